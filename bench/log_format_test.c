@@ -0,0 +1,120 @@
+/**
+ * Host check of the deferred debug_log() formatter
+ *
+ * Each case captures its arguments with util/log_format the way
+ * debug_log() queues them, formats them back, and compares the message
+ * with what vsnprintf makes of the same call: flags, '*' widths and
+ * precisions, length modifiers, strings and NULL, a full message buffer,
+ * and arguments that do not fit the record.
+ *
+ * Usage: log_format_test
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "util/log_format.h"
+#include "config/system_config.h"
+
+#define MESSAGE_SIZE    256
+
+static int failures = 0;
+static int cases = 0;
+
+static size_t capture(uint8_t *out, size_t capacity, bool *truncated, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t len = log_format_capture(out, capacity, format, args, truncated);
+    va_end(args);
+    return len;
+}
+
+// Formats through a record of arg_bytes and through vsnprintf
+static void check_v(int line, size_t arg_bytes, size_t out_size, const char *format, va_list args) {
+    uint8_t record[256];
+    char expected[MESSAGE_SIZE];
+    char actual[MESSAGE_SIZE];
+    bool truncated = false;
+    va_list copy;
+
+    va_copy(copy, args);
+    vsnprintf(expected, out_size, format, copy);
+    va_end(copy);
+
+    size_t arg_len = log_format_capture(record, arg_bytes, format, args, &truncated);
+    size_t len = log_format_message(format, record, arg_len, truncated, actual, out_size);
+
+    if (truncated && strlen(expected) + 4 <= out_size) {
+        // What fit is formatted, then the message ends in "..."
+        size_t prefix = len >= 3 ? len - 3 : 0;
+        if (len < 3 || strcmp(actual + prefix, "...") != 0 ||
+            strncmp(actual, expected, prefix) != 0) {
+            printf("FAIL line %d: \"%s\" is no truncated \"%s\"\n", line, actual, expected);
+            failures++;
+        }
+    } else if (strcmp(actual, expected) != 0 || len != strlen(actual)) {
+        printf("FAIL line %d: \"%s\" != \"%s\"\n", line, actual, expected);
+        failures++;
+    }
+    cases++;
+}
+
+static void check_sized(int line, size_t arg_bytes, size_t out_size, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    check_v(line, arg_bytes, out_size, format, args);
+    va_end(args);
+}
+
+#define CHECK(...) check_sized(__LINE__, DEBUG_LOG_ARG_BYTES, MESSAGE_SIZE, __VA_ARGS__)
+
+int main(void) {
+    const char *volatile null_string = NULL;
+    long double ld = 2.5L;
+    uint8_t record[DEBUG_LOG_ARG_BYTES];
+    bool truncated;
+
+    // Plain text and %%
+    CHECK("no conversions");
+    CHECK("100%% sure, %d%%", 42);
+
+    // Flags, widths and precisions
+    CHECK("[%-6d] [%+d] [% d] [%06d] [%#x] [%#o]", 17, 5, 9, -42, 255, 8);
+    CHECK("[%8.3f] [%-10.2e] [%+.0f] [%#.0f] [%G]", 3.14159, 12345.678, 2.5, 3.0, 1e-10);
+    CHECK("[%*d] [%-*d] [%.*d] [%*.*f]", 5, 42, 7, -3, 4, 9, 10, 2, 1.005);
+    CHECK("[%*d] [%.*f] [%.*s]", -6, 12, -1, 2.25, -1, "no precision");
+    CHECK("[%c] [%5c] [%-3c]", 'a', 'b', 'c');
+
+    // Length modifiers
+    CHECK("%hhd %hhu %hd %hu", -3, 250, -1234, 65000);
+    CHECK("%ld %lu %lx", -123456789L, 4000000000UL, 0xDEADBEEFUL);
+    CHECK("%lld %llu %llX", -1234567890123LL, 18000000000000000000ULL, 0x1234ABCDULL);
+    CHECK("%jd %zu %zd %td", (intmax_t)-99, (size_t)4096, (ssize_t)-7, (ptrdiff_t)-12);
+    CHECK("%Lf %.1Le", ld, ld);
+    CHECK("%p %p", (void *)&failures, (void *)NULL);
+
+    // Strings and NULL
+    CHECK("%s|%10s|%-10s|%.3s", "abc", "right", "left", "truncate");
+    CHECK("tag=%s value=%d", null_string, 7);
+    CHECK("%s%s%s", "", "x", "");
+
+    // A message longer than its buffer is cut like vsnprintf cuts it
+    check_sized(__LINE__, DEBUG_LOG_ARG_BYTES, 16, "%s and %d more", "a long string", 12345);
+    check_sized(__LINE__, DEBUG_LOG_ARG_BYTES, 1, "%d", 5);
+
+    // Arguments beyond the record are left out and marked
+    check_sized(__LINE__, 8, MESSAGE_SIZE, "%d %d %d %d", 1, 2, 3, 4);
+    check_sized(__LINE__, 8, MESSAGE_SIZE, "%d then %s", 1, "is cut short");
+    capture(record, sizeof(record), &truncated, "%s", "0123456789012345678901234567890123456789012345678901234567890");
+    if (!truncated) {
+        printf("FAIL line %d: a string longer than the record is not marked truncated\n", __LINE__);
+        failures++;
+    }
+    cases++;
+
+    printf("%d cases, %d failed\n%s\n", cases, failures, failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
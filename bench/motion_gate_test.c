@@ -0,0 +1,136 @@
+/**
+ * Host check of the motion gate's flex stage
+ *
+ * Feeds synthetic frames with a still IMU and Gaussian flex noise through
+ * processing/motion_gate and checks that
+ *
+ *   - sensor noise alone, including one much noisier joint, leaves the
+ *     gate idle apart from its keep-alive checks,
+ *   - a small bend shared by every joint wakes the pose matcher, and
+ *   - it still does right after a large, fast bend, which must not raise
+ *     the noise floor the next pose change is judged by.
+ *
+ * Usage: motion_gate_test
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "processing/motion_gate.h"
+#include "config/system_config.h"
+
+#define JOINTS          10
+#define NOISE_FRAMES    2000
+#define DETECT_FRAMES   10      // A pose change must be caught this soon
+
+static int failures = 0;
+static uint32_t rng_state = 0x2545F491;
+static float pose[JOINTS];
+static float joint_noise[JOINTS];
+static uint32_t sequence = 0;
+
+static float next_uniform(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return ((rng_state >> 8) + 0.5f) / 16777216.0f;
+}
+
+static float next_gaussian(void) {
+    return sqrtf(-2.0f * logf(next_uniform())) * cosf(6.2831853f * next_uniform());
+}
+
+static motion_gate_decision_t step(void) {
+    sensor_data_t frame;
+
+    memset(&frame, 0, sizeof(frame));
+    for (int i = 0; i < JOINTS; i++) {
+        frame.flex_data.angles[i] = pose[i] + joint_noise[i] * next_gaussian();
+    }
+    frame.flex_data_valid = true;
+    frame.imu_data.accel[2] = 9.80665f;
+    frame.imu_data_valid = true;
+    frame.sequence_number = sequence;
+    frame.timestamp = sequence * 10;
+    sequence++;
+    return motion_gate_evaluate(&frame);
+}
+
+// Runs until the pose matcher's hangover from earlier changes is over
+static void settle(void) {
+    int idle_run = 0;
+    for (int n = 0; n < 10 * MOTION_GATE_SETTLE_FRAMES && idle_run < MOTION_GATE_SETTLE_FRAMES; n++) {
+        idle_run = step() == MOTION_GATE_IDLE ? idle_run + 1 : 0;
+    }
+}
+
+// Frames of noise that woke the matcher, keep-alive checks left out
+static int noise_wakeups(int frames) {
+    motion_gate_stats_t before, after;
+
+    settle();
+    motion_gate_get_stats(&before);
+    for (int n = 0; n < frames; n++) {
+        step();
+    }
+    motion_gate_get_stats(&after);
+    return (int)(after.static_pose - before.static_pose) - frames / MOTION_GATE_IDLE_INTERVAL;
+}
+
+// Whether a bend of every joint by delta starts a pose matcher run
+static bool bend_detected(float delta) {
+    settle();
+    for (int i = 0; i < JOINTS; i++) {
+        pose[i] += delta;
+    }
+
+    // A keep-alive check runs a single frame, a change runs the hangover
+    int run = 0;
+    for (int n = 0; n < DETECT_FRAMES + MOTION_GATE_SETTLE_FRAMES; n++) {
+        if (step() == MOTION_GATE_IDLE) {
+            if (n >= DETECT_FRAMES) {
+                return false;
+            }
+            run = 0;
+        } else if (++run >= MOTION_GATE_SETTLE_FRAMES) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void expect(bool ok, const char *what) {
+    printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) {
+        failures++;
+    }
+}
+
+int main(void) {
+    for (int i = 0; i < JOINTS; i++) {
+        pose[i] = 40.0f + 3.0f * i;
+        joint_noise[i] = 0.5f;
+    }
+    motion_gate_init();
+
+    int wakeups = noise_wakeups(NOISE_FRAMES);
+    printf("noise: %d wakeups in %d frames\n", wakeups, NOISE_FRAMES);
+    expect(wakeups <= 0, "sensor noise leaves the gate idle");
+
+    joint_noise[3] = 6.0f;
+    noise_wakeups(NOISE_FRAMES);
+    wakeups = noise_wakeups(NOISE_FRAMES);
+    printf("noisy joint: %d wakeups in %d frames\n", wakeups, NOISE_FRAMES);
+    expect(wakeups <= NOISE_FRAMES / 100, "a noisy joint does not trigger on its own");
+    joint_noise[3] = 0.5f;
+    noise_wakeups(NOISE_FRAMES);
+
+    expect(bend_detected(2.0f), "a 2 degree bend of every joint is detected");
+
+    // Large bend in a single frame, held past the hangover, then a small one
+    expect(bend_detected(30.0f), "a 30 degree bend is detected");
+    expect(bend_detected(-2.0f), "a 2 degree bend right after it is detected");
+
+    printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,726 @@
+/**
+ * Host replay benchmark for the processing pipeline
+ *
+ * Feeds a recorded sensor trace through the same stages the glove runs
+ * (sensor fusion, history and gating, feature extraction, template
+ * matching and decoding) and reports throughput, per-stage latency and
+ * recognition accuracy against the labels in the trace.
+ *
+ * Trace format: CSV, one sensor frame per line
+ *
+ *   t_ms, flex0..flex9 (deg), ax, ay, az (m/s²), gx, gy, gz (°/s), touch0..touch4, label
+ *
+ * The label names the gesture being performed during that frame; empty
+ * or "-" means none. Lines starting with '#' and a non-numeric header
+ * line are skipped. Binary traces from core/trace_recorder are read as
+ * well; they carry no labels.
+ *
+ * Usage: pipeline_bench [--realtime] [--templates image.bin] [--train trace.csv] [-v] trace.csv
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <time.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "processing/sensor_fusion.h"
+#include "processing/feature_extraction.h"
+#include "processing/gesture_detection.h"
+#include "processing/gesture_decoder.h"
+#include "processing/motion_gate.h"
+#include "processing/camera_roi.h"
+#include "core/trace_recorder.h"
+#include "gesture_templates.h"
+#include "config/system_config.h"
+#include "util/ahrs.h"
+#include "util/history_window.h"
+#include "util/window_stats.h"
+#include "ml_inference.h"
+
+static const char *TAG = "PIPELINE_BENCH";
+
+#define GRAVITY_EARTH       9.80665f
+#define DEG_TO_RAD          0.0174532925f
+#define TRACE_FIELDS        23
+#define LABEL_LEN           GESTURE_TEMPLATE_NAME_LEN
+#define MAX_LABELS          64
+#define LABEL_LEAD_MS       250     // Hand labels trail the moment the pose is reached
+
+/**
+ * @brief One line of a trace
+ */
+typedef struct {
+    uint32_t t_ms;
+    float flex[10];
+    float accel[3];
+    float gyro[3];
+    bool touch[5];
+    char label[LABEL_LEN];
+} trace_frame_t;
+
+typedef struct {
+    trace_frame_t *frames;
+    size_t count;
+} trace_t;
+
+/**
+ * @brief Output of the feature stage, as processing_task.c hands it to the classify stage
+ */
+typedef struct {
+    feature_vector_t features;
+    float motion_sequence[GESTURE_MOTION_SEQUENCE_VALUES];
+    bool has_motion;
+    motion_gate_decision_t gate;
+    const char *label;          // Ground truth at the aligned frame time
+} feature_frame_t;
+
+typedef void (*frame_sink_t)(feature_frame_t *frame);
+
+/**
+ * @brief A labeled run of frames in the trace
+ */
+typedef struct {
+    char name[LABEL_LEN];
+    uint32_t start_ms;
+    uint32_t end_ms;
+    bool matched;
+} segment_t;
+
+/**
+ * @brief Running sums of one label, for --train
+ */
+typedef struct {
+    char name[LABEL_LEN];
+    double features[FEATURE_BUFFER_SIZE];
+    uint32_t frames;
+    uint32_t dynamic_frames;
+    double sequence[GESTURE_MOTION_SEQUENCE_VALUES];
+    uint32_t sequences;
+    float pending_sequence[GESTURE_MOTION_SEQUENCE_VALUES];
+    bool pending;
+    uint16_t feature_count;
+} label_model_t;
+
+// Wall-clock latency of each stage; esp_timer is trace time
+static ml_latency_histogram_t stage_latency[ML_STAGE_COUNT];
+static const char *stage_names[ML_STAGE_COUNT] = { "fusion", "features", "matching" };
+
+// Trace time from the end of a gesture to its result, the decoder's share of the latency budget
+static ml_latency_histogram_t decision_lag;
+
+static history_window_t history_window;
+static window_stats_t window_stats;
+static ahrs_t ahrs;
+
+static segment_t *segments = NULL;
+static size_t segment_count = 0;
+
+static uint32_t detections = 0;
+static uint32_t true_positives = 0;
+static uint32_t false_positives = 0;
+
+static label_model_t label_models[MAX_LABELS];
+static size_t label_model_count = 0;
+static char previous_label[LABEL_LEN];
+static label_model_t *previous_model = NULL;
+
+static int64_t wall_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void sleep_until_us(int64_t deadline_us) {
+    int64_t now = wall_time_us();
+    if (deadline_us > now) {
+        struct timespec ts = {
+            .tv_sec = (deadline_us - now) / 1000000,
+            .tv_nsec = ((deadline_us - now) % 1000000) * 1000
+        };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static bool is_no_label(const char *label) {
+    return label[0] == '\0' || strcmp(label, "-") == 0;
+}
+
+// Split one CSV line into a frame; false for comments, headers and malformed lines
+static bool parse_frame(char *line, trace_frame_t *frame) {
+    char *fields[TRACE_FIELDS];
+    int count = 0;
+
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    if (!isdigit((unsigned char)*line)) {
+        return false;
+    }
+
+    char *cursor = line;
+    while (count < TRACE_FIELDS) {
+        fields[count++] = cursor;
+        char *comma = strchr(cursor, ',');
+        if (comma == NULL) {
+            break;
+        }
+        *comma = '\0';
+        cursor = comma + 1;
+    }
+    if (count < TRACE_FIELDS - 1) {
+        return false;
+    }
+
+    memset(frame, 0, sizeof(*frame));
+    frame->t_ms = (uint32_t)strtoul(fields[0], NULL, 10);
+    for (int i = 0; i < 10; i++) {
+        frame->flex[i] = strtof(fields[1 + i], NULL);
+    }
+    for (int i = 0; i < 3; i++) {
+        frame->accel[i] = strtof(fields[11 + i], NULL);
+        frame->gyro[i] = strtof(fields[14 + i], NULL);
+    }
+    for (int i = 0; i < 5; i++) {
+        frame->touch[i] = strtol(fields[17 + i], NULL, 10) != 0;
+    }
+
+    if (count == TRACE_FIELDS) {
+        // Trim whitespace and the line ending around the label
+        char *label = fields[TRACE_FIELDS - 1];
+        while (*label == ' ' || *label == '\t') {
+            label++;
+        }
+        size_t length = strcspn(label, " \t\r\n");
+        if (length >= LABEL_LEN) {
+            length = LABEL_LEN - 1;
+        }
+        memcpy(frame->label, label, length);
+    }
+    return true;
+}
+
+// Add room for one more frame
+static esp_err_t grow_trace(trace_t *trace, size_t *capacity) {
+    if (trace->count < *capacity) {
+        return ESP_OK;
+    }
+
+    *capacity = (*capacity > 0) ? *capacity * 2 : 1024;
+    trace_frame_t *frames = realloc(trace->frames, *capacity * sizeof(trace_frame_t));
+    if (frames == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    trace->frames = frames;
+    return ESP_OK;
+}
+
+// Recorder files: one frame per record, fixed-point units back to floats
+static esp_err_t load_recorded_trace(FILE *file, trace_t *trace) {
+    trace_file_header_t header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.version != TRACE_FILE_VERSION ||
+        header.record_size != sizeof(trace_record_t)) {
+        ESP_LOGE(TAG, "Unsupported recorder trace");
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    size_t capacity = 0;
+    trace_record_t record;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        esp_err_t ret = grow_trace(trace, &capacity);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+
+        // Frames of a FIFO burst all carry the newest timestamp
+        if (trace->count > 0 && record.timestamp_ms <= trace->frames[trace->count - 1].t_ms) {
+            continue;
+        }
+
+        trace_frame_t *frame = &trace->frames[trace->count++];
+        memset(frame, 0, sizeof(*frame));
+        frame->t_ms = record.timestamp_ms;
+        for (int i = 0; i < 10; i++) {
+            frame->flex[i] = record.flex_angle[i] / 100.0f;
+        }
+        for (int i = 0; i < 3; i++) {
+            frame->accel[i] = record.accel[i] * GRAVITY_EARTH / 1000.0f;
+            frame->gyro[i] = record.gyro[i] / 10.0f;
+        }
+        for (int i = 0; i < 5; i++) {
+            frame->touch[i] = (record.touch_mask & (1 << i)) != 0;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t load_trace(const char *path, trace_t *trace) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        ESP_LOGE(TAG, "Cannot open trace %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    trace->frames = NULL;
+    trace->count = 0;
+
+    uint32_t magic = 0;
+    bool recorded = fread(&magic, sizeof(magic), 1, file) == 1 && magic == TRACE_FILE_MAGIC;
+    rewind(file);
+    if (recorded) {
+        esp_err_t ret = load_recorded_trace(file, trace);
+        fclose(file);
+        if (ret == ESP_OK && trace->count == 0) {
+            ret = ESP_ERR_INVALID_SIZE;
+        }
+        return ret;
+    }
+
+    size_t capacity = 0;
+    char line[512];
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (grow_trace(trace, &capacity) != ESP_OK) {
+            fclose(file);
+            return ESP_ERR_NO_MEM;
+        }
+
+        if (!parse_frame(line, &trace->frames[trace->count])) {
+            continue;
+        }
+
+        // Fusion only accepts samples that move forward in time
+        if (trace->count > 0 && trace->frames[trace->count].t_ms <= trace->frames[trace->count - 1].t_ms) {
+            ESP_LOGW(TAG, "Skipping out-of-order frame at %lu ms",
+                     (unsigned long)trace->frames[trace->count].t_ms);
+            continue;
+        }
+        trace->count++;
+    }
+
+    fclose(file);
+    if (trace->count == 0) {
+        ESP_LOGE(TAG, "Trace %s has no frames", path);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+// Fill a sensor frame the way the drivers would, including the AHRS pass of imu.c
+static void build_sensor_frame(const trace_frame_t *source, float dt, uint32_t sequence, sensor_data_t *out) {
+    memset(out, 0, sizeof(*out));
+
+    memcpy(out->flex_data.angles, source->flex, sizeof(source->flex));
+    out->flex_data.timestamp = source->t_ms;
+    out->flex_data_valid = true;
+
+    imu_data_t *imu = &out->imu_data;
+    memcpy(imu->accel, source->accel, sizeof(source->accel));
+    memcpy(imu->gyro, source->gyro, sizeof(source->gyro));
+
+    float gyro_rad[3] = {
+        imu->gyro[0] * DEG_TO_RAD,
+        imu->gyro[1] * DEG_TO_RAD,
+        imu->gyro[2] * DEG_TO_RAD
+    };
+    ahrs_update(&ahrs, gyro_rad, imu->accel, dt);
+    memcpy(imu->quaternion, ahrs.q, sizeof(imu->quaternion));
+
+    float gravity_dir[3];
+    ahrs_quaternion_gravity(ahrs.q, gravity_dir);
+    for (int i = 0; i < 3; i++) {
+        imu->gravity[i] = gravity_dir[i] * GRAVITY_EARTH;
+        imu->linear_accel[i] = imu->accel[i] - imu->gravity[i];
+    }
+    imu->timestamp = source->t_ms;
+    out->imu_data_valid = true;
+
+    memcpy(out->touch_data.touch_status, source->touch, sizeof(source->touch));
+    out->touch_data.timestamp = source->t_ms;
+    out->touch_data_valid = true;
+
+    out->sequence_number = sequence;
+    out->timestamp = source->t_ms;
+}
+
+// Label of the trace frame at or before t, advancing a cursor as t grows
+static const char *label_at(const trace_t *trace, size_t *cursor, uint32_t t) {
+    while (*cursor + 1 < trace->count && trace->frames[*cursor + 1].t_ms <= t) {
+        (*cursor)++;
+    }
+    return trace->frames[*cursor].label;
+}
+
+static esp_err_t reset_pipeline(void) {
+    history_window_init(&history_window);
+    window_stats_init(&window_stats);
+    ahrs_init(&ahrs, IMU_AHRS_BETA);
+    motion_gate_init();
+    gesture_decoder_reset();
+
+    esp_err_t ret = sensor_fusion_init();
+    if (ret == ESP_OK) {
+        ret = feature_extraction_init();
+    }
+    return ret;
+}
+
+// Stage 2 of processing_task.c; false when the gate skips the frame
+static bool extract_frame(sensor_data_t *sensor_data, feature_frame_t *frame) {
+    history_window_push(&history_window, sensor_data);
+    window_stats_update(&window_stats, &history_window);
+
+    frame->gate = motion_gate_evaluate(sensor_data);
+    if (frame->gate == MOTION_GATE_IDLE) {
+        return false;
+    }
+
+    if (feature_extraction_process(sensor_data, &history_window, &window_stats,
+                                   &frame->features) != ESP_OK) {
+        return false;
+    }
+
+    frame->has_motion = frame->gate == MOTION_GATE_DYNAMIC &&
+                        gesture_detection_capture_motion(&history_window, frame->motion_sequence) == ESP_OK;
+    return true;
+}
+
+static void record(ml_stage_t stage, int64_t start_us) {
+    ml_latency_record(&stage_latency[stage], (uint32_t)(wall_time_us() - start_us));
+}
+
+// Replay a trace through fusion and the feature stage, handing each frame to a sink
+static esp_err_t replay(const trace_t *trace, bool realtime, frame_sink_t sink) {
+    esp_err_t ret = reset_pipeline();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    int64_t wall_start = wall_time_us();
+    uint32_t trace_start = trace->frames[0].t_ms;
+    size_t label_cursor = 0;
+    sensor_data_t frame;
+    sensor_data_t aligned;
+    feature_frame_t features;
+
+    for (size_t i = 0; i < trace->count; i++) {
+        const trace_frame_t *source = &trace->frames[i];
+        if (realtime) {
+            sleep_until_us(wall_start + (int64_t)(source->t_ms - trace_start) * 1000);
+        }
+
+        float dt = (i > 0) ? (source->t_ms - trace->frames[i - 1].t_ms) / 1000.0f : 0.0f;
+        build_sensor_frame(source, dt, (uint32_t)i, &frame);
+        bench_set_time_us((int64_t)source->t_ms * 1000);
+
+        // Stage 1: ingest, then every fusion tick that is due
+        int64_t start = wall_time_us();
+        sensor_fusion_ingest(&frame);
+        size_t ready = 0;
+        sensor_data_t pending[8];
+        while (ready < sizeof(pending) / sizeof(pending[0]) && sensor_fusion_get_aligned(&aligned) == ESP_OK) {
+            pending[ready++] = aligned;
+        }
+        record(ML_STAGE_FUSION, start);
+
+        for (size_t k = 0; k < ready; k++) {
+            start = wall_time_us();
+            bool keep = extract_frame(&pending[k], &features);
+            record(ML_STAGE_FEATURES, start);
+
+            if (keep) {
+                features.label = label_at(trace, &label_cursor, pending[k].timestamp);
+                sink(&features);
+            }
+        }
+    }
+
+    return ESP_OK;
+}
+
+// Stage 3 of processing_task.c, scored against the ground truth
+static void classify_sink(feature_frame_t *frame) {
+    processing_result_t result;
+
+    int64_t start = wall_time_us();
+    esp_err_t ret = gesture_detection_process(&frame->features, frame->has_motion ? frame->motion_sequence : NULL,
+                                              &result);
+    record(ML_STAGE_MATCHING, start);
+
+    if (ret != ESP_OK || result.confidence <= 0.0f) {
+        return;
+    }
+
+    uint32_t now_ms = esp_timer_get_time() / 1000;
+    detections++;
+    ml_latency_record(&decision_lag, (now_ms - result.sample_timestamp) * 1000);
+
+    // The decoder reports a gesture up to its maximum lag after it ends
+    for (size_t s = 0; s < segment_count; s++) {
+        segment_t *segment = &segments[s];
+        if (!segment->matched && now_ms + LABEL_LEAD_MS >= segment->start_ms &&
+            now_ms <= segment->end_ms + GESTURE_DECODER_MAX_LAG_MS &&
+            strncmp(segment->name, result.gesture_name, LABEL_LEN) == 0) {
+            segment->matched = true;
+            true_positives++;
+            ESP_LOGI(TAG, "%6lu ms  %-12s %.2f", (unsigned long)now_ms, result.gesture_name, result.confidence);
+            return;
+        }
+    }
+
+    false_positives++;
+    ESP_LOGI(TAG, "%6lu ms  %-12s %.2f  (false)", (unsigned long)now_ms, result.gesture_name, result.confidence);
+}
+
+static label_model_t *find_model(const char *name) {
+    for (size_t i = 0; i < label_model_count; i++) {
+        if (strcmp(label_models[i].name, name) == 0) {
+            return &label_models[i];
+        }
+    }
+
+    if (label_model_count == MAX_LABELS) {
+        return NULL;
+    }
+    label_model_t *model = &label_models[label_model_count++];
+    memset(model, 0, sizeof(*model));
+    strncpy(model->name, name, LABEL_LEN - 1);
+    return model;
+}
+
+// A segment's motion is best seen at its last moving frame, when the window covers all of it
+static void close_segment(void) {
+    if (previous_model != NULL && previous_model->pending) {
+        for (int v = 0; v < GESTURE_MOTION_SEQUENCE_VALUES; v++) {
+            previous_model->sequence[v] += previous_model->pending_sequence[v];
+        }
+        previous_model->sequences++;
+        previous_model->pending = false;
+    }
+    previous_model = NULL;
+}
+
+// Accumulate the features of each labeled frame
+static void train_sink(feature_frame_t *frame) {
+    if (strcmp(frame->label, previous_label) != 0) {
+        close_segment();
+        strncpy(previous_label, frame->label, LABEL_LEN - 1);
+        if (!is_no_label(frame->label)) {
+            previous_model = find_model(frame->label);
+        }
+    }
+
+    label_model_t *model = previous_model;
+    if (model == NULL) {
+        return;
+    }
+
+    model->feature_count = frame->features.feature_count;
+    for (uint16_t f = 0; f < frame->features.feature_count; f++) {
+        model->features[f] += frame->features.features[f];
+    }
+    model->frames++;
+
+    if (frame->gate == MOTION_GATE_DYNAMIC) {
+        model->dynamic_frames++;
+    }
+    if (frame->has_motion) {
+        memcpy(model->pending_sequence, frame->motion_sequence, sizeof(model->pending_sequence));
+        model->pending = true;
+    }
+}
+
+// Add one centroid per label of a training trace to the template store,
+// replacing templates of the same name
+static esp_err_t train(const trace_t *trace) {
+    esp_err_t ret = replay(trace, false, train_sink);
+    close_segment();
+
+    for (size_t i = 0; i < label_model_count && ret == ESP_OK; i++) {
+        label_model_t *model = &label_models[i];
+        float features[FEATURE_BUFFER_SIZE];
+        for (uint16_t f = 0; f < model->feature_count; f++) {
+            features[f] = (float)(model->features[f] / model->frames);
+        }
+
+        bool is_dynamic = model->sequences > 0 && 2 * model->dynamic_frames > model->frames;
+        ret = gesture_templates_add(model->name, features, model->feature_count, is_dynamic, false,
+                                    CONFIDENCE_THRESHOLD);
+        if (ret == ESP_OK && is_dynamic) {
+            float sequence[GESTURE_MOTION_SEQUENCE_VALUES];
+            for (int v = 0; v < GESTURE_MOTION_SEQUENCE_VALUES; v++) {
+                sequence[v] = (float)(model->sequence[v] / model->sequences);
+            }
+            ret = gesture_templates_set_sequence(model->name, sequence);
+        }
+        printf("trained %-12s %s, %lu frames\n", model->name, is_dynamic ? "dynamic" : "static ",
+               (unsigned long)model->frames);
+    }
+    return ret;
+}
+
+static esp_err_t find_segments(const trace_t *trace) {
+    segments = calloc(trace->count, sizeof(segment_t));
+    if (segments == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (size_t i = 0; i < trace->count; i++) {
+        const trace_frame_t *frame = &trace->frames[i];
+        if (is_no_label(frame->label)) {
+            continue;
+        }
+
+        segment_t *last = (segment_count > 0) ? &segments[segment_count - 1] : NULL;
+        bool continues = last != NULL && i > 0 && strcmp(trace->frames[i - 1].label, frame->label) == 0;
+        if (continues) {
+            last->end_ms = frame->t_ms;
+        } else {
+            segment_t *segment = &segments[segment_count++];
+            strncpy(segment->name, frame->label, LABEL_LEN - 1);
+            segment->start_ms = frame->t_ms;
+            segment->end_ms = frame->t_ms;
+        }
+    }
+    return ESP_OK;
+}
+
+static void print_report(const trace_t *trace, int64_t wall_us) {
+    double seconds = wall_us / 1e6;
+    double trace_seconds = (trace->frames[trace->count - 1].t_ms - trace->frames[0].t_ms) / 1000.0;
+
+    printf("\n%zu frames (%.1f s of trace) in %.3f s: %.0f frames/s, %.1fx real time\n",
+           trace->count, trace_seconds, seconds, trace->count / seconds,
+           (seconds > 0.0) ? trace_seconds / seconds : 0.0);
+
+    printf("\n%-10s %8s %8s %8s %8s %8s\n", "stage", "count", "p50 us", "p95 us", "p99 us", "max us");
+    for (int s = 0; s < ML_STAGE_COUNT; s++) {
+        ml_latency_stats_t stats;
+        ml_latency_summarize(&stage_latency[s], &stats);
+        printf("%-10s %8lu %8lu %8lu %8lu %8lu\n", stage_names[s], (unsigned long)stats.count,
+               (unsigned long)stats.p50_us, (unsigned long)stats.p95_us,
+               (unsigned long)stats.p99_us, (unsigned long)stats.max_us);
+    }
+
+    ml_latency_stats_t lag;
+    ml_latency_summarize(&decision_lag, &lag);
+    if (lag.count > 0) {
+        printf("\ndecision lag: p50 %lu ms, p95 %lu ms, max %lu ms after the gesture ended\n",
+               (unsigned long)(lag.p50_us / 1000), (unsigned long)(lag.p95_us / 1000),
+               (unsigned long)(lag.max_us / 1000));
+    }
+
+    motion_gate_stats_t gate;
+    motion_gate_get_stats(&gate);
+    printf("\ngate: %lu idle, %lu static, %lu dynamic\n", (unsigned long)gate.idle,
+           (unsigned long)gate.static_pose, (unsigned long)gate.dynamic);
+
+    if (segment_count == 0) {
+        printf("accuracy: trace has no labels\n");
+        return;
+    }
+
+    uint32_t misses = segment_count - true_positives;
+    printf("accuracy: %zu gestures, %lu detections, %lu correct, %lu false, %lu missed\n",
+           segment_count, (unsigned long)detections, (unsigned long)true_positives,
+           (unsigned long)false_positives, (unsigned long)misses);
+    printf("precision %.3f, recall %.3f\n",
+           (detections > 0) ? (double)true_positives / detections : 0.0,
+           (double)true_positives / segment_count);
+
+    for (size_t s = 0; s < segment_count; s++) {
+        if (!segments[s].matched) {
+            ESP_LOGI(TAG, "Missed %s at %lu-%lu ms", segments[s].name,
+                     (unsigned long)segments[s].start_ms, (unsigned long)segments[s].end_ms);
+        }
+    }
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [--realtime] [--templates image.bin] [--train trace.csv] [-v] trace.csv\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    const char *trace_path = NULL;
+    const char *templates_path = NULL;
+    const char *train_path = NULL;
+    bool realtime = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--realtime") == 0) {
+            realtime = true;
+        } else if (strcmp(argv[i], "--templates") == 0 && i + 1 < argc) {
+            templates_path = argv[++i];
+        } else if (strcmp(argv[i], "--train") == 0 && i + 1 < argc) {
+            train_path = argv[++i];
+        } else if (strcmp(argv[i], "-v") == 0) {
+            bench_log_level = ESP_LOG_INFO;
+        } else if (argv[i][0] != '-' && trace_path == NULL) {
+            trace_path = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (trace_path == NULL) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (templates_path != NULL &&
+        bench_partition_load(GESTURE_TEMPLATES_PARTITION_LABEL, templates_path) != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot load template image %s", templates_path);
+        return 1;
+    }
+
+    trace_t trace;
+    esp_err_t ret = load_trace(trace_path, &trace);
+    if (ret == ESP_OK) {
+        ret = find_segments(&trace);
+    }
+    if (ret == ESP_OK) {
+        ret = camera_roi_init();
+    }
+    if (ret == ESP_OK) {
+        ret = gesture_templates_init();
+    }
+
+    if (ret == ESP_OK && train_path != NULL) {
+        trace_t training;
+        ret = load_trace(train_path, &training);
+        if (ret == ESP_OK) {
+            ret = train(&training);
+            free(training.frames);
+        }
+        for (int s = 0; s < ML_STAGE_COUNT; s++) {
+            ml_latency_reset(&stage_latency[s]);
+        }
+    }
+
+    // The classifier snapshots the store, so it comes up after training
+    if (ret == ESP_OK) {
+        ret = gesture_detection_init();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Setup failed: %s", esp_err_to_name(ret));
+        return 1;
+    }
+
+    int64_t start = wall_time_us();
+    ret = replay(&trace, realtime, classify_sink);
+    int64_t elapsed = wall_time_us() - start;
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Replay failed: %s", esp_err_to_name(ret));
+        return 1;
+    }
+
+    print_report(&trace, elapsed);
+
+    free(segments);
+    free(trace.frames);
+    return 0;
+}
@@ -0,0 +1,9 @@
+#ifndef BENCH_DSPS_DOTPROD_H
+#define BENCH_DSPS_DOTPROD_H
+
+#include "esp_err.h"
+
+// Scalar stand-in for the esp-dsp dot product
+esp_err_t dsps_dotprod_f32(const float *src1, const float *src2, float *dest, int len);
+
+#endif /* BENCH_DSPS_DOTPROD_H */
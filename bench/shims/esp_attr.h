@@ -0,0 +1,9 @@
+#ifndef BENCH_ESP_ATTR_H
+#define BENCH_ESP_ATTR_H
+
+// Placement attributes mean nothing on the host
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define EXT_RAM_BSS_ATTR
+
+#endif /* BENCH_ESP_ATTR_H */
@@ -0,0 +1,39 @@
+#ifndef BENCH_ESP_PARTITION_H
+#define BENCH_ESP_PARTITION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * Partitions live in RAM. Each starts erased, or with the image given to
+ * bench_partition_load(); writes only clear bits, as on flash.
+ */
+typedef int esp_partition_type_t;
+typedef int esp_partition_subtype_t;
+typedef int esp_partition_mmap_memory_t;
+typedef uint32_t esp_partition_mmap_handle_t;
+
+#define ESP_PARTITION_TYPE_DATA     1
+#define ESP_PARTITION_MMAP_DATA     0
+
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t size;
+    char label[17];
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle);
+void esp_partition_munmap(esp_partition_mmap_handle_t handle);
+
+esp_err_t bench_partition_load(const char *label, const char *path);
+
+#endif /* BENCH_ESP_PARTITION_H */
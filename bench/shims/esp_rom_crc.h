@@ -0,0 +1,8 @@
+#ifndef BENCH_ESP_ROM_CRC_H
+#define BENCH_ESP_ROM_CRC_H
+
+#include <stdint.h>
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+#endif /* BENCH_ESP_ROM_CRC_H */
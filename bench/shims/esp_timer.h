@@ -0,0 +1,15 @@
+#ifndef BENCH_ESP_TIMER_H
+#define BENCH_ESP_TIMER_H
+
+#include <stdint.h>
+
+/**
+ * Trace time, not wall time: the replay sets it to each frame's recorded
+ * timestamp, so the pipeline sees the clock it saw on the glove however
+ * fast the trace is replayed.
+ */
+int64_t esp_timer_get_time(void);
+
+void bench_set_time_us(int64_t time_us);
+
+#endif /* BENCH_ESP_TIMER_H */
@@ -0,0 +1,31 @@
+#ifndef BENCH_FREERTOS_H
+#define BENCH_FREERTOS_H
+
+#include <stdint.h>
+
+// Just enough FreeRTOS for the pipeline modules to build on the host
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint8_t StackType_t;
+
+// Control blocks for static tasks and queues; the shims allocate their own
+typedef struct { uint8_t unused; } StaticTask_t;
+typedef struct { uint8_t unused; } StaticQueue_t;
+
+#define pdTRUE                  1
+#define pdFALSE                 0
+#define pdPASS                  pdTRUE
+#define pdFAIL                  pdFALSE
+#define portMAX_DELAY           ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS      1
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))
+#define errQUEUE_FULL           0
+
+// Critical sections guard nothing in a single-threaded replay
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    0
+#define taskENTER_CRITICAL(mux)         ((void)(mux))
+#define taskEXIT_CRITICAL(mux)          ((void)(mux))
+
+#endif /* BENCH_FREERTOS_H */
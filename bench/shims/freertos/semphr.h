@@ -0,0 +1,24 @@
+#ifndef BENCH_FREERTOS_SEMPHR_H
+#define BENCH_FREERTOS_SEMPHR_H
+
+#include "freertos/FreeRTOS.h"
+
+// Mutexes guard nothing in a single-threaded replay
+typedef struct { uint8_t unused; } StaticSemaphore_t;
+typedef StaticSemaphore_t *SemaphoreHandle_t;
+
+#define xSemaphoreCreateMutexStatic(buffer)     (buffer)
+#define xSemaphoreCreateBinaryStatic(buffer)    (buffer)
+
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait) {
+    (void)sem;
+    (void)wait;
+    return pdTRUE;
+}
+
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    (void)sem;
+    return pdTRUE;
+}
+
+#endif /* BENCH_FREERTOS_SEMPHR_H */
@@ -0,0 +1,35 @@
+#ifndef BENCH_FREERTOS_TASK_H
+#define BENCH_FREERTOS_TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+typedef void *TaskHandle_t;
+
+typedef enum {
+    eNoAction = 0,
+    eSetBits,
+    eIncrement,
+    eSetValueWithOverwrite,
+    eSetValueWithoutOverwrite
+} eNotifyAction;
+
+/**
+ * The replay is single-threaded: tasks are accepted but never run, and a
+ * delay returns at once.
+ */
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                           UBaseType_t priority, StackType_t *stack_buffer,
+                                           StaticTask_t *tcb, BaseType_t core);
+void vTaskDelete(TaskHandle_t handle);
+void vTaskDelay(TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+// Nothing else runs to notify, so a wait returns at once without a value
+BaseType_t xTaskNotify(TaskHandle_t handle, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t wait);
+BaseType_t xTaskNotifyStateClear(TaskHandle_t handle);
+
+#endif /* BENCH_FREERTOS_TASK_H */
@@ -0,0 +1,12 @@
+#include "drivers/imu.h"
+#include "util/ahrs.h"
+
+// The quaternion half of drivers/imu.c, which otherwise talks to the MPU6050
+esp_err_t imu_get_euler(const imu_data_t* data, float euler[3]) {
+    if (data == NULL || euler == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ahrs_quaternion_to_euler(data->quaternion, euler);
+    return ESP_OK;
+}
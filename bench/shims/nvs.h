@@ -0,0 +1,23 @@
+#ifndef BENCH_NVS_H
+#define BENCH_NVS_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// No NVS on the host: opening fails, so every image is read from slot 0
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE
+} nvs_open_mode_t;
+
+#define ESP_ERR_NVS_NOT_INITIALIZED 0x1101
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle);
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *value);
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value);
+esp_err_t nvs_commit(nvs_handle_t handle);
+void nvs_close(nvs_handle_t handle);
+
+#endif /* BENCH_NVS_H */
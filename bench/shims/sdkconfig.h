@@ -0,0 +1,17 @@
+#ifndef BENCH_SDKCONFIG_H
+#define BENCH_SDKCONFIG_H
+
+/**
+ * The menuconfig choices the processing modules read. Traces come from the
+ * full glove, so the bench builds with every sensor and feature group,
+ * as a single glove.
+ */
+#define CONFIG_GLOVE_SENSOR_TOUCH           1
+#define CONFIG_GLOVE_SENSOR_CAMERA          1
+#define CONFIG_GLOVE_FEATURE_TOUCH          1
+#define CONFIG_GLOVE_FEATURE_TEMPORAL       1
+#define CONFIG_GLOVE_FEATURE_AHRS           1
+#define CONFIG_GLOVE_FEATURE_WINDOW_STATS   1
+#define CONFIG_GLOVE_HAND_SINGLE            1
+
+#endif /* BENCH_SDKCONFIG_H */
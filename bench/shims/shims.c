@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "esp_partition.h"
+#include "dsps_dotprod.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+esp_log_level_t bench_log_level = ESP_LOG_WARN;
+
+static int64_t bench_time_us = 0;
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:                  return "ESP_OK";
+        case ESP_FAIL:                return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:          return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:     return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:   return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:    return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:       return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:   return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:         return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_CRC:     return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+        default:                      return "ESP_ERR_UNKNOWN";
+    }
+}
+
+void bench_log(esp_log_level_t level, const char *tag, const char *format, ...) {
+    static const char letters[] = "NEWIDV";
+    if (level > bench_log_level) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%c (%s) ", letters[level], tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
+
+int64_t esp_timer_get_time(void) {
+    return bench_time_us;
+}
+
+void bench_set_time_us(int64_t time_us) {
+    bench_time_us = time_us;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    return calloc(n, size);
+}
+
+void *heap_caps_aligned_calloc(size_t alignment, size_t n, size_t size, uint32_t caps) {
+    size_t bytes = (n * size + alignment - 1) & ~(alignment - 1);
+    void *ptr = aligned_alloc(alignment, bytes);
+    if (ptr != NULL) {
+        memset(ptr, 0, bytes);
+    }
+    return ptr;
+}
+
+void heap_caps_free(void *ptr) {
+    free(ptr);
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+esp_err_t dsps_dotprod_f32(const float *src1, const float *src2, float *dest, int len) {
+    float acc = 0.0f;
+    for (int i = 0; i < len; i++) {
+        acc += src1[i] * src2[i];
+    }
+    *dest = acc;
+    return ESP_OK;
+}
+
+// Data partitions from partitions.csv that the pipeline reads
+typedef struct {
+    esp_partition_t partition;
+    uint8_t *data;
+} bench_partition_t;
+
+static bench_partition_t partitions[] = {
+    { .partition = { ESP_PARTITION_TYPE_DATA, 0x40, 0x100000, "templates" } },
+    { .partition = { ESP_PARTITION_TYPE_DATA, 0x42, 0x80000, "dictionary" } },
+};
+
+static bench_partition_t *find_partition(const char *label) {
+    for (size_t i = 0; i < sizeof(partitions) / sizeof(partitions[0]); i++) {
+        if (label != NULL && strcmp(partitions[i].partition.label, label) == 0) {
+            bench_partition_t *p = &partitions[i];
+            if (p->data == NULL) {
+                p->data = aligned_alloc(64, p->partition.size);
+                memset(p->data, 0xFF, p->partition.size);
+            }
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static bench_partition_t *owner_of(const esp_partition_t *partition) {
+    return (bench_partition_t *)partition;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+    bench_partition_t *p = find_partition(label);
+    return (p != NULL && p->partition.type == type && p->partition.subtype == subtype) ? &p->partition : NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst, size_t size) {
+    if (offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, owner_of(partition)->data + offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *src, size_t size) {
+    if (offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t *data = owner_of(partition)->data + offset;
+    for (size_t i = 0; i < size; i++) {
+        data[i] &= ((const uint8_t *)src)[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+    if (offset % 4096 != 0 || size % 4096 != 0 || offset + size > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(owner_of(partition)->data + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle) {
+    if (offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *out_ptr = owner_of(partition)->data + offset;
+    *out_handle = 0;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle) {
+}
+
+esp_err_t bench_partition_load(const char *label, const char *path) {
+    bench_partition_t *p = find_partition(label);
+    FILE *file = fopen(path, "rb");
+    if (p == NULL || file == NULL) {
+        if (file != NULL) {
+            fclose(file);
+        }
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    size_t bytes = fread(p->data, 1, p->partition.size, file);
+    fclose(file);
+    return (bytes > 0) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+    if (handle != NULL) {
+        *handle = (TaskHandle_t)fn;
+    }
+    return pdPASS;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                                           UBaseType_t priority, StackType_t *stack_buffer,
+                                           StaticTask_t *tcb, BaseType_t core) {
+    return (TaskHandle_t)fn;
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+}
+
+void vTaskDelay(TickType_t ticks) {
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return NULL;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t handle, uint32_t value, eNotifyAction action) {
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t wait) {
+    return pdFALSE;
+}
+
+BaseType_t xTaskNotifyStateClear(TaskHandle_t handle) {
+    return pdFALSE;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle) {
+    return ESP_ERR_NVS_NOT_INITIALIZED;
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *value) {
+    return ESP_ERR_NVS_NOT_INITIALIZED;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value) {
+    return ESP_ERR_NVS_NOT_INITIALIZED;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return ESP_ERR_NVS_NOT_INITIALIZED;
+}
+
+void nvs_close(nvs_handle_t handle) {
+}
+
+struct bench_queue {
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t items[];
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    QueueHandle_t queue = calloc(1, sizeof(struct bench_queue) + (size_t)length * item_size);
+    if (queue != NULL) {
+        queue->length = length;
+        queue->item_size = item_size;
+    }
+    return queue;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size,
+                                 uint8_t *storage, StaticQueue_t *queue) {
+    return xQueueCreate(length, item_size);
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    free(queue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait) {
+    if (queue->count == queue->length) {
+        return pdFALSE;
+    }
+    UBaseType_t slot = (queue->head + queue->count) % queue->length;
+    memcpy(queue->items + (size_t)slot * queue->item_size, item, queue->item_size);
+    queue->count++;
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t wait) {
+    if (queue->count == queue->length) {
+        return pdFALSE;
+    }
+    queue->head = (queue->head + queue->length - 1) % queue->length;
+    memcpy(queue->items + (size_t)queue->head * queue->item_size, item, queue->item_size);
+    queue->count++;
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait) {
+    if (queue->count == 0) {
+        return pdFALSE;
+    }
+    memcpy(item, queue->items + (size_t)queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    return queue->length - queue->count;
+}
@@ -0,0 +1,190 @@
+/**
+ * Host round trip of the raw sensor stream codec
+ *
+ * Packs pseudo-random frames with core/stream_codec, including full-scale
+ * steps and sequence and timestamp wraparound, at a range of MTUs, then
+ * decodes every packet by the layout documented in core/sensor_stream.h
+ * and compares each field with the frame that went in.
+ *
+ * Usage: stream_codec_test
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "core/stream_codec.h"
+#include "core/sensor_stream.h"
+
+#define FRAME_COUNT     4096
+#define MAX_PACKET      512
+
+static trace_record_t frames[FRAME_COUNT];
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static bool get_varint(const uint8_t **p, const uint8_t *end, uint32_t *value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*p >= end) {
+            return false;
+        }
+        uint8_t byte = *(*p)++;
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool get_zigzag(const uint8_t **p, const uint8_t *end, int32_t *value) {
+    uint32_t raw;
+    if (!get_varint(p, end, &raw)) {
+        return false;
+    }
+    *value = (int32_t)(raw >> 1) ^ -(int32_t)(raw & 1);
+    return true;
+}
+
+// Decodes one packet into out; returns the frame count or -1 if malformed
+static int decode_packet(const uint8_t *packet, size_t len, trace_record_t *out, int max) {
+    const uint8_t *p = packet;
+    const uint8_t *end = packet + len;
+    trace_record_t previous;
+    int n = 0;
+
+    if (len < 1 || *p++ != SENSOR_STREAM_PACKET_FRAMES) {
+        return -1;
+    }
+    memset(&previous, 0, sizeof(previous));
+    while (p < end) {
+        trace_record_t frame;
+        uint32_t delta;
+        int32_t diff;
+
+        if (n >= max) {
+            return -1;
+        }
+        memset(&frame, 0, sizeof(frame));
+        if (!get_varint(&p, end, &delta)) return -1;
+        frame.sequence = previous.sequence + delta;
+        if (!get_varint(&p, end, &delta)) return -1;
+        frame.timestamp_ms = previous.timestamp_ms + delta;
+        for (int i = 0; i < 10; i++) {
+            if (!get_zigzag(&p, end, &diff)) return -1;
+            frame.flex_raw[i] = (uint16_t)(previous.flex_raw[i] + diff);
+        }
+        for (int i = 0; i < 3; i++) {
+            if (!get_zigzag(&p, end, &diff)) return -1;
+            frame.accel[i] = (int16_t)(previous.accel[i] + diff);
+        }
+        for (int i = 0; i < 3; i++) {
+            if (!get_zigzag(&p, end, &diff)) return -1;
+            frame.gyro[i] = (int16_t)(previous.gyro[i] + diff);
+        }
+        if (p >= end) return -1;
+        uint8_t flags = *p++;
+        frame.touch_mask = flags & 0x1F;
+        frame.valid_mask = ((flags & SENSOR_STREAM_FLAG_FLEX_VALID) ? TRACE_RECORD_FLEX_VALID : 0) |
+                           ((flags & SENSOR_STREAM_FLAG_IMU_VALID) ? TRACE_RECORD_IMU_VALID : 0) |
+                           ((flags & SENSOR_STREAM_FLAG_TOUCH_VALID) ? TRACE_RECORD_TOUCH_VALID : 0);
+        out[n++] = frame;
+        previous = frame;
+    }
+    return n;
+}
+
+static bool same_frame(const trace_record_t *a, const trace_record_t *b) {
+    const uint8_t valid = TRACE_RECORD_FLEX_VALID | TRACE_RECORD_IMU_VALID | TRACE_RECORD_TOUCH_VALID;
+
+    return a->sequence == b->sequence &&
+           a->timestamp_ms == b->timestamp_ms &&
+           memcmp(a->flex_raw, b->flex_raw, sizeof(a->flex_raw)) == 0 &&
+           memcmp(a->accel, b->accel, sizeof(a->accel)) == 0 &&
+           memcmp(a->gyro, b->gyro, sizeof(a->gyro)) == 0 &&
+           (a->touch_mask & 0x1F) == b->touch_mask &&
+           (a->valid_mask & valid) == b->valid_mask;
+}
+
+static void make_frames(void) {
+    uint32_t sequence = UINT32_MAX - FRAME_COUNT / 2;  // Wraps halfway
+    uint32_t timestamp = UINT32_MAX - 1000;
+
+    for (int n = 0; n < FRAME_COUNT; n++) {
+        trace_record_t *frame = &frames[n];
+        bool extreme = (n % 7) == 3;
+
+        memset(frame, 0, sizeof(*frame));
+        sequence += 1 + ((n % 50) == 0 ? next_random() % 1000 : 0);
+        timestamp += (n % 300) == 0 ? next_random() : 10;
+        frame->sequence = sequence;
+        frame->timestamp_ms = timestamp;
+        for (int i = 0; i < 10; i++) {
+            frame->flex_raw[i] = extreme ? ((n + i) & 1 ? UINT16_MAX : 0) : (uint16_t)(next_random() % 4096);
+        }
+        for (int i = 0; i < 3; i++) {
+            frame->accel[i] = extreme ? ((n + i) & 1 ? INT16_MAX : INT16_MIN) : (int16_t)next_random();
+            frame->gyro[i] = extreme ? ((n + i) & 1 ? INT16_MIN : INT16_MAX) : (int16_t)(next_random() % 200 - 100);
+        }
+        frame->touch_mask = (uint8_t)next_random();
+        frame->valid_mask = (uint8_t)next_random();
+    }
+}
+
+// Streams all frames at one packet size; returns the number of failures
+static int round_trip(size_t packet_size) {
+    static uint8_t packet[MAX_PACKET];
+    static trace_record_t decoded[MAX_PACKET];
+    uint32_t next = 0;
+    uint32_t packets = 0;
+
+    while (next < FRAME_COUNT) {
+        uint32_t encoded = 0;
+        size_t len = stream_codec_encode_packet(&frames[next], FRAME_COUNT - next,
+                                                packet, packet_size, &encoded);
+        if (len > packet_size || encoded == 0) {
+            printf("FAIL size %zu: packet %u holds %u frames in %zu bytes\n",
+                   packet_size, (unsigned)packets, (unsigned)encoded, len);
+            return 1;
+        }
+
+        int count = decode_packet(packet, len, decoded, MAX_PACKET);
+        if (count != (int)encoded) {
+            printf("FAIL size %zu: packet %u decodes to %d frames, %u packed\n",
+                   packet_size, (unsigned)packets, count, (unsigned)encoded);
+            return 1;
+        }
+        for (int i = 0; i < count; i++) {
+            if (!same_frame(&frames[next + i], &decoded[i])) {
+                printf("FAIL size %zu: frame %u differs after the round trip\n",
+                       packet_size, (unsigned)(next + i));
+                return 1;
+            }
+        }
+        next += encoded;
+        packets++;
+    }
+
+    printf("size %3zu: %u frames in %u packets\n", packet_size, (unsigned)FRAME_COUNT, (unsigned)packets);
+    return 0;
+}
+
+int main(void) {
+    static const size_t sizes[] = { 1 + STREAM_CODEC_MAX_FRAME_BYTES, 100, 244, MAX_PACKET };
+    int failures = 0;
+
+    make_frames();
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        failures += round_trip(sizes[i]);
+    }
+
+    printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,131 @@
+#include "image_slots.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+
+static const char *TAG = "IMAGE_SLOTS";
+
+static inline uint32_t align_up(uint32_t value, uint32_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+uint32_t image_slots_size(const esp_partition_t *partition) {
+    return (partition->size / IMAGE_SLOT_COUNT) & ~(IMAGE_SLOTS_SECTOR_SIZE - 1);
+}
+
+uint32_t image_slots_offset(const esp_partition_t *partition, uint8_t slot) {
+    return (slot < IMAGE_SLOT_COUNT) ? slot * image_slots_size(partition) : 0;
+}
+
+uint8_t image_slots_active(const esp_partition_t *partition) {
+    nvs_handle_t nvs_handle;
+    if (nvs_open(IMAGE_SLOTS_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) != ESP_OK) {
+        return 0;
+    }
+
+    uint8_t slot = 0;
+    if (nvs_get_u8(nvs_handle, partition->label, &slot) != ESP_OK || slot >= IMAGE_SLOT_COUNT) {
+        slot = 0;
+    }
+
+    nvs_close(nvs_handle);
+    return slot;
+}
+
+esp_err_t image_slots_activate(const esp_partition_t *partition, uint8_t slot) {
+    if (partition == NULL || slot >= IMAGE_SLOT_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t nvs_handle;
+    esp_err_t ret = nvs_open(IMAGE_SLOTS_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = nvs_set_u8(nvs_handle, partition->label, slot);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to activate slot %u of '%s': %s", slot, partition->label, esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Slot %u of '%s' active", slot, partition->label);
+    }
+    return ret;
+}
+
+esp_err_t image_slot_writer_begin(image_slot_writer_t *writer, const esp_partition_t *partition,
+                                  uint8_t slot, uint32_t size) {
+    if (writer == NULL || partition == NULL || slot >= IMAGE_SLOT_COUNT || size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (size > image_slots_size(partition)) {
+        ESP_LOGE(TAG, "Image (%lu bytes) does not fit a slot of '%s'", (unsigned long)size, partition->label);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    writer->partition = partition;
+    writer->base = image_slots_offset(partition, slot);
+    writer->size = size;
+    writer->written = 0;
+    writer->erased = 0;
+    writer->crc32 = 0;
+    return ESP_OK;
+}
+
+esp_err_t image_slot_writer_write(image_slot_writer_t *writer, const void *data, size_t length) {
+    if (writer == NULL || writer->partition == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (length > writer->size - writer->written) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Erase only the sectors this write reaches into
+    uint32_t end = writer->written + length;
+    if (end > writer->erased) {
+        uint32_t erase_end = align_up(end, IMAGE_SLOTS_SECTOR_SIZE);
+        esp_err_t ret = esp_partition_erase_range(writer->partition, writer->base + writer->erased,
+                                                  erase_end - writer->erased);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to erase '%s': %s", writer->partition->label, esp_err_to_name(ret));
+            return ret;
+        }
+        writer->erased = erase_end;
+    }
+
+    esp_err_t ret = esp_partition_write(writer->partition, writer->base + writer->written, data, length);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write '%s': %s", writer->partition->label, esp_err_to_name(ret));
+        return ret;
+    }
+
+    writer->crc32 = esp_rom_crc32_le(writer->crc32, data, length);
+    writer->written = end;
+    return ESP_OK;
+}
+
+esp_err_t image_slot_writer_finish(const image_slot_writer_t *writer, uint32_t crc32) {
+    if (writer == NULL || writer->partition == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (writer->written != writer->size) {
+        ESP_LOGE(TAG, "Image for '%s' incomplete (%lu of %lu bytes)", writer->partition->label,
+                 (unsigned long)writer->written, (unsigned long)writer->size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (writer->crc32 != crc32) {
+        ESP_LOGE(TAG, "Image for '%s' checksum mismatch", writer->partition->label);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    return ESP_OK;
+}
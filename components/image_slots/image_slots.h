@@ -0,0 +1,117 @@
+#ifndef IMAGE_SLOTS_H
+#define IMAGE_SLOTS_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_partition.h"
+
+/**
+ * @brief A/B slots in the data partitions holding memory-mapped images
+ *
+ * A partition holding a template or model image is split into two equal
+ * slots. One is active and mapped; an update is streamed into the other
+ * and then activated with a single NVS write, so a power cut at any point
+ * leaves either the old or the new image active, never a partial one.
+ * Slot 0 starts at the partition start, so an image flashed as a whole
+ * partition is found in slot 0.
+ *
+ * The active slot of each partition is kept under its label in the
+ * IMAGE_SLOTS_NVS_NAMESPACE namespace; without an entry (or without NVS)
+ * slot 0 is active.
+ */
+
+#define IMAGE_SLOT_COUNT            2
+#define IMAGE_SLOTS_NVS_NAMESPACE   "image_slots"
+#define IMAGE_SLOTS_SECTOR_SIZE     4096
+
+/**
+ * @brief Size of each slot of a partition
+ *
+ * @param partition Partition
+ * @return Slot size in bytes, a whole number of flash sectors
+ */
+uint32_t image_slots_size(const esp_partition_t *partition);
+
+/**
+ * @brief Offset of a slot from the start of its partition
+ *
+ * @param partition Partition
+ * @param slot Slot (0 or 1)
+ * @return Offset in bytes
+ */
+uint32_t image_slots_offset(const esp_partition_t *partition, uint8_t slot);
+
+/**
+ * @brief Get the active slot of a partition
+ *
+ * @param partition Partition
+ * @return Active slot, 0 if none was ever activated
+ */
+uint8_t image_slots_active(const esp_partition_t *partition);
+
+/**
+ * @brief Make a slot the active one
+ *
+ * Atomic: one NVS entry is replaced and committed. The image in the slot
+ * is not checked; its owner validates it when mapping.
+ *
+ * @param partition Partition
+ * @param slot Slot to activate
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t image_slots_activate(const esp_partition_t *partition, uint8_t slot);
+
+/**
+ * @brief Sequential writer of one image into a slot
+ *
+ * Sectors are erased just ahead of the data instead of all at once, so
+ * the flash (and with it the cache) is never held for more than one sector
+ * erase at a time, and the CRC is computed as the data goes by. Nothing
+ * but the writer's own fields is buffered.
+ */
+typedef struct {
+    const esp_partition_t *partition;
+    uint32_t base;               // Slot offset in the partition
+    uint32_t size;               // Image size given to begin
+    uint32_t written;            // Bytes written so far
+    uint32_t erased;             // Bytes of the slot erased so far
+    uint32_t crc32;              // CRC32 (little-endian) of the bytes written so far
+} image_slot_writer_t;
+
+/**
+ * @brief Start writing an image into a slot
+ *
+ * The slot must not be the one mapped.
+ *
+ * @param writer Writer to set up
+ * @param partition Partition
+ * @param slot Slot to write
+ * @param size Image size in bytes
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if the image does not fit the slot
+ */
+esp_err_t image_slot_writer_begin(image_slot_writer_t *writer, const esp_partition_t *partition,
+                                  uint8_t slot, uint32_t size);
+
+/**
+ * @brief Append bytes to the image
+ *
+ * @param writer Writer
+ * @param data Bytes to append
+ * @param length Number of bytes
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE past the announced size,
+ *         flash error code otherwise
+ */
+esp_err_t image_slot_writer_write(image_slot_writer_t *writer, const void *data, size_t length);
+
+/**
+ * @brief Check that the whole image arrived intact
+ *
+ * @param writer Writer
+ * @param crc32 Expected CRC32 of the whole image
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if bytes are missing,
+ *         ESP_ERR_INVALID_CRC on a checksum mismatch
+ */
+esp_err_t image_slot_writer_finish(const image_slot_writer_t *writer, uint32_t crc32);
+
+#endif /* IMAGE_SLOTS_H */
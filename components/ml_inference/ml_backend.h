@@ -0,0 +1,99 @@
+#ifndef ML_BACKEND_H
+#define ML_BACKEND_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+#include "ml_inference.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Interpreter backend behind ml_inference (TensorFlow Lite Micro)
+ *
+ * Every loaded model gets its own interpreter, but all of them allocate
+ * from one statically sized tensor arena: persistent buffers are stacked
+ * per model while the scratch area is shared, so only one model may run
+ * at a time (ml_inference serializes calls with its mutex).
+ */
+
+/**
+ * @brief Load a model into a slot and (re)plan the shared arena
+ *
+ * Every loaded model is planned again; one that no longer fits is dropped
+ * from its slot (see ml_backend_is_loaded()) without failing this load.
+ *
+ * @param model_type Slot to load
+ * @param model_data Flatbuffer, must stay valid while the model is loaded
+ * @param model_size Flatbuffer size in bytes
+ * @return ESP_OK on success, error code for this slot otherwise
+ */
+esp_err_t ml_backend_load(ml_model_type_t model_type, const void *model_data, size_t model_size);
+
+/**
+ * @brief Unload the model in a slot
+ *
+ * @param model_type Slot to unload
+ */
+void ml_backend_unload(ml_model_type_t model_type);
+
+/**
+ * @brief Check whether a slot holds a planned, runnable model
+ *
+ * @param model_type Slot to check
+ * @return true if the slot can be invoked
+ */
+bool ml_backend_is_loaded(ml_model_type_t model_type);
+
+/**
+ * @brief Quantize features into the input tensor, run the model and pick the top class
+ *
+ * @param model_type Slot to run
+ * @param features Input features, quantized directly into the int8 input tensor
+ * @param feature_count Number of input features
+ * @param class_id Pointer to store the highest scoring class
+ * @param score Pointer to store its dequantized score (0-1 for a softmax output)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t ml_backend_invoke(ml_model_type_t model_type, const float *features, uint16_t feature_count,
+                            uint16_t *class_id, float *score);
+
+/**
+ * @brief Requantize Q15 features into the input tensor, run the model and pick the top class
+ *
+ * @param model_type Slot to run
+ * @param features Normalized features in Q15
+ * @param feature_count Number of input features
+ * @param full_scale Normalized value represented by Q15 full scale
+ * @param class_id Pointer to store the highest scoring class
+ * @param score Pointer to store its dequantized score (0-1 for a softmax output)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t ml_backend_invoke_q15(ml_model_type_t model_type, const int16_t *features, uint16_t feature_count,
+                                float full_scale, uint16_t *class_id, float *score);
+
+/**
+ * @brief Run a loaded model once on a neutral input
+ *
+ * Pulls the model's weights and the kernels' one-time setup through the
+ * cache before the first real frame.
+ *
+ * @param model_type Slot to run
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t ml_backend_warm_up(ml_model_type_t model_type);
+
+/**
+ * @brief Get the number of arena bytes in use by all loaded models
+ *
+ * @return Bytes used, 0 if no model is loaded
+ */
+size_t ml_backend_arena_used(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ML_BACKEND_H */
@@ -0,0 +1,266 @@
+#include "ml_backend.h"
+#include <math.h>
+#include <string.h>
+#include <new>
+#include "esp_log.h"
+#include "tensorflow/lite/micro/micro_allocator.h"
+#include "tensorflow/lite/micro/micro_interpreter.h"
+#include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+static const char *TAG = "ML_BACKEND";
+
+// Operators used by the gesture models. With esp-tflite-micro these resolve
+// to the ESP-NN optimized int8 kernels on the S3.
+#define ML_BACKEND_MAX_OPS  (10)
+
+// Shared tensor arena, sized at build time
+alignas(16) static uint8_t tensor_arena[ML_TENSOR_ARENA_SIZE];
+
+// Per-slot model and interpreter (constructed in place, no heap)
+typedef struct {
+    const tflite::Model *model;
+    float input_inv_scale;       // 1 / input scale, so quantizing is a multiply
+    int32_t input_zero_point;
+    float q15_full_scale;        // Full scale the Q15 multiplier was derived for
+    int32_t q15_multiplier;      // Q15 feature to input tensor units, Q16
+    bool ready;
+    alignas(tflite::MicroInterpreter) uint8_t storage[sizeof(tflite::MicroInterpreter)];
+} model_slot_t;
+
+static model_slot_t slots[ML_MODEL_COUNT];
+static tflite::MicroAllocator *allocator = nullptr;
+static tflite::MicroMutableOpResolver<ML_BACKEND_MAX_OPS> op_resolver;
+static bool op_resolver_ready = false;
+
+static inline tflite::MicroInterpreter *slot_interpreter(model_slot_t *slot) {
+    return reinterpret_cast<tflite::MicroInterpreter *>(slot->storage);
+}
+
+static void register_ops(void) {
+    if (op_resolver_ready) {
+        return;
+    }
+
+    op_resolver.AddFullyConnected();
+    op_resolver.AddConv2D();
+    op_resolver.AddDepthwiseConv2D();
+    op_resolver.AddAveragePool2D();
+    op_resolver.AddMaxPool2D();
+    op_resolver.AddReshape();
+    op_resolver.AddSoftmax();
+    op_resolver.AddQuantize();
+    op_resolver.AddDequantize();
+    op_resolver.AddLogistic();
+    op_resolver_ready = true;
+}
+
+static void destroy_interpreters(void) {
+    for (int i = 0; i < ML_MODEL_COUNT; i++) {
+        if (slots[i].ready) {
+            slot_interpreter(&slots[i])->~MicroInterpreter();
+            slots[i].ready = false;
+        }
+    }
+    allocator = nullptr;
+}
+
+// Plan every loaded model into the arena again. Persistent allocations
+// cannot be freed one model at a time, so any load or unload starts over.
+// A model that no longer plans is dropped from its slot; the result is
+// that of the requested slot (ML_MODEL_COUNT for none).
+static esp_err_t rebuild_interpreters(ml_model_type_t requested) {
+    destroy_interpreters();
+
+    allocator = tflite::MicroAllocator::Create(tensor_arena, sizeof(tensor_arena));
+    if (allocator == nullptr) {
+        ESP_LOGE(TAG, "Failed to create arena allocator");
+        for (int i = 0; i < ML_MODEL_COUNT; i++) {
+            slots[i].model = nullptr;
+        }
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = ESP_OK;
+
+    for (int i = 0; i < ML_MODEL_COUNT; i++) {
+        model_slot_t *slot = &slots[i];
+        if (slot->model == nullptr) {
+            continue;
+        }
+
+        tflite::MicroInterpreter *interpreter =
+            new (slot->storage) tflite::MicroInterpreter(slot->model, op_resolver, allocator);
+
+        if (interpreter->AllocateTensors() != kTfLiteOk) {
+            ESP_LOGE(TAG, "Model %d does not fit the %u byte arena", i, (unsigned)sizeof(tensor_arena));
+            interpreter->~MicroInterpreter();
+            slot->model = nullptr;
+            if (i == (int)requested) {
+                ret = ESP_ERR_NO_MEM;
+            }
+            continue;
+        }
+
+        TfLiteTensor *input = interpreter->input(0);
+        TfLiteTensor *output = interpreter->output(0);
+        if (input->type != kTfLiteInt8 || output->type != kTfLiteInt8 || input->params.scale <= 0.0f) {
+            ESP_LOGE(TAG, "Model %d is not int8 quantized", i);
+            interpreter->~MicroInterpreter();
+            slot->model = nullptr;
+            if (i == (int)requested) {
+                ret = ESP_ERR_NOT_SUPPORTED;
+            }
+            continue;
+        }
+
+        slot->input_inv_scale = 1.0f / input->params.scale;
+        slot->input_zero_point = input->params.zero_point;
+        slot->q15_full_scale = 0.0f;
+        slot->ready = true;
+    }
+
+    ESP_LOGI(TAG, "Tensor arena: %u of %u bytes used",
+             (unsigned)ml_backend_arena_used(), (unsigned)sizeof(tensor_arena));
+    return ret;
+}
+
+extern "C" esp_err_t ml_backend_load(ml_model_type_t model_type, const void *model_data, size_t model_size) {
+    if (model_type >= ML_MODEL_COUNT || model_data == nullptr || model_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const tflite::Model *model = tflite::GetModel(model_data);
+    if (model->version() != TFLITE_SCHEMA_VERSION) {
+        ESP_LOGE(TAG, "Model schema %lu, expected %d", (unsigned long)model->version(), TFLITE_SCHEMA_VERSION);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    register_ops();
+    slots[model_type].model = model;
+
+    return rebuild_interpreters(model_type);
+}
+
+extern "C" void ml_backend_unload(ml_model_type_t model_type) {
+    if (model_type >= ML_MODEL_COUNT || slots[model_type].model == nullptr) {
+        return;
+    }
+
+    slots[model_type].model = nullptr;
+    rebuild_interpreters(ML_MODEL_COUNT);
+}
+
+extern "C" bool ml_backend_is_loaded(ml_model_type_t model_type) {
+    return model_type < ML_MODEL_COUNT && slots[model_type].ready;
+}
+
+static inline int8_t saturate_int8(int32_t q) {
+    return (int8_t)((q < -128) ? -128 : (q > 127) ? 127 : q);
+}
+
+// Run the slot's interpreter on the filled input tensor and pick the top class
+static esp_err_t invoke_and_pick(ml_model_type_t model_type, tflite::MicroInterpreter *interpreter,
+                                 uint16_t *class_id, float *score) {
+    if (interpreter->Invoke() != kTfLiteOk) {
+        ESP_LOGE(TAG, "Invoke failed for model %d", model_type);
+        return ESP_FAIL;
+    }
+
+    // Arg-max on the quantized scores; only the winner is dequantized
+    TfLiteTensor *output = interpreter->output(0);
+    const int8_t *scores = output->data.int8;
+    size_t best = 0;
+    for (size_t i = 1; i < output->bytes; i++) {
+        if (scores[i] > scores[best]) {
+            best = i;
+        }
+    }
+
+    *class_id = (uint16_t)best;
+    *score = (scores[best] - output->params.zero_point) * output->params.scale;
+
+    return ESP_OK;
+}
+
+extern "C" esp_err_t ml_backend_invoke(ml_model_type_t model_type, const float *features, uint16_t feature_count,
+                                       uint16_t *class_id, float *score) {
+    if (model_type >= ML_MODEL_COUNT || features == nullptr || class_id == nullptr || score == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    model_slot_t *slot = &slots[model_type];
+    if (!slot->ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    tflite::MicroInterpreter *interpreter = slot_interpreter(slot);
+    TfLiteTensor *input = interpreter->input(0);
+
+    // Quantize straight into the input tensor; inputs the frame lacks read as zero
+    int8_t *dst = input->data.int8;
+    size_t input_count = input->bytes;
+    size_t count = (feature_count < input_count) ? feature_count : input_count;
+
+    for (size_t i = 0; i < count; i++) {
+        dst[i] = saturate_int8((int32_t)lrintf(features[i] * slot->input_inv_scale) + slot->input_zero_point);
+    }
+    for (size_t i = count; i < input_count; i++) {
+        dst[i] = (int8_t)slot->input_zero_point;
+    }
+
+    return invoke_and_pick(model_type, interpreter, class_id, score);
+}
+
+extern "C" esp_err_t ml_backend_invoke_q15(ml_model_type_t model_type, const int16_t *features, uint16_t feature_count,
+                                           float full_scale, uint16_t *class_id, float *score) {
+    if (model_type >= ML_MODEL_COUNT || features == nullptr || class_id == nullptr || score == nullptr ||
+        full_scale <= 0.0f) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    model_slot_t *slot = &slots[model_type];
+    if (!slot->ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Input units per Q15 step, derived once per full scale
+    if (slot->q15_full_scale != full_scale) {
+        slot->q15_multiplier = (int32_t)lrintf(full_scale / 32768.0f * slot->input_inv_scale * 65536.0f);
+        slot->q15_full_scale = full_scale;
+    }
+
+    tflite::MicroInterpreter *interpreter = slot_interpreter(slot);
+    TfLiteTensor *input = interpreter->input(0);
+
+    int8_t *dst = input->data.int8;
+    size_t input_count = input->bytes;
+    size_t count = (feature_count < input_count) ? feature_count : input_count;
+
+    for (size_t i = 0; i < count; i++) {
+        int32_t q = (int32_t)(((int64_t)features[i] * slot->q15_multiplier + (1 << 15)) >> 16);
+        dst[i] = saturate_int8(q + slot->input_zero_point);
+    }
+    for (size_t i = count; i < input_count; i++) {
+        dst[i] = (int8_t)slot->input_zero_point;
+    }
+
+    return invoke_and_pick(model_type, interpreter, class_id, score);
+}
+
+extern "C" esp_err_t ml_backend_warm_up(ml_model_type_t model_type) {
+    if (model_type >= ML_MODEL_COUNT || !slots[model_type].ready) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Zero-point input is a real-valued zero vector
+    tflite::MicroInterpreter *interpreter = slot_interpreter(&slots[model_type]);
+    TfLiteTensor *input = interpreter->input(0);
+    memset(input->data.int8, (int8_t)slots[model_type].input_zero_point, input->bytes);
+
+    return (interpreter->Invoke() == kTfLiteOk) ? ESP_OK : ESP_FAIL;
+}
+
+extern "C" size_t ml_backend_arena_used(void) {
+    return (allocator != nullptr) ? allocator->used_bytes() : 0;
+}
@@ -1,18 +1,30 @@
 #include "ml_inference.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include "esp_log.h"
 #include "esp_system.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "esp_timer.h"
-#include "nvs_flash.h"
-#include "nvs.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "image_slots.h"
+#include "ml_backend.h"
+#include "ml_latency.h"
 
 static const char *TAG = "ML_INFERENCE";
 
-// NVS namespace for ML models
-#define ML_MODEL_NVS_NAMESPACE "ml_models"
+// Chunk used to copy model files into their partition
+#define ML_MODEL_COPY_CHUNK    (4096)
+
+// Partition holding each model slot
+static const char *model_partition_labels[ML_MODEL_COUNT] = {
+    ML_MODEL_STATIC_PARTITION,
+    ML_MODEL_DYNAMIC_PARTITION
+};
 
 // Inference state
 static bool ml_initialized = false;
@@ -29,6 +41,7 @@ typedef struct {
     float avg_inference_time_ms;
     uint32_t inference_count;
     float accuracy;
+    ml_latency_histogram_t latency;  // Recorded without the mutex
 } ml_stats_t;
 
 static ml_stats_t model_stats[ML_MODEL_COUNT] = {
@@ -36,20 +49,25 @@ static ml_stats_t model_stats[ML_MODEL_COUNT] = {
     { 0.0f, 0, 0.0f }   // Dynamic gestures
 };
 
+// Latency of the pipeline stages in front of the models
+static ml_latency_histogram_t stage_latency[ML_STAGE_COUNT];
+
 // Model status
 typedef struct {
     bool loaded;
     uint32_t model_size;
     uint32_t last_update_time;
+    uint32_t arena_bytes;      // Arena requirement from the image header
+    uint32_t flags;            // ML_MODEL_FLAG_* from the image header
+    const void *model_data;    // Flatbuffer in memory-mapped flash
+    bool mapped;
+    uint8_t slot;              // Image slot mapped
+    esp_partition_mmap_handle_t map_handle;
 } model_status_t;
 
-static model_status_t model_status[ML_MODEL_COUNT] = {
-    { false, 0, 0 },  // Static gestures
-    { false, 0, 0 }   // Dynamic gestures
-};
+static model_status_t model_status[ML_MODEL_COUNT] = {0};
 
-// In a real implementation, we would have TensorFlow Lite Micro model structures here
-// For this placeholder implementation, we'll simulate inference using basic logic
+static void unmap_model(ml_model_type_t model_type);
 
 esp_err_t ml_inference_init(void) {
     if (ml_initialized) {
@@ -63,7 +81,7 @@ esp_err_t ml_inference_init(void) {
         return ESP_ERR_NO_MEM;
     }
     
-    // Attempt to load models from NVS
+    // Map the models already in flash
     ml_inference_load_model(ML_MODEL_STATIC_GESTURES, NULL);
     ml_inference_load_model(ML_MODEL_DYNAMIC_GESTURES, NULL);
     
@@ -86,9 +104,7 @@ esp_err_t ml_inference_deinit(void) {
     
     // Free model resources if they were loaded
     for (int i = 0; i < ML_MODEL_COUNT; i++) {
-        // In a real implementation, we would free TensorFlow Lite model memory here
-        model_status[i].loaded = false;
-        model_status[i].model_size = 0;
+        unmap_model((ml_model_type_t)i);
     }
     
     // Release mutex and delete it
@@ -103,7 +119,18 @@ esp_err_t ml_inference_deinit(void) {
 }
 
 esp_err_t ml_inference_run(ml_model_type_t model_type, const ml_input_features_t* features, ml_result_t* result) {
-    if (!ml_initialized || features == NULL || result == NULL) {
+    if (features == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    return ml_inference_run_features(model_type, features->features, features->feature_count, result);
+}
+
+// Shared by the float and Q15 entry points; exactly one of features and
+// q15_features is set
+static esp_err_t run_model(ml_model_type_t model_type, const float* features, const int16_t* q15_features,
+                           float q15_full_scale, uint16_t feature_count, ml_result_t* result) {
+    if (!ml_initialized || (features == NULL && q15_features == NULL) || result == NULL) {
         return ESP_ERR_INVALID_STATE;
     }
     
@@ -117,7 +144,7 @@ esp_err_t ml_inference_run(ml_model_type_t model_type, const ml_input_features_t
         return ESP_ERR_INVALID_STATE;
     }
     
-    // Take mutex to ensure exclusive access
+    // Take mutex to ensure exclusive access (the models share one tensor arena)
     if (xSemaphoreTake(ml_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
         ESP_LOGW(TAG, "Failed to take ML mutex for inference");
         return ESP_ERR_TIMEOUT;
@@ -130,38 +157,32 @@ esp_err_t ml_inference_run(ml_model_type_t model_type, const ml_input_features_t
     // Start timing for performance measurement
     int64_t start_time = esp_timer_get_time();
     
-    // In a real implementation, we would run TensorFlow Lite inference here
-    // For this placeholder, we'll simulate inference with a basic algorithm
-    
-    // Placeholder: Just use the maximum feature value as a simple "recognition"
-    float max_val = 0.0f;
-    int max_idx = 0;
-    for (int i = 0; i < features->feature_count; i++) {
-        if (features->features[i] > max_val) {
-            max_val = features->features[i];
-            max_idx = i;
-        }
-    }
-    
-    // Calculate a simple confidence score (0-1)
-    float confidence = max_val / 100.0f;
-    if (confidence > 1.0f) confidence = 1.0f;
+    uint16_t class_id = 0;
+    float confidence = 0.0f;
+    esp_err_t ret = (q15_features != NULL)
+        ? ml_backend_invoke_q15(model_type, q15_features, feature_count, q15_full_scale, &class_id, &confidence)
+        : ml_backend_invoke(model_type, features, feature_count, &class_id, &confidence);
     
     // Calculate inference time
     int64_t end_time = esp_timer_get_time();
     float inference_time_ms = (end_time - start_time) / 1000.0f;
+    ml_latency_record(&model_stats[model_type].latency, (uint32_t)(end_time - start_time));
+    
+    if (ret != ESP_OK) {
+        xSemaphoreGive(ml_mutex);
+        return ret;
+    }
     
     // Check if confidence exceeds threshold
     if (confidence >= confidence_thresholds[model_type]) {
-        // Determine a gesture ID based on max feature index (just for simulation)
-        uint8_t gesture_id = (max_idx % 50);  // Limit to 50 gestures
+        uint8_t gesture_id = (uint8_t)class_id;
         
         // Set result values
         result->gesture_id = gesture_id;
         result->confidence = confidence;
         result->is_valid = true;
         
-        // Set gesture name based on ID (basic mapping for simulation)
+        // Set gesture name based on the class index
         if (model_type == ML_MODEL_STATIC_GESTURES) {
             // For static gestures, use letters of the alphabet
             if (gesture_id < 26) {
@@ -203,75 +224,320 @@ esp_err_t ml_inference_run(ml_model_type_t model_type, const ml_input_features_t
     return ESP_OK;
 }
 
-esp_err_t ml_inference_load_model(ml_model_type_t model_type, const char* path) {
-    if (!ml_initialized && model_type >= ML_MODEL_COUNT) {
+esp_err_t ml_inference_run_features(ml_model_type_t model_type, const float* features,
+                                    uint16_t feature_count, ml_result_t* result) {
+    if (features == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    return run_model(model_type, features, NULL, 0.0f, feature_count, result);
+}
+
+esp_err_t ml_inference_run_q15(ml_model_type_t model_type, const int16_t* features,
+                               uint16_t feature_count, float full_scale, ml_result_t* result) {
+    if (features == NULL || full_scale <= 0.0f) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    // Take mutex to ensure exclusive access
-    if (xSemaphoreTake(ml_mutex, portMAX_DELAY) != pdTRUE) {
-        ESP_LOGW(TAG, "Failed to take ML mutex for model loading");
-        return ESP_ERR_TIMEOUT;
+    return run_model(model_type, NULL, features, full_scale, feature_count, result);
+}
+
+static inline uint32_t align_up(uint32_t value, uint32_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+static const esp_partition_t* find_model_partition(ml_model_type_t model_type) {
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                                ML_MODEL_PARTITION_SUBTYPE,
+                                                                model_partition_labels[model_type]);
+    if (partition == NULL) {
+        ESP_LOGW(TAG, "Model partition '%s' not found", model_partition_labels[model_type]);
+    }
+    return partition;
+}
+
+static uint32_t header_crc(const ml_model_image_header_t *header) {
+    return esp_rom_crc32_le(0, (const uint8_t *)header, offsetof(ml_model_image_header_t, header_crc32));
+}
+
+// Replanning the arena can drop other models from the backend; unmap
+// those too, so no slot is left marked loaded over a dropped interpreter
+static void unmap_dropped_models(void) {
+    for (int i = 0; i < ML_MODEL_COUNT; i++) {
+        model_status_t *status = &model_status[i];
+        if (status->loaded && !ml_backend_is_loaded((ml_model_type_t)i)) {
+            ESP_LOGW(TAG, "Model type %d no longer fits the arena, unloaded", i);
+            status->loaded = false;
+            unmap_model((ml_model_type_t)i);
+        }
     }
+}
+
+static void unmap_model(ml_model_type_t model_type) {
+    model_status_t *status = &model_status[model_type];
     
-    esp_err_t ret = ESP_OK;
+    if (status->loaded) {
+        ml_backend_unload(model_type);
+        status->loaded = false;
+        unmap_dropped_models();
+    }
+    if (status->mapped) {
+        esp_partition_munmap(status->map_handle);
+    }
     
-    // Determine model key for NVS
-    char model_key[16];
-    snprintf(model_key, sizeof(model_key), "model_%d", model_type);
+    status->loaded = false;
+    status->mapped = false;
+    status->model_data = NULL;
+    status->model_size = 0;
+    status->arena_bytes = 0;
+    status->flags = 0;
+}
+
+// Check the image in one slot of a model partition and run it in place from mapped flash
+static esp_err_t map_slot(ml_model_type_t model_type, const esp_partition_t *partition, uint8_t slot) {
+    uint32_t base = image_slots_offset(partition, slot);
+    uint32_t slot_size = image_slots_size(partition);
+    
+    ml_model_image_header_t header;
+    esp_err_t ret = esp_partition_read(partition, base, &header, sizeof(header));
+    if (ret != ESP_OK) {
+        return ret;
+    }
     
-    if (path != NULL) {
-        // Load model from file (simulated for this placeholder)
-        ESP_LOGI(TAG, "Loading model type %d from path %s", model_type, path);
-        
-        // In a real implementation, we would load the TensorFlow Lite model from file
-        // For this placeholder, we'll just mark it as loaded
-        model_status[model_type].loaded = true;
-        model_status[model_type].model_size = 250000;  // Simulated size
-        model_status[model_type].last_update_time = esp_timer_get_time() / 1000;
-        
-        // Save model to NVS for future use
-        nvs_handle_t nvs_handle;
-        ret = nvs_open(ML_MODEL_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-        if (ret == ESP_OK) {
-            // In a real implementation, we would save the actual model to NVS
-            // For this placeholder, we just save a marker
-            ret = nvs_set_u32(nvs_handle, model_key, model_status[model_type].model_size);
-            if (ret != ESP_OK) {
-                ESP_LOGW(TAG, "Failed to save model to NVS: %s", esp_err_to_name(ret));
-            }
-            nvs_commit(nvs_handle);
-            nvs_close(nvs_handle);
-        }
+    if (header.magic != ML_MODEL_IMAGE_MAGIC) {
+        ESP_LOGW(TAG, "No model image in slot %u of '%s'", slot, partition->label);
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    // Version 1 headers end before flags, so their CRC sits where flags are now
+    bool header_ok;
+    if (header.version == 1 && header.header_size == ML_MODEL_IMAGE_V1_SIZE) {
+        header_ok = esp_rom_crc32_le(0, (const uint8_t *)&header,
+                                     offsetof(ml_model_image_header_t, flags)) == header.flags;
+        header.flags = 0;
     } else {
-        // Try to load from NVS
-        ESP_LOGI(TAG, "Attempting to load model type %d from NVS", model_type);
-        
-        nvs_handle_t nvs_handle;
-        ret = nvs_open(ML_MODEL_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
-        if (ret == ESP_OK) {
-            uint32_t model_size = 0;
-            ret = nvs_get_u32(nvs_handle, model_key, &model_size);
-            if (ret == ESP_OK) {
-                // In a real implementation, we would load the actual model from NVS
-                // For this placeholder, we just check if it exists
-                model_status[model_type].loaded = true;
-                model_status[model_type].model_size = model_size;
-                model_status[model_type].last_update_time = esp_timer_get_time() / 1000;
-                ESP_LOGI(TAG, "Loaded model type %d from NVS, size: %u bytes", model_type, model_size);
-            } else {
-                ESP_LOGW(TAG, "Model type %d not found in NVS", model_type);
-            }
-            nvs_close(nvs_handle);
-        } else {
-            ESP_LOGW(TAG, "Failed to open NVS for model loading: %s", esp_err_to_name(ret));
+        header_ok = header.version == ML_MODEL_IMAGE_VERSION && header.header_size == sizeof(header) &&
+                    header_crc(&header) == header.header_crc32;
+    }
+    if (!header_ok) {
+        ESP_LOGE(TAG, "Bad model image header in slot %u of '%s'", slot, partition->label);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    
+    if (header.model_offset < header.header_size || header.model_offset % ML_MODEL_IMAGE_ALIGN != 0 ||
+        header.model_size == 0 || header.model_offset + header.model_size > slot_size) {
+        ESP_LOGE(TAG, "Model image in slot %u of '%s' does not fit its slot", slot, partition->label);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    
+    // All models share one arena, so the declared needs must fit together
+    uint32_t arena_needed = header.arena_bytes;
+    for (int i = 0; i < ML_MODEL_COUNT; i++) {
+        if (i != (int)model_type && model_status[i].loaded) {
+            arena_needed += model_status[i].arena_bytes;
         }
     }
+    if (arena_needed > ML_TENSOR_ARENA_SIZE) {
+        ESP_LOGE(TAG, "Models need %lu arena bytes, only %d available",
+                 (unsigned long)arena_needed, ML_TENSOR_ARENA_SIZE);
+        return ESP_ERR_NO_MEM;
+    }
+    
+    const void *mapped = NULL;
+    esp_partition_mmap_handle_t map_handle;
+    ret = esp_partition_mmap(partition, base, header.model_offset + header.model_size,
+                             ESP_PARTITION_MMAP_DATA, &mapped, &map_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map '%s': %s", partition->label, esp_err_to_name(ret));
+        return ret;
+    }
+    
+    // The checksum pass reads the whole flatbuffer through the flash cache
+    const uint8_t *model_data = (const uint8_t *)mapped + header.model_offset;
+    if (esp_rom_crc32_le(0, model_data, header.model_size) != header.model_crc32) {
+        ESP_LOGE(TAG, "Model checksum mismatch in slot %u of '%s'", slot, partition->label);
+        esp_partition_munmap(map_handle);
+        return ESP_ERR_INVALID_CRC;
+    }
+    
+    model_status_t *status = &model_status[model_type];
+    status->mapped = true;
+    status->map_handle = map_handle;
+    status->slot = slot;
+    status->model_data = model_data;
+    status->model_size = header.model_size;
+    status->arena_bytes = header.arena_bytes;
+    status->flags = header.flags;
+    
+    ret = ml_backend_load(model_type, model_data, header.model_size);
+    unmap_dropped_models();
+    if (ret != ESP_OK) {
+        unmap_model(model_type);
+        return ret;
+    }
+    
+    status->loaded = true;
+    status->last_update_time = esp_timer_get_time() / 1000;
+    
+    // One throwaway run so the first real frame does not pay for cold
+    // cache lines and lazy kernel setup
+    ml_backend_warm_up(model_type);
+    
+    ESP_LOGI(TAG, "Model type %d v%lu mapped from slot %u of '%s' (%lu bytes, arena %lu used)",
+             model_type, (unsigned long)header.model_version, slot, partition->label,
+             (unsigned long)header.model_size, (unsigned long)ml_backend_arena_used());
+    return ESP_OK;
+}
+
+// Map the active slot, or the other one if the active one holds no usable
+// image; the slot that loads becomes the active one, so updates always go
+// to the slot that is not mapped
+static esp_err_t map_model(ml_model_type_t model_type) {
+    const esp_partition_t *partition = find_model_partition(model_type);
+    if (partition == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    uint8_t active = image_slots_active(partition);
+    esp_err_t ret = map_slot(model_type, partition, active);
+    if (ret == ESP_OK || ret == ESP_ERR_NO_MEM) {
+        return ret;
+    }
+    
+    uint8_t other = (active + 1) % IMAGE_SLOT_COUNT;
+    if (map_slot(model_type, partition, other) != ESP_OK) {
+        return ret;
+    }
+    
+    ESP_LOGW(TAG, "Slot %u of '%s' unusable, fell back to slot %u", active, partition->label, other);
+    image_slots_activate(partition, other);
+    return ESP_OK;
+}
+
+// Slot an update of a model is written to: the one not mapped
+static uint8_t update_slot(ml_model_type_t model_type, const esp_partition_t *partition) {
+    const model_status_t *status = &model_status[model_type];
+    uint8_t in_use = status->mapped ? status->slot : image_slots_active(partition);
+    return (in_use + 1) % IMAGE_SLOT_COUNT;
+}
+
+// Copy a model file into the idle slot of its partition. Model images are
+// copied as they are; a raw flatbuffer gets an image header in front of it.
+static esp_err_t write_model_file(ml_model_type_t model_type, const char* path, uint8_t *slot) {
+    const esp_partition_t *partition = find_model_partition(model_type);
+    if (partition == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        ESP_LOGW(TAG, "Model file %s not found", path);
+        return ESP_ERR_NOT_FOUND;
+    }
     
-    // Reset statistics for this model
+    uint8_t *chunk = malloc(ML_MODEL_COPY_CHUNK);
+    if (chunk == NULL) {
+        fclose(file);
+        return ESP_ERR_NO_MEM;
+    }
+    
+    // First pass: size, kind and checksum, so the slot can be written front to back
+    uint32_t magic = 0;
+    uint32_t size = 0;
+    uint32_t crc = 0;
+    size_t read;
+    while ((read = fread(chunk, 1, ML_MODEL_COPY_CHUNK, file)) > 0) {
+        if (size == 0 && read >= sizeof(magic)) {
+            memcpy(&magic, chunk, sizeof(magic));
+        }
+        crc = esp_rom_crc32_le(crc, chunk, read);
+        size += read;
+    }
+    
+    bool is_image = (magic == ML_MODEL_IMAGE_MAGIC);
+    uint32_t data_offset = is_image ? 0 : align_up(sizeof(ml_model_image_header_t), ML_MODEL_IMAGE_ALIGN);
+    uint32_t image_size = data_offset + size;
+    
+    *slot = update_slot(model_type, partition);
+    image_slot_writer_t writer;
+    esp_err_t ret = (size < sizeof(magic)) ? ESP_ERR_INVALID_SIZE :
+                    image_slot_writer_begin(&writer, partition, *slot, image_size);
+    
+    if (ret == ESP_OK && !is_image) {
+        ml_model_image_header_t header = {
+            .magic = ML_MODEL_IMAGE_MAGIC,
+            .version = ML_MODEL_IMAGE_VERSION,
+            .header_size = sizeof(ml_model_image_header_t),
+            .model_offset = data_offset,
+            .model_size = size,
+            .model_crc32 = crc,
+            .arena_bytes = 0,
+            .model_version = 0,
+            .flags = 0
+        };
+        header.header_crc32 = header_crc(&header);
+        
+        memset(chunk, 0, data_offset);
+        memcpy(chunk, &header, sizeof(header));
+        ret = image_slot_writer_write(&writer, chunk, data_offset);
+    }
+    
+    // Second pass: the file itself
+    fseek(file, 0, SEEK_SET);
+    while (ret == ESP_OK && (read = fread(chunk, 1, ML_MODEL_COPY_CHUNK, file)) > 0) {
+        ret = image_slot_writer_write(&writer, chunk, read);
+    }
+    
+    free(chunk);
+    fclose(file);
+    
+    if (ret == ESP_OK && writer.written != image_size) {
+        ret = ESP_FAIL;
+    }
+    
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write model to '%s': %s", partition->label, esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Wrote %s to slot %u of '%s' (%lu bytes)", path, *slot, partition->label,
+                 (unsigned long)image_size);
+    }
+    return ret;
+}
+
+// Reset statistics for a model that was just (re)mapped
+static void reset_stats(ml_model_type_t model_type) {
     model_stats[model_type].avg_inference_time_ms = 0.0f;
     model_stats[model_type].inference_count = 0;
     model_stats[model_type].accuracy = 0.0f;
+    ml_latency_reset(&model_stats[model_type].latency);
+}
+
+esp_err_t ml_inference_load_model(ml_model_type_t model_type, const char* path) {
+    if (ml_mutex == NULL || model_type >= ML_MODEL_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // A new model goes into the idle slot while the current one keeps running
+    if (path != NULL) {
+        ESP_LOGI(TAG, "Loading model type %d from path %s", model_type, path);
+        uint8_t slot = 0;
+        esp_err_t ret = write_model_file(model_type, path, &slot);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        return ml_inference_activate_slot(model_type, slot);
+    }
+    
+    // Take mutex to ensure exclusive access
+    if (xSemaphoreTake(ml_mutex, portMAX_DELAY) != pdTRUE) {
+        ESP_LOGW(TAG, "Failed to take ML mutex for model loading");
+        return ESP_ERR_TIMEOUT;
+    }
+    
+    // The model is about to be remapped
+    unmap_model(model_type);
+    esp_err_t ret = map_model(model_type);
+    reset_stats(model_type);
     
     // Release mutex
     xSemaphoreGive(ml_mutex);
@@ -279,6 +545,61 @@ esp_err_t ml_inference_load_model(ml_model_type_t model_type, const char* path)
     return ret;
 }
 
+esp_err_t ml_inference_get_update_slot(ml_model_type_t model_type, const esp_partition_t **partition,
+                                       uint8_t *slot) {
+    if (model_type >= ML_MODEL_COUNT || partition == NULL || slot == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    *partition = find_model_partition(model_type);
+    if (*partition == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    *slot = update_slot(model_type, *partition);
+    return ESP_OK;
+}
+
+esp_err_t ml_inference_activate_slot(ml_model_type_t model_type, uint8_t slot) {
+    if (model_type >= ML_MODEL_COUNT || slot >= IMAGE_SLOT_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    const esp_partition_t *partition = find_model_partition(model_type);
+    if (partition == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    // Not running yet: the slot is mapped at init
+    if (ml_mutex == NULL) {
+        return image_slots_activate(partition, slot);
+    }
+    
+    if (xSemaphoreTake(ml_mutex, portMAX_DELAY) != pdTRUE) {
+        ESP_LOGW(TAG, "Failed to take ML mutex for slot activation");
+        return ESP_ERR_TIMEOUT;
+    }
+    
+    // Swapped between two inferences; a slot that does not load is not kept
+    uint8_t previous = image_slots_active(partition);
+    unmap_model(model_type);
+    esp_err_t ret = map_slot(model_type, partition, slot);
+    if (ret == ESP_OK) {
+        ret = image_slots_activate(partition, slot);
+        if (ret != ESP_OK) {
+            unmap_model(model_type);
+        }
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Slot %u of '%s' not activated: %s", slot, partition->label, esp_err_to_name(ret));
+        map_slot(model_type, partition, previous);
+    }
+    reset_stats(model_type);
+    
+    xSemaphoreGive(ml_mutex);
+    return ret;
+}
+
 esp_err_t ml_inference_get_stats(ml_model_type_t model_type, float* inference_time_ms, float* accuracy) {
     if (model_type >= ML_MODEL_COUNT) {
         return ESP_ERR_INVALID_ARG;
@@ -295,6 +616,48 @@ esp_err_t ml_inference_get_stats(ml_model_type_t model_type, float* inference_ti
     return ESP_OK;
 }
 
+bool ml_inference_model_two_handed(ml_model_type_t model_type) {
+    if (model_type >= ML_MODEL_COUNT) {
+        return false;
+    }
+    
+    const model_status_t *status = &model_status[model_type];
+    return status->loaded && (status->flags & ML_MODEL_FLAG_TWO_HANDED) != 0;
+}
+
+esp_err_t ml_inference_get_latency(ml_model_type_t model_type, ml_latency_stats_t* stats) {
+    if (model_type >= ML_MODEL_COUNT || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    ml_latency_summarize(&model_stats[model_type].latency, stats);
+    return ESP_OK;
+}
+
+void ml_inference_record_stage(ml_stage_t stage, uint32_t elapsed_us) {
+    if (stage < ML_STAGE_COUNT) {
+        ml_latency_record(&stage_latency[stage], elapsed_us);
+    }
+}
+
+esp_err_t ml_inference_get_stage_latency(ml_stage_t stage, ml_latency_stats_t* stats) {
+    if (stage >= ML_STAGE_COUNT || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    ml_latency_summarize(&stage_latency[stage], stats);
+    return ESP_OK;
+}
+
+void ml_inference_reset_latency(void) {
+    for (int i = 0; i < ML_MODEL_COUNT; i++) {
+        ml_latency_reset(&model_stats[i].latency);
+    }
+    for (int i = 0; i < ML_STAGE_COUNT; i++) {
+        ml_latency_reset(&stage_latency[i]);
+    }
+}
+
 esp_err_t ml_inference_set_params(ml_model_type_t model_type, float confidence_threshold) {
     if (model_type >= ML_MODEL_COUNT) {
         return ESP_ERR_INVALID_ARG;
@@ -4,6 +4,54 @@
 #include "esp_err.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include "esp_partition.h"
+#include "ml_latency.h"
+
+/**
+ * @brief Tensor arena shared by all model slots, in bytes
+ *
+ * Must hold the persistent buffers of every loaded model plus the largest
+ * model's scratch area. The backend logs the bytes actually used at load.
+ */
+#ifndef ML_TENSOR_ARENA_SIZE
+#define ML_TENSOR_ARENA_SIZE   (96 * 1024)
+#endif
+
+// Flash partitions holding the model images (data partitions, subtype 0x41),
+// each split into two image slots (see image_slots.h). With the 512 KB
+// partitions in partitions.csv a model image, header included, is limited
+// to 256 KB.
+#define ML_MODEL_PARTITION_SUBTYPE      0x41
+#define ML_MODEL_STATIC_PARTITION       "model_static"
+#define ML_MODEL_DYNAMIC_PARTITION      "model_dynamic"
+
+// Model image format
+#define ML_MODEL_IMAGE_MAGIC            0x4C444D47  // "GMDL" little-endian
+#define ML_MODEL_IMAGE_VERSION          2
+#define ML_MODEL_IMAGE_V1_SIZE          32          // Version 1 header, without flags
+
+// Model image flags
+#define ML_MODEL_FLAG_TWO_HANDED        (1u << 0)   // Input holds both gloves of a pair
+#define ML_MODEL_IMAGE_ALIGN            16
+
+/**
+ * @brief Header at the start of a model image slot
+ *
+ * The TensorFlow Lite flatbuffer follows at model_offset, aligned to
+ * ML_MODEL_IMAGE_ALIGN, and is run in place from memory-mapped flash.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;              // ML_MODEL_IMAGE_MAGIC
+    uint16_t version;            // ML_MODEL_IMAGE_VERSION
+    uint16_t header_size;        // sizeof(ml_model_image_header_t)
+    uint32_t model_offset;       // Flatbuffer offset from the start of the slot
+    uint32_t model_size;         // Flatbuffer size in bytes
+    uint32_t model_crc32;        // CRC32 (little-endian) of the flatbuffer
+    uint32_t arena_bytes;        // Tensor arena the model needs, 0 if unknown
+    uint32_t model_version;      // Version of the trained model
+    uint32_t flags;              // ML_MODEL_FLAG_* (not in version 1 images, read as 0)
+    uint32_t header_crc32;       // CRC32 of the header bytes before this field
+} ml_model_image_header_t;
 
 /**
  * @brief ML model types for different gesture recognition approaches
@@ -14,6 +62,16 @@ typedef enum {
     ML_MODEL_COUNT                 // Number of model types
 } ml_model_type_t;
 
+/**
+ * @brief Pipeline stages whose latency is tracked next to the models'
+ */
+typedef enum {
+    ML_STAGE_FUSION = 0,           // Sensor alignment
+    ML_STAGE_FEATURES,             // History, gating and feature extraction
+    ML_STAGE_MATCHING,             // Template matching, DTW and decoding
+    ML_STAGE_COUNT                 // Number of stages
+} ml_stage_t;
+
 /**
  * @brief Input feature structure for ML inference
  */
@@ -56,15 +114,83 @@ esp_err_t ml_inference_deinit(void);
  */
 esp_err_t ml_inference_run(ml_model_type_t model_type, const ml_input_features_t* features, ml_result_t* result);
 
+/**
+ * @brief Run inference directly on a feature array
+ * 
+ * Same as ml_inference_run(), but the features are quantized straight from
+ * the caller's array (such as feature_vector_t.features) into the model's
+ * int8 input tensor, with no intermediate copy.
+ * 
+ * @param model_type Type of model to use for inference
+ * @param features Input features
+ * @param feature_count Number of input features
+ * @param result Pointer to store inference result
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t ml_inference_run_features(ml_model_type_t model_type, const float* features,
+                                    uint16_t feature_count, ml_result_t* result);
+
+/**
+ * @brief Run inference on normalized Q15 features
+ * 
+ * For models trained on normalized features. The Q15 values are mapped to
+ * the int8 input tensor with an integer multiply and shift, so the input
+ * path does no float work.
+ * 
+ * @param model_type Type of model to use for inference
+ * @param features Normalized features in Q15
+ * @param feature_count Number of input features
+ * @param full_scale Normalized value represented by Q15 full scale (32768)
+ * @param result Pointer to store inference result
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t ml_inference_run_q15(ml_model_type_t model_type, const int16_t* features,
+                               uint16_t feature_count, float full_scale, ml_result_t* result);
+
 /**
  * @brief Load a model from storage
  * 
+ * Models live in their own flash partition and run in place from
+ * memory-mapped flash. With path NULL the image in the active slot is
+ * checked and mapped, falling back to the other slot if it holds none.
+ * With a path, the file (a model image or a raw int8 TensorFlow Lite
+ * flatbuffer) is first written into the idle slot while the current model
+ * keeps running, then activated as by ml_inference_activate_slot().
+ * 
  * @param model_type Type of model to load
- * @param path Path to model file
+ * @param path Path to model file, or NULL
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t ml_inference_load_model(ml_model_type_t model_type, const char* path);
 
+/**
+ * @brief Get where an update of a model is to be written
+ * 
+ * The idle slot: the one not mapped, or not active while no model is
+ * mapped. Write it with an image_slot_writer_t, then activate it. Only
+ * one update per model may be in progress.
+ * 
+ * @param model_type Type of model
+ * @param partition Pointer to store the model's partition
+ * @param slot Pointer to store the idle slot
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND without the partition
+ */
+esp_err_t ml_inference_get_update_slot(ml_model_type_t model_type, const esp_partition_t **partition,
+                                       uint8_t *slot);
+
+/**
+ * @brief Switch a model to the image in a slot
+ * 
+ * The slot is mapped between two inferences and made active; if its image
+ * does not load, the previous slot stays active and mapped. Before
+ * ml_inference_init() the slot is only made active.
+ * 
+ * @param model_type Type of model
+ * @param slot Slot holding the new image
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t ml_inference_activate_slot(ml_model_type_t model_type, uint8_t slot);
+
 /**
  * @brief Get inference statistics
  * 
@@ -75,6 +201,53 @@ esp_err_t ml_inference_load_model(ml_model_type_t model_type, const char* path);
  */
 esp_err_t ml_inference_get_stats(ml_model_type_t model_type, float* inference_time_ms, float* accuracy);
 
+/**
+ * @brief Check whether a loaded model takes both gloves of a pair
+ * 
+ * A two-handed model expects the feature vector of a primary glove,
+ * second hand included; the others only the wearer's hand.
+ * 
+ * @param model_type Type of model
+ * @return true if the model is loaded and flagged ML_MODEL_FLAG_TWO_HANDED
+ */
+bool ml_inference_model_two_handed(ml_model_type_t model_type);
+
+/**
+ * @brief Get the latency distribution of a model's inferences
+ * 
+ * Lock-free; reflects every inference since the model was loaded or
+ * ml_inference_reset_latency() was called.
+ * 
+ * @param model_type Type of model
+ * @param stats Pointer to store the percentiles
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t ml_inference_get_latency(ml_model_type_t model_type, ml_latency_stats_t* stats);
+
+/**
+ * @brief Record the latency of one pass through a pipeline stage
+ * 
+ * Lock-free, safe from any task.
+ * 
+ * @param stage Pipeline stage
+ * @param elapsed_us Time spent, in microseconds
+ */
+void ml_inference_record_stage(ml_stage_t stage, uint32_t elapsed_us);
+
+/**
+ * @brief Get the latency distribution of a pipeline stage
+ * 
+ * @param stage Pipeline stage
+ * @param stats Pointer to store the percentiles
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t ml_inference_get_stage_latency(ml_stage_t stage, ml_latency_stats_t* stats);
+
+/**
+ * @brief Forget the latency samples of every model and stage
+ */
+void ml_inference_reset_latency(void);
+
 /**
  * @brief Set inference parameters
  * 
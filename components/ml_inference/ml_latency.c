@@ -0,0 +1,72 @@
+#include "ml_latency.h"
+
+static inline uint32_t bucket_of(uint32_t value) {
+    if (value < 2 * ML_LATENCY_SUB_BUCKETS) {
+        return value;
+    }
+
+    // Octave from the leading bit, then the next ML_LATENCY_SUB_BITS bits
+    uint32_t octave = 31 - __builtin_clz(value);
+    uint32_t sub = (value >> (octave - ML_LATENCY_SUB_BITS)) & (ML_LATENCY_SUB_BUCKETS - 1);
+    return 2 * ML_LATENCY_SUB_BUCKETS + (octave - ML_LATENCY_SUB_BITS - 1) * ML_LATENCY_SUB_BUCKETS + sub;
+}
+
+// Largest value that lands in a bucket
+static inline uint32_t bucket_upper(uint32_t bucket) {
+    if (bucket < 2 * ML_LATENCY_SUB_BUCKETS) {
+        return bucket;
+    }
+
+    uint32_t k = bucket - 2 * ML_LATENCY_SUB_BUCKETS;
+    uint32_t shift = k / ML_LATENCY_SUB_BUCKETS + 1;
+    uint64_t lower = (uint64_t)(ML_LATENCY_SUB_BUCKETS + k % ML_LATENCY_SUB_BUCKETS) << shift;
+    uint64_t upper = lower + ((uint64_t)1 << shift) - 1;
+    return (upper > UINT32_MAX) ? UINT32_MAX : (uint32_t)upper;
+}
+
+void ml_latency_record(ml_latency_histogram_t *histogram, uint32_t elapsed_us) {
+    atomic_fetch_add_explicit(&histogram->buckets[bucket_of(elapsed_us)], 1, memory_order_relaxed);
+
+    uint32_t max = atomic_load_explicit(&histogram->max_us, memory_order_relaxed);
+    while (elapsed_us > max &&
+           !atomic_compare_exchange_weak_explicit(&histogram->max_us, &max, elapsed_us,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+void ml_latency_summarize(const ml_latency_histogram_t *histogram, ml_latency_stats_t *stats) {
+    // One pass to snapshot the counts, so the percentiles agree with each other
+    static const uint32_t percent[3] = {50, 95, 99};
+    uint32_t *result[3] = {&stats->p50_us, &stats->p95_us, &stats->p99_us};
+    uint32_t counts[ML_LATENCY_BUCKETS];
+    uint32_t total = 0;
+
+    for (uint32_t b = 0; b < ML_LATENCY_BUCKETS; b++) {
+        counts[b] = atomic_load_explicit(&histogram->buckets[b], memory_order_relaxed);
+        total += counts[b];
+    }
+
+    stats->count = total;
+    stats->max_us = atomic_load_explicit(&histogram->max_us, memory_order_relaxed);
+
+    uint32_t seen = 0;
+    uint32_t next = 0;
+    for (uint32_t b = 0; b < ML_LATENCY_BUCKETS && next < 3; b++) {
+        seen += counts[b];
+        // Smallest bucket holding at least p% of the samples
+        while (next < 3 && total > 0 && (uint64_t)seen * 100 >= (uint64_t)total * percent[next]) {
+            uint32_t upper = bucket_upper(b);
+            *result[next++] = (upper < stats->max_us) ? upper : stats->max_us;
+        }
+    }
+    while (next < 3) {
+        *result[next++] = 0;
+    }
+}
+
+void ml_latency_reset(ml_latency_histogram_t *histogram) {
+    for (uint32_t b = 0; b < ML_LATENCY_BUCKETS; b++) {
+        atomic_store_explicit(&histogram->buckets[b], 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&histogram->max_us, 0, memory_order_relaxed);
+}
@@ -0,0 +1,65 @@
+#ifndef ML_LATENCY_H
+#define ML_LATENCY_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Buckets per power of two; latencies are bucketed to within 1/8 (12.5%)
+#define ML_LATENCY_SUB_BITS       3
+#define ML_LATENCY_SUB_BUCKETS    (1 << ML_LATENCY_SUB_BITS)
+
+// Exact below 2 * ML_LATENCY_SUB_BUCKETS us, then log-scale up to 2^32 us
+#define ML_LATENCY_BUCKETS        (2 * ML_LATENCY_SUB_BUCKETS + (31 - ML_LATENCY_SUB_BITS) * ML_LATENCY_SUB_BUCKETS)
+
+/**
+ * @brief Fixed-bucket log-scale latency histogram
+ *
+ * Recording is a couple of relaxed atomic increments, so any task may
+ * record without a lock, and readers see a consistent enough picture for
+ * percentiles without stopping the writers.
+ */
+typedef struct {
+    atomic_uint_least32_t buckets[ML_LATENCY_BUCKETS];
+    atomic_uint_least32_t max_us;
+} ml_latency_histogram_t;
+
+/**
+ * @brief Latency summary of a histogram
+ *
+ * Percentiles are the upper edge of the bucket holding them, so they
+ * never understate the latency by more than one bucket.
+ */
+typedef struct {
+    uint32_t count;              // Samples recorded
+    uint32_t p50_us;
+    uint32_t p95_us;
+    uint32_t p99_us;
+    uint32_t max_us;             // Exact
+} ml_latency_stats_t;
+
+/**
+ * @brief Record one latency sample
+ *
+ * @param histogram Histogram to record into
+ * @param elapsed_us Latency in microseconds
+ */
+void ml_latency_record(ml_latency_histogram_t *histogram, uint32_t elapsed_us);
+
+/**
+ * @brief Summarize a histogram
+ *
+ * @param histogram Histogram to read
+ * @param stats Pointer to store the summary
+ */
+void ml_latency_summarize(const ml_latency_histogram_t *histogram, ml_latency_stats_t *stats);
+
+/**
+ * @brief Forget all samples
+ *
+ * Samples recorded while resetting may survive it.
+ *
+ * @param histogram Histogram to reset
+ */
+void ml_latency_reset(ml_latency_histogram_t *histogram);
+
+#endif /* ML_LATENCY_H */
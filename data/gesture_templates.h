@@ -2,10 +2,78 @@
 #define GESTURE_TEMPLATES_H
 
 #include "esp_err.h"
+#include "esp_partition.h"
 #include "util/buffer.h"
+#include "processing/template_matcher.h"
 
 // Define the maximum number of gesture templates
-#define MAX_GESTURE_TEMPLATES 50
+#define MAX_GESTURE_TEMPLATES 200
+
+// Flash partition holding the template image (data partition, subtype 0x40),
+// split into two image slots (see image_slots.h)
+#define GESTURE_TEMPLATES_PARTITION_LABEL  "templates"
+#define GESTURE_TEMPLATES_PARTITION_SUBTYPE 0x40
+
+// Template image format
+#define GESTURE_TEMPLATES_MAGIC      0x4C505447  // "GTPL" little-endian
+#define GESTURE_TEMPLATES_VERSION    3
+#define GESTURE_TEMPLATE_NAME_LEN    32
+#define GESTURE_TEMPLATES_ALIGN      16
+
+/**
+ * @brief Header at the start of the template image
+ *
+ * The image is a flat little-endian file laid out for direct use once
+ * memory-mapped: every section sits at a GESTURE_TEMPLATES_ALIGN aligned
+ * offset and is sized for template_capacity entries, so adding a template
+ * never moves the others.
+ *
+ *   header | names[capacity][32] | info[capacity] | inv_scale[stride]
+ *          | offset[stride] | matrix[capacity][stride] | norms[capacity]
+ *          | matrix_q15[capacity][stride] (int16)
+ *          | sequence_inv_scale[channels] | sequences[capacity][length][channels]
+ *
+ * offset and inv_scale are the feature normalization tables: the matrix
+ * rows hold (value - offset) * inv_scale, zero-padded, as
+ * template_matcher_pack_row() produces them, and matrix_q15 the same rows
+ * from template_matcher_pack_row_q15(). Dynamic templates also carry
+ * a motion sequence for DTW matching, time-major and multiplied by
+ * sequence_inv_scale. crc32 covers every byte from header_size to
+ * total_size.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;              // GESTURE_TEMPLATES_MAGIC
+    uint16_t version;            // GESTURE_TEMPLATES_VERSION
+    uint16_t header_size;        // sizeof(gesture_templates_header_t)
+    uint16_t template_count;     // Templates in use
+    uint16_t template_capacity;  // Slots in each section
+    uint16_t feature_dim;        // Features per template
+    uint16_t feature_stride;     // Floats per matrix row, TEMPLATE_MATCHER_STRIDE(feature_dim)
+    uint32_t names_offset;       // Offsets from the start of the image
+    uint32_t info_offset;
+    uint32_t scale_offset;
+    uint32_t offset_offset;
+    uint32_t matrix_offset;
+    uint32_t norms_offset;
+    uint32_t matrix_q15_offset;
+    uint16_t sequence_length;    // Steps per motion sequence
+    uint16_t sequence_channels;  // Values per sequence step
+    uint32_t sequence_scale_offset;
+    uint32_t sequence_offset;
+    uint32_t total_size;         // Image size in bytes
+    uint32_t crc32;              // CRC32 (little-endian) of bytes [header_size, total_size)
+} gesture_templates_header_t;
+
+/**
+ * @brief Per-template metadata stored in the image
+ */
+typedef struct __attribute__((packed)) {
+    float confidence_threshold;  // Minimum score for detection
+    uint8_t is_dynamic;          // Static vs dynamic gesture
+    uint8_t has_sequence;        // Motion sequence slot holds data
+    uint8_t two_handed;          // Compared on both gloves of a pair, 0 in older images
+    uint8_t reserved;
+} gesture_template_info_t;
 
 /**
  * @brief Gesture template structure
@@ -21,6 +89,9 @@ typedef struct {
 /**
  * @brief Initialize the gesture templates
  * 
+ * Maps the template partition. If it holds no valid image, the default
+ * templates are written to it.
+ * 
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t gesture_templates_init(void);
@@ -28,13 +99,46 @@ esp_err_t gesture_templates_init(void);
 /**
  * @brief Load gesture templates from storage
  * 
+ * Memory-maps the image in the active slot and checks its header and CRC,
+ * falling back to the other slot if the active one holds no valid image.
+ * Nothing is copied to RAM; the matcher reads the templates in place.
+ * 
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t gesture_templates_load(void);
 
+/**
+ * @brief Get where a template pack is to be written
+ * 
+ * The image slot not mapped. Write a whole template image into it with an
+ * image_slot_writer_t, then activate it.
+ * 
+ * @param partition Pointer to store the template partition
+ * @param slot Pointer to store the idle slot
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t gesture_templates_get_update_slot(const esp_partition_t **partition, uint8_t *slot);
+
+/**
+ * @brief Switch the store to the template pack in an image slot
+ * 
+ * The slot is mapped and checked like at load, and must have this build's
+ * feature dimension; then it is made active. Otherwise the previous slot
+ * stays mapped and active. Templates stored since the pack was written
+ * are not carried over. Call from the task that stores templates; the
+ * classifier's snapshots are reloaded separately.
+ * 
+ * @param slot Slot holding the pack
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t gesture_templates_activate_slot(uint8_t slot);
+
 /**
  * @brief Save gesture templates to storage
  * 
+ * Changes are written through to flash as they are made, so this only
+ * verifies that the stored image is intact.
+ * 
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t gesture_templates_save(void);
@@ -46,12 +150,26 @@ esp_err_t gesture_templates_save(void);
  * @param features Feature vector
  * @param feature_count Number of features
  * @param is_dynamic Whether this is a dynamic gesture
+ * @param two_handed Whether the gesture uses the second glove of a pair;
+ *                   otherwise only the wearer's hand is stored and compared
  * @param confidence_threshold Confidence threshold for this gesture
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t gesture_templates_add(const char* name, const float* features, 
                               uint16_t feature_count, bool is_dynamic,
-                              float confidence_threshold);
+                              bool two_handed, float confidence_threshold);
+
+/**
+ * @brief Get the number of features a template is packed on
+ *
+ * Two-handed templates use all feature_dim features of the image, the
+ * others only the wearer's hand; their rows are zero past it.
+ *
+ * @param info Template metadata
+ * @param feature_dim Features per template in the image
+ * @return Features packed
+ */
+uint16_t gesture_templates_packed_dim(const gesture_template_info_t *info, uint16_t feature_dim);
 
 /**
  * @brief Get a gesture template by name
@@ -78,6 +196,66 @@ esp_err_t gesture_templates_get_by_index(uint8_t index, gesture_template_t* temp
  */
 uint8_t gesture_templates_get_count(void);
 
+/**
+ * @brief Get the loaded templates as a matcher set
+ *
+ * The set points straight into the memory-mapped image and stays valid
+ * until the next add, reset or load.
+ *
+ * @param set Pointer to store the set
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t gesture_templates_get_set(template_set_t *set);
+
+/**
+ * @brief Get the name of a template without copying it
+ *
+ * @param index Template index
+ * @return Name in the mapped image, or NULL if index is out of range
+ */
+const char* gesture_templates_get_name(uint8_t index);
+
+/**
+ * @brief Get the metadata of a template without copying it
+ *
+ * @param index Template index
+ * @return Metadata in the mapped image, or NULL if index is out of range
+ */
+const gesture_template_info_t* gesture_templates_get_info(uint8_t index);
+
+/**
+ * @brief Store the motion sequence of a template
+ *
+ * @param name Name of an existing template
+ * @param sequence Raw values, sequence_length steps of sequence_channels values each
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t gesture_templates_set_sequence(const char* name, const float* sequence);
+
+/**
+ * @brief Get the scaled motion sequence of a template without copying it
+ *
+ * @param index Template index
+ * @return Sequence in the mapped image, or NULL if the template has none
+ */
+const float* gesture_templates_get_sequence(uint8_t index);
+
+/**
+ * @brief Get the per-channel inverse scales applied to motion sequences
+ *
+ * @return Scales in the mapped image (sequence_channels values), or NULL if not loaded
+ */
+const float* gesture_templates_get_sequence_scale(void);
+
+/**
+ * @brief Get the shape of the stored motion sequences
+ *
+ * @param length Pointer to store the steps per sequence
+ * @param channels Pointer to store the values per step
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t gesture_templates_get_sequence_shape(uint16_t* length, uint16_t* channels);
+
 /**
  * @brief Reset all templates to default
  * 
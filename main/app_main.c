@@ -14,12 +14,20 @@
 // Include all subsystems
 #include "config/system_config.h"
 #include "config/pin_definitions.h"
+#include "config/memory_layout.h"
 #include "core/power_management.h"
 #include "core/system_monitor.h"
+#include "core/trace_recorder.h"
+#include "core/sensor_stream.h"
+#include "core/wake_state.h"
+#include "core/telemetry.h"
+#include "core/command_bus.h"
+#include "core/calibration.h"
 #include "drivers/flex_sensor.h"
 #include "drivers/imu.h"
-#include "drivers/camera.h"
+#if GLOVE_HAS_TOUCH
 #include "drivers/touch.h"
+#endif
 #include "drivers/display.h"
 #include "drivers/audio.h"
 #include "drivers/haptic.h"
@@ -27,15 +35,24 @@
 #include "processing/feature_extraction.h"
 #include "processing/gesture_detection.h"
 #include "communication/ble_service.h"
+#include "communication/image_transfer.h"
+#if GLOVE_TWO_HAND
+#include "communication/hand_link.h"
+#endif
 #include "output/text_generation.h"
 #include "output/output_manager.h"
 #include "tasks/sensor_task.h"
+#if GLOVE_HAS_CAMERA
+#include "tasks/camera_task.h"
+#endif
 #include "tasks/processing_task.h"
 #include "tasks/output_task.h"
 #include "tasks/communication_task.h"
 #include "tasks/power_task.h"
 #include "util/debug.h"
 #include "util/buffer.h"
+#include "util/frame_pool.h"
+#include "util/heap_guard.h"
 
 static const char *TAG = "APP_MAIN";
 
@@ -46,22 +63,122 @@ system_config_t g_system_config;
 QueueHandle_t g_sensor_data_queue;
 QueueHandle_t g_processing_result_queue;
 QueueHandle_t g_output_command_queue;
-QueueHandle_t g_system_command_queue;
 
 // Event group for system synchronization
 EventGroupHandle_t g_system_event_group;
 
+// Queue storage, reserved at link time in internal RAM
+STATIC_QUEUE_STORAGE(sensor_data, SENSOR_QUEUE_SIZE, sizeof(sensor_frame_index_t));
+STATIC_QUEUE_STORAGE(processing_result, PROCESSING_QUEUE_SIZE, sizeof(processing_result_t));
+STATIC_QUEUE_STORAGE(output_command, OUTPUT_QUEUE_SIZE, sizeof(output_command_t));
+static StaticEventGroup_t system_event_group;
+
 // Forward declarations for initialization functions
 static esp_err_t init_nvs(void);
 static esp_err_t init_spiffs(void);
 static esp_err_t init_i2c(void);
 static esp_err_t init_system_config(void);
-static esp_err_t init_drivers(void);
 static esp_err_t init_processing(void);
 static esp_err_t init_communication(void);
 static esp_err_t init_output(void);
 static esp_err_t init_queues(void);
 static esp_err_t init_tasks(void);
+static esp_err_t run_boot_graph(void);
+
+/**
+ * Boot steps, run as a dependency graph: every step whose dependencies
+ * have finished starts at once in its own short-lived task, so flash,
+ * I2C and Bluetooth bring-up overlap on both cores. The camera and audio
+ * are not in the graph; they come up on first use.
+ */
+typedef enum {
+    BOOT_STEP_NVS,
+    BOOT_STEP_CONFIG,
+    BOOT_STEP_CALIBRATION,
+    BOOT_STEP_SPIFFS,
+    BOOT_STEP_I2C,
+    BOOT_STEP_QUEUES,
+    BOOT_STEP_DISPLAY,
+    BOOT_STEP_FLEX,
+    BOOT_STEP_IMU,
+#if GLOVE_HAS_TOUCH
+    BOOT_STEP_TOUCH,
+#endif
+    BOOT_STEP_HAPTIC,
+    BOOT_STEP_BLE,
+    BOOT_STEP_POWER,
+    BOOT_STEP_MONITOR,
+    BOOT_STEP_TRACE,
+    BOOT_STEP_STREAM,
+#if GLOVE_TWO_HAND
+    BOOT_STEP_HAND_LINK,
+#endif
+    BOOT_STEP_PROCESSING,
+    BOOT_STEP_OUTPUT,
+    BOOT_STEP_TRANSFER,
+    BOOT_STEP_COUNT
+} boot_step_id_t;
+
+#define BOOT_BIT(step) (1UL << (step))
+#define BOOT_ALL_STEPS (BOOT_BIT(BOOT_STEP_COUNT) - 1)
+
+// One event group bit per step, and the group has 24
+_Static_assert(BOOT_STEP_COUNT <= 24, "Too many boot steps for one event group");
+
+typedef struct {
+    const char *name;
+    esp_err_t (*init)(void);
+    uint32_t depends_on;    // BOOT_BIT()s that must have finished first
+    BaseType_t core;
+    bool required;          // Failure aborts boot; optional steps only log
+} boot_step_t;
+
+static const boot_step_t boot_steps[BOOT_STEP_COUNT] = {
+    [BOOT_STEP_NVS]        = { "nvs",        init_nvs,              0,                                   0, true },
+    [BOOT_STEP_CONFIG]     = { "config",     init_system_config,    BOOT_BIT(BOOT_STEP_NVS),             0, true },
+    // One blob read; the drivers start with what it holds
+    [BOOT_STEP_CALIBRATION] = { "calibration", calibration_init,   BOOT_BIT(BOOT_STEP_NVS),             0, true },
+    [BOOT_STEP_SPIFFS]     = { "spiffs",     init_spiffs,           0,                                   1, true },
+    [BOOT_STEP_I2C]        = { "i2c",        init_i2c,              0,                                   1, true },
+    [BOOT_STEP_QUEUES]     = { "queues",     init_queues,           0,                                   1, true },
+    [BOOT_STEP_DISPLAY]    = { "display",    display_init,          BOOT_BIT(BOOT_STEP_I2C),             1, true },
+    [BOOT_STEP_FLEX]       = { "flex",       flex_sensor_init,      BOOT_BIT(BOOT_STEP_CALIBRATION),     0, true },
+    [BOOT_STEP_IMU]        = { "imu",        imu_init,              BOOT_BIT(BOOT_STEP_CALIBRATION) |
+                                                                    BOOT_BIT(BOOT_STEP_I2C),             1, true },
+#if GLOVE_HAS_TOUCH
+    [BOOT_STEP_TOUCH]      = { "touch",      touch_init,            BOOT_BIT(BOOT_STEP_CALIBRATION),     0, true },
+#endif
+    [BOOT_STEP_HAPTIC]     = { "haptic",     haptic_init,           0,                                   0, true },
+    [BOOT_STEP_BLE]        = { "ble",        init_communication,    BOOT_BIT(BOOT_STEP_CONFIG),          0, true },
+    // Battery ADC shares ADC1 with the flex sensors; the initial mode may
+    // switch the display, BLE and IMU
+    [BOOT_STEP_POWER]      = { "power",      power_management_init, BOOT_BIT(BOOT_STEP_FLEX) |
+                                                                    BOOT_BIT(BOOT_STEP_DISPLAY) |
+                                                                    BOOT_BIT(BOOT_STEP_IMU) |
+                                                                    BOOT_BIT(BOOT_STEP_BLE),             0, true },
+    [BOOT_STEP_MONITOR]    = { "monitor",    system_monitor_init,   BOOT_BIT(BOOT_STEP_POWER),           0, true },
+    // Development aids: boot continues without them
+    [BOOT_STEP_TRACE]      = { "trace",      trace_recorder_init,   BOOT_BIT(BOOT_STEP_SPIFFS),          1, false },
+    [BOOT_STEP_STREAM]     = { "stream",     sensor_stream_init,    BOOT_BIT(BOOT_STEP_BLE),             0, false },
+#if GLOVE_TWO_HAND
+    // Wi-Fi joins the radio once Bluetooth is up; without the link a
+    // primary still recognizes one-handed signs
+    [BOOT_STEP_HAND_LINK]  = { "hand_link",  hand_link_init,        BOOT_BIT(BOOT_STEP_NVS) |
+                                                                    BOOT_BIT(BOOT_STEP_BLE),             0, false },
+#endif
+    // Template store and view read the active slot from NVS
+    [BOOT_STEP_PROCESSING] = { "processing", init_processing,       BOOT_BIT(BOOT_STEP_NVS),             1, true },
+    [BOOT_STEP_OUTPUT]     = { "output",     init_output,           BOOT_BIT(BOOT_STEP_SPIFFS) |
+                                                                    BOOT_BIT(BOOT_STEP_DISPLAY),         1, true },
+    // Without it the glove keeps the images it has
+    [BOOT_STEP_TRANSFER]   = { "transfer",   image_transfer_init,   BOOT_BIT(BOOT_STEP_BLE) |
+                                                                    BOOT_BIT(BOOT_STEP_PROCESSING),      0, false },
+};
+
+// Written by each step's task before it sets its bit
+static esp_err_t boot_step_result[BOOT_STEP_COUNT];
+static uint32_t boot_step_ms[BOOT_STEP_COUNT];
+static EventGroupHandle_t boot_done_group = NULL;
 
 /**
  * @brief Initialize the application
@@ -73,95 +190,143 @@ static esp_err_t init_tasks(void);
  */
 esp_err_t app_init(void) {
     esp_err_t ret;
+    int64_t boot_start = esp_timer_get_time();
     
     // Create system event group
-    g_system_event_group = xEventGroupCreate();
+    g_system_event_group = xEventGroupCreateStatic(&system_event_group);
     if (g_system_event_group == NULL) {
         ESP_LOGE(TAG, "Failed to create system event group");
         return ESP_FAIL;
     }
     
-    // Initialize NVS
-    ret = init_nvs();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize NVS: %s", esp_err_to_name(ret));
-        return ret;
-    }
+    // A wake from deep sleep brings configuration and calibration back from RTC memory
+    bool warm_boot = wake_state_restore();
     
-    // Initialize SPIFFS
-    ret = init_spiffs();
+    // Initialize debug subsystem first so every step below can log through it
+    ret = debug_init(DEBUG_LEVEL_INFO, DEBUG_MODE_UART | DEBUG_MODE_DISPLAY);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize SPIFFS: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "Failed to initialize debug subsystem: %s", esp_err_to_name(ret));
         return ret;
     }
     
-    // Initialize I2C bus (shared between multiple devices)
-    ret = init_i2c();
+    // Bring up storage, drivers, processing, communication and output
+    ret = run_boot_graph();
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize I2C: %s", esp_err_to_name(ret));
         return ret;
     }
     
-    // Initialize system configuration
-    ret = init_system_config();
+    // Initialize system tasks
+    int64_t tasks_start = esp_timer_get_time();
+    ret = init_tasks();
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize system config: %s", esp_err_to_name(ret));
+        ESP_LOGE(TAG, "Failed to initialize tasks: %s", esp_err_to_name(ret));
         return ret;
     }
+    ESP_LOGI(TAG, "Boot phase tasks: %lu ms", (unsigned long)((esp_timer_get_time() - tasks_start) / 1000));
     
-    // Initialize debug subsystem
-    ret = debug_init(DEBUG_LEVEL_INFO, DEBUG_MODE_UART | DEBUG_MODE_DISPLAY);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize debug subsystem: %s", esp_err_to_name(ret));
-        return ret;
-    }
+    // Set system initialization complete; from here on the heap is off limits
+    xEventGroupSetBits(g_system_event_group, SYSTEM_EVENT_INIT_COMPLETE);
+    heap_guard_arm();
     
-    // Initialize interprocess queues
-    ret = init_queues();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize queues: %s", esp_err_to_name(ret));
-        return ret;
-    }
+    ESP_LOGI(TAG, "Application initialized successfully in %lu ms (%s boot, %lu ms since reset)",
+             (unsigned long)((esp_timer_get_time() - boot_start) / 1000),
+             warm_boot ? "warm" : "cold", (unsigned long)(esp_timer_get_time() / 1000));
+    return ESP_OK;
+}
+
+static void boot_step_task(void *arg) {
+    boot_step_id_t id = (boot_step_id_t)(uintptr_t)arg;
+    const boot_step_t *step = &boot_steps[id];
     
-    // Initialize drivers
-    ret = init_drivers();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize drivers: %s", esp_err_to_name(ret));
-        return ret;
-    }
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = step->init();
+    boot_step_ms[id] = (uint32_t)((esp_timer_get_time() - start) / 1000);
+    boot_step_result[id] = ret;
     
-    // Initialize processing modules
-    ret = init_processing();
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize processing: %s", esp_err_to_name(ret));
-        return ret;
+        ESP_LOGE(TAG, "Boot step %s failed after %lu ms: %s", step->name,
+                 (unsigned long)boot_step_ms[id], esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Boot step %s: %lu ms on core %d", step->name,
+                 (unsigned long)boot_step_ms[id], xPortGetCoreID());
     }
     
-    // Initialize communication
-    ret = init_communication();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize communication: %s", esp_err_to_name(ret));
-        return ret;
+    xEventGroupSetBits(boot_done_group, BOOT_BIT(id));
+    vTaskDelete(NULL);
+}
+
+static esp_err_t run_boot_graph(void) {
+    boot_done_group = xEventGroupCreate();
+    if (boot_done_group == NULL) {
+        ESP_LOGE(TAG, "Failed to create boot event group");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    int64_t start = esp_timer_get_time();
+    uint32_t started = 0;
+    uint32_t finished = 0;
+    esp_err_t failure = ESP_OK;
+    
+    while (finished != started || (failure == ESP_OK && finished != BOOT_ALL_STEPS)) {
+        // Start everything whose dependencies are met, unless boot is failing
+        for (int i = 0; i < BOOT_STEP_COUNT && failure == ESP_OK; i++) {
+            const boot_step_t *step = &boot_steps[i];
+            if ((started & BOOT_BIT(i)) || (step->depends_on & finished) != step->depends_on) {
+                continue;
+            }
+            
+            BaseType_t xReturned = xTaskCreatePinnedToCore(
+                boot_step_task,
+                step->name,
+                BOOT_STEP_STACK_SIZE,
+                (void *)(uintptr_t)i,
+                BOOT_STEP_PRIORITY,
+                NULL,
+                step->core
+            );
+            if (xReturned != pdPASS) {
+                ESP_LOGE(TAG, "Failed to start boot step %s", step->name);
+                failure = ESP_ERR_NO_MEM;
+                break;
+            }
+            started |= BOOT_BIT(i);
+        }
+        
+        uint32_t running = started & ~finished;
+        if (running == 0) {
+            break;  // Only reached when nothing could be started
+        }
+        
+        uint32_t now_finished = (uint32_t)xEventGroupWaitBits(boot_done_group, running,
+                                                              pdFALSE, pdFALSE, portMAX_DELAY) & BOOT_ALL_STEPS;
+        for (int i = 0; i < BOOT_STEP_COUNT; i++) {
+            if ((now_finished & ~finished & BOOT_BIT(i)) &&
+                boot_step_result[i] != ESP_OK && boot_steps[i].required && failure == ESP_OK) {
+                failure = boot_step_result[i];
+            }
+        }
+        finished = now_finished;
     }
     
-    // Initialize output systems
-    ret = init_output();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize output: %s", esp_err_to_name(ret));
-        return ret;
-    }
+    vEventGroupDelete(boot_done_group);
+    boot_done_group = NULL;
     
-    // Initialize system tasks
-    ret = init_tasks();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize tasks: %s", esp_err_to_name(ret));
-        return ret;
+    if (failure == ESP_OK && finished != BOOT_ALL_STEPS) {
+        failure = ESP_ERR_INVALID_STATE;  // A dependency that can never finish
     }
     
-    // Set system initialization complete
-    xEventGroupSetBits(g_system_event_group, SYSTEM_EVENT_INIT_COMPLETE);
+    if (failure != ESP_OK) {
+        ESP_LOGE(TAG, "Boot failed: %s", esp_err_to_name(failure));
+        return failure;
+    }
     
-    ESP_LOGI(TAG, "Application initialized successfully");
+    // The sum against the wall time shows what running steps side by side saved
+    uint32_t serial_ms = 0;
+    for (int i = 0; i < BOOT_STEP_COUNT; i++) {
+        serial_ms += boot_step_ms[i];
+    }
+    ESP_LOGI(TAG, "Boot phase graph: %lu ms (%lu ms of steps)",
+             (unsigned long)((esp_timer_get_time() - start) / 1000), (unsigned long)serial_ms);
     return ESP_OK;
 }
 
@@ -244,6 +409,13 @@ static esp_err_t init_i2c(void) {
 }
 
 static esp_err_t init_system_config(void) {
+    if (wake_state_is_warm()) {
+        // Restored from RTC memory, no NVS read
+        g_system_config.system_state = SYSTEM_STATE_INIT;
+        ESP_LOGI(TAG, "System configuration restored");
+        return ESP_OK;
+    }
+    
     // Initialize default system configuration
     g_system_config.system_state = SYSTEM_STATE_INIT;
     g_system_config.last_error = SYSTEM_ERROR_NONE;
@@ -253,7 +425,7 @@ static esp_err_t init_system_config(void) {
     g_system_config.haptic_intensity = 80;
     g_system_config.bluetooth_enabled = true;
     g_system_config.power_save_enabled = true;
-    g_system_config.touch_enabled = true;
+    g_system_config.touch_enabled = GLOVE_HAS_TOUCH;
     g_system_config.camera_enabled = false; // Camera initially disabled to save power
     g_system_config.calibration_required = true;
     
@@ -274,79 +446,6 @@ static esp_err_t init_system_config(void) {
     return ESP_OK;
 }
 
-static esp_err_t init_drivers(void) {
-    esp_err_t ret;
-    
-    // Initialize display first to show progress
-    ret = display_init();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize display: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    // Initialize flex sensors
-    ret = flex_sensor_init();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize flex sensors: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    // Initialize IMU
-    ret = imu_init();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize IMU: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    // Initialize touch sensors
-    ret = touch_init();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize touch sensors: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    // Initialize audio
-    ret = audio_init();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize audio: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    // Initialize haptic feedback
-    ret = haptic_init();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize haptic feedback: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    // Initialize camera (if enabled)
-    if (g_system_config.camera_enabled) {
-        ret = camera_init();
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to initialize camera: %s", esp_err_to_name(ret));
-            // Camera is optional, so we continue even if it fails
-            g_system_config.camera_enabled = false;
-        }
-    }
-    
-    // Initialize power management
-    ret = power_management_init();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize power management: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    // Initialize system monitor
-    ret = system_monitor_init();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize system monitor: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    ESP_LOGI(TAG, "All drivers initialized successfully");
-    return ESP_OK;
-}
-
 static esp_err_t init_processing(void) {
     esp_err_t ret;
     
@@ -413,34 +512,45 @@ static esp_err_t init_output(void) {
 }
 
 static esp_err_t init_queues(void) {
-    // Create sensor data queue
-    g_sensor_data_queue = xQueueCreate(SENSOR_QUEUE_SIZE, sizeof(sensor_data_t));
+    // Initialize the sensor frame pool shared by the sensor and processing tasks
+    esp_err_t ret = frame_pool_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize sensor frame pool: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    // Create sensor data queue (carries frame pool indices)
+    g_sensor_data_queue = STATIC_QUEUE_CREATE(sensor_data, SENSOR_QUEUE_SIZE, sizeof(sensor_frame_index_t));
     if (g_sensor_data_queue == NULL) {
         ESP_LOGE(TAG, "Failed to create sensor data queue");
         return ESP_FAIL;
     }
     
     // Create processing result queue
-    g_processing_result_queue = xQueueCreate(PROCESSING_QUEUE_SIZE, sizeof(processing_result_t));
+    g_processing_result_queue = STATIC_QUEUE_CREATE(processing_result, PROCESSING_QUEUE_SIZE, sizeof(processing_result_t));
     if (g_processing_result_queue == NULL) {
         ESP_LOGE(TAG, "Failed to create processing result queue");
         return ESP_FAIL;
     }
     
     // Create output command queue
-    g_output_command_queue = xQueueCreate(OUTPUT_QUEUE_SIZE, sizeof(output_command_t));
+    g_output_command_queue = STATIC_QUEUE_CREATE(output_command, OUTPUT_QUEUE_SIZE, sizeof(output_command_t));
     if (g_output_command_queue == NULL) {
         ESP_LOGE(TAG, "Failed to create output command queue");
         return ESP_FAIL;
     }
     
-    // Create system command queue
-    g_system_command_queue = xQueueCreate(COMMAND_QUEUE_SIZE, sizeof(system_command_t));
-    if (g_system_command_queue == NULL) {
-        ESP_LOGE(TAG, "Failed to create system command queue");
-        return ESP_FAIL;
+    // Create the system command queues, one per subscribing task
+    ret = command_bus_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create system command bus");
+        return ret;
     }
     
+    telemetry_register_queue(TELEMETRY_QUEUE_SENSOR_DATA, g_sensor_data_queue);
+    telemetry_register_queue(TELEMETRY_QUEUE_PROCESSING_RESULT, g_processing_result_queue);
+    telemetry_register_queue(TELEMETRY_QUEUE_OUTPUT_COMMAND, g_output_command_queue);
+    
     ESP_LOGI(TAG, "All queues created successfully");
     return ESP_OK;
 }
@@ -455,6 +565,15 @@ static esp_err_t init_tasks(void) {
         return ret;
     }
     
+#if GLOVE_HAS_CAMERA
+    // Initialize camera task (idles while the camera is disabled)
+    ret = camera_task_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize camera task: %s", esp_err_to_name(ret));
+        return ret;
+    }
+#endif
+    
     // Initialize processing task
     ret = processing_task_init();
     if (ret != ESP_OK) {
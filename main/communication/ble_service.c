@@ -1,6 +1,7 @@
 #include "communication/ble_service.h"
 #include <string.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_bt.h"
 #include "esp_bt_main.h"
 #include "esp_gap_ble_api.h"
@@ -8,8 +9,13 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
 #include "config/system_config.h"
 #include "util/debug.h"
+#include "util/cycle_trace.h"
+#include "core/system_monitor.h"
+#include "processing/template_view.h"
 
 static const char *TAG = "BLE_SERVICE";
 
@@ -20,8 +26,11 @@ static const char *TAG = "BLE_SERVICE";
 #define GATTS_CHAR_UUID_STATUS             0x2A1F
 #define GATTS_CHAR_UUID_DEBUG              0x2A20
 #define GATTS_CHAR_UUID_COMMAND            0x2A21
+#define GATTS_CHAR_UUID_STREAM             0x2A22
+#define GATTS_CHAR_UUID_TELEMETRY          0x2A23
+#define GATTS_CHAR_UUID_TRANSFER           0x2A24
 
-#define GATTS_NUM_HANDLE                   10
+#define GATTS_NUM_HANDLE                   17
 #define PROFILE_NUM                        1
 #define PROFILE_APP_IDX                    0
 
@@ -32,10 +41,17 @@ static const char *TAG = "BLE_SERVICE";
 
 // MTU size for BLE communication
 #define BLE_MTU_SIZE                       500
+#define BLE_DEFAULT_MTU                    23    // Until the client negotiates
+#define BLE_ATT_HEADER_SIZE                3     // Opcode and handle of a notification
+
+// Gesture results packet: type and timestamp, then the records
+#define BLE_RESULTS_HEADER_SIZE            5
+#define BLE_TEXT_MAX                       255   // Longest text the keep byte can refer back to
 
 // Characteristic properties
 #define CHAR_PROP_READ                     (ESP_GATT_CHAR_PROP_BIT_READ)
 #define CHAR_PROP_WRITE                    (ESP_GATT_CHAR_PROP_BIT_WRITE)
+#define CHAR_PROP_WRITE_NR                 (ESP_GATT_CHAR_PROP_BIT_WRITE_NR)
 #define CHAR_PROP_NOTIFY                   (ESP_GATT_CHAR_PROP_BIT_NOTIFY)
 
 // BLE advertising parameters
@@ -55,6 +71,9 @@ static uint16_t text_char_handle;
 static uint16_t status_char_handle;
 static uint16_t debug_char_handle;
 static uint16_t command_char_handle;
+static uint16_t stream_char_handle;
+static uint16_t telemetry_char_handle;
+static uint16_t transfer_char_handle;
 
 // Connection status
 static bool is_connected = false;
@@ -71,16 +90,72 @@ static uint16_t conn_id = 0xFFFF;
 // Command callback
 static ble_command_callback_t command_callback = NULL;
 
+// Sensor stream flow control callback
+static ble_stream_callback_t stream_callback = NULL;
+
+// Image transfer chunk callback
+static ble_transfer_callback_t transfer_callback = NULL;
+
 // Notification enable flags
 static bool gesture_notify_enable = false;
 static bool text_notify_enable = false;
 static bool status_notify_enable = false;
 static bool debug_notify_enable = false;
+static bool stream_notify_enable = false;
+static bool telemetry_notify_enable = false;
+static bool transfer_notify_enable = false;
+
+// The stack has no room for more notifications
+static volatile bool congested = false;
+
+// Negotiated ATT MTU and connection interval of the current connection
+static uint16_t att_mtu = BLE_DEFAULT_MTU;
+static uint32_t conn_interval_ms = BLE_BATCH_DEFAULT_MS;
+
+// Gesture results waiting for the end of the connection interval, under batch_lock
+static portMUX_TYPE batch_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t batch_buffer[BLE_MTU_SIZE];
+static size_t batch_len = 0;
+static uint32_t batch_last_ms = 0;
+static TimerHandle_t batch_timer = NULL;
+
+// Sends a batch, from the output task when full or the timer task when due
+static SemaphoreHandle_t batch_send_mutex = NULL;
+static StaticSemaphore_t batch_send_mutex_storage;
+static uint8_t batch_tx[BLE_MTU_SIZE];
+
+// Hash of the name the client holds for each gesture ID, 0 if none; under
+// batch_send_mutex while the client is subscribed
+static uint16_t announced_names[256];
+
+// Name table sent after a subscribe, a few names per timer tick, under batch_send_mutex
+#define NAME_TABLE_DONE     UINT16_MAX
+static volatile bool name_table_requested = false;
+static uint16_t name_table_next = NAME_TABLE_DONE;
+
+// Text the client holds, for sending only the change
+static char text_sent[BLE_TEXT_MAX];
+static size_t text_sent_len = 0;
+
+// Connection parameters last requested, under link_lock
+typedef enum {
+    LINK_NONE = 0,           // Not connected
+    LINK_FAST,
+    LINK_SLOW
+} link_mode_t;
+static portMUX_TYPE link_lock = portMUX_INITIALIZER_UNLOCKED;
+static link_mode_t link_mode = LINK_NONE;
+static uint32_t last_traffic_ms = 0;
+static esp_bd_addr_t peer_bda;
 
 // Forward declarations for internal functions
 static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
 static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
 static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
+static void batch_timer_callback(TimerHandle_t timer);
+static void reset_client_state(void);
+static void note_traffic(void);
+static bool request_link(link_mode_t mode);
 
 // Service definition
 static struct gatts_profile_inst {
@@ -104,6 +179,14 @@ esp_err_t ble_service_init(void) {
     
     ESP_LOGI(TAG, "Initializing BLE service...");
     
+    batch_send_mutex = xSemaphoreCreateMutexStatic(&batch_send_mutex_storage);
+    batch_timer = xTimerCreate("ble_batch", pdMS_TO_TICKS(BLE_BATCH_DEFAULT_MS), pdFALSE, NULL,
+                               batch_timer_callback);
+    if (batch_send_mutex == NULL || batch_timer == NULL) {
+        ESP_LOGE(TAG, "Failed to create gesture batching");
+        return ESP_ERR_NO_MEM;
+    }
+    
     // Release BT controller memory if needed
     ret = esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT);
     if (ret) {
@@ -214,11 +297,16 @@ esp_err_t ble_service_deinit(void) {
     is_registered = false;
     gatts_if = 0xFF;
     conn_id = 0xFFFF;
+    att_mtu = BLE_DEFAULT_MTU;
+    reset_client_state();
     
     gesture_notify_enable = false;
     text_notify_enable = false;
     status_notify_enable = false;
     debug_notify_enable = false;
+    stream_notify_enable = false;
+    telemetry_notify_enable = false;
+    congested = false;
     
     ESP_LOGI(TAG, "BLE service deinitialized");
     return ESP_OK;
@@ -266,58 +354,261 @@ esp_err_t ble_service_is_connected(bool *connected) {
     return ESP_OK;
 }
 
-esp_err_t ble_service_send_gesture(uint8_t gesture_id, const char *gesture_name, float confidence) {
-    if (!is_connected || !gesture_notify_enable) {
-        return ESP_OK;  // Not connected or notifications not enabled
+uint32_t ble_service_update_link(void) {
+    uint32_t now_ms = esp_timer_get_time() / 1000;
+    uint32_t wait_ms = UINT32_MAX;
+    bool go_slow = false;
+    
+    portENTER_CRITICAL(&link_lock);
+    if (link_mode == LINK_FAST) {
+        // A subscribed stream counts as traffic all the time
+        if (stream_notify_enable) {
+            last_traffic_ms = now_ms;
+        }
+        uint32_t idle_ms = now_ms - last_traffic_ms;
+        if (idle_ms >= BLE_LINK_IDLE_MS) {
+            link_mode = LINK_SLOW;
+            go_slow = true;
+        } else {
+            wait_ms = BLE_LINK_IDLE_MS - idle_ms;
+        }
     }
+    portEXIT_CRITICAL(&link_lock);
     
-    // Prepare data packet
-    uint8_t buffer[64];
-    size_t len = 0;
+    if (go_slow && !request_link(LINK_SLOW)) {
+        wait_ms = BLE_LINK_IDLE_MS;  // Stays fast; try again later
+    }
     
-    buffer[len++] = gesture_id;
+    return wait_ms;
+}
+
+size_t ble_service_get_payload_size(void) {
+    uint16_t mtu = (att_mtu < BLE_MTU_SIZE) ? att_mtu : BLE_MTU_SIZE;
+    return mtu - BLE_ATT_HEADER_SIZE;
+}
+
+// FNV-1a folded to 16 bits; 0 is kept for "not announced"
+static uint16_t name_hash(const char *name) {
+    uint32_t hash = 2166136261u;
+    while (*name != '\0') {
+        hash = (hash ^ (uint8_t)*name++) * 16777619u;
+    }
+    hash ^= hash >> 16;
+    return ((uint16_t)hash != 0) ? (uint16_t)hash : 1;
+}
+
+// Tell the client the name behind an ID, unless it already has it
+static esp_err_t announce_name(uint8_t gesture_id, const char *gesture_name) {
+    uint16_t hash = name_hash(gesture_name);
+    if (announced_names[gesture_id] == hash) {
+        return ESP_OK;
+    }
     
-    // Copy gesture name
+    uint8_t buffer[3 + 32];
     size_t name_len = strlen(gesture_name);
     if (name_len > 32) name_len = 32;  // Limit to 32 characters
     
-    buffer[len++] = (uint8_t)name_len;
-    memcpy(buffer + len, gesture_name, name_len);
-    len += name_len;
-    
-    // Copy confidence (as float, 4 bytes)
-    memcpy(buffer + len, &confidence, sizeof(float));
-    len += sizeof(float);
+    buffer[0] = BLE_GESTURE_PACKET_NAME;
+    buffer[1] = gesture_id;
+    buffer[2] = (uint8_t)name_len;
+    memcpy(buffer + 3, gesture_name, name_len);
     
-    // Send notification
-    esp_err_t ret = esp_ble_gatts_send_indicate(gatts_if, conn_id, gesture_char_handle, 
-                                               len, buffer, false);
+    CYCLE_TRACE_BEGIN(CYCLE_TRACE_BLE_SEND);
+    esp_err_t ret = esp_ble_gatts_send_indicate(gatts_if, conn_id, gesture_char_handle,
+                                               3 + name_len, buffer, false);
+    CYCLE_TRACE_END(CYCLE_TRACE_BLE_SEND);
     if (ret) {
-        ESP_LOGW(TAG, "Failed to send gesture notification: %s", esp_err_to_name(ret));
+        ESP_LOGW(TAG, "Failed to send gesture name: %s", esp_err_to_name(ret));
         return ret;
     }
     
+    announced_names[gesture_id] = hash;
     return ESP_OK;
 }
 
-esp_err_t ble_service_send_text(const char *text) {
+// Send the next few names of the table; true while some are left. The
+// caller holds batch_send_mutex.
+static bool send_name_table(void) {
+    if (name_table_requested) {
+        name_table_requested = false;
+        memset(announced_names, 0, sizeof(announced_names));
+        name_table_next = 0;
+    }
+
+    char name[GESTURE_TEMPLATE_NAME_LEN];
+    for (int n = 0; n < BLE_NAME_TABLE_BURST && name_table_next != NAME_TABLE_DONE; n++) {
+        if (!is_connected || !gesture_notify_enable || name_table_next > UINT8_MAX) {
+            name_table_next = NAME_TABLE_DONE;
+            break;
+        }
+        if (congested) {
+            break;
+        }
+
+        esp_err_t ret = template_view_copy_name(name_table_next, name);
+        if (ret == ESP_ERR_TIMEOUT) {
+            break;  // Templates are being updated; next tick
+        }
+        name[GESTURE_TEMPLATE_NAME_LEN - 1] = '\0';
+        if (ret != ESP_OK || announce_name((uint8_t)name_table_next, name) != ESP_OK) {
+            // Past the last template, or the link failed; results still announce their own names
+            name_table_next = NAME_TABLE_DONE;
+            break;
+        }
+        name_table_next++;
+    }
+    return name_table_next != NAME_TABLE_DONE;
+}
+
+// Send the batched results, if any; the caller holds batch_send_mutex
+static esp_err_t send_batch(void) {
+    esp_err_t ret = ESP_OK;
+    
+    portENTER_CRITICAL(&batch_lock);
+    size_t len = batch_len;
+    memcpy(batch_tx, batch_buffer, len);
+    batch_len = 0;
+    portEXIT_CRITICAL(&batch_lock);
+    
+    if (len > 0 && is_connected && gesture_notify_enable) {
+        CYCLE_TRACE_BEGIN(CYCLE_TRACE_BLE_SEND);
+        ret = esp_ble_gatts_send_indicate(gatts_if, conn_id, gesture_char_handle, len, batch_tx, false);
+        CYCLE_TRACE_END(CYCLE_TRACE_BLE_SEND);
+        if (ret) {
+            ESP_LOGW(TAG, "Failed to send gesture notification: %s", esp_err_to_name(ret));
+        }
+    }
+    
+    return ret;
+}
+
+// Send a full batch from the output task
+static esp_err_t flush_batch(void) {
+    xSemaphoreTake(batch_send_mutex, portMAX_DELAY);
+    esp_err_t ret = send_batch();
+    xSemaphoreGive(batch_send_mutex);
+    return ret;
+}
+
+// Runs in the timer service task, which must not block: while the output
+// task is sending, the batch is tried again on the next tick. Also sends
+// the name table ahead of the batch, a few names per tick.
+static void batch_timer_callback(TimerHandle_t timer) {
+    if (xSemaphoreTake(batch_send_mutex, 0) != pdTRUE) {
+        xTimerChangePeriod(timer, 1, 0);
+        return;
+    }
+    bool names_left = send_name_table();
+    send_batch();
+    xSemaphoreGive(batch_send_mutex);
+
+    if (names_left) {
+        xTimerChangePeriod(timer, 1, 0);
+    }
+}
+
+esp_err_t ble_service_send_gesture(uint8_t gesture_id, const char *gesture_name, float confidence,
+                                   uint32_t timestamp_ms) {
+    if (!is_connected || !gesture_notify_enable) {
+        return ESP_OK;  // Not connected or notifications not enabled
+    }
+    
+    // Results referring to an unknown name would be useless to the client;
+    // one the name table has not reached yet, or that changed, goes first
+    xSemaphoreTake(batch_send_mutex, portMAX_DELAY);
+    esp_err_t ret = announce_name(gesture_id, gesture_name);
+    xSemaphoreGive(batch_send_mutex);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    if (confidence < 0.0f) confidence = 0.0f;
+    if (confidence > 1.0f) confidence = 1.0f;
+    
+    ble_gesture_record_t record = {
+        .gesture_id = gesture_id,
+        .confidence = (uint8_t)(confidence * 255.0f + 0.5f)
+    };
+    
+    // Packed up to the MTU; a full batch goes out at once
+    portENTER_CRITICAL(&batch_lock);
+    bool full = batch_len > 0 && batch_len + sizeof(record) > ble_service_get_payload_size();
+    portEXIT_CRITICAL(&batch_lock);
+    if (full) {
+        flush_batch();
+    }
+    
+    portENTER_CRITICAL(&batch_lock);
+    bool first = batch_len == 0;
+    if (first) {
+        batch_buffer[0] = BLE_GESTURE_PACKET_RESULTS;
+        memcpy(batch_buffer + 1, &timestamp_ms, sizeof(timestamp_ms));
+        batch_len = BLE_RESULTS_HEADER_SIZE;
+    } else {
+        uint32_t delta = timestamp_ms - batch_last_ms;
+        record.delta_ms = (delta < UINT16_MAX) ? (uint16_t)delta : UINT16_MAX;
+    }
+    memcpy(batch_buffer + batch_len, &record, sizeof(record));
+    batch_len += sizeof(record);
+    batch_last_ms = timestamp_ms;
+    portEXIT_CRITICAL(&batch_lock);
+    
+    note_traffic();
+    
+    // The first result of a batch opens the window of one connection interval
+    if (first) {
+        TickType_t window = pdMS_TO_TICKS(conn_interval_ms);
+        xTimerChangePeriod(batch_timer, (window > 0) ? window : 1, 0);
+    }
+    
+    return ESP_OK;
+}
+
+esp_err_t ble_service_send_text(const char *text, uint32_t origin_timestamp) {
     if (!is_connected || !text_notify_enable) {
         return ESP_OK;  // Not connected or notifications not enabled
     }
     
     size_t len = strlen(text);
-    if (len > BLE_MTU_SIZE - 3) {
-        len = BLE_MTU_SIZE - 3;  // Limit to MTU size minus ATT headers
+    if (len > BLE_TEXT_MAX) {
+        len = BLE_TEXT_MAX;
+    }
+    
+    // Keep what the client already has in common with the new text
+    size_t keep = 0;
+    while (keep < len && keep < text_sent_len && text[keep] == text_sent[keep]) {
+        keep++;
+    }
+    if (keep == len && len == text_sent_len) {
+        system_monitor_record_output(OUTPUT_SINK_BLE, origin_timestamp);
+        return ESP_OK;  // Unchanged
     }
     
+    size_t append = len - keep;
+    if (append > ble_service_get_payload_size() - 1) {
+        append = ble_service_get_payload_size() - 1;  // Limit to MTU size minus ATT headers
+    }
+    
+    uint8_t buffer[BLE_MTU_SIZE];
+    buffer[0] = (uint8_t)keep;
+    memcpy(buffer + 1, text + keep, append);
+    
     // Send notification
+    CYCLE_TRACE_BEGIN(CYCLE_TRACE_BLE_SEND);
     esp_err_t ret = esp_ble_gatts_send_indicate(gatts_if, conn_id, text_char_handle, 
-                                               len, (uint8_t *)text, false);
+                                               1 + append, buffer, false);
+    CYCLE_TRACE_END(CYCLE_TRACE_BLE_SEND);
     if (ret) {
         ESP_LOGW(TAG, "Failed to send text notification: %s", esp_err_to_name(ret));
         return ret;
     }
     
+    memcpy(text_sent + keep, text + keep, append);
+    text_sent_len = keep + append;
+    
+    note_traffic();
+    
+    system_monitor_record_output(OUTPUT_SINK_BLE, origin_timestamp);
     return ESP_OK;
 }
 
@@ -333,8 +624,10 @@ esp_err_t ble_service_send_status(uint8_t battery_level, uint8_t state, uint8_t
     buffer[2] = error;
     
     // Send notification
+    CYCLE_TRACE_BEGIN(CYCLE_TRACE_BLE_SEND);
     esp_err_t ret = esp_ble_gatts_send_indicate(gatts_if, conn_id, status_char_handle, 
                                                sizeof(buffer), buffer, false);
+    CYCLE_TRACE_END(CYCLE_TRACE_BLE_SEND);
     if (ret) {
         ESP_LOGW(TAG, "Failed to send status notification: %s", esp_err_to_name(ret));
         return ret;
@@ -349,8 +642,8 @@ esp_err_t ble_service_send_debug(const char *data) {
     }
     
     size_t len = strlen(data);
-    if (len > BLE_MTU_SIZE - 3) {
-        len = BLE_MTU_SIZE - 3;  // Limit to MTU size minus ATT headers
+    if (len > ble_service_get_payload_size()) {
+        len = ble_service_get_payload_size();  // Limit to MTU size minus ATT headers
     }
     
     // Send notification
@@ -364,6 +657,94 @@ esp_err_t ble_service_send_debug(const char *data) {
     return ESP_OK;
 }
 
+esp_err_t ble_service_send_telemetry(const uint8_t *data, size_t length) {
+    if (data == NULL || length == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!is_connected || !telemetry_notify_enable) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    // One index byte per chunk, the rest of the payload is snapshot
+    size_t chunk_size = ble_service_get_payload_size() - 1;
+    size_t chunks = (length + chunk_size - 1) / chunk_size;
+    if (chunks >= BLE_TELEMETRY_LAST_CHUNK) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    
+    static uint8_t packet[BLE_MTU_SIZE];
+    for (size_t i = 0; i < chunks; i++) {
+        size_t offset = i * chunk_size;
+        size_t len = (length - offset < chunk_size) ? length - offset : chunk_size;
+        
+        packet[0] = (uint8_t)i | ((i == chunks - 1) ? BLE_TELEMETRY_LAST_CHUNK : 0);
+        memcpy(&packet[1], data + offset, len);
+        
+        esp_err_t ret = esp_ble_gatts_send_indicate(gatts_if, conn_id, telemetry_char_handle,
+                                                   len + 1, packet, false);
+        if (ret) {
+            ESP_LOGW(TAG, "Failed to send telemetry chunk %u: %s", (unsigned)i, esp_err_to_name(ret));
+            return ret;
+        }
+    }
+    
+    note_traffic();
+    return ESP_OK;
+}
+
+bool ble_service_stream_enabled(void) {
+    return is_connected && stream_notify_enable;
+}
+
+bool ble_service_is_congested(void) {
+    return congested;
+}
+
+esp_err_t ble_service_send_stream(const uint8_t *data, size_t length) {
+    if (!is_connected || !stream_notify_enable) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    CYCLE_TRACE_BEGIN(CYCLE_TRACE_BLE_SEND);
+    esp_err_t ret = esp_ble_gatts_send_indicate(gatts_if, conn_id, stream_char_handle,
+                                               length, (uint8_t *)data, false);
+    CYCLE_TRACE_END(CYCLE_TRACE_BLE_SEND);
+    if (ret) {
+        return ret;
+    }
+    
+    return ESP_OK;
+}
+
+esp_err_t ble_service_register_stream_callback(ble_stream_callback_t callback) {
+    stream_callback = callback;
+    return ESP_OK;
+}
+
+esp_err_t ble_service_send_transfer(const uint8_t *data, size_t length) {
+    if (data == NULL || length == 0 || length > ble_service_get_payload_size()) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!is_connected || !transfer_notify_enable) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    esp_err_t ret = esp_ble_gatts_send_indicate(gatts_if, conn_id, transfer_char_handle,
+                                               length, (uint8_t *)data, false);
+    if (ret) {
+        ESP_LOGW(TAG, "Failed to send transfer status: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    note_traffic();
+    return ESP_OK;
+}
+
+esp_err_t ble_service_register_transfer_callback(ble_transfer_callback_t callback) {
+    transfer_callback = callback;
+    return ESP_OK;
+}
+
 esp_err_t ble_service_process_command(const uint8_t *data, size_t length) {
     if (data == NULL || length == 0) {
         return ESP_ERR_INVALID_ARG;
@@ -389,6 +770,69 @@ esp_err_t ble_service_register_command_callback(ble_command_callback_t callback)
 
 // Private function implementations
 
+// Forget what the client was sent; names and text start over
+static void reset_client_state(void) {
+    portENTER_CRITICAL(&batch_lock);
+    batch_len = 0;
+    portEXIT_CRITICAL(&batch_lock);
+    
+    memset(announced_names, 0, sizeof(announced_names));
+    text_sent_len = 0;
+}
+
+// Ask the central for the parameters of a mode; on failure the previous
+// mode is restored so the policy tries again
+static bool request_link(link_mode_t mode) {
+    esp_ble_conn_update_params_t conn_params = {0};
+    
+    portENTER_CRITICAL(&link_lock);
+    memcpy(conn_params.bda, peer_bda, sizeof(esp_bd_addr_t));
+    portEXIT_CRITICAL(&link_lock);
+    
+    if (mode == LINK_FAST) {
+        conn_params.min_int = BLE_LINK_FAST_MIN_INT;
+        conn_params.max_int = BLE_LINK_FAST_MAX_INT;
+        conn_params.latency = 0;
+    } else {
+        conn_params.min_int = BLE_LINK_SLOW_MIN_INT;
+        conn_params.max_int = BLE_LINK_SLOW_MAX_INT;
+        conn_params.latency = BLE_LINK_SLOW_LATENCY;
+    }
+    conn_params.timeout = BLE_LINK_TIMEOUT;
+    
+    esp_err_t ret = esp_ble_gap_update_conn_params(&conn_params);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to request %s connection parameters: %s",
+                 (mode == LINK_FAST) ? "fast" : "slow", esp_err_to_name(ret));
+        portENTER_CRITICAL(&link_lock);
+        if (link_mode == mode) {
+            link_mode = (mode == LINK_FAST) ? LINK_SLOW : LINK_FAST;
+            last_traffic_ms = esp_timer_get_time() / 1000;
+        }
+        portEXIT_CRITICAL(&link_lock);
+        return false;
+    }
+    
+    return true;
+}
+
+// Something went out to the client: keep the link fast, or make it fast again
+static void note_traffic(void) {
+    uint32_t now_ms = esp_timer_get_time() / 1000;
+    
+    portENTER_CRITICAL(&link_lock);
+    last_traffic_ms = now_ms;
+    bool go_fast = (link_mode == LINK_SLOW);
+    if (go_fast) {
+        link_mode = LINK_FAST;
+    }
+    portEXIT_CRITICAL(&link_lock);
+    
+    if (go_fast) {
+        request_link(LINK_FAST);
+    }
+}
+
 static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param) {
     switch (event) {
         case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
@@ -413,7 +857,10 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
             break;
             
         case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
-            ESP_LOGI(TAG, "BLE connection parameters updated");
+            // Interval in units of 1.25 ms; results are batched over one
+            conn_interval_ms = param->update_conn_params.conn_int * 5 / 4;
+            ESP_LOGI(TAG, "BLE connection parameters updated, interval %lu ms, latency %u",
+                     (unsigned long)conn_interval_ms, param->update_conn_params.latency);
             break;
             
         default:
@@ -490,6 +937,18 @@ static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_
             command_uuid.len = ESP_UUID_LEN_16;
             command_uuid.uuid.uuid16 = GATTS_CHAR_UUID_COMMAND;
             
+            esp_bt_uuid_t stream_uuid;
+            stream_uuid.len = ESP_UUID_LEN_16;
+            stream_uuid.uuid.uuid16 = GATTS_CHAR_UUID_STREAM;
+            
+            esp_bt_uuid_t telemetry_uuid;
+            telemetry_uuid.len = ESP_UUID_LEN_16;
+            telemetry_uuid.uuid.uuid16 = GATTS_CHAR_UUID_TELEMETRY;
+            
+            esp_bt_uuid_t transfer_uuid;
+            transfer_uuid.len = ESP_UUID_LEN_16;
+            transfer_uuid.uuid.uuid16 = GATTS_CHAR_UUID_TRANSFER;
+            
             // Add characteristics
             esp_ble_gatts_add_char(service_handle, &gesture_uuid, ESP_GATT_PERM_READ, 
                                  CHAR_PROP_READ | CHAR_PROP_NOTIFY,
@@ -511,6 +970,18 @@ static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_
                                  CHAR_PROP_WRITE,
                                  NULL, NULL);
             
+            esp_ble_gatts_add_char(service_handle, &stream_uuid, ESP_GATT_PERM_READ, 
+                                 CHAR_PROP_NOTIFY,
+                                 NULL, NULL);
+            
+            esp_ble_gatts_add_char(service_handle, &telemetry_uuid, ESP_GATT_PERM_READ, 
+                                 CHAR_PROP_NOTIFY,
+                                 NULL, NULL);
+            
+            esp_ble_gatts_add_char(service_handle, &transfer_uuid, ESP_GATT_PERM_WRITE, 
+                                 CHAR_PROP_WRITE_NR | CHAR_PROP_NOTIFY,
+                                 NULL, NULL);
+            
             // Start service
             esp_ble_gatts_start_service(service_handle);
             
@@ -554,6 +1025,15 @@ static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_
                 case GATTS_CHAR_UUID_COMMAND:
                     command_char_handle = param->add_char.attr_handle;
                     break;
+                case GATTS_CHAR_UUID_STREAM:
+                    stream_char_handle = param->add_char.attr_handle;
+                    break;
+                case GATTS_CHAR_UUID_TELEMETRY:
+                    telemetry_char_handle = param->add_char.attr_handle;
+                    break;
+                case GATTS_CHAR_UUID_TRANSFER:
+                    transfer_char_handle = param->add_char.attr_handle;
+                    break;
                 default:
                     break;
             }
@@ -567,28 +1047,42 @@ static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_
             ESP_LOGI(TAG, "BLE client connected, conn_id: %d", param->connect.conn_id);
             is_connected = true;
             conn_id = param->connect.conn_id;
+            att_mtu = BLE_DEFAULT_MTU;
+            conn_interval_ms = param->connect.conn_params.interval * 5 / 4;
+            reset_client_state();
             
-            // Update connection parameters
-            esp_ble_conn_update_params_t conn_params = {0};
-            memcpy(conn_params.bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
-            conn_params.latency = 0;
-            conn_params.max_int = 0x20;    // Max connection interval: 40ms
-            conn_params.min_int = 0x10;    // Min connection interval: 20ms
-            conn_params.timeout = 400;     // Supervision timeout: 4s
+            // Start fast for discovery and subscriptions; idle time slows it down
+            portENTER_CRITICAL(&link_lock);
+            memcpy(peer_bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+            link_mode = LINK_FAST;
+            last_traffic_ms = esp_timer_get_time() / 1000;
+            portEXIT_CRITICAL(&link_lock);
             
-            esp_ble_gap_update_conn_params(&conn_params);
+            request_link(LINK_FAST);
             break;
             
         case ESP_GATTS_DISCONNECT_EVT:
             ESP_LOGI(TAG, "BLE client disconnected, reason: %d", param->disconnect.reason);
             is_connected = false;
             conn_id = 0xFFFF;
+            xTimerStop(batch_timer, 0);
+            
+            portENTER_CRITICAL(&link_lock);
+            link_mode = LINK_NONE;
+            portEXIT_CRITICAL(&link_lock);
             
             // Reset notification flags
             gesture_notify_enable = false;
             text_notify_enable = false;
             status_notify_enable = false;
             debug_notify_enable = false;
+            stream_notify_enable = false;
+            telemetry_notify_enable = false;
+            transfer_notify_enable = false;
+            congested = false;
+            if (stream_callback != NULL) {
+                stream_callback();
+            }
             
             // Restart advertising
             esp_ble_gap_start_advertising(&adv_params);
@@ -604,9 +1098,15 @@ static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_
                 // Determine which characteristic is being configured for notifications
                 if (param->write.handle == gesture_char_handle + 1) { // +1 for descriptor
                     gesture_notify_enable = (descr_value == 0x0001);
+                    if (gesture_notify_enable) {
+                        // The client gets every name before any result
+                        name_table_requested = true;
+                        xTimerChangePeriod(batch_timer, 1, 0);
+                    }
                     ESP_LOGI(TAG, "Gesture notifications %s", gesture_notify_enable ? "enabled" : "disabled");
                 } else if (param->write.handle == text_char_handle + 1) {
                     text_notify_enable = (descr_value == 0x0001);
+                    text_sent_len = 0;
                     ESP_LOGI(TAG, "Text notifications %s", text_notify_enable ? "enabled" : "disabled");
                 } else if (param->write.handle == status_char_handle + 1) {
                     status_notify_enable = (descr_value == 0x0001);
@@ -614,6 +1114,26 @@ static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_
                 } else if (param->write.handle == debug_char_handle + 1) {
                     debug_notify_enable = (descr_value == 0x0001);
                     ESP_LOGI(TAG, "Debug notifications %s", debug_notify_enable ? "enabled" : "disabled");
+                } else if (param->write.handle == stream_char_handle + 1) {
+                    stream_notify_enable = (descr_value == 0x0001);
+                    ESP_LOGI(TAG, "Stream notifications %s", stream_notify_enable ? "enabled" : "disabled");
+                    note_traffic();
+                    if (stream_callback != NULL) {
+                        stream_callback();
+                    }
+                } else if (param->write.handle == telemetry_char_handle + 1) {
+                    telemetry_notify_enable = (descr_value == 0x0001);
+                    ESP_LOGI(TAG, "Telemetry notifications %s", telemetry_notify_enable ? "enabled" : "disabled");
+                } else if (param->write.handle == transfer_char_handle + 1) {
+                    transfer_notify_enable = (descr_value == 0x0001);
+                    ESP_LOGI(TAG, "Transfer notifications %s", transfer_notify_enable ? "enabled" : "disabled");
+                }
+            }
+            // Image chunks; copied out by the callback, written to flash elsewhere
+            else if (param->write.handle == transfer_char_handle && !param->write.is_prep) {
+                note_traffic();
+                if (transfer_callback != NULL) {
+                    transfer_callback(param->write.value, param->write.len);
                 }
             }
             // Check if this is a command write
@@ -623,6 +1143,18 @@ static void gatts_profile_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_
             }
             break;
             
+        case ESP_GATTS_MTU_EVT:
+            ESP_LOGI(TAG, "MTU negotiated: %d", param->mtu.mtu);
+            att_mtu = param->mtu.mtu;
+            break;
+            
+        case ESP_GATTS_CONGEST_EVT:
+            congested = param->congest.congested;
+            if (!congested && stream_callback != NULL) {
+                stream_callback();
+            }
+            break;
+            
         case ESP_GATTS_READ_EVT:
             ESP_LOGI(TAG, "READ_EVT, handle: %d", param->read.handle);
             break;
@@ -4,6 +4,7 @@
 #include "esp_err.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * @brief BLE service notification types
@@ -12,9 +13,45 @@ typedef enum {
     BLE_NOTIFY_GESTURE, // Recognized gesture notification
     BLE_NOTIFY_TEXT,    // Generated text notification
     BLE_NOTIFY_STATUS,  // System status notification
-    BLE_NOTIFY_DEBUG    // Debug information notification
+    BLE_NOTIFY_DEBUG,   // Debug information notification
+    BLE_NOTIFY_STREAM,  // Raw sensor frame stream
+    BLE_NOTIFY_TELEMETRY, // Telemetry snapshot chunks
+    BLE_NOTIFY_TRANSFER  // Image transfer progress
 } ble_notification_type_t;
 
+/**
+ * @brief Packet types on the gesture characteristic (first byte)
+ *
+ * Every gesture name goes out when the client subscribes, a few at a
+ * time. A result whose name the client does not hold yet, or
+ * whose name changed since, is preceded by that name:
+ *
+ *   BLE_GESTURE_PACKET_NAME | id | length | name[length]
+ *
+ * Results are coalesced over one connection interval and packed up to the
+ * negotiated ATT MTU:
+ *
+ *   BLE_GESTURE_PACKET_RESULTS | timestamp_ms (u32) | ble_gesture_record_t...
+ *
+ * The timestamp is the sample time of the first result; each record holds
+ * its time since the one before. Multi-byte fields are little-endian.
+ */
+#define BLE_TELEMETRY_LAST_CHUNK   0x80    // Flag on the chunk index of the last chunk
+
+typedef enum {
+    BLE_GESTURE_PACKET_NAME = 0x01,
+    BLE_GESTURE_PACKET_RESULTS = 0x02
+} ble_gesture_packet_t;
+
+/**
+ * @brief One result in a BLE_GESTURE_PACKET_RESULTS notification
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t gesture_id;          // ID of an announced name
+    uint8_t confidence;          // 0-255 for 0-1
+    uint16_t delta_ms;           // Since the previous result (0 for the first), saturating
+} ble_gesture_record_t;
+
 /**
  * @brief Initialize BLE service
  * 
@@ -51,23 +88,47 @@ esp_err_t ble_service_disable(void);
  */
 esp_err_t ble_service_is_connected(bool *connected);
 
+/**
+ * @brief Apply the connection parameter policy
+ *
+ * The fast interval (BLE_LINK_FAST_*) is requested on connect and as soon
+ * as results or text are sent again, from the sending task. This drops to
+ * the slow interval with slave latency (BLE_LINK_SLOW_*) once nothing was
+ * sent and the sensor stream was off for BLE_LINK_IDLE_MS. Only for the
+ * communication task; call it again within the returned time.
+ *
+ * @return Milliseconds until the policy needs another look, UINT32_MAX if not before the next traffic
+ */
+uint32_t ble_service_update_link(void);
+
 /**
  * @brief Send gesture data over BLE
  * 
+ * The result is batched with the others of the same connection interval
+ * (see ble_gesture_packet_t). Its name is only sent if the client does
+ * not hold it yet.
+ * 
  * @param gesture_id Gesture ID
  * @param gesture_name Gesture name
  * @param confidence Confidence level (0-1)
+ * @param timestamp_ms Sample time of the gesture
  * @return ESP_OK on success, error code otherwise
  */
-esp_err_t ble_service_send_gesture(uint8_t gesture_id, const char *gesture_name, float confidence);
+esp_err_t ble_service_send_gesture(uint8_t gesture_id, const char *gesture_name, float confidence,
+                                   uint32_t timestamp_ms);
 
 /**
  * @brief Send recognized text over BLE
  * 
+ * Only the change is sent: a byte giving how many leading characters of
+ * the previous text to keep, then the characters to append. The first
+ * text after subscribing keeps 0.
+ * 
  * @param text Text to send
+ * @param origin_timestamp Sample time of the gesture behind the text, 0 if none
  * @return ESP_OK on success, error code otherwise
  */
-esp_err_t ble_service_send_text(const char *text);
+esp_err_t ble_service_send_text(const char *text, uint32_t origin_timestamp);
 
 /**
  * @brief Send system status over BLE
@@ -87,6 +148,87 @@ esp_err_t ble_service_send_status(uint8_t battery_level, uint8_t state, uint8_t
  */
 esp_err_t ble_service_send_debug(const char *data);
 
+/**
+ * @brief Send a telemetry snapshot over BLE
+ * 
+ * The snapshot goes out on the telemetry characteristic in as many
+ * notifications as the MTU needs, each starting with its chunk index;
+ * BLE_TELEMETRY_LAST_CHUNK is set on the last one. A client rebuilds the
+ * snapshot by appending the chunks in index order.
+ * 
+ * @param data Snapshot, see core/telemetry.h
+ * @param length Snapshot length in bytes
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if nobody is subscribed, error code otherwise
+ */
+esp_err_t ble_service_send_telemetry(const uint8_t *data, size_t length);
+
+/**
+ * @brief Check if a client is subscribed to the sensor stream
+ * 
+ * @return true if stream notifications are enabled
+ */
+bool ble_service_stream_enabled(void);
+
+/**
+ * @brief Check if the stack is refusing notifications for now
+ * 
+ * Follows the stack's congestion events.
+ * 
+ * @return true while congested
+ */
+bool ble_service_is_congested(void);
+
+/**
+ * @brief Get the largest notification payload on the current connection
+ * 
+ * @return ATT MTU minus the notification header
+ */
+size_t ble_service_get_payload_size(void);
+
+/**
+ * @brief Send one packet on the sensor stream characteristic
+ * 
+ * Never retried; on failure the caller keeps its data for a later try.
+ * 
+ * @param data Packet, at most ble_service_get_payload_size() bytes
+ * @param length Packet length
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not subscribed, error code otherwise
+ */
+esp_err_t ble_service_send_stream(const uint8_t *data, size_t length);
+
+/**
+ * @brief Register callback for sensor stream flow control
+ * 
+ * Called from the Bluetooth task when the stream is subscribed or
+ * unsubscribed and when congestion clears. Must not block.
+ * 
+ * @param callback Function pointer to callback
+ * @return ESP_OK on success, error code otherwise
+ */
+typedef void (*ble_stream_callback_t)(void);
+esp_err_t ble_service_register_stream_callback(ble_stream_callback_t callback);
+
+/**
+ * @brief Send a status packet on the image transfer characteristic
+ * 
+ * @param data Packet, see communication/image_transfer.h
+ * @param length Packet length, at most ble_service_get_payload_size()
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not subscribed, error code otherwise
+ */
+esp_err_t ble_service_send_transfer(const uint8_t *data, size_t length);
+
+/**
+ * @brief Register callback for image transfer writes
+ * 
+ * Called from the Bluetooth task with each write to the transfer
+ * characteristic. Must copy the data and return without blocking.
+ * 
+ * @param callback Function pointer to callback
+ * @return ESP_OK on success, error code otherwise
+ */
+typedef void (*ble_transfer_callback_t)(const uint8_t *data, size_t length);
+esp_err_t ble_service_register_transfer_callback(ble_transfer_callback_t callback);
+
 /**
  * @brief Process received BLE command
  * 
@@ -0,0 +1,501 @@
+#include "communication/hand_link.h"
+#include <string.h>
+#include <stddef.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_event.h"
+#include "esp_mac.h"
+#include "esp_wifi.h"
+#include "esp_now.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "config/system_config.h"
+#include "config/memory_layout.h"
+#include "core/telemetry.h"
+#include "processing/feature_layout.h"
+#include "processing/template_matcher.h"
+
+static const char *TAG = "HAND_LINK";
+
+#define HAND_LINK_PAIR_ID   ((uint8_t)CONFIG_GLOVE_HAND_LINK_PAIR_ID)
+
+typedef struct __attribute__((packed)) {
+    hand_link_header_t header;
+    int64_t t1;                  // Request sent, secondary clock
+} sync_req_packet_t;
+
+typedef struct __attribute__((packed)) {
+    hand_link_header_t header;
+    int64_t t1;                  // Echoed from the request
+    int64_t t2;                  // Request received, primary clock
+    int64_t t3;                  // Reply sent, primary clock
+} sync_resp_packet_t;
+
+typedef struct __attribute__((packed)) {
+    hand_link_header_t header;
+    uint32_t timestamp_ms;       // Sample time, primary clock
+    uint8_t flags;               // HAND_LINK_FRAME_*
+    uint8_t count;               // Features that follow
+    int16_t features[GESTURE_HAND_FEATURES];
+} features_packet_t;
+
+_Static_assert(sizeof(features_packet_t) <= ESP_NOW_MAX_DATA_LEN, "Hand features do not fit one ESP-NOW packet");
+
+// Work the receive callback hands to the link task
+typedef enum {
+    LINK_EVENT_SYNC_REQ = 0,     // Primary: answer a sync request
+    LINK_EVENT_PEER              // Secondary: the primary answered from this address
+} link_event_type_t;
+
+typedef struct {
+    link_event_type_t type;
+    uint8_t mac[ESP_NOW_ETH_ALEN];
+    int64_t t1;
+    int64_t t2;
+} link_event_t;
+
+// One received frame of the second hand
+typedef struct {
+    uint32_t timestamp_ms;
+    uint8_t flags;
+    uint8_t count;
+    int16_t features[GESTURE_HAND_FEATURES];
+} link_frame_t;
+
+static const uint8_t broadcast_mac[ESP_NOW_ETH_ALEN] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+static bool hand_link_initialized = false;
+static QueueHandle_t event_queue = NULL;
+static TaskHandle_t link_task_handle = NULL;
+STATIC_TASK_STORAGE(link_task, HAND_LINK_TASK_STACK_SIZE);
+STATIC_QUEUE_STORAGE(event_queue, HAND_LINK_QUEUE_SIZE, sizeof(link_event_t));
+
+// Normalization of the hand's features, the layout defaults on both gloves
+static float feature_offset[GESTURE_HAND_FEATURES];
+static float feature_inv_scale[GESTURE_HAND_FEATURES];
+static float feature_unit[GESTURE_HAND_FEATURES];   // Raw value of one Q15 step
+
+// Everything below is shared with the Wi-Fi task's receive callback
+static portMUX_TYPE link_lock = portMUX_INITIALIZER_UNLOCKED;
+static hand_link_status_t link_status;
+static uint8_t peer_mac[ESP_NOW_ETH_ALEN];
+
+// Secondary: clock sync samples and the request in flight
+static struct {
+    int64_t offset_us;
+    uint32_t rtt_us;
+} sync_samples[HAND_LINK_SYNC_SAMPLES];
+static uint8_t sync_next = 0;
+static uint8_t sync_count = 0;
+static int64_t pending_t1 = 0;
+
+// Primary: newest frames of the second hand, oldest first from frame_head
+static link_frame_t frames[HAND_LINK_FRAME_DEPTH];
+static uint8_t frame_head = 0;
+static uint8_t frame_count = 0;
+
+// Secondary: local sample time of the last frame sent
+static uint32_t last_sent_ms = 0;
+static uint8_t tx_sequence = 0;
+
+static void fill_header(hand_link_header_t *header, hand_link_msg_t type) {
+    header->type = type;
+    header->version = HAND_LINK_PROTOCOL_VERSION;
+    header->pair_id = HAND_LINK_PAIR_ID;
+    header->sequence = tx_sequence++;
+}
+
+static esp_err_t add_peer(const uint8_t *mac) {
+    if (esp_now_is_peer_exist(mac)) {
+        return ESP_OK;
+    }
+
+    esp_now_peer_info_t peer = {
+        .channel = 0,            // The channel Wi-Fi is on
+        .ifidx = WIFI_IF_STA,
+        .encrypt = false,
+    };
+    memcpy(peer.peer_addr, mac, ESP_NOW_ETH_ALEN);
+    return esp_now_add_peer(&peer);
+}
+
+#if GLOVE_HAND_SECONDARY
+// Keep a sync sample and take the offset of the fastest recent round trip
+static void add_sync_sample(int64_t offset_us, uint32_t rtt_us) {
+    sync_samples[sync_next].offset_us = offset_us;
+    sync_samples[sync_next].rtt_us = rtt_us;
+    sync_next = (sync_next + 1) % HAND_LINK_SYNC_SAMPLES;
+    if (sync_count < HAND_LINK_SYNC_SAMPLES) {
+        sync_count++;
+    }
+
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < sync_count; i++) {
+        if (sync_samples[i].rtt_us < sync_samples[best].rtt_us) {
+            best = i;
+        }
+    }
+    link_status.offset_us = sync_samples[best].offset_us;
+    link_status.rtt_us = sync_samples[best].rtt_us;
+    link_status.synced = true;
+}
+
+static void receive_sync_resp(const uint8_t *mac, const sync_resp_packet_t *resp, int64_t t4) {
+    bool new_peer = false;
+
+    taskENTER_CRITICAL(&link_lock);
+    // Only the request in flight: a late reply to an older one has waited somewhere
+    if (resp->t1 == pending_t1 && t4 >= resp->t1) {
+        pending_t1 = 0;
+        int64_t offset = ((resp->t2 - resp->t1) + (resp->t3 - t4)) / 2;
+        int64_t rtt = (t4 - resp->t1) - (resp->t3 - resp->t2);
+        add_sync_sample(offset, (rtt > 0) ? (uint32_t)rtt : 0);
+        if (!link_status.peer_known) {
+            memcpy(peer_mac, mac, ESP_NOW_ETH_ALEN);
+            link_status.peer_known = true;
+            new_peer = true;
+        }
+    }
+    taskEXIT_CRITICAL(&link_lock);
+
+    if (new_peer) {
+        link_event_t event = { .type = LINK_EVENT_PEER };
+        memcpy(event.mac, mac, ESP_NOW_ETH_ALEN);
+        xQueueSend(event_queue, &event, 0);
+    }
+}
+
+#else
+static void receive_features(const features_packet_t *packet, int len) {
+    if (packet->count == 0 || packet->count > GESTURE_HAND_FEATURES ||
+        len != (int)(offsetof(features_packet_t, features) + packet->count * sizeof(int16_t))) {
+        taskENTER_CRITICAL(&link_lock);
+        link_status.frames_rejected++;
+        taskEXIT_CRITICAL(&link_lock);
+        telemetry_count_drop(TELEMETRY_DROP_HAND_FRAME);
+        return;
+    }
+
+    taskENTER_CRITICAL(&link_lock);
+    const link_frame_t *newest = (frame_count > 0) ?
+        &frames[(frame_head + frame_count - 1) % HAND_LINK_FRAME_DEPTH] : NULL;
+    if (newest != NULL && (int32_t)(packet->timestamp_ms - newest->timestamp_ms) <= 0) {
+        // Resampling needs the frames in time order
+        link_status.frames_rejected++;
+        telemetry_count_drop(TELEMETRY_DROP_HAND_FRAME);
+    } else {
+        uint8_t slot = (frame_head + frame_count) % HAND_LINK_FRAME_DEPTH;
+        if (frame_count < HAND_LINK_FRAME_DEPTH) {
+            frame_count++;
+        } else {
+            frame_head = (frame_head + 1) % HAND_LINK_FRAME_DEPTH;
+        }
+        frames[slot].timestamp_ms = packet->timestamp_ms;
+        frames[slot].flags = packet->flags;
+        frames[slot].count = packet->count;
+        memcpy(frames[slot].features, packet->features, packet->count * sizeof(int16_t));
+        link_status.frames_received++;
+        link_status.last_frame_ms = packet->timestamp_ms;
+        link_status.peer_known = true;
+    }
+    taskEXIT_CRITICAL(&link_lock);
+}
+#endif
+
+// Runs in the Wi-Fi task: stamp, check and hand off, nothing slow
+static void on_receive(const esp_now_recv_info_t *info, const uint8_t *data, int len) {
+    int64_t now = esp_timer_get_time();
+
+    if (info == NULL || data == NULL || len < (int)sizeof(hand_link_header_t)) {
+        return;
+    }
+
+    const hand_link_header_t *header = (const hand_link_header_t *)data;
+    if (header->pair_id != HAND_LINK_PAIR_ID || header->version != HAND_LINK_PROTOCOL_VERSION) {
+        return;
+    }
+
+#if GLOVE_HAND_PRIMARY
+    if (header->type == HAND_LINK_MSG_SYNC_REQ && len == sizeof(sync_req_packet_t)) {
+        link_event_t event = { .type = LINK_EVENT_SYNC_REQ, .t2 = now };
+        memcpy(event.mac, info->src_addr, ESP_NOW_ETH_ALEN);
+        memcpy(&event.t1, &((const sync_req_packet_t *)data)->t1, sizeof(event.t1));
+        xQueueSend(event_queue, &event, 0);
+    } else if (header->type == HAND_LINK_MSG_FEATURES && len >= (int)offsetof(features_packet_t, features)) {
+        receive_features((const features_packet_t *)data, len);
+    }
+#else
+    if (header->type == HAND_LINK_MSG_SYNC_RESP && len == sizeof(sync_resp_packet_t)) {
+        receive_sync_resp(info->src_addr, (const sync_resp_packet_t *)data, now);
+    }
+#endif
+}
+
+#if GLOVE_HAND_SECONDARY
+static void send_sync_request(void) {
+    sync_req_packet_t req;
+    fill_header(&req.header, HAND_LINK_MSG_SYNC_REQ);
+
+    // Broadcast until the primary has answered, then straight to it
+    uint8_t dest[ESP_NOW_ETH_ALEN];
+    taskENTER_CRITICAL(&link_lock);
+    memcpy(dest, link_status.peer_known ? peer_mac : broadcast_mac, ESP_NOW_ETH_ALEN);
+    req.t1 = esp_timer_get_time();
+    pending_t1 = req.t1;
+    taskEXIT_CRITICAL(&link_lock);
+
+    esp_err_t ret = esp_now_send(dest, (const uint8_t *)&req, sizeof(req));
+    if (ret != ESP_OK) {
+        ESP_LOGD(TAG, "Sync request not sent: %s", esp_err_to_name(ret));
+    }
+}
+#endif
+
+static void link_task(void *arg) {
+    ESP_LOGI(TAG, "Hand link task started (%s, pair %u, channel %d)",
+             GLOVE_HAND_PRIMARY ? "primary" : "secondary", HAND_LINK_PAIR_ID, CONFIG_GLOVE_HAND_LINK_CHANNEL);
+
+#if GLOVE_HAND_SECONDARY
+    int64_t next_sync_us = 0;
+#endif
+
+    while (1) {
+        TickType_t wait = portMAX_DELAY;
+#if GLOVE_HAND_SECONDARY
+        // Quick rounds until the sample window is full, then a slow refresh for drift
+        int64_t now = esp_timer_get_time();
+        if (now >= next_sync_us) {
+            send_sync_request();
+            uint32_t period_ms = (sync_count < HAND_LINK_SYNC_SAMPLES) ? HAND_LINK_SYNC_FAST_MS
+                                                                       : HAND_LINK_SYNC_PERIOD_MS;
+            next_sync_us = now + (int64_t)period_ms * 1000;
+        }
+        wait = pdMS_TO_TICKS((next_sync_us - now) / 1000 + 1);
+#endif
+
+        link_event_t event;
+        if (xQueueReceive(event_queue, &event, wait) != pdTRUE) {
+            continue;
+        }
+
+        esp_err_t ret = add_peer(event.mac);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Cannot add peer: %s", esp_err_to_name(ret));
+            continue;
+        }
+
+        if (event.type == LINK_EVENT_PEER) {
+            ESP_LOGI(TAG, "Primary found at " MACSTR, MAC2STR(event.mac));
+            continue;
+        }
+
+        taskENTER_CRITICAL(&link_lock);
+        bool first = !link_status.peer_known;
+        link_status.peer_known = true;
+        taskEXIT_CRITICAL(&link_lock);
+        if (first) {
+            ESP_LOGI(TAG, "Secondary found at " MACSTR, MAC2STR(event.mac));
+        }
+
+        // t3 as late as possible, so only the radio is left between it and the air
+        sync_resp_packet_t resp;
+        fill_header(&resp.header, HAND_LINK_MSG_SYNC_RESP);
+        resp.t1 = event.t1;
+        resp.t2 = event.t2;
+        resp.t3 = esp_timer_get_time();
+        esp_now_send(event.mac, (const uint8_t *)&resp, sizeof(resp));
+    }
+}
+
+static esp_err_t start_radio(void) {
+    // ESP-NOW needs Wi-Fi running, not connected
+    esp_err_t ret = esp_event_loop_create_default();
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        return ret;
+    }
+
+    wifi_init_config_t config = WIFI_INIT_CONFIG_DEFAULT();
+    ret = esp_wifi_init(&config);
+    if (ret == ESP_OK) {
+        ret = esp_wifi_set_storage(WIFI_STORAGE_RAM);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_wifi_set_mode(WIFI_MODE_STA);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_wifi_start();
+    }
+    if (ret == ESP_OK) {
+        ret = esp_wifi_set_channel(CONFIG_GLOVE_HAND_LINK_CHANNEL, WIFI_SECOND_CHAN_NONE);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_now_init();
+    }
+    if (ret == ESP_OK) {
+        ret = esp_now_register_recv_cb(on_receive);
+    }
+    if (ret == ESP_OK) {
+        ret = add_peer(broadcast_mac);
+    }
+    return ret;
+}
+
+esp_err_t hand_link_init(void) {
+    if (hand_link_initialized) {
+        return ESP_OK;
+    }
+
+    for (uint16_t i = 0; i < GESTURE_HAND_FEATURES; i++) {
+        float scale = feature_layout_scale(i);
+        feature_offset[i] = feature_layout_offset(i);
+        feature_inv_scale[i] = 1.0f / scale;
+        feature_unit[i] = scale / TEMPLATE_MATCHER_Q15_PER_UNIT;
+    }
+
+    event_queue = STATIC_QUEUE_CREATE(event_queue, HAND_LINK_QUEUE_SIZE, sizeof(link_event_t));
+    if (event_queue == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = start_radio();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start ESP-NOW: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    link_task_handle = STATIC_TASK_CREATE_PINNED(link_task, "hand_link", HAND_LINK_TASK_STACK_SIZE,
+                                                 NULL, HAND_LINK_TASK_PRIORITY, HAND_LINK_TASK_CORE);
+    if (link_task_handle == NULL) {
+        ESP_LOGE(TAG, "Failed to create hand link task");
+        esp_now_deinit();
+        return ESP_FAIL;
+    }
+
+    hand_link_initialized = true;
+    return ESP_OK;
+}
+
+bool hand_link_keepalive_due(uint32_t now_ms) {
+    return (uint32_t)(now_ms - last_sent_ms) >= HAND_LINK_KEEPALIVE_MS;
+}
+
+esp_err_t hand_link_send_features(const feature_vector_t *features, bool idle) {
+    if (features == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!GLOVE_HAND_SECONDARY || !hand_link_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t dest[ESP_NOW_ETH_ALEN];
+    int64_t offset_us;
+    taskENTER_CRITICAL(&link_lock);
+    bool synced = link_status.synced;
+    offset_us = link_status.offset_us;
+    memcpy(dest, peer_mac, ESP_NOW_ETH_ALEN);
+    taskEXIT_CRITICAL(&link_lock);
+
+    if (!synced) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    features_packet_t packet;
+    uint16_t count = (features->feature_count < GESTURE_HAND_FEATURES) ? features->feature_count
+                                                                       : GESTURE_HAND_FEATURES;
+    if (count == 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Q15 against the layout scales: half the size of floats, same steps as the matcher's
+    int16_t row[TEMPLATE_MATCHER_STRIDE(GESTURE_HAND_FEATURES)];
+    template_matcher_pack_row_q15(features->features, feature_offset, feature_inv_scale, count, row);
+
+    fill_header(&packet.header, HAND_LINK_MSG_FEATURES);
+    packet.timestamp_ms = (uint32_t)(((int64_t)features->timestamp * 1000 + offset_us) / 1000);
+    packet.flags = idle ? HAND_LINK_FRAME_IDLE : 0;
+    packet.count = (uint8_t)count;
+    memcpy(packet.features, row, count * sizeof(int16_t));
+
+    last_sent_ms = features->timestamp;
+    esp_err_t ret = esp_now_send(dest, (const uint8_t *)&packet,
+                                 offsetof(features_packet_t, features) + count * sizeof(int16_t));
+    if (ret != ESP_OK) {
+        telemetry_count_drop(TELEMETRY_DROP_HAND_FRAME);
+        return ret;
+    }
+
+    taskENTER_CRITICAL(&link_lock);
+    link_status.frames_sent++;
+    taskEXIT_CRITICAL(&link_lock);
+    return ESP_OK;
+}
+
+esp_err_t hand_link_get_features(uint32_t timestamp_ms, float *features) {
+    if (features == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Copy the frames around the time out of the ring, resample outside the lock
+    link_frame_t before = {0}, after = {0};
+    bool have_before = false, have_after = false;
+
+    taskENTER_CRITICAL(&link_lock);
+    for (uint8_t i = 0; i < frame_count; i++) {
+        const link_frame_t *frame = &frames[(frame_head + i) % HAND_LINK_FRAME_DEPTH];
+        if ((int32_t)(frame->timestamp_ms - timestamp_ms) <= 0) {
+            before = *frame;
+            have_before = true;
+        } else {
+            after = *frame;
+            have_after = true;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&link_lock);
+
+    if (!have_before && !have_after) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Nothing newer yet, the usual case: hold the newest pose while it is fresh
+    if (!have_after) {
+        uint32_t age = timestamp_ms - before.timestamp_ms;
+        uint32_t stale = (before.flags & HAND_LINK_FRAME_IDLE) ? 2 * HAND_LINK_KEEPALIVE_MS : HAND_LINK_STALE_MS;
+        if (age > stale) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        after = before;
+    } else if (!have_before) {
+        // Older than everything kept: the oldest frame is the nearest
+        before = after;
+    }
+
+    float weight = 0.0f;
+    if (after.timestamp_ms != before.timestamp_ms) {
+        weight = (float)(timestamp_ms - before.timestamp_ms) / (float)(after.timestamp_ms - before.timestamp_ms);
+    }
+
+    for (uint16_t i = 0; i < GESTURE_HAND_FEATURES; i++) {
+        if (i >= before.count || i >= after.count) {
+            features[i] = feature_offset[i];
+            continue;
+        }
+        float q = before.features[i] + weight * (after.features[i] - before.features[i]);
+        features[i] = q * feature_unit[i] + feature_offset[i];
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t hand_link_get_status(hand_link_status_t *status) {
+    if (status == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    taskENTER_CRITICAL(&link_lock);
+    *status = link_status;
+    taskEXIT_CRITICAL(&link_lock);
+    return ESP_OK;
+}
@@ -0,0 +1,127 @@
+#ifndef COMMUNICATION_HAND_LINK_H
+#define COMMUNICATION_HAND_LINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "util/buffer.h"
+
+/**
+ * @brief ESP-NOW link between the two gloves of a pair
+ *
+ * The secondary glove extracts the instantaneous features of its hand
+ * (flex, IMU and touch, GESTURE_HAND_FEATURES values) and sends them to
+ * the primary, which recognizes signs from both hands. Both gloves start
+ * Wi-Fi in station mode on CONFIG_GLOVE_HAND_LINK_CHANNEL without joining
+ * a network; only packets carrying the same pair ID are taken.
+ *
+ * The secondary finds the primary by broadcasting clock sync requests and
+ * talks to it directly once one is answered. Sync is NTP-style: the
+ * secondary stamps the request (t1), the primary its arrival (t2) and its
+ * reply (t3), the secondary the reply's arrival (t4), all on esp_timer.
+ * The clock offset ((t2 - t1) + (t3 - t4)) / 2 is taken from the fastest
+ * round trip of the last HAND_LINK_SYNC_SAMPLES, where queuing in either
+ * stack skewed the least. Frames are stamped on the primary's clock before
+ * they are sent.
+ *
+ * Packets, all little-endian, after hand_link_header_t:
+ *
+ *   SYNC_REQ    t1 (i64)
+ *   SYNC_RESP   t1, t2, t3 (i64)
+ *   FEATURES    timestamp_ms (u32, primary clock) | flags | count | q15[count]
+ *
+ * Features are normalized with the default layout scales and sent in Q15,
+ * so both gloves must run the same feature layout.
+ */
+
+#define HAND_LINK_PROTOCOL_VERSION  1
+
+/**
+ * @brief Packet types
+ */
+typedef enum {
+    HAND_LINK_MSG_SYNC_REQ = 0x01,
+    HAND_LINK_MSG_SYNC_RESP = 0x02,
+    HAND_LINK_MSG_FEATURES = 0x03
+} hand_link_msg_t;
+
+// Flags of a FEATURES packet
+#define HAND_LINK_FRAME_IDLE        (1u << 0)   // Hand at rest, a keepalive of its pose
+
+/**
+ * @brief Header of every packet
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t type;                // hand_link_msg_t
+    uint8_t version;             // HAND_LINK_PROTOCOL_VERSION
+    uint8_t pair_id;             // CONFIG_GLOVE_HAND_LINK_PAIR_ID
+    uint8_t sequence;            // Per sender, wraps
+} hand_link_header_t;
+
+/**
+ * @brief Link figures, for logs and telemetry
+ */
+typedef struct {
+    bool peer_known;             // Other glove heard since boot
+    bool synced;                 // Secondary: clock offset known
+    int64_t offset_us;           // Secondary: primary clock minus local clock
+    uint32_t rtt_us;             // Secondary: round trip of the sample in use
+    uint32_t frames_sent;
+    uint32_t frames_received;
+    uint32_t frames_rejected;    // Wrong layout or out of order
+    uint32_t last_frame_ms;      // Primary: time of the newest frame, 0 if none
+} hand_link_status_t;
+
+/**
+ * @brief Start Wi-Fi and ESP-NOW and the link task
+ *
+ * Only built in two-hand roles. NVS must be initialized.
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t hand_link_init(void);
+
+/**
+ * @brief Check whether the secondary should send a keepalive frame
+ *
+ * While the hand rests, the secondary sends its pose every
+ * HAND_LINK_KEEPALIVE_MS so the primary always holds a recent one.
+ *
+ * @param now_ms Sample time of the current frame, local clock
+ * @return true if a frame is due
+ */
+bool hand_link_keepalive_due(uint32_t now_ms);
+
+/**
+ * @brief Send this hand's features to the primary (secondary only)
+ *
+ * @param features Feature vector from feature_extraction_process()
+ * @param idle Whether the hand is at rest
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE before the clock is
+ *         synced, error code otherwise
+ */
+esp_err_t hand_link_send_features(const feature_vector_t *features, bool idle);
+
+/**
+ * @brief Get the second hand's features at a sample time (primary only)
+ *
+ * Interpolated between the received frames around the time, or the newest
+ * frame held while it is younger than HAND_LINK_STALE_MS (twice
+ * HAND_LINK_KEEPALIVE_MS for a hand at rest). Features the secondary did
+ * not have are set to their layout offset.
+ *
+ * @param timestamp_ms Sample time, primary clock
+ * @param features Output raw feature values (GESTURE_HAND_FEATURES values)
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no usable frame
+ */
+esp_err_t hand_link_get_features(uint32_t timestamp_ms, float *features);
+
+/**
+ * @brief Get the link figures
+ *
+ * @param status Pointer to store the figures
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t hand_link_get_status(hand_link_status_t *status);
+
+#endif /* COMMUNICATION_HAND_LINK_H */
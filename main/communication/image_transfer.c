@@ -0,0 +1,268 @@
+#include "communication/image_transfer.h"
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "image_slots.h"
+#include "ml_inference.h"
+#include "config/system_config.h"
+#include "config/memory_layout.h"
+#include "core/telemetry.h"
+#include "communication/ble_service.h"
+#include "processing/template_enroll.h"
+#include "gesture_templates.h"
+
+static const char *TAG = "IMAGE_TRANSFER";
+
+// One client write, as copied out of the Bluetooth task
+typedef struct {
+    uint16_t length;
+    uint8_t data[IMAGE_TRANSFER_CHUNK_MAX];
+} transfer_chunk_t;
+
+// The transfer in progress
+typedef struct {
+    bool active;
+    image_transfer_target_t target;
+    uint8_t slot;                // Idle slot being written
+    uint32_t crc32;              // Expected CRC32 of the whole image
+    image_slot_writer_t writer;
+    uint16_t unacked;            // Chunks written since the last ACK
+    bool resend_sent;            // RESEND sent for the current gap
+} transfer_t;
+
+static transfer_t transfer;
+static image_transfer_status_t last_result;   // Answer to a repeated END
+
+static QueueHandle_t chunk_queue = NULL;
+static TaskHandle_t transfer_task_handle = NULL;
+STATIC_TASK_STORAGE(transfer_task, IMAGE_TRANSFER_STACK_SIZE);
+
+// Only busy during a transfer, so queued in PSRAM
+static MEM_BULK uint8_t chunk_queue_storage[IMAGE_TRANSFER_QUEUE_SIZE * sizeof(transfer_chunk_t)];
+static StaticQueue_t chunk_queue_buffer;
+
+static void send_status(image_transfer_event_t event, image_transfer_error_t error) {
+    image_transfer_status_t status = {
+        .event = event,
+        .error = error,
+        .window = IMAGE_TRANSFER_QUEUE_SIZE,
+        .offset = transfer.writer.written
+    };
+    if (event == IMAGE_TRANSFER_EVENT_DONE || event == IMAGE_TRANSFER_EVENT_FAILED) {
+        last_result = status;
+    }
+    ble_service_send_transfer((const uint8_t *)&status, sizeof(status));
+}
+
+static void fail(image_transfer_error_t error) {
+    transfer.active = false;
+    send_status(IMAGE_TRANSFER_EVENT_FAILED, error);
+}
+
+static image_transfer_error_t flash_error(esp_err_t ret) {
+    switch (ret) {
+        case ESP_ERR_INVALID_SIZE:
+            return IMAGE_TRANSFER_ERR_SIZE;
+        case ESP_ERR_INVALID_CRC:
+            return IMAGE_TRANSFER_ERR_CHECKSUM;
+        default:
+            return IMAGE_TRANSFER_ERR_FLASH;
+    }
+}
+
+// Partition and idle slot of a target
+static esp_err_t find_slot(image_transfer_target_t target, const esp_partition_t **partition, uint8_t *slot) {
+    switch (target) {
+        case IMAGE_TRANSFER_TARGET_TEMPLATES:
+            return gesture_templates_get_update_slot(partition, slot);
+        case IMAGE_TRANSFER_TARGET_MODEL_STATIC:
+            return ml_inference_get_update_slot(ML_MODEL_STATIC_GESTURES, partition, slot);
+        case IMAGE_TRANSFER_TARGET_MODEL_DYNAMIC:
+            return ml_inference_get_update_slot(ML_MODEL_DYNAMIC_GESTURES, partition, slot);
+        default:
+            return ESP_ERR_NOT_FOUND;
+    }
+}
+
+static void begin(const transfer_chunk_t *chunk) {
+    image_transfer_begin_t request;
+    if (chunk->length < sizeof(request)) {
+        fail(IMAGE_TRANSFER_ERR_SIZE);
+        return;
+    }
+    memcpy(&request, chunk->data, sizeof(request));
+
+    // A new BEGIN drops whatever was in progress; the slot is idle either way
+    memset(&transfer, 0, sizeof(transfer));
+
+    const esp_partition_t *partition = NULL;
+    if (find_slot((image_transfer_target_t)request.target, &partition, &transfer.slot) != ESP_OK) {
+        fail(IMAGE_TRANSFER_ERR_TARGET);
+        return;
+    }
+
+    esp_err_t ret = image_slot_writer_begin(&transfer.writer, partition, transfer.slot, request.size);
+    if (ret != ESP_OK) {
+        fail(flash_error(ret));
+        return;
+    }
+
+    transfer.active = true;
+    transfer.target = (image_transfer_target_t)request.target;
+    transfer.crc32 = request.crc32;
+    ESP_LOGI(TAG, "Receiving %lu bytes for slot %u of '%s'", (unsigned long)request.size,
+             transfer.slot, partition->label);
+    send_status(IMAGE_TRANSFER_EVENT_READY, IMAGE_TRANSFER_OK);
+}
+
+static void data(const transfer_chunk_t *chunk) {
+    image_transfer_data_t header;
+    if (!transfer.active || chunk->length < sizeof(header)) {
+        return;
+    }
+    memcpy(&header, chunk->data, sizeof(header));
+
+    // Writes after a lost one are ignored until the client goes back to it
+    if (header.offset != transfer.writer.written) {
+        if (header.offset > transfer.writer.written && !transfer.resend_sent) {
+            transfer.resend_sent = true;
+            transfer.unacked = 0;
+            send_status(IMAGE_TRANSFER_EVENT_RESEND, IMAGE_TRANSFER_OK);
+        }
+        return;
+    }
+    transfer.resend_sent = false;
+
+    esp_err_t ret = image_slot_writer_write(&transfer.writer, chunk->data + sizeof(header),
+                                            chunk->length - sizeof(header));
+    if (ret != ESP_OK) {
+        fail(flash_error(ret));
+        return;
+    }
+
+    if (++transfer.unacked >= IMAGE_TRANSFER_ACK_CHUNKS) {
+        transfer.unacked = 0;
+        send_status(IMAGE_TRANSFER_EVENT_ACK, IMAGE_TRANSFER_OK);
+    }
+}
+
+// Switch the target to the new slot; each owner checks the image and
+// keeps the old one if it does not load
+static esp_err_t activate(image_transfer_target_t target, uint8_t slot) {
+    switch (target) {
+        case IMAGE_TRANSFER_TARGET_TEMPLATES:
+            return template_enroll_activate_pack(slot);
+        case IMAGE_TRANSFER_TARGET_MODEL_STATIC:
+            return ml_inference_activate_slot(ML_MODEL_STATIC_GESTURES, slot);
+        case IMAGE_TRANSFER_TARGET_MODEL_DYNAMIC:
+            return ml_inference_activate_slot(ML_MODEL_DYNAMIC_GESTURES, slot);
+        default:
+            return ESP_ERR_NOT_FOUND;
+    }
+}
+
+static void end(void) {
+    if (!transfer.active) {
+        if (last_result.event != 0) {
+            ble_service_send_transfer((const uint8_t *)&last_result, sizeof(last_result));
+        } else {
+            fail(IMAGE_TRANSFER_ERR_STATE);
+        }
+        return;
+    }
+
+    esp_err_t ret = image_slot_writer_finish(&transfer.writer, transfer.crc32);
+    if (ret != ESP_OK) {
+        fail(flash_error(ret));
+        return;
+    }
+
+    ret = activate(transfer.target, transfer.slot);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Received image not activated: %s", esp_err_to_name(ret));
+        fail(IMAGE_TRANSFER_ERR_REJECTED);
+        return;
+    }
+
+    transfer.active = false;
+    ESP_LOGI(TAG, "Image active from slot %u", transfer.slot);
+    send_status(IMAGE_TRANSFER_EVENT_DONE, IMAGE_TRANSFER_OK);
+}
+
+// Writes at flash speed, below the recognition pipeline; the classifier
+// keeps matching the active slot throughout
+static void transfer_task(void *arg) {
+    // Received by copy, so the Bluetooth task can queue the next chunk meanwhile
+    static transfer_chunk_t chunk;
+
+    while (1) {
+        if (xQueueReceive(chunk_queue, &chunk, portMAX_DELAY) != pdTRUE || chunk.length == 0) {
+            continue;
+        }
+
+        switch (chunk.data[0]) {
+            case IMAGE_TRANSFER_OP_BEGIN:
+                begin(&chunk);
+                break;
+            case IMAGE_TRANSFER_OP_DATA:
+                data(&chunk);
+                break;
+            case IMAGE_TRANSFER_OP_END:
+                end();
+                break;
+            case IMAGE_TRANSFER_OP_ABORT:
+                if (transfer.active) {
+                    ESP_LOGW(TAG, "Transfer aborted at %lu bytes", (unsigned long)transfer.writer.written);
+                    fail(IMAGE_TRANSFER_ERR_ABORTED);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// Bluetooth task: copy the write and get out of the way
+static void on_transfer_write(const uint8_t *data, size_t length) {
+    static transfer_chunk_t incoming;
+
+    if (length == 0 || length > sizeof(incoming.data)) {
+        return;
+    }
+
+    incoming.length = length;
+    memcpy(incoming.data, data, length);
+    if (telemetry_queue_send(TELEMETRY_QUEUE_IMAGE_TRANSFER, &incoming, 0) != pdTRUE) {
+        telemetry_count_drop(TELEMETRY_DROP_TRANSFER_CHUNK);
+    }
+}
+
+esp_err_t image_transfer_init(void) {
+    if (chunk_queue != NULL) {
+        return ESP_OK;
+    }
+
+    chunk_queue = xQueueCreateStatic(IMAGE_TRANSFER_QUEUE_SIZE, sizeof(transfer_chunk_t),
+                                     chunk_queue_storage, &chunk_queue_buffer);
+    if (chunk_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create chunk queue");
+        return ESP_ERR_NO_MEM;
+    }
+    telemetry_register_queue(TELEMETRY_QUEUE_IMAGE_TRANSFER, chunk_queue);
+
+    transfer_task_handle = STATIC_TASK_CREATE_PINNED(transfer_task, "image_transfer", IMAGE_TRANSFER_STACK_SIZE,
+                                                     NULL, IMAGE_TRANSFER_PRIORITY, IMAGE_TRANSFER_CORE);
+    if (transfer_task_handle == NULL) {
+        ESP_LOGE(TAG, "Failed to create transfer task");
+        telemetry_register_queue(TELEMETRY_QUEUE_IMAGE_TRANSFER, NULL);
+        vQueueDelete(chunk_queue);
+        chunk_queue = NULL;
+        return ESP_FAIL;
+    }
+
+    ble_service_register_transfer_callback(on_transfer_write);
+    ESP_LOGI(TAG, "Image transfer ready");
+    return ESP_OK;
+}
@@ -0,0 +1,121 @@
+#ifndef COMMUNICATION_IMAGE_TRANSFER_H
+#define COMMUNICATION_IMAGE_TRANSFER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief Template pack and model updates over BLE
+ *
+ * A client streams a whole template image (data/gesture_templates.h) or
+ * model image (ml_inference.h) to the transfer characteristic (0x2A24).
+ * Each write is copied into a queue by the Bluetooth task; a task of its
+ * own writes the chunks straight into the idle image slot of the target
+ * partition (image_slots.h), checksumming as it goes, so nothing larger
+ * than a chunk is ever buffered and recognition keeps running on the
+ * active slot. Once the image is complete and intact, the slot is
+ * activated and mapped in place of the old one, with no reboot.
+ *
+ * Client writes (write without response), first byte the opcode, all
+ * multi-byte fields little-endian:
+ *
+ *   BEGIN   target (u8) | size (u32) | crc32 (u32)
+ *   DATA    offset (u32) | bytes
+ *   END
+ *   ABORT
+ *
+ * The glove answers with image_transfer_status_t notifications. READY
+ * answers BEGIN with the window: the client keeps at most that many DATA
+ * writes past the last acknowledged offset. ACK comes every
+ * IMAGE_TRANSFER_ACK_CHUNKS writes with the bytes written so far. A write
+ * that was lost (the queue was full) shows up as a gap in the offsets and
+ * is answered once with RESEND and the offset to go on from; writes before
+ * it are ignored. END is answered with DONE once the new image is active,
+ * or FAILED with the reason, after which the old image stays active. A
+ * BEGIN or END that gets no answer can be repeated: BEGIN starts over, an
+ * END after the transfer finished repeats its answer.
+ */
+
+/**
+ * @brief Opcodes of client writes
+ */
+typedef enum {
+    IMAGE_TRANSFER_OP_BEGIN = 0x01,
+    IMAGE_TRANSFER_OP_DATA = 0x02,
+    IMAGE_TRANSFER_OP_END = 0x03,
+    IMAGE_TRANSFER_OP_ABORT = 0x04
+} image_transfer_op_t;
+
+/**
+ * @brief Images that can be transferred
+ */
+typedef enum {
+    IMAGE_TRANSFER_TARGET_TEMPLATES = 0,     // Template pack, "templates" partition
+    IMAGE_TRANSFER_TARGET_MODEL_STATIC,      // Model image, "model_static" partition
+    IMAGE_TRANSFER_TARGET_MODEL_DYNAMIC,     // Model image, "model_dynamic" partition
+    IMAGE_TRANSFER_TARGET_COUNT
+} image_transfer_target_t;
+
+/**
+ * @brief Events notified to the client
+ */
+typedef enum {
+    IMAGE_TRANSFER_EVENT_READY = 0x01,       // Transfer started, offset 0
+    IMAGE_TRANSFER_EVENT_ACK = 0x02,         // Bytes written so far
+    IMAGE_TRANSFER_EVENT_RESEND = 0x03,      // Write lost, go on from offset
+    IMAGE_TRANSFER_EVENT_DONE = 0x04,        // New image active
+    IMAGE_TRANSFER_EVENT_FAILED = 0x05       // Transfer over, old image still active
+} image_transfer_event_t;
+
+/**
+ * @brief Reasons for a FAILED event
+ */
+typedef enum {
+    IMAGE_TRANSFER_OK = 0,
+    IMAGE_TRANSFER_ERR_TARGET,               // Unknown target or partition missing
+    IMAGE_TRANSFER_ERR_SIZE,                 // Image does not fit a slot, or is incomplete
+    IMAGE_TRANSFER_ERR_FLASH,                // Erase or write failed
+    IMAGE_TRANSFER_ERR_CHECKSUM,             // CRC32 of the received image does not match
+    IMAGE_TRANSFER_ERR_REJECTED,             // Image intact but did not load
+    IMAGE_TRANSFER_ERR_STATE,                // END or DATA without a transfer
+    IMAGE_TRANSFER_ERR_ABORTED               // Client aborted
+} image_transfer_error_t;
+
+/**
+ * @brief Header of a BEGIN write
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t op;                  // IMAGE_TRANSFER_OP_BEGIN
+    uint8_t target;              // image_transfer_target_t
+    uint32_t size;               // Image size in bytes
+    uint32_t crc32;              // CRC32 (little-endian) of the whole image
+} image_transfer_begin_t;
+
+/**
+ * @brief Header of a DATA write, the image bytes follow
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t op;                  // IMAGE_TRANSFER_OP_DATA
+    uint32_t offset;             // Offset of the bytes in the image
+} image_transfer_data_t;
+
+/**
+ * @brief Notification sent to the client
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t event;               // image_transfer_event_t
+    uint8_t error;               // image_transfer_error_t, IMAGE_TRANSFER_OK unless FAILED
+    uint8_t window;              // DATA writes the client may have unacknowledged
+    uint32_t offset;             // Bytes written in order so far
+} image_transfer_status_t;
+
+/**
+ * @brief Create the chunk queue and transfer task and hook the characteristic
+ *
+ * The template store and the BLE service must be initialized.
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t image_transfer_init(void);
+
+#endif /* COMMUNICATION_IMAGE_TRANSFER_H */
@@ -0,0 +1,64 @@
+#ifndef MEMORY_LAYOUT_H
+#define MEMORY_LAYOUT_H
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+/**
+ * @brief Placement of long-lived memory
+ *
+ * Queues, task stacks and pipeline buffers are reserved at link time
+ * instead of taken from the heap, so the memory map is fixed at build
+ * time and cannot fragment however long the glove runs.
+ */
+
+/* Memory regions */
+#define MEM_HOT     // Internal DRAM (the default for .bss): sample path, pools, queues, stacks
+
+#if CONFIG_SPIRAM_ALLOW_BSS_SEG_EXTERNAL_MEMORY
+#define MEM_BULK    EXT_RAM_BSS_ATTR    // PSRAM: large, read at frame rate or slower
+#else
+#define MEM_BULK                        // No PSRAM .bss in this build, stays internal
+#endif
+
+/**
+ * @brief Reserve a stack and control block for a static task
+ *
+ * Declares fn_stack and fn_tcb for the task function fn. Stacks stay in
+ * internal DRAM: tasks touching flash must not run on a PSRAM stack.
+ */
+#define STATIC_TASK_STORAGE(fn, stack_size)                                 \
+    static StackType_t fn##_stack[(stack_size)] __attribute__((aligned(16))); \
+    static StaticTask_t fn##_tcb
+
+/**
+ * @brief Reserve the storage and control block for a static queue
+ *
+ * Declares name_storage and name_queue for xQueueCreateStatic.
+ */
+#define STATIC_QUEUE_STORAGE(name, length, item_size)                       \
+    static uint8_t name##_storage[(length) * (item_size)] __attribute__((aligned(4))); \
+    static StaticQueue_t name##_queue
+
+/**
+ * @brief Create a queue in storage reserved with STATIC_QUEUE_STORAGE
+ *
+ * @return Queue handle, NULL on failure
+ */
+#define STATIC_QUEUE_CREATE(name, length, item_size) \
+    xQueueCreateStatic((length), (item_size), name##_storage, &name##_queue)
+
+/**
+ * @brief Create a pinned task in storage reserved with STATIC_TASK_STORAGE
+ *
+ * @return Task handle, NULL on failure
+ */
+#define STATIC_TASK_CREATE_PINNED(fn, label, stack_size, arg, priority, core) \
+    xTaskCreateStaticPinnedToCore(fn, (label), (stack_size), (arg), (priority), \
+                                  fn##_stack, &fn##_tcb, (core))
+
+#endif /* MEMORY_LAYOUT_H */
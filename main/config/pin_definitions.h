@@ -8,18 +8,18 @@
 /* Flex Sensors ADC Pins (10 sensors, 2 per finger) */
 #define FLEX_SENSOR_ADC_UNIT               ADC_UNIT_1
 #define FLEX_SENSOR_ADC_ATTENUATION        ADC_ATTEN_DB_11
-#define FLEX_SENSOR_ADC_BIT_WIDTH          ADC_WIDTH_BIT_12
+#define FLEX_SENSOR_ADC_BIT_WIDTH          ADC_BITWIDTH_12
 
-#define FLEX_SENSOR_THUMB_MCP_ADC_CHANNEL  ADC1_CHANNEL_0   // GPIO1
-#define FLEX_SENSOR_THUMB_PIP_ADC_CHANNEL  ADC1_CHANNEL_1   // GPIO2
-#define FLEX_SENSOR_INDEX_MCP_ADC_CHANNEL  ADC1_CHANNEL_2   // GPIO3
-#define FLEX_SENSOR_INDEX_PIP_ADC_CHANNEL  ADC1_CHANNEL_3   // GPIO4
-#define FLEX_SENSOR_MIDDLE_MCP_ADC_CHANNEL ADC1_CHANNEL_4   // GPIO5
-#define FLEX_SENSOR_MIDDLE_PIP_ADC_CHANNEL ADC1_CHANNEL_5   // GPIO6
-#define FLEX_SENSOR_RING_MCP_ADC_CHANNEL   ADC1_CHANNEL_6   // GPIO7
-#define FLEX_SENSOR_RING_PIP_ADC_CHANNEL   ADC1_CHANNEL_7   // GPIO8
-#define FLEX_SENSOR_PINKY_MCP_ADC_CHANNEL  ADC1_CHANNEL_8   // GPIO9
-#define FLEX_SENSOR_PINKY_PIP_ADC_CHANNEL  ADC1_CHANNEL_9   // GPIO10
+#define FLEX_SENSOR_THUMB_MCP_ADC_CHANNEL  ADC_CHANNEL_0    // GPIO1
+#define FLEX_SENSOR_THUMB_PIP_ADC_CHANNEL  ADC_CHANNEL_1    // GPIO2
+#define FLEX_SENSOR_INDEX_MCP_ADC_CHANNEL  ADC_CHANNEL_2    // GPIO3
+#define FLEX_SENSOR_INDEX_PIP_ADC_CHANNEL  ADC_CHANNEL_3    // GPIO4
+#define FLEX_SENSOR_MIDDLE_MCP_ADC_CHANNEL ADC_CHANNEL_4    // GPIO5
+#define FLEX_SENSOR_MIDDLE_PIP_ADC_CHANNEL ADC_CHANNEL_5    // GPIO6
+#define FLEX_SENSOR_RING_MCP_ADC_CHANNEL   ADC_CHANNEL_6    // GPIO7
+#define FLEX_SENSOR_RING_PIP_ADC_CHANNEL   ADC_CHANNEL_7    // GPIO8
+#define FLEX_SENSOR_PINKY_MCP_ADC_CHANNEL  ADC_CHANNEL_8    // GPIO9
+#define FLEX_SENSOR_PINKY_PIP_ADC_CHANNEL  ADC_CHANNEL_9    // GPIO10
 
 /* IMU (MPU6050) I2C Pins */
 #define I2C_MASTER_NUM              I2C_NUM_0
@@ -63,9 +63,9 @@
 /* Haptic Feedback Motor Pin */
 #define HAPTIC_PIN                  23
 
-/* Battery Monitoring Pin */
-#define BATTERY_ADC_CHANNEL         ADC1_CHANNEL_10  // GPIO16
-#define BATTERY_ADC_UNIT            ADC_UNIT_1
+/* Battery Monitoring Pin (ADC1 GPIO1-10 all carry flex sensors) */
+#define BATTERY_ADC_CHANNEL         ADC_CHANNEL_5    // GPIO16
+#define BATTERY_ADC_UNIT            ADC_UNIT_2
 #define BATTERY_ADC_ATTENUATION     ADC_ATTEN_DB_11
 
 /* Power Control Pins */
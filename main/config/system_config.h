@@ -1,29 +1,118 @@
+#ifndef SYSTEM_CONFIG_H
+#define SYSTEM_CONFIG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
 #include "esp_err.h"
+#include "sdkconfig.h"
 
 /**
  * @brief System configuration parameters
  */
 
+/* Sensor and feature set, chosen in menuconfig ("Glove sensor and feature set").
+ * Disabled sensors have no driver, task or feature code in the image. */
+#ifdef CONFIG_GLOVE_SENSOR_TOUCH
+#define GLOVE_HAS_TOUCH             (1)
+#else
+#define GLOVE_HAS_TOUCH             (0)
+#endif
+#ifdef CONFIG_GLOVE_SENSOR_CAMERA
+#define GLOVE_HAS_CAMERA            (1)
+#else
+#define GLOVE_HAS_CAMERA            (0)
+#endif
+#ifdef CONFIG_GLOVE_FEATURE_TOUCH
+#define FEATURE_SET_TOUCH           (1)     // Touch states
+#else
+#define FEATURE_SET_TOUCH           (0)
+#endif
+#ifdef CONFIG_GLOVE_FEATURE_TEMPORAL
+#define FEATURE_SET_TEMPORAL        (1)     // Mean acceleration and joint velocity
+#else
+#define FEATURE_SET_TEMPORAL        (0)
+#endif
+#ifdef CONFIG_GLOVE_FEATURE_AHRS
+#define FEATURE_SET_AHRS            (1)     // Gravity and linear acceleration
+#else
+#define FEATURE_SET_AHRS            (0)
+#endif
+#ifdef CONFIG_GLOVE_FEATURE_WINDOW_STATS
+#define FEATURE_SET_WINDOW_STATS    (1)     // Variance, range and jitter over the window
+#else
+#define FEATURE_SET_WINDOW_STATS    (0)
+#endif
+
+/* Two-hand mode: a secondary glove streams its features to the primary */
+#if defined(CONFIG_GLOVE_HAND_PRIMARY)
+#define GLOVE_HAND_PRIMARY          (1)
+#define GLOVE_HAND_SECONDARY        (0)
+#elif defined(CONFIG_GLOVE_HAND_SECONDARY)
+#define GLOVE_HAND_PRIMARY          (0)
+#define GLOVE_HAND_SECONDARY        (1)
+#else
+#define GLOVE_HAND_PRIMARY          (0)
+#define GLOVE_HAND_SECONDARY        (0)
+#endif
+#define GLOVE_TWO_HAND              (GLOVE_HAND_PRIMARY || GLOVE_HAND_SECONDARY)
+#define FEATURE_SET_SECOND_HAND     (GLOVE_HAND_PRIMARY)    // Second glove's features in the vector
+
 /* Task priorities */
 #define SENSOR_TASK_PRIORITY        (10)
-#define PROCESSING_TASK_PRIORITY    (9)
+#define PROCESSING_TASK_PRIORITY    (9)     // Fusion stage
+#define FEATURE_STAGE_PRIORITY      (9)
+#define CLASSIFY_STAGE_PRIORITY     (9)
 #define OUTPUT_TASK_PRIORITY        (8)
+#define DISPLAY_FLUSH_PRIORITY      (7)     // Sends frames the output task has drawn
 #define COMMUNICATION_TASK_PRIORITY (7)
 #define POWER_TASK_PRIORITY         (6)
+#define CAMERA_TASK_PRIORITY        (5)
+#define HAND_LINK_TASK_PRIORITY     (7)     // Clock sync replies, timestamps must stay tight
+#define TEMPLATE_PERSIST_PRIORITY   (2)     // Writes enrolled templates to flash
+#define IMAGE_TRANSFER_PRIORITY     (2)     // Writes template packs and models received over BLE
+#define SENSOR_STREAM_PRIORITY      (3)     // Streams raw sensor frames over BLE
+#define TRACE_RECORDER_PRIORITY     (1)     // Writes recorded sensor traces to flash
+#define CALIBRATION_TASK_PRIORITY   (2)     // Guides calibration sessions and writes the calibration blob
+#define DEBUG_LOG_PRIORITY          (1)     // Formats deferred debug_log() records
+#define BOOT_STEP_PRIORITY          (5)     // Short-lived tasks running the boot graph
 
 /* Task stack sizes */
 #define SENSOR_TASK_STACK_SIZE        (4096)
-#define PROCESSING_TASK_STACK_SIZE    (8192)
+#define PROCESSING_TASK_STACK_SIZE    (4096)
+#define FEATURE_STAGE_STACK_SIZE      (6144)
+#define CLASSIFY_STAGE_STACK_SIZE     (8192)
 #define OUTPUT_TASK_STACK_SIZE        (4096)
+#define DISPLAY_FLUSH_STACK_SIZE      (2048)
 #define COMMUNICATION_TASK_STACK_SIZE (4096)
 #define POWER_TASK_STACK_SIZE         (2048)
+#define CAMERA_TASK_STACK_SIZE        (3072)
+#define HAND_LINK_TASK_STACK_SIZE     (3072)
+#define TEMPLATE_PERSIST_STACK_SIZE   (4096)
+#define IMAGE_TRANSFER_STACK_SIZE     (6144)  // Maps and warms up activated models
+#define SENSOR_STREAM_STACK_SIZE      (3072)
+#define TRACE_RECORDER_STACK_SIZE     (3072)
+#define CALIBRATION_TASK_STACK_SIZE   (4096)
+#define DEBUG_LOG_STACK_SIZE          (3072)
+#define BOOT_STEP_STACK_SIZE          (6144)  // Freed once the step finishes
 
 /* Core assignments */
 #define SENSOR_TASK_CORE           (0)
-#define PROCESSING_TASK_CORE       (1)
+#define PROCESSING_TASK_CORE       (1)     // Fusion stage
+#define FEATURE_STAGE_CORE         (0)     // Overlaps feature extraction of frame N+1...
+#define CLASSIFY_STAGE_CORE        (1)     // ...with classification of frame N
 #define OUTPUT_TASK_CORE           (1)
+#define DISPLAY_FLUSH_CORE         (1)     // Alongside the output task
 #define COMMUNICATION_TASK_CORE    (0)
 #define POWER_TASK_CORE            (0)
+#define CAMERA_TASK_CORE           (0)
+#define HAND_LINK_TASK_CORE        (0)     // With the Wi-Fi stack
+#define TEMPLATE_PERSIST_CORE      (0)     // Away from the classify stage
+#define IMAGE_TRANSFER_CORE        (0)     // With the Bluetooth stack
+#define SENSOR_STREAM_CORE         (0)     // With the Bluetooth stack
+#define TRACE_RECORDER_CORE        (1)     // Away from the sensor task
+#define CALIBRATION_TASK_CORE      (1)     // Away from the sensor task feeding it
+#define DEBUG_LOG_CORE             (0)     // With the Bluetooth stack it feeds
 
 /* Sampling rates */
 #define FLEX_SENSOR_SAMPLE_RATE_HZ  (50)
@@ -31,22 +120,82 @@
 #define CAMERA_FRAME_RATE_HZ        (15)
 #define TOUCH_SAMPLE_RATE_HZ        (20)
 
+/* Flex sensor acquisition */
+#define FLEX_SENSOR_CONTINUOUS_MODE (1)     // DMA scan instead of one-shot reads
+#define FLEX_SENSOR_OVERSAMPLE      (8)     // Conversions per joint per sample
+
+/* IMU acquisition */
+#define IMU_FIFO_MODE               (1)     // Drain the MPU6050 FIFO on data-ready bursts
+#define IMU_FIFO_BURST_SAMPLES      (4)     // Samples per burst read
+#define IMU_AHRS_BETA               (0.1f)  // Madgwick gain, higher trusts the accelerometer more
+#define IMU_WAKE_MOTION_THRESHOLD   (20)    // MOT_THR counts that wake the glove from sleep, 32 mg per LSB
+#define IMU_WAKE_MOTION_DURATION    (1)     // Samples over the threshold, at the wake sample rate
+#define IMU_WAKE_SAMPLE_RATE        (2)     // LP_WAKE_CTRL while asleep: 0 = 1.25 Hz, 1 = 5 Hz, 2 = 20 Hz, 3 = 40 Hz
+
+/* Camera acquisition */
+#define CAMERA_CAPTURE_GRAYSCALE    (1)     // Capture QQVGA grayscale instead of QVGA RGB565
+#define CAMERA_ROI_POOL_SIZE        (8)     // 32x32 hand ROI slots shared with the pipeline
+
 /* Queue sizes */
 #define SENSOR_QUEUE_SIZE           (10)
 #define PROCESSING_QUEUE_SIZE       (5)
 #define OUTPUT_QUEUE_SIZE           (5)
 #define COMMAND_QUEUE_SIZE          (5)
+#define PIPELINE_RING_DEPTH         (4)     // Frames between processing stages, a power of two
 
 /* Buffer sizes */
 #define FLEX_SENSOR_BUFFER_SIZE     (10)
 #define IMU_BUFFER_SIZE             (20)
-#define FEATURE_BUFFER_SIZE         (100)
+#define FEATURE_BUFFER_SIZE         (GLOVE_HAND_PRIMARY ? 128 : 100)  // The primary of a pair also holds the second hand
+#define HISTORY_WINDOW_SIZE         (128)
+#define WINDOW_STATS_LENGTH         (MAX_GESTURE_DURATION_MS * SENSOR_FUSION_RATE_HZ / 1000)  // Sliding statistics window
+#define WINDOW_STATS_RESEED_SAMPLES (1024)  // Samples between exact recomputes of the running sums
+
+/* Sensor frame pool: frames in the sensor queue, plus one being filled by
+ * the sensor task and one being ingested by fusion */
+#define SENSOR_FRAME_POOL_SIZE      (SENSOR_QUEUE_SIZE + 2)
+
+/* Sensor trace recorder */
+#define TRACE_RECORDER_PATH         "/spiffs/trace.bin"
+#define TRACE_RECORDER_PAGE_SIZE    (4096)  // Bytes per RAM page; two pages are double-buffered
+
+/* Calibration session */
+#define CALIBRATION_SETTLE_MS       (1500)  // Time to get into each pose before sampling starts
+#define CALIBRATION_POSE_MS         (1500)  // Sampling time per pose
+#define CALIBRATION_MAX_SAMPLES     (192)   // Samples kept per channel and pose, at least IMU rate x pose time
+#define CALIBRATION_MIN_SAMPLES     (20)    // Fewer in a pose and the sensor is left as it was
+#define CALIBRATION_TRIM_PERCENT    (10)    // Share of samples dropped at each end before averaging
+#define CALIBRATION_MAX_GYRO_SPREAD (3.0f)  // °/s between the trimmed extremes; more and the hand was moving
+#define CALIBRATION_MIN_JOINT_RANGE (100)   // ADC counts between flat and fist for a joint to be recalibrated
+
+/* Cycle trace points */
+#define CYCLE_TRACE_ENABLED         (0)     // 1 to compile the hot-path trace points in
+#define CYCLE_TRACE_DEPTH           (1024)  // Events kept per core, power of two
+
+/* Deferred debug log */
+#define DEBUG_LOG_RING_RECORDS      (32)    // Records queued per core, power of two, newest dropped when full
+#define DEBUG_LOG_ARG_BYTES         (48)    // Raw argument bytes per record, %s strings included
+#define DEBUG_LOG_FLUSH_MS          (50)    // Longest a record waits before it is formatted
+
+/* Telemetry */
+#define TELEMETRY_MAX_TASKS         (40)    // Tasks one monitor cycle takes in
+#define TELEMETRY_TASK_NAME_LEN     (12)    // Bytes of each task name in a snapshot
+
+/* Sensor fusion alignment */
+#define SENSOR_FUSION_RATE_HZ       (50)    // Rate of aligned frames sent downstream
+#define SENSOR_FUSION_LATENCY_MS    (25)    // Delay behind the newest sample so ticks are bracketed
+#define SENSOR_FUSION_STALE_MS      (250)   // A stream with no newer sample is marked invalid
 
 /* Power management */
 #define BATTERY_LOW_THRESHOLD_MV    (3300)
 #define BATTERY_CRITICAL_MV         (3100)
 #define INACTIVITY_TIMEOUT_SEC      (60)
 #define DEEP_SLEEP_TIMEOUT_SEC      (300)
+#define POWER_GOVERNOR_HOLD_MS      (400)   // Max frequency kept after a stage's last busy frame
+#define POWER_GOVERNOR_BOOST_MS     (2000)  // Max frequency kept after a stage misses its deadline
+#define POWER_DEADLINE_FEATURES_US  (1000000 / SENSOR_FUSION_RATE_HZ)   // One aligned frame period
+#define POWER_DEADLINE_CLASSIFY_US  (1000000 / SENSOR_FUSION_RATE_HZ)
+#define POWER_DEADLINE_OUTPUT_US    (30000) // One result or command
 
 /* Display parameters */
 #define DISPLAY_TIMEOUT_SEC         (30)
@@ -57,15 +206,90 @@
 #define AUDIO_SAMPLE_RATE           (16000)
 #define AUDIO_BUFFER_SIZE           (1024)
 
+/* Speech clips */
+#define SPEECH_CACHE_SLOTS          (8)     // Decoded clips kept in PSRAM
+#define SPEECH_CACHE_MAX_SAMPLES    (16000) // Longest clip worth caching (32 KB per slot)
+#define SPEECH_MAX_CLIPS            (64)    // Clips and gaps in one utterance
+#define SPEECH_WORD_GAP_MS          (60)    // Silence between words
+
+/* Two-hand link (ESP-NOW) */
+#define HAND_LINK_QUEUE_SIZE        (4)     // Sync requests waiting for a reply
+#define HAND_LINK_SYNC_SAMPLES      (8)     // Clock offset is taken from the fastest round trip of these
+#define HAND_LINK_SYNC_PERIOD_MS    (1000)  // Between sync requests once synced
+#define HAND_LINK_SYNC_FAST_MS      (100)   // Between sync requests until the window is full
+#define HAND_LINK_FRAME_DEPTH       (8)     // Second-glove frames kept for interpolation
+#define HAND_LINK_STALE_MS          (60)    // Newest frame is held this long past its time
+#define HAND_LINK_KEEPALIVE_MS      (200)   // Secondary sends at least this often when the gate holds frames
+
 /* Bluetooth LE */
 #define BLE_DEVICE_NAME             "SignLangGlove"
 #define BLE_MAX_CONNECTIONS         (1)
+#define BLE_BATCH_DEFAULT_MS        (30)    // Gesture batching window until the connection interval is known
+#define BLE_NAME_TABLE_BURST        (4)     // Gesture names sent per timer tick after a subscribe
+#define BLE_LINK_FAST_MIN_INT       (6)     // 7.5 ms, in 1.25 ms units, while results or the stream flow
+#define BLE_LINK_FAST_MAX_INT       (12)    // 15 ms
+#define BLE_LINK_SLOW_MIN_INT       (80)    // 100 ms when idle
+#define BLE_LINK_SLOW_MAX_INT       (120)   // 150 ms
+#define BLE_LINK_SLOW_LATENCY       (4)     // Connection events the glove may skip when idle
+#define BLE_LINK_TIMEOUT            (400)   // Supervision timeout, 10 ms units (above 2 x 5 x 150 ms)
+#define BLE_LINK_IDLE_MS            (3000)  // Quiet time before switching to the slow interval
+
+/* Image transfer over BLE */
+#define IMAGE_TRANSFER_QUEUE_SIZE   (16)    // Chunks between the Bluetooth task and flash, also the client's window
+#define IMAGE_TRANSFER_ACK_CHUNKS   (8)     // Chunks written per acknowledgement
+#define IMAGE_TRANSFER_CHUNK_MAX    (497)   // Largest write: the 500-byte MTU less the ATT header
+
+/* Raw sensor stream */
+#define SENSOR_STREAM_MAX_RATE_HZ   (100)   // Frames streamed per second at most
+#define SENSOR_STREAM_BATCH_MS      (20)    // Frames gathered into each notification
+#define SENSOR_STREAM_RING_FRAMES   (64)    // Frames queued under backpressure (power of 2), oldest dropped
 
 /* Gesture recognition */
-#define MAX_GESTURES                (50)
+#define MAX_GESTURES                (200)
 #define CONFIDENCE_THRESHOLD        (0.7f)
 #define MAX_GESTURE_DURATION_MS     (2000)
 #define MIN_GESTURE_DURATION_MS     (200)
+#define GESTURE_MATCH_USE_ESP_DSP   (1)     // Score templates with the esp-dsp dot product (0 = scalar loop)
+#define GESTURE_MATCH_USE_Q15       (1)     // Match normalized Q15 features with integer distances (0 = float)
+#define GESTURE_Q15_RANGE           (8.0f)  // Normalized feature magnitude that maps to Q15 full scale
+#define GESTURE_SEQUENCE_LENGTH     (32)    // Steps in a dynamic gesture's motion sequence
+#define GESTURE_SEQUENCE_CHANNELS   (16)    // Flex angles, gravity and linear acceleration per step
+#define GESTURE_DTW_BAND            (4)     // Sakoe-Chiba band radius in sequence steps
+#define GESTURE_COARSE_DIMS         (10)    // Leading template features (flex angles) in the coarse index
+#define GESTURE_COARSE_TOP_K        (8)     // Candidates the coarse index passes to the full score and DTW
+#define GESTURE_ENROLL_REPETITIONS  (5)     // Repetitions averaged into one enrolled template
+#define GESTURE_ENROLL_SPREAD       (3.0f)  // Multiple of the repetitions' spread an enrolled template accepts
+#define GESTURE_ENROLL_MIN_CONF     (0.4f)  // Floor for thresholds derived from a loose enrollment
+#define GESTURE_ENROLL_QUEUE        (2)     // Enrolled templates waiting to be written to flash
+#define GESTURE_ENROLL_WAIT_MS      (1000)  // Wait for room in the persist queue
+#define GESTURE_VIEW_SPARE_SLOTS    (8)     // Templates a snapshot takes beyond those loaded before it grows
+#define GESTURE_VIEW_READER_WAIT_MS (500)   // Longest a template update waits for the classifier to let go of a snapshot
+#define GESTURE_DECODER_GAIN        (10.0f) // Evidence per frame per unit of score above threshold
+#define GESTURE_DECODER_ENTER       (3.0f)  // Evidence a gesture segment must pay to start
+#define GESTURE_DECODER_COMMIT      (6.0f)  // Evidence at which a running segment is committed early
+#define GESTURE_DECODER_EVENTS      (4)     // Decided segments waiting to be reported
+#define GESTURE_DECODER_MAX_LAG_MS  (1000)  // Longest a finished segment waits before the best path decides it
+
+/* Motion gate in front of feature extraction and matching */
+#define MOTION_GATE_ENABLED         (1)
+#define MOTION_GATE_IMU_THRESHOLD   (5)     // MPU6050 MOT_THR counts, 32 mg per LSB (~1.6 m/s²)
+#define MOTION_GATE_IMU_DURATION    (2)     // Samples above threshold before the interrupt fires
+#define MOTION_GATE_GYRO_DPS        (30.0f) // Angular rate that counts as movement
+#define MOTION_GATE_LINEAR_ACCEL    (1.5f)  // Linear acceleration (m/s²) that counts as movement
+#define MOTION_GATE_FLEX_NOISE_DEG  (2.0f)  // Flex noise floor the pose distance is scaled by
+#define MOTION_GATE_POSE_DISTANCE   (0.4f)  // Mean scaled squared distance at which the pose changed
+#define MOTION_GATE_NOISE_RATE      (0.05f) // Weight of each frame in the flex noise estimate
+#define MOTION_GATE_NOISE_MARGIN    (10.0f) // Multiples of a joint's noise variance added to its distance scale
+#define MOTION_GATE_NOISE_CLIP      (3.0f)  // Flex steps beyond this many sigma are bends, not noise
+#define MOTION_GATE_SETTLE_FRAMES   (25)    // Frames the pose matcher keeps running after a change
+#define MOTION_GATE_DYNAMIC_FRAMES  (50)    // Frames DTW keeps running after movement stops
+#define MOTION_GATE_IDLE_INTERVAL   (50)    // Idle frames between keep-alive pose checks
+
+/* Text generation */
+#define TEXT_SENTENCE_CAPACITY      (128)   // Sentence characters kept, a power of two; older ones scroll out
+#define WORD_DICTIONARY_PATH        "/spiffs/words.txt"  // Word list, one per line, most frequent first
+#define WORD_DICTIONARY_MAX_WORD    (24)    // Letters in the longest dictionary word
+#define WORD_COMPLETION_MIN_PREFIX  (2)     // Letters typed before a completion is offered
 
 /* System states */
 typedef enum {
@@ -125,4 +349,4 @@ esp_err_t system_config_save(void);
 esp_err_t system_config_load(void);
 esp_err_t system_config_reset_to_default(void);
 
-#endif /* SYSTEM_CONFIG_H */#include <stdio.h>
+#endif /* SYSTEM_CONFIG_H */
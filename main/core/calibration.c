@@ -0,0 +1,514 @@
+#include "core/calibration.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "config/system_config.h"
+#include "config/memory_layout.h"
+#include "core/command_bus.h"
+#include "core/telemetry.h"
+#include "core/wake_state.h"
+#include "drivers/flex_sensor.h"
+#include "drivers/imu.h"
+#include "drivers/touch.h"
+
+static const char *TAG = "CALIBRATION";
+
+typedef struct {
+    uint32_t magic;                      // CALIBRATION_BLOB_MAGIC
+    uint16_t version;                    // CALIBRATION_BLOB_VERSION
+    uint16_t size;                       // sizeof(calibration_blob_t)
+    uint32_t sources;                    // CALIBRATION_SOURCE_* held
+    flex_sensor_calibration_t flex;
+    imu_calibration_t imu;
+    touch_calibration_t touch;
+    uint32_t crc32;                      // Over everything before this field
+} calibration_blob_t;
+
+// Engine task notification bits
+#define NOTIFY_START        (1 << 0)
+#define NOTIFY_SAVE         (1 << 1)
+#define NOTIFY_COLLECTED    (1 << 2)
+
+// Who owns the sample buffers: the engine task while idle, the sensor task
+// while a pose is sampled
+enum {
+    COLLECT_IDLE = 0,
+    COLLECT_RUNNING
+};
+
+// Samples of one pose, channel by channel so each sorts in place
+typedef struct {
+    uint16_t flex[FINGER_JOINT_COUNT][CALIBRATION_MAX_SAMPLES];
+    float imu[6][CALIBRATION_MAX_SAMPLES];      // Accel x, y, z in m/s², gyro x, y, z in °/s
+    uint16_t touch[TOUCH_SENSOR_COUNT][CALIBRATION_MAX_SAMPLES];
+    uint16_t flex_count;
+    uint16_t imu_count;
+    uint16_t touch_count;
+    uint32_t last_flex_ms;               // Timestamps of the readings taken last
+    uint32_t last_imu_ms;
+    uint32_t last_touch_ms;
+} pose_samples_t;
+
+static MEM_BULK pose_samples_t samples;
+static atomic_int collect_state = COLLECT_IDLE;
+static int64_t collect_end_us;           // Set before collect_state goes to COLLECT_RUNNING
+static atomic_bool session_running = false;
+static bool save_pending;                // Save requested while a pose was sampled
+
+static TaskHandle_t calibration_task_handle = NULL;
+STATIC_TASK_STORAGE(calibration_task, CALIBRATION_TASK_STACK_SIZE);
+
+static uint32_t blob_crc(const calibration_blob_t *blob) {
+    return esp_rom_crc32_le(0, (const uint8_t *)blob, offsetof(calibration_blob_t, crc32));
+}
+
+#if GLOVE_HAS_TOUCH
+static bool touch_measured(const touch_calibration_t *touch) {
+    for (int i = 0; i < TOUCH_SENSOR_COUNT; i++) {
+        if (touch->baseline[i] == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+// Snapshot the drivers' calibration and write it as the blob
+static esp_err_t write_blob(void) {
+    calibration_blob_t blob = {
+        .magic = CALIBRATION_BLOB_MAGIC,
+        .version = CALIBRATION_BLOB_VERSION,
+        .size = sizeof(calibration_blob_t),
+        .sources = CALIBRATION_SOURCE_FLEX | CALIBRATION_SOURCE_IMU
+    };
+
+    flex_sensor_get_calibration(&blob.flex);
+    imu_get_calibration(&blob.imu);
+#if GLOVE_HAS_TOUCH
+    // Baselines are only known once measured or set
+    if (touch_get_calibration(&blob.touch) == ESP_OK && touch_measured(&blob.touch)) {
+        blob.sources |= CALIBRATION_SOURCE_TOUCH;
+    }
+#endif
+    blob.crc32 = blob_crc(&blob);
+
+    nvs_handle_t nvs_handle;
+    esp_err_t ret = nvs_open(CALIBRATION_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = nvs_set_blob(nvs_handle, CALIBRATION_NVS_KEY, &blob, sizeof(blob));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs_handle);
+    }
+    nvs_close(nvs_handle);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save calibration: %s", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Calibration saved (sources 0x%02lx)", (unsigned long)blob.sources);
+    }
+    return ret;
+}
+
+// One read at boot; anything but an intact blob of this version is ignored
+static esp_err_t load_blob(void) {
+    calibration_blob_t blob;
+    size_t size = sizeof(blob);
+
+    nvs_handle_t nvs_handle;
+    esp_err_t ret = nvs_open(CALIBRATION_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(nvs_handle, CALIBRATION_NVS_KEY, &blob, &size);
+        nvs_close(nvs_handle);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (size != sizeof(blob) || blob.magic != CALIBRATION_BLOB_MAGIC ||
+        blob.version != CALIBRATION_BLOB_VERSION || blob.size != sizeof(blob) ||
+        blob.crc32 != blob_crc(&blob)) {
+        ESP_LOGW(TAG, "Calibration blob damaged or of another version, ignored");
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    if (blob.sources & CALIBRATION_SOURCE_FLEX) {
+        flex_sensor_set_calibration(&blob.flex);
+    }
+    if (blob.sources & CALIBRATION_SOURCE_IMU) {
+        imu_set_calibration(&blob.imu);
+    }
+#if GLOVE_HAS_TOUCH
+    if (blob.sources & CALIBRATION_SOURCE_TOUCH) {
+        touch_set_calibration(&blob.touch);
+    }
+#endif
+
+    ESP_LOGI(TAG, "Calibration loaded (sources 0x%02lx)", (unsigned long)blob.sources);
+    return ESP_OK;
+}
+
+static void prompt(const char *text) {
+    output_command_t cmd = {
+        .type = OUTPUT_CMD_DISPLAY_TEXT,
+        .data.display.clear_first = true,
+        .data.display.line = 0,
+        .data.display.size = 0
+    };
+
+    strncpy(cmd.data.display.text, text, sizeof(cmd.data.display.text) - 1);
+    telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &cmd, 0);
+}
+
+static int compare_u16(const void *a, const void *b) {
+    return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+static int compare_float(const void *a, const void *b) {
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// Mean of the samples left after dropping CALIBRATION_TRIM_PERCENT at each end
+static uint16_t trimmed_mean_u16(uint16_t *values, size_t count) {
+    qsort(values, count, sizeof(uint16_t), compare_u16);
+
+    size_t trim = count * CALIBRATION_TRIM_PERCENT / 100;
+    size_t kept = count - 2 * trim;
+    uint32_t sum = 0;
+    for (size_t i = trim; i < count - trim; i++) {
+        sum += values[i];
+    }
+    return (uint16_t)((sum + kept / 2) / kept);
+}
+
+// As trimmed_mean_u16(); the spread between the extremes kept shows how
+// steady the channel was
+static float trimmed_mean_float(float *values, size_t count, float *spread) {
+    qsort(values, count, sizeof(float), compare_float);
+
+    size_t trim = count * CALIBRATION_TRIM_PERCENT / 100;
+    float sum = 0.0f;
+    for (size_t i = trim; i < count - trim; i++) {
+        sum += values[i];
+    }
+    if (spread != NULL) {
+        *spread = values[count - trim - 1] - values[trim];
+    }
+    return sum / (float)(count - 2 * trim);
+}
+
+// Give the user time to get into a pose, then let the sensor task sample
+// it until the pose time is up
+static esp_err_t collect_pose(const char *instruction) {
+    prompt(instruction);
+    vTaskDelay(pdMS_TO_TICKS(CALIBRATION_SETTLE_MS));
+
+    samples.flex_count = 0;
+    samples.imu_count = 0;
+    samples.touch_count = 0;
+    samples.last_flex_ms = UINT32_MAX;
+    samples.last_imu_ms = UINT32_MAX;
+    samples.last_touch_ms = UINT32_MAX;
+    collect_end_us = esp_timer_get_time() + (int64_t)CALIBRATION_POSE_MS * 1000;
+    atomic_store_explicit(&collect_state, COLLECT_RUNNING, memory_order_release);
+
+    // A save request may wake us early; only the sensor task ends the pose
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(CALIBRATION_POSE_MS + 1000);
+    TickType_t wait = 0;
+    uint32_t events = 0;
+    while (!(events & NOTIFY_COLLECTED)) {
+        TickType_t now = xTaskGetTickCount();
+        if (wait != portMAX_DELAY) {
+            if ((int32_t)(deadline - now) <= 0) {
+                // No frames coming; take the buffers back unless the pose just ended
+                int expected = COLLECT_RUNNING;
+                if (atomic_compare_exchange_strong(&collect_state, &expected, COLLECT_IDLE)) {
+                    return ESP_ERR_TIMEOUT;
+                }
+                wait = portMAX_DELAY;
+            } else {
+                wait = deadline - now;
+            }
+        }
+        xTaskNotifyWait(0, NOTIFY_COLLECTED | NOTIFY_SAVE, &events, wait);
+        if (events & NOTIFY_SAVE) {
+            save_pending = true;
+        }
+    }
+
+    return ESP_OK;
+}
+
+// Flat and still: flex flat values, IMU offsets and touch baselines
+static esp_err_t reduce_rest_pose(flex_sensor_calibration_t *flex, imu_calibration_t *imu,
+                                  touch_calibration_t *touch, uint32_t *sources) {
+    if (samples.flex_count < CALIBRATION_MIN_SAMPLES) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // Movement spoils every average of this pose, so it is checked first
+    if (samples.imu_count >= CALIBRATION_MIN_SAMPLES) {
+        float accel[3];
+        float gyro[3];
+        for (int axis = 0; axis < 3; axis++) {
+            float spread;
+            gyro[axis] = trimmed_mean_float(samples.imu[3 + axis], samples.imu_count, &spread);
+            if (spread > CALIBRATION_MAX_GYRO_SPREAD) {
+                ESP_LOGW(TAG, "Hand moved (gyro axis %d spread %.1f °/s)", axis, spread);
+                return ESP_ERR_INVALID_STATE;
+            }
+            accel[axis] = trimmed_mean_float(samples.imu[axis], samples.imu_count, NULL);
+        }
+
+        if (imu_calibration_from_rest(accel, gyro, imu) == ESP_OK) {
+            *sources |= CALIBRATION_SOURCE_IMU;
+        }
+    } else {
+        ESP_LOGW(TAG, "Too few IMU samples (%u), IMU left as it was", samples.imu_count);
+    }
+
+    for (int joint = 0; joint < FINGER_JOINT_COUNT; joint++) {
+        flex->flat_value[joint] = trimmed_mean_u16(samples.flex[joint], samples.flex_count);
+    }
+
+    if (samples.touch_count >= CALIBRATION_MIN_SAMPLES) {
+        for (int pad = 0; pad < TOUCH_SENSOR_COUNT; pad++) {
+            touch->baseline[pad] = trimmed_mean_u16(samples.touch[pad], samples.touch_count);
+            touch->threshold[pad] = (uint32_t)touch->baseline[pad] * TOUCH_THRESHOLD_PERCENT / 100;
+        }
+        *sources |= CALIBRATION_SOURCE_TOUCH;
+    }
+
+    return ESP_OK;
+}
+
+// Fist: flex bent values, for the joints that actually bent
+static esp_err_t reduce_fist_pose(flex_sensor_calibration_t *flex, const flex_sensor_calibration_t *previous,
+                                  uint32_t *sources) {
+    if (samples.flex_count < CALIBRATION_MIN_SAMPLES) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    int recalibrated = 0;
+    for (int joint = 0; joint < FINGER_JOINT_COUNT; joint++) {
+        uint16_t bent = trimmed_mean_u16(samples.flex[joint], samples.flex_count);
+        int range = abs((int)bent - (int)flex->flat_value[joint]);
+
+        if (range < CALIBRATION_MIN_JOINT_RANGE) {
+            ESP_LOGW(TAG, "Joint %d barely bent (%d counts), keeping its calibration", joint, range);
+            flex->flat_value[joint] = previous->flat_value[joint];
+            flex->bent_value[joint] = previous->bent_value[joint];
+            continue;
+        }
+
+        flex->bent_value[joint] = bent;
+        recalibrated++;
+    }
+
+    if (recalibrated == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    *sources |= CALIBRATION_SOURCE_FLEX;
+    ESP_LOGI(TAG, "%d of %d joints recalibrated", recalibrated, FINGER_JOINT_COUNT);
+    return ESP_OK;
+}
+
+static const char *failure_text(esp_err_t ret) {
+    switch (ret) {
+        case ESP_ERR_TIMEOUT:
+            return "Calibration failed: no sensor data";
+        case ESP_ERR_INVALID_STATE:
+            return "Calibration failed: keep still";
+        case ESP_ERR_NOT_FOUND:
+            return "Calibration failed: no fist";
+        default:
+            return "Calibration failed";
+    }
+}
+
+static void run_session(void) {
+    ESP_LOGI(TAG, "Calibration session started");
+    int64_t start = esp_timer_get_time();
+
+    flex_sensor_calibration_t previous;
+    flex_sensor_get_calibration(&previous);
+    flex_sensor_calibration_t flex = previous;
+    imu_calibration_t imu;
+    touch_calibration_t touch;
+    uint32_t sources = 0;
+
+    esp_err_t ret = collect_pose("Hand flat, keep still");
+    if (ret == ESP_OK) {
+        ret = reduce_rest_pose(&flex, &imu, &touch, &sources);
+    }
+    if (ret == ESP_OK) {
+        ret = collect_pose("Make a fist, hold it");
+    }
+    if (ret == ESP_OK) {
+        ret = reduce_fist_pose(&flex, &previous, &sources);
+    }
+
+    if (ret == ESP_OK) {
+        // All or nothing: a failed session leaves every sensor as it was
+        flex_sensor_set_calibration(&flex);
+        if (sources & CALIBRATION_SOURCE_IMU) {
+            imu_set_calibration(&imu);
+        }
+#if GLOVE_HAS_TOUCH
+        if (sources & CALIBRATION_SOURCE_TOUCH) {
+            touch_set_calibration(&touch);
+        }
+#endif
+        write_blob();
+        prompt("Calibration done");
+        ESP_LOGI(TAG, "Calibration session done in %lu ms (sources 0x%02lx)",
+                 (unsigned long)((esp_timer_get_time() - start) / 1000), (unsigned long)sources);
+    } else {
+        prompt(failure_text(ret));
+        ESP_LOGW(TAG, "Calibration session failed: %s", esp_err_to_name(ret));
+    }
+
+    atomic_store(&session_running, false);
+
+    // Back to recognition, through the power task that owns the state
+    system_command_t cmd = {
+        .type = SYS_CMD_CHANGE_STATE,
+        .data.change_state.new_state = SYSTEM_STATE_ACTIVE
+    };
+    command_bus_publish(&cmd);
+}
+
+static void calibration_task(void *arg) {
+    while (1) {
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+
+        if (events & NOTIFY_START) {
+            run_session();
+        }
+        if ((events & NOTIFY_SAVE) || save_pending) {
+            save_pending = false;
+            write_blob();
+        }
+    }
+}
+
+esp_err_t calibration_init(void) {
+    if (calibration_task_handle != NULL) {
+        return ESP_OK;
+    }
+
+    calibration_task_handle = STATIC_TASK_CREATE_PINNED(calibration_task, "calibration", CALIBRATION_TASK_STACK_SIZE,
+                                                        NULL, CALIBRATION_TASK_PRIORITY, CALIBRATION_TASK_CORE);
+    if (calibration_task_handle == NULL) {
+        ESP_LOGE(TAG, "Failed to create calibration task");
+        return ESP_FAIL;
+    }
+
+    // Flex and IMU calibration came back from RTC memory; the touch pads measure their baselines
+    if (wake_state_is_warm()) {
+        return ESP_OK;
+    }
+
+    if (load_blob() == ESP_OK) {
+        return ESP_OK;
+    }
+
+    // First boot of this firmware: take what earlier firmware saved in the
+    // drivers' own entries, if anything, and write the blob either way so
+    // later boots find it
+    bool flex_found = flex_sensor_load_calibration() == ESP_OK;
+    bool imu_found = imu_load_calibration() == ESP_OK;
+    if (flex_found || imu_found) {
+        ESP_LOGI(TAG, "Moving calibration from the driver entries into the blob");
+    }
+    return calibration_save();
+}
+
+esp_err_t calibration_start(void) {
+    if (calibration_task_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    bool expected = false;
+    if (!atomic_compare_exchange_strong(&session_running, &expected, true)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xTaskNotify(calibration_task_handle, NOTIFY_START, eSetBits);
+    return ESP_OK;
+}
+
+bool calibration_is_running(void) {
+    return atomic_load(&session_running);
+}
+
+esp_err_t calibration_save(void) {
+    if (calibration_task_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xTaskNotify(calibration_task_handle, NOTIFY_SAVE, eSetBits);
+    return ESP_OK;
+}
+
+void calibration_record(const sensor_data_t *frame) {
+    if (atomic_load_explicit(&collect_state, memory_order_acquire) != COLLECT_RUNNING) {
+        return;
+    }
+
+    // Frames repeat the latest reading of every sensor; take each reading once
+    if (frame->flex_data_valid && frame->flex_data.timestamp != samples.last_flex_ms &&
+        samples.flex_count < CALIBRATION_MAX_SAMPLES) {
+        for (int joint = 0; joint < FINGER_JOINT_COUNT; joint++) {
+            samples.flex[joint][samples.flex_count] = frame->flex_data.raw_values[joint];
+        }
+        samples.flex_count++;
+        samples.last_flex_ms = frame->flex_data.timestamp;
+    }
+
+    if (frame->imu_data_valid && frame->imu_data.timestamp != samples.last_imu_ms &&
+        samples.imu_count < CALIBRATION_MAX_SAMPLES) {
+        for (int axis = 0; axis < 3; axis++) {
+            samples.imu[axis][samples.imu_count] = frame->imu_data.accel[axis];
+            samples.imu[3 + axis][samples.imu_count] = frame->imu_data.gyro[axis];
+        }
+        samples.imu_count++;
+        samples.last_imu_ms = frame->imu_data.timestamp;
+    }
+
+#if GLOVE_HAS_TOUCH
+    // The frame only has touched or not; the baselines need the readings
+    uint16_t values[TOUCH_SENSOR_COUNT];
+    if (frame->touch_data_valid && frame->touch_data.timestamp != samples.last_touch_ms &&
+        samples.touch_count < CALIBRATION_MAX_SAMPLES && touch_get_values(values) == ESP_OK) {
+        for (int pad = 0; pad < TOUCH_SENSOR_COUNT; pad++) {
+            samples.touch[pad][samples.touch_count] = values[pad];
+        }
+        samples.touch_count++;
+        samples.last_touch_ms = frame->touch_data.timestamp;
+    }
+#endif
+
+    // Hand the buffers back once the pose time is up
+    if (esp_timer_get_time() >= collect_end_us) {
+        int expected = COLLECT_RUNNING;
+        if (atomic_compare_exchange_strong_explicit(&collect_state, &expected, COLLECT_IDLE,
+                                                    memory_order_acq_rel, memory_order_relaxed)) {
+            xTaskNotify(calibration_task_handle, NOTIFY_COLLECTED, eSetBits);
+        }
+    }
+}
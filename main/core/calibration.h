@@ -0,0 +1,88 @@
+#ifndef CORE_CALIBRATION_H
+#define CORE_CALIBRATION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "util/buffer.h"
+
+/**
+ * @brief Calibration engine: one guided session for all sensors, one NVS blob
+ *
+ * A session asks for two poses, the hand flat and still, then a fist, and
+ * samples the flex sensors, the IMU and the touch pads side by side from
+ * the frames the sensor task publishes anyway (flex by DMA scan, IMU
+ * from its FIFO), so it takes a few seconds. Each channel is reduced to a
+ * trimmed mean, which shrugs off twitches and glitches. The flat pose
+ * gives the flex flat values, the IMU offsets and the touch baselines;
+ * a gyro spread showing the hand moving fails the session. The fist gives
+ * the flex bent values; a joint whose flat to fist range is too small to
+ * be a real bend keeps its previous calibration.
+ *
+ * All calibration is kept in one versioned, CRC-protected blob under a
+ * single NVS key. The engine's low-priority task writes it, so neither
+ * the session nor calibration_save() waits on flash, and calibration_init()
+ * reads it with one nvs_get_blob() before the drivers start. Calibration
+ * saved by earlier firmware in the drivers' own NVS entries is read once
+ * when there is no blob and moved into one.
+ */
+
+#define CALIBRATION_BLOB_MAGIC      0x4C414347  // "GCAL" little-endian
+#define CALIBRATION_BLOB_VERSION    1
+#define CALIBRATION_NVS_NAMESPACE   "calibration"
+#define CALIBRATION_NVS_KEY         "blob"
+
+// Sensors a blob or session holds calibration for
+#define CALIBRATION_SOURCE_FLEX     (1 << 0)
+#define CALIBRATION_SOURCE_IMU      (1 << 1)
+#define CALIBRATION_SOURCE_TOUCH    (1 << 2)
+
+/**
+ * @brief Load the calibration blob into the drivers and start the engine task
+ *
+ * Runs after NVS and before the sensor drivers, which then start with the
+ * stored calibration. On a warm boot the flex and IMU calibration already
+ * came back from RTC memory and NVS is not read.
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t calibration_init(void);
+
+/**
+ * @brief Start a guided calibration session
+ *
+ * Returns at once; the session prompts on the display, applies the
+ * result to the drivers and saves it, and hands the system back to the
+ * active state when done.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if a session is running
+ */
+esp_err_t calibration_start(void);
+
+/**
+ * @brief Check whether a session is running
+ *
+ * @return true while a session is running
+ */
+bool calibration_is_running(void);
+
+/**
+ * @brief Save the drivers' current calibration in the background
+ *
+ * Returns at once; the blob is written by the engine task.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE before calibration_init()
+ */
+esp_err_t calibration_save(void);
+
+/**
+ * @brief Take in one published sensor frame
+ *
+ * Called by the sensor task for every frame; returns at once unless a
+ * pose is being sampled.
+ *
+ * @param frame Frame just published
+ */
+void calibration_record(const sensor_data_t *frame);
+
+#endif /* CORE_CALIBRATION_H */
@@ -0,0 +1,93 @@
+#include "core/command_bus.h"
+#include "esp_log.h"
+#include "freertos/queue.h"
+#include "config/system_config.h"
+#include "config/memory_layout.h"
+#include "core/telemetry.h"
+
+static const char *TAG = "COMMAND_BUS";
+
+#define NO_SUBSCRIBER   0xFF
+
+_Static_assert(SYS_CMD_COUNT <= 32, "Too many command types for a subscription mask");
+
+// Per subscriber: its queue as the telemetry registry knows it
+static const telemetry_queue_t subscriber_queues[COMMAND_SUBSCRIBER_COUNT] = {
+    [COMMAND_SUBSCRIBER_POWER]         = TELEMETRY_QUEUE_POWER_COMMAND,
+    [COMMAND_SUBSCRIBER_COMMUNICATION] = TELEMETRY_QUEUE_COMMUNICATION_COMMAND,
+};
+
+STATIC_QUEUE_STORAGE(power_command, COMMAND_QUEUE_SIZE, sizeof(system_command_t));
+STATIC_QUEUE_STORAGE(communication_command, COMMAND_QUEUE_SIZE, sizeof(system_command_t));
+
+static QueueHandle_t queues[COMMAND_SUBSCRIBER_COUNT];
+
+// Subscriber of each command type, written during init only
+static uint8_t routes[SYS_CMD_COUNT];
+
+esp_err_t command_bus_init(void) {
+    for (int i = 0; i < SYS_CMD_COUNT; i++) {
+        routes[i] = NO_SUBSCRIBER;
+    }
+
+    queues[COMMAND_SUBSCRIBER_POWER] =
+        STATIC_QUEUE_CREATE(power_command, COMMAND_QUEUE_SIZE, sizeof(system_command_t));
+    queues[COMMAND_SUBSCRIBER_COMMUNICATION] =
+        STATIC_QUEUE_CREATE(communication_command, COMMAND_QUEUE_SIZE, sizeof(system_command_t));
+
+    for (int i = 0; i < COMMAND_SUBSCRIBER_COUNT; i++) {
+        if (queues[i] == NULL) {
+            ESP_LOGE(TAG, "Failed to create command queue %d", i);
+            return ESP_FAIL;
+        }
+        telemetry_register_queue(subscriber_queues[i], queues[i]);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t command_bus_subscribe(command_subscriber_t subscriber, uint32_t types) {
+    if (subscriber >= COMMAND_SUBSCRIBER_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int i = 0; i < SYS_CMD_COUNT; i++) {
+        if ((types & COMMAND_BUS_TYPE(i)) && routes[i] != NO_SUBSCRIBER && routes[i] != subscriber) {
+            ESP_LOGE(TAG, "Command type %d already routed to subscriber %u", i, routes[i]);
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    for (int i = 0; i < SYS_CMD_COUNT; i++) {
+        if (types & COMMAND_BUS_TYPE(i)) {
+            routes[i] = (uint8_t)subscriber;
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t command_bus_publish(const system_command_t *cmd) {
+    if (cmd == NULL || cmd->type >= SYS_CMD_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t subscriber = routes[cmd->type];
+    if (subscriber == NO_SUBSCRIBER) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (telemetry_queue_send(subscriber_queues[subscriber], cmd, 0) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    return ESP_OK;
+}
+
+BaseType_t command_bus_receive(command_subscriber_t subscriber, system_command_t *cmd, TickType_t ticks_to_wait) {
+    if (subscriber >= COMMAND_SUBSCRIBER_COUNT || cmd == NULL || queues[subscriber] == NULL) {
+        return pdFALSE;
+    }
+
+    return xQueueReceive(queues[subscriber], cmd, ticks_to_wait);
+}
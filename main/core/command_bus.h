@@ -0,0 +1,70 @@
+#ifndef CORE_COMMAND_BUS_H
+#define CORE_COMMAND_BUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "util/buffer.h"
+
+/**
+ * @brief Routing of system commands to the tasks that handle them
+ *
+ * Each subscriber has its own queue and claims the command types it
+ * handles. Publishing looks the type up in the routing table and sends
+ * to that one queue, so a command never passes through a task that
+ * does not handle it, and no task has to hand commands back.
+ */
+
+/**
+ * @brief Tasks receiving system commands
+ */
+typedef enum {
+    COMMAND_SUBSCRIBER_POWER = 0,       // State changes, calibration, power modes, restart, sleep
+    COMMAND_SUBSCRIBER_COMMUNICATION,   // Bluetooth on and off
+    COMMAND_SUBSCRIBER_COUNT
+} command_subscriber_t;
+
+#define COMMAND_BUS_TYPE(type)  (1UL << (type))     // Bit of a type in a subscription mask
+
+/**
+ * @brief Create the subscriber queues
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t command_bus_init(void);
+
+/**
+ * @brief Route command types to a subscriber
+ *
+ * Every type has at most one subscriber. Called from the subscriber's
+ * init, before anything publishes those types.
+ *
+ * @param subscriber Subscriber
+ * @param types COMMAND_BUS_TYPE() bits of the types it handles
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if a type is already routed elsewhere
+ */
+esp_err_t command_bus_subscribe(command_subscriber_t subscriber, uint32_t types);
+
+/**
+ * @brief Send a command to the subscriber of its type
+ *
+ * Never blocks.
+ *
+ * @param cmd Command
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if nobody handles the
+ *         type, ESP_ERR_TIMEOUT if the subscriber's queue is full
+ */
+esp_err_t command_bus_publish(const system_command_t *cmd);
+
+/**
+ * @brief Take the next command for a subscriber
+ *
+ * @param subscriber Subscriber
+ * @param cmd Pointer to store the command
+ * @param ticks_to_wait Longest to wait for one
+ * @return pdTRUE if a command was received
+ */
+BaseType_t command_bus_receive(command_subscriber_t subscriber, system_command_t *cmd, TickType_t ticks_to_wait);
+
+#endif /* CORE_COMMAND_BUS_H */
@@ -1,15 +1,20 @@
 #include "core/power_management.h"
 #include <string.h>
+#include <stdatomic.h>
 #include "esp_log.h"
 #include "esp_sleep.h"
 #include "esp_pm.h"
 #include "esp_timer.h"
 #include "driver/gpio.h"
-#include "driver/adc.h"
-#include "esp_adc_cal.h"
+#include "driver/rtc_io.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
 #include "config/pin_definitions.h"
 #include "util/debug.h"
 #include "drivers/display.h"
+#include "drivers/imu.h"
+#include "core/wake_state.h"
 #include "communication/ble_service.h"
 
 static const char *TAG = "POWER_MGMT";
@@ -20,8 +25,9 @@ static const char *TAG = "POWER_MGMT";
 #define PERIPHERAL_BLE       3
 #define PERIPHERAL_CAMERA    4
 
-// Battery ADC calibration
-static esp_adc_cal_characteristics_t adc_chars;
+// Battery divider on ADC2, clear of the flex sensors' ADC1 DMA scan
+static adc_oneshot_unit_handle_t battery_adc_handle = NULL;
+static adc_cali_handle_t adc_cali_handle = NULL;
 
 // Power management state
 static struct {
@@ -42,6 +48,31 @@ static struct {
     .is_sleeping = false
 };
 
+// Governor state of each stage, written only by the stage's own task
+typedef struct {
+    esp_pm_lock_handle_t lock;
+    bool held;
+    uint32_t busy_until_ms;      // Hold after the last busy work item
+    uint32_t boost_until_ms;     // Hold after the last deadline miss
+    uint32_t deadline_us;
+    atomic_uint_least32_t deadline_misses;
+    atomic_uint_least32_t lock_acquisitions;
+} stage_governor_t;
+
+static stage_governor_t stage_governors[POWER_STAGE_COUNT] = {
+    [POWER_STAGE_FEATURES] = { .deadline_us = POWER_DEADLINE_FEATURES_US },
+    [POWER_STAGE_CLASSIFY] = { .deadline_us = POWER_DEADLINE_CLASSIFY_US },
+    [POWER_STAGE_OUTPUT]   = { .deadline_us = POWER_DEADLINE_OUTPUT_US },
+};
+
+static const char *stage_lock_names[POWER_STAGE_COUNT] = {
+    "features",
+    "classify",
+    "output"
+};
+
+static bool pm_configured = false;
+
 // Battery voltage to percentage mapping (approximate for 3.7V LiPo)
 static const struct {
     uint16_t voltage_mv;
@@ -65,12 +96,36 @@ static const struct {
 esp_err_t power_management_init(void) {
     esp_err_t ret;
     
-    // Initialize ADC for battery monitoring
-    adc1_config_width(ADC_WIDTH_BIT_12);
-    adc1_config_channel_atten(BATTERY_ADC_CHANNEL, BATTERY_ADC_ATTENUATION);
+    // One-shot ADC2 unit for battery monitoring
+    adc_oneshot_unit_init_cfg_t unit_config = {
+        .unit_id = BATTERY_ADC_UNIT,
+    };
+    ret = adc_oneshot_new_unit(&unit_config, &battery_adc_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create battery ADC unit: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    adc_oneshot_chan_cfg_t channel_config = {
+        .atten = BATTERY_ADC_ATTENUATION,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    ret = adc_oneshot_config_channel(battery_adc_handle, BATTERY_ADC_CHANNEL, &channel_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure battery ADC channel: %s", esp_err_to_name(ret));
+        return ret;
+    }
     
-    // Characterize ADC
-    esp_adc_cal_characterize(BATTERY_ADC_UNIT, BATTERY_ADC_ATTENUATION, ADC_WIDTH_BIT_12, 0, &adc_chars);
+    // Characterize ADC for battery monitoring
+    adc_cali_curve_fitting_config_t cali_config = {
+        .unit_id = BATTERY_ADC_UNIT,
+        .chan = BATTERY_ADC_CHANNEL,
+        .atten = BATTERY_ADC_ATTENUATION,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    if (adc_cali_create_scheme_curve_fitting(&cali_config, &adc_cali_handle) != ESP_OK) {
+        ESP_LOGW(TAG, "No ADC calibration in eFuse, battery voltage is approximate");
+        adc_cali_handle = NULL;
+    }
     
     // Configure GPIO for power control
     gpio_config_t io_conf = {
@@ -80,14 +135,28 @@ esp_err_t power_management_init(void) {
         .pull_down_en = 0,
         .pull_up_en = 0
     };
+    // Released from the deep sleep hold, if this is a wake
+    gpio_hold_dis(SENSOR_POWER_CTRL_PIN);
     gpio_config(&io_conf);
     
     // Enable all peripherals initially
     gpio_set_level(SENSOR_POWER_CTRL_PIN, 1);
     
-    // Get initial battery status
+    // Stage locks raise the CPU to the mode's ceiling while a gesture is in progress
+    for (int i = 0; i < POWER_STAGE_COUNT; i++) {
+        ret = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, stage_lock_names[i], &stage_governors[i].lock);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "No %s frequency lock (%s), stage runs at the mode's range",
+                     stage_lock_names[i], esp_err_to_name(ret));
+            stage_governors[i].lock = NULL;
+        }
+    }
+    
+    // Get initial battery status; ADC2 may be busy with the radio
     ret = power_management_get_battery_status(&power_state.battery);
-    if (ret != ESP_OK) {
+    if (ret == ESP_ERR_TIMEOUT) {
+        ESP_LOGW(TAG, "Battery not measured yet, assuming it is fine");
+    } else if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to get initial battery status");
         return ret;
     }
@@ -110,10 +179,27 @@ esp_err_t power_management_init(void) {
     return ESP_OK;
 }
 
+// Frequency range for the governor: the floor between gestures, the
+// ceiling while a stage holds its lock
+static esp_err_t configure_frequency_range(uint32_t max_freq_mhz, uint32_t min_freq_mhz, bool light_sleep) {
+    esp_pm_config_esp32s3_t pm_config = {
+        .max_freq_mhz = max_freq_mhz,
+        .min_freq_mhz = min_freq_mhz,
+        .light_sleep_enable = light_sleep
+    };
+    
+    esp_err_t ret = esp_pm_configure(&pm_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set frequency range %lu-%lu MHz: %s",
+                 (unsigned long)min_freq_mhz, (unsigned long)max_freq_mhz, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
 esp_err_t power_management_set_mode(power_mode_t mode) {
     esp_err_t ret = ESP_OK;
     
-    if (mode == power_state.current_mode) {
+    if (mode == power_state.current_mode && pm_configured) {
         // No change needed
         return ESP_OK;
     }
@@ -124,17 +210,14 @@ esp_err_t power_management_set_mode(power_mode_t mode) {
     // Apply power mode settings
     switch (mode) {
         case POWER_MODE_PERFORMANCE:
-            // Maximum CPU frequency
-            power_management_set_cpu_frequency(240);
+            // Pinned to the maximum CPU frequency, no automatic light sleep
+            ret = configure_frequency_range(240, 240, false);
             
             // Enable all peripherals
             for (int i = 0; i < 5; i++) {
                 power_management_set_peripheral_power(i, true);
             }
             
-            // Disable automatic light sleep
-            esp_pm_configure(NULL);
-            
             // Set long timeouts
             power_state.inactivity_timeout_ms = INACTIVITY_TIMEOUT_SEC * 2 * 1000;
             power_state.deep_sleep_timeout_ms = DEEP_SLEEP_TIMEOUT_SEC * 2 * 1000;
@@ -143,8 +226,8 @@ esp_err_t power_management_set_mode(power_mode_t mode) {
             break;
             
         case POWER_MODE_BALANCED:
-            // Medium CPU frequency
-            power_management_set_cpu_frequency(160);
+            // Full speed while signing, XTAL and light sleep in between
+            ret = configure_frequency_range(240, 40, true);
             
             // Enable all important peripherals
             power_management_set_peripheral_power(PERIPHERAL_SENSORS, true);
@@ -153,14 +236,6 @@ esp_err_t power_management_set_mode(power_mode_t mode) {
             power_management_set_peripheral_power(PERIPHERAL_BLE, true);
             power_management_set_peripheral_power(PERIPHERAL_CAMERA, false);
             
-            // Configure automatic light sleep
-            esp_pm_config_esp32s3_t pm_config = {
-                .max_freq_mhz = 160,
-                .min_freq_mhz = 80,
-                .light_sleep_enable = true
-            };
-            esp_pm_configure(&pm_config);
-            
             // Set standard timeouts
             power_state.inactivity_timeout_ms = INACTIVITY_TIMEOUT_SEC * 1000;
             power_state.deep_sleep_timeout_ms = DEEP_SLEEP_TIMEOUT_SEC * 1000;
@@ -169,8 +244,8 @@ esp_err_t power_management_set_mode(power_mode_t mode) {
             break;
             
         case POWER_MODE_POWER_SAVE:
-            // Lower CPU frequency
-            power_management_set_cpu_frequency(80);
+            // Lower ceiling while signing
+            ret = configure_frequency_range(160, 40, true);
             
             // Disable non-essential peripherals
             power_management_set_peripheral_power(PERIPHERAL_SENSORS, true);
@@ -179,14 +254,6 @@ esp_err_t power_management_set_mode(power_mode_t mode) {
             power_management_set_peripheral_power(PERIPHERAL_BLE, true);
             power_management_set_peripheral_power(PERIPHERAL_CAMERA, false);
             
-            // Configure aggressive automatic light sleep
-            esp_pm_config_esp32s3_t pm_config = {
-                .max_freq_mhz = 80,
-                .min_freq_mhz = 40,
-                .light_sleep_enable = true
-            };
-            esp_pm_configure(&pm_config);
-            
             // Set shorter timeouts
             power_state.inactivity_timeout_ms = (INACTIVITY_TIMEOUT_SEC / 2) * 1000;
             power_state.deep_sleep_timeout_ms = (DEEP_SLEEP_TIMEOUT_SEC / 2) * 1000;
@@ -195,8 +262,8 @@ esp_err_t power_management_set_mode(power_mode_t mode) {
             break;
             
         case POWER_MODE_MAX_POWER_SAVE:
-            // Minimum CPU frequency
-            power_management_set_cpu_frequency(40);
+            // Lowest ceiling
+            ret = configure_frequency_range(80, 40, true);
             
             // Disable most peripherals
             power_management_set_peripheral_power(PERIPHERAL_SENSORS, true);
@@ -205,14 +272,6 @@ esp_err_t power_management_set_mode(power_mode_t mode) {
             power_management_set_peripheral_power(PERIPHERAL_BLE, false);
             power_management_set_peripheral_power(PERIPHERAL_CAMERA, false);
             
-            // Configure very aggressive automatic light sleep
-            esp_pm_config_esp32s3_t pm_config = {
-                .max_freq_mhz = 40,
-                .min_freq_mhz = 40,
-                .light_sleep_enable = true
-            };
-            esp_pm_configure(&pm_config);
-            
             // Set very short timeouts
             power_state.inactivity_timeout_ms = (INACTIVITY_TIMEOUT_SEC / 4) * 1000;
             power_state.deep_sleep_timeout_ms = (DEEP_SLEEP_TIMEOUT_SEC / 4) * 1000;
@@ -221,9 +280,72 @@ esp_err_t power_management_set_mode(power_mode_t mode) {
             break;
     }
     
+    pm_configured = (ret == ESP_OK);
     return ret;
 }
 
+static void stage_lock_acquire(stage_governor_t *governor) {
+    if (esp_pm_lock_acquire(governor->lock) == ESP_OK) {
+        governor->held = true;
+        atomic_fetch_add_explicit(&governor->lock_acquisitions, 1, memory_order_relaxed);
+    }
+}
+
+void power_management_begin_stage(power_stage_t stage) {
+    if (stage >= POWER_STAGE_COUNT) {
+        return;
+    }
+    
+    stage_governor_t *governor = &stage_governors[stage];
+    if (!governor->held && governor->lock != NULL) {
+        stage_lock_acquire(governor);
+    }
+}
+
+bool power_management_report_stage(power_stage_t stage, bool busy, uint32_t elapsed_us) {
+    if (stage >= POWER_STAGE_COUNT) {
+        return false;
+    }
+    
+    stage_governor_t *governor = &stage_governors[stage];
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    
+    // A miss is what the frequency is for: hold it a while whatever the gate says
+    if (elapsed_us > governor->deadline_us) {
+        atomic_fetch_add_explicit(&governor->deadline_misses, 1, memory_order_relaxed);
+        governor->boost_until_ms = now_ms + POWER_GOVERNOR_BOOST_MS;
+    }
+    if (busy) {
+        governor->busy_until_ms = now_ms + POWER_GOVERNOR_HOLD_MS;
+    }
+    
+    bool want = (int32_t)(governor->busy_until_ms - now_ms) > 0 ||
+                (int32_t)(governor->boost_until_ms - now_ms) > 0;
+    if (want == governor->held || governor->lock == NULL) {
+        return governor->held;
+    }
+    
+    if (want) {
+        stage_lock_acquire(governor);
+    } else if (esp_pm_lock_release(governor->lock) == ESP_OK) {
+        governor->held = false;
+    }
+    return governor->held;
+}
+
+esp_err_t power_management_get_governor_stats(power_governor_stats_t *stats) {
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    for (int i = 0; i < POWER_STAGE_COUNT; i++) {
+        stats->deadline_misses[i] = atomic_load(&stage_governors[i].deadline_misses);
+        stats->lock_acquisitions[i] = atomic_load(&stage_governors[i].lock_acquisitions);
+        stats->lock_held[i] = stage_governors[i].held;
+    }
+    return ESP_OK;
+}
+
 power_mode_t power_management_get_mode(void) {
     return power_state.current_mode;
 }
@@ -233,9 +355,23 @@ esp_err_t power_management_get_battery_status(battery_status_t* status) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    // Read battery voltage from ADC
-    uint32_t adc_reading = adc1_get_raw(BATTERY_ADC_CHANNEL);
-    uint32_t voltage_mv = esp_adc_cal_raw_to_voltage(adc_reading, &adc_chars);
+    if (battery_adc_handle == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    // Read battery voltage; ADC2 is arbitrated with Wi-Fi, which may hold it
+    int adc_reading = 0;
+    esp_err_t ret = adc_oneshot_read(battery_adc_handle, BATTERY_ADC_CHANNEL, &adc_reading);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    int calibrated_mv = 0;
+    if (adc_cali_handle == NULL || adc_cali_raw_to_voltage(adc_cali_handle, adc_reading, &calibrated_mv) != ESP_OK) {
+        // Uncalibrated: full scale is about 3.1 V at 11 dB
+        calibrated_mv = adc_reading * 3100 / 4095;
+    }
+    uint32_t voltage_mv = (uint32_t)calibrated_mv;
     
     // Apply voltage divider conversion if necessary
     // Note: This assumes a voltage divider is used to measure battery voltage
@@ -272,6 +408,15 @@ esp_err_t power_management_get_battery_status(battery_status_t* status) {
     return ESP_OK;
 }
 
+// Wake on the MPU6050 motion interrupt, latched high on the INT pin
+static void enable_motion_wakeup(void) {
+    if (imu_arm_wake_on_motion(true) != ESP_OK) {
+        ESP_LOGW(TAG, "No wake-on-motion, only the timer wakes the glove");
+        return;
+    }
+    esp_sleep_enable_ext0_wakeup(IMU_INT_PIN, 1);
+}
+
 esp_err_t power_management_light_sleep(uint32_t sleep_duration_ms) {
     ESP_LOGI(TAG, "Entering light sleep for %d ms", sleep_duration_ms);
     
@@ -279,9 +424,7 @@ esp_err_t power_management_light_sleep(uint32_t sleep_duration_ms) {
     if (sleep_duration_ms > 0) {
         esp_sleep_enable_timer_wakeup(sleep_duration_ms * 1000);
     }
-    
-    // Enable wakeup from touch pad or IMU interrupt if connected
-    esp_sleep_enable_ext0_wakeup(IMU_INT_PIN, 1);
+    enable_motion_wakeup();
     
     // Record that we're sleeping
     power_state.is_sleeping = true;
@@ -289,9 +432,11 @@ esp_err_t power_management_light_sleep(uint32_t sleep_duration_ms) {
     // Enter light sleep
     esp_light_sleep_start();
     
-    // Code continues here after wakeup
+    // Code continues here after wakeup, with RAM and every driver intact
     power_state.is_sleeping = false;
-    ESP_LOGI(TAG, "Woke up from light sleep");
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+    imu_arm_wake_on_motion(false);
+    ESP_LOGI(TAG, "Woke up from light sleep (cause %d)", (int)esp_sleep_get_wakeup_cause());
     
     // Reset inactivity timer
     power_management_reset_inactivity_timer();
@@ -306,9 +451,16 @@ esp_err_t power_management_deep_sleep(uint32_t sleep_duration_ms) {
     if (sleep_duration_ms > 0) {
         esp_sleep_enable_timer_wakeup(sleep_duration_ms * 1000);
     }
+    enable_motion_wakeup();
     
-    // Enable wakeup from touch pad or IMU interrupt if connected
-    esp_sleep_enable_ext0_wakeup(IMU_INT_PIN, 1);
+    // Keep the INT pin low until the IMU latches it, and the sensors powered
+    rtc_gpio_pullup_dis(IMU_INT_PIN);
+    rtc_gpio_pulldown_en(IMU_INT_PIN);
+    gpio_hold_en(SENSOR_POWER_CTRL_PIN);
+    gpio_deep_sleep_hold_en();
+    
+    // Calibration, orientation and configuration survive for a warm boot
+    wake_state_save();
     
     // Enter deep sleep (will reset the chip)
     esp_deep_sleep_start();
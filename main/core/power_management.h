@@ -14,6 +14,27 @@ typedef enum {
     POWER_MODE_MAX_POWER_SAVE  // Maximum power saving
 } power_mode_t;
 
+/**
+ * @brief Pipeline stages that hold a max-frequency lock while busy
+ *
+ * Each stage is reported by its own task only.
+ */
+typedef enum {
+    POWER_STAGE_FEATURES = 0,  // Feature stage: busy while the motion gate is not idle
+    POWER_STAGE_CLASSIFY,      // Classify stage: busy while feature frames arrive
+    POWER_STAGE_OUTPUT,        // Output task: busy while a result plays out
+    POWER_STAGE_COUNT
+} power_stage_t;
+
+/**
+ * @brief Governor counters since boot
+ */
+typedef struct {
+    uint32_t deadline_misses[POWER_STAGE_COUNT];    // Work items over the stage deadline
+    uint32_t lock_acquisitions[POWER_STAGE_COUNT];  // Times the stage raised the frequency
+    bool lock_held[POWER_STAGE_COUNT];              // Stage holds its lock now
+} power_governor_stats_t;
+
 /**
  * @brief Battery status
  */
@@ -35,6 +56,10 @@ esp_err_t power_management_init(void);
 /**
  * @brief Set power mode
  * 
+ * The mode sets the frequency range; except in PERFORMANCE the CPU runs
+ * at the floor with automatic light sleep, and only goes up to the
+ * ceiling while a stage holds its lock (see power_management_report_stage()).
+ * 
  * @param mode Power mode
  * @return ESP_OK on success, error code otherwise
  */
@@ -47,6 +72,44 @@ esp_err_t power_management_set_mode(power_mode_t mode);
  */
 power_mode_t power_management_get_mode(void);
 
+/**
+ * @brief Start a work item of a pipeline stage
+ * 
+ * Takes the stage's ESP_PM_CPU_FREQ_MAX lock if it is not held yet, so
+ * the first frame of a gesture already runs at full speed. The report
+ * that ends the work item decides whether the lock is kept. Call it from
+ * the stage's own task when work arrives, before doing it.
+ * 
+ * @param stage Starting stage
+ */
+void power_management_begin_stage(power_stage_t stage);
+
+/**
+ * @brief Report one work item, or an idle wakeup, of a pipeline stage
+ * 
+ * The stage holds an ESP_PM_CPU_FREQ_MAX lock while it is busy and for
+ * POWER_GOVERNOR_HOLD_MS after, so a gesture in progress runs at full
+ * speed and the gaps between signs fall back to the floor frequency. A
+ * work item over the stage's deadline keeps the lock for
+ * POWER_GOVERNOR_BOOST_MS whatever the stage reports. Call it from the
+ * stage's own task when a work item ends, also on idle wakeups so the
+ * lock can be released.
+ * 
+ * @param stage Reporting stage
+ * @param busy Whether the stage worked on part of a gesture
+ * @param elapsed_us Time the work item took, 0 for an idle wakeup
+ * @return Whether the stage holds its lock after this report
+ */
+bool power_management_report_stage(power_stage_t stage, bool busy, uint32_t elapsed_us);
+
+/**
+ * @brief Get the governor counters
+ * 
+ * @param stats Pointer to store the counters
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t power_management_get_governor_stats(power_governor_stats_t *stats);
+
 /**
  * @brief Get battery status
  * 
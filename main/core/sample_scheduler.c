@@ -0,0 +1,155 @@
+#include "core/sample_scheduler.h"
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "SAMPLE_SCHED";
+
+// Run the timer callbacks straight from the esp_timer ISR when supported
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+#define SAMPLE_TIMER_DISPATCH  ESP_TIMER_ISR
+#else
+#define SAMPLE_TIMER_DISPATCH  ESP_TIMER_TASK
+#endif
+
+static const char *source_names[SAMPLE_SOURCE_COUNT] = {
+    "sample_flex", "sample_imu", "sample_touch", "sample_camera"
+};
+
+// Scheduler state
+static TaskHandle_t target_task = NULL;
+static esp_timer_handle_t source_timers[SAMPLE_SOURCE_COUNT] = {0};
+static volatile int64_t last_tick_time[SAMPLE_SOURCE_COUNT] = {0};
+static bool sample_scheduler_initialized = false;
+
+static void IRAM_ATTR sample_timer_callback(void *arg) {
+    sample_source_t source = (sample_source_t)(uintptr_t)arg;
+    last_tick_time[source] = esp_timer_get_time();
+
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+    BaseType_t higher_priority_woken = pdFALSE;
+    xTaskNotifyFromISR(target_task, SAMPLE_EVENT_BIT(source), eSetBits, &higher_priority_woken);
+    if (higher_priority_woken) {
+        esp_timer_isr_dispatch_need_yield();
+    }
+#else
+    xTaskNotify(target_task, SAMPLE_EVENT_BIT(source), eSetBits);
+#endif
+}
+
+esp_err_t sample_scheduler_init(TaskHandle_t task) {
+    if (task == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (sample_scheduler_initialized) {
+        return ESP_OK;
+    }
+
+    target_task = task;
+
+    for (int i = 0; i < SAMPLE_SOURCE_COUNT; i++) {
+        esp_timer_create_args_t timer_args = {
+            .callback = sample_timer_callback,
+            .arg = (void *)(uintptr_t)i,
+            .dispatch_method = SAMPLE_TIMER_DISPATCH,
+            .name = source_names[i],
+            .skip_unhandled_events = true
+        };
+
+        esp_err_t ret = esp_timer_create(&timer_args, &source_timers[i]);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to create timer %s: %s", source_names[i], esp_err_to_name(ret));
+            sample_scheduler_deinit();
+            return ret;
+        }
+    }
+
+    sample_scheduler_initialized = true;
+    ESP_LOGI(TAG, "Sample scheduler initialized");
+
+    return ESP_OK;
+}
+
+void sample_scheduler_deinit(void) {
+    for (int i = 0; i < SAMPLE_SOURCE_COUNT; i++) {
+        if (source_timers[i] != NULL) {
+            esp_timer_stop(source_timers[i]);
+            esp_timer_delete(source_timers[i]);
+            source_timers[i] = NULL;
+        }
+    }
+
+    target_task = NULL;
+    sample_scheduler_initialized = false;
+}
+
+esp_err_t sample_scheduler_start(sample_source_t source, uint32_t rate_hz) {
+    if (!sample_scheduler_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (source >= SAMPLE_SOURCE_COUNT || rate_hz == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Restart with the new period if already running
+    if (esp_timer_is_active(source_timers[source])) {
+        esp_timer_stop(source_timers[source]);
+    }
+
+    uint64_t period_us = 1000000ULL / rate_hz;
+    last_tick_time[source] = esp_timer_get_time();
+
+    esp_err_t ret = esp_timer_start_periodic(source_timers[source], period_us);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start %s: %s", source_names[source], esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "%s scheduled at %lu Hz", source_names[source], (unsigned long)rate_hz);
+    return ESP_OK;
+}
+
+esp_err_t sample_scheduler_stop(sample_source_t source) {
+    if (!sample_scheduler_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (source >= SAMPLE_SOURCE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (esp_timer_is_active(source_timers[source])) {
+        return esp_timer_stop(source_timers[source]);
+    }
+
+    return ESP_OK;
+}
+
+void sample_scheduler_notify(sample_source_t source) {
+    if (target_task == NULL || source >= SAMPLE_SOURCE_COUNT) {
+        return;
+    }
+
+    last_tick_time[source] = esp_timer_get_time();
+    xTaskNotify(target_task, SAMPLE_EVENT_BIT(source), eSetBits);
+}
+
+void IRAM_ATTR sample_scheduler_notify_from_isr(sample_source_t source, BaseType_t *higher_priority_woken) {
+    if (target_task == NULL || source >= SAMPLE_SOURCE_COUNT) {
+        return;
+    }
+
+    last_tick_time[source] = esp_timer_get_time();
+    xTaskNotifyFromISR(target_task, SAMPLE_EVENT_BIT(source), eSetBits, higher_priority_woken);
+}
+
+int64_t sample_scheduler_get_tick_time(sample_source_t source) {
+    if (source >= SAMPLE_SOURCE_COUNT) {
+        return 0;
+    }
+    return last_tick_time[source];
+}
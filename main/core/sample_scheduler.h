@@ -0,0 +1,90 @@
+#ifndef CORE_SAMPLE_SCHEDULER_H
+#define CORE_SAMPLE_SCHEDULER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/**
+ * @brief Sampled sensor sources
+ */
+typedef enum {
+    SAMPLE_SOURCE_FLEX = 0,
+    SAMPLE_SOURCE_IMU,
+    SAMPLE_SOURCE_TOUCH,
+    SAMPLE_SOURCE_CAMERA,
+    SAMPLE_SOURCE_COUNT
+} sample_source_t;
+
+/**
+ * @brief Task notification bit used for a source
+ */
+#define SAMPLE_EVENT_BIT(source)   (1UL << (source))
+
+/**
+ * @brief Initialize the sample scheduler
+ *
+ * Each started source gets its own periodic esp_timer whose callback sets
+ * the source's notification bit on the target task, so the task can block
+ * in xTaskNotifyWait() between samples.
+ *
+ * @param task Task to notify
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t sample_scheduler_init(TaskHandle_t task);
+
+/**
+ * @brief Deinitialize the sample scheduler and delete all timers
+ */
+void sample_scheduler_deinit(void);
+
+/**
+ * @brief Start periodic notifications for a source
+ *
+ * @param source Source to schedule
+ * @param rate_hz Sampling rate in Hz
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t sample_scheduler_start(sample_source_t source, uint32_t rate_hz);
+
+/**
+ * @brief Stop periodic notifications for a source
+ *
+ * @param source Source to stop
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t sample_scheduler_stop(sample_source_t source);
+
+/**
+ * @brief Signal a source from another task instead of its timer
+ *
+ * For sources produced by their own task, such as the camera stage.
+ *
+ * @param source Source to signal
+ */
+void sample_scheduler_notify(sample_source_t source);
+
+/**
+ * @brief Signal a source from an interrupt instead of its timer
+ *
+ * For sources paced by their own hardware, such as a sensor data-ready
+ * pin. The tick time is recorded the same way as for timer ticks.
+ *
+ * @param source Source to signal
+ * @param higher_priority_woken Set to pdTRUE if a context switch is needed
+ */
+void sample_scheduler_notify_from_isr(sample_source_t source, BaseType_t *higher_priority_woken);
+
+/**
+ * @brief Get the time of the last tick of a source
+ *
+ * Sampling code uses this as the sample timestamp, so timestamps follow
+ * the timer period rather than when the task got to run.
+ *
+ * @param source Source to query
+ * @return Tick time in microseconds since boot
+ */
+int64_t sample_scheduler_get_tick_time(sample_source_t source);
+
+#endif /* CORE_SAMPLE_SCHEDULER_H */
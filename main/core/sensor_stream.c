@@ -0,0 +1,171 @@
+#include "core/sensor_stream.h"
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "core/trace_recorder.h"
+#include "core/stream_codec.h"
+#include "communication/ble_service.h"
+#include "config/system_config.h"
+#include "config/memory_layout.h"
+
+static const char *TAG = "SENSOR_STREAM";
+
+#define RING_MASK           (SENSOR_STREAM_RING_FRAMES - 1)
+#define MIN_FRAME_INTERVAL  (1000 / SENSOR_STREAM_MAX_RATE_HZ)
+#define MAX_PACKET_BYTES    512
+#define MAX_BATCH           (MAX_PACKET_BYTES / STREAM_CODEC_MIN_FRAME_BYTES)
+
+// Frames waiting to be sent. head and tail only grow; the sensor task
+// moves tail past the oldest frame when the ring is full.
+static portMUX_TYPE ring_lock = portMUX_INITIALIZER_UNLOCKED;
+static trace_record_t ring[SENSOR_STREAM_RING_FRAMES];
+static uint32_t ring_head = 0;
+static uint32_t ring_tail = 0;
+static uint32_t last_frame_ms = 0;
+static bool have_last_frame = false;
+
+static TaskHandle_t stream_task_handle = NULL;
+STATIC_TASK_STORAGE(stream_task, SENSOR_STREAM_STACK_SIZE);
+
+static atomic_uint_least32_t frames_sent;
+static atomic_uint_least32_t frames_dropped;
+static atomic_uint_least32_t packets_sent;
+static atomic_uint_least32_t failed_sends;
+
+static void drop_queued(void) {
+    portENTER_CRITICAL(&ring_lock);
+    ring_tail = ring_head;
+    portEXIT_CRITICAL(&ring_lock);
+}
+
+// Send one packet of the oldest frames; false when there is nothing to do
+static bool send_queued(void) {
+    static trace_record_t batch[MAX_BATCH];
+    static uint8_t packet[MAX_PACKET_BYTES];
+
+    portENTER_CRITICAL(&ring_lock);
+    uint32_t tail = ring_tail;
+    uint32_t count = ring_head - tail;
+    if (count > MAX_BATCH) {
+        count = MAX_BATCH;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        batch[i] = ring[(tail + i) & RING_MASK];
+    }
+    portEXIT_CRITICAL(&ring_lock);
+
+    if (count == 0) {
+        return false;
+    }
+
+    size_t size = ble_service_get_payload_size();
+    if (size > MAX_PACKET_BYTES) {
+        size = MAX_PACKET_BYTES;
+    }
+    uint32_t encoded = 0;
+    size_t len = stream_codec_encode_packet(batch, count, packet, size, &encoded);
+    bool sent = encoded > 0;
+    if (!sent) {
+        // Not even one frame fits this MTU: drop it rather than stall the stream
+        ESP_LOGW(TAG, "MTU too small for a sensor frame (%u bytes)", (unsigned)size);
+        encoded = 1;
+        atomic_fetch_add_explicit(&frames_dropped, 1, memory_order_relaxed);
+    } else if (ble_service_send_stream(packet, len) != ESP_OK) {
+        // Frames stay queued for the next batch window
+        atomic_fetch_add_explicit(&failed_sends, 1, memory_order_relaxed);
+        return false;
+    }
+
+    // The sensor task may have dropped some of them meanwhile
+    portENTER_CRITICAL(&ring_lock);
+    if ((int32_t)(tail + encoded - ring_tail) > 0) {
+        ring_tail = tail + encoded;
+    }
+    portEXIT_CRITICAL(&ring_lock);
+
+    if (sent) {
+        atomic_fetch_add_explicit(&frames_sent, encoded, memory_order_relaxed);
+        atomic_fetch_add_explicit(&packets_sent, 1, memory_order_relaxed);
+    }
+    return true;
+}
+
+// Bluetooth task: subscription changed or the congestion cleared
+static void stream_ready_callback(void) {
+    if (stream_task_handle != NULL) {
+        xTaskNotifyGive(stream_task_handle);
+    }
+}
+
+static void stream_task(void *arg) {
+    while (1) {
+        // Gather a batch while subscribed, otherwise sleep until a client is
+        TickType_t wait = ble_service_stream_enabled() ? pdMS_TO_TICKS(SENSOR_STREAM_BATCH_MS) : portMAX_DELAY;
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        if (!ble_service_stream_enabled()) {
+            drop_queued();
+            continue;
+        }
+
+        while (!ble_service_is_congested() && send_queued()) {
+        }
+    }
+}
+
+esp_err_t sensor_stream_init(void) {
+    if (stream_task_handle != NULL) {
+        return ESP_OK;
+    }
+
+    stream_task_handle = STATIC_TASK_CREATE_PINNED(stream_task, "sensor_stream", SENSOR_STREAM_STACK_SIZE,
+                                                   NULL, SENSOR_STREAM_PRIORITY, SENSOR_STREAM_CORE);
+    if (stream_task_handle == NULL) {
+        ESP_LOGE(TAG, "Failed to create sensor stream task");
+        return ESP_FAIL;
+    }
+
+    ble_service_register_stream_callback(stream_ready_callback);
+
+    ESP_LOGI(TAG, "Sensor stream initialized (%u frames queued at most)", (unsigned)SENSOR_STREAM_RING_FRAMES);
+    return ESP_OK;
+}
+
+void sensor_stream_record(const sensor_data_t *frame) {
+    if (stream_task_handle == NULL || !ble_service_stream_enabled()) {
+        have_last_frame = false;
+        return;
+    }
+
+    // Frames closer together than the stream rate are skipped
+    if (have_last_frame && frame->timestamp - last_frame_ms < MIN_FRAME_INTERVAL) {
+        return;
+    }
+    last_frame_ms = frame->timestamp;
+    have_last_frame = true;
+
+    trace_record_t record;
+    trace_recorder_encode(frame, &record);
+
+    portENTER_CRITICAL(&ring_lock);
+    if (ring_head - ring_tail == SENSOR_STREAM_RING_FRAMES) {
+        ring_tail++;
+        atomic_fetch_add_explicit(&frames_dropped, 1, memory_order_relaxed);
+    }
+    ring[ring_head & RING_MASK] = record;
+    ring_head++;
+    portEXIT_CRITICAL(&ring_lock);
+}
+
+esp_err_t sensor_stream_get_stats(sensor_stream_stats_t *stats) {
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    stats->frames_sent = atomic_load(&frames_sent);
+    stats->frames_dropped = atomic_load(&frames_dropped);
+    stats->packets_sent = atomic_load(&packets_sent);
+    stats->failed_sends = atomic_load(&failed_sends);
+    return ESP_OK;
+}
@@ -0,0 +1,79 @@
+#ifndef CORE_SENSOR_STREAM_H
+#define CORE_SENSOR_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "util/buffer.h"
+
+/**
+ * @brief Live raw sensor stream over BLE, for collecting training data
+ *
+ * While a client is subscribed to the stream characteristic, published
+ * sensor frames (at most SENSOR_STREAM_MAX_RATE_HZ) are packed the way the
+ * trace recorder packs them and queued in a RAM ring. A low-priority task
+ * sends the queued frames every SENSOR_STREAM_BATCH_MS, as many per
+ * notification as fit in the MTU. While the stack reports congestion
+ * nothing is sent and the ring keeps the newest SENSOR_STREAM_RING_FRAMES,
+ * dropping the oldest; the gaps show up in the sequence numbers. A frame
+ * takes up to 59 bytes, so the client should negotiate an MTU of at least
+ * 63 (frames that do not fit the MTU are dropped).
+ *
+ * Packet layout: SENSOR_STREAM_PACKET_FRAMES, then frames back to back.
+ * Each frame is the difference to the frame before it in the packet (to
+ * all zeros for the first, so every packet decodes on its own):
+ *
+ *   varint   sequence delta
+ *   varint   timestamp delta, ms
+ *   zigzag   flex_raw[10], ADC counts
+ *   zigzag   accel[3], mg
+ *   zigzag   gyro[3], 0.1 °/s
+ *   u8       touch bits 0-4, SENSOR_STREAM_FLAG_* bits 5-7
+ *
+ * varint is LEB128; zigzag is a signed value mapped to a varint as
+ * (v << 1) ^ (v >> 31).
+ */
+
+#define SENSOR_STREAM_PACKET_FRAMES     0x01
+
+// Flag bits of the last frame byte
+#define SENSOR_STREAM_FLAG_FLEX_VALID   (1 << 5)
+#define SENSOR_STREAM_FLAG_IMU_VALID    (1 << 6)
+#define SENSOR_STREAM_FLAG_TOUCH_VALID  (1 << 7)
+
+/**
+ * @brief Stream counters since boot
+ */
+typedef struct {
+    uint32_t frames_sent;        // Frames delivered to the stack
+    uint32_t frames_dropped;     // Overwritten under backpressure or too big for the MTU
+    uint32_t packets_sent;       // Notifications sent
+    uint32_t failed_sends;       // Sends refused by the stack, retried later
+} sensor_stream_stats_t;
+
+/**
+ * @brief Initialize the stream and start its send task
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t sensor_stream_init(void);
+
+/**
+ * @brief Queue one published sensor frame
+ *
+ * Only for the sensor task; returns at once when nobody is subscribed
+ * and never blocks.
+ *
+ * @param frame Frame being published
+ */
+void sensor_stream_record(const sensor_data_t *frame);
+
+/**
+ * @brief Get the stream counters
+ *
+ * @param stats Pointer to store the counters
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t sensor_stream_get_stats(sensor_stream_stats_t *stats);
+
+#endif /* CORE_SENSOR_STREAM_H */
@@ -0,0 +1,63 @@
+#include "core/stream_codec.h"
+#include <string.h>
+#include "core/sensor_stream.h"
+
+static size_t put_varint(uint8_t *out, uint32_t value) {
+    size_t len = 0;
+    while (value >= 0x80) {
+        out[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[len++] = (uint8_t)value;
+    return len;
+}
+
+static size_t put_zigzag(uint8_t *out, int32_t value) {
+    return put_varint(out, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+// One frame as the difference to the previous one
+static size_t encode_frame(const trace_record_t *record, const trace_record_t *previous, uint8_t *out) {
+    size_t len = 0;
+    len += put_varint(out + len, record->sequence - previous->sequence);
+    len += put_varint(out + len, record->timestamp_ms - previous->timestamp_ms);
+
+    for (int i = 0; i < 10; i++) {
+        len += put_zigzag(out + len, (int32_t)record->flex_raw[i] - previous->flex_raw[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        len += put_zigzag(out + len, (int32_t)record->accel[i] - previous->accel[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        len += put_zigzag(out + len, (int32_t)record->gyro[i] - previous->gyro[i]);
+    }
+
+    out[len++] = (record->touch_mask & 0x1F) |
+                 ((record->valid_mask & TRACE_RECORD_FLEX_VALID) ? SENSOR_STREAM_FLAG_FLEX_VALID : 0) |
+                 ((record->valid_mask & TRACE_RECORD_IMU_VALID) ? SENSOR_STREAM_FLAG_IMU_VALID : 0) |
+                 ((record->valid_mask & TRACE_RECORD_TOUCH_VALID) ? SENSOR_STREAM_FLAG_TOUCH_VALID : 0);
+    return len;
+}
+
+size_t stream_codec_encode_packet(const trace_record_t *records, uint32_t count,
+                                  uint8_t *packet, size_t size, uint32_t *encoded) {
+    static const trace_record_t zero;
+    const trace_record_t *previous = &zero;
+    uint8_t frame[STREAM_CODEC_MAX_FRAME_BYTES];
+    size_t len = 0;
+    uint32_t n = 0;
+
+    packet[len++] = SENSOR_STREAM_PACKET_FRAMES;
+    while (n < count) {
+        size_t frame_len = encode_frame(&records[n], previous, frame);
+        if (len + frame_len > size) {
+            break;
+        }
+        memcpy(packet + len, frame, frame_len);
+        len += frame_len;
+        previous = &records[n++];
+    }
+
+    *encoded = n;
+    return len;
+}
@@ -0,0 +1,32 @@
+#ifndef CORE_STREAM_CODEC_H
+#define CORE_STREAM_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "core/trace_recorder.h"
+
+/**
+ * @brief Delta/varint packing of sensor frames for the raw stream
+ *
+ * Kept apart from the stream task so the host bench can check it. The
+ * packet layout is documented in core/sensor_stream.h.
+ */
+
+#define STREAM_CODEC_AXES               16      // 10 flex, 3 accel, 3 gyro
+#define STREAM_CODEC_MAX_FRAME_BYTES    (5 + 5 + STREAM_CODEC_AXES * 3 + 1)
+#define STREAM_CODEC_MIN_FRAME_BYTES    (1 + 1 + STREAM_CODEC_AXES + 1)
+
+/**
+ * @brief Pack as many frames as fit into one packet
+ *
+ * @param records Frames, oldest first
+ * @param count Number of frames
+ * @param packet Output buffer
+ * @param size Size of the output buffer, at least 1
+ * @param encoded Set to the number of frames packed
+ * @return Packet length in bytes
+ */
+size_t stream_codec_encode_packet(const trace_record_t *records, uint32_t count,
+                                  uint8_t *packet, size_t size, uint32_t *encoded);
+
+#endif /* CORE_STREAM_CODEC_H */
@@ -7,32 +7,62 @@
 #include "esp_timer.h"
 #include "esp_heap_caps.h"
 #include "util/debug.h"
+#include "util/scratch_arena.h"
+#include "util/heap_guard.h"
+#include "core/telemetry.h"
+#include "config/memory_layout.h"
+#include "ml_inference.h"
 
 static const char *TAG = "SYS_MONITOR";
 
 // Task handle for the system monitor task
 static TaskHandle_t monitor_task_handle = NULL;
+STATIC_TASK_STORAGE(system_monitor_task, 2048);
 
 // Last captured metrics
 static system_metrics_t last_metrics = {0};
 
+// Sample-to-output latency per sink
+static ml_latency_histogram_t output_latency[OUTPUT_SINK_COUNT];
+
 // The monitoring interval in milliseconds
 #define MONITOR_INTERVAL_MS 5000
 
+// Per-cycle working memory of the monitor task, reset at the top of each
+// cycle: the task list and its telemetry records. With more than
+// TELEMETRY_MAX_TASKS tasks the cycle skips the CPU figures.
+static uint8_t monitor_scratch[TELEMETRY_MAX_TASKS * (sizeof(TaskStatus_t) + sizeof(telemetry_task_record_t)) + 16]
+    __attribute__((aligned(8)));
+static scratch_arena_t monitor_arena;
+
+// Run time counters of the previous cycle, to take each task's share of the interval
+static TaskHandle_t prev_handles[TELEMETRY_MAX_TASKS];
+static uint32_t prev_run_time[TELEMETRY_MAX_TASKS];
+static UBaseType_t prev_count = 0;
+static uint32_t prev_total_run_time = 0;
+static uint64_t prev_sample_ms = 0;
+static TaskHandle_t idle_handles[2];
+
+// Allocations after init already reported
+static uint32_t reported_allocations = 0;
+
 // Forward declarations
 static void system_monitor_task(void *pvParameters);
 
 esp_err_t system_monitor_init(void) {
+    scratch_arena_init(&monitor_arena, monitor_scratch, sizeof(monitor_scratch));
+    
     // Create the system monitor task
-    BaseType_t xReturned = xTaskCreate(
+    monitor_task_handle = xTaskCreateStatic(
         system_monitor_task,
         "system_monitor",
         2048,  // Stack size
         NULL,
         2,     // Priority (low)
-        &monitor_task_handle);
+        system_monitor_task_stack,
+        &system_monitor_task_tcb);
         
-    if (xReturned != pdPASS) {
+    if (monitor_task_handle == NULL) {
         ESP_LOGE(TAG, "Failed to create system monitor task");
         return ESP_FAIL;
     }
@@ -52,6 +82,24 @@ esp_err_t system_monitor_get_metrics(system_metrics_t* metrics) {
     return ESP_OK;
 }
 
+void system_monitor_record_output(output_sink_t sink, uint32_t origin_timestamp) {
+    if (sink >= OUTPUT_SINK_COUNT || origin_timestamp == 0) {
+        return;
+    }
+    
+    int64_t elapsed_us = esp_timer_get_time() - (int64_t)origin_timestamp * 1000;
+    ml_latency_record(&output_latency[sink], elapsed_us > 0 ? (uint32_t)elapsed_us : 0);
+}
+
+esp_err_t system_monitor_get_output_latency(output_sink_t sink, ml_latency_stats_t* stats) {
+    if (sink >= OUTPUT_SINK_COUNT || stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    ml_latency_summarize(&output_latency[sink], stats);
+    return ESP_OK;
+}
+
 esp_err_t system_monitor_print_metrics(void) {
     system_metrics_t metrics;
     esp_err_t ret = system_monitor_get_metrics(&metrics);
@@ -62,13 +110,54 @@ esp_err_t system_monitor_print_metrics(void) {
     ESP_LOGI(TAG, "System Metrics:");
     ESP_LOGI(TAG, "  Free Heap: %u bytes", metrics.free_heap);
     ESP_LOGI(TAG, "  Min Free Heap: %u bytes", metrics.min_free_heap);
-    ESP_LOGI(TAG, "  CPU Usage: %u%%", metrics.cpu_usage_percent);
+    ESP_LOGI(TAG, "  CPU Usage: %u%% (Core 0: %u%%, Core 1: %u%%)", metrics.cpu_usage_percent,
+        metrics.cpu_core_percent[0], metrics.cpu_core_percent[1]);
     ESP_LOGI(TAG, "  CPU Temperature: %.1f°C", metrics.cpu_temperature);
     ESP_LOGI(TAG, "  Task Count: %u", metrics.task_count);
     ESP_LOGI(TAG, "  Stack High-Water: Core 0: %u, Core 1: %u", 
         metrics.stack_high_water[0], metrics.stack_high_water[1]);
     ESP_LOGI(TAG, "  Uptime: %llu ms", metrics.uptime_ms);
     
+    // Tail latency of the pipeline stages
+    static const char *stage_names[ML_STAGE_COUNT] = {"Fusion", "Features", "Matching"};
+    for (int i = 0; i < ML_STAGE_COUNT; i++) {
+        ml_latency_stats_t latency;
+        if (ml_inference_get_stage_latency((ml_stage_t)i, &latency) == ESP_OK && latency.count > 0) {
+            ESP_LOGI(TAG, "  %s: p50 %lu us, p95 %lu us, p99 %lu us, max %lu us (%lu samples)", stage_names[i],
+                     (unsigned long)latency.p50_us, (unsigned long)latency.p95_us, (unsigned long)latency.p99_us,
+                     (unsigned long)latency.max_us, (unsigned long)latency.count);
+        }
+    }
+    
+    // End to end, from the end of a gesture to its output
+    static const char *sink_names[OUTPUT_SINK_COUNT] = {"Display", "Audio", "BLE"};
+    for (int i = 0; i < OUTPUT_SINK_COUNT; i++) {
+        ml_latency_stats_t latency;
+        if (system_monitor_get_output_latency((output_sink_t)i, &latency) == ESP_OK && latency.count > 0) {
+            ESP_LOGI(TAG, "  Gesture to %s: p50 %lu ms, p95 %lu ms, p99 %lu ms, max %lu ms (%lu samples)",
+                     sink_names[i], (unsigned long)(latency.p50_us / 1000), (unsigned long)(latency.p95_us / 1000),
+                     (unsigned long)(latency.p99_us / 1000), (unsigned long)(latency.max_us / 1000),
+                     (unsigned long)latency.count);
+        }
+    }
+    
+    // Queues that have been close to full or refused sends, and frames lost elsewhere
+    for (int i = 0; i < TELEMETRY_QUEUE_COUNT; i++) {
+        telemetry_queue_record_t queue;
+        if (telemetry_get_queue((telemetry_queue_t)i, &queue) == ESP_OK && queue.capacity > 0 &&
+            (queue.drops > 0 || queue.high_water >= queue.capacity)) {
+            ESP_LOGI(TAG, "  Queue %s: depth %u, high water %u of %u, %lu dropped",
+                     telemetry_queue_name((telemetry_queue_t)i), queue.depth, queue.high_water,
+                     queue.capacity, (unsigned long)queue.drops);
+        }
+    }
+    for (int i = 0; i < TELEMETRY_DROP_COUNT; i++) {
+        uint32_t drops = telemetry_get_drops((telemetry_drop_t)i);
+        if (drops > 0) {
+            ESP_LOGI(TAG, "  Dropped %s: %lu", telemetry_drop_name((telemetry_drop_t)i), (unsigned long)drops);
+        }
+    }
+    
     return ESP_OK;
 }
 
@@ -85,10 +174,13 @@ esp_err_t system_monitor_health_check(void) {
         return ESP_ERR_NO_MEM;
     }
     
-    // Check CPU usage (if extremely high for this kind of system)
-    if (metrics.cpu_usage_percent > 90) {
-        ESP_LOGW(TAG, "High CPU usage: %u%%", metrics.cpu_usage_percent);
-        return ESP_FAIL;
+    // Check CPU usage per core: one saturated core stalls its stages
+    // however idle the other one is
+    for (int core = 0; core < 2; core++) {
+        if (metrics.cpu_core_percent[core] > 90) {
+            ESP_LOGW(TAG, "High CPU usage on core %d: %u%%", core, metrics.cpu_core_percent[core]);
+            return ESP_FAIL;
+        }
     }
     
     // Check temperature (if supported and if too high)
@@ -104,13 +196,89 @@ void* system_monitor_get_task_handle(void) {
     return (void*)monitor_task_handle;
 }
 
+// Turns one cycle's task list into per-task shares of the interval and
+// per-core load, and hands them to telemetry
+static void update_task_telemetry(const TaskStatus_t *status, UBaseType_t count, uint32_t total_run_time) {
+    uint32_t elapsed = total_run_time - prev_total_run_time;
+    bool have_interval = prev_count > 0 && elapsed > 0;
+    
+    telemetry_task_record_t *records = scratch_arena_alloc(&monitor_arena, count * sizeof(telemetry_task_record_t),
+                                                           __alignof__(telemetry_task_record_t));
+    uint32_t idle_run_time[2] = {0, 0};
+    
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t *task = &status[i];
+        
+        // Run time over the interval, from this task's previous counter
+        uint32_t run_time = 0;
+        for (UBaseType_t j = 0; j < prev_count; j++) {
+            if (prev_handles[j] == task->xHandle) {
+                run_time = task->ulRunTimeCounter - prev_run_time[j];
+                break;
+            }
+        }
+        
+        // Idle tasks by handle: their names are not unique
+        for (int core = 0; core < 2; core++) {
+            if (task->xHandle == idle_handles[core]) {
+                idle_run_time[core] = run_time;
+            }
+        }
+        
+        // Minimum free stack for tasks on specific cores
+        if (task->xCoreID == 0 || task->xCoreID == 1) {
+            if (task->usStackHighWaterMark < last_metrics.stack_high_water[task->xCoreID] || 
+                last_metrics.stack_high_water[task->xCoreID] == 0) {
+                last_metrics.stack_high_water[task->xCoreID] = task->usStackHighWaterMark;
+            }
+        }
+        
+        if (records != NULL) {
+            telemetry_task_record_t *record = &records[i];
+            strncpy(record->name, task->pcTaskName, sizeof(record->name));
+            record->core = (task->xCoreID == 0 || task->xCoreID == 1) ? (uint8_t)task->xCoreID : TELEMETRY_CORE_ANY;
+            record->cpu_permille = have_interval ? (uint16_t)((uint64_t)run_time * 1000 / elapsed) : 0;
+            record->stack_free = (task->usStackHighWaterMark > UINT16_MAX) ? UINT16_MAX
+                                                                           : (uint16_t)task->usStackHighWaterMark;
+        }
+    }
+    
+    // Only now: the loop above still looks tasks up in the previous cycle's list
+    for (UBaseType_t i = 0; i < count; i++) {
+        prev_handles[i] = status[i].xHandle;
+        prev_run_time[i] = status[i].ulRunTimeCounter;
+    }
+    
+    uint16_t core_load[2] = {0, 0};
+    if (have_interval) {
+        // Each core runs for the whole interval, split between its idle task and the rest
+        for (int core = 0; core < 2; core++) {
+            uint32_t idle_permille = (uint32_t)((uint64_t)idle_run_time[core] * 1000 / elapsed);
+            core_load[core] = (idle_permille < 1000) ? (uint16_t)(1000 - idle_permille) : 0;
+            last_metrics.cpu_core_percent[core] = core_load[core] / 10;
+        }
+        last_metrics.cpu_usage_percent = (last_metrics.cpu_core_percent[0] + last_metrics.cpu_core_percent[1]) / 2;
+    }
+    
+    if (records != NULL) {
+        uint32_t interval_ms = have_interval ? (uint32_t)(last_metrics.uptime_ms - prev_sample_ms) : 0;
+        telemetry_publish_tasks(records, count, core_load, interval_ms);
+    }
+    
+    prev_count = count;
+    prev_total_run_time = total_run_time;
+    prev_sample_ms = last_metrics.uptime_ms;
+}
+
 // System monitor task function
 static void system_monitor_task(void *pvParameters) {
-    uint32_t task_run_time_prev[2] = {0, 0};  // Previous run time for cores
-    uint32_t idle_run_time_prev[2] = {0, 0};  // Previous idle task run time for cores
-    uint32_t total_run_time_prev = 0;         // Previous total run time
+    for (int core = 0; core < 2; core++) {
+        idle_handles[core] = xTaskGetIdleTaskHandleForCPU(core);
+    }
     
     while (1) {
+        scratch_arena_reset(&monitor_arena);
+        
         // Get current metrics
         
         // Heap metrics
@@ -123,80 +291,23 @@ static void system_monitor_task(void *pvParameters) {
         // Uptime
         last_metrics.uptime_ms = esp_timer_get_time() / 1000;
         
-        // CPU usage calculation
-        uint32_t task_run_time[2] = {0, 0};       // Run time for all tasks per core
-        uint32_t idle_run_time[2] = {0, 0};       // Run time for idle tasks per core
-        uint32_t total_run_time = 0;             // Total run time
-        
         // Get runtime stats
-        TaskStatus_t *pxTaskStatusArray;
-        volatile UBaseType_t uxArraySize, x;
-        uint32_t ulTotalRunTime;
+        UBaseType_t task_count = uxTaskGetNumberOfTasks();
+        uint32_t total_run_time = 0;
         
-        // Get the number of tasks
-        uxArraySize = uxTaskGetNumberOfTasks();
-        
-        // Allocate a TaskStatus_t structure for each task
-        pxTaskStatusArray = pvPortMalloc(uxArraySize * sizeof(TaskStatus_t));
+        // A TaskStatus_t structure for each task, from this cycle's scratch
+        TaskStatus_t *status = NULL;
+        if (task_count <= TELEMETRY_MAX_TASKS) {
+            status = scratch_arena_alloc(&monitor_arena, task_count * sizeof(TaskStatus_t),
+                                         __alignof__(TaskStatus_t));
+        }
         
-        if (pxTaskStatusArray != NULL) {
+        if (status != NULL) {
             // Generate raw status information about each task
-            uxArraySize = uxTaskGetSystemState(pxTaskStatusArray, uxArraySize, &ulTotalRunTime);
-            total_run_time = ulTotalRunTime;
-            
-            // Calculate run time for each core
-            for (x = 0; x < uxArraySize; x++) {
-                TaskStatus_t *task = &pxTaskStatusArray[x];
-                
-                // Check if it's the idle task
-                if (strcmp(task->pcTaskName, "IDLE") == 0) {
-                    // Core 0 idle task
-                    if (task->xCoreID == 0) {
-                        idle_run_time[0] = task->ulRunTimeCounter;
-                    }
-                    // Core 1 idle task
-                    else if (task->xCoreID == 1) {
-                        idle_run_time[1] = task->ulRunTimeCounter;
-                    }
-                } else {
-                    // Add to the appropriate core's total
-                    if (task->xCoreID == 0) {
-                        task_run_time[0] += task->ulRunTimeCounter;
-                    } else if (task->xCoreID == 1) {
-                        task_run_time[1] += task->ulRunTimeCounter;
-                    }
-                }
-                
-                // Check stack high water mark for tasks on specific cores
-                if (task->xCoreID == 0 || task->xCoreID == 1) {
-                    if (task->usStackHighWaterMark < last_metrics.stack_high_water[task->xCoreID] || 
-                        last_metrics.stack_high_water[task->xCoreID] == 0) {
-                        last_metrics.stack_high_water[task->xCoreID] = task->usStackHighWaterMark;
-                    }
-                }
+            task_count = uxTaskGetSystemState(status, task_count, &total_run_time);
+            if (task_count > 0) {
+                update_task_telemetry(status, task_count, total_run_time);
             }
-            
-            // Free the status array
-            vPortFree(pxTaskStatusArray);
-            
-            // Calculate CPU usage if we have previous values
-            if (total_run_time_prev > 0) {
-                uint32_t delta_time = total_run_time - total_run_time_prev;
-                uint32_t delta_idle0 = idle_run_time[0] - idle_run_time_prev[0];
-                uint32_t delta_idle1 = idle_run_time[1] - idle_run_time_prev[1];
-                
-                // Calculate the CPU usage for each core and average them
-                uint32_t usage0 = 100 - ((delta_idle0 * 100) / (delta_time / 2));
-                uint32_t usage1 = 100 - ((delta_idle1 * 100) / (delta_time / 2));
-                last_metrics.cpu_usage_percent = (usage0 + usage1) / 2;
-            }
-            
-            // Store current values for next calculation
-            task_run_time_prev[0] = task_run_time[0];
-            task_run_time_prev[1] = task_run_time[1];
-            idle_run_time_prev[0] = idle_run_time[0];
-            idle_run_time_prev[1] = idle_run_time[1];
-            total_run_time_prev = total_run_time;
         }
         
         // CPU temperature (example - not supported on all ESP32 versions/boards)
@@ -210,6 +321,15 @@ static void system_monitor_task(void *pvParameters) {
             log_counter = 0;
         }
         
+        // Steady state should not touch the heap; say so when something did
+        heap_guard_stats_t heap_stats;
+        if (heap_guard_get_stats(&heap_stats) == ESP_OK && heap_stats.allocations != reported_allocations) {
+            ESP_LOGW(TAG, "%lu heap allocations since init (%lu bytes, largest %lu)",
+                     (unsigned long)heap_stats.allocations, (unsigned long)heap_stats.bytes,
+                     (unsigned long)heap_stats.largest);
+            reported_allocations = heap_stats.allocations;
+        }
+        
         // Run health check
         esp_err_t health_result = system_monitor_health_check();
         if (health_result != ESP_OK) {
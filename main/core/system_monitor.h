@@ -1,7 +1,9 @@
 #ifndef CORE_SYSTEM_MONITOR_H
 #define CORE_SYSTEM_MONITOR_H
 
+#include <stdint.h>
 #include "esp_err.h"
+#include "ml_latency.h"
 
 /**
  * @brief System performance metrics
@@ -9,13 +11,24 @@
 typedef struct {
     uint32_t free_heap;            // Free heap memory in bytes
     uint32_t min_free_heap;        // Minimum free heap size since boot
-    uint32_t cpu_usage_percent;    // CPU usage percentage (0-100)
+    uint32_t cpu_usage_percent;    // CPU usage percentage (0-100), average of both cores
+    uint32_t cpu_core_percent[2];  // CPU usage of core 0 and 1
     float cpu_temperature;         // CPU temperature in Celsius
     uint32_t task_count;           // Number of tasks running
     uint32_t stack_high_water[2];  // Minimum free stack for core 0 and 1
     uint64_t uptime_ms;            // System uptime in milliseconds
 } system_metrics_t;
 
+/**
+ * @brief Output sinks whose end-to-end latency is tracked
+ */
+typedef enum {
+    OUTPUT_SINK_DISPLAY = 0,       // Display flush done
+    OUTPUT_SINK_AUDIO,             // First I2S write of the utterance
+    OUTPUT_SINK_BLE,               // Text notification queued
+    OUTPUT_SINK_COUNT              // Number of sinks
+} output_sink_t;
+
 /**
  * @brief Initialize system monitor
  * 
@@ -31,6 +44,26 @@ esp_err_t system_monitor_init(void);
  */
 esp_err_t system_monitor_get_metrics(system_metrics_t* metrics);
 
+/**
+ * @brief Record that a gesture reached an output sink
+ * 
+ * The latency is taken from the sample time the gesture ended at to now.
+ * Lock-free, safe from any task.
+ * 
+ * @param sink Output sink
+ * @param origin_timestamp Sample time in milliseconds, 0 for output not caused by a gesture (ignored)
+ */
+void system_monitor_record_output(output_sink_t sink, uint32_t origin_timestamp);
+
+/**
+ * @brief Get the sample-to-output latency distribution of a sink
+ * 
+ * @param sink Output sink
+ * @param stats Pointer to store the percentiles
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t system_monitor_get_output_latency(output_sink_t sink, ml_latency_stats_t* stats);
+
 /**
  * @brief Print system metrics to log
  * 
@@ -0,0 +1,229 @@
+#include "core/telemetry.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "TELEMETRY";
+
+static const char *queue_names[TELEMETRY_QUEUE_COUNT] = {
+    [TELEMETRY_QUEUE_SENSOR_DATA]           = "sensor_data",
+    [TELEMETRY_QUEUE_PROCESSING_RESULT]     = "processing_result",
+    [TELEMETRY_QUEUE_OUTPUT_COMMAND]        = "output_command",
+    [TELEMETRY_QUEUE_POWER_COMMAND]         = "power_command",
+    [TELEMETRY_QUEUE_COMMUNICATION_COMMAND] = "comm_command",
+    [TELEMETRY_QUEUE_AUDIO_COMMAND]         = "audio_command",
+    [TELEMETRY_QUEUE_TEMPLATE_PERSIST]      = "template_persist",
+    [TELEMETRY_QUEUE_IMAGE_TRANSFER]        = "image_transfer",
+};
+
+static const char *drop_names[TELEMETRY_DROP_COUNT] = {
+    [TELEMETRY_DROP_SENSOR_FRAME]    = "sensor_frame",
+    [TELEMETRY_DROP_ALIGNED_FRAME]   = "aligned_frame",
+    [TELEMETRY_DROP_FEATURE_FRAME]   = "feature_frame",
+    [TELEMETRY_DROP_CAMERA_ROI]      = "camera_roi",
+    [TELEMETRY_DROP_DECODER_SEGMENT] = "decoder_segment",
+    [TELEMETRY_DROP_HAND_FRAME]      = "hand_frame",
+    [TELEMETRY_DROP_TRANSFER_CHUNK]  = "transfer_chunk",
+};
+
+typedef struct {
+    QueueHandle_t _Atomic handle;
+    atomic_uint_least32_t capacity;
+    atomic_uint_least32_t high_water;
+    atomic_uint_least32_t drops;
+} queue_slot_t;
+
+static queue_slot_t queues[TELEMETRY_QUEUE_COUNT];
+static atomic_uint_least32_t drops[TELEMETRY_DROP_COUNT];
+static spsc_ring_t *_Atomic drop_rings[TELEMETRY_DROP_COUNT];
+
+// Task figures of the last monitor interval, under task_lock
+static portMUX_TYPE task_lock = portMUX_INITIALIZER_UNLOCKED;
+static telemetry_task_record_t task_records[TELEMETRY_MAX_TASKS];
+static size_t task_count = 0;
+static uint16_t core_load[2] = {0, 0};
+static uint32_t task_interval_ms = 0;
+
+esp_err_t telemetry_register_queue(telemetry_queue_t id, QueueHandle_t queue) {
+    if (id >= TELEMETRY_QUEUE_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    queue_slot_t *slot = &queues[id];
+    uint32_t capacity = 0;
+    if (queue != NULL) {
+        capacity = uxQueueSpacesAvailable(queue) + uxQueueMessagesWaiting(queue);
+    }
+
+    atomic_store(&slot->capacity, capacity);
+    atomic_store(&slot->handle, queue);
+    return ESP_OK;
+}
+
+esp_err_t telemetry_register_ring(telemetry_drop_t drop, spsc_ring_t *ring) {
+    if (drop >= TELEMETRY_DROP_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    atomic_store(&drop_rings[drop], ring);
+    return ESP_OK;
+}
+
+// Counts the outcome of one send on a registered queue
+static BaseType_t track_send(queue_slot_t *slot, QueueHandle_t queue, BaseType_t sent) {
+    if (sent != pdTRUE) {
+        atomic_fetch_add_explicit(&slot->drops, 1, memory_order_relaxed);
+        return sent;
+    }
+
+    uint_least32_t depth = uxQueueMessagesWaiting(queue);
+    uint_least32_t seen = atomic_load_explicit(&slot->high_water, memory_order_relaxed);
+    while (depth > seen &&
+           !atomic_compare_exchange_weak_explicit(&slot->high_water, &seen, depth,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+
+    return sent;
+}
+
+BaseType_t telemetry_queue_send(telemetry_queue_t id, const void *item, TickType_t ticks_to_wait) {
+    if (id >= TELEMETRY_QUEUE_COUNT) {
+        return errQUEUE_FULL;
+    }
+
+    queue_slot_t *slot = &queues[id];
+    QueueHandle_t queue = atomic_load(&slot->handle);
+    if (queue == NULL) {
+        atomic_fetch_add_explicit(&slot->drops, 1, memory_order_relaxed);
+        return errQUEUE_FULL;
+    }
+
+    return track_send(slot, queue, xQueueSend(queue, item, ticks_to_wait));
+}
+
+BaseType_t telemetry_queue_send_to_front(telemetry_queue_t id, const void *item, TickType_t ticks_to_wait) {
+    if (id >= TELEMETRY_QUEUE_COUNT) {
+        return errQUEUE_FULL;
+    }
+
+    queue_slot_t *slot = &queues[id];
+    QueueHandle_t queue = atomic_load(&slot->handle);
+    if (queue == NULL) {
+        atomic_fetch_add_explicit(&slot->drops, 1, memory_order_relaxed);
+        return errQUEUE_FULL;
+    }
+
+    return track_send(slot, queue, xQueueSendToFront(queue, item, ticks_to_wait));
+}
+
+void telemetry_count_drop(telemetry_drop_t drop) {
+    if (drop < TELEMETRY_DROP_COUNT) {
+        atomic_fetch_add_explicit(&drops[drop], 1, memory_order_relaxed);
+    }
+}
+
+void telemetry_publish_tasks(const telemetry_task_record_t *tasks, size_t count,
+                             const uint16_t core_load_permille[2], uint32_t interval_ms) {
+    if (tasks == NULL && count > 0) {
+        return;
+    }
+    if (count > TELEMETRY_MAX_TASKS) {
+        count = TELEMETRY_MAX_TASKS;
+    }
+
+    taskENTER_CRITICAL(&task_lock);
+    memcpy(task_records, tasks, count * sizeof(telemetry_task_record_t));
+    task_count = count;
+    core_load[0] = core_load_permille[0];
+    core_load[1] = core_load_permille[1];
+    task_interval_ms = interval_ms;
+    taskEXIT_CRITICAL(&task_lock);
+}
+
+esp_err_t telemetry_get_queue(telemetry_queue_t id, telemetry_queue_record_t *record) {
+    if (id >= TELEMETRY_QUEUE_COUNT || record == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    queue_slot_t *slot = &queues[id];
+    QueueHandle_t queue = atomic_load(&slot->handle);
+    uint32_t high_water = atomic_load(&slot->high_water);
+    uint32_t capacity = atomic_load(&slot->capacity);
+
+    record->depth = (queue != NULL) ? (uint8_t)uxQueueMessagesWaiting(queue) : 0;
+    record->high_water = (high_water > UINT8_MAX) ? UINT8_MAX : (uint8_t)high_water;
+    record->capacity = (capacity > UINT8_MAX) ? UINT8_MAX : (uint8_t)capacity;
+    record->drops = atomic_load(&slot->drops);
+    return ESP_OK;
+}
+
+uint32_t telemetry_get_drops(telemetry_drop_t drop) {
+    if (drop >= TELEMETRY_DROP_COUNT) {
+        return 0;
+    }
+
+    spsc_ring_t *ring = atomic_load(&drop_rings[drop]);
+    return atomic_load(&drops[drop]) + ((ring != NULL) ? spsc_ring_get_dropped(ring) : 0);
+}
+
+const char* telemetry_queue_name(telemetry_queue_t id) {
+    return (id < TELEMETRY_QUEUE_COUNT) ? queue_names[id] : "unknown";
+}
+
+const char* telemetry_drop_name(telemetry_drop_t drop) {
+    return (drop < TELEMETRY_DROP_COUNT) ? drop_names[drop] : "unknown";
+}
+
+esp_err_t telemetry_snapshot(uint8_t *buffer, size_t size, size_t *length) {
+    if (buffer == NULL || length == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    telemetry_snapshot_header_t header = {
+        .version = TELEMETRY_SNAPSHOT_VERSION,
+        .queue_count = TELEMETRY_QUEUE_COUNT,
+        .drop_count = TELEMETRY_DROP_COUNT,
+        .uptime_ms = (uint32_t)(esp_timer_get_time() / 1000),
+    };
+
+    // Task records go straight into place; the header is written last
+    taskENTER_CRITICAL(&task_lock);
+    size_t tasks = task_count;
+    size_t needed = sizeof(header) + tasks * sizeof(telemetry_task_record_t) +
+                    TELEMETRY_QUEUE_COUNT * sizeof(telemetry_queue_record_t) +
+                    TELEMETRY_DROP_COUNT * sizeof(uint32_t);
+    if (needed <= size) {
+        memcpy(buffer + sizeof(header), task_records, tasks * sizeof(telemetry_task_record_t));
+        header.interval_ms = (task_interval_ms > UINT16_MAX) ? UINT16_MAX : (uint16_t)task_interval_ms;
+        header.core_load_permille[0] = core_load[0];
+        header.core_load_permille[1] = core_load[1];
+    }
+    taskEXIT_CRITICAL(&task_lock);
+
+    if (needed > size) {
+        ESP_LOGW(TAG, "Snapshot needs %u bytes, buffer has %u", (unsigned)needed, (unsigned)size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    header.task_count = (uint8_t)tasks;
+    memcpy(buffer, &header, sizeof(header));
+
+    size_t offset = sizeof(header) + tasks * sizeof(telemetry_task_record_t);
+    for (int i = 0; i < TELEMETRY_QUEUE_COUNT; i++) {
+        telemetry_queue_record_t record;
+        telemetry_get_queue((telemetry_queue_t)i, &record);
+        memcpy(buffer + offset, &record, sizeof(record));
+        offset += sizeof(record);
+    }
+
+    for (int i = 0; i < TELEMETRY_DROP_COUNT; i++) {
+        uint32_t count = telemetry_get_drops((telemetry_drop_t)i);
+        memcpy(buffer + offset, &count, sizeof(count));
+        offset += sizeof(count);
+    }
+
+    *length = offset;
+    return ESP_OK;
+}
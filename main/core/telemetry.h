@@ -0,0 +1,208 @@
+#ifndef CORE_TELEMETRY_H
+#define CORE_TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "config/system_config.h"
+#include "util/spsc_ring.h"
+
+/**
+ * @brief Pipeline telemetry: where time goes and where frames are lost
+ *
+ * Three kinds of figures, all cheap enough for the hot path:
+ *  - per task, its share of a core over the last monitor interval and its
+ *    minimum free stack, published by the system monitor;
+ *  - per registered queue, its current depth, the deepest it has been and
+ *    the sends refused because it was full;
+ *  - named drop counters for the places that lose a frame without a queue.
+ *
+ * Sends to registered queues go through telemetry_queue_send() so every
+ * refused send is counted. All of it is read back as one snapshot, sent
+ * over BLE on request:
+ *
+ *   telemetry_snapshot_header_t
+ *   telemetry_task_record_t[task_count]
+ *   telemetry_queue_record_t[queue_count], in telemetry_queue_t order
+ *   u32 drops[drop_count], in telemetry_drop_t order
+ *
+ * Multi-byte fields are little-endian. Clients must use the counts in the
+ * header, not this firmware's enums, to walk the snapshot.
+ */
+
+#define TELEMETRY_SNAPSHOT_VERSION  1
+#define TELEMETRY_CORE_ANY          0xFF    // Task record core of an unpinned task
+
+/**
+ * @brief Queues tracked by the registry
+ */
+typedef enum {
+    TELEMETRY_QUEUE_SENSOR_DATA = 0,        // Sensor task to fusion, frame pool indices
+    TELEMETRY_QUEUE_PROCESSING_RESULT,      // Classify stage to output task
+    TELEMETRY_QUEUE_OUTPUT_COMMAND,         // Anyone to output task
+    TELEMETRY_QUEUE_POWER_COMMAND,          // System commands for the power task
+    TELEMETRY_QUEUE_COMMUNICATION_COMMAND,  // System commands for the communication task
+    TELEMETRY_QUEUE_AUDIO_COMMAND,          // Output task to audio task
+    TELEMETRY_QUEUE_TEMPLATE_PERSIST,       // Enrolled templates waiting for flash
+    TELEMETRY_QUEUE_IMAGE_TRANSFER,         // BLE image chunks waiting for flash
+    TELEMETRY_QUEUE_COUNT
+} telemetry_queue_t;
+
+/**
+ * @brief Frames lost outside a queue
+ */
+typedef enum {
+    TELEMETRY_DROP_SENSOR_FRAME = 0,    // No free frame pool slot for a sample
+    TELEMETRY_DROP_ALIGNED_FRAME,       // Feature stage behind, aligned ring full
+    TELEMETRY_DROP_FEATURE_FRAME,       // Classify stage behind, feature ring full
+    TELEMETRY_DROP_CAMERA_ROI,          // ROI replaced before the sensor task took it
+    TELEMETRY_DROP_DECODER_SEGMENT,     // Decoder event queue full
+    TELEMETRY_DROP_HAND_FRAME,          // Second-glove frame not sent, or rejected by the primary
+    TELEMETRY_DROP_TRANSFER_CHUNK,      // Image chunk arrived with the transfer queue full
+    TELEMETRY_DROP_COUNT
+} telemetry_drop_t;
+
+/**
+ * @brief Snapshot header
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t version;                    // TELEMETRY_SNAPSHOT_VERSION
+    uint8_t task_count;
+    uint8_t queue_count;
+    uint8_t drop_count;
+    uint32_t uptime_ms;
+    uint16_t interval_ms;               // Interval the task shares cover, 0 before the first
+    uint16_t core_load_permille[2];     // Busy time of core 0 and 1 over the interval
+} telemetry_snapshot_header_t;
+
+/**
+ * @brief One task over the last monitor interval
+ */
+typedef struct __attribute__((packed)) {
+    char name[TELEMETRY_TASK_NAME_LEN]; // Truncated, not NUL-terminated when full
+    uint8_t core;                       // 0, 1 or TELEMETRY_CORE_ANY
+    uint16_t cpu_permille;              // Share of one core
+    uint16_t stack_free;                // Minimum free stack since start, bytes
+} telemetry_task_record_t;
+
+/**
+ * @brief One queue
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t depth;                      // Items waiting now
+    uint8_t high_water;                 // Most items waiting after a send since boot
+    uint8_t capacity;                   // 0 if the queue does not exist (yet)
+    uint32_t drops;                     // Sends refused because the queue was full
+} telemetry_queue_record_t;
+
+#define TELEMETRY_SNAPSHOT_MAX  (sizeof(telemetry_snapshot_header_t) +                        \
+                                 TELEMETRY_MAX_TASKS * sizeof(telemetry_task_record_t) +      \
+                                 TELEMETRY_QUEUE_COUNT * sizeof(telemetry_queue_record_t) +   \
+                                 TELEMETRY_DROP_COUNT * sizeof(uint32_t))
+
+/**
+ * @brief Track a queue under an ID
+ *
+ * Called right after the queue is created, and with NULL when it is
+ * deleted. Counters survive re-registration.
+ *
+ * @param id Queue ID
+ * @param queue Queue handle, or NULL
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t telemetry_register_queue(telemetry_queue_t id, QueueHandle_t queue);
+
+/**
+ * @brief Report the writes a ring refused under a drop counter
+ *
+ * The ring keeps the count itself, so its producer does not also call
+ * telemetry_count_drop().
+ *
+ * @param drop Drop counter
+ * @param ring Ring, or NULL to stop reporting it
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t telemetry_register_ring(telemetry_drop_t drop, spsc_ring_t *ring);
+
+/**
+ * @brief Send to the back of a registered queue
+ *
+ * xQueueSend() that counts a refused send as a drop and keeps the high
+ * watermark. Not for ISRs.
+ *
+ * @param id Queue ID
+ * @param item Item to copy into the queue
+ * @param ticks_to_wait Longest to wait for space
+ * @return pdTRUE if sent, errQUEUE_FULL otherwise (also for an unregistered queue)
+ */
+BaseType_t telemetry_queue_send(telemetry_queue_t id, const void *item, TickType_t ticks_to_wait);
+
+/**
+ * @brief Send to the front of a registered queue
+ *
+ * As telemetry_queue_send(), for xQueueSendToFront().
+ */
+BaseType_t telemetry_queue_send_to_front(telemetry_queue_t id, const void *item, TickType_t ticks_to_wait);
+
+/**
+ * @brief Count a frame lost outside a queue
+ *
+ * Lock-free, safe from any task or ISR.
+ *
+ * @param drop Drop counter
+ */
+void telemetry_count_drop(telemetry_drop_t drop);
+
+/**
+ * @brief Replace the task figures with those of the last interval
+ *
+ * Only for the system monitor.
+ *
+ * @param tasks Task records
+ * @param count Number of records, at most TELEMETRY_MAX_TASKS are kept
+ * @param core_load_permille Busy time of core 0 and 1
+ * @param interval_ms Interval the figures cover
+ */
+void telemetry_publish_tasks(const telemetry_task_record_t *tasks, size_t count,
+                             const uint16_t core_load_permille[2], uint32_t interval_ms);
+
+/**
+ * @brief Get the figures of one queue
+ *
+ * @param id Queue ID
+ * @param record Pointer to store the figures
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t telemetry_get_queue(telemetry_queue_t id, telemetry_queue_record_t *record);
+
+/**
+ * @brief Get one drop counter
+ *
+ * @param drop Drop counter
+ * @return Drops since boot
+ */
+uint32_t telemetry_get_drops(telemetry_drop_t drop);
+
+/**
+ * @brief Get the name of a queue, for logs
+ */
+const char* telemetry_queue_name(telemetry_queue_t id);
+
+/**
+ * @brief Get the name of a drop counter, for logs
+ */
+const char* telemetry_drop_name(telemetry_drop_t drop);
+
+/**
+ * @brief Encode everything as one snapshot
+ *
+ * @param buffer Output buffer, TELEMETRY_SNAPSHOT_MAX bytes always suffice
+ * @param size Size of the buffer
+ * @param length Pointer to store the snapshot length
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if the buffer is too small
+ */
+esp_err_t telemetry_snapshot(uint8_t *buffer, size_t size, size_t *length);
+
+#endif /* CORE_TELEMETRY_H */
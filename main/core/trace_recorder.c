@@ -0,0 +1,260 @@
+#include "core/trace_recorder.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "config/system_config.h"
+#include "config/memory_layout.h"
+
+static const char *TAG = "TRACE_RECORDER";
+
+#define PAGE_RECORDS        (TRACE_RECORDER_PAGE_SIZE / sizeof(trace_record_t))
+#define GRAVITY_EARTH       9.80665f
+
+typedef enum {
+    RECORDER_IDLE = 0,           // No file open
+    RECORDER_RECORDING,          // Sensor task appends records
+    RECORDER_STOPPING,           // Sensor task hands over its partial page on its next frame
+    RECORDER_CLOSING             // Flush task writes the last page and closes the file
+} recorder_state_t;
+
+typedef struct {
+    trace_record_t records[PAGE_RECORDS];
+    uint32_t count;
+} trace_page_t;
+
+// Double buffer: the sensor task fills pages[active_page], the flush task
+// owns any page marked busy until it has been written
+static trace_page_t pages[2];
+static atomic_bool page_busy[2];
+static uint8_t active_page = 0;
+
+static atomic_int recorder_state = RECORDER_IDLE;
+static FILE *trace_file = NULL;
+static TaskHandle_t flush_task_handle = NULL;
+STATIC_TASK_STORAGE(flush_task, TRACE_RECORDER_STACK_SIZE);
+
+static atomic_uint_least32_t record_count;
+static atomic_uint_least32_t dropped_count;
+static atomic_uint_least32_t bytes_written;
+
+static inline int16_t to_fixed(float value, float scale) {
+    float scaled = value * scale;
+    if (scaled >= 32767.0f) {
+        return INT16_MAX;
+    } else if (scaled <= -32768.0f) {
+        return INT16_MIN;
+    }
+    return (int16_t)(scaled + (scaled >= 0.0f ? 0.5f : -0.5f));
+}
+
+static inline uint16_t age_ms(uint32_t now, uint32_t sample) {
+    uint32_t age = now - sample;
+    return (age > UINT16_MAX) ? UINT16_MAX : (uint16_t)age;
+}
+
+// Flash writes happen here, at the lowest priority in the system
+static void flush_task(void *arg) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Read first: the sensor task marks the last page busy before it asks to close
+        bool closing = atomic_load(&recorder_state) == RECORDER_CLOSING;
+
+        for (int i = 0; i < 2; i++) {
+            if (!atomic_load_explicit(&page_busy[i], memory_order_acquire)) {
+                continue;
+            }
+
+            size_t bytes = pages[i].count * sizeof(trace_record_t);
+            if (trace_file != NULL && fwrite(pages[i].records, 1, bytes, trace_file) != bytes) {
+                ESP_LOGE(TAG, "Trace write failed (storage full?), stopping");
+                int expected = RECORDER_RECORDING;
+                atomic_compare_exchange_strong(&recorder_state, &expected, RECORDER_STOPPING);
+            } else {
+                atomic_fetch_add(&bytes_written, bytes);
+            }
+            atomic_store_explicit(&page_busy[i], false, memory_order_release);
+        }
+
+        if (closing) {
+            if (trace_file != NULL) {
+                fclose(trace_file);
+                trace_file = NULL;
+            }
+            ESP_LOGI(TAG, "Trace closed: %lu records, %lu dropped, %lu bytes",
+                     (unsigned long)atomic_load(&record_count), (unsigned long)atomic_load(&dropped_count),
+                     (unsigned long)atomic_load(&bytes_written));
+            atomic_store(&recorder_state, RECORDER_IDLE);
+        }
+    }
+}
+
+// Hand the active page to the flush task; false while it still holds the other one
+static bool swap_page(void) {
+    uint8_t other = active_page ^ 1;
+    if (atomic_load_explicit(&page_busy[other], memory_order_acquire)) {
+        return false;
+    }
+
+    atomic_store_explicit(&page_busy[active_page], true, memory_order_release);
+    xTaskNotifyGive(flush_task_handle);
+
+    active_page = other;
+    pages[active_page].count = 0;
+    return true;
+}
+
+// Sensor task side of trace_recorder_stop()
+static void finish_recording(void) {
+    if (atomic_load_explicit(&page_busy[active_page ^ 1], memory_order_acquire)) {
+        return;  // Writer still behind, try again on the next frame
+    }
+
+    if (pages[active_page].count > 0) {
+        atomic_store_explicit(&page_busy[active_page], true, memory_order_release);
+        active_page ^= 1;
+        pages[active_page].count = 0;
+    }
+    atomic_store(&recorder_state, RECORDER_CLOSING);
+    xTaskNotifyGive(flush_task_handle);
+}
+
+esp_err_t trace_recorder_init(void) {
+    if (flush_task_handle != NULL) {
+        return ESP_OK;
+    }
+
+    atomic_init(&page_busy[0], false);
+    atomic_init(&page_busy[1], false);
+    atomic_store(&recorder_state, RECORDER_IDLE);
+
+    flush_task_handle = STATIC_TASK_CREATE_PINNED(flush_task, "trace_flush", TRACE_RECORDER_STACK_SIZE,
+                                                  NULL, TRACE_RECORDER_PRIORITY, TRACE_RECORDER_CORE);
+    if (flush_task_handle == NULL) {
+        ESP_LOGE(TAG, "Failed to create trace flush task");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Trace recorder initialized (%u records per page)", (unsigned)PAGE_RECORDS);
+    return ESP_OK;
+}
+
+esp_err_t trace_recorder_start(const char *path) {
+    if (flush_task_handle == NULL || atomic_load(&recorder_state) != RECORDER_IDLE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (path == NULL) {
+        path = TRACE_RECORDER_PATH;
+    }
+
+    trace_file = fopen(path, "wb");
+    if (trace_file == NULL) {
+        ESP_LOGE(TAG, "Failed to create %s", path);
+        return ESP_FAIL;
+    }
+
+    trace_file_header_t header = {
+        .magic = TRACE_FILE_MAGIC,
+        .version = TRACE_FILE_VERSION,
+        .record_size = sizeof(trace_record_t),
+        .start_time_ms = (uint32_t)(esp_timer_get_time() / 1000)
+    };
+    if (fwrite(&header, sizeof(header), 1, trace_file) != 1) {
+        fclose(trace_file);
+        trace_file = NULL;
+        return ESP_FAIL;
+    }
+
+    atomic_store(&record_count, 0);
+    atomic_store(&dropped_count, 0);
+    atomic_store(&bytes_written, sizeof(header));
+
+    // The flush task is idle, so both pages are free
+    pages[active_page].count = 0;
+    atomic_store(&recorder_state, RECORDER_RECORDING);
+
+    ESP_LOGI(TAG, "Recording sensor trace to %s", path);
+    return ESP_OK;
+}
+
+esp_err_t trace_recorder_stop(void) {
+    int expected = RECORDER_RECORDING;
+    if (!atomic_compare_exchange_strong(&recorder_state, &expected, RECORDER_STOPPING)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return ESP_OK;
+}
+
+void trace_recorder_encode(const sensor_data_t *frame, trace_record_t *record) {
+    uint32_t now = frame->timestamp;
+
+    record->sequence = frame->sequence_number;
+    record->timestamp_ms = now;
+    record->flex_age_ms = age_ms(now, frame->flex_data.timestamp);
+    record->imu_age_ms = age_ms(now, frame->imu_data.timestamp);
+    record->touch_age_ms = age_ms(now, frame->touch_data.timestamp);
+
+    memcpy(record->flex_raw, frame->flex_data.raw_values, sizeof(record->flex_raw));
+    for (int i = 0; i < 10; i++) {
+        record->flex_angle[i] = to_fixed(frame->flex_data.angles[i], 100.0f);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        record->accel[i] = to_fixed(frame->imu_data.accel[i], 1000.0f / GRAVITY_EARTH);
+        record->gyro[i] = to_fixed(frame->imu_data.gyro[i], 10.0f);
+    }
+
+    uint8_t touch_mask = 0;
+    for (int i = 0; i < 5; i++) {
+        if (frame->touch_data.touch_status[i]) {
+            touch_mask |= 1 << i;
+        }
+    }
+    record->touch_mask = touch_mask;
+
+    record->valid_mask = (frame->flex_data_valid ? TRACE_RECORD_FLEX_VALID : 0) |
+                         (frame->imu_data_valid ? TRACE_RECORD_IMU_VALID : 0) |
+                         (frame->touch_data_valid ? TRACE_RECORD_TOUCH_VALID : 0) |
+                         (frame->imu_data.motion ? TRACE_RECORD_IMU_MOTION : 0);
+}
+
+void trace_recorder_record(const sensor_data_t *frame) {
+    int state = atomic_load_explicit(&recorder_state, memory_order_relaxed);
+    if (state != RECORDER_RECORDING) {
+        if (state == RECORDER_STOPPING) {
+            finish_recording();
+        }
+        return;
+    }
+
+    // A page left full because the writer was behind goes out first
+    if (pages[active_page].count == PAGE_RECORDS && !swap_page()) {
+        atomic_fetch_add_explicit(&dropped_count, 1, memory_order_relaxed);
+        return;
+    }
+
+    trace_page_t *page = &pages[active_page];
+    trace_recorder_encode(frame, &page->records[page->count++]);
+    atomic_fetch_add_explicit(&record_count, 1, memory_order_relaxed);
+
+    if (page->count == PAGE_RECORDS) {
+        swap_page();
+    }
+}
+
+esp_err_t trace_recorder_get_stats(trace_recorder_stats_t *stats) {
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    stats->recording = atomic_load(&recorder_state) == RECORDER_RECORDING;
+    stats->records = atomic_load(&record_count);
+    stats->dropped = atomic_load(&dropped_count);
+    stats->bytes_written = atomic_load(&bytes_written);
+    return ESP_OK;
+}
@@ -0,0 +1,125 @@
+#ifndef CORE_TRACE_RECORDER_H
+#define CORE_TRACE_RECORDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "util/buffer.h"
+
+/**
+ * @brief Binary sensor trace recorder
+ *
+ * Every frame the sensor task publishes is packed into a fixed-size
+ * record and appended to one of two RAM pages. A full page is handed to a
+ * low-priority task that writes it to a file on the storage partition
+ * while the sensor task fills the other one. If the writer still holds
+ * its page when the next one fills, new records are dropped and counted
+ * until it catches up; the sensor task never waits on flash.
+ *
+ * File layout: trace_file_header_t, then trace_record_t records back to
+ * back until the end of the file. All fields are little-endian.
+ */
+
+#define TRACE_FILE_MAGIC            0x43525447  // "GTRC" little-endian
+#define TRACE_FILE_VERSION          1
+
+// trace_record_t.valid_mask bits
+#define TRACE_RECORD_FLEX_VALID     (1 << 0)
+#define TRACE_RECORD_IMU_VALID      (1 << 1)
+#define TRACE_RECORD_TOUCH_VALID    (1 << 2)
+#define TRACE_RECORD_IMU_MOTION     (1 << 3)
+
+/**
+ * @brief Header at the start of a trace file
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;              // TRACE_FILE_MAGIC
+    uint16_t version;            // TRACE_FILE_VERSION
+    uint16_t record_size;        // sizeof(trace_record_t)
+    uint32_t start_time_ms;      // Boot time of the first record
+} trace_file_header_t;
+
+/**
+ * @brief One sensor frame
+ *
+ * Stream sample times are stored as their age against the frame time,
+ * saturating at UINT16_MAX. Fixed-point units keep the full sensor
+ * resolution: accelerometer in mg, gyro in 0.1 °/s, angles in 0.01°.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t sequence;           // Frame sequence number
+    uint32_t timestamp_ms;       // Frame time
+    uint16_t flex_age_ms;
+    uint16_t imu_age_ms;
+    uint16_t touch_age_ms;
+    uint16_t flex_raw[10];       // ADC counts
+    int16_t flex_angle[10];      // 0.01 degree
+    int16_t accel[3];            // mg
+    int16_t gyro[3];             // 0.1 °/s
+    uint8_t touch_mask;          // Bit per pad
+    uint8_t valid_mask;          // TRACE_RECORD_* bits
+} trace_record_t;
+
+/**
+ * @brief Recorder counters since the last start
+ */
+typedef struct {
+    bool recording;              // Records are being taken
+    uint32_t records;            // Records taken
+    uint32_t dropped;            // Records dropped while the writer was behind
+    uint32_t bytes_written;      // Bytes in the file, header included
+} trace_recorder_stats_t;
+
+/**
+ * @brief Initialize the recorder and start its flush task
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t trace_recorder_init(void);
+
+/**
+ * @brief Start recording into a new file
+ *
+ * Any previous file at the path is replaced.
+ *
+ * @param path File path, or NULL for TRACE_RECORDER_PATH
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if a recording is still open
+ */
+esp_err_t trace_recorder_start(const char *path);
+
+/**
+ * @brief Stop recording
+ *
+ * Returns at once. The sensor task hands over its partial page on its
+ * next frame and the flush task closes the file after writing it.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if not recording
+ */
+esp_err_t trace_recorder_stop(void);
+
+/**
+ * @brief Record one published sensor frame
+ *
+ * Only for the sensor task; costs a few microseconds and never blocks.
+ *
+ * @param frame Frame being published
+ */
+void trace_recorder_record(const sensor_data_t *frame);
+
+/**
+ * @brief Pack a sensor frame into a trace record
+ *
+ * @param frame Sensor frame
+ * @param record Pointer to store the record
+ */
+void trace_recorder_encode(const sensor_data_t *frame, trace_record_t *record);
+
+/**
+ * @brief Get the recorder counters
+ *
+ * @param stats Pointer to store the counters
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t trace_recorder_get_stats(trace_recorder_stats_t *stats);
+
+#endif /* CORE_TRACE_RECORDER_H */
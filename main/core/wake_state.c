@@ -0,0 +1,83 @@
+#include "core/wake_state.h"
+#include <string.h>
+#include <stddef.h>
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "esp_rom_crc.h"
+#include "config/system_config.h"
+#include "drivers/flex_sensor.h"
+#include "drivers/imu.h"
+
+static const char *TAG = "WAKE_STATE";
+
+typedef struct {
+    uint32_t magic;                      // WAKE_STATE_MAGIC
+    uint16_t version;                    // WAKE_STATE_VERSION
+    uint16_t size;                       // sizeof(retained_state_t)
+    system_config_t config;
+    flex_sensor_calibration_t flex_calibration;
+    imu_retained_state_t imu;
+    uint32_t crc32;                      // Over everything before this field
+} retained_state_t;
+
+// Zeroed on a cold boot, kept through deep sleep
+static RTC_DATA_ATTR retained_state_t retained;
+
+static bool warm_boot = false;
+
+static uint32_t retained_crc(void) {
+    return esp_rom_crc32_le(0, (const uint8_t *)&retained, offsetof(retained_state_t, crc32));
+}
+
+esp_err_t wake_state_save(void) {
+    retained.magic = WAKE_STATE_MAGIC;
+    retained.version = WAKE_STATE_VERSION;
+    retained.size = sizeof(retained_state_t);
+    retained.config = g_system_config;
+    
+    esp_err_t ret = flex_sensor_get_calibration(&retained.flex_calibration);
+    if (ret == ESP_OK) {
+        ret = imu_get_retained_state(&retained.imu);
+    }
+    if (ret != ESP_OK) {
+        // A partial snapshot would restore defaults as calibration
+        retained.magic = 0;
+        ESP_LOGW(TAG, "Failed to snapshot state, next wake is a cold boot");
+        return ret;
+    }
+    
+    retained.crc32 = retained_crc();
+    return ESP_OK;
+}
+
+bool wake_state_restore(void) {
+    bool valid = retained.magic == WAKE_STATE_MAGIC &&
+                 retained.version == WAKE_STATE_VERSION &&
+                 retained.size == sizeof(retained_state_t) &&
+                 retained.crc32 == retained_crc();
+    
+    // Used once: a crash or reset after this must not bring it back
+    retained.magic = 0;
+    
+    if (esp_reset_reason() != ESP_RST_DEEPSLEEP) {
+        return false;
+    }
+    if (!valid) {
+        ESP_LOGW(TAG, "No valid retained state, cold boot");
+        return false;
+    }
+    
+    g_system_config = retained.config;
+    flex_sensor_restore_calibration(&retained.flex_calibration);
+    imu_restore_retained_state(&retained.imu);
+    warm_boot = true;
+    
+    ESP_LOGI(TAG, "Warm boot (wakeup cause %d)", (int)esp_sleep_get_wakeup_cause());
+    return true;
+}
+
+bool wake_state_is_warm(void) {
+    return warm_boot;
+}
@@ -0,0 +1,49 @@
+#ifndef CORE_WAKE_STATE_H
+#define CORE_WAKE_STATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/**
+ * @brief State kept in RTC memory across deep sleep, for a warm boot
+ *
+ * Just before deep sleep the system configuration, the flex and IMU
+ * calibration and the IMU orientation are copied into RTC slow memory
+ * and sealed with a CRC. When the chip comes back from deep sleep with a
+ * valid snapshot, wake_state_restore() puts them back before the drivers
+ * start, so boot skips the NVS reads, the calibration loads and the
+ * sensor warm-up. Any other boot, or a snapshot that fails its check, is
+ * a cold boot.
+ */
+
+#define WAKE_STATE_MAGIC            0x454B5747  // "GWKE" little-endian
+#define WAKE_STATE_VERSION          1
+
+/**
+ * @brief Snapshot the retained state into RTC memory
+ *
+ * Call right before esp_deep_sleep_start().
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t wake_state_save(void);
+
+/**
+ * @brief Restore the retained state if this boot is a wake from deep sleep
+ *
+ * Call once at the start of boot, before the system configuration and
+ * the drivers are initialized. The snapshot is used up either way.
+ *
+ * @return true for a warm boot (state restored), false for a cold boot
+ */
+bool wake_state_restore(void);
+
+/**
+ * @brief Check whether this boot restored the retained state
+ *
+ * @return true for a warm boot
+ */
+bool wake_state_is_warm(void);
+
+#endif /* CORE_WAKE_STATE_H */
@@ -5,9 +5,15 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "config/pin_definitions.h"
+#include "config/system_config.h"
+#include "config/memory_layout.h"
 #include "util/debug.h"
-#include "math.h"
+#include "util/cycle_trace.h"
+#include "core/system_monitor.h"
+#include "core/telemetry.h"
+#include "output/speech_clips.h"
 
 static const char *TAG = "AUDIO";
 
@@ -24,14 +30,46 @@ static const char *TAG = "AUDIO";
 #define AUDIO_TASK_STACK_SIZE 2048
 #define AUDIO_TASK_PRIORITY 10
 
-// Audio buffer for playback
-#define AUDIO_BUFFER_SIZE 1024
+// Audio buffer for playback (AUDIO_BUFFER_SIZE from system_config.h)
 static int16_t audio_buffer[AUDIO_BUFFER_SIZE];
 
+// Playback is generated and written one DMA buffer of stereo frames at a
+// time, checking for a preempting command in between
+#define AUDIO_BLOCK_FRAMES I2S_DMA_BUFFER_SIZE
+static int16_t speech_pcm[AUDIO_BLOCK_FRAMES];  // Mono clip samples of one block
+
+// One sine period, Q15, with the first entry repeated for interpolation
+#define WAVETABLE_BITS 8
+static const int16_t sine_table[(1 << WAVETABLE_BITS) + 1] = {
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602, 6393, 7179, 7962, 8739,
+    9512, 10278, 11039, 11793, 12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594, 23170, 23731, 24279, 24811,
+    25329, 25832, 26319, 26790, 27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971, 32137, 32285, 32412, 32521,
+    32609, 32678, 32728, 32757, 32767, 32757, 32728, 32678, 32609, 32521, 32412, 32285,
+    32137, 31971, 31785, 31580, 31356, 31113, 30852, 30571, 30273, 29956, 29621, 29268,
+    28898, 28510, 28105, 27683, 27245, 26790, 26319, 25832, 25329, 24811, 24279, 23731,
+    23170, 22594, 22005, 21403, 20787, 20159, 19519, 18868, 18204, 17530, 16846, 16151,
+    15446, 14732, 14010, 13279, 12539, 11793, 11039, 10278, 9512, 8739, 7962, 7179,
+    6393, 5602, 4808, 4011, 3212, 2410, 1608, 804, 0, -804, -1608, -2410,
+    -3212, -4011, -4808, -5602, -6393, -7179, -7962, -8739, -9512, -10278, -11039, -11793,
+    -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530, -18204, -18868, -19519, -20159,
+    -20787, -21403, -22005, -22594, -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+    -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956, -30273, -30571, -30852, -31113,
+    -31356, -31580, -31785, -31971, -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+    -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285, -32137, -31971, -31785, -31580,
+    -31356, -31113, -30852, -30571, -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+    -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731, -23170, -22594, -22005, -21403,
+    -20787, -20159, -19519, -18868, -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+    -12539, -11793, -11039, -10278, -9512, -8739, -7962, -7179, -6393, -5602, -4808, -4011,
+    -3212, -2410, -1608, -804, 0
+};
+
 // Audio state
 static bool audio_initialized = false;
 static bool audio_playback_active = false;
 static uint8_t audio_volume = 80;  // 0-100
+static SemaphoreHandle_t audio_done_signal = NULL;  // Given when playback goes idle
 
 // Queue for audio commands
 static QueueHandle_t audio_command_queue = NULL;
@@ -45,12 +83,18 @@ typedef struct {
     char text[128];  // Text for TTS
     uint16_t tone_freq;  // Frequency for tone
     uint16_t duration_ms;  // Duration for tone
+    uint32_t origin_timestamp;  // Sample time of the gesture behind the text, 0 if none
 } audio_command_data_t;
 
+// Task and queue storage, reserved even while audio is never used
+#define AUDIO_QUEUE_LENGTH 10
+STATIC_TASK_STORAGE(audio_task, AUDIO_TASK_STACK_SIZE);
+STATIC_QUEUE_STORAGE(audio_command, AUDIO_QUEUE_LENGTH, sizeof(audio_command_data_t));
+
 // Forward declarations
 static void audio_task(void *pvParameters);
-static void audio_play_tone(uint16_t frequency, uint16_t duration_ms);
-static void audio_speak_text(const char *text);
+static bool audio_play_tone(uint16_t frequency, uint16_t duration_ms);
+static bool audio_speak_text(const char *text, uint32_t origin_timestamp);
 
 esp_err_t audio_init(void) {
     esp_err_t ret;
@@ -69,7 +113,8 @@ esp_err_t audio_init(void) {
         .dma_buf_count = I2S_DMA_BUFFER_COUNT,
         .dma_buf_len = I2S_DMA_BUFFER_SIZE,
         .use_apll = false,
-        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1
+        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+        .tx_desc_auto_clear = true  // Silence, not a repeated buffer, once playback runs dry
     };
     
     // I2S pin configuration
@@ -108,25 +153,32 @@ esp_err_t audio_init(void) {
     // Enable MAX98357A
     gpio_set_level(I2S_SD_PIN, 1);
     
+    // Speech falls back to beeps when no clip archive is flashed
+    if (speech_clips_init() != ESP_OK) {
+        ESP_LOGW(TAG, "No speech clips, text will be beeped");
+    }
+    
     // Create audio command queue
-    audio_command_queue = xQueueCreate(10, sizeof(audio_command_data_t));
+    audio_command_queue = STATIC_QUEUE_CREATE(audio_command, AUDIO_QUEUE_LENGTH, sizeof(audio_command_data_t));
     if (audio_command_queue == NULL) {
         ESP_LOGE(TAG, "Failed to create audio command queue");
         i2s_driver_uninstall(I2S_NUM);
         return ESP_ERR_NO_MEM;
     }
+    telemetry_register_queue(TELEMETRY_QUEUE_AUDIO_COMMAND, audio_command_queue);
     
     // Create audio task
-    BaseType_t xReturned = xTaskCreate(
+    audio_task_handle = xTaskCreateStatic(
         audio_task,
         "audio_task",
         AUDIO_TASK_STACK_SIZE,
         NULL,
         AUDIO_TASK_PRIORITY,
-        &audio_task_handle
+        audio_task_stack,
+        &audio_task_tcb
     );
     
-    if (xReturned != pdPASS) {
+    if (audio_task_handle == NULL) {
         ESP_LOGE(TAG, "Failed to create audio task");
         vQueueDelete(audio_command_queue);
         i2s_driver_uninstall(I2S_NUM);
@@ -136,9 +188,6 @@ esp_err_t audio_init(void) {
     audio_initialized = true;
     ESP_LOGI(TAG, "Audio system initialized");
     
-    // Play startup sound
-    audio_play_beep(1000, 100);
-    
     return ESP_OK;
 }
 
@@ -161,6 +210,7 @@ esp_err_t audio_deinit(void) {
     
     // Delete command queue
     if (audio_command_queue != NULL) {
+        telemetry_register_queue(TELEMETRY_QUEUE_AUDIO_COMMAND, NULL);
         vQueueDelete(audio_command_queue);
         audio_command_queue = NULL;
     }
@@ -175,8 +225,9 @@ esp_err_t audio_deinit(void) {
 }
 
 esp_err_t audio_play_beep(uint16_t frequency, uint16_t duration_ms) {
-    if (!audio_initialized) {
-        return ESP_ERR_INVALID_STATE;
+    esp_err_t ret = audio_init();  // I2S comes up on first use, not at boot
+    if (ret != ESP_OK) {
+        return ret;
     }
     
     audio_command_data_t cmd = {
@@ -185,7 +236,7 @@ esp_err_t audio_play_beep(uint16_t frequency, uint16_t duration_ms) {
         .duration_ms = duration_ms
     };
     
-    if (xQueueSend(audio_command_queue, &cmd, pdMS_TO_TICKS(100)) != pdPASS) {
+    if (telemetry_queue_send(TELEMETRY_QUEUE_AUDIO_COMMAND, &cmd, pdMS_TO_TICKS(100)) != pdPASS) {
         ESP_LOGW(TAG, "Failed to queue audio command");
         return ESP_FAIL;
     }
@@ -193,20 +244,26 @@ esp_err_t audio_play_beep(uint16_t frequency, uint16_t duration_ms) {
     return ESP_OK;
 }
 
-esp_err_t audio_speak(const char *text) {
-    if (!audio_initialized || text == NULL) {
-        return ESP_ERR_INVALID_STATE;
+esp_err_t audio_speak(const char *text, uint32_t origin_timestamp) {
+    if (text == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    esp_err_t ret = audio_init();
+    if (ret != ESP_OK) {
+        return ret;
     }
     
     audio_command_data_t cmd = {
-        .command = AUDIO_CMD_SPEAK_TEXT
+        .command = AUDIO_CMD_SPEAK_TEXT,
+        .origin_timestamp = origin_timestamp
     };
     
     // Copy text (with truncation if needed)
     strncpy(cmd.text, text, sizeof(cmd.text) - 1);
     cmd.text[sizeof(cmd.text) - 1] = '\0';
     
-    if (xQueueSend(audio_command_queue, &cmd, pdMS_TO_TICKS(100)) != pdPASS) {
+    if (telemetry_queue_send(TELEMETRY_QUEUE_AUDIO_COMMAND, &cmd, pdMS_TO_TICKS(100)) != pdPASS) {
         ESP_LOGW(TAG, "Failed to queue audio command");
         return ESP_FAIL;
     }
@@ -216,14 +273,15 @@ esp_err_t audio_speak(const char *text) {
 
 esp_err_t audio_stop(void) {
     if (!audio_initialized) {
-        return ESP_ERR_INVALID_STATE;
+        return ESP_OK;  // Nothing has played yet
     }
     
     audio_command_data_t cmd = {
         .command = AUDIO_CMD_STOP
     };
     
-    if (xQueueSend(audio_command_queue, &cmd, pdMS_TO_TICKS(100)) != pdPASS) {
+    // Ahead of anything queued, where playback checks for it
+    if (telemetry_queue_send_to_front(TELEMETRY_QUEUE_AUDIO_COMMAND, &cmd, pdMS_TO_TICKS(100)) != pdPASS) {
         ESP_LOGW(TAG, "Failed to queue audio command");
         return ESP_FAIL;
     }
@@ -235,10 +293,6 @@ esp_err_t audio_stop(void) {
 }
 
 esp_err_t audio_set_volume(uint8_t volume) {
-    if (!audio_initialized) {
-        return ESP_ERR_INVALID_STATE;
-    }
-    
     // Clamp volume to 0-100
     if (volume > 100) {
         volume = 100;
@@ -255,7 +309,23 @@ uint8_t audio_get_volume(void) {
 }
 
 bool audio_is_active(void) {
-    return audio_playback_active;
+    return audio_playback_active ||
+           (audio_command_queue != NULL && uxQueueMessagesWaiting(audio_command_queue) > 0);
+}
+
+void audio_set_done_signal(SemaphoreHandle_t done) {
+    audio_done_signal = done;
+}
+
+// Whether the command at the head of the queue cuts short what is playing:
+// a stop always does, newer speech makes speech in progress stale
+static bool audio_preempted(audio_command_t playing) {
+    static audio_command_data_t next;  // Audio task only; too big for its stack
+    if (xQueuePeek(audio_command_queue, &next, 0) != pdPASS) {
+        return false;
+    }
+    return next.command == AUDIO_CMD_STOP ||
+           (playing == AUDIO_CMD_SPEAK_TEXT && next.command == AUDIO_CMD_SPEAK_TEXT);
 }
 
 // Audio task function
@@ -265,16 +335,26 @@ static void audio_task(void *pvParameters) {
     while (1) {
         // Wait for a command
         if (xQueueReceive(audio_command_queue, &cmd, portMAX_DELAY) == pdPASS) {
+            bool finished = true;
+            
             switch (cmd.command) {
                 case AUDIO_CMD_PLAY_TONE:
                     audio_playback_active = true;
-                    audio_play_tone(cmd.tone_freq, cmd.duration_ms);
+                    CYCLE_TRACE_BEGIN(CYCLE_TRACE_AUDIO_PLAY);
+                    finished = audio_play_tone(cmd.tone_freq, cmd.duration_ms);
+                    CYCLE_TRACE_END(CYCLE_TRACE_AUDIO_PLAY);
                     audio_playback_active = false;
                     break;
                     
                 case AUDIO_CMD_SPEAK_TEXT:
+                    // Stale already if newer speech is waiting
+                    if (audio_preempted(AUDIO_CMD_SPEAK_TEXT)) {
+                        break;
+                    }
                     audio_playback_active = true;
-                    audio_speak_text(cmd.text);
+                    CYCLE_TRACE_BEGIN(CYCLE_TRACE_AUDIO_PLAY);
+                    finished = audio_speak_text(cmd.text, cmd.origin_timestamp);
+                    CYCLE_TRACE_END(CYCLE_TRACE_AUDIO_PLAY);
                     audio_playback_active = false;
                     break;
                     
@@ -288,55 +368,159 @@ static void audio_task(void *pvParameters) {
                     ESP_LOGW(TAG, "Unknown audio command: %d", cmd.command);
                     break;
             }
+            
+            // Drop what is still queued in the DMA buffers of preempted playback
+            if (!finished) {
+                i2s_zero_dma_buffer(I2S_NUM);
+            }
+            
+            if (audio_done_signal != NULL && uxQueueMessagesWaiting(audio_command_queue) == 0) {
+                xSemaphoreGive(audio_done_signal);
+            }
         }
     }
 }
 
-// Generate and play a simple tone
-static void audio_play_tone(uint16_t frequency, uint16_t duration_ms) {
+uint32_t audio_render_tone(int16_t *buffer, uint32_t frames, uint32_t phase,
+                           uint32_t phase_step, int16_t amplitude) {
+    for (uint32_t j = 0; j < frames; j++) {
+        // Table index from the top bits, Q15 interpolation from the next ones
+        uint32_t index = phase >> (32 - WAVETABLE_BITS);
+        int32_t fraction = (phase >> (32 - WAVETABLE_BITS - 15)) & 0x7FFF;
+        int32_t a = sine_table[index];
+        int32_t b = sine_table[index + 1];
+        int32_t value = a + (((b - a) * fraction) >> 15);
+        int16_t sample = (int16_t)((value * amplitude) >> 15);
+        
+        // Fill left and right channels with the same data
+        buffer[j*2] = sample;      // Left channel
+        buffer[j*2+1] = sample;    // Right channel
+        phase += phase_step;
+    }
+    return phase;
+}
+
+// Generate and play a simple tone; false if preempted
+static bool audio_play_tone(uint16_t frequency, uint16_t duration_ms) {
     size_t i2s_bytes_written = 0;
     
     // Calculate parameters
     uint32_t sample_count = I2S_SAMPLE_RATE * duration_ms / 1000;
-    float volume_scale = (float)audio_volume / 100.0f;
-    float volume_factor = 32767.0f * volume_scale;  // Scale to int16_t range
+    int16_t amplitude = (int16_t)(32767 * audio_volume / 100);
     
-    // Calculate wave parameters
-    float angular_frequency = 2.0f * M_PI * frequency / I2S_SAMPLE_RATE;
+    // Phase accumulator: a full period is 2^32
+    uint32_t phase_step = (uint32_t)(((uint64_t)frequency << 32) / I2S_SAMPLE_RATE);
+    uint32_t phase = 0;
     
-    // Generate sine wave and send to I2S
-    for (uint32_t i = 0; i < sample_count; i += AUDIO_BUFFER_SIZE / 2) {  // Divide by 2 because we need to generate both L and R channels
-        uint32_t buffer_samples = (i + AUDIO_BUFFER_SIZE / 2 < sample_count) ? 
-                                  AUDIO_BUFFER_SIZE / 2 : (sample_count - i);
+    // Generate sine wave and send to I2S one DMA buffer at a time
+    for (uint32_t i = 0; i < sample_count; i += AUDIO_BLOCK_FRAMES) {
+        if (audio_preempted(AUDIO_CMD_PLAY_TONE)) {
+            return false;
+        }
+        
+        uint32_t buffer_samples = (i + AUDIO_BLOCK_FRAMES < sample_count) ? 
+                                  AUDIO_BLOCK_FRAMES : (sample_count - i);
         
         // Generate samples for both channels
-        for (uint32_t j = 0; j < buffer_samples; j++) {
-            float sample_value = sinf((i + j) * angular_frequency);
-            int16_t sample = (int16_t)(sample_value * volume_factor);
-            
-            // Fill left and right channels with the same data
-            audio_buffer[j*2] = sample;      // Left channel
-            audio_buffer[j*2+1] = sample;    // Right channel
-        }
+        phase = audio_render_tone(audio_buffer, buffer_samples, phase, phase_step, amplitude);
         
-        // Send to I2S (blocking)
+        // Waits at most while the DMA plays one buffer
         i2s_write(I2S_NUM, audio_buffer, buffer_samples * 4, &i2s_bytes_written, portMAX_DELAY);  // 4 bytes per sample (2 bytes per channel, 2 channels)
     }
     
-    // Ensure buffer is flushed
-    i2s_zero_dma_buffer(I2S_NUM);
+    return true;
+}
+
+static void audio_write_silence(uint32_t frames) {
+    size_t i2s_bytes_written = 0;
+    
+    memset(audio_buffer, 0, sizeof(audio_buffer));
+    while (frames > 0) {
+        uint32_t block = (frames < AUDIO_BLOCK_FRAMES) ? frames : AUDIO_BLOCK_FRAMES;
+        i2s_write(I2S_NUM, audio_buffer, block * 4, &i2s_bytes_written, portMAX_DELAY);
+        frames -= block;
+    }
+}
+
+// Stream clips from the archive: decode a block, ramp it up to the I2S
+// rate, write it, repeat. The I2S DMA ring plays one block while the next
+// is decoded, so no clip is ever held whole in RAM. False if preempted.
+static bool audio_speak_clips(const char *text, uint32_t origin_timestamp) {
+    static uint16_t plan[SPEECH_MAX_CLIPS];
+    size_t clip_count = speech_clips_plan(text, plan, SPEECH_MAX_CLIPS);
+    int32_t repeat = I2S_SAMPLE_RATE / speech_clips_sample_rate();
+    int32_t gain = (int32_t)audio_volume * 32768 / 100;  // Q15
+    int32_t previous = 0;
+    bool first_block = true;
+    size_t i2s_bytes_written = 0;
+    
+    ESP_LOGI(TAG, "Speaking '%s' (%u clips)", text, (unsigned)clip_count);
+    
+    for (size_t c = 0; c < clip_count; c++) {
+        if (audio_preempted(AUDIO_CMD_SPEAK_TEXT)) {
+            return false;
+        }
+        
+        if (plan[c] == SPEECH_CLIP_PAUSE) {
+            audio_write_silence(I2S_SAMPLE_RATE * SPEECH_WORD_GAP_MS / 1000);
+            previous = 0;
+            continue;
+        }
+        
+        speech_stream_t stream;
+        if (speech_clips_open(plan[c], &stream) != ESP_OK) {
+            continue;
+        }
+        
+        size_t samples;
+        while ((samples = speech_clips_read(&stream, speech_pcm, AUDIO_BLOCK_FRAMES / repeat)) > 0) {
+            // Linear interpolation up to the I2S rate, same data on both channels
+            uint32_t frames = 0;
+            for (size_t i = 0; i < samples; i++) {
+                int32_t target = (speech_pcm[i] * gain) >> 15;
+                for (int32_t k = 1; k <= repeat; k++) {
+                    int16_t sample = (int16_t)(previous + (target - previous) * k / repeat);
+                    audio_buffer[frames * 2] = sample;
+                    audio_buffer[frames * 2 + 1] = sample;
+                    frames++;
+                }
+                previous = target;
+            }
+            
+            i2s_write(I2S_NUM, audio_buffer, frames * 4, &i2s_bytes_written, portMAX_DELAY);
+            
+            // Latency ends at the first sample handed to the DMA
+            if (first_block) {
+                system_monitor_record_output(OUTPUT_SINK_AUDIO, origin_timestamp);
+                first_block = false;
+            }
+            
+            if (audio_preempted(AUDIO_CMD_SPEAK_TEXT)) {
+                return false;
+            }
+        }
+    }
+    
+    return true;
 }
 
-// Very simple text-to-speech (just beeps for now - would need a real TTS engine)
-static void audio_speak_text(const char *text) {
-    // For a real implementation, we'd integrate a TTS engine here
-    // For now, just beep with different tones based on text length
+static bool audio_speak_text(const char *text, uint32_t origin_timestamp) {
+    if (speech_clips_available()) {
+        return audio_speak_clips(text, origin_timestamp);
+    }
+    
+    // No clip archive: beep with different tones based on text
     ESP_LOGI(TAG, "TTS (simulated): %s", text);
+    system_monitor_record_output(OUTPUT_SINK_AUDIO, origin_timestamp);
     
     // Play a sequence of beeps to simulate speech
     for (int i = 0; i < strlen(text) && i < 10; i++) {
         uint16_t freq = 500 + (text[i] % 1000);  // Generate frequency based on character
-        audio_play_tone(freq, 100);
-        vTaskDelay(pdMS_TO_TICKS(50));  // Short pause between beeps
+        if (!audio_play_tone(freq, 100) || audio_preempted(AUDIO_CMD_SPEAK_TEXT)) {
+            return false;
+        }
+        audio_write_silence(I2S_SAMPLE_RATE * 50 / 1000);  // Short pause between beeps
     }
-}
\ No newline at end of file
+    
+    return true;
+}
@@ -4,6 +4,8 @@
 #include "esp_err.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 /**
  * @brief Audio command types
@@ -17,6 +19,10 @@ typedef enum {
 /**
  * @brief Initialize audio subsystem
  * 
+ * Called on the first beep or speech rather than at boot, so a glove that
+ * never plays audio never powers the amplifier. Repeated calls are no-ops;
+ * only the output task plays audio, so the first call is not raced.
+ * 
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t audio_init(void);
@@ -41,9 +47,10 @@ esp_err_t audio_play_beep(uint16_t frequency, uint16_t duration_ms);
  * @brief Speak text using TTS
  * 
  * @param text Text to speak
+ * @param origin_timestamp Sample time of the gesture behind the text, 0 if none
  * @return ESP_OK on success, error code otherwise
  */
-esp_err_t audio_speak(const char *text);
+esp_err_t audio_speak(const char *text, uint32_t origin_timestamp);
 
 /**
  * @brief Stop audio playback
@@ -70,8 +77,35 @@ uint8_t audio_get_volume(void);
 /**
  * @brief Check if audio playback is active
  * 
- * @return true if audio is playing, false otherwise
+ * @return true if audio is playing or queued, false otherwise
  */
 bool audio_is_active(void);
 
+/**
+ * @brief Set a semaphore to give whenever playback goes idle
+ * 
+ * Given by the audio task once the last queued tone or utterance is done,
+ * so a waiting task can block on it (or on a queue set holding it).
+ * 
+ * @param done Binary semaphore, NULL for none
+ */
+void audio_set_done_signal(SemaphoreHandle_t done);
+
+/**
+ * @brief Render a block of a stereo sine tone
+ * 
+ * The sample loop of tone playback, separate from the I2S write so it
+ * can be benchmarked on its own. Reads an interpolated sine wavetable
+ * with a phase accumulator, one period being 2^32.
+ * 
+ * @param buffer Output, interleaved left/right (2 * frames values)
+ * @param frames Number of frames to render
+ * @param phase Phase of the first frame
+ * @param phase_step Phase step per frame, frequency * 2^32 / sample rate
+ * @param amplitude Peak sample value
+ * @return Phase of the frame after the block
+ */
+uint32_t audio_render_tone(int16_t *buffer, uint32_t frames, uint32_t phase,
+                           uint32_t phase_step, int16_t amplitude);
+
 #endif /* DRIVERS_AUDIO_H */
\ No newline at end of file
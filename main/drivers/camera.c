@@ -4,7 +4,9 @@
 #include "esp_camera.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
 #include "config/pin_definitions.h"
+#include "config/system_config.h"
 #include "util/debug.h"
 
 static const char *TAG = "CAMERA";
@@ -14,7 +16,11 @@ static bool camera_initialized = false;
 static bool camera_streaming = false;
 
 // Camera resolution
+#if CAMERA_CAPTURE_GRAYSCALE
+static camera_resolution_t current_resolution = CAMERA_RESOLUTION_QQVGA;
+#else
 static camera_resolution_t current_resolution = CAMERA_RESOLUTION_QVGA;
+#endif
 
 // Frame buffer
 static camera_fb_t *current_frame = NULL;
@@ -49,13 +55,19 @@ esp_err_t camera_init(void) {
         .ledc_timer = LEDC_TIMER_0,
         .ledc_channel = LEDC_CHANNEL_0,
         
+#if CAMERA_CAPTURE_GRAYSCALE
+        // Sensor-side grayscale at 160x120: 19 KB per frame instead of 150 KB
+        .pixel_format = PIXFORMAT_GRAYSCALE,
+        .frame_size = FRAMESIZE_QQVGA,  // 160x120
+#else
         .pixel_format = PIXFORMAT_RGB565,
         .frame_size = FRAMESIZE_QVGA,  // 320x240
+#endif
         
         .jpeg_quality = 12,  // 0-63, lower is higher quality
         .fb_count = 2,  // Number of frame buffers
         .fb_location = CAMERA_FB_IN_PSRAM,
-        .grab_mode = CAMERA_GRAB_WHEN_EMPTY
+        .grab_mode = CAMERA_GRAB_LATEST  // Always hand out the freshest frame
     };
     
     // Init camera
@@ -162,8 +174,17 @@ esp_err_t camera_capture_frame(camera_frame_t *frame) {
     frame->buffer_size = current_frame->len;
     frame->width = current_frame->width;
     frame->height = current_frame->height;
-    frame->format = (current_frame->format == PIXFORMAT_RGB565) ? 
-                   CAMERA_FORMAT_RGB565 : CAMERA_FORMAT_JPEG;
+    switch (current_frame->format) {
+        case PIXFORMAT_RGB565:
+            frame->format = CAMERA_FORMAT_RGB565;
+            break;
+        case PIXFORMAT_GRAYSCALE:
+            frame->format = CAMERA_FORMAT_GRAYSCALE;
+            break;
+        default:
+            frame->format = CAMERA_FORMAT_JPEG;
+            break;
+    }
     frame->timestamp = esp_timer_get_time() / 1000;  // Convert to milliseconds
     
     return ESP_OK;
@@ -19,14 +19,18 @@ typedef enum {
  */
 typedef enum {
     CAMERA_FORMAT_RGB565 = 0,
-    CAMERA_FORMAT_JPEG
+    CAMERA_FORMAT_JPEG,
+    CAMERA_FORMAT_GRAYSCALE
 } camera_format_t;
 
 /**
  * @brief Camera frame structure
+ *
+ * buffer is owned by the camera driver and only stays valid until the
+ * next capture or camera_release_frame().
  */
 typedef struct {
-    uint8_t *buffer;        // Pointer to image data
+    uint8_t *buffer;        // Pointer to image data (not owned)
     uint32_t buffer_size;   // Size of the buffer
     uint16_t width;         // Image width
     uint16_t height;        // Image height
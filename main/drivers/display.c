@@ -7,8 +7,13 @@
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "config/pin_definitions.h"
+#include "config/system_config.h"
+#include "config/memory_layout.h"
+#include "core/system_monitor.h"
 #include "util/debug.h"
+#include "util/cycle_trace.h"
 
 static const char *TAG = "DISPLAY";
 
@@ -44,26 +49,192 @@ static const char *TAG = "DISPLAY";
 #define SSD1306_HEIGHT              64
 #define SSD1306_PAGES               8  // 64 pixels / 8 bits per page
 
-// Display buffer
+// Bus bytes spent addressing one more window (two transactions, six
+// commands); runs of dirty pages are merged while that is dearer
+#define SSD1306_WINDOW_COST         11
+
+// Bytes per millisecond on the bus, 9 clocks per byte
+#define SSD1306_BYTES_PER_MS        (I2C_MASTER_FREQ_HZ / 9 / 1000)
+
+// Display buffer, drawn into by the display_* calls
 static uint8_t display_buffer[SSD1306_WIDTH * SSD1306_PAGES];
+
+// Columns of each page changed since the last display_update(), first > last when clean
+static uint8_t dirty_first[SSD1306_PAGES];
+static uint8_t dirty_last[SSD1306_PAGES];
+
+// Front buffer and its unsent columns, handed over under front_lock and
+// sent by the flush task, so drawing never waits for the bus
+static uint8_t front_buffer[SSD1306_WIDTH * SSD1306_PAGES];
+static uint8_t front_first[SSD1306_PAGES];
+static uint8_t front_last[SSD1306_PAGES];
+static uint32_t front_origin = 0;   // Oldest gesture sample time waiting to be shown
+static bool flush_busy = false;
+static portMUX_TYPE front_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t flush_task_handle = NULL;
+static SemaphoreHandle_t flush_done = NULL;
+static StaticSemaphore_t flush_done_storage;
+STATIC_TASK_STORAGE(display_flush_task, DISPLAY_FLUSH_STACK_SIZE);
+
+// Control byte plus the largest window, so flushes never allocate
+static uint8_t tx_buffer[1 + sizeof(front_buffer)];
+
 static bool display_initialized = false;
 static bool display_powered_on = false;
 
-// Simple 6x8 font (ASCII 32-127, reduced for brevity)
-static const uint8_t font6x8[] = {
+// 6x8 font, ASCII 32-127: one byte per column, bit 0 at the top, as in an SSD1306 page
+#define FONT_FIRST_CHAR             32
+#define FONT_GLYPHS                 96
+#define FONT_GLYPH_WIDTH            6
+
+static const uint8_t font6x8[FONT_GLYPHS * FONT_GLYPH_WIDTH] = {
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // Space
     0x00, 0x00, 0x5F, 0x00, 0x00, 0x00, // !
     0x00, 0x07, 0x00, 0x07, 0x00, 0x00, // "
     0x14, 0x7F, 0x14, 0x7F, 0x14, 0x00, // #
-    // ... remainder of font data would be here
+    0x24, 0x2A, 0x7F, 0x2A, 0x12, 0x00, // $
+    0x23, 0x13, 0x08, 0x64, 0x62, 0x00, // %
+    0x36, 0x49, 0x55, 0x22, 0x50, 0x00, // &
+    0x00, 0x05, 0x03, 0x00, 0x00, 0x00, // '
+    0x00, 0x1C, 0x22, 0x41, 0x00, 0x00, // (
+    0x00, 0x41, 0x22, 0x1C, 0x00, 0x00, // )
+    0x08, 0x2A, 0x1C, 0x2A, 0x08, 0x00, // *
+    0x08, 0x08, 0x3E, 0x08, 0x08, 0x00, // +
+    0x00, 0x50, 0x30, 0x00, 0x00, 0x00, // ,
+    0x08, 0x08, 0x08, 0x08, 0x08, 0x00, // -
+    0x00, 0x60, 0x60, 0x00, 0x00, 0x00, // .
+    0x20, 0x10, 0x08, 0x04, 0x02, 0x00, // /
+    0x3E, 0x51, 0x49, 0x45, 0x3E, 0x00, // 0
+    0x00, 0x42, 0x7F, 0x40, 0x00, 0x00, // 1
+    0x42, 0x61, 0x51, 0x49, 0x46, 0x00, // 2
+    0x21, 0x41, 0x45, 0x4B, 0x31, 0x00, // 3
+    0x18, 0x14, 0x12, 0x7F, 0x10, 0x00, // 4
+    0x27, 0x45, 0x45, 0x45, 0x39, 0x00, // 5
+    0x3C, 0x4A, 0x49, 0x49, 0x30, 0x00, // 6
+    0x01, 0x71, 0x09, 0x05, 0x03, 0x00, // 7
+    0x36, 0x49, 0x49, 0x49, 0x36, 0x00, // 8
+    0x06, 0x49, 0x49, 0x29, 0x1E, 0x00, // 9
+    0x00, 0x36, 0x36, 0x00, 0x00, 0x00, // :
+    0x00, 0x56, 0x36, 0x00, 0x00, 0x00, // ;
+    0x08, 0x14, 0x22, 0x41, 0x00, 0x00, // <
+    0x14, 0x14, 0x14, 0x14, 0x14, 0x00, // =
+    0x00, 0x41, 0x22, 0x14, 0x08, 0x00, // >
+    0x02, 0x01, 0x51, 0x09, 0x06, 0x00, // ?
+    0x32, 0x49, 0x79, 0x41, 0x3E, 0x00, // @
+    0x7E, 0x11, 0x11, 0x11, 0x7E, 0x00, // A
+    0x7F, 0x49, 0x49, 0x49, 0x36, 0x00, // B
+    0x3E, 0x41, 0x41, 0x41, 0x22, 0x00, // C
+    0x7F, 0x41, 0x41, 0x22, 0x1C, 0x00, // D
+    0x7F, 0x49, 0x49, 0x49, 0x41, 0x00, // E
+    0x7F, 0x09, 0x09, 0x09, 0x01, 0x00, // F
+    0x3E, 0x41, 0x49, 0x49, 0x7A, 0x00, // G
+    0x7F, 0x08, 0x08, 0x08, 0x7F, 0x00, // H
+    0x00, 0x41, 0x7F, 0x41, 0x00, 0x00, // I
+    0x20, 0x40, 0x41, 0x3F, 0x01, 0x00, // J
+    0x7F, 0x08, 0x14, 0x22, 0x41, 0x00, // K
+    0x7F, 0x40, 0x40, 0x40, 0x40, 0x00, // L
+    0x7F, 0x02, 0x0C, 0x02, 0x7F, 0x00, // M
+    0x7F, 0x04, 0x08, 0x10, 0x7F, 0x00, // N
+    0x3E, 0x41, 0x41, 0x41, 0x3E, 0x00, // O
+    0x7F, 0x09, 0x09, 0x09, 0x06, 0x00, // P
+    0x3E, 0x41, 0x51, 0x21, 0x5E, 0x00, // Q
+    0x7F, 0x09, 0x19, 0x29, 0x46, 0x00, // R
+    0x46, 0x49, 0x49, 0x49, 0x31, 0x00, // S
+    0x01, 0x01, 0x7F, 0x01, 0x01, 0x00, // T
+    0x3F, 0x40, 0x40, 0x40, 0x3F, 0x00, // U
+    0x1F, 0x20, 0x40, 0x20, 0x1F, 0x00, // V
+    0x3F, 0x40, 0x38, 0x40, 0x3F, 0x00, // W
+    0x63, 0x14, 0x08, 0x14, 0x63, 0x00, // X
+    0x07, 0x08, 0x70, 0x08, 0x07, 0x00, // Y
+    0x61, 0x51, 0x49, 0x45, 0x43, 0x00, // Z
+    0x00, 0x7F, 0x41, 0x41, 0x00, 0x00, // [
+    0x02, 0x04, 0x08, 0x10, 0x20, 0x00, // Backslash
+    0x00, 0x41, 0x41, 0x7F, 0x00, 0x00, // ]
+    0x04, 0x02, 0x01, 0x02, 0x04, 0x00, // ^
+    0x40, 0x40, 0x40, 0x40, 0x40, 0x00, // _
+    0x00, 0x01, 0x02, 0x04, 0x00, 0x00, // `
+    0x20, 0x54, 0x54, 0x54, 0x78, 0x00, // a
+    0x7F, 0x48, 0x44, 0x44, 0x38, 0x00, // b
+    0x38, 0x44, 0x44, 0x44, 0x20, 0x00, // c
+    0x38, 0x44, 0x44, 0x48, 0x7F, 0x00, // d
+    0x38, 0x54, 0x54, 0x54, 0x18, 0x00, // e
+    0x08, 0x7E, 0x09, 0x01, 0x02, 0x00, // f
+    0x0C, 0x52, 0x52, 0x52, 0x3E, 0x00, // g
+    0x7F, 0x08, 0x04, 0x04, 0x78, 0x00, // h
+    0x00, 0x44, 0x7D, 0x40, 0x00, 0x00, // i
+    0x20, 0x40, 0x44, 0x3D, 0x00, 0x00, // j
+    0x7F, 0x10, 0x28, 0x44, 0x00, 0x00, // k
+    0x00, 0x41, 0x7F, 0x40, 0x00, 0x00, // l
+    0x7C, 0x04, 0x18, 0x04, 0x78, 0x00, // m
+    0x7C, 0x08, 0x04, 0x04, 0x78, 0x00, // n
+    0x38, 0x44, 0x44, 0x44, 0x38, 0x00, // o
+    0x7C, 0x14, 0x14, 0x14, 0x08, 0x00, // p
+    0x08, 0x14, 0x14, 0x18, 0x7C, 0x00, // q
+    0x7C, 0x08, 0x04, 0x04, 0x08, 0x00, // r
+    0x48, 0x54, 0x54, 0x54, 0x20, 0x00, // s
+    0x04, 0x3F, 0x44, 0x40, 0x20, 0x00, // t
+    0x3C, 0x40, 0x40, 0x20, 0x7C, 0x00, // u
+    0x1C, 0x20, 0x40, 0x20, 0x1C, 0x00, // v
+    0x3C, 0x40, 0x30, 0x40, 0x3C, 0x00, // w
+    0x44, 0x28, 0x10, 0x28, 0x44, 0x00, // x
+    0x0C, 0x50, 0x50, 0x50, 0x3C, 0x00, // y
+    0x44, 0x64, 0x54, 0x4C, 0x44, 0x00, // z
+    0x00, 0x08, 0x36, 0x41, 0x00, 0x00, // {
+    0x00, 0x00, 0x7F, 0x00, 0x00, 0x00, // |
+    0x00, 0x41, 0x36, 0x08, 0x00, 0x00, // }
+    0x08, 0x04, 0x08, 0x10, 0x08, 0x00, // ~
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // DEL
+};
+
+// Medium and large fonts: font6x8 scaled 2x and 3x, built once at init.
+// Glyphs are stored page by page, one row of glyph columns per page.
+static uint8_t font12x16[FONT_GLYPHS * 2 * FONT_GLYPH_WIDTH * 2];
+static uint8_t font18x24[FONT_GLYPHS * 3 * FONT_GLYPH_WIDTH * 3];
+
+typedef struct {
+    const uint8_t *glyphs;
+    uint8_t width;                  // Columns per glyph, spacing included
+    uint8_t pages;                  // 8-row pages per glyph
+} ssd1306_font_t;
+
+static const ssd1306_font_t fonts[] = {
+    [DISPLAY_FONT_SMALL]  = { font6x8, FONT_GLYPH_WIDTH, 1 },
+    [DISPLAY_FONT_MEDIUM] = { font12x16, FONT_GLYPH_WIDTH * 2, 2 },
+    [DISPLAY_FONT_LARGE]  = { font18x24, FONT_GLYPH_WIDTH * 3, 3 }
 };
 
 // Forward function declarations
 static esp_err_t ssd1306_write_command(uint8_t command);
-static esp_err_t ssd1306_write_data(uint8_t* data, size_t len);
+static esp_err_t ssd1306_write_commands(const uint8_t *commands, size_t count);
 static void ssd1306_set_pixel(uint8_t x, uint8_t y, uint8_t color);
+static void ssd1306_clear_buffer(void);
+static void ssd1306_blit(const uint8_t *glyph, uint8_t width, uint8_t pages, uint8_t x, uint8_t y);
+static void ssd1306_build_scaled_font(uint8_t *glyphs, uint8_t scale);
+static void ssd1306_publish(uint32_t origin_timestamp);
+static esp_err_t ssd1306_flush(void);
+static void display_flush_task(void *arg);
 static esp_err_t ssd1306_update_full();
 
+// Dirty column ranges, for both the back and the front buffer
+static inline void mark_dirty(uint8_t *first, uint8_t *last, uint8_t page, uint8_t from, uint8_t to) {
+    if (from < first[page]) {
+        first[page] = from;
+    }
+    if (to > last[page]) {
+        last[page] = to;
+    }
+}
+
+static inline void mark_clean(uint8_t *first, uint8_t *last, uint8_t page) {
+    first[page] = SSD1306_WIDTH;
+    last[page] = 0;
+}
+
+static inline bool page_dirty(const uint8_t *first, const uint8_t *last, uint8_t page) {
+    return first[page] <= last[page];
+}
+
 esp_err_t display_init(void) {
     esp_err_t ret;
     
@@ -89,6 +260,11 @@ esp_err_t display_init(void) {
     ret = ssd1306_write_command(SSD1306_CMD_DISPLAY_OFF);  // Display off
     if (ret != ESP_OK) return ret;
     
+    ret = ssd1306_write_command(SSD1306_CMD_SET_MEM_ADDR); // Set memory addressing mode
+    if (ret != ESP_OK) return ret;
+    ret = ssd1306_write_command(0x00);  // Horizontal, so a window streams in one write
+    if (ret != ESP_OK) return ret;
+    
     ret = ssd1306_write_command(SSD1306_CMD_SET_MUX_RATIO); // Set MUX ratio
     if (ret != ESP_OK) return ret;
     ret = ssd1306_write_command(0x3F);  // 64 lines
@@ -142,10 +318,30 @@ esp_err_t display_init(void) {
     // Clear display buffer
     memset(display_buffer, 0, sizeof(display_buffer));
     
-    // Send buffer to display
-    ret = ssd1306_update_full();
+    ssd1306_build_scaled_font(font12x16, 2);
+    ssd1306_build_scaled_font(font18x24, 3);
+    
+    // Send buffer to display; the flush task is not running yet, so write it here
+    ssd1306_update_full();
+    ret = ssd1306_flush();
     if (ret != ESP_OK) return ret;
     
+    if (flush_done == NULL) {
+        flush_done = xSemaphoreCreateBinaryStatic(&flush_done_storage);
+        if (flush_done == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    
+    if (flush_task_handle == NULL) {
+        flush_task_handle = STATIC_TASK_CREATE_PINNED(display_flush_task, "display_flush", DISPLAY_FLUSH_STACK_SIZE,
+                                                      NULL, DISPLAY_FLUSH_PRIORITY, DISPLAY_FLUSH_CORE);
+        if (flush_task_handle == NULL) {
+            ESP_LOGE(TAG, "Failed to create display flush task");
+            return ESP_FAIL;
+        }
+    }
+    
     // Turn display on
     ret = ssd1306_write_command(SSD1306_CMD_DISPLAY_ON);
     if (ret != ESP_OK) return ret;
@@ -228,18 +424,51 @@ esp_err_t display_clear(void) {
     }
     
     // Clear buffer
-    memset(display_buffer, 0, sizeof(display_buffer));
+    ssd1306_clear_buffer();
     
-    // Send buffer to display
-    return ssd1306_update_full();
+    // Send the cleared areas to the display
+    ssd1306_publish(0);
+    return ESP_OK;
 }
 
 esp_err_t display_update(void) {
+    return display_update_with_origin(0);
+}
+
+esp_err_t display_update_with_origin(uint32_t origin_timestamp) {
     if (!display_initialized) {
         return ESP_ERR_INVALID_STATE;
     }
     
-    return ssd1306_update_full();
+    // Only what the drawing calls changed since the last update
+    ssd1306_publish(origin_timestamp);
+    return ESP_OK;
+}
+
+esp_err_t display_wait_flush(uint32_t timeout_ms) {
+    if (!display_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    while (1) {
+        portENTER_CRITICAL(&front_lock);
+        bool idle = !flush_busy;
+        for (uint8_t page = 0; page < SSD1306_PAGES && idle; page++) {
+            idle = !page_dirty(front_first, front_last, page);
+        }
+        portEXIT_CRITICAL(&front_lock);
+        if (idle) {
+            return ESP_OK;
+        }
+        
+        // Each finished flush gives the semaphore; recheck after every one
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout || xSemaphoreTake(flush_done, timeout - elapsed) != pdTRUE) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
 }
 
 esp_err_t display_draw_text(const char* text, uint8_t x, uint8_t y, display_font_t font, display_align_t align) {
@@ -247,13 +476,15 @@ esp_err_t display_draw_text(const char* text, uint8_t x, uint8_t y, display_font
         return ESP_ERR_INVALID_STATE;
     }
     
-    // For simplicity, we'll just use the 6x8 font for now
-    uint8_t font_width = 6;
-    uint8_t font_height = 8;
+    if (font > DISPLAY_FONT_LARGE) {
+        font = DISPLAY_FONT_SMALL;
+    }
+    const ssd1306_font_t *face = &fonts[font];
+    uint8_t glyph_bytes = face->width * face->pages;
     
     // Calculate text length in pixels
     size_t text_len = strlen(text);
-    uint16_t text_width = text_len * font_width;
+    uint32_t text_width = text_len * face->width;
     
     // Adjust x coordinate based on alignment
     switch (align) {
@@ -272,46 +503,19 @@ esp_err_t display_draw_text(const char* text, uint8_t x, uint8_t y, display_font
     }
     
     // Draw each character
-    uint8_t cursor_x = x;
-    for (size_t i = 0; i < text_len; i++) {
-        char c = text[i];
+    uint16_t cursor_x = x;
+    for (size_t i = 0; i < text_len && cursor_x < SSD1306_WIDTH; i++) {
+        uint8_t c = (uint8_t)text[i];
         
         // Skip non-printable characters
-        if (c < 32 || c > 127) {
+        if (c < FONT_FIRST_CHAR || c >= FONT_FIRST_CHAR + FONT_GLYPHS) {
             continue;
         }
         
-        // Get character index in font array
-        uint16_t char_idx = (c - 32) * font_width;
-        
-        // Draw character (6x8 font only for simplicity)
-        for (uint8_t col = 0; col < font_width; col++) {
-            uint8_t x_pos = cursor_x + col;
-            
-            // Skip if out of bounds
-            if (x_pos >= SSD1306_WIDTH) {
-                break;
-            }
-            
-            uint8_t font_byte = font6x8[char_idx + col];
-            for (uint8_t row = 0; row < 8; row++) {
-                if (y + row >= SSD1306_HEIGHT) {
-                    break;
-                }
-                
-                if (font_byte & (1 << row)) {
-                    ssd1306_set_pixel(x_pos, y + row, 1);
-                }
-            }
-        }
+        ssd1306_blit(&face->glyphs[(c - FONT_FIRST_CHAR) * glyph_bytes], face->width, face->pages, cursor_x, y);
         
         // Move cursor to next character position
-        cursor_x += font_width;
-        
-        // Break if outside display
-        if (cursor_x >= SSD1306_WIDTH) {
-            break;
-        }
+        cursor_x += face->width;
     }
     
     // No need to update display here, caller should call display_update() when needed
@@ -555,7 +759,7 @@ esp_err_t display_show_splash_screen(void) {
     }
     
     // Clear display buffer
-    memset(display_buffer, 0, sizeof(display_buffer));
+    ssd1306_clear_buffer();
     
     // Draw a simple splash screen
     display_draw_text("Sign Language", 0, 16, DISPLAY_FONT_SMALL, DISPLAY_ALIGN_CENTER);
@@ -664,7 +868,13 @@ esp_err_t display_flip_horizontal(bool flip) {
     }
     
     uint8_t command = flip ? (SSD1306_CMD_SET_SEGMENT | 0x00) : (SSD1306_CMD_SET_SEGMENT | 0x01);
-    return ssd1306_write_command(command);
+    esp_err_t ret = ssd1306_write_command(command);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    // Segment remap only applies to data written after it, so rewrite the panel
+    return ssd1306_update_full();
 }
 
 //---------------------- Private functions -----------------------
@@ -674,25 +884,16 @@ static esp_err_t ssd1306_write_command(uint8_t command) {
     return i2c_master_write_to_device(I2C_MASTER_NUM, SSD1306_ADDR, write_buf, sizeof(write_buf), pdMS_TO_TICKS(10));
 }
 
-static esp_err_t ssd1306_write_data(uint8_t* data, size_t len) {
-    // Create temp buffer for data byte + control byte
-    uint8_t *temp_buf = malloc(len + 1);
-    if (temp_buf == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate memory for I2C buffer");
-        return ESP_ERR_NO_MEM;
+static esp_err_t ssd1306_write_commands(const uint8_t *commands, size_t count) {
+    // One control byte, then every command in the same transaction
+    uint8_t write_buf[8];
+    if (count >= sizeof(write_buf)) {
+        return ESP_ERR_INVALID_SIZE;
     }
     
-    // Set control byte for data
-    temp_buf[0] = SSD1306_DATA;
-    memcpy(temp_buf + 1, data, len);
-    
-    // Send data
-    esp_err_t ret = i2c_master_write_to_device(I2C_MASTER_NUM, SSD1306_ADDR, temp_buf, len + 1, pdMS_TO_TICKS(10));
-    
-    // Free temp buffer
-    free(temp_buf);
-    
-    return ret;
+    write_buf[0] = SSD1306_COMMAND;
+    memcpy(write_buf + 1, commands, count);
+    return i2c_master_write_to_device(I2C_MASTER_NUM, SSD1306_ADDR, write_buf, count + 1, pdMS_TO_TICKS(10));
 }
 
 static void ssd1306_set_pixel(uint8_t x, uint8_t y, uint8_t color) {
@@ -704,33 +905,254 @@ static void ssd1306_set_pixel(uint8_t x, uint8_t y, uint8_t color) {
     uint16_t byte_idx = x + (y / 8) * SSD1306_WIDTH;
     uint8_t bit_pos = y % 8;
     
-    // Set or clear the bit
-    if (color) {
-        display_buffer[byte_idx] |= (1 << bit_pos);
-    } else {
-        display_buffer[byte_idx] &= ~(1 << bit_pos);
+    // Set or clear the bit, marking the column only if it changed
+    uint8_t old_value = display_buffer[byte_idx];
+    uint8_t new_value = color ? (old_value | (1 << bit_pos)) : (old_value & ~(1 << bit_pos));
+    if (new_value != old_value) {
+        display_buffer[byte_idx] = new_value;
+        mark_dirty(dirty_first, dirty_last, y / 8, x, x);
     }
 }
 
-static esp_err_t ssd1306_update_full() {
-    esp_err_t ret;
+static void ssd1306_clear_buffer(void) {
+    // Only the columns that were lit become dirty
+    for (uint8_t page = 0; page < SSD1306_PAGES; page++) {
+        uint8_t *row = &display_buffer[page * SSD1306_WIDTH];
+        for (uint8_t x = 0; x < SSD1306_WIDTH; x++) {
+            if (row[x] != 0) {
+                row[x] = 0;
+                mark_dirty(dirty_first, dirty_last, page, x, x);
+            }
+        }
+    }
+}
+
+/*
+ * OR a glyph into the buffer a column byte at a time. On a page boundary
+ * each glyph byte lands in one buffer byte; otherwise it is shifted across
+ * two pages. Clipped at the right and bottom edges.
+ */
+static void ssd1306_blit(const uint8_t *glyph, uint8_t width, uint8_t pages, uint8_t x, uint8_t y) {
+    uint8_t first_page = y / 8;
+    uint8_t shift = y % 8;
+    if (x >= SSD1306_WIDTH || first_page >= SSD1306_PAGES) {
+        return;
+    }
+    uint8_t columns = (x + width > SSD1306_WIDTH) ? SSD1306_WIDTH - x : width;
     
-    // Set column address range
-    ret = ssd1306_write_command(SSD1306_CMD_SET_COL_ADDR);
-    if (ret != ESP_OK) return ret;
-    ret = ssd1306_write_command(0);  // Start column
-    if (ret != ESP_OK) return ret;
-    ret = ssd1306_write_command(SSD1306_WIDTH - 1);  // End column
-    if (ret != ESP_OK) return ret;
+    for (uint8_t p = 0; p < pages; p++) {
+        const uint8_t *src = &glyph[p * width];
+        uint8_t page = first_page + p;
+        
+        for (uint8_t half = 0; half < (shift ? 2 : 1); half++, page++) {
+            if (page >= SSD1306_PAGES) {
+                break;
+            }
+            
+            uint8_t *dst = &display_buffer[page * SSD1306_WIDTH + x];
+            for (uint8_t col = 0; col < columns; col++) {
+                uint8_t bits = half ? (src[col] >> (8 - shift)) : (uint8_t)(src[col] << shift);
+                if ((dst[col] | bits) != dst[col]) {
+                    dst[col] |= bits;
+                    mark_dirty(dirty_first, dirty_last, page, x + col, x + col);
+                }
+            }
+        }
+    }
+}
+
+static void ssd1306_build_scaled_font(uint8_t *glyphs, uint8_t scale) {
+    uint8_t width = FONT_GLYPH_WIDTH * scale;
+    
+    for (uint16_t g = 0; g < FONT_GLYPHS; g++) {
+        uint8_t *glyph = &glyphs[g * width * scale];
+        for (uint8_t col = 0; col < FONT_GLYPH_WIDTH; col++) {
+            // Repeat every row `scale` times down one tall column
+            uint8_t src = font6x8[g * FONT_GLYPH_WIDTH + col];
+            uint32_t tall = 0;
+            for (uint8_t row = 0; row < 8; row++) {
+                if (src & (1 << row)) {
+                    tall |= ((1UL << scale) - 1) << (row * scale);
+                }
+            }
+            
+            for (uint8_t p = 0; p < scale; p++) {
+                for (uint8_t rep = 0; rep < scale; rep++) {
+                    glyph[p * width + col * scale + rep] = (tall >> (p * 8)) & 0xFF;
+                }
+            }
+        }
+    }
+}
+
+static void ssd1306_publish(uint32_t origin_timestamp) {
+    // Copy only the changed columns; the flush task may be sending the rest
+    portENTER_CRITICAL(&front_lock);
+    for (uint8_t page = 0; page < SSD1306_PAGES; page++) {
+        if (!page_dirty(dirty_first, dirty_last, page)) {
+            continue;
+        }
+        
+        size_t offset = page * SSD1306_WIDTH + dirty_first[page];
+        memcpy(&front_buffer[offset], &display_buffer[offset], dirty_last[page] - dirty_first[page] + 1);
+        mark_dirty(front_first, front_last, page, dirty_first[page], dirty_last[page]);
+        mark_clean(dirty_first, dirty_last, page);
+    }
     
-    // Set page address range
-    ret = ssd1306_write_command(SSD1306_CMD_SET_PAGE_ADDR);
-    if (ret != ESP_OK) return ret;
-    ret = ssd1306_write_command(0);  // Start page
-    if (ret != ESP_OK) return ret;
-    ret = ssd1306_write_command(SSD1306_PAGES - 1);  // End page
-    if (ret != ESP_OK) return ret;
+    // Updates merged into one flush are timed from the oldest
+    if (front_origin == 0) {
+        front_origin = origin_timestamp;
+    }
+    portEXIT_CRITICAL(&front_lock);
+    
+    if (flush_task_handle != NULL) {
+        xTaskNotifyGive(flush_task_handle);
+    }
+}
+
+typedef struct {
+    uint8_t first_page;
+    uint8_t last_page;
+    uint8_t first_col;
+    uint8_t last_col;
+} ssd1306_window_t;
+
+/*
+ * Find the next unsent window of the front buffer. Runs of dirty pages
+ * share one window while the clean bytes that adds cost less than
+ * addressing another window. Call under front_lock.
+ */
+static bool ssd1306_next_window(ssd1306_window_t *window) {
+    uint8_t page = 0;
+    while (page < SSD1306_PAGES && !page_dirty(front_first, front_last, page)) {
+        page++;
+    }
+    if (page == SSD1306_PAGES) {
+        return false;
+    }
+    
+    window->first_page = page;
+    window->last_page = page;
+    window->first_col = front_first[page];
+    window->last_col = front_last[page];
+    size_t apart = window->last_col - window->first_col + 1;  // Bus bytes with one window per page
+    
+    while (window->last_page + 1 < SSD1306_PAGES && page_dirty(front_first, front_last, window->last_page + 1)) {
+        uint8_t next = window->last_page + 1;
+        uint8_t merged_first = (front_first[next] < window->first_col) ? front_first[next] : window->first_col;
+        uint8_t merged_last = (front_last[next] > window->last_col) ? front_last[next] : window->last_col;
+        size_t merged = (size_t)(next - window->first_page + 1) * (merged_last - merged_first + 1);
+        size_t next_apart = apart + SSD1306_WINDOW_COST + (front_last[next] - front_first[next] + 1);
+        if (merged > next_apart) {
+            break;
+        }
+        
+        window->first_col = merged_first;
+        window->last_col = merged_last;
+        window->last_page = next;
+        apart = next_apart;
+    }
+    
+    return true;
+}
+
+/*
+ * Copy a window into tx_buffer row by row, as horizontal addressing takes
+ * it, and mark it sent. Call under front_lock. Returns the bytes to write.
+ */
+static size_t ssd1306_take_window(const ssd1306_window_t *window) {
+    size_t width = window->last_col - window->first_col + 1;
+    size_t len = 1;
+    
+    tx_buffer[0] = SSD1306_DATA;
+    for (uint8_t page = window->first_page; page <= window->last_page; page++) {
+        memcpy(&tx_buffer[len], &front_buffer[page * SSD1306_WIDTH + window->first_col], width);
+        len += width;
+        mark_clean(front_first, front_last, page);
+    }
+    
+    return len;
+}
+
+static esp_err_t ssd1306_write_window(const ssd1306_window_t *window, size_t len) {
+    const uint8_t addressing[] = {
+        SSD1306_CMD_SET_COL_ADDR, window->first_col, window->last_col,
+        SSD1306_CMD_SET_PAGE_ADDR, window->first_page, window->last_page
+    };
+    esp_err_t ret = ssd1306_write_commands(addressing, sizeof(addressing));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    return i2c_master_write_to_device(I2C_MASTER_NUM, SSD1306_ADDR, tx_buffer, len,
+                                      pdMS_TO_TICKS(10 + len / SSD1306_BYTES_PER_MS));
+}
+
+static esp_err_t ssd1306_flush(void) {
+    esp_err_t ret = ESP_OK;
+    ssd1306_window_t window;
+    
+    portENTER_CRITICAL(&front_lock);
+    uint32_t origin = front_origin;
+    front_origin = 0;
+    flush_busy = true;
+    portEXIT_CRITICAL(&front_lock);
+    
+    CYCLE_TRACE_BEGIN(CYCLE_TRACE_DISPLAY_UPDATE);
+    while (1) {
+        // Windows published meanwhile are picked up by the same pass
+        portENTER_CRITICAL(&front_lock);
+        bool found = ssd1306_next_window(&window);
+        size_t len = found ? ssd1306_take_window(&window) : 0;
+        portEXIT_CRITICAL(&front_lock);
+        if (!found) {
+            break;
+        }
+        
+        ret = ssd1306_write_window(&window, len);
+        if (ret != ESP_OK) {
+            // Leave the window unsent for the next update
+            portENTER_CRITICAL(&front_lock);
+            for (uint8_t page = window.first_page; page <= window.last_page; page++) {
+                mark_dirty(front_first, front_last, page, window.first_col, window.last_col);
+            }
+            if (front_origin == 0) {
+                front_origin = origin;
+            }
+            portEXIT_CRITICAL(&front_lock);
+            break;
+        }
+    }
+    CYCLE_TRACE_END(CYCLE_TRACE_DISPLAY_UPDATE);
+    
+    portENTER_CRITICAL(&front_lock);
+    flush_busy = false;
+    portEXIT_CRITICAL(&front_lock);
+    
+    if (ret == ESP_OK) {
+        system_monitor_record_output(OUTPUT_SINK_DISPLAY, origin);
+    }
+    return ret;
+}
+
+static void display_flush_task(void *arg) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        
+        esp_err_t ret = ssd1306_flush();
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Display flush failed: %s", esp_err_to_name(ret));
+        }
+        xSemaphoreGive(flush_done);
+    }
+}
+
+static esp_err_t ssd1306_update_full() {
+    // Whole buffer, for when the panel's RAM cannot be trusted
+    for (uint8_t page = 0; page < SSD1306_PAGES; page++) {
+        mark_dirty(dirty_first, dirty_last, page, 0, SSD1306_WIDTH - 1);
+    }
     
-    // Send the buffer
-    return ssd1306_write_data(display_buffer, sizeof(display_buffer));
-}
\ No newline at end of file
+    ssd1306_publish(0);
+    return ESP_OK;
+}
@@ -19,8 +19,8 @@ typedef enum {
  */
 typedef enum {
     DISPLAY_FONT_SMALL = 0,  // 6x8 pixels
-    DISPLAY_FONT_MEDIUM,     // 8x16 pixels
-    DISPLAY_FONT_LARGE       // 16x24 pixels
+    DISPLAY_FONT_MEDIUM,     // 12x16 pixels, small scaled 2x
+    DISPLAY_FONT_LARGE       // 18x24 pixels, small scaled 3x
 } display_font_t;
 
 /**
@@ -62,10 +62,33 @@ esp_err_t display_clear(void);
 /**
  * @brief Update the display with current buffer content
  * 
+ * Hands the areas drawn since the last update to the display flush task
+ * and returns without waiting for the I2C transfer. Updates made while a
+ * flush is running are sent by the same or the next flush.
+ * 
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t display_update(void);
 
+/**
+ * @brief Update the display, timing it from a gesture sample
+ * 
+ * Like display_update(); once the flush carrying this content completes,
+ * the latency from origin_timestamp is recorded for the display sink.
+ * 
+ * @param origin_timestamp Sample time of the gesture shown, 0 if none
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t display_update_with_origin(uint32_t origin_timestamp);
+
+/**
+ * @brief Wait until every update has reached the display
+ * 
+ * @param timeout_ms Maximum time to wait
+ * @return ESP_OK when idle, ESP_ERR_TIMEOUT if a flush is still pending or failed
+ */
+esp_err_t display_wait_flush(uint32_t timeout_ms);
+
 /**
  * @brief Draw a text string at specified position
  * 
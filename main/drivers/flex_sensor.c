@@ -1,21 +1,30 @@
 #include "drivers/flex_sensor.h"
 #include <string.h>
 #include "esp_log.h"
-#include "driver/adc.h"
-#include "esp_adc_cal.h"
+#include "esp_timer.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_continuous.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "config/pin_definitions.h"
+#include "config/system_config.h"
 #include "util/debug.h"
+#include "util/filter_bank.h"
 
 static const char *TAG = "FLEX_SENSOR";
 
-// NVS namespace for flex sensor calibration
+// NVS entry earlier firmware kept the calibration in
 #define FLEX_SENSOR_NVS_NAMESPACE "flex_sensor"
 #define FLEX_SENSOR_NVS_KEY "calibration"
 
-// Filter buffer size for moving average
-#define FILTER_BUFFER_SIZE 5
+// Default filter: moving average over 5 samples
+#define FLEX_FILTER_DEFAULT_WINDOW 5
+
+// Continuous mode DMA sizing: one conversion frame holds a full scan of
+// every joint at the maximum oversampling factor
+#define FLEX_ADC_MAX_OVERSAMPLE   (16)
+#define FLEX_ADC_FRAME_BYTES      (FINGER_JOINT_COUNT * FLEX_ADC_MAX_OVERSAMPLE * SOC_ADC_DIGI_RESULT_BYTES)
+#define FLEX_ADC_POOL_BYTES       (FLEX_ADC_FRAME_BYTES * 4)
 
 // Flex sensor calibration data
 static flex_sensor_calibration_t sensor_calibration = {
@@ -25,8 +34,14 @@ static flex_sensor_calibration_t sensor_calibration = {
     .offset = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f}
 };
 
+// Calibration came from RTC memory; skip the filter warm-up
+static bool calibration_restored = false;
+
+// Calibration was handed in before init; skip the defaults
+static bool calibration_set = false;
+
 // ADC channel mapping to finger joints
-static const adc1_channel_t adc_channels[FINGER_JOINT_COUNT] = {
+static const adc_channel_t adc_channels[FINGER_JOINT_COUNT] = {
     FLEX_SENSOR_THUMB_MCP_ADC_CHANNEL,
     FLEX_SENSOR_THUMB_PIP_ADC_CHANNEL,
     FLEX_SENSOR_INDEX_MCP_ADC_CHANNEL,
@@ -39,13 +54,32 @@ static const adc1_channel_t adc_channels[FINGER_JOINT_COUNT] = {
     FLEX_SENSOR_PINKY_PIP_ADC_CHANNEL
 };
 
-// ADC calibration
-static esp_adc_cal_characteristics_t adc_chars;
+// One-shot unit, only open while the DMA scan is stopped
+static adc_oneshot_unit_handle_t adc_oneshot_handle = NULL;
 
-// Filter buffers for each sensor
-static uint16_t filter_buffers[FINGER_JOINT_COUNT][FILTER_BUFFER_SIZE];
-static uint8_t filter_index[FINGER_JOINT_COUNT] = {0};
+// Per-joint filter bank
+static filter_bank_t flex_filters;
 static bool filtering_enabled = true;
+static int64_t last_filter_time_us = 0;
+
+// Continuous (DMA) acquisition state
+static adc_continuous_handle_t adc_continuous_handle = NULL;
+static bool continuous_running = false;
+static uint8_t adc_read_buffer[FLEX_ADC_FRAME_BYTES];
+
+// Most recent filtered frame, shared by read_raw and read_angles
+static uint16_t last_raw_values[FINGER_JOINT_COUNT];
+static bool frame_pending_angles = false;
+
+// Map an ADC channel back to its joint (-1 if not a flex channel)
+static int channel_to_joint(uint32_t channel) {
+    for (int i = 0; i < FINGER_JOINT_COUNT; i++) {
+        if ((uint32_t)adc_channels[i] == channel) {
+            return i;
+        }
+    }
+    return -1;
+}
 
 // Function to calculate calibration scaling factors
 static void calculate_calibration_factors(void) {
@@ -69,60 +103,167 @@ static void calculate_calibration_factors(void) {
     }
 }
 
-// Function to apply moving average filter
-static uint16_t apply_filter(finger_joint_t joint, uint16_t raw_value) {
+// Time since the previous filtered sample, nominal period on the first call
+static float filter_dt_sec(void) {
+    int64_t now = esp_timer_get_time();
+    float dt = (last_filter_time_us > 0) ? (now - last_filter_time_us) / 1000000.0f
+                                         : 1.0f / FLEX_SENSOR_SAMPLE_RATE_HZ;
+    last_filter_time_us = now;
+    return dt;
+}
+
+// Filter a full frame in one pass over all joints
+static void apply_filters(const uint16_t* frame, uint16_t* raw_values) {
     if (!filtering_enabled) {
-        return raw_value;
+        memcpy(raw_values, frame, sizeof(uint16_t) * FINGER_JOINT_COUNT);
+        return;
+    }
+    
+    float samples[FINGER_JOINT_COUNT];
+    for (int i = 0; i < FINGER_JOINT_COUNT; i++) {
+        samples[i] = frame[i];
     }
     
-    // Add current value to filter buffer
-    filter_buffers[joint][filter_index[joint]] = raw_value;
-    filter_index[joint] = (filter_index[joint] + 1) % FILTER_BUFFER_SIZE;
+    filter_bank_process(&flex_filters, samples, samples, filter_dt_sec());
     
-    // Calculate mean
-    uint32_t sum = 0;
-    for (int i = 0; i < FILTER_BUFFER_SIZE; i++) {
-        sum += filter_buffers[joint][i];
+    for (int i = 0; i < FINGER_JOINT_COUNT; i++) {
+        raw_values[i] = (samples[i] > 0.0f) ? (uint16_t)(samples[i] + 0.5f) : 0;
+    }
+}
+
+// Filter a single joint
+static uint16_t apply_filter(finger_joint_t joint, uint16_t raw_value) {
+    if (!filtering_enabled) {
+        return raw_value;
     }
     
-    return (uint16_t)(sum / FILTER_BUFFER_SIZE);
+    float filtered = filter_bank_process_channel(&flex_filters, joint, raw_value, filter_dt_sec());
+    return (filtered > 0.0f) ? (uint16_t)(filtered + 0.5f) : 0;
 }
 
-esp_err_t flex_sensor_init(void) {
-    esp_err_t ret;
+// Convert a filtered raw value to a joint angle constrained to 0-90 degrees
+static float raw_to_angle(finger_joint_t joint, uint16_t raw_value) {
+    float angle = sensor_calibration.scale_factor[joint] * raw_value + sensor_calibration.offset[joint];
+    
+    if (angle < 0.0f) {
+        angle = 0.0f;
+    } else if (angle > 90.0f) {
+        angle = 90.0f;
+    }
     
-    // Configure ADC
-    adc1_config_width(ADC_WIDTH_BIT_12);
+    return angle;
+}
+
+// Drain every conversion the DMA has completed since the last call and
+// average them per joint (oversampling). Joints with no new conversions
+// keep their previous value.
+static esp_err_t read_continuous_frame(uint16_t* raw_values) {
+    uint32_t sums[FINGER_JOINT_COUNT] = {0};
+    uint16_t counts[FINGER_JOINT_COUNT] = {0};
+    uint32_t length = 0;
+    
+    while (adc_continuous_read(adc_continuous_handle, adc_read_buffer, sizeof(adc_read_buffer), 
+                               &length, 0) == ESP_OK) {
+        for (uint32_t offset = 0; offset + SOC_ADC_DIGI_RESULT_BYTES <= length; 
+             offset += SOC_ADC_DIGI_RESULT_BYTES) {
+            adc_digi_output_data_t *sample = (adc_digi_output_data_t *)&adc_read_buffer[offset];
+            int joint = channel_to_joint(sample->type2.channel);
+            if (joint >= 0) {
+                sums[joint] += sample->type2.data;
+                counts[joint]++;
+            }
+        }
+    }
     
-    // Configure channels
     for (int i = 0; i < FINGER_JOINT_COUNT; i++) {
-        adc1_config_channel_atten(adc_channels[i], FLEX_SENSOR_ADC_ATTENUATION);
+        if (counts[i] > 0) {
+            raw_values[i] = (uint16_t)(sums[i] / counts[i]);
+        } else {
+            raw_values[i] = last_raw_values[i];
+        }
+    }
+    
+    return ESP_OK;
+}
+
+// Claim ADC1 for one-shot reads of the joints
+static esp_err_t oneshot_open(void) {
+    if (adc_oneshot_handle != NULL) {
+        return ESP_OK;
     }
     
-    // Characterize ADC
-    esp_adc_cal_characterize(FLEX_SENSOR_ADC_UNIT, FLEX_SENSOR_ADC_ATTENUATION, 
-                            FLEX_SENSOR_ADC_BIT_WIDTH, 0, &adc_chars);
+    adc_oneshot_unit_init_cfg_t unit_config = {
+        .unit_id = FLEX_SENSOR_ADC_UNIT,
+    };
+    esp_err_t ret = adc_oneshot_new_unit(&unit_config, &adc_oneshot_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create one-shot ADC unit: %s", esp_err_to_name(ret));
+        return ret;
+    }
     
-    // Initialize filter buffers
+    adc_oneshot_chan_cfg_t channel_config = {
+        .atten = FLEX_SENSOR_ADC_ATTENUATION,
+        .bitwidth = FLEX_SENSOR_ADC_BIT_WIDTH,
+    };
     for (int i = 0; i < FINGER_JOINT_COUNT; i++) {
-        for (int j = 0; j < FILTER_BUFFER_SIZE; j++) {
-            filter_buffers[i][j] = 0;
-        }
-        filter_index[i] = 0;
+        adc_oneshot_config_channel(adc_oneshot_handle, adc_channels[i], &channel_config);
     }
     
-    // Load calibration data
-    ret = flex_sensor_load_calibration();
+    return ESP_OK;
+}
+
+// Hand ADC1 over to the DMA scan
+static void oneshot_close(void) {
+    if (adc_oneshot_handle != NULL) {
+        adc_oneshot_del_unit(adc_oneshot_handle);
+        adc_oneshot_handle = NULL;
+    }
+}
+
+static uint16_t oneshot_read(adc_channel_t channel) {
+    int raw = 0;
+    adc_oneshot_read(adc_oneshot_handle, channel, &raw);
+    return (uint16_t)raw;
+}
+
+esp_err_t flex_sensor_init(void) {
+    esp_err_t ret;
+    
+    // One-shot reads until (and unless) the DMA scan takes over
+    ret = oneshot_open();
     if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to load calibration data, using defaults");
+        return ret;
+    }
+    
+    // Initialize filter bank with the default moving average on every joint
+    filter_bank_init(&flex_filters, FINGER_JOINT_COUNT);
+    filter_config_t default_filter = {
+        .type = FILTER_TYPE_MOVING_AVERAGE,
+        .window = FLEX_FILTER_DEFAULT_WINDOW,
+    };
+    filter_bank_configure(&flex_filters, FILTER_BANK_ALL_CHANNELS, &default_filter);
+    
+    // Calibration comes from the calibration engine or deep sleep
+    if (!calibration_set) {
+        ESP_LOGW(TAG, "No calibration data, using defaults");
         calculate_calibration_factors();
     }
     
-    // Read initial values to fill filter buffers
-    uint16_t raw_values[FINGER_JOINT_COUNT];
-    for (int i = 0; i < 10; i++) {
-        flex_sensor_read_raw(raw_values);
-        vTaskDelay(pdMS_TO_TICKS(10));
+#if FLEX_SENSOR_CONTINUOUS_MODE
+    // Scan all joints by DMA instead of blocking conversions
+    ret = flex_sensor_start_continuous(FLEX_SENSOR_SAMPLE_RATE_HZ, FLEX_SENSOR_OVERSAMPLE);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Continuous ADC unavailable, using one-shot reads: %s", esp_err_to_name(ret));
+    }
+#endif
+    
+    // Read initial values to fill filter buffers (not worth the wait on a warm wake)
+    if (!calibration_restored) {
+        uint16_t raw_values[FINGER_JOINT_COUNT];
+        for (int i = 0; i < 10; i++) {
+            flex_sensor_read_raw(raw_values);
+            vTaskDelay(pdMS_TO_TICKS(10));
+        }
     }
     
     ESP_LOGI(TAG, "Flex sensors initialized");
@@ -134,12 +275,22 @@ esp_err_t flex_sensor_read_raw(uint16_t* raw_values) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    // Read raw values and apply filtering
-    for (int i = 0; i < FINGER_JOINT_COUNT; i++) {
-        uint16_t raw = adc1_get_raw(adc_channels[i]);
-        raw_values[i] = apply_filter(i, raw);
+    uint16_t frame[FINGER_JOINT_COUNT];
+    
+    if (continuous_running) {
+        // Latest oversampled frame from the DMA ring
+        read_continuous_frame(frame);
+    } else {
+        for (int i = 0; i < FINGER_JOINT_COUNT; i++) {
+            frame[i] = oneshot_read(adc_channels[i]);
+        }
     }
     
+    // Apply filtering and keep the frame for read_angles
+    apply_filters(frame, raw_values);
+    memcpy(last_raw_values, raw_values, sizeof(last_raw_values));
+    frame_pending_angles = true;
+    
     return ESP_OK;
 }
 
@@ -148,22 +299,19 @@ esp_err_t flex_sensor_read_angles(float* angles) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    uint16_t raw_values[FINGER_JOINT_COUNT];
-    esp_err_t ret = flex_sensor_read_raw(raw_values);
-    if (ret != ESP_OK) {
-        return ret;
+    // Reuse the frame from the preceding read_raw, sample only if it was already consumed
+    if (!frame_pending_angles) {
+        uint16_t raw_values[FINGER_JOINT_COUNT];
+        esp_err_t ret = flex_sensor_read_raw(raw_values);
+        if (ret != ESP_OK) {
+            return ret;
+        }
     }
+    frame_pending_angles = false;
     
     // Calculate angles using calibration data
     for (int i = 0; i < FINGER_JOINT_COUNT; i++) {
-        angles[i] = sensor_calibration.scale_factor[i] * raw_values[i] + sensor_calibration.offset[i];
-        
-        // Constrain angles to 0-90 degrees
-        if (angles[i] < 0.0f) {
-            angles[i] = 0.0f;
-        } else if (angles[i] > 90.0f) {
-            angles[i] = 90.0f;
-        }
+        angles[i] = raw_to_angle(i, last_raw_values[i]);
     }
     
     return ESP_OK;
@@ -174,18 +322,17 @@ esp_err_t flex_sensor_read_joint(finger_joint_t joint, uint16_t* raw_value, floa
         return ESP_ERR_INVALID_ARG;
     }
     
-    // Read raw value
-    *raw_value = apply_filter(joint, adc1_get_raw(adc_channels[joint]));
+    // Read raw value (the DMA scan owns ADC1 in continuous mode)
+    if (continuous_running) {
+        uint16_t frame[FINGER_JOINT_COUNT];
+        read_continuous_frame(frame);
+        *raw_value = apply_filter(joint, frame[joint]);
+    } else {
+        *raw_value = apply_filter(joint, oneshot_read(adc_channels[joint]));
+    }
     
     // Calculate angle
-    *angle = sensor_calibration.scale_factor[joint] * (*raw_value) + sensor_calibration.offset[joint];
-    
-    // Constrain angle to 0-90 degrees
-    if (*angle < 0.0f) {
-        *angle = 0.0f;
-    } else if (*angle > 90.0f) {
-        *angle = 90.0f;
-    }
+    *angle = raw_to_angle(joint, *raw_value);
     
     return ESP_OK;
 }
@@ -212,38 +359,8 @@ esp_err_t flex_sensor_calibrate_bent(void) {
     return ESP_OK;
 }
 
-esp_err_t flex_sensor_save_calibration(void) {
-    ESP_LOGI(TAG, "Saving flex sensor calibration...");
-    
-    nvs_handle_t nvs_handle;
-    esp_err_t ret;
-    
-    ret = nvs_open(FLEX_SENSOR_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    // Write calibration data to NVS
-    ret = nvs_set_blob(nvs_handle, FLEX_SENSOR_NVS_KEY, &sensor_calibration, sizeof(flex_sensor_calibration_t));
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error writing to NVS: %s", esp_err_to_name(ret));
-        nvs_close(nvs_handle);
-        return ret;
-    }
-    
-    // Commit the changes
-    ret = nvs_commit(nvs_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error committing NVS changes: %s", esp_err_to_name(ret));
-    }
-    
-    nvs_close(nvs_handle);
-    return ret;
-}
-
 esp_err_t flex_sensor_load_calibration(void) {
-    ESP_LOGI(TAG, "Loading flex sensor calibration...");
+    ESP_LOGI(TAG, "Loading flex sensor calibration from its own NVS entry...");
     
     nvs_handle_t nvs_handle;
     esp_err_t ret;
@@ -267,6 +384,7 @@ esp_err_t flex_sensor_load_calibration(void) {
     
     // Calculate calibration factors
     calculate_calibration_factors();
+    calibration_set = true;
     
     return ESP_OK;
 }
@@ -283,8 +401,7 @@ esp_err_t flex_sensor_reset_calibration(void) {
     // Calculate calibration factors
     calculate_calibration_factors();
     
-    // Save to NVS
-    return flex_sensor_save_calibration();
+    return ESP_OK;
 }
 
 esp_err_t flex_sensor_get_calibration(flex_sensor_calibration_t* calibration) {
@@ -298,22 +415,143 @@ esp_err_t flex_sensor_get_calibration(flex_sensor_calibration_t* calibration) {
     return ESP_OK;
 }
 
+esp_err_t flex_sensor_set_calibration(const flex_sensor_calibration_t* calibration) {
+    if (calibration == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    memcpy(sensor_calibration.flat_value, calibration->flat_value, sizeof(sensor_calibration.flat_value));
+    memcpy(sensor_calibration.bent_value, calibration->bent_value, sizeof(sensor_calibration.bent_value));
+    calculate_calibration_factors();
+    calibration_set = true;
+    
+    return ESP_OK;
+}
+
+esp_err_t flex_sensor_restore_calibration(const flex_sensor_calibration_t* calibration) {
+    if (calibration == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    memcpy(&sensor_calibration, calibration, sizeof(flex_sensor_calibration_t));
+    calibration_restored = true;
+    calibration_set = true;
+    
+    return ESP_OK;
+}
+
 esp_err_t flex_sensor_set_filtering(bool enable) {
     filtering_enabled = enable;
     
-    // If filtering is being enabled, reset filter buffers
+    // If filtering is being enabled, re-prime the filters from the next sample
     if (enable) {
-        uint16_t raw_values[FINGER_JOINT_COUNT];
-        flex_sensor_read_raw(raw_values);
-        
-        for (int i = 0; i < FINGER_JOINT_COUNT; i++) {
-            for (int j = 0; j < FILTER_BUFFER_SIZE; j++) {
-                filter_buffers[i][j] = raw_values[i];
-            }
-            filter_index[i] = 0;
-        }
+        filter_bank_reset(&flex_filters, NULL);
+        last_filter_time_us = 0;
     }
     
     ESP_LOGI(TAG, "Flex sensor filtering %s", enable ? "enabled" : "disabled");
     return ESP_OK;
-}
\ No newline at end of file
+}
+
+esp_err_t flex_sensor_start_continuous(uint32_t scan_rate_hz, uint8_t oversample) {
+    if (scan_rate_hz == 0 || oversample == 0 || oversample > FLEX_ADC_MAX_OVERSAMPLE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (continuous_running) {
+        flex_sensor_stop_continuous();
+    }
+    
+    // Continuous and one-shot mode cannot share ADC1
+    oneshot_close();
+    
+    adc_continuous_handle_cfg_t handle_config = {
+        .max_store_buf_size = FLEX_ADC_POOL_BYTES,
+        .conv_frame_size = FINGER_JOINT_COUNT * oversample * SOC_ADC_DIGI_RESULT_BYTES,
+    };
+    
+    esp_err_t ret = adc_continuous_new_handle(&handle_config, &adc_continuous_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create continuous ADC handle: %s", esp_err_to_name(ret));
+        oneshot_open();
+        return ret;
+    }
+    
+    // One pattern entry per joint, scanned in order
+    adc_digi_pattern_config_t patterns[FINGER_JOINT_COUNT];
+    for (int i = 0; i < FINGER_JOINT_COUNT; i++) {
+        patterns[i].atten = FLEX_SENSOR_ADC_ATTENUATION;
+        patterns[i].channel = (uint8_t)adc_channels[i];
+        patterns[i].unit = FLEX_SENSOR_ADC_UNIT;
+        patterns[i].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+    }
+    
+    // Conversion rate covers every joint `oversample` times per scan period
+    adc_continuous_config_t adc_config = {
+        .pattern_num = FINGER_JOINT_COUNT,
+        .adc_pattern = patterns,
+        .sample_freq_hz = scan_rate_hz * FINGER_JOINT_COUNT * oversample,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+    };
+    
+    if (adc_config.sample_freq_hz < SOC_ADC_SAMPLE_FREQ_THRES_LOW) {
+        adc_config.sample_freq_hz = SOC_ADC_SAMPLE_FREQ_THRES_LOW;
+    }
+    
+    ret = adc_continuous_config(adc_continuous_handle, &adc_config);
+    if (ret == ESP_OK) {
+        ret = adc_continuous_start(adc_continuous_handle);
+    }
+    
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start continuous ADC: %s", esp_err_to_name(ret));
+        adc_continuous_deinit(adc_continuous_handle);
+        adc_continuous_handle = NULL;
+        oneshot_open();
+        return ret;
+    }
+    
+    continuous_running = true;
+    ESP_LOGI(TAG, "Continuous ADC running at %lu Hz (%ux oversampling)", 
+             (unsigned long)adc_config.sample_freq_hz, oversample);
+    
+    return ESP_OK;
+}
+
+esp_err_t flex_sensor_stop_continuous(void) {
+    if (!continuous_running) {
+        return ESP_OK;
+    }
+    
+    continuous_running = false;
+    adc_continuous_stop(adc_continuous_handle);
+    adc_continuous_deinit(adc_continuous_handle);
+    adc_continuous_handle = NULL;
+    
+    // Back to one-shot reads of the joints
+    oneshot_open();
+    
+    ESP_LOGI(TAG, "Continuous ADC stopped");
+    return ESP_OK;
+}
+
+esp_err_t flex_sensor_set_filter(finger_joint_t joint, const filter_config_t* config) {
+    if (config == NULL || joint > FINGER_JOINT_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    uint8_t channel = (joint == FINGER_JOINT_COUNT) ? FILTER_BANK_ALL_CHANNELS : (uint8_t)joint;
+    esp_err_t ret = filter_bank_configure(&flex_filters, channel, config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    ESP_LOGI(TAG, "Flex filter type %d set on %s", config->type, 
+             (joint == FINGER_JOINT_COUNT) ? "all joints" : "one joint");
+    return ESP_OK;
+}
+
+bool flex_sensor_is_continuous(void) {
+    return continuous_running;
+}
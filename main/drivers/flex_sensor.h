@@ -3,6 +3,8 @@
 
 #include "esp_err.h"
 #include <stdint.h>
+#include <stdbool.h>
+#include "util/filter_bank.h"
 
 /**
  * @brief Finger joint identifiers
@@ -49,6 +51,9 @@ esp_err_t flex_sensor_read_raw(uint16_t* raw_values);
 /**
  * @brief Read calibrated angle values from all flex sensors
  * 
+ * Converts the frame returned by the preceding flex_sensor_read_raw()
+ * when it has not been converted yet, otherwise acquires a new frame.
+ * 
  * @param angles Array to store angle values in degrees (10 values)
  * @return ESP_OK on success, error code otherwise
  */
@@ -67,6 +72,9 @@ esp_err_t flex_sensor_read_joint(finger_joint_t joint, uint16_t* raw_value, floa
 /**
  * @brief Calibrate flex sensors using current position as flat (0 degrees)
  * 
+ * Takes a single frame and is not persisted; the guided session in
+ * core/calibration.h averages many and stores the result.
+ * 
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t flex_sensor_calibrate_flat(void);
@@ -74,19 +82,17 @@ esp_err_t flex_sensor_calibrate_flat(void);
 /**
  * @brief Calibrate flex sensors using current position as bent (90 degrees)
  * 
+ * Takes a single frame and is not persisted, as flex_sensor_calibrate_flat().
+ * 
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t flex_sensor_calibrate_bent(void);
 
 /**
- * @brief Save flex sensor calibration data to non-volatile storage
+ * @brief Load calibration saved by earlier firmware in the driver's own NVS entry
  * 
- * @return ESP_OK on success, error code otherwise
- */
-esp_err_t flex_sensor_save_calibration(void);
-
-/**
- * @brief Load flex sensor calibration data from non-volatile storage
+ * Only read by the calibration engine when its blob does not exist yet;
+ * calibration is otherwise kept in the blob (core/calibration.h).
  * 
  * @return ESP_OK on success, error code otherwise
  */
@@ -95,6 +101,8 @@ esp_err_t flex_sensor_load_calibration(void);
 /**
  * @brief Reset flex sensor calibration to default values
  * 
+ * Not persisted until calibration_save().
+ * 
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t flex_sensor_reset_calibration(void);
@@ -107,12 +115,74 @@ esp_err_t flex_sensor_reset_calibration(void);
  */
 esp_err_t flex_sensor_get_calibration(flex_sensor_calibration_t* calibration);
 
+/**
+ * @brief Set the flat and bent values of every joint
+ * 
+ * Can be called before flex_sensor_init(), which then keeps them instead
+ * of the defaults, or at any time after. Scale factors and offsets are
+ * recomputed from the two values.
+ * 
+ * @param calibration Calibration, only flat_value and bent_value are used
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t flex_sensor_set_calibration(const flex_sensor_calibration_t* calibration);
+
+/**
+ * @brief Restore calibration kept across deep sleep, before flex_sensor_init()
+ * 
+ * flex_sensor_init() then skips the defaults and the filter warm-up; the
+ * filters settle on the first samples instead.
+ * 
+ * @param calibration Calibration from flex_sensor_get_calibration()
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t flex_sensor_restore_calibration(const flex_sensor_calibration_t* calibration);
+
 /**
  * @brief Apply digital filtering to flex sensor readings
  * 
+ * Bypasses the filter bank without changing the per-joint filter selection.
+ * 
  * @param enable Enable or disable filtering
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t flex_sensor_set_filtering(bool enable);
 
+/**
+ * @brief Select the filter applied to a joint
+ * 
+ * @param joint Finger joint, or FINGER_JOINT_COUNT for all joints
+ * @param config Filter configuration (see util/filter_bank.h)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t flex_sensor_set_filter(finger_joint_t joint, const filter_config_t* config);
+
+/**
+ * @brief Start continuous (DMA) acquisition of all flex channels
+ * 
+ * ADC1 scans every joint into a DMA ring; flex_sensor_read_raw() then just
+ * drains and averages the conversions completed since the previous read.
+ * While running, ADC1 is owned by the scan and must not be used for
+ * one-shot reads elsewhere.
+ * 
+ * @param scan_rate_hz Full scans per second (read rate)
+ * @param oversample Conversions per joint per scan (1-16)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t flex_sensor_start_continuous(uint32_t scan_rate_hz, uint8_t oversample);
+
+/**
+ * @brief Stop continuous acquisition and return to one-shot reads
+ * 
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t flex_sensor_stop_continuous(void);
+
+/**
+ * @brief Check whether continuous acquisition is running
+ * 
+ * @return true if the DMA scan is active
+ */
+bool flex_sensor_is_continuous(void);
+
 #endif /* DRIVERS_FLEX_SENSOR_H */
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
+#include "freertos/semphr.h"
 #include "config/pin_definitions.h"
 #include "util/debug.h"
 
@@ -28,6 +29,7 @@ static uint8_t haptic_intensity = 100;  // 0-100%
 static const haptic_pattern_t *current_pattern = NULL;
 static int current_step = 0;
 static uint8_t current_pattern_length = 0;
+static SemaphoreHandle_t haptic_done_signal = NULL;  // Given when feedback ends
 
 // Forward declarations
 static void haptic_timer_callback(TimerHandle_t xTimer);
@@ -220,12 +222,24 @@ esp_err_t haptic_is_active(bool *active) {
     return ESP_OK;
 }
 
+void haptic_set_done_signal(SemaphoreHandle_t done) {
+    haptic_done_signal = done;
+}
+
+static void haptic_finish(void) {
+    haptic_set_motor_duty(0);  // Turn off motor
+    haptic_active = false;
+    
+    if (haptic_done_signal != NULL) {
+        xSemaphoreGive(haptic_done_signal);
+    }
+}
+
 // Timer callback function for haptic pattern generation
 static void haptic_timer_callback(TimerHandle_t xTimer) {
     if (current_pattern == NULL) {
         // Simple vibrate mode
-        haptic_set_motor_duty(0);  // Turn off motor
-        haptic_active = false;
+        haptic_finish();
         return;
     }
     
@@ -234,8 +248,7 @@ static void haptic_timer_callback(TimerHandle_t xTimer) {
     
     if (current_step >= current_pattern_length) {
         // Pattern complete
-        haptic_set_motor_duty(0);  // Turn off motor
-        haptic_active = false;
+        haptic_finish();
         return;
     }
     
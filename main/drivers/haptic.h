@@ -4,6 +4,8 @@
 #include "esp_err.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 /**
  * @brief Haptic pattern step definition
@@ -67,4 +69,13 @@ esp_err_t haptic_stop(void);
  */
 esp_err_t haptic_is_active(bool *active);
 
+/**
+ * @brief Set a semaphore to give whenever a vibration or pattern ends
+ * 
+ * Given from the timer service task, not when stopped with haptic_stop().
+ * 
+ * @param done Binary semaphore, NULL for none
+ */
+void haptic_set_done_signal(SemaphoreHandle_t done);
+
 #endif /* DRIVERS_HAPTIC_H */
\ No newline at end of file
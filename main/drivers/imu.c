@@ -2,12 +2,16 @@
 #include <string.h>
 #include "esp_log.h"
 #include "driver/i2c.h"
+#include "driver/gpio.h"
 #include "esp_timer.h"
+#include "esp_attr.h"
 #include "math.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "config/pin_definitions.h"
+#include "config/system_config.h"
 #include "util/debug.h"
+#include "util/ahrs.h"
 
 static const char *TAG = "IMU";
 
@@ -16,6 +20,7 @@ static const char *TAG = "IMU";
 
 // MPU6050 registers
 #define MPU6050_REG_PWR_MGMT_1    0x6B
+#define MPU6050_REG_PWR_MGMT_2    0x6C
 #define MPU6050_REG_SMPLRT_DIV    0x19
 #define MPU6050_REG_CONFIG        0x1A
 #define MPU6050_REG_GYRO_CONFIG   0x1B
@@ -29,19 +34,38 @@ static const char *TAG = "IMU";
 #define MPU6050_REG_MOT_DETECT_CTRL 0x69
 #define MPU6050_REG_INT_STATUS    0x3A
 #define MPU6050_REG_WHO_AM_I      0x75
+#define MPU6050_REG_FIFO_EN       0x23
+#define MPU6050_REG_INT_PIN_CFG   0x37
+#define MPU6050_REG_USER_CTRL     0x6A
+#define MPU6050_REG_FIFO_COUNTH   0x72
+#define MPU6050_REG_FIFO_R_W      0x74
 
 // MPU6050 constants
 #define MPU6050_CLOCK_PLL_XGYRO   0x01
 #define MPU6050_INT_ENABLE_DATA_RDY  0x01
 #define MPU6050_INT_ENABLE_MOT    0x40
+#define MPU6050_INT_STATUS_FIFO_OFLOW 0x10
 #define MPU6050_WHO_AM_I_VAL      0x68
+#define MPU6050_FIFO_EN_GYRO_ACCEL 0x78  // XG, YG, ZG and ACCEL into the FIFO
+#define MPU6050_USER_CTRL_FIFO_EN  0x40
+#define MPU6050_USER_CTRL_FIFO_RESET 0x04
+#define MPU6050_INT_PIN_RD_CLEAR   0x10  // Any register read clears INT_STATUS
+#define MPU6050_INT_PIN_LATCH      0x20  // INT held high until INT_STATUS is read
+#define MPU6050_PWR1_CYCLE         0x20  // Sleep between single accelerometer samples
+#define MPU6050_PWR1_TEMP_DIS      0x08
+#define MPU6050_PWR2_STBY_GYRO     0x07  // All three gyro axes in standby
+#define MPU6050_ACCEL_HPF_5HZ      0x01  // Motion detector high-pass, settles on the current pose
+#define MPU6050_ACCEL_HPF_HOLD     0x07  // Freeze the high-pass reference
+#define MPU6050_FIFO_SIZE          1024
+#define MPU6050_FIFO_SAMPLE_BYTES  12    // Accel XYZ + gyro XYZ, big endian
 
-// NVS namespace for IMU calibration
+// NVS entry earlier firmware kept the calibration in
 #define IMU_NVS_NAMESPACE "imu"
 #define IMU_NVS_KEY "calibration"
 
 // Gravitational acceleration constant
 #define GRAVITY_EARTH 9.80665f
+#define DEG_TO_RAD    0.0174532925f
 
 // Accelerometer scale factors for different ranges
 static const float accel_scale_factor[] = {
@@ -59,13 +83,6 @@ static const float gyro_scale_factor[] = {
     16.4f      // ±2000°/s
 };
 
-// IMU calibration data
-typedef struct {
-    int16_t accel_offset[3];
-    int16_t gyro_offset[3];
-    float orientation_offset[3];
-} imu_calibration_t;
-
 // Current configuration
 static imu_config_t current_config = {
     .accel_range = IMU_ACCEL_RANGE_2G,
@@ -82,10 +99,44 @@ static imu_calibration_t calibration = {
     .orientation_offset = {0.0f, 0.0f, 0.0f}
 };
 
-// Previous orientation for filtering
-static float prev_orientation[3] = {0.0f, 0.0f, 0.0f};
+// Orientation estimator
+static ahrs_t imu_ahrs;
 static uint32_t prev_time_us = 0;
 
+// Sources currently enabled in INT_ENABLE
+static uint8_t int_enable_mask = 0;
+
+// FIFO mode state
+static bool fifo_enabled = false;
+static uint8_t fifo_burst_samples = 1;
+static uint32_t fifo_sample_period_us = 10000;
+static int64_t fifo_anchor_us = 0;       // Sensor-clock time of FIFO sample 0
+static uint64_t fifo_sample_index = 0;   // Samples drained since the anchor
+static float fifo_last_temp = 0.0f;
+
+// Calibration or orientation came from RTC memory; skip the NVS read
+static bool state_restored = false;
+
+// Calibration was handed in before init; skip the defaults
+static bool calibration_set = false;
+static bool wake_armed = false;
+
+// Motion interrupt seen in an INT_STATUS read and not yet handed out.
+// Any status read clears the register, so every reader latches it here.
+static bool motion_latched = false;
+
+// Data-ready interrupt state
+static bool isr_installed = false;
+static volatile uint8_t data_ready_count = 0;
+
+// Earliest the next data-ready pulse can come (low 32 bits of esp_timer).
+// The motion detector pulses the same pin, and the ISR cannot read
+// INT_STATUS over I2C, so edges sooner than 3/4 of a sample period after
+// the last counted one are taken for motion and not counted.
+static volatile uint32_t next_data_ready_us = 0;
+static imu_data_ready_callback_t data_ready_callback = NULL;
+static void *data_ready_callback_arg = NULL;
+
 // Motion detection configuration
 static imu_motion_detection_config_t motion_config = {
     .threshold = 20,        // Default threshold (0-255)
@@ -105,6 +156,129 @@ static esp_err_t mpu6050_read_bytes(uint8_t reg_addr, uint8_t *data, size_t len)
     return i2c_master_write_read_device(I2C_MASTER_NUM, MPU6050_ADDR, &reg_addr, 1, data, len, pdMS_TO_TICKS(100));
 }
 
+// Output rate of the sensor's sample clock for a configuration
+static uint32_t sample_period_us(const imu_config_t *config) {
+    // Gyro output runs at 1 kHz with the DLPF enabled, 8 kHz without it
+    uint32_t base_period_us = (config->use_dlpf && config->dlpf_bandwidth != IMU_DLPF_BW_256HZ) ? 1000 : 125;
+    return base_period_us * (1 + config->sample_rate_div);
+}
+
+// Runs on every INT pulse; wakes the consumer once per burst of data-ready pulses
+static void IRAM_ATTR imu_int_isr_handler(void *arg) {
+    uint32_t now_us = (uint32_t)esp_timer_get_time();
+    if ((int32_t)(now_us - next_data_ready_us) < 0) {
+        return;
+    }
+    next_data_ready_us = now_us + fifo_sample_period_us - fifo_sample_period_us / 4;
+
+    if (++data_ready_count < fifo_burst_samples) {
+        return;
+    }
+    data_ready_count = 0;
+
+    if (data_ready_callback != NULL) {
+        data_ready_callback(data_ready_callback_arg);
+    }
+}
+
+static esp_err_t install_int_pin_isr(void) {
+    if (isr_installed) {
+        return ESP_OK;
+    }
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << IMU_INT_PIN),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_ENABLE,
+        .intr_type = GPIO_INTR_POSEDGE
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // The ISR service may already be installed by another driver
+    ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        return ret;
+    }
+
+    ret = gpio_isr_handler_add(IMU_INT_PIN, imu_int_isr_handler, NULL);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    isr_installed = true;
+    return ESP_OK;
+}
+
+static void remove_int_pin_isr(void) {
+    if (isr_installed) {
+        gpio_isr_handler_remove(IMU_INT_PIN);
+        isr_installed = false;
+    }
+}
+
+// Keep a motion interrupt seen in a status read for the next sample handed out
+static inline void latch_motion(uint8_t int_status) {
+    if (int_status & MPU6050_INT_ENABLE_MOT) {
+        motion_latched = true;
+    }
+}
+
+// Convert raw counts into calibrated physical units and advance the AHRS by dt
+static void convert_raw_data(const imu_raw_data_t *raw_data, float dt, imu_data_t *data) {
+    float accel_scale = accel_scale_factor[current_config.accel_range];
+    float gyro_scale = gyro_scale_factor[current_config.gyro_range];
+    
+    for (int i = 0; i < 3; i++) {
+        int16_t accel_calibrated = raw_data->accel_raw[i] - calibration.accel_offset[i];
+        int16_t gyro_calibrated = raw_data->gyro_raw[i] - calibration.gyro_offset[i];
+        
+        // Accel in m/s² (standard gravity units), gyro in °/s
+        data->accel[i] = (float)accel_calibrated / accel_scale * GRAVITY_EARTH;
+        data->gyro[i] = (float)gyro_calibrated / gyro_scale;
+    }
+    
+    float gyro_rad[3] = {
+        data->gyro[0] * DEG_TO_RAD,
+        data->gyro[1] * DEG_TO_RAD,
+        data->gyro[2] * DEG_TO_RAD
+    };
+    ahrs_update(&imu_ahrs, gyro_rad, data->accel, dt);
+    memcpy(data->quaternion, imu_ahrs.q, sizeof(data->quaternion));
+    
+    // Split the measured acceleration into gravity and motion
+    float gravity_dir[3];
+    ahrs_quaternion_gravity(imu_ahrs.q, gravity_dir);
+    for (int i = 0; i < 3; i++) {
+        data->gravity[i] = gravity_dir[i] * GRAVITY_EARTH;
+        data->linear_accel[i] = data->accel[i] - data->gravity[i];
+    }
+}
+
+// Clear the FIFO and restart the sample clock anchor
+static esp_err_t reset_fifo(void) {
+    esp_err_t ret = mpu6050_write_byte(MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_RESET);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    ret = mpu6050_write_byte(MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_EN);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    // The first sample lands one period after the reset
+    fifo_anchor_us = esp_timer_get_time() + fifo_sample_period_us;
+    fifo_sample_index = 0;
+    data_ready_count = 0;
+    next_data_ready_us = (uint32_t)fifo_anchor_us - fifo_sample_period_us / 4;
+    
+    return ESP_OK;
+}
+
 static esp_err_t calculate_calibration_factors(void) {
     // No additional calculation needed for calibration factors
     // Just log the current offsets
@@ -120,6 +294,10 @@ esp_err_t imu_init(void) {
     
     // Initialize I2C if not already initialized (done in app_main for shared I2C bus)
     
+    if (!state_restored) {
+        ahrs_init(&imu_ahrs, IMU_AHRS_BETA);
+    }
+    
     // Verify device identity
     ret = mpu6050_read_bytes(MPU6050_REG_WHO_AM_I, &who_am_i, 1);
     if (ret != ESP_OK) {
@@ -146,10 +324,9 @@ esp_err_t imu_init(void) {
         return ret;
     }
     
-    // Load calibration data
-    ret = imu_load_calibration();
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to load calibration data, using defaults");
+    // Calibration comes from the calibration engine or deep sleep
+    if (!state_restored && !calibration_set) {
+        ESP_LOGW(TAG, "No calibration data, using defaults");
         // Calculate default calibration factors
         calculate_calibration_factors();
     }
@@ -195,6 +372,15 @@ esp_err_t imu_config(const imu_config_t* config) {
     
     // Save current configuration
     memcpy(&current_config, config, sizeof(imu_config_t));
+    fifo_sample_period_us = sample_period_us(config);
+    
+    // A new sample rate invalidates the FIFO timestamps
+    if (fifo_enabled) {
+        ret = reset_fifo();
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
     
     ESP_LOGI(TAG, "IMU configured: accel_range=%d, gyro_range=%d, dlpf=%d, sample_rate_div=%d",
              config->accel_range, config->gyro_range, config->dlpf_bandwidth, config->sample_rate_div);
@@ -251,29 +437,6 @@ esp_err_t imu_read(imu_data_t* data) {
         return ret;
     }
     
-    // Apply calibration offsets
-    int16_t accel_calibrated[3];
-    int16_t gyro_calibrated[3];
-    
-    for (int i = 0; i < 3; i++) {
-        accel_calibrated[i] = raw_data.accel_raw[i] - calibration.accel_offset[i];
-        gyro_calibrated[i] = raw_data.gyro_raw[i] - calibration.gyro_offset[i];
-    }
-    
-    // Convert to physical units
-    float accel_scale = accel_scale_factor[current_config.accel_range];
-    float gyro_scale = gyro_scale_factor[current_config.gyro_range];
-    
-    for (int i = 0; i < 3; i++) {
-        data->accel[i] = (float)accel_calibrated[i] / accel_scale;
-        data->gyro[i] = (float)gyro_calibrated[i] / gyro_scale;
-    }
-    
-    // Convert to m/s² (standard gravity units)
-    for (int i = 0; i < 3; i++) {
-        data->accel[i] *= GRAVITY_EARTH;
-    }
-    
     // Convert temperature
     data->temp = (float)raw_data.temp_raw / 340.0f + 36.53f;
     
@@ -283,11 +446,17 @@ esp_err_t imu_read(imu_data_t* data) {
     prev_time_us = current_time_us;
     data->timestamp = current_time_us / 1000;  // Convert to milliseconds
     
-    // Calculate orientation using complementary filter
-    imu_calculate_orientation(data->accel, data->gyro, dt, prev_orientation, data->orientation);
+    convert_raw_data(&raw_data, dt, data);
     
-    // Update previous orientation
-    memcpy(prev_orientation, data->orientation, sizeof(prev_orientation));
+    // Polling only touches the status register when the motion detector is armed
+    if (int_enable_mask & MPU6050_INT_ENABLE_MOT) {
+        uint8_t int_status;
+        if (mpu6050_read_bytes(MPU6050_REG_INT_STATUS, &int_status, 1) == ESP_OK) {
+            latch_motion(int_status);
+        }
+    }
+    data->motion = motion_latched;
+    motion_latched = false;
     
     return ESP_OK;
 }
@@ -336,15 +505,8 @@ esp_err_t imu_calibrate(void) {
     // Reset orientation offset
     for (int i = 0; i < 3; i++) {
         calibration.orientation_offset[i] = 0.0f;
-        prev_orientation[i] = 0.0f;
-    }
-    
-    // Save calibration data
-    esp_err_t ret = imu_save_calibration();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to save calibration data");
-        return ret;
     }
+    ahrs_reset(&imu_ahrs);
     
     // Log calibration results
     ESP_LOGI(TAG, "IMU calibration complete");
@@ -361,17 +523,55 @@ esp_err_t imu_reset_calibration(void) {
         calibration.accel_offset[i] = 0;
         calibration.gyro_offset[i] = 0;
         calibration.orientation_offset[i] = 0.0f;
-        prev_orientation[i] = 0.0f;
     }
+    ahrs_reset(&imu_ahrs);
     
-    // Save default calibration
-    esp_err_t ret = imu_save_calibration();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to save default calibration data");
-        return ret;
+    ESP_LOGI(TAG, "IMU calibration reset to defaults");
+    return ESP_OK;
+}
+
+esp_err_t imu_get_calibration(imu_calibration_t *result) {
+    if (result == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    memcpy(result, &calibration, sizeof(imu_calibration_t));
+    return ESP_OK;
+}
+
+esp_err_t imu_set_calibration(const imu_calibration_t *new_calibration) {
+    if (new_calibration == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    memcpy(&calibration, new_calibration, sizeof(imu_calibration_t));
+    calibration_set = true;
+    
+    // Re-seed orientation from the next sample
+    ahrs_reset(&imu_ahrs);
+    return ESP_OK;
+}
+
+esp_err_t imu_calibration_from_rest(const float accel[3], const float gyro[3], imu_calibration_t *result) {
+    if (accel == NULL || gyro == NULL || result == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    float accel_scale = accel_scale_factor[current_config.accel_range];
+    float gyro_scale = gyro_scale_factor[current_config.gyro_range];
+    
+    // The readings already have the current offsets taken off; whatever is
+    // left, apart from 1 g on Z, goes into the offsets as in imu_calibrate()
+    for (int i = 0; i < 3; i++) {
+        float accel_counts = accel[i] / GRAVITY_EARTH * accel_scale;
+        if (i == 2) {
+            accel_counts -= accel_scale;
+        }
+        result->accel_offset[i] = calibration.accel_offset[i] + (int16_t)lroundf(accel_counts);
+        result->gyro_offset[i] = calibration.gyro_offset[i] + (int16_t)lroundf(gyro[i] * gyro_scale);
+        result->orientation_offset[i] = 0.0f;
     }
     
-    ESP_LOGI(TAG, "IMU calibration reset to defaults");
     return ESP_OK;
 }
 
@@ -416,16 +616,7 @@ esp_err_t imu_config_motion_detection(const imu_motion_detection_config_t* confi
 }
 
 esp_err_t imu_enable_motion_detection(bool enable) {
-    // Configure interrupt
-    uint8_t int_enable = enable ? MPU6050_INT_ENABLE_MOT : 0;
-    
-    esp_err_t ret = mpu6050_write_byte(MPU6050_REG_INT_ENABLE, int_enable);
-    if (ret != ESP_OK) {
-        return ret;
-    }
-    
-    ESP_LOGI(TAG, "Motion detection %s", enable ? "enabled" : "disabled");
-    return ESP_OK;
+    return imu_config_interrupts(enable, IMU_INTERRUPT_MOTION);
 }
 
 esp_err_t imu_is_motion_detected(bool* detected) {
@@ -440,39 +631,348 @@ esp_err_t imu_is_motion_detected(bool* detected) {
         return ret;
     }
     
-    // Check motion interrupt flag
-    *detected = (int_status & MPU6050_INT_ENABLE_MOT) != 0;
+    // Include motion already latched by a sample read
+    latch_motion(int_status);
+    *detected = motion_latched;
+    motion_latched = false;
     
     return ESP_OK;
 }
 
 esp_err_t imu_config_interrupts(bool enable, uint8_t interrupt_type) {
-    uint8_t int_enable = 0;
+    uint8_t source_bit;
     
-    if (enable) {
-        if (interrupt_type == 0) {
-            // Motion detection interrupt
-            int_enable = MPU6050_INT_ENABLE_MOT;
-        } else if (interrupt_type == 1) {
-            // Data ready interrupt
-            int_enable = MPU6050_INT_ENABLE_DATA_RDY;
+    if (interrupt_type == IMU_INTERRUPT_MOTION) {
+        source_bit = MPU6050_INT_ENABLE_MOT;
+    } else if (interrupt_type == IMU_INTERRUPT_DATA_READY) {
+        source_bit = MPU6050_INT_ENABLE_DATA_RDY;
+    } else {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // Sources are independent, so keep the others as they were
+    uint8_t int_enable = enable ? (int_enable_mask | source_bit) : (int_enable_mask & ~source_bit);
+    
+    esp_err_t ret;
+    if (interrupt_type == IMU_INTERRUPT_DATA_READY) {
+        if (enable) {
+            // Active-high 50us pulse, cleared by any read
+            ret = mpu6050_write_byte(MPU6050_REG_INT_PIN_CFG, MPU6050_INT_PIN_RD_CLEAR);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            
+            ret = install_int_pin_isr();
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to install INT pin handler: %s", esp_err_to_name(ret));
+                return ret;
+            }
         } else {
-            return ESP_ERR_INVALID_ARG;
+            remove_int_pin_isr();
         }
     }
     
-    esp_err_t ret = mpu6050_write_byte(MPU6050_REG_INT_ENABLE, int_enable);
+    ret = mpu6050_write_byte(MPU6050_REG_INT_ENABLE, int_enable);
     if (ret != ESP_OK) {
         return ret;
     }
+    int_enable_mask = int_enable;
     
     ESP_LOGI(TAG, "%s interrupt %s", 
-             interrupt_type == 0 ? "Motion detection" : "Data ready",
+             interrupt_type == IMU_INTERRUPT_MOTION ? "Motion detection" : "Data ready",
              enable ? "enabled" : "disabled");
     
     return ESP_OK;
 }
 
+esp_err_t imu_get_retained_state(imu_retained_state_t *state) {
+    if (state == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    memcpy(state->accel_offset, calibration.accel_offset, sizeof(state->accel_offset));
+    memcpy(state->gyro_offset, calibration.gyro_offset, sizeof(state->gyro_offset));
+    memcpy(state->orientation_offset, calibration.orientation_offset, sizeof(state->orientation_offset));
+    memcpy(state->quaternion, imu_ahrs.q, sizeof(state->quaternion));
+    state->orientation_valid = imu_ahrs.initialized;
+    
+    return ESP_OK;
+}
+
+esp_err_t imu_restore_retained_state(const imu_retained_state_t *state) {
+    if (state == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    memcpy(calibration.accel_offset, state->accel_offset, sizeof(calibration.accel_offset));
+    memcpy(calibration.gyro_offset, state->gyro_offset, sizeof(calibration.gyro_offset));
+    memcpy(calibration.orientation_offset, state->orientation_offset, sizeof(calibration.orientation_offset));
+    
+    // The pose has barely changed since motion woke us; the filter corrects the rest
+    ahrs_init(&imu_ahrs, IMU_AHRS_BETA);
+    if (state->orientation_valid) {
+        memcpy(imu_ahrs.q, state->quaternion, sizeof(imu_ahrs.q));
+        imu_ahrs.initialized = true;
+    }
+    
+    state_restored = true;
+    return ESP_OK;
+}
+
+esp_err_t imu_arm_wake_on_motion(bool arm) {
+    esp_err_t ret;
+    
+    if (arm == wake_armed) {
+        return ESP_OK;
+    }
+    
+    if (arm) {
+        // The pin stays high once motion latches it, keep the data-ready ISR out
+        if (isr_installed) {
+            gpio_intr_disable(IMU_INT_PIN);
+        }
+        
+        // Accelerometer only, with the high-pass settling on the resting pose
+        ret = mpu6050_write_byte(MPU6050_REG_PWR_MGMT_1, MPU6050_CLOCK_PLL_XGYRO);
+        if (ret == ESP_OK) ret = mpu6050_write_byte(MPU6050_REG_PWR_MGMT_2, MPU6050_PWR2_STBY_GYRO);
+        if (ret == ESP_OK) ret = mpu6050_write_byte(MPU6050_REG_ACCEL_CONFIG,
+                                                    (current_config.accel_range << 3) | MPU6050_ACCEL_HPF_5HZ);
+        if (ret == ESP_OK) ret = mpu6050_write_byte(MPU6050_REG_MOT_THR, IMU_WAKE_MOTION_THRESHOLD);
+        if (ret == ESP_OK) ret = mpu6050_write_byte(MPU6050_REG_MOT_DUR, IMU_WAKE_MOTION_DURATION);
+        if (ret == ESP_OK) ret = mpu6050_write_byte(MPU6050_REG_INT_PIN_CFG, MPU6050_INT_PIN_LATCH);
+        if (ret == ESP_OK) ret = mpu6050_write_byte(MPU6050_REG_INT_ENABLE, MPU6050_INT_ENABLE_MOT);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to arm wake-on-motion: %s", esp_err_to_name(ret));
+            wake_armed = true;
+            imu_arm_wake_on_motion(false);
+            return ret;
+        }
+        
+        // One sample at the 5 Hz high-pass, then hold it as the reference
+        vTaskDelay(pdMS_TO_TICKS(10));
+        ret = mpu6050_write_byte(MPU6050_REG_ACCEL_CONFIG,
+                                 (current_config.accel_range << 3) | MPU6050_ACCEL_HPF_HOLD);
+        if (ret == ESP_OK) ret = mpu6050_write_byte(MPU6050_REG_PWR_MGMT_2,
+                                                    (IMU_WAKE_SAMPLE_RATE << 6) | MPU6050_PWR2_STBY_GYRO);
+        if (ret == ESP_OK) ret = mpu6050_write_byte(MPU6050_REG_PWR_MGMT_1,
+                                                    MPU6050_PWR1_CYCLE | MPU6050_PWR1_TEMP_DIS);
+        
+        // Start from a low pin, whatever the sampling path left latched
+        uint8_t int_status;
+        mpu6050_read_bytes(MPU6050_REG_INT_STATUS, &int_status, 1);
+        
+        wake_armed = true;
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to enter cycle mode: %s", esp_err_to_name(ret));
+            imu_arm_wake_on_motion(false);
+            return ret;
+        }
+        
+        ESP_LOGI(TAG, "Wake-on-motion armed (threshold %d)", IMU_WAKE_MOTION_THRESHOLD);
+        return ESP_OK;
+    }
+    
+    // Back to continuous sampling with the configuration in use before
+    ret = mpu6050_write_byte(MPU6050_REG_PWR_MGMT_1, MPU6050_CLOCK_PLL_XGYRO);
+    if (ret == ESP_OK) ret = mpu6050_write_byte(MPU6050_REG_PWR_MGMT_2, 0);
+    if (ret == ESP_OK) ret = imu_config(&current_config);
+    if (ret == ESP_OK) ret = imu_config_motion_detection(&motion_config);
+    if (ret == ESP_OK) ret = mpu6050_write_byte(MPU6050_REG_INT_PIN_CFG, MPU6050_INT_PIN_RD_CLEAR);
+    if (ret == ESP_OK) ret = mpu6050_write_byte(MPU6050_REG_INT_ENABLE, int_enable_mask);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to disarm wake-on-motion: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    // Motion that woke us is handed out with the next sample; the read unlatches the pin
+    uint8_t int_status = 0;
+    if (mpu6050_read_bytes(MPU6050_REG_INT_STATUS, &int_status, 1) == ESP_OK) {
+        latch_motion(int_status);
+    }
+    
+    if (fifo_enabled) {
+        reset_fifo();
+    }
+    prev_time_us = esp_timer_get_time();
+    
+    if (isr_installed) {
+        gpio_intr_enable(IMU_INT_PIN);
+    }
+    
+    wake_armed = false;
+    ESP_LOGI(TAG, "Wake-on-motion disarmed");
+    return ESP_OK;
+}
+
+esp_err_t imu_set_data_ready_callback(imu_data_ready_callback_t callback, void *arg) {
+    // Swap with the pin interrupt masked so the ISR never sees a torn pair
+    if (isr_installed) {
+        gpio_intr_disable(IMU_INT_PIN);
+    }
+    
+    data_ready_callback = callback;
+    data_ready_callback_arg = arg;
+    
+    if (isr_installed) {
+        gpio_intr_enable(IMU_INT_PIN);
+    }
+    
+    return ESP_OK;
+}
+
+esp_err_t imu_enable_fifo(bool enable, uint8_t burst_samples) {
+    esp_err_t ret;
+    
+    if (!enable) {
+        ret = imu_config_interrupts(false, IMU_INTERRUPT_DATA_READY);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        
+        ret = mpu6050_write_byte(MPU6050_REG_FIFO_EN, 0);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        
+        ret = mpu6050_write_byte(MPU6050_REG_USER_CTRL, MPU6050_USER_CTRL_FIFO_RESET);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        
+        fifo_enabled = false;
+        prev_time_us = esp_timer_get_time();
+        ESP_LOGI(TAG, "FIFO mode disabled");
+        return ESP_OK;
+    }
+    
+    if (burst_samples == 0 || burst_samples > IMU_FIFO_MAX_BURST) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    fifo_burst_samples = burst_samples;
+    fifo_sample_period_us = sample_period_us(&current_config);
+    
+    // Accel and gyro only; temperature is read separately
+    ret = mpu6050_write_byte(MPU6050_REG_FIFO_EN, MPU6050_FIFO_EN_GYRO_ACCEL);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    ret = reset_fifo();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    ret = imu_config_interrupts(true, IMU_INTERRUPT_DATA_READY);
+    if (ret != ESP_OK) {
+        mpu6050_write_byte(MPU6050_REG_FIFO_EN, 0);
+        mpu6050_write_byte(MPU6050_REG_USER_CTRL, 0);
+        return ret;
+    }
+    
+    fifo_enabled = true;
+    
+    ESP_LOGI(TAG, "FIFO mode enabled: %lu us sample period, burst of %d",
+             (unsigned long)fifo_sample_period_us, burst_samples);
+    
+    return ESP_OK;
+}
+
+bool imu_is_fifo_enabled(void) {
+    return fifo_enabled;
+}
+
+esp_err_t imu_read_fifo(imu_data_t *samples, size_t max_samples, size_t *count) {
+    if (samples == NULL || count == NULL || max_samples == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    *count = 0;
+    
+    if (!fifo_enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    // Status and count in two short reads; reading INT_STATUS also clears the pin
+    uint8_t int_status;
+    esp_err_t ret = mpu6050_read_bytes(MPU6050_REG_INT_STATUS, &int_status, 1);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    latch_motion(int_status);
+    
+    uint8_t count_buf[2];
+    ret = mpu6050_read_bytes(MPU6050_REG_FIFO_COUNTH, count_buf, 2);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    uint16_t fifo_bytes = (uint16_t)((count_buf[0] << 8) | count_buf[1]);
+    
+    // On overflow the FIFO holds a partial sample and the clock anchor is lost
+    if ((int_status & MPU6050_INT_STATUS_FIFO_OFLOW) || fifo_bytes >= MPU6050_FIFO_SIZE) {
+        ESP_LOGW(TAG, "FIFO overflow, resetting");
+        return reset_fifo();
+    }
+    
+    size_t available = fifo_bytes / MPU6050_FIFO_SAMPLE_BYTES;
+    if (available == 0) {
+        return ESP_OK;
+    }
+    
+    size_t n = available;
+    if (n > max_samples) n = max_samples;
+    if (n > IMU_FIFO_MAX_BURST) n = IMU_FIFO_MAX_BURST;
+    
+    // One burst transaction for all samples
+    uint8_t buffer[IMU_FIFO_MAX_BURST * MPU6050_FIFO_SAMPLE_BYTES];
+    ret = mpu6050_read_bytes(MPU6050_REG_FIFO_R_W, buffer, n * MPU6050_FIFO_SAMPLE_BYTES);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    // Temperature is not in the FIFO; refresh it occasionally
+    if ((fifo_sample_index & 0x3F) == 0) {
+        uint8_t temp_buf[2];
+        if (mpu6050_read_bytes(MPU6050_REG_TEMP_OUT_H, temp_buf, 2) == ESP_OK) {
+            fifo_last_temp = (float)(int16_t)((temp_buf[0] << 8) | temp_buf[1]) / 340.0f + 36.53f;
+        }
+    }
+    
+    // Samples are exactly one sensor clock period apart
+    float dt = fifo_sample_period_us / 1000000.0f;
+    
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *p = &buffer[i * MPU6050_FIFO_SAMPLE_BYTES];
+        imu_raw_data_t raw_data;
+        
+        for (int axis = 0; axis < 3; axis++) {
+            raw_data.accel_raw[axis] = (int16_t)((p[axis * 2] << 8) | p[axis * 2 + 1]);
+            raw_data.gyro_raw[axis] = (int16_t)((p[6 + axis * 2] << 8) | p[6 + axis * 2 + 1]);
+        }
+        raw_data.temp_raw = 0;
+        
+        int64_t sample_time_us = fifo_anchor_us + (int64_t)fifo_sample_index * fifo_sample_period_us;
+        fifo_sample_index++;
+        
+        convert_raw_data(&raw_data, dt, &samples[i]);
+        samples[i].temp = fifo_last_temp;
+        samples[i].motion = motion_latched;
+        samples[i].timestamp = sample_time_us / 1000;
+    }
+    motion_latched = false;
+    
+    // Slowly pull the anchor towards the host clock to absorb sensor clock drift.
+    // The oldest unread sample was produced at most one period ago, so the newest
+    // drained sample should sit (available - n) periods plus half a period back.
+    int64_t newest_us = fifo_anchor_us + (int64_t)(fifo_sample_index - 1) * fifo_sample_period_us;
+    int64_t expected_us = esp_timer_get_time() -
+                          (int64_t)(available - n) * fifo_sample_period_us - fifo_sample_period_us / 2;
+    fifo_anchor_us += (expected_us - newest_us) / 64;
+    
+    *count = n;
+    return ESP_OK;
+}
+
 esp_err_t imu_set_low_power_mode(bool enable) {
     // Read current power management register
     uint8_t pwr_mgmt;
@@ -519,6 +1019,15 @@ esp_err_t imu_reset(void) {
     return ESP_OK;
 }
 
+esp_err_t imu_get_euler(const imu_data_t* data, float euler[3]) {
+    if (data == NULL || euler == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    ahrs_quaternion_to_euler(data->quaternion, euler);
+    return ESP_OK;
+}
+
 esp_err_t imu_calculate_orientation(const float accel[3], const float gyro[3], 
                                    float dt, const float previous_orientation[3], 
                                    float new_orientation[3]) {
@@ -542,38 +1051,8 @@ esp_err_t imu_calculate_orientation(const float accel[3], const float gyro[3],
     return ESP_OK;
 }
 
-esp_err_t imu_save_calibration(void) {
-    ESP_LOGI(TAG, "Saving IMU calibration...");
-    
-    nvs_handle_t nvs_handle;
-    esp_err_t ret;
-    
-    ret = nvs_open(IMU_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(ret));
-        return ret;
-    }
-    
-    // Write calibration data to NVS
-    ret = nvs_set_blob(nvs_handle, IMU_NVS_KEY, &calibration, sizeof(imu_calibration_t));
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error writing to NVS: %s", esp_err_to_name(ret));
-        nvs_close(nvs_handle);
-        return ret;
-    }
-    
-    // Commit the changes
-    ret = nvs_commit(nvs_handle);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error committing NVS changes: %s", esp_err_to_name(ret));
-    }
-    
-    nvs_close(nvs_handle);
-    return ret;
-}
-
 esp_err_t imu_load_calibration(void) {
-    ESP_LOGI(TAG, "Loading IMU calibration...");
+    ESP_LOGI(TAG, "Loading IMU calibration from its own NVS entry...");
     
     nvs_handle_t nvs_handle;
     esp_err_t ret;
@@ -594,9 +1073,10 @@ esp_err_t imu_load_calibration(void) {
     }
     
     nvs_close(nvs_handle);
+    calibration_set = true;
     
-    // Reset previous orientation
-    memcpy(prev_orientation, calibration.orientation_offset, sizeof(prev_orientation));
+    // Re-seed orientation from the next sample
+    ahrs_reset(&imu_ahrs);
     
     ESP_LOGI(TAG, "IMU calibration loaded successfully");
     return ESP_OK;
@@ -4,6 +4,7 @@
 #include "esp_err.h"
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * @brief IMU accelerometer range settings
@@ -68,13 +69,43 @@ typedef struct {
  * @brief IMU calibrated data
  */
 typedef struct {
-    float accel[3];      // Calibrated accelerometer data in g (x, y, z)
+    float accel[3];      // Calibrated accelerometer data in m/s² (x, y, z)
     float gyro[3];       // Calibrated gyroscope data in °/s (x, y, z)
     float temp;          // Calibrated temperature in °C
-    float orientation[3]; // Roll, pitch, yaw in degrees
+    float quaternion[4]; // Orientation quaternion (w, x, y, z), sensor to earth
+    float gravity[3];    // Gravity in the sensor frame in m/s² (x, y, z)
+    float linear_accel[3]; // Acceleration with gravity removed in m/s² (x, y, z)
+    bool motion;         // Hardware motion detector fired since the previous read
     uint32_t timestamp;  // Timestamp in milliseconds
 } imu_data_t;
 
+/**
+ * @brief Interrupt sources for imu_config_interrupts()
+ */
+#define IMU_INTERRUPT_MOTION      (0)
+#define IMU_INTERRUPT_DATA_READY  (1)
+
+/**
+ * @brief Maximum number of samples drained by one FIFO burst read
+ */
+#define IMU_FIFO_MAX_BURST        (16)
+
+/**
+ * @brief Callback run from the INT pin ISR once per FIFO burst
+ *
+ * Must be IRAM-safe and only use FromISR APIs.
+ */
+typedef void (*imu_data_ready_callback_t)(void *arg);
+
+/**
+ * @brief IMU calibration
+ */
+typedef struct {
+    int16_t accel_offset[3];     // Raw counts taken off each axis, Z keeps 1 g
+    int16_t gyro_offset[3];      // Raw counts taken off each axis
+    float orientation_offset[3];
+} imu_calibration_t;
+
 /**
  * @brief IMU motion detection configuration
  */
@@ -86,9 +117,23 @@ typedef struct {
     bool z_axis_enable;      // Enable motion detection on Z axis
 } imu_motion_detection_config_t;
 
+/**
+ * @brief IMU state kept in RTC memory across deep sleep
+ */
+typedef struct {
+    int16_t accel_offset[3];     // Calibration offsets, raw counts
+    int16_t gyro_offset[3];
+    float orientation_offset[3];
+    float quaternion[4];         // AHRS orientation when the glove went to sleep
+    bool orientation_valid;      // quaternion was seeded from gravity
+} imu_retained_state_t;
+
 /**
  * @brief Initialize IMU
  * 
+ * Calibration is loaded from NVS unless imu_restore_retained_state()
+ * ran first.
+ * 
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t imu_init(void);
@@ -128,7 +173,8 @@ esp_err_t imu_read(imu_data_t* data);
 /**
  * @brief Perform IMU calibration
  * 
- * The device should be kept stationary during calibration.
+ * The device should be kept stationary during calibration. Not persisted;
+ * the guided session in core/calibration.h stores its result.
  * 
  * @return ESP_OK on success, error code otherwise
  */
@@ -137,10 +183,56 @@ esp_err_t imu_calibrate(void);
 /**
  * @brief Reset IMU calibration to default values
  * 
+ * Not persisted until calibration_save().
+ * 
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t imu_reset_calibration(void);
 
+/**
+ * @brief Load calibration saved by earlier firmware in the driver's own NVS entry
+ * 
+ * Only read by the calibration engine when its blob does not exist yet;
+ * calibration is otherwise kept in the blob (core/calibration.h).
+ * 
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t imu_load_calibration(void);
+
+/**
+ * @brief Get the current calibration
+ * 
+ * @param calibration Pointer to store the calibration
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t imu_get_calibration(imu_calibration_t *calibration);
+
+/**
+ * @brief Set the calibration
+ * 
+ * Can be called before imu_init(), which then keeps it instead of the
+ * defaults, or at any time after; the orientation re-seeds from the next
+ * sample.
+ * 
+ * @param calibration Calibration to use
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t imu_set_calibration(const imu_calibration_t *calibration);
+
+/**
+ * @brief Work out the calibration that zeroes readings taken at rest
+ * 
+ * For the glove lying still, Z up: the mean accelerometer reading should
+ * be 1 g on Z and the mean gyro reading zero. Readings are imu_data_t
+ * values taken with the current calibration and sensor ranges.
+ * 
+ * @param accel Mean acceleration at rest in m/s² (x, y, z)
+ * @param gyro Mean angular rate at rest in °/s (x, y, z)
+ * @param calibration Pointer to store the calibration, not applied
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t imu_calibration_from_rest(const float accel[3], const float gyro[3], imu_calibration_t *calibration);
+
 /**
  * @brief Configure motion detection
  * 
@@ -168,12 +260,91 @@ esp_err_t imu_is_motion_detected(bool* detected);
 /**
  * @brief Configure and use IMU interrupts (motion detection or data ready)
  * 
+ * Sources are enabled independently. Enabling data ready also installs the
+ * INT pin handler that drives the data-ready callback.
+ * 
  * @param enable True to enable, false to disable
- * @param interrupt_type 0 for motion detection, 1 for data ready
+ * @param interrupt_type IMU_INTERRUPT_MOTION or IMU_INTERRUPT_DATA_READY
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t imu_config_interrupts(bool enable, uint8_t interrupt_type);
 
+/**
+ * @brief Set the callback run when a FIFO burst is ready
+ * 
+ * @param callback Callback to run from the INT pin ISR, or NULL to clear
+ * @param arg Argument passed to the callback
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t imu_set_data_ready_callback(imu_data_ready_callback_t callback, void *arg);
+
+/**
+ * @brief Enable or disable FIFO mode
+ * 
+ * Accelerometer and gyroscope samples are queued in the MPU6050 FIFO at the
+ * configured sample rate, and the data-ready callback runs once every
+ * burst_samples samples.
+ * 
+ * @param enable True to enable, false to disable
+ * @param burst_samples Samples per burst (1..IMU_FIFO_MAX_BURST)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t imu_enable_fifo(bool enable, uint8_t burst_samples);
+
+/**
+ * @brief Check if FIFO mode is enabled
+ * 
+ * @return true if FIFO mode is enabled
+ */
+bool imu_is_fifo_enabled(void);
+
+/**
+ * @brief Drain queued samples from the FIFO in one burst read
+ * 
+ * Samples are returned oldest first. Timestamps and the orientation
+ * integration step come from the sensor's sample clock, not from when the
+ * read happened.
+ * 
+ * @param samples Array to store calibrated samples
+ * @param max_samples Capacity of the array
+ * @param count Pointer to store the number of samples read
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t imu_read_fifo(imu_data_t *samples, size_t max_samples, size_t *count);
+
+/**
+ * @brief Get the state worth keeping across deep sleep
+ * 
+ * @param state Pointer to store the state
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t imu_get_retained_state(imu_retained_state_t *state);
+
+/**
+ * @brief Restore state kept across deep sleep, before imu_init()
+ * 
+ * imu_init() then keeps the calibration instead of the defaults, and the orientation
+ * carries on from where it was instead of re-seeding.
+ * 
+ * @param state State from imu_get_retained_state()
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t imu_restore_retained_state(const imu_retained_state_t *state);
+
+/**
+ * @brief Arm or disarm wake-on-motion on the INT pin
+ * 
+ * Armed, the MPU6050 samples only the accelerometer in cycle mode at
+ * IMU_WAKE_SAMPLE_RATE and latches INT high on motion over
+ * IMU_WAKE_MOTION_THRESHOLD, for an ext0 wakeup from light or deep
+ * sleep. The data-ready handler is masked meanwhile. Disarming restores
+ * the sampling configuration, interrupts and FIFO.
+ * 
+ * @param arm True to arm before sleeping, false after waking
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t imu_arm_wake_on_motion(bool arm);
+
 /**
  * @brief Enter low power mode
  * 
@@ -189,9 +360,24 @@ esp_err_t imu_set_low_power_mode(bool enable);
  */
 esp_err_t imu_reset(void);
 
+/**
+ * @brief Get Euler angles for a sample
+ * 
+ * Converted from the sample's quaternion on request; the driver itself
+ * never works in Euler angles.
+ * 
+ * @param data IMU sample
+ * @param euler Roll, pitch, yaw in degrees
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t imu_get_euler(const imu_data_t* data, float euler[3]);
+
 /**
  * @brief Apply complementary filter to calculate orientation
  * 
+ * Standalone helper kept for callers that work in Euler angles. The driver
+ * tracks orientation with the quaternion AHRS instead.
+ * 
  * @param accel Accelerometer data in g
  * @param gyro Gyroscope data in °/s
  * @param dt Time difference in seconds
@@ -25,8 +25,19 @@ static uint16_t touch_thresholds[TOUCH_SENSOR_COUNT] = {0};
 static uint16_t touch_baseline[TOUCH_SENSOR_COUNT] = {0};
 static bool touch_status[TOUCH_SENSOR_COUNT] = {false};
 
+// Baselines and thresholds were handed in before init; skip measuring
+static bool calibration_set = false;
+
 // Callback function pointer for touch events
 static touch_callback_t touch_callback = NULL;
+static void *touch_callback_arg = NULL;
+
+// Sensors touched since the last touch_take_events(), set from the ISR
+static volatile uint8_t latched_touch_mask = 0;
+static portMUX_TYPE latched_touch_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_err_t apply_thresholds(void);
+static esp_err_t measure_baseline(void);
 
 esp_err_t touch_init(void) {
     esp_err_t ret;
@@ -59,8 +70,8 @@ esp_err_t touch_init(void) {
         }
     }
     
-    // Initialize and start calibration
-    ret = touch_calibrate();
+    // Thresholds from the calibration engine, or measured now
+    ret = calibration_set ? apply_thresholds() : measure_baseline();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to calibrate touch sensors: %d", ret);
         return ret;
@@ -99,11 +110,19 @@ esp_err_t touch_deinit(void) {
     return ESP_OK;
 }
 
-esp_err_t touch_calibrate(void) {
-    if (!touch_initialized) {
-        return ESP_ERR_INVALID_STATE;
+// Program the interrupt thresholds of every pad
+static esp_err_t apply_thresholds(void) {
+    for (int i = 0; i < TOUCH_SENSOR_COUNT; i++) {
+        esp_err_t ret = touch_pad_set_thresh(touch_pins[i], touch_thresholds[i]);
+        if (ret != ESP_OK) {
+            return ret;
+        }
     }
-    
+    return ESP_OK;
+}
+
+// Blocking baseline measurement, 100 ms per pad
+static esp_err_t measure_baseline(void) {
     ESP_LOGI(TAG, "Calibrating touch sensors...");
     
     // Measure baseline values for each sensor
@@ -123,8 +142,8 @@ esp_err_t touch_calibrate(void) {
         // Calculate average
         touch_baseline[i] = sum / samples;
         
-        // Set threshold at 80% of baseline value (lower value = touch detected)
-        touch_thresholds[i] = touch_baseline[i] * 0.8;
+        // Set threshold below the baseline value (lower value = touch detected)
+        touch_thresholds[i] = (uint32_t)touch_baseline[i] * TOUCH_THRESHOLD_PERCENT / 100;
         
         // Set the threshold for interrupt
         touch_pad_set_thresh(touch_pins[i], touch_thresholds[i]);
@@ -137,6 +156,37 @@ esp_err_t touch_calibrate(void) {
     return ESP_OK;
 }
 
+esp_err_t touch_calibrate(void) {
+    if (!touch_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    return measure_baseline();
+}
+
+esp_err_t touch_get_calibration(touch_calibration_t *calibration) {
+    if (calibration == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    memcpy(calibration->baseline, touch_baseline, sizeof(calibration->baseline));
+    memcpy(calibration->threshold, touch_thresholds, sizeof(calibration->threshold));
+    return ESP_OK;
+}
+
+esp_err_t touch_set_calibration(const touch_calibration_t *calibration) {
+    if (calibration == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    memcpy(touch_baseline, calibration->baseline, sizeof(touch_baseline));
+    memcpy(touch_thresholds, calibration->threshold, sizeof(touch_thresholds));
+    calibration_set = true;
+    
+    // Before init the thresholds are programmed by touch_init()
+    return touch_initialized ? apply_thresholds() : ESP_OK;
+}
+
 esp_err_t touch_set_threshold(uint8_t sensor_id, uint16_t threshold) {
     if (!touch_initialized || sensor_id >= TOUCH_SENSOR_COUNT) {
         return ESP_ERR_INVALID_ARG;
@@ -155,12 +205,32 @@ esp_err_t touch_set_threshold(uint8_t sensor_id, uint16_t threshold) {
     return ESP_OK;
 }
 
-esp_err_t touch_set_callback(touch_callback_t callback) {
+esp_err_t touch_set_callback(touch_callback_t callback, void *arg) {
     if (!touch_initialized) {
         return ESP_ERR_INVALID_STATE;
     }
     
+    // Swap with the interrupt masked so the ISR never sees a torn pair
+    touch_pad_intr_disable();
     touch_callback = callback;
+    touch_callback_arg = arg;
+    if (touch_enabled) {
+        touch_pad_intr_enable();
+    }
+    
+    return ESP_OK;
+}
+
+esp_err_t touch_take_events(uint8_t *touched_mask) {
+    if (!touch_initialized || touched_mask == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    taskENTER_CRITICAL(&latched_touch_lock);
+    *touched_mask = latched_touch_mask;
+    latched_touch_mask = 0;
+    taskEXIT_CRITICAL(&latched_touch_lock);
+    
     return ESP_OK;
 }
 
@@ -223,14 +293,9 @@ esp_err_t touch_update_status(void) {
         }
     }
     
-    // Update status and notify callback if changed
+    // Update status if changed
     if (status_changed) {
         memcpy(touch_status, new_status, sizeof(touch_status));
-        
-        // Call callback if registered
-        if (touch_callback != NULL) {
-            touch_callback(touch_status);
-        }
     }
     
     return ESP_OK;
@@ -258,9 +323,29 @@ bool touch_is_sensor_active(uint8_t sensor_id) {
 }
 
 void touch_intr_handler(void *arg) {
-    // Update touch status
-    touch_update_status();
+    // Pads that crossed their threshold, one bit per pad number
+    uint32_t pad_mask = touch_pad_get_status();
     
     // Clear touch interrupt
     touch_pad_clear_status();
+    
+    uint8_t touched = 0;
+    for (int i = 0; i < TOUCH_SENSOR_COUNT; i++) {
+        if (pad_mask & (1UL << touch_pins[i])) {
+            touched |= 1 << i;
+        }
+    }
+    
+    if (touched == 0) {
+        return;
+    }
+    
+    taskENTER_CRITICAL_ISR(&latched_touch_lock);
+    latched_touch_mask |= touched;
+    taskEXIT_CRITICAL_ISR(&latched_touch_lock);
+    
+    // Defer everything else to the consumer task
+    if (touch_callback != NULL) {
+        touch_callback(touch_callback_arg);
+    }
 }
\ No newline at end of file
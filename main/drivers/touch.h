@@ -15,10 +15,25 @@
 #define TOUCH_SENSOR_RING   3
 #define TOUCH_SENSOR_PINKY  4
 
+// Touch threshold as a share of the untouched baseline, in percent
+#define TOUCH_THRESHOLD_PERCENT 80
+
+/**
+ * @brief Touch calibration
+ */
+typedef struct {
+    uint16_t baseline[TOUCH_SENSOR_COUNT];   // Reading with the pad untouched
+    uint16_t threshold[TOUCH_SENSOR_COUNT];  // Readings below are touches
+} touch_calibration_t;
+
 /**
  * @brief Touch event callback function type
+ * 
+ * Runs in interrupt context after the touched pads have been latched, so
+ * it must only use FromISR APIs. The latched events are collected later
+ * from task context with touch_take_events().
  */
-typedef void (*touch_callback_t)(bool *status);
+typedef void (*touch_callback_t)(void *arg);
 
 /**
  * @brief Initialize touch sensors
@@ -37,10 +52,33 @@ esp_err_t touch_deinit(void);
 /**
  * @brief Calibrate touch sensors
  * 
+ * Measures each pad's baseline, blocking for half a second. Not persisted;
+ * the guided session in core/calibration.h measures all pads alongside
+ * the other sensors and stores the result.
+ * 
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t touch_calibrate(void);
 
+/**
+ * @brief Get the current baselines and thresholds
+ * 
+ * @param calibration Pointer to store the calibration
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t touch_get_calibration(touch_calibration_t *calibration);
+
+/**
+ * @brief Set the baselines and thresholds
+ * 
+ * Can be called before touch_init(), which then uses them instead of
+ * measuring the baselines, or at any time after.
+ * 
+ * @param calibration Calibration to use
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t touch_set_calibration(const touch_calibration_t *calibration);
+
 /**
  * @brief Set touch sensor threshold
  * 
@@ -53,10 +91,19 @@ esp_err_t touch_set_threshold(uint8_t sensor_id, uint16_t threshold);
 /**
  * @brief Set touch event callback
  * 
- * @param callback Callback function
+ * @param callback Callback function, run from the touch ISR
+ * @param arg Argument passed to the callback
  * @return ESP_OK on success, error code otherwise
  */
-esp_err_t touch_set_callback(touch_callback_t callback);
+esp_err_t touch_set_callback(touch_callback_t callback, void *arg);
+
+/**
+ * @brief Take the touch events latched by the ISR since the last call
+ * 
+ * @param touched_mask Pointer to store a bitmask of sensors touched (bit n = sensor n)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t touch_take_events(uint8_t *touched_mask);
 
 /**
  * @brief Enable/disable touch sensors
@@ -100,6 +147,9 @@ bool touch_is_sensor_active(uint8_t sensor_id);
 /**
  * @brief Touch interrupt handler
  * 
+ * Only latches the touched pads and signals the callback; status is
+ * read and compared in task context.
+ * 
  * @param arg Handler argument (not used)
  */
 void touch_intr_handler(void *arg);
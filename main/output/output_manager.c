@@ -3,7 +3,6 @@
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/semphr.h"
 #include "drivers/display.h"
 #include "drivers/audio.h"
 #include "drivers/haptic.h"
@@ -40,7 +39,9 @@ static const haptic_pattern_t HAPTIC_PATTERN_ERROR[] = {
 
 // Output manager state
 static bool output_manager_initialized = false;
-static SemaphoreHandle_t output_mutex = NULL;
+
+// Origin of the command being handled, for the sink latencies
+static uint32_t command_origin = 0;
 
 // Font size mapping
 static const display_font_t font_size_map[] = {
@@ -66,13 +67,8 @@ esp_err_t output_manager_init(void) {
         return ESP_OK;  // Already initialized
     }
     
-    // Create mutex for thread-safe access to output devices
-    output_mutex = xSemaphoreCreateMutex();
-    if (output_mutex == NULL) {
-        ESP_LOGE(TAG, "Failed to create output mutex");
-        return ESP_ERR_NO_MEM;
-    }
-    
+    // No lock: only the output task drives the outputs, and the display,
+    // audio and haptic drivers each finish their work in their own task
     output_manager_initialized = true;
     ESP_LOGI(TAG, "Output manager initialized");
     
@@ -84,12 +80,6 @@ esp_err_t output_manager_deinit(void) {
         return ESP_OK;  // Already deinitialized
     }
     
-    // Delete mutex
-    if (output_mutex != NULL) {
-        vSemaphoreDelete(output_mutex);
-        output_mutex = NULL;
-    }
-    
     output_manager_initialized = false;
     ESP_LOGI(TAG, "Output manager deinitialized");
     
@@ -103,11 +93,7 @@ esp_err_t output_manager_handle_command(output_command_t *command) {
     
     esp_err_t ret = ESP_OK;
     
-    // Take mutex to ensure thread-safe access to output devices
-    if (xSemaphoreTake(output_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        ESP_LOGW(TAG, "Failed to take output mutex");
-        return ESP_ERR_TIMEOUT;
-    }
+    command_origin = command->origin_timestamp;
     
     // Handle command based on type
     switch (command->type) {
@@ -167,8 +153,7 @@ esp_err_t output_manager_handle_command(output_command_t *command) {
             break;
     }
     
-    // Release mutex
-    xSemaphoreGive(output_mutex);
+    command_origin = 0;
     
     return ret;
 }
@@ -237,12 +222,12 @@ esp_err_t output_manager_display_text(const char *text, uint8_t size, uint8_t li
     
     // Draw text and update display
     display_draw_text(text, 0, y, font, DISPLAY_ALIGN_LEFT);
-    display_update();
+    display_update_with_origin(command_origin);
     
     // Also send to BLE if connected
     bool connected = false;
     if (ble_service_is_connected(&connected) == ESP_OK && connected) {
-        ble_service_send_text(text);
+        ble_service_send_text(text, command_origin);
     }
     
     ESP_LOGI(TAG, "Displayed text: '%s'", text);
@@ -256,7 +241,7 @@ esp_err_t output_manager_speak_text(const char *text, uint8_t priority) {
     }
     
     // Priority not implemented yet, just speak the text
-    esp_err_t ret = audio_speak(text);
+    esp_err_t ret = audio_speak(text, command_origin);
     
     ESP_LOGI(TAG, "Speaking text: '%s'", text);
     
@@ -21,6 +21,8 @@ esp_err_t output_manager_deinit(void);
 /**
  * @brief Handle output command
  * 
+ * Only for the output task, which owns the display, audio and haptic outputs.
+ * 
  * @param command Output command to handle
  * @return ESP_OK on success, error code otherwise
  */
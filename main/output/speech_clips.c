@@ -0,0 +1,350 @@
+#include "output/speech_clips.h"
+#include <string.h>
+#include <ctype.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+static const char *TAG = "SPEECH_CLIPS";
+
+#define ADPCM_MAX_STEP_INDEX    (88)
+
+typedef struct {
+    int16_t *pcm;                // SPEECH_CACHE_MAX_SAMPLES samples in PSRAM
+    uint32_t last_used;          // use_clock at the last open
+    uint16_t clip;
+    bool valid;                  // Holds the whole decoded clip
+} cache_slot_t;
+
+static const esp_partition_t *speech_partition = NULL;
+static esp_partition_mmap_handle_t map_handle;
+static const uint8_t *archive = NULL;
+static const speech_clips_header_t *header = NULL;
+static const speech_clip_entry_t *index_entries = NULL;
+
+static cache_slot_t cache[SPEECH_CACHE_SLOTS];
+static uint32_t use_clock = 0;
+
+static const int16_t adpcm_step_table[ADPCM_MAX_STEP_INDEX + 1] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143,
+    157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+    724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t adpcm_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static inline int16_t ulaw_decode(uint8_t code) {
+    code = ~code;
+    int32_t magnitude = (((code & 0x0F) << 3) + 0x84) << ((code & 0x70) >> 4);
+    return (int16_t)((code & 0x80) ? (0x84 - magnitude) : (magnitude - 0x84));
+}
+
+static inline int16_t adpcm_decode(speech_stream_t *stream, uint8_t nibble) {
+    int32_t step = adpcm_step_table[stream->step_index];
+    int32_t diff = step >> 3;
+    if (nibble & 4) {
+        diff += step;
+    }
+    if (nibble & 2) {
+        diff += step >> 1;
+    }
+    if (nibble & 1) {
+        diff += step >> 2;
+    }
+
+    int32_t predictor = stream->predictor + ((nibble & 8) ? -diff : diff);
+    if (predictor > INT16_MAX) {
+        predictor = INT16_MAX;
+    } else if (predictor < INT16_MIN) {
+        predictor = INT16_MIN;
+    }
+    stream->predictor = predictor;
+
+    int32_t step_index = stream->step_index + adpcm_index_table[nibble];
+    if (step_index < 0) {
+        step_index = 0;
+    } else if (step_index > ADPCM_MAX_STEP_INDEX) {
+        step_index = ADPCM_MAX_STEP_INDEX;
+    }
+    stream->step_index = step_index;
+
+    return (int16_t)predictor;
+}
+
+// Check that the mapped archive is complete, self-consistent and intact
+static esp_err_t validate_archive(const uint8_t *image) {
+    const speech_clips_header_t *hdr = (const speech_clips_header_t *)image;
+
+    if (hdr->magic != SPEECH_CLIPS_MAGIC) {
+        ESP_LOGW(TAG, "No clip archive in partition");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (hdr->version != SPEECH_CLIPS_VERSION || hdr->header_size != sizeof(speech_clips_header_t)) {
+        ESP_LOGW(TAG, "Unsupported clip archive version %u", hdr->version);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    if (hdr->sample_rate == 0 || AUDIO_SAMPLE_RATE % hdr->sample_rate != 0) {
+        ESP_LOGW(TAG, "Clip sample rate %lu Hz does not divide %d Hz",
+                 (unsigned long)hdr->sample_rate, AUDIO_SAMPLE_RATE);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    if (hdr->clip_count == 0 || hdr->clip_count >= SPEECH_CLIP_PAUSE ||
+        hdr->index_offset < hdr->header_size || hdr->total_size > speech_partition->size ||
+        hdr->index_offset + hdr->clip_count * sizeof(speech_clip_entry_t) > hdr->total_size) {
+        ESP_LOGW(TAG, "Clip archive layout is inconsistent");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (esp_rom_crc32_le(0, image + hdr->header_size, hdr->total_size - hdr->header_size) != hdr->crc32) {
+        ESP_LOGW(TAG, "Clip archive CRC mismatch");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    // Playback reads clips without checking them
+    const speech_clip_entry_t *entry = (const speech_clip_entry_t *)(image + hdr->index_offset);
+    for (uint32_t i = 0; i < hdr->clip_count; i++) {
+        uint32_t expected_size = (entry[i].encoding == SPEECH_CLIP_ULAW) ? entry[i].samples : (entry[i].samples + 1) / 2;
+        if (entry[i].encoding > SPEECH_CLIP_IMA_ADPCM || entry[i].data_size != expected_size ||
+            entry[i].data_offset > hdr->total_size || entry[i].data_size > hdr->total_size - entry[i].data_offset ||
+            entry[i].adpcm_step_index > ADPCM_MAX_STEP_INDEX ||
+            entry[i].name[0] == '\0' || entry[i].name[SPEECH_CLIP_NAME_SIZE - 1] != '\0' ||
+            (i > 0 && strncmp(entry[i - 1].name, entry[i].name, SPEECH_CLIP_NAME_SIZE) >= 0)) {
+            ESP_LOGW(TAG, "Clip %lu is malformed", (unsigned long)i);
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t speech_clips_init(void) {
+    if (header != NULL) {
+        return ESP_OK;
+    }
+
+    speech_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                SPEECH_CLIPS_PARTITION_SUBTYPE,
+                                                SPEECH_CLIPS_PARTITION_LABEL);
+    if (speech_partition == NULL) {
+        ESP_LOGW(TAG, "Speech partition '%s' not found", SPEECH_CLIPS_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const void *ptr = NULL;
+    esp_err_t ret = esp_partition_mmap(speech_partition, 0, speech_partition->size,
+                                       ESP_PARTITION_MMAP_DATA, &ptr, &map_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map speech partition: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = validate_archive((const uint8_t *)ptr);
+    if (ret != ESP_OK) {
+        esp_partition_munmap(map_handle);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    archive = (const uint8_t *)ptr;
+    header = (const speech_clips_header_t *)archive;
+    index_entries = (const speech_clip_entry_t *)(archive + header->index_offset);
+
+    // Without PSRAM every clip is decoded from flash
+    size_t cached_slots = 0;
+    for (int i = 0; i < SPEECH_CACHE_SLOTS; i++) {
+        cache[i].pcm = heap_caps_malloc(SPEECH_CACHE_MAX_SAMPLES * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        cache[i].valid = false;
+        cached_slots += (cache[i].pcm != NULL);
+    }
+
+    ESP_LOGI(TAG, "%lu clips mapped at %lu Hz, %u cache slots",
+             (unsigned long)header->clip_count, (unsigned long)header->sample_rate, (unsigned)cached_slots);
+    return ESP_OK;
+}
+
+bool speech_clips_available(void) {
+    return header != NULL;
+}
+
+uint32_t speech_clips_sample_rate(void) {
+    return (header != NULL) ? header->sample_rate : 0;
+}
+
+// Binary search for an exact name of `length` characters
+static int32_t find_clip(const char *name, size_t length) {
+    int32_t low = 0;
+    int32_t high = (int32_t)header->clip_count - 1;
+
+    while (low <= high) {
+        int32_t mid = (low + high) / 2;
+        const char *entry_name = index_entries[mid].name;
+        int cmp = strncmp(entry_name, name, length);
+        if (cmp == 0 && entry_name[length] != '\0') {
+            cmp = 1;  // Entry is longer than the name
+        }
+
+        if (cmp == 0) {
+            return mid;
+        } else if (cmp < 0) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    return -1;
+}
+
+size_t speech_clips_plan(const char *text, uint16_t *clips, size_t max_clips) {
+    if (header == NULL || text == NULL || clips == NULL) {
+        return 0;
+    }
+
+    size_t count = 0;
+    const char *p = text;
+    while (*p != '\0' && count < max_clips) {
+        // Collect one word, upper case
+        char word[SPEECH_CLIP_NAME_SIZE * 2];
+        size_t length = 0;
+        while (*p != '\0' && !isalnum((unsigned char)*p) && *p != '\'') {
+            p++;
+        }
+        while ((isalnum((unsigned char)*p) || *p == '\'') && length < sizeof(word)) {
+            word[length++] = (char)toupper((unsigned char)*p++);
+        }
+        while (isalnum((unsigned char)*p) || *p == '\'') {
+            p++;  // Longer words are cut short
+        }
+        if (length == 0) {
+            continue;
+        }
+
+        if (count > 0 && clips[count - 1] != SPEECH_CLIP_PAUSE) {
+            clips[count++] = SPEECH_CLIP_PAUSE;
+        }
+
+        // Longest clip at each point, so whole words beat their pieces
+        size_t start = 0;
+        while (start < length && count < max_clips) {
+            size_t span = length - start;
+            if (span > SPEECH_CLIP_NAME_SIZE - 1) {
+                span = SPEECH_CLIP_NAME_SIZE - 1;
+            }
+
+            int32_t clip = -1;
+            for (; span > 0; span--) {
+                clip = find_clip(&word[start], span);
+                if (clip >= 0) {
+                    break;
+                }
+            }
+
+            if (clip < 0) {
+                start++;  // No clip for this letter
+            } else {
+                clips[count++] = (uint16_t)clip;
+                start += span;
+            }
+        }
+    }
+
+    // No trailing gap
+    if (count > 0 && clips[count - 1] == SPEECH_CLIP_PAUSE) {
+        count--;
+    }
+    return count;
+}
+
+esp_err_t speech_clips_open(uint16_t clip, speech_stream_t *stream) {
+    if (header == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (clip >= header->clip_count || stream == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const speech_clip_entry_t *entry = &index_entries[clip];
+    memset(stream, 0, sizeof(*stream));
+    stream->entry = entry;
+    stream->data = archive + entry->data_offset;
+    stream->slot = -1;
+    stream->predictor = entry->adpcm_predictor;
+    stream->step_index = entry->adpcm_step_index;
+
+    // A cached copy, or else the least recently used slot to fill
+    int8_t victim = -1;
+    use_clock++;
+    for (int8_t i = 0; i < SPEECH_CACHE_SLOTS; i++) {
+        if (cache[i].pcm == NULL) {
+            continue;
+        }
+        if (cache[i].valid && cache[i].clip == clip) {
+            cache[i].last_used = use_clock;
+            stream->cached = cache[i].pcm;
+            stream->slot = i;
+            return ESP_OK;
+        }
+        if (victim < 0 || (!cache[i].valid && cache[victim].valid) ||
+            (cache[i].valid == cache[victim].valid && cache[i].last_used < cache[victim].last_used)) {
+            victim = i;
+        }
+    }
+
+    if (victim >= 0 && entry->samples <= SPEECH_CACHE_MAX_SAMPLES) {
+        cache[victim].valid = false;
+        cache[victim].clip = clip;
+        cache[victim].last_used = use_clock;
+        stream->fill = cache[victim].pcm;
+        stream->slot = victim;
+    }
+
+    return ESP_OK;
+}
+
+size_t speech_clips_read(speech_stream_t *stream, int16_t *pcm, size_t max_samples) {
+    if (stream == NULL || stream->entry == NULL || pcm == NULL) {
+        return 0;
+    }
+
+    uint32_t remaining = stream->entry->samples - stream->position;
+    size_t count = (max_samples < remaining) ? max_samples : remaining;
+    if (count == 0) {
+        return 0;
+    }
+
+    if (stream->cached != NULL) {
+        memcpy(pcm, &stream->cached[stream->position], count * sizeof(int16_t));
+    } else if (stream->entry->encoding == SPEECH_CLIP_ULAW) {
+        for (size_t i = 0; i < count; i++) {
+            pcm[i] = ulaw_decode(stream->data[stream->position + i]);
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            uint32_t sample = stream->position + i;
+            uint8_t byte = stream->data[sample / 2];
+            pcm[i] = adpcm_decode(stream, (sample & 1) ? (byte >> 4) : (byte & 0x0F));
+        }
+    }
+
+    if (stream->fill != NULL) {
+        memcpy(&stream->fill[stream->position], pcm, count * sizeof(int16_t));
+    }
+    stream->position += count;
+
+    // Only a clip decoded to the end is served from the cache
+    if (stream->fill != NULL && stream->position == stream->entry->samples) {
+        cache[stream->slot].valid = true;
+        stream->fill = NULL;
+    }
+
+    return count;
+}
@@ -0,0 +1,137 @@
+#ifndef OUTPUT_SPEECH_CLIPS_H
+#define OUTPUT_SPEECH_CLIPS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "config/system_config.h"
+
+// Flash partition holding the clip archive (data partition, subtype 0x43)
+#define SPEECH_CLIPS_PARTITION_LABEL    "speech"
+#define SPEECH_CLIPS_PARTITION_SUBTYPE  0x43
+
+// Clip archive format
+#define SPEECH_CLIPS_MAGIC           0x50494C43  // "CLIP" little-endian
+#define SPEECH_CLIPS_VERSION         1
+#define SPEECH_CLIP_NAME_SIZE        16          // Name bytes in an index entry, NUL-padded
+#define SPEECH_CLIP_PAUSE            0xFFFF      // Plan entry for the gap between words
+
+/**
+ * @brief Clip sample encodings
+ */
+typedef enum {
+    SPEECH_CLIP_ULAW = 0,        // G.711 µ-law, one byte per sample
+    SPEECH_CLIP_IMA_ADPCM        // IMA ADPCM, two samples per byte, low nibble first
+} speech_clip_encoding_t;
+
+/**
+ * @brief Header at the start of the clip archive
+ *
+ * The archive is laid out for direct use once memory-mapped:
+ *
+ *   header | index[clip_count] | clip data
+ *
+ * The index is sorted by name (byte order), so clips are found by binary
+ * search. Names are upper-case words, word pieces or single letters; text
+ * is spoken by matching the longest name at each point of a word. All
+ * clips are mono at sample_rate, which must divide AUDIO_SAMPLE_RATE.
+ * crc32 covers every byte from header_size to total_size.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;              // SPEECH_CLIPS_MAGIC
+    uint16_t version;            // SPEECH_CLIPS_VERSION
+    uint16_t header_size;        // sizeof(speech_clips_header_t)
+    uint32_t sample_rate;        // Hz
+    uint32_t clip_count;         // Entries in the index
+    uint32_t index_offset;       // Offset of the index from the start of the archive
+    uint32_t total_size;         // Archive size in bytes
+    uint32_t crc32;              // CRC32 (little-endian) of bytes [header_size, total_size)
+} speech_clips_header_t;
+
+/**
+ * @brief Index entry of one clip
+ */
+typedef struct __attribute__((packed)) {
+    char name[SPEECH_CLIP_NAME_SIZE];  // Upper case, NUL-padded, at most 15 characters
+    uint32_t data_offset;        // Offset of the encoded samples from the start of the archive
+    uint32_t data_size;          // Encoded bytes
+    uint32_t samples;            // Decoded samples
+    uint8_t encoding;            // speech_clip_encoding_t
+    uint8_t adpcm_step_index;    // IMA ADPCM state at the first sample (0-88)
+    int16_t adpcm_predictor;
+} speech_clip_entry_t;
+
+/**
+ * @brief Read position in one clip
+ */
+typedef struct {
+    const speech_clip_entry_t *entry;
+    const uint8_t *data;         // Encoded samples, in mapped flash
+    const int16_t *cached;       // Decoded copy in PSRAM, NULL while decoding from flash
+    int16_t *fill;               // Cache slot being filled while decoding, NULL if none
+    int8_t slot;                 // Cache slot of the clip, -1 if none
+    uint32_t position;           // Samples read so far
+    int32_t predictor;           // IMA ADPCM decoder state
+    int32_t step_index;
+} speech_stream_t;
+
+/**
+ * @brief Map the clip archive and allocate the decoded clip cache
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no valid archive is flashed
+ */
+esp_err_t speech_clips_init(void);
+
+/**
+ * @brief Check if an archive is mapped
+ *
+ * @return true if text can be spoken from clips
+ */
+bool speech_clips_available(void);
+
+/**
+ * @brief Get the sample rate of the clips
+ *
+ * @return Sample rate in Hz, 0 if no archive is mapped
+ */
+uint32_t speech_clips_sample_rate(void);
+
+/**
+ * @brief Turn text into a sequence of clips
+ *
+ * Each word takes the longest clip matching at each point, down to single
+ * letters; letters without a clip are skipped. Words are separated by
+ * SPEECH_CLIP_PAUSE entries.
+ *
+ * @param text Text to speak
+ * @param clips Buffer to store clip indices
+ * @param max_clips Size of the buffer
+ * @return Number of entries written
+ */
+size_t speech_clips_plan(const char *text, uint16_t *clips, size_t max_clips);
+
+/**
+ * @brief Start reading a clip
+ *
+ * Clips in the cache are read from PSRAM. Others are decoded from flash a
+ * block at a time and, when short enough, kept in the least recently used
+ * cache slot. Only for the audio task.
+ *
+ * @param clip Clip index from speech_clips_plan()
+ * @param stream Stream to set up
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t speech_clips_open(uint16_t clip, speech_stream_t *stream);
+
+/**
+ * @brief Read the next samples of a clip
+ *
+ * @param stream Open stream
+ * @param pcm Buffer to store mono samples at the clip sample rate
+ * @param max_samples Size of the buffer
+ * @return Number of samples read, 0 at the end of the clip
+ */
+size_t speech_clips_read(speech_stream_t *stream, int16_t *pcm, size_t max_samples);
+
+#endif /* OUTPUT_SPEECH_CLIPS_H */
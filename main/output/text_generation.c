@@ -3,18 +3,139 @@
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "util/debug.h"
+#include "output/word_dictionary.h"
+#include "util/text_ring.h"
 
 static const char *TAG = "TEXT_GEN";
 
 // Text generation state
 static bool text_generation_initialized = false;
 
-// Buffer for the current sentence being constructed
-static char current_sentence[128] = {0};
+// Sentence being constructed
+static text_ring_t sentence;
+
+// Dictionary position of the word being spelled and its top completion
+static word_dictionary_cursor_t word_cursor;
+static char suggestion[WORD_DICTIONARY_MAX_WORD + 1] = {0};
+
+/**
+ * What a recognized gesture does to the sentence. Resolved from the
+ * gesture name the first time a gesture id is seen, then looked up by id.
+ */
+typedef enum {
+    GESTURE_ACTION_UNRESOLVED = 0,
+    GESTURE_ACTION_LETTER,       // Append one letter
+    GESTURE_ACTION_WORD,         // Append a whole word
+    GESTURE_ACTION_SPACE,
+    GESTURE_ACTION_BACKSPACE,
+    GESTURE_ACTION_CLEAR,
+    GESTURE_ACTION_CONFIRM       // Accept the word completion
+} gesture_action_type_t;
+
+typedef struct {
+    uint8_t type;                // gesture_action_type_t
+    char letter;                 // Letter of a GESTURE_ACTION_LETTER
+    uint32_t tag;                // Leading name bytes, to notice a slot reused by another gesture
+} gesture_action_t;
+
+static const struct {
+    const char *name;
+    gesture_action_type_t type;
+} control_gestures[] = {
+    {"SPACE", GESTURE_ACTION_SPACE},
+    {"BACKSPACE", GESTURE_ACTION_BACKSPACE},
+    {"CLEAR", GESTURE_ACTION_CLEAR},
+    {"CONFIRM", GESTURE_ACTION_CONFIRM},
+};
+
+static gesture_action_t gesture_actions[MAX_GESTURES];
+
+static inline uint32_t name_tag(const char *name) {
+    uint32_t tag;
+    memcpy(&tag, name, sizeof(tag));
+    return tag;
+}
+
+static void resolve_action(const char *name, gesture_action_t *action) {
+    action->tag = name_tag(name);
+    action->letter = '\0';
+    
+    for (size_t i = 0; i < sizeof(control_gestures) / sizeof(control_gestures[0]); i++) {
+        if (strcmp(name, control_gestures[i].name) == 0) {
+            action->type = control_gestures[i].type;
+            return;
+        }
+    }
+    
+    // Alphabet gestures (A-Z) are letters, anything else a word
+    if (name[0] >= 'A' && name[0] <= 'Z' && name[1] == '\0') {
+        action->type = GESTURE_ACTION_LETTER;
+        action->letter = name[0];
+    } else {
+        action->type = GESTURE_ACTION_WORD;
+    }
+}
+
+// Action of a result, resolved by name only the first time its id is seen
+static const gesture_action_t* lookup_action(const processing_result_t *result) {
+    static gesture_action_t uncached;
+    if (result->gesture_id >= MAX_GESTURES) {
+        resolve_action(result->gesture_name, &uncached);
+        return &uncached;
+    }
+    
+    gesture_action_t *action = &gesture_actions[result->gesture_id];
+    if (action->type == GESTURE_ACTION_UNRESOLVED || action->tag != name_tag(result->gesture_name)) {
+        resolve_action(result->gesture_name, action);
+    }
+    return action;
+}
+
+// Start completing a new word at the end of the sentence
+static void restart_word(void) {
+    word_dictionary_cursor_reset(&word_cursor);
+    suggestion[0] = '\0';
+}
+
+static void update_suggestion(void) {
+    if (word_cursor.length >= WORD_COMPLETION_MIN_PREFIX) {
+        word_dictionary_complete(&word_cursor, suggestion, sizeof(suggestion));
+    } else {
+        suggestion[0] = '\0';
+    }
+}
+
+// Walk the dictionary again over the letters of the last word, after an edit
+static void rewind_word(void) {
+    const char *text = text_ring_data(&sentence);
+    size_t start = sentence.length;
+    while (start > 0 && text[start - 1] != ' ') {
+        start--;
+    }
+    
+    restart_word();
+    for (size_t i = start; i < sentence.length; i++) {
+        word_dictionary_cursor_step(&word_cursor, text[i]);
+    }
+    update_suggestion();
+}
+
+static void append_text(const char *text) {
+    for (const char *p = text; *p != '\0'; p++) {
+        text_ring_push(&sentence, *p);
+    }
+}
 
 esp_err_t text_generation_init(void) {
     // Clear the current sentence buffer
-    memset(current_sentence, 0, sizeof(current_sentence));
+    text_ring_init(&sentence);
+    
+    // Without a dictionary, letters are still typed, just not completed
+    esp_err_t ret = word_dictionary_init();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Word completion unavailable: %s", esp_err_to_name(ret));
+    }
+    restart_word();
     
     text_generation_initialized = true;
     ESP_LOGI(TAG, "Text generation initialized");
@@ -24,6 +145,7 @@ esp_err_t text_generation_init(void) {
 
 esp_err_t text_generation_deinit(void) {
     text_generation_initialized = false;
+    word_dictionary_deinit();
     ESP_LOGI(TAG, "Text generation deinitialized");
     
     return ESP_OK;
@@ -34,80 +156,53 @@ esp_err_t text_generation_generate_text(processing_result_t *result, char *outpu
         return ESP_ERR_INVALID_STATE;
     }
     
-    // Clear output buffer
-    memset(output_text, 0, max_length);
-    
-    // For this simplified version, we'll just output the gesture name directly
-    // In a real implementation, you would have more sophisticated language processing
-    
-    // Special cases for certain gestures
-    if (strcmp(result->gesture_name, "SPACE") == 0) {
-        // Add a space to the current sentence
-        size_t current_length = strlen(current_sentence);
-        if (current_length < sizeof(current_sentence) - 1) {
-            current_sentence[current_length] = ' ';
-            current_sentence[current_length + 1] = '\0';
-        }
-        
-        // Copy the current sentence to the output
-        snprintf(output_text, max_length, "%s", current_sentence);
-    }
-    else if (strcmp(result->gesture_name, "BACKSPACE") == 0) {
-        // Remove the last character from the current sentence
-        size_t current_length = strlen(current_sentence);
-        if (current_length > 0) {
-            current_sentence[current_length - 1] = '\0';
-        }
-        
-        // Copy the current sentence to the output
-        snprintf(output_text, max_length, "%s", current_sentence);
-    }
-    else if (strcmp(result->gesture_name, "CLEAR") == 0) {
-        // Clear the current sentence
-        memset(current_sentence, 0, sizeof(current_sentence));
-        
-        // Set output text
-        snprintf(output_text, max_length, "Text cleared");
-    }
-    else {
-        // For alphabet gestures (A-Z), add the letter to the current sentence
-        if (strlen(result->gesture_name) == 1 && 
-            result->gesture_name[0] >= 'A' && result->gesture_name[0] <= 'Z') {
-            // Add letter to the current sentence
-            size_t current_length = strlen(current_sentence);
-            if (current_length < sizeof(current_sentence) - 1) {
-                current_sentence[current_length] = result->gesture_name[0];
-                current_sentence[current_length + 1] = '\0';
-            }
+    const gesture_action_t *action = lookup_action(result);
+    switch (action->type) {
+        case GESTURE_ACTION_SPACE:
+            text_ring_push(&sentence, ' ');
+            restart_word();
+            break;
             
-            // Copy the current sentence to the output
-            snprintf(output_text, max_length, "%s", current_sentence);
-        }
-        // For word gestures, add the word followed by a space
-        else {
-            // Add the word to the current sentence
-            size_t current_length = strlen(current_sentence);
-            size_t word_length = strlen(result->gesture_name);
+        case GESTURE_ACTION_CONFIRM:
+            // Accept the top completion, or the word as spelled, and end it
+            append_text(suggestion);
+            text_ring_push(&sentence, ' ');
+            restart_word();
+            break;
             
-            // Check if we need to add a space first
-            if (current_length > 0 && current_sentence[current_length - 1] != ' ') {
-                if (current_length < sizeof(current_sentence) - 1) {
-                    current_sentence[current_length] = ' ';
-                    current_length++;
-                }
-            }
+        case GESTURE_ACTION_BACKSPACE:
+            text_ring_pop(&sentence);
+            rewind_word();
+            break;
             
-            // Add the word if there's space
-            if (current_length + word_length < sizeof(current_sentence) - 1) {
-                strncpy(current_sentence + current_length, result->gesture_name, 
-                        sizeof(current_sentence) - current_length - 1);
-            }
+        case GESTURE_ACTION_CLEAR:
+            text_ring_clear(&sentence);
+            restart_word();
             
-            // Copy the current sentence to the output
-            snprintf(output_text, max_length, "%s", current_sentence);
-        }
+            snprintf(output_text, max_length, "Text cleared");
+            return ESP_OK;
+            
+        case GESTURE_ACTION_LETTER:
+            text_ring_push(&sentence, action->letter);
+            
+            // Narrow the completion by the new letter
+            word_dictionary_cursor_step(&word_cursor, action->letter);
+            update_suggestion();
+            break;
+            
+        default:
+            // Words are separated from what came before by a space
+            if (sentence.length > 0 && text_ring_last(&sentence) != ' ') {
+                text_ring_push(&sentence, ' ');
+            }
+            append_text(result->gesture_name);
+            restart_word();
+            break;
     }
     
+    // Copy the end of the current sentence to the output
+    text_ring_copy(&sentence, output_text, max_length);
+    
     return ESP_OK;
 }
 
@@ -116,8 +211,8 @@ esp_err_t text_generation_get_current_text(char *output_text, size_t max_length)
         return ESP_ERR_INVALID_STATE;
     }
     
-    // Copy the current sentence to the output
-    snprintf(output_text, max_length, "%s", current_sentence);
+    // Copy the end of the current sentence to the output
+    text_ring_copy(&sentence, output_text, max_length);
     
     return ESP_OK;
 }
@@ -128,8 +223,31 @@ esp_err_t text_generation_clear_text(void) {
     }
     
     // Clear the current sentence
-    memset(current_sentence, 0, sizeof(current_sentence));
+    text_ring_clear(&sentence);
+    restart_word();
     
     ESP_LOGI(TAG, "Text cleared");
+    return ESP_OK;
+}
+
+esp_err_t text_generation_get_suggestion(char *output_text, size_t max_length) {
+    if (!text_generation_initialized || output_text == NULL || max_length == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    // Copy the letters the confirm gesture would add
+    snprintf(output_text, max_length, "%s", suggestion);
+    
+    return ESP_OK;
+}
+
+esp_err_t text_generation_get_delta(char *output_text, size_t max_length, size_t *erase) {
+    if (!text_generation_initialized || output_text == NULL || max_length == 0 || erase == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    // Only what changed since the previous call
+    text_ring_take_delta(&sentence, output_text, max_length, erase);
+    
     return ESP_OK;
 }
\ No newline at end of file
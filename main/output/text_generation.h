@@ -22,6 +22,10 @@ esp_err_t text_generation_deinit(void);
 /**
  * @brief Generate text from gesture recognition result
  * 
+ * Letters are matched against the word dictionary as they arrive; a
+ * CONFIRM gesture completes the word with the top suggestion. The output
+ * holds the end of the sentence that fits.
+ * 
  * @param result Processing result from gesture detection
  * @param output_text Buffer to store generated text
  * @param max_length Maximum length of output text
@@ -38,6 +42,32 @@ esp_err_t text_generation_generate_text(processing_result_t *result, char *outpu
  */
 esp_err_t text_generation_get_current_text(char *output_text, size_t max_length);
 
+/**
+ * @brief Get what changed in the current text since the last call
+ * 
+ * For consumers that keep their own copy of the text: drop *erase
+ * characters from its end, then append the returned characters. Text that
+ * does not fit is returned by the next call.
+ * 
+ * @param output_text Buffer to store the new characters
+ * @param max_length Maximum length of output text
+ * @param erase Pointer to store the number of characters to drop
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t text_generation_get_delta(char *output_text, size_t max_length, size_t *erase);
+
+/**
+ * @brief Get the completion offered for the word being spelled
+ * 
+ * These are the letters a CONFIRM gesture would add; empty when the
+ * current letters are too few or spell no dictionary word.
+ * 
+ * @param output_text Buffer to store the missing letters
+ * @param max_length Maximum length of output text
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t text_generation_get_suggestion(char *output_text, size_t max_length);
+
 /**
  * @brief Clear the current text
  * 
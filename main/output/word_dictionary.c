@@ -0,0 +1,432 @@
+#include "output/word_dictionary.h"
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+static const char *TAG = "WORD_DICT";
+
+#define FLASH_SECTOR_SIZE    (4096)
+#define BUILD_NONE           (0xFFFFFFFF)
+
+static const esp_partition_t *dictionary_partition = NULL;
+static esp_partition_mmap_handle_t map_handle;
+static const uint8_t *image = NULL;
+static const word_dictionary_header_t *header = NULL;
+static const word_dictionary_node_t *nodes = NULL;
+
+// Used when no word list has been uploaded, most frequent first
+static const char *const default_words[] = {
+    "THE", "BE", "TO", "OF", "AND", "A", "IN", "THAT", "HAVE", "I",
+    "IT", "FOR", "NOT", "ON", "WITH", "HE", "AS", "YOU", "DO", "AT",
+    "THIS", "BUT", "HIS", "BY", "FROM", "THEY", "WE", "SAY", "HER", "SHE",
+    "OR", "AN", "WILL", "MY", "ONE", "ALL", "WOULD", "THERE", "THEIR", "WHAT",
+    "SO", "UP", "OUT", "IF", "ABOUT", "WHO", "GET", "WHICH", "GO", "ME",
+    "WHEN", "MAKE", "CAN", "LIKE", "TIME", "NO", "JUST", "HIM", "KNOW", "TAKE",
+    "PEOPLE", "INTO", "YEAR", "YOUR", "GOOD", "SOME", "COULD", "THEM", "SEE", "OTHER",
+    "THAN", "THEN", "NOW", "LOOK", "ONLY", "COME", "ITS", "OVER", "THINK", "ALSO",
+    "BACK", "AFTER", "USE", "TWO", "HOW", "OUR", "WORK", "FIRST", "WELL", "WAY",
+    "EVEN", "NEW", "WANT", "BECAUSE", "ANY", "THESE", "GIVE", "DAY", "MOST", "US",
+    "HELLO", "THANKS", "PLEASE", "YES", "HELP", "NAME", "WATER", "EAT", "DRINK", "SORRY",
+    "FRIEND", "FAMILY", "HOME", "SCHOOL", "NEED", "WHERE", "WHY", "UNDERSTAND", "AGAIN", "LATER"
+};
+
+// Trie node while building, children kept as a sorted sibling list
+typedef struct {
+    uint32_t first_child;
+    uint32_t next_sibling;
+    uint32_t best;               // Child on the way to the best word, BUILD_NONE if it ends here
+    uint8_t letter;
+    bool is_word;
+    bool has_best;
+} build_node_t;
+
+typedef struct {
+    build_node_t *nodes;
+    uint32_t node_count;
+    uint32_t max_nodes;
+    uint32_t word_count;
+} builder_t;
+
+static inline uint32_t align_up(uint32_t value, uint32_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+static uint32_t image_crc(const uint8_t *data, const word_dictionary_header_t *hdr) {
+    return esp_rom_crc32_le(0, data + hdr->header_size, hdr->total_size - hdr->header_size);
+}
+
+static esp_err_t map_partition(void) {
+    const void *ptr = NULL;
+    esp_err_t ret = esp_partition_mmap(dictionary_partition, 0, dictionary_partition->size,
+                                       ESP_PARTITION_MMAP_DATA, &ptr, &map_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map dictionary partition: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    image = (const uint8_t *)ptr;
+    return ESP_OK;
+}
+
+static void unmap_partition(void) {
+    if (image != NULL) {
+        esp_partition_munmap(map_handle);
+        image = NULL;
+    }
+    header = NULL;
+    nodes = NULL;
+}
+
+// Check that the mapped image is complete, self-consistent and intact
+static esp_err_t validate_image(void) {
+    const word_dictionary_header_t *hdr = (const word_dictionary_header_t *)image;
+
+    if (hdr->magic != WORD_DICTIONARY_MAGIC) {
+        ESP_LOGW(TAG, "No dictionary image in partition");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (hdr->version != WORD_DICTIONARY_VERSION || hdr->header_size != sizeof(word_dictionary_header_t)) {
+        ESP_LOGW(TAG, "Unsupported dictionary image version %u", hdr->version);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    if (hdr->node_count == 0 || hdr->node_offset < hdr->header_size ||
+        hdr->total_size > dictionary_partition->size ||
+        hdr->node_offset + hdr->node_count * sizeof(word_dictionary_node_t) != hdr->total_size) {
+        ESP_LOGW(TAG, "Dictionary image layout is inconsistent");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (image_crc(image, hdr) != hdr->crc32) {
+        ESP_LOGW(TAG, "Dictionary image CRC mismatch");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    // Lookups follow links without checking them
+    const word_dictionary_node_t *node = (const word_dictionary_node_t *)(image + hdr->node_offset);
+    for (uint32_t i = 0; i < hdr->node_count; i++) {
+        if (node[i].child_count > 26 ||
+            (node[i].child_count > 0 && node[i].first_child + node[i].child_count > hdr->node_count) ||
+            (node[i].best_child != WORD_DICTIONARY_NO_CHILD && node[i].best_child >= node[i].child_count)) {
+            ESP_LOGW(TAG, "Dictionary node %lu is malformed", (unsigned long)i);
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    header = hdr;
+    nodes = node;
+    return ESP_OK;
+}
+
+static esp_err_t load_image(void) {
+    esp_err_t ret = map_partition();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = validate_image();
+    if (ret != ESP_OK) {
+        unmap_partition();
+    }
+    return ret;
+}
+
+static uint32_t builder_new_node(builder_t *builder, uint8_t letter) {
+    if (builder->node_count >= builder->max_nodes) {
+        return BUILD_NONE;
+    }
+
+    uint32_t id = builder->node_count++;
+    build_node_t *node = &builder->nodes[id];
+    memset(node, 0, sizeof(*node));
+    node->first_child = BUILD_NONE;
+    node->next_sibling = BUILD_NONE;
+    node->best = BUILD_NONE;
+    node->letter = letter;
+    return id;
+}
+
+// Child of a node for a letter, created in letter order if missing
+static uint32_t builder_child(builder_t *builder, uint32_t parent, uint8_t letter) {
+    uint32_t *link = &builder->nodes[parent].first_child;
+    while (*link != BUILD_NONE && builder->nodes[*link].letter < letter) {
+        link = &builder->nodes[*link].next_sibling;
+    }
+    if (*link != BUILD_NONE && builder->nodes[*link].letter == letter) {
+        return *link;
+    }
+
+    uint32_t id = builder_new_node(builder, letter);
+    if (id != BUILD_NONE) {
+        builder->nodes[id].next_sibling = *link;
+        *link = id;
+    }
+    return id;
+}
+
+// Words arrive most frequent first, so the first word through a node is its best
+static esp_err_t builder_add(builder_t *builder, const char *word, size_t length) {
+    // Room for the whole word up front, so no node is left without a word below it
+    if (builder->node_count + length > builder->max_nodes) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint32_t path[WORD_DICTIONARY_MAX_WORD + 1];
+    path[0] = 0;
+    for (size_t i = 0; i < length; i++) {
+        path[i + 1] = builder_child(builder, path[i], (uint8_t)word[i]);
+        if (path[i + 1] == BUILD_NONE) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    build_node_t *last = &builder->nodes[path[length]];
+    if (last->is_word) {
+        return ESP_OK;
+    }
+    last->is_word = true;
+    builder->word_count++;
+
+    for (size_t i = 0; i <= length; i++) {
+        build_node_t *node = &builder->nodes[path[i]];
+        if (!node->has_best) {
+            node->best = (i < length) ? path[i + 1] : BUILD_NONE;
+            node->has_best = true;
+        }
+    }
+    return ESP_OK;
+}
+
+// Clean up one word list entry; false if it is not a plain word
+static bool normalize_word(const char *text, char *word, size_t *length) {
+    size_t n = 0;
+    for (const char *p = text; *p != '\0' && *p != '\n' && *p != '\r'; p++) {
+        if (!isalpha((unsigned char)*p) || n >= WORD_DICTIONARY_MAX_WORD) {
+            return false;
+        }
+        word[n++] = (char)toupper((unsigned char)*p);
+    }
+    *length = n;
+    return n > 0;
+}
+
+static esp_err_t builder_add_list(builder_t *builder) {
+    char line[64];
+    char word[WORD_DICTIONARY_MAX_WORD];
+    size_t length;
+    esp_err_t ret = ESP_OK;
+
+    FILE *file = fopen(WORD_DICTIONARY_PATH, "r");
+    if (file == NULL) {
+        ESP_LOGW(TAG, "No word list at %s, using built-in words", WORD_DICTIONARY_PATH);
+        for (size_t i = 0; i < sizeof(default_words) / sizeof(default_words[0]) && ret == ESP_OK; i++) {
+            if (normalize_word(default_words[i], word, &length)) {
+                ret = builder_add(builder, word, length);
+            }
+        }
+        return ret;
+    }
+
+    while (ret == ESP_OK && fgets(line, sizeof(line), file) != NULL) {
+        if (normalize_word(line, word, &length)) {
+            ret = builder_add(builder, word, length);
+        }
+    }
+    fclose(file);
+
+    if (ret == ESP_ERR_NO_MEM) {
+        ESP_LOGW(TAG, "Dictionary full after %lu words", (unsigned long)builder->word_count);
+        ret = ESP_OK;
+    }
+    return ret;
+}
+
+// Lay the trie out breadth first so every node's children are consecutive
+static void builder_serialize(const builder_t *builder, uint32_t *order, uint8_t *out) {
+    word_dictionary_header_t *hdr = (word_dictionary_header_t *)out;
+    word_dictionary_node_t *dst = (word_dictionary_node_t *)(out + sizeof(*hdr));
+
+    uint32_t count = 1;
+    order[0] = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const build_node_t *src = &builder->nodes[order[i]];
+        dst[i].first_child = count;
+        dst[i].child_count = 0;
+        dst[i].letter = src->letter;
+        dst[i].best_child = WORD_DICTIONARY_NO_CHILD;
+        dst[i].is_word = src->is_word ? 1 : 0;
+
+        for (uint32_t c = src->first_child; c != BUILD_NONE; c = builder->nodes[c].next_sibling) {
+            if (c == src->best) {
+                dst[i].best_child = dst[i].child_count;
+            }
+            order[count++] = c;
+            dst[i].child_count++;
+        }
+    }
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = WORD_DICTIONARY_MAGIC;
+    hdr->version = WORD_DICTIONARY_VERSION;
+    hdr->header_size = sizeof(*hdr);
+    hdr->word_count = builder->word_count;
+    hdr->node_count = builder->node_count;
+    hdr->node_offset = sizeof(*hdr);
+    hdr->total_size = sizeof(*hdr) + builder->node_count * sizeof(word_dictionary_node_t);
+    hdr->crc32 = image_crc(out, hdr);
+}
+
+// Nodes first and the header last, so an interrupted write leaves no valid image
+static esp_err_t write_image(const uint8_t *out, const word_dictionary_header_t *hdr) {
+    esp_err_t ret = esp_partition_erase_range(dictionary_partition, 0, align_up(hdr->total_size, FLASH_SECTOR_SIZE));
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(dictionary_partition, hdr->header_size, out + hdr->header_size,
+                                  hdr->total_size - hdr->header_size);
+    }
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(dictionary_partition, 0, out, hdr->header_size);
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Dictionary flash write failed: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t word_dictionary_init(void) {
+    if (header != NULL) {
+        return ESP_OK;
+    }
+
+    dictionary_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                    WORD_DICTIONARY_PARTITION_SUBTYPE,
+                                                    WORD_DICTIONARY_PARTITION_LABEL);
+    if (dictionary_partition == NULL) {
+        ESP_LOGE(TAG, "Dictionary partition '%s' not found", WORD_DICTIONARY_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t ret = load_image();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Building dictionary image");
+        ret = word_dictionary_rebuild();
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    ESP_LOGI(TAG, "%lu words mapped (%lu nodes)",
+             (unsigned long)header->word_count, (unsigned long)header->node_count);
+    return ESP_OK;
+}
+
+esp_err_t word_dictionary_deinit(void) {
+    unmap_partition();
+    return ESP_OK;
+}
+
+esp_err_t word_dictionary_rebuild(void) {
+    if (dictionary_partition == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    unmap_partition();
+
+    // Temporary, in PSRAM: the trie as built, the layout order and the image
+    builder_t builder = {
+        .max_nodes = (dictionary_partition->size - sizeof(word_dictionary_header_t)) / sizeof(word_dictionary_node_t),
+    };
+    size_t image_size = sizeof(word_dictionary_header_t) + builder.max_nodes * sizeof(word_dictionary_node_t);
+    builder.nodes = heap_caps_malloc(builder.max_nodes * sizeof(build_node_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    uint32_t *order = heap_caps_malloc(builder.max_nodes * sizeof(uint32_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    uint8_t *out = heap_caps_malloc(image_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    if (builder.nodes != NULL && order != NULL && out != NULL) {
+        builder_new_node(&builder, 0);
+        ret = builder_add_list(&builder);
+    }
+
+    if (ret == ESP_OK) {
+        builder_serialize(&builder, order, out);
+        ret = write_image(out, (const word_dictionary_header_t *)out);
+    }
+
+    heap_caps_free(builder.nodes);
+    heap_caps_free(order);
+    heap_caps_free(out);
+
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return load_image();
+}
+
+void word_dictionary_cursor_reset(word_dictionary_cursor_t *cursor) {
+    if (cursor == NULL) {
+        return;
+    }
+
+    cursor->node = 0;
+    cursor->length = 0;
+    cursor->valid = (nodes != NULL);
+}
+
+bool word_dictionary_cursor_step(word_dictionary_cursor_t *cursor, char letter) {
+    if (cursor == NULL || !cursor->valid || nodes == NULL) {
+        return false;
+    }
+
+    uint8_t key = (uint8_t)toupper((unsigned char)letter);
+    const word_dictionary_node_t *node = &nodes[cursor->node];
+
+    // Children are sorted, so the scan stops at the first letter past the key
+    cursor->valid = false;
+    for (uint8_t i = 0; i < node->child_count; i++) {
+        const word_dictionary_node_t *child = &nodes[node->first_child + i];
+        if (child->letter >= key) {
+            if (child->letter == key) {
+                cursor->node = node->first_child + i;
+                cursor->valid = true;
+            }
+            break;
+        }
+    }
+
+    if (cursor->length < UINT8_MAX) {
+        cursor->length++;
+    }
+    return cursor->valid;
+}
+
+size_t word_dictionary_complete(const word_dictionary_cursor_t *cursor, char *suffix, size_t max_length) {
+    if (suffix == NULL || max_length == 0) {
+        return 0;
+    }
+    suffix[0] = '\0';
+
+    if (cursor == NULL || !cursor->valid || nodes == NULL) {
+        return 0;
+    }
+
+    // The length bound also stops a malformed image from looping
+    size_t n = 0;
+    const word_dictionary_node_t *node = &nodes[cursor->node];
+    while (node->best_child != WORD_DICTIONARY_NO_CHILD &&
+           n + 1 < max_length && cursor->length + n < WORD_DICTIONARY_MAX_WORD) {
+        node = &nodes[node->first_child + node->best_child];
+        suffix[n++] = (char)node->letter;
+    }
+
+    // A completion cut short would type a word that is not in the dictionary
+    if (node->best_child != WORD_DICTIONARY_NO_CHILD) {
+        n = 0;
+    }
+    suffix[n] = '\0';
+    return n;
+}
@@ -0,0 +1,122 @@
+#ifndef OUTPUT_WORD_DICTIONARY_H
+#define OUTPUT_WORD_DICTIONARY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "config/system_config.h"
+
+// Flash partition holding the dictionary image (data partition, subtype 0x42)
+#define WORD_DICTIONARY_PARTITION_LABEL    "dictionary"
+#define WORD_DICTIONARY_PARTITION_SUBTYPE  0x42
+
+// Dictionary image format
+#define WORD_DICTIONARY_MAGIC        0x54434457  // "WDCT" little-endian
+#define WORD_DICTIONARY_VERSION      1
+#define WORD_DICTIONARY_NO_CHILD     0xFF        // best_child of a node whose best word ends there
+
+/**
+ * @brief Header at the start of the dictionary image
+ *
+ * The image is a letter trie laid out for direct use once memory-mapped:
+ *
+ *   header | nodes[node_count]
+ *
+ * Node 0 is the root (empty prefix). The children of a node are
+ * child_count consecutive nodes starting at first_child, sorted by letter.
+ * Each node also records which child leads to the most frequent word
+ * below it, so the top completion of a prefix is read off by following
+ * best_child links. Nodes may be shared by several parents (a DAWG), as
+ * long as their best_child links stay correct for each. crc32 covers every
+ * byte from header_size to total_size.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;              // WORD_DICTIONARY_MAGIC
+    uint16_t version;            // WORD_DICTIONARY_VERSION
+    uint16_t header_size;        // sizeof(word_dictionary_header_t)
+    uint32_t word_count;         // Words in the dictionary
+    uint32_t node_count;         // Nodes in the trie
+    uint32_t node_offset;        // Offset of the node array from the start of the image
+    uint32_t total_size;         // Image size in bytes
+    uint32_t crc32;              // CRC32 (little-endian) of bytes [header_size, total_size)
+} word_dictionary_header_t;
+
+/**
+ * @brief Trie node stored in the image
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t first_child;        // Index of the first child node
+    uint8_t child_count;         // Consecutive children, up to 26
+    uint8_t letter;              // Letter on the edge into this node ('A'-'Z'), 0 at the root
+    uint8_t best_child;          // Child on the way to the most frequent word, WORD_DICTIONARY_NO_CHILD if it ends here
+    uint8_t is_word;             // A word ends at this node
+} word_dictionary_node_t;
+
+/**
+ * @brief Position in the dictionary after the letters typed so far
+ */
+typedef struct {
+    uint32_t node;               // Node of the prefix
+    uint8_t length;              // Letters in the prefix
+    bool valid;                  // Prefix starts at least one word
+} word_dictionary_cursor_t;
+
+/**
+ * @brief Map the dictionary image
+ *
+ * If the partition holds no valid image, one is built from the word list
+ * at WORD_DICTIONARY_PATH (one word per line, most frequent first), or from
+ * a small built-in list when that file is missing, and written to flash.
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t word_dictionary_init(void);
+
+/**
+ * @brief Release the mapped image
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t word_dictionary_deinit(void);
+
+/**
+ * @brief Rebuild the image from the word list at WORD_DICTIONARY_PATH
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t word_dictionary_rebuild(void);
+
+/**
+ * @brief Move a cursor back to the empty prefix
+ *
+ * @param cursor Cursor to reset
+ */
+void word_dictionary_cursor_reset(word_dictionary_cursor_t *cursor);
+
+/**
+ * @brief Extend the prefix by one letter
+ *
+ * Constant time per letter and no heap use. Once the prefix leaves the
+ * dictionary the cursor stays invalid until reset.
+ *
+ * @param cursor Cursor to advance
+ * @param letter Letter typed, 'A'-'Z' (lower case is folded)
+ * @return true if the prefix still starts a word
+ */
+bool word_dictionary_cursor_step(word_dictionary_cursor_t *cursor, char letter);
+
+/**
+ * @brief Get the most frequent completion of the prefix
+ *
+ * Writes only the letters that follow the prefix, so an exact match of
+ * the top word yields an empty string.
+ *
+ * @param cursor Cursor of the prefix
+ * @param suffix Buffer to store the missing letters
+ * @param max_length Size of the buffer
+ * @return Number of letters written, 0 if there is no completion
+ */
+size_t word_dictionary_complete(const word_dictionary_cursor_t *cursor, char *suffix, size_t max_length);
+
+#endif /* OUTPUT_WORD_DICTIONARY_H */
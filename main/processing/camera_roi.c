@@ -0,0 +1,206 @@
+#include "processing/camera_roi.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "config/system_config.h"
+#include "config/memory_layout.h"
+
+static const char *TAG = "CAMERA_ROI";
+
+// ROI storage, descriptors and per-slot reference counts
+static MEM_HOT uint8_t roi_pixels[CAMERA_ROI_POOL_SIZE][CAMERA_ROI_PIXELS] __attribute__((aligned(4)));
+static camera_roi_desc_t roi_descs[CAMERA_ROI_POOL_SIZE];
+static atomic_uint_fast8_t roi_refs[CAMERA_ROI_POOL_SIZE];
+
+// Previous ROI, kept for the motion measure
+static uint8_t previous_pixels[CAMERA_ROI_PIXELS];
+static bool previous_valid = false;
+
+// Requested source window (size 0 = largest centred window)
+static uint16_t window_x = 0;
+static uint16_t window_y = 0;
+static uint16_t window_size = 0;
+
+static bool camera_roi_initialized = false;
+
+// Luma of a big-endian RGB565 pixel, (77 R + 150 G + 29 B) / 256 on 8-bit channels
+static inline uint8_t rgb565_luma(const uint8_t *p) {
+    uint16_t pixel = (uint16_t)((p[0] << 8) | p[1]);
+    uint32_t r = (pixel >> 8) & 0xF8;
+    uint32_t g = (pixel >> 3) & 0xFC;
+    uint32_t b = (pixel << 3) & 0xF8;
+    return (uint8_t)((r * 77 + g * 150 + b * 29) >> 8);
+}
+
+static esp_err_t acquire_slot(camera_roi_index_t *index) {
+    for (int slot = 0; slot < CAMERA_ROI_POOL_SIZE; slot++) {
+        uint_fast8_t expected = 0;
+        if (atomic_compare_exchange_strong(&roi_refs[slot], &expected, 1)) {
+            *index = (camera_roi_index_t)slot;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t camera_roi_init(void) {
+    memset(roi_pixels, 0, sizeof(roi_pixels));
+    for (int i = 0; i < CAMERA_ROI_POOL_SIZE; i++) {
+        atomic_init(&roi_refs[i], 0);
+    }
+    previous_valid = false;
+
+    camera_roi_initialized = true;
+    ESP_LOGI(TAG, "ROI pool initialized (%d slots of %dx%d)",
+             CAMERA_ROI_POOL_SIZE, CAMERA_ROI_SIZE, CAMERA_ROI_SIZE);
+
+    return ESP_OK;
+}
+
+void camera_roi_deinit(void) {
+    camera_roi_initialized = false;
+}
+
+esp_err_t camera_roi_set_window(uint16_t x, uint16_t y, uint16_t size) {
+    if (size != 0 && size < CAMERA_ROI_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    window_x = x;
+    window_y = y;
+    window_size = size - (size % CAMERA_ROI_SIZE);
+    previous_valid = false;
+
+    return ESP_OK;
+}
+
+esp_err_t camera_roi_extract(const camera_frame_t *frame, camera_roi_desc_t *desc) {
+    if (!camera_roi_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (frame == NULL || frame->buffer == NULL || desc == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t bytes_per_pixel;
+    if (frame->format == CAMERA_FORMAT_GRAYSCALE) {
+        bytes_per_pixel = 1;
+    } else if (frame->format == CAMERA_FORMAT_RGB565) {
+        bytes_per_pixel = 2;
+    } else {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // Resolve the source window
+    uint16_t size = window_size;
+    uint16_t x = window_x;
+    uint16_t y = window_y;
+    if (size == 0) {
+        uint16_t shorter = (frame->width < frame->height) ? frame->width : frame->height;
+        size = shorter - (shorter % CAMERA_ROI_SIZE);
+        x = (frame->width - size) / 2;
+        y = (frame->height - size) / 2;
+    }
+
+    if (size < CAMERA_ROI_SIZE || x + size > frame->width || y + size > frame->height ||
+        (uint32_t)frame->width * frame->height * bytes_per_pixel > frame->buffer_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    camera_roi_index_t index;
+    if (acquire_slot(&index) != ESP_OK) {
+        ESP_LOGW(TAG, "ROI pool exhausted");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // k x k box average per output pixel; each source row is read once
+    uint16_t k = size / CAMERA_ROI_SIZE;
+    uint32_t area = (uint32_t)k * k;
+    uint32_t stride = (uint32_t)frame->width * bytes_per_pixel;
+    uint8_t *out = roi_pixels[index];
+    uint32_t total = 0;
+    uint32_t motion = 0;
+
+    for (int oy = 0; oy < CAMERA_ROI_SIZE; oy++) {
+        uint32_t sums[CAMERA_ROI_SIZE] = {0};
+
+        for (int ry = 0; ry < k; ry++) {
+            const uint8_t *row = frame->buffer + (uint32_t)(y + oy * k + ry) * stride + (uint32_t)x * bytes_per_pixel;
+
+            if (bytes_per_pixel == 1) {
+                for (int ox = 0; ox < CAMERA_ROI_SIZE; ox++) {
+                    for (int rx = 0; rx < k; rx++) {
+                        sums[ox] += *row++;
+                    }
+                }
+            } else {
+                for (int ox = 0; ox < CAMERA_ROI_SIZE; ox++) {
+                    for (int rx = 0; rx < k; rx++) {
+                        sums[ox] += rgb565_luma(row);
+                        row += 2;
+                    }
+                }
+            }
+        }
+
+        for (int ox = 0; ox < CAMERA_ROI_SIZE; ox++) {
+            uint8_t value = (uint8_t)(sums[ox] / area);
+            int pos = oy * CAMERA_ROI_SIZE + ox;
+            out[pos] = value;
+            total += value;
+            if (previous_valid) {
+                int diff = (int)value - (int)previous_pixels[pos];
+                motion += (diff < 0) ? -diff : diff;
+            }
+        }
+    }
+
+    memcpy(previous_pixels, out, CAMERA_ROI_PIXELS);
+    previous_valid = true;
+
+    desc->roi_index = index;
+    desc->x = x;
+    desc->y = y;
+    desc->size = size;
+    desc->mean = (uint8_t)(total / CAMERA_ROI_PIXELS);
+    desc->motion = (uint8_t)(motion / CAMERA_ROI_PIXELS);
+    desc->timestamp = frame->timestamp;
+    roi_descs[index] = *desc;
+
+    return ESP_OK;
+}
+
+void camera_roi_retain(camera_roi_index_t index) {
+    if (index >= CAMERA_ROI_POOL_SIZE) {
+        return;
+    }
+    atomic_fetch_add(&roi_refs[index], 1);
+}
+
+void camera_roi_release(camera_roi_index_t index) {
+    if (index >= CAMERA_ROI_POOL_SIZE) {
+        return;
+    }
+
+    uint_fast8_t previous = atomic_fetch_sub(&roi_refs[index], 1);
+    if (previous == 0) {
+        // Unbalanced release, restore the count rather than wrapping
+        atomic_store(&roi_refs[index], 0);
+        ESP_LOGW(TAG, "Release of free ROI slot %d", index);
+    }
+}
+
+const camera_roi_desc_t* camera_roi_get_desc(camera_roi_index_t index) {
+    if (index >= CAMERA_ROI_POOL_SIZE) {
+        return NULL;
+    }
+    return &roi_descs[index];
+}
+
+const uint8_t* camera_roi_get_pixels(camera_roi_index_t index) {
+    if (index >= CAMERA_ROI_POOL_SIZE) {
+        return NULL;
+    }
+    return roi_pixels[index];
+}
@@ -0,0 +1,119 @@
+#ifndef PROCESSING_CAMERA_ROI_H
+#define PROCESSING_CAMERA_ROI_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "config/system_config.h"
+#include "drivers/camera.h"
+
+#define CAMERA_ROI_SIZE         (32)
+#define CAMERA_ROI_PIXELS       (CAMERA_ROI_SIZE * CAMERA_ROI_SIZE)
+#define CAMERA_ROI_INVALID      (0xFF)
+
+/**
+ * @brief Index of an ROI slot in the ROI pool
+ */
+typedef uint8_t camera_roi_index_t;
+
+/**
+ * @brief Compact descriptor of a hand ROI
+ *
+ * Handed from the camera task to the sensor task and kept in the pool
+ * next to the pixels; sensor frames carry only roi_index and hold one
+ * reference on the slot.
+ */
+typedef struct {
+    camera_roi_index_t roi_index;  // Slot holding the 32x32 grayscale pixels
+    uint16_t x;                    // Left edge of the source window in pixels
+    uint16_t y;                    // Top edge of the source window in pixels
+    uint16_t size;                 // Side of the square source window in pixels
+    uint8_t mean;                  // Mean ROI intensity (0-255)
+    uint8_t motion;                // Mean absolute change from the previous ROI (0-255)
+    uint32_t timestamp;            // Acquisition timestamp (ms)
+} camera_roi_desc_t;
+
+#if GLOVE_HAS_CAMERA
+
+/**
+ * @brief Initialize the ROI pool
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t camera_roi_init(void);
+
+/**
+ * @brief Deinitialize the ROI pool
+ */
+void camera_roi_deinit(void);
+
+/**
+ * @brief Set the source window used for the ROI
+ *
+ * The size is rounded down to a multiple of CAMERA_ROI_SIZE so the
+ * downsampling is an integer box filter.
+ *
+ * @param x Left edge in pixels
+ * @param y Top edge in pixels
+ * @param size Side of the square window, or 0 for the largest centred window
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t camera_roi_set_window(uint16_t x, uint16_t y, uint16_t size);
+
+/**
+ * @brief Downsample the hand ROI of a frame into a new pool slot
+ *
+ * Grayscale and RGB565 frames are supported. The frame buffer is only
+ * read during the call and can be returned to the driver right after.
+ *
+ * @param frame Source frame
+ * @param desc Descriptor of the new ROI; the caller owns one reference
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the pool is exhausted
+ */
+esp_err_t camera_roi_extract(const camera_frame_t *frame, camera_roi_desc_t *desc);
+
+/**
+ * @brief Add a reference to an ROI slot
+ *
+ * @param index Slot index
+ */
+void camera_roi_retain(camera_roi_index_t index);
+
+/**
+ * @brief Drop a reference to an ROI slot
+ *
+ * @param index Slot index
+ */
+void camera_roi_release(camera_roi_index_t index);
+
+/**
+ * @brief Get the descriptor of an ROI slot
+ *
+ * Valid while the caller holds a reference on the slot.
+ *
+ * @param index Slot index
+ * @return Descriptor written when the ROI was extracted, or NULL
+ */
+const camera_roi_desc_t* camera_roi_get_desc(camera_roi_index_t index);
+
+/**
+ * @brief Get the pixels of an ROI slot
+ *
+ * @param index Slot index
+ * @return CAMERA_ROI_SIZE x CAMERA_ROI_SIZE grayscale pixels, row-major, or NULL
+ */
+const uint8_t* camera_roi_get_pixels(camera_roi_index_t index);
+
+#else
+
+/* No camera in this build: frames never hold an ROI, and the reference
+ * handling in the pipeline compiles to nothing */
+static inline void camera_roi_retain(camera_roi_index_t index) { (void)index; }
+static inline void camera_roi_release(camera_roi_index_t index) { (void)index; }
+static inline const camera_roi_desc_t* camera_roi_get_desc(camera_roi_index_t index) { (void)index; return NULL; }
+static inline const uint8_t* camera_roi_get_pixels(camera_roi_index_t index) { (void)index; return NULL; }
+
+#endif /* GLOVE_HAS_CAMERA */
+
+#endif /* PROCESSING_CAMERA_ROI_H */
@@ -0,0 +1,210 @@
+#include "processing/dtw_matcher.h"
+#include <string.h>
+#include <float.h>
+#include "esp_log.h"
+
+static const char *TAG = "DTW_MATCH";
+
+// Query and its LB_Keogh envelope, set once per match
+static float query[DTW_MAX_LENGTH * DTW_MAX_CHANNELS] __attribute__((aligned(16)));
+static float upper[DTW_MAX_LENGTH * DTW_MAX_CHANNELS] __attribute__((aligned(16)));
+static float lower[DTW_MAX_LENGTH * DTW_MAX_CHANNELS] __attribute__((aligned(16)));
+static uint16_t query_length = 0;
+static uint16_t query_channels = 0;
+static uint16_t query_band = 0;
+
+// Per-candidate scratch: lower bound of each step and its suffix sums
+static float bound_suffix[DTW_MAX_LENGTH + 1];
+
+// Two cost rows are enough for the DTW recurrence
+static float cost_rows[2][DTW_MAX_LENGTH];
+
+static inline float step_distance(const float *a, const float *b, uint16_t channels) {
+    float sum = 0.0f;
+    for (uint16_t k = 0; k < channels; k++) {
+        float d = a[k] - b[k];
+        sum += d * d;
+    }
+    return sum;
+}
+
+// LB_Keogh: every candidate step is matched to some query step within the
+// band, so it costs at least its distance to the query envelope. Stops as
+// soon as the bound reaches best_so_far; otherwise leaves the suffix sums
+// used for early abandoning in bound_suffix.
+static float lower_bound(const float *candidate, float best_so_far) {
+    const uint16_t length = query_length;
+    const uint16_t channels = query_channels;
+    float total = 0.0f;
+
+    for (uint16_t j = 0; j < length; j++) {
+        const float *c = &candidate[j * channels];
+        const float *u = &upper[j * channels];
+        const float *l = &lower[j * channels];
+        float step = 0.0f;
+
+        for (uint16_t k = 0; k < channels; k++) {
+            if (c[k] > u[k]) {
+                float d = c[k] - u[k];
+                step += d * d;
+            } else if (c[k] < l[k]) {
+                float d = l[k] - c[k];
+                step += d * d;
+            }
+        }
+
+        bound_suffix[j] = step;
+        total += step;
+        if (total >= best_so_far) {
+            return total;
+        }
+    }
+
+    bound_suffix[length] = 0.0f;
+    for (int j = length - 1; j >= 0; j--) {
+        bound_suffix[j] += bound_suffix[j + 1];
+    }
+
+    return total;
+}
+
+// Banded DTW, abandoned once the cheapest partial path plus the lower bound
+// of the candidate steps no path has reached yet cannot beat best_so_far
+static float banded_dtw(const float *candidate, float best_so_far) {
+    const uint16_t length = query_length;
+    const uint16_t channels = query_channels;
+    const uint16_t band = query_band;
+    float *prev = cost_rows[0];
+    float *curr = cost_rows[1];
+
+    for (uint16_t j = 0; j < length; j++) {
+        prev[j] = FLT_MAX;
+    }
+
+    for (uint16_t i = 0; i < length; i++) {
+        uint16_t j_start = (i > band) ? i - band : 0;
+        uint16_t j_end = (i + band < length - 1) ? i + band : length - 1;
+        const float *q = &query[i * channels];
+        float row_min = FLT_MAX;
+
+        // Cells just outside the band are read by the next row
+        if (j_start > 0) {
+            curr[j_start - 1] = FLT_MAX;
+        }
+        if (j_end + 1 < length) {
+            curr[j_end + 1] = FLT_MAX;
+        }
+
+        for (uint16_t j = j_start; j <= j_end; j++) {
+            float best_prev;
+            if (i == 0 && j == 0) {
+                best_prev = 0.0f;
+            } else {
+                best_prev = prev[j];                                  // Query advances
+                if (j > 0) {
+                    if (curr[j - 1] < best_prev) best_prev = curr[j - 1];  // Candidate advances
+                    if (prev[j - 1] < best_prev) best_prev = prev[j - 1];  // Both advance
+                }
+            }
+
+            float cost = (best_prev < FLT_MAX)
+                ? best_prev + step_distance(q, &candidate[j * channels], channels)
+                : FLT_MAX;
+            curr[j] = cost;
+            if (cost < row_min) {
+                row_min = cost;
+            }
+        }
+
+        uint16_t next_unreached = j_end + 1;
+        float remaining = (next_unreached < length) ? bound_suffix[next_unreached] : 0.0f;
+        if (row_min + remaining >= best_so_far) {
+            return FLT_MAX;
+        }
+
+        float *swap = prev;
+        prev = curr;
+        curr = swap;
+    }
+
+    return prev[length - 1];
+}
+
+esp_err_t dtw_matcher_set_query(const float *sequence, uint16_t length, uint16_t channels, uint16_t band) {
+    if (sequence == NULL || length < 2 || length > DTW_MAX_LENGTH ||
+        channels == 0 || channels > DTW_MAX_CHANNELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (band >= length) {
+        band = length - 1;
+    }
+
+    memcpy(query, sequence, length * channels * sizeof(float));
+    query_length = length;
+    query_channels = channels;
+    query_band = band;
+
+    // Envelope: min and max of each channel over the band around every step
+    for (uint16_t i = 0; i < length; i++) {
+        uint16_t k_start = (i > band) ? i - band : 0;
+        uint16_t k_end = (i + band < length - 1) ? i + band : length - 1;
+
+        for (uint16_t c = 0; c < channels; c++) {
+            float hi = query[k_start * channels + c];
+            float lo = hi;
+            for (uint16_t k = k_start + 1; k <= k_end; k++) {
+                float v = query[k * channels + c];
+                if (v > hi) hi = v;
+                if (v < lo) lo = v;
+            }
+            upper[i * channels + c] = hi;
+            lower[i * channels + c] = lo;
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t dtw_matcher_match(const float *const *candidates, uint16_t count, dtw_match_t *match) {
+    if (candidates == NULL || match == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (query_length == 0) {
+        ESP_LOGW(TAG, "No query set");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(match, 0, sizeof(dtw_match_t));
+    match->index = -1;
+
+    float best = FLT_MAX;
+
+    for (uint16_t t = 0; t < count; t++) {
+        if (candidates[t] == NULL) {
+            continue;
+        }
+
+        if (lower_bound(candidates[t], best) >= best) {
+            match->pruned++;
+            continue;
+        }
+
+        float cost = banded_dtw(candidates[t], best);
+        if (cost >= best) {
+            match->abandoned++;
+            continue;
+        }
+
+        best = cost;
+        match->index = t;
+    }
+
+    if (match->index >= 0) {
+        match->distance = best / (float)(query_length * query_channels);
+        match->score = 1.0f / (1.0f + match->distance);
+    }
+
+    return ESP_OK;
+}
@@ -0,0 +1,51 @@
+#ifndef PROCESSING_DTW_MATCHER_H
+#define PROCESSING_DTW_MATCHER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Largest sequences the preallocated buffers hold
+#define DTW_MAX_LENGTH      (64)
+#define DTW_MAX_CHANNELS    (16)
+
+/**
+ * @brief Result of matching the query against a list of candidates
+ */
+typedef struct {
+    int16_t index;          // Best candidate, -1 if none
+    float distance;         // DTW cost of the best candidate per step and channel
+    float score;            // 1 / (1 + distance), in (0, 1]
+    uint16_t pruned;        // Candidates skipped by the LB_Keogh lower bound
+    uint16_t abandoned;     // Candidates abandoned part-way through DTW
+} dtw_match_t;
+
+/**
+ * @brief Set the query sequence that candidates are matched against
+ *
+ * The query is copied and its LB_Keogh envelope computed once here, so
+ * each candidate costs only its lower bound and, if it survives, a banded
+ * DTW pass over preallocated cost rows.
+ *
+ * @param query Time-major sequence, length steps of channels values, already scaled
+ * @param length Number of steps (2..DTW_MAX_LENGTH)
+ * @param channels Values per step (1..DTW_MAX_CHANNELS)
+ * @param band Sakoe-Chiba band radius in steps
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t dtw_matcher_set_query(const float *query, uint16_t length, uint16_t channels, uint16_t band);
+
+/**
+ * @brief Find the candidate with the lowest DTW distance to the query
+ *
+ * Candidates are sequences of the query's shape. A candidate whose lower
+ * bound already reaches the best distance so far is skipped, and DTW is
+ * abandoned as soon as no warping path can beat it. Not reentrant.
+ *
+ * @param candidates Candidate sequences, NULL entries are skipped
+ * @param count Number of candidates
+ * @param match Output match result
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t dtw_matcher_match(const float *const *candidates, uint16_t count, dtw_match_t *match);
+
+#endif /* PROCESSING_DTW_MATCHER_H */
@@ -1,14 +1,23 @@
 #include "processing/feature_extraction.h"
 #include <string.h>
 #include "esp_log.h"
-#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "drivers/flex_sensor.h"
+#include "drivers/imu.h"
+#include "processing/feature_layout.h"
+#if FEATURE_SET_SECOND_HAND
+#include "communication/hand_link.h"
+#endif
 #include "util/buffer.h"
+#include "util/history_window.h"
 #include "util/debug.h"
 #include "math.h"
 
 static const char *TAG = "FEATURE_EXTRACT";
 
+// Number of history samples used by the short-term temporal features
+#define TEMPORAL_WINDOW_SAMPLES  (5)
+
 // Feature extraction state
 static bool feature_extraction_initialized = false;
 
@@ -27,128 +36,147 @@ esp_err_t feature_extraction_deinit(void) {
 }
 
 esp_err_t feature_extraction_process(sensor_data_t *sensor_data, 
-                                    sensor_data_buffer_t *data_buffer, 
+                                    const history_window_t *history, 
+                                    const window_stats_t *stats,
                                     feature_vector_t *feature_vector) {
     if (!feature_extraction_initialized || sensor_data == NULL || 
-        data_buffer == NULL || feature_vector == NULL) {
+        history == NULL || stats == NULL || feature_vector == NULL) {
         return ESP_ERR_INVALID_STATE;
     }
     
     // Reset feature vector
     memset(feature_vector, 0, sizeof(feature_vector_t));
     
-    // Set timestamp
-    feature_vector->timestamp = esp_timer_get_time() / 1000;
+    // Sample time of the frame, so later stages can measure latency from the hand
+    feature_vector->timestamp = sensor_data->timestamp;
+    
+    float *features = feature_vector->features;
     
     // Extract features from flex sensor data
     if (sensor_data->flex_data_valid) {
         // Direct features: finger joint angles
         for (int i = 0; i < FINGER_JOINT_COUNT; i++) {
             // Each joint angle is a feature
-            feature_vector->features[i] = sensor_data->flex_data.angles[i];
+            features[FEATURE_OFFSET_JOINT_ANGLE + i] = sensor_data->flex_data.angles[i];
         }
         
         // Derived features: angle differences between adjacent fingers
         for (int i = 0; i < 4; i++) {  // 4 pairs of adjacent fingers
             // MCP joints
-            feature_vector->features[10 + i] = fabsf(sensor_data->flex_data.angles[i*2] - 
-                                                  sensor_data->flex_data.angles[(i+1)*2]);
+            features[FEATURE_OFFSET_MCP_SPREAD + i] = fabsf(sensor_data->flex_data.angles[i*2] - 
+                                                            sensor_data->flex_data.angles[(i+1)*2]);
             // PIP joints
-            feature_vector->features[14 + i] = fabsf(sensor_data->flex_data.angles[i*2+1] - 
-                                                  sensor_data->flex_data.angles[(i+1)*2+1]);
+            features[FEATURE_OFFSET_PIP_SPREAD + i] = fabsf(sensor_data->flex_data.angles[i*2+1] - 
+                                                            sensor_data->flex_data.angles[(i+1)*2+1]);
         }
         
         // Feature count update
-        feature_vector->feature_count = 18;  // 10 joint angles + 8 difference features
+        feature_vector->feature_count = FEATURE_END_PIP_SPREAD;
     }
     
     // Extract features from IMU data
     if (sensor_data->imu_data_valid) {
-        // Hand orientation features
-        feature_vector->features[18] = sensor_data->imu_data.orientation[0];  // Roll
-        feature_vector->features[19] = sensor_data->imu_data.orientation[1];  // Pitch
-        feature_vector->features[20] = sensor_data->imu_data.orientation[2];  // Yaw
+        // Hand orientation features (roll, pitch, yaw), converted from the quaternion once per frame
+        imu_get_euler(&sensor_data->imu_data, &features[FEATURE_OFFSET_ORIENTATION]);
         
-        // Hand acceleration features
-        feature_vector->features[21] = sensor_data->imu_data.accel[0];  // X acceleration
-        feature_vector->features[22] = sensor_data->imu_data.accel[1];  // Y acceleration
-        feature_vector->features[23] = sensor_data->imu_data.accel[2];  // Z acceleration
-        
-        // Angular velocity features
-        feature_vector->features[24] = sensor_data->imu_data.gyro[0];  // X angular velocity
-        feature_vector->features[25] = sensor_data->imu_data.gyro[1];  // Y angular velocity
-        feature_vector->features[26] = sensor_data->imu_data.gyro[2];  // Z angular velocity
+        for (int axis = 0; axis < 3; axis++) {
+            features[FEATURE_OFFSET_ACCEL + axis] = sensor_data->imu_data.accel[axis];  // Hand acceleration
+            features[FEATURE_OFFSET_GYRO + axis] = sensor_data->imu_data.gyro[axis];    // Angular velocity
+        }
         
         // Feature count update
-        feature_vector->feature_count = 27;
+        feature_vector->feature_count = FEATURE_END_GYRO;
     }
     
+#if FEATURE_SET_TOUCH
     // Extract features from touch sensor data
     if (sensor_data->touch_data_valid) {
         // Touch status as features (binary)
         for (int i = 0; i < TOUCH_SENSOR_COUNT; i++) {
-            feature_vector->features[27 + i] = sensor_data->touch_data.touch_status[i] ? 1.0f : 0.0f;
+            features[FEATURE_OFFSET_TOUCH + i] = sensor_data->touch_data.touch_status[i] ? 1.0f : 0.0f;
         }
         
         // Feature count update
-        feature_vector->feature_count = 32;
+        feature_vector->feature_count = FEATURE_END_TOUCH;
     }
+#endif
     
+#if FEATURE_SET_SECOND_HAND
+    // The other glove's instantaneous features, resampled to this frame's time
+    if (hand_link_get_features(sensor_data->timestamp, &features[FEATURE_OFFSET_SECOND_HAND]) == ESP_OK) {
+        feature_vector->two_hand = true;
+        feature_vector->feature_count = FEATURE_END_SECOND_HAND;
+    }
+#endif
+    
+#if FEATURE_SET_TEMPORAL
     // Temporal features (if we have enough historical data)
-    if (buffer_get_size(data_buffer) >= 5) {
-        // Extract motion trajectories from buffer
-        // This is a simplified version; a real implementation would do more complex analysis
+    if (history_window_get_count(history) >= TEMPORAL_WINDOW_SAMPLES) {
+        const uint32_t *timestamps = history_window_timestamps(history, TEMPORAL_WINDOW_SAMPLES);
+        float window_sec = (timestamps[TEMPORAL_WINDOW_SAMPLES - 1] - timestamps[0]) / 1000.0f;
         
-        // Get past samples for temporal analysis
-        sensor_data_t past_data[5];
-        for (int i = 0; i < 5; i++) {
-            sensor_data_t temp_data;
-            if (i == 0) {
-                // Current data is first
-                memcpy(&past_data[0], sensor_data, sizeof(sensor_data_t));
-            } else {
-                // Get older samples from buffer (if available)
-                if (buffer_get_size(data_buffer) > i) {
-                    // This is a simplification; in practice, you'd need to access
-                    // specific items in the buffer based on their index
-                    // For now, we're just reusing the current data
-                    memcpy(&past_data[i], sensor_data, sizeof(sensor_data_t));
-                } else {
-                    // Not enough historical data
-                    break;
-                }
+        if (sensor_data->imu_data_valid) {
+            // Average acceleration over the statistics window
+            for (int axis = 0; axis < 3; axis++) {
+                features[FEATURE_OFFSET_MEAN_ACCEL + axis] = window_stats_mean(stats, HISTORY_CH_ACCEL_X + axis);
             }
+            
+            // Feature count update
+            feature_vector->feature_count = FEATURE_END_MEAN_ACCEL;
         }
         
-        // Calculate motion velocity features (simplified)
-        // For a real implementation, you'd compute these from the actual historical data
-        if (sensor_data->imu_data_valid) {
-            // Example: Compute average acceleration over last few samples
-            float avg_accel_x = 0.0f;
-            float avg_accel_y = 0.0f;
-            float avg_accel_z = 0.0f;
-            
-            for (int i = 0; i < 5; i++) {
-                if (past_data[i].imu_data_valid) {
-                    avg_accel_x += past_data[i].imu_data.accel[0];
-                    avg_accel_y += past_data[i].imu_data.accel[1];
-                    avg_accel_z += past_data[i].imu_data.accel[2];
-                }
+        if (sensor_data->flex_data_valid && window_sec > 0.0f) {
+            // Joint angular velocity (degrees/s) across the window
+            for (int i = 0; i < FINGER_JOINT_COUNT; i++) {
+                const float *angles = history_window_channel(history, HISTORY_CH_FLEX_0 + i, 
+                                                             TEMPORAL_WINDOW_SAMPLES);
+                features[FEATURE_OFFSET_JOINT_VELOCITY + i] = (angles[TEMPORAL_WINDOW_SAMPLES - 1] - angles[0]) / window_sec;
             }
             
-            avg_accel_x /= 5.0f;
-            avg_accel_y /= 5.0f;
-            avg_accel_z /= 5.0f;
-            
-            // Store as features
-            feature_vector->features[32] = avg_accel_x;
-            feature_vector->features[33] = avg_accel_y;
-            feature_vector->features[34] = avg_accel_z;
-            
             // Feature count update
-            feature_vector->feature_count = 35;
+            feature_vector->feature_count = FEATURE_END_JOINT_VELOCITY;
         }
     }
+#endif
+    
+#if FEATURE_SET_AHRS
+    // Gravity and motion split from the AHRS
+    if (sensor_data->imu_data_valid) {
+        for (int axis = 0; axis < 3; axis++) {
+            features[FEATURE_OFFSET_GRAVITY + axis] = sensor_data->imu_data.gravity[axis];            // Tilt
+            features[FEATURE_OFFSET_LINEAR_ACCEL + axis] = sensor_data->imu_data.linear_accel[axis];  // Motion
+        }
+        
+        // Feature count update
+        feature_vector->feature_count = FEATURE_END_LINEAR_ACCEL;
+    }
+#endif
+    
+#if FEATURE_SET_WINDOW_STATS
+    // Window statistics, read from the running sums
+    if (window_stats_get_count(stats) >= TEMPORAL_WINDOW_SAMPLES && 
+        sensor_data->flex_data_valid && sensor_data->imu_data_valid) {
+        for (int i = 0; i < FINGER_JOINT_COUNT; i++) {
+            history_channel_t ch = HISTORY_CH_FLEX_0 + i;
+            features[FEATURE_OFFSET_JOINT_VARIANCE + i] = window_stats_variance(stats, ch);   // Joint steadiness
+            features[FEATURE_OFFSET_JOINT_RANGE + i] = window_stats_max(stats, ch, history) - 
+                                                       window_stats_min(stats, ch, history);  // Joint range
+            features[FEATURE_OFFSET_JOINT_JITTER + i] = window_stats_diff_energy(stats, ch);  // Joint jitter
+        }
+        
+        for (int axis = 0; axis < 3; axis++) {
+            history_channel_t linear = HISTORY_CH_LINEAR_ACCEL_X + axis;
+            history_channel_t gyro = HISTORY_CH_GYRO_X + axis;
+            features[FEATURE_OFFSET_LINEAR_VARIANCE + axis] = window_stats_variance(stats, linear);
+            features[FEATURE_OFFSET_GYRO_VARIANCE + axis] = window_stats_variance(stats, gyro);
+            features[FEATURE_OFFSET_LINEAR_JITTER + axis] = window_stats_diff_energy(stats, linear);
+            features[FEATURE_OFFSET_GYRO_JITTER + axis] = window_stats_diff_energy(stats, gyro);
+        }
+        
+        // Feature count update
+        feature_vector->feature_count = FEATURE_END_GYRO_JITTER;
+    }
+#endif
     
     // In a complete implementation, you'd also extract features from camera data
     // and perform more sophisticated temporal analysis
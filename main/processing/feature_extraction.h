@@ -3,6 +3,8 @@
 
 #include "esp_err.h"
 #include "util/buffer.h"
+#include "util/history_window.h"
+#include "util/window_stats.h"
 
 /**
  * @brief Initialize feature extraction module
@@ -21,13 +23,19 @@ esp_err_t feature_extraction_deinit(void);
 /**
  * @brief Extract features from sensor data
  * 
+ * Window features (mean, variance, range and first-difference energy over
+ * the last WINDOW_STATS_LENGTH samples) come from the running statistics,
+ * so their cost does not depend on the window length.
+ * 
  * @param sensor_data Current sensor data
- * @param data_buffer Buffer containing historical sensor data
+ * @param history History window, already containing the current sample
+ * @param stats Window statistics, already updated with the current sample
  * @param feature_vector Output feature vector
  * @return ESP_OK on success, error code otherwise
  */
 esp_err_t feature_extraction_process(sensor_data_t *sensor_data, 
-                                   sensor_data_buffer_t *data_buffer, 
+                                   const history_window_t *history, 
+                                   const window_stats_t *stats,
                                    feature_vector_t *feature_vector);
 
 #endif /* PROCESSING_FEATURE_EXTRACTION_H */
\ No newline at end of file
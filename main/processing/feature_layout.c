@@ -0,0 +1,51 @@
+#include "processing/feature_layout.h"
+#include <stddef.h>
+
+// The layout table, generated from the same rows as the offsets
+#define FEATURE_LAYOUT_ROW(id, count_, enabled, scale_, center_)   \
+    [FEATURE_GROUP_##id] = {                                        \
+        .name = #id,                                                \
+        .offset = FEATURE_OFFSET_##id,                              \
+        .count = FEATURE_END_##id - FEATURE_OFFSET_##id,            \
+        .scale = (scale_),                                          \
+        .center = (center_),                                        \
+    },
+static const feature_group_info_t groups[FEATURE_GROUP_COUNT] = {
+    FEATURE_GROUPS(FEATURE_LAYOUT_ROW)
+};
+#undef FEATURE_LAYOUT_ROW
+
+// Group holding a feature index; groups are in vector order and disabled
+// ones are empty, so the first group ending past the index holds it
+static const feature_group_info_t* group_of(uint16_t feature) {
+    for (int i = 0; i < FEATURE_GROUP_COUNT; i++) {
+        if (feature < groups[i].offset + groups[i].count) {
+            return &groups[i];
+        }
+    }
+    return NULL;
+}
+
+const feature_group_info_t* feature_layout_group(feature_group_t group) {
+    return (group < FEATURE_GROUP_COUNT) ? &groups[group] : NULL;
+}
+
+float feature_layout_scale(uint16_t feature) {
+#if FEATURE_SET_SECOND_HAND
+    if (feature >= FEATURE_OFFSET_SECOND_HAND && feature < FEATURE_END_SECOND_HAND) {
+        return feature_layout_scale(feature - FEATURE_OFFSET_SECOND_HAND);
+    }
+#endif
+    const feature_group_info_t *group = group_of(feature);
+    return (group != NULL) ? group->scale : 1.0f;
+}
+
+float feature_layout_offset(uint16_t feature) {
+#if FEATURE_SET_SECOND_HAND
+    if (feature >= FEATURE_OFFSET_SECOND_HAND && feature < FEATURE_END_SECOND_HAND) {
+        return feature_layout_offset(feature - FEATURE_OFFSET_SECOND_HAND);
+    }
+#endif
+    const feature_group_info_t *group = group_of(feature);
+    return (group != NULL) ? group->center : 0.0f;
+}
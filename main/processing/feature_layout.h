@@ -0,0 +1,116 @@
+#ifndef PROCESSING_FEATURE_LAYOUT_H
+#define PROCESSING_FEATURE_LAYOUT_H
+
+#include <stdint.h>
+#include "config/system_config.h"
+#include "drivers/flex_sensor.h"
+#include "drivers/touch.h"
+
+/**
+ * @brief Feature vector layout of this build
+ *
+ * One row per feature group, in vector order:
+ *   X(name, count, enabled, scale, offset)
+ *
+ * Groups disabled in menuconfig take no room, so the groups after them
+ * move down and the vector is as short as the build allows. Scale is the
+ * typical spread of a feature, so one unit of scaled distance means about
+ * the same amount of mismatch whatever the feature measures; offset is
+ * the middle of its usual range, so normalized values stay well inside
+ * the Q15 range.
+ *
+ * SECOND_HAND repeats the groups up to TOUCH for the other glove of a
+ * two-hand pair; each of its features takes the scale and offset of the
+ * matching feature of the wearer's hand, not the row's.
+ */
+#define FEATURE_GROUPS(X)                                                               \
+    X(JOINT_ANGLE,       FINGER_JOINT_COUNT, 1,                        20.0f,  45.0f)  \
+    X(MCP_SPREAD,        4,                  1,                        20.0f,  20.0f)  \
+    X(PIP_SPREAD,        4,                  1,                        20.0f,  20.0f)  \
+    X(ORIENTATION,       3,                  1,                        30.0f,  0.0f)   \
+    X(ACCEL,             3,                  1,                        4.0f,   0.0f)   \
+    X(GYRO,              3,                  1,                        100.0f, 0.0f)   \
+    X(TOUCH,             TOUCH_SENSOR_COUNT, FEATURE_SET_TOUCH,        1.0f,   0.5f)   \
+    X(SECOND_HAND,       FEATURE_END_TOUCH,  FEATURE_SET_SECOND_HAND,  1.0f,   0.0f)   \
+    X(MEAN_ACCEL,        3,                  FEATURE_SET_TEMPORAL,     4.0f,   0.0f)   \
+    X(JOINT_VELOCITY,    FINGER_JOINT_COUNT, FEATURE_SET_TEMPORAL,     200.0f, 0.0f)   \
+    X(GRAVITY,           3,                  FEATURE_SET_AHRS,         4.0f,   0.0f)   \
+    X(LINEAR_ACCEL,      3,                  FEATURE_SET_AHRS,         4.0f,   0.0f)   \
+    X(JOINT_VARIANCE,    FINGER_JOINT_COUNT, FEATURE_SET_WINDOW_STATS, 4.0f,   0.0f)   \
+    X(JOINT_RANGE,       FINGER_JOINT_COUNT, FEATURE_SET_WINDOW_STATS, 4.0f,   0.0f)   \
+    X(LINEAR_VARIANCE,   3,                  FEATURE_SET_WINDOW_STATS, 4.0f,   0.0f)   \
+    X(GYRO_VARIANCE,     3,                  FEATURE_SET_WINDOW_STATS, 4.0f,   0.0f)   \
+    X(JOINT_JITTER,      FINGER_JOINT_COUNT, FEATURE_SET_WINDOW_STATS, 4.0f,   0.0f)   \
+    X(LINEAR_JITTER,     3,                  FEATURE_SET_WINDOW_STATS, 4.0f,   0.0f)   \
+    X(GYRO_JITTER,       3,                  FEATURE_SET_WINDOW_STATS, 4.0f,   0.0f)
+
+/**
+ * @brief First index of each group (FEATURE_OFFSET_<name>) and the index
+ * just past it (FEATURE_END_<name>)
+ *
+ * A disabled group has FEATURE_OFFSET_<name> == FEATURE_END_<name>.
+ */
+#define FEATURE_LAYOUT_ENUM(name, count, enabled, scale, offset)               \
+    FEATURE_OFFSET_##name,                                                      \
+    FEATURE_END_##name = FEATURE_OFFSET_##name + ((enabled) ? (count) : 0),     \
+    FEATURE_LAST_##name = FEATURE_END_##name - 1,
+enum {
+    FEATURE_GROUPS(FEATURE_LAYOUT_ENUM)
+    FEATURE_LAYOUT_SIZE             // Features in a complete vector
+};
+#undef FEATURE_LAYOUT_ENUM
+
+/**
+ * @brief Feature groups, for walking the table
+ */
+#define FEATURE_LAYOUT_GROUP_ID(name, count, enabled, scale, offset) FEATURE_GROUP_##name,
+typedef enum {
+    FEATURE_GROUPS(FEATURE_LAYOUT_GROUP_ID)
+    FEATURE_GROUP_COUNT
+} feature_group_t;
+#undef FEATURE_LAYOUT_GROUP_ID
+
+_Static_assert(FEATURE_LAYOUT_SIZE <= FEATURE_BUFFER_SIZE, "Feature layout does not fit FEATURE_BUFFER_SIZE");
+
+// Instantaneous features of one hand: flex, IMU and touch
+#define GESTURE_HAND_FEATURES       (FEATURE_END_TOUCH)
+
+// Templates hold the instantaneous features of every hand of the build
+#define GESTURE_TEMPLATE_FEATURES   (FEATURE_END_SECOND_HAND)
+
+/**
+ * @brief One group of the layout
+ */
+typedef struct {
+    const char *name;
+    uint8_t offset;         // First feature index
+    uint8_t count;          // 0 if disabled in this build
+    float scale;            // Typical spread of the group's features
+    float center;           // Middle of their usual range
+} feature_group_info_t;
+
+/**
+ * @brief Get a group of the layout
+ *
+ * @param group Group
+ * @return Group description, or NULL
+ */
+const feature_group_info_t* feature_layout_group(feature_group_t group);
+
+/**
+ * @brief Get the default normalization scale of a feature
+ *
+ * @param feature Feature index
+ * @return Scale, 1 for an index past the layout
+ */
+float feature_layout_scale(uint16_t feature);
+
+/**
+ * @brief Get the default normalization offset of a feature
+ *
+ * @param feature Feature index
+ * @return Offset, 0 for an index past the layout
+ */
+float feature_layout_offset(uint16_t feature);
+
+#endif /* PROCESSING_FEATURE_LAYOUT_H */
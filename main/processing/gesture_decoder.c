@@ -0,0 +1,325 @@
+#include "processing/gesture_decoder.h"
+#include <string.h>
+#include <math.h>
+#include "esp_log.h"
+#include "core/telemetry.h"
+
+static const char *TAG = "GESTURE_DECODER";
+
+#define DECODER_STATES   (MAX_GESTURE_TEMPLATES + 1)   // Rest plus one state per template
+#define DECODER_SEGMENTS (4 * DECODER_STATES)
+#define REST_STATE       (0)
+#define REST_LABEL       (-1)
+#define NO_SEGMENT       (0xFFFF)
+
+/**
+ * One segment of a surviving path. Paths share their common past, so the
+ * segments form a tree; a segment is freed once no state's path runs
+ * through it, and the root is decided once every path agrees on it.
+ */
+typedef struct {
+    int16_t label;               // Template index, REST_LABEL for rest
+    uint16_t parent;             // Previous segment on the path, NO_SEGMENT at the root
+    uint16_t children;           // Live segments following this one
+    bool held;                   // Current segment of a state
+    bool emitted;
+    uint16_t frames;
+    uint32_t start_ms;
+    uint32_t end_ms;
+    float score_sum;
+    float evidence;              // Emissions collected, in log-odds against rest
+} segment_t;
+
+static segment_t segments[DECODER_SEGMENTS];
+static uint16_t free_segments[DECODER_SEGMENTS];
+static uint16_t free_count = 0;
+static uint16_t root = NO_SEGMENT;
+
+// Viterbi state: best path score and current segment of each state
+static float delta[DECODER_STATES];
+static uint16_t current[DECODER_STATES];
+static uint16_t predecessor[DECODER_STATES];
+static uint16_t state_count = 0;
+
+// Decided segments waiting to be taken
+static gesture_decoder_event_t events[GESTURE_DECODER_EVENTS];
+static uint8_t event_head = 0;
+static uint8_t event_count = 0;
+
+static uint16_t alloc_segment(int16_t label, uint16_t parent, uint32_t now_ms) {
+    if (free_count == 0) {
+        return NO_SEGMENT;
+    }
+
+    uint16_t id = free_segments[--free_count];
+    segment_t *seg = &segments[id];
+    memset(seg, 0, sizeof(*seg));
+    seg->label = label;
+    seg->parent = parent;
+    seg->held = true;
+    seg->start_ms = now_ms;
+    seg->end_ms = now_ms;
+
+    if (parent != NO_SEGMENT) {
+        segments[parent].children++;
+    }
+    return id;
+}
+
+// Free a segment nobody continues, and any ancestors left without followers
+static void release_segment(uint16_t id) {
+    while (id != NO_SEGMENT && !segments[id].held && segments[id].children == 0) {
+        uint16_t parent = segments[id].parent;
+        free_segments[free_count++] = id;
+        if (parent != NO_SEGMENT) {
+            segments[parent].children--;
+        }
+        id = parent;
+    }
+}
+
+static void queue_event(const segment_t *seg) {
+    if (event_count >= GESTURE_DECODER_EVENTS) {
+        telemetry_count_drop(TELEMETRY_DROP_DECODER_SEGMENT);
+        ESP_LOGW(TAG, "Event queue full, segment dropped");
+        return;
+    }
+
+    gesture_decoder_event_t *event = &events[(event_head + event_count) % GESTURE_DECODER_EVENTS];
+    event->template_index = seg->label;
+    event->confidence = (seg->frames > 0) ? seg->score_sum / seg->frames : 0.0f;
+    event->start_ms = seg->start_ms;
+    event->duration_ms = seg->end_ms - seg->start_ms;
+    event_count++;
+}
+
+// Settle a root the paths keep disagreeing about: keep the branch of the
+// best path and drop the states that follow any other, which then re-enter
+// from the others on the next frame
+static void force_decision(void) {
+    uint16_t best_state = REST_STATE;
+    for (uint16_t j = 1; j < state_count; j++) {
+        if (delta[j] > delta[best_state]) {
+            best_state = j;
+        }
+    }
+
+    // Branch below the root that the best path takes
+    uint16_t keep = current[best_state];
+    while (keep != root && segments[keep].parent != root) {
+        keep = segments[keep].parent;
+    }
+
+    for (uint16_t j = 0; j < state_count; j++) {
+        uint16_t branch = current[j];
+        while (branch != NO_SEGMENT && branch != root && segments[branch].parent != root) {
+            branch = segments[branch].parent;
+        }
+        if (branch == keep || current[j] == NO_SEGMENT) {
+            continue;
+        }
+
+        segments[current[j]].held = false;
+        release_segment(current[j]);
+        current[j] = NO_SEGMENT;
+        delta[j] = -INFINITY;
+    }
+}
+
+// Emit what every surviving path agrees on
+static void decide(uint32_t now_ms) {
+    // Bound the decision lag, and the segments the open branches hold
+    if (!segments[root].held && segments[root].children > 1 &&
+        (now_ms - segments[root].end_ms > GESTURE_DECODER_MAX_LAG_MS || free_count < DECODER_STATES)) {
+        force_decision();
+    }
+
+    // A finished root with a single follower is final
+    while (!segments[root].held && segments[root].children == 1) {
+        uint16_t child = NO_SEGMENT;
+        for (uint16_t i = 0; i < DECODER_SEGMENTS; i++) {
+            if (segments[i].parent == root && (segments[i].held || segments[i].children > 0)) {
+                child = i;
+                break;
+            }
+        }
+        if (child == NO_SEGMENT) {
+            break;
+        }
+
+        segment_t *seg = &segments[root];
+        if (seg->label != REST_LABEL && !seg->emitted) {
+            queue_event(seg);
+        }
+
+        segments[child].parent = NO_SEGMENT;
+        seg->children = 0;
+        free_segments[free_count++] = root;
+        root = child;
+    }
+
+    // A running root is on every path too; commit it once the evidence is clear
+    segment_t *seg = &segments[root];
+    if (seg->held && seg->label != REST_LABEL && !seg->emitted && seg->evidence >= GESTURE_DECODER_COMMIT) {
+        queue_event(seg);
+        seg->emitted = true;
+    }
+}
+
+static float template_threshold(const gesture_template_info_t *info) {
+    return (info->confidence_threshold > 0.0f) ? info->confidence_threshold : CONFIDENCE_THRESHOLD;
+}
+
+esp_err_t gesture_decoder_init(void) {
+    gesture_decoder_reset();
+    ESP_LOGI(TAG, "Gesture decoder initialized (%u segments)", DECODER_SEGMENTS);
+    return ESP_OK;
+}
+
+void gesture_decoder_reset(void) {
+    free_count = 0;
+    for (uint16_t i = DECODER_SEGMENTS; i > 0; i--) {
+        segments[i - 1].parent = NO_SEGMENT;
+        segments[i - 1].held = false;
+        segments[i - 1].children = 0;
+        free_segments[free_count++] = i - 1;
+    }
+
+    for (uint16_t j = 0; j < DECODER_STATES; j++) {
+        delta[j] = -INFINITY;
+        current[j] = NO_SEGMENT;
+    }
+
+    // Every path starts at rest
+    root = alloc_segment(REST_LABEL, NO_SEGMENT, 0);
+    delta[REST_STATE] = 0.0f;
+    current[REST_STATE] = root;
+    state_count = 1;
+
+    event_head = 0;
+    event_count = 0;
+}
+
+esp_err_t gesture_decoder_push(const float *scores, const gesture_template_info_t *info,
+                               uint16_t count, uint32_t now_ms) {
+    if (scores == NULL || info == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (count > MAX_GESTURE_TEMPLATES) {
+        count = MAX_GESTURE_TEMPLATES;
+    }
+
+    // New templates start without a path; they can only be entered
+    if (count + 1 > state_count) {
+        state_count = count + 1;
+    }
+
+    // Best two template states of the previous frame, for switching
+    uint16_t best = NO_SEGMENT, second = NO_SEGMENT;
+    for (uint16_t j = 1; j < state_count; j++) {
+        if (best == NO_SEGMENT || delta[j] > delta[best]) {
+            second = best;
+            best = j;
+        } else if (second == NO_SEGMENT || delta[j] > delta[second]) {
+            second = j;
+        }
+    }
+
+    // Pick each state's predecessor. Rest is left for free, templates are
+    // held for free, and entering a template costs GESTURE_DECODER_ENTER.
+    static float next_delta[DECODER_STATES];
+    for (uint16_t j = 0; j < state_count; j++) {
+        float path = (current[j] != NO_SEGMENT) ? delta[j] : -INFINITY;
+        uint16_t from = j;
+
+        if (j == REST_STATE) {
+            if (best != NO_SEGMENT && delta[best] > path) {
+                path = delta[best];
+                from = best;
+            }
+            next_delta[j] = path;
+        } else {
+            float enter = delta[REST_STATE] - GESTURE_DECODER_ENTER;
+            if (enter > path) {
+                path = enter;
+                from = REST_STATE;
+            }
+
+            uint16_t other = (best != j) ? best : second;
+            if (other != NO_SEGMENT && delta[other] - GESTURE_DECODER_ENTER > path) {
+                path = delta[other] - GESTURE_DECODER_ENTER;
+                from = other;
+            }
+
+            float score = (j - 1 < count) ? scores[j - 1] : 0.0f;
+            float emission = (j - 1 < count) ? GESTURE_DECODER_GAIN * (score - template_threshold(&info[j - 1]))
+                                             : -INFINITY;
+            next_delta[j] = path + emission;
+        }
+        predecessor[j] = from;
+    }
+
+    // Start new segments before letting go of old ones, which may be their parents
+    static uint16_t next_current[DECODER_STATES];
+    for (uint16_t j = 0; j < state_count; j++) {
+        if (predecessor[j] == j) {
+            next_current[j] = current[j];
+            continue;
+        }
+
+        next_current[j] = alloc_segment((j == REST_STATE) ? REST_LABEL : (int16_t)(j - 1),
+                                        current[predecessor[j]], now_ms);
+        if (next_current[j] == NO_SEGMENT) {
+            ESP_LOGW(TAG, "Out of path segments, decoder reset");
+            gesture_decoder_reset();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    float peak = -INFINITY;
+    for (uint16_t j = 0; j < state_count; j++) {
+        if (next_current[j] != current[j] && current[j] != NO_SEGMENT) {
+            segments[current[j]].held = false;
+            release_segment(current[j]);
+        }
+        current[j] = next_current[j];
+        delta[j] = next_delta[j];
+        if (delta[j] > peak) {
+            peak = delta[j];
+        }
+
+        // Extend the state's segment by this frame
+        if (current[j] == NO_SEGMENT) {
+            continue;
+        }
+        segment_t *seg = &segments[current[j]];
+        seg->frames++;
+        seg->end_ms = now_ms;
+        if (j != REST_STATE && j - 1 < count) {
+            seg->score_sum += scores[j - 1];
+            seg->evidence += GESTURE_DECODER_GAIN * (scores[j - 1] - template_threshold(&info[j - 1]));
+        }
+    }
+
+    // Keep path scores near zero; only their differences matter
+    for (uint16_t j = 0; j < state_count; j++) {
+        if (current[j] != NO_SEGMENT) {
+            delta[j] -= peak;
+        }
+    }
+
+    decide(now_ms);
+    return ESP_OK;
+}
+
+bool gesture_decoder_pop(gesture_decoder_event_t *event) {
+    if (event == NULL || event_count == 0) {
+        return false;
+    }
+
+    *event = events[event_head];
+    event_head = (event_head + 1) % GESTURE_DECODER_EVENTS;
+    event_count--;
+    return true;
+}
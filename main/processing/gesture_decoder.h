@@ -0,0 +1,69 @@
+#ifndef PROCESSING_GESTURE_DECODER_H
+#define PROCESSING_GESTURE_DECODER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "config/system_config.h"
+#include "gesture_templates.h"
+
+/**
+ * @brief A gesture segment decided by the decoder
+ */
+typedef struct {
+    int16_t template_index;      // Template the segment was decoded as
+    float confidence;            // Mean score over the segment
+    uint32_t start_ms;           // First frame of the segment
+    uint32_t duration_ms;        // Segment length, up to the commit if committed early
+} gesture_decoder_event_t;
+
+/**
+ * @brief Streaming Viterbi decoder over per-frame template scores
+ *
+ * One hold state per template plus a rest state. Each frame a template's
+ * state earns GESTURE_DECODER_GAIN * (score - threshold), rest earns
+ * nothing, and entering a template costs GESTURE_DECODER_ENTER, so short
+ * flicker above threshold never pays for its own segment while a held
+ * sign does within a few frames. Repeated signs are separate segments
+ * with rest in between. A segment is emitted once every surviving path
+ * agrees on it: when it has ended, or earlier if it is still running but
+ * has gathered GESTURE_DECODER_COMMIT evidence. Paths that still disagree
+ * GESTURE_DECODER_MAX_LAG_MS after a segment ended are settled in favour
+ * of the best one.
+ */
+
+/**
+ * @brief Initialize the decoder
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t gesture_decoder_init(void);
+
+/**
+ * @brief Forget all paths and pending events
+ */
+void gesture_decoder_reset(void);
+
+/**
+ * @brief Advance the decoder by one frame
+ *
+ * Templates added since the last frame join with no history.
+ *
+ * @param scores Score of each template this frame, 0 if it was not scored
+ * @param info Metadata of each template, for its confidence threshold
+ * @param count Number of templates
+ * @param now_ms Frame time
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t gesture_decoder_push(const float *scores, const gesture_template_info_t *info,
+                               uint16_t count, uint32_t now_ms);
+
+/**
+ * @brief Take the oldest decided gesture segment
+ *
+ * @param event Pointer to store the segment
+ * @return true if a segment was available
+ */
+bool gesture_decoder_pop(gesture_decoder_event_t *event);
+
+#endif /* PROCESSING_GESTURE_DECODER_H */
@@ -1,78 +1,198 @@
 #include "processing/gesture_detection.h"
 #include <string.h>
+#include <stdatomic.h>
 #include "esp_log.h"
-#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "util/buffer.h"
 #include "util/debug.h"
-#include "math.h"
+#include "processing/template_matcher.h"
+#include "processing/dtw_matcher.h"
+#include "processing/template_index.h"
+#include "processing/template_view.h"
+#include "processing/template_enroll.h"
+#include "processing/gesture_decoder.h"
+#include "processing/feature_layout.h"
+#include "gesture_templates.h"
 
 static const char *TAG = "GESTURE_DETECT";
 
 // Gesture detection state
 static bool gesture_detection_initialized = false;
 
-// Define gesture templates (simplified for demonstration)
-// In a real implementation, these would be learned from training data
-// or loaded from a pre-trained model
-
-// Number of gestures in our vocabulary
-#define NUM_GESTURES 10
-
-// Simplified gesture templates (placeholder)
-typedef struct {
-    char name[32];           // Gesture name
-    float template_features[FEATURE_BUFFER_SIZE];  // Template feature vector
-    uint16_t feature_count;  // Number of features used
-    bool is_dynamic;         // Static vs dynamic gesture
-} gesture_template_t;
-
-// Sample gesture templates
-static gesture_template_t gesture_templates[NUM_GESTURES] = {
-    {
-        .name = "A",
-        .template_features = {0.0f},  // Would be filled with actual values
-        .feature_count = 32,
-        .is_dynamic = false
-    },
-    {
-        .name = "B",
-        .template_features = {0.0f},  // Would be filled with actual values
-        .feature_count = 32,
-        .is_dynamic = false
-    },
-    // More gestures would be defined here
+// History channels making up one motion sequence step
+static const history_channel_t sequence_channels[GESTURE_SEQUENCE_CHANNELS] = {
+    HISTORY_CH_FLEX_0, HISTORY_CH_FLEX_0 + 1, HISTORY_CH_FLEX_0 + 2, HISTORY_CH_FLEX_0 + 3,
+    HISTORY_CH_FLEX_0 + 4, HISTORY_CH_FLEX_0 + 5, HISTORY_CH_FLEX_0 + 6, HISTORY_CH_FLEX_0 + 7,
+    HISTORY_CH_FLEX_0 + 8, HISTORY_CH_FLEX_0 + 9,
+    HISTORY_CH_GRAVITY_X, HISTORY_CH_GRAVITY_Y, HISTORY_CH_GRAVITY_Z,
+    HISTORY_CH_LINEAR_ACCEL_X, HISTORY_CH_LINEAR_ACCEL_Y, HISTORY_CH_LINEAR_ACCEL_Z
 };
 
-// Last detected gesture for debouncing
-static char last_detected_gesture[32] = {0};
-static uint32_t last_detection_time = 0;
-static const uint32_t GESTURE_DEBOUNCE_TIME_MS = 500;
+// History samples resampled into one motion sequence (the longest gesture)
+#define SEQUENCE_WINDOW_SAMPLES ((MAX_GESTURE_DURATION_MS * SENSOR_FUSION_RATE_HZ) / 1000)
+#define SEQUENCE_VALUES         GESTURE_MOTION_SEQUENCE_VALUES
 
-esp_err_t gesture_detection_init(void) {
-    // In a real implementation, you would load gesture templates or ML model from storage
-    // For this demonstration, we'll use pre-defined templates
+#if GESTURE_MATCH_USE_Q15
+// Current features normalized against the template tables
+static int16_t normalized_input[TEMPLATE_MATCHER_MAX_STRIDE] __attribute__((aligned(16)));
+
+#if GESTURE_COARSE_TOP_K > TEMPLATE_INDEX_MAX_K
+#error "GESTURE_COARSE_TOP_K exceeds TEMPLATE_INDEX_MAX_K"
+#endif
+
+// Templates nearest the current pose in the coarse index; only these get
+// the full score and DTW once the vocabulary outgrows GESTURE_COARSE_TOP_K
+static bool coarse_active = false;
+static uint16_t coarse_candidates[GESTURE_COARSE_TOP_K];
+static uint16_t coarse_count = 0;
+static const float *coarse_sequences[GESTURE_COARSE_TOP_K];
+#endif
+
+// Last motion matched, raw and scaled for DTW. Enrollment reads the raw
+// one from another task; the version is odd while it is being rewritten.
+static float motion_sequence[SEQUENCE_VALUES];
+static float scaled_sequence[SEQUENCE_VALUES] __attribute__((aligned(16)));
+static atomic_uint motion_version = 0;
+static atomic_bool motion_sequence_valid = false;
+static bool dtw_enabled = false;
+
+// Copy of the last motion taken for an enrollment repetition
+static float enroll_sequence[SEQUENCE_VALUES];
+
+// This frame's score for every template, 0 where it was not scored
+static float frame_scores[MAX_GESTURE_TEMPLATES];
+
+// Snapshot generation the decoder's paths refer to
+static uint32_t decoder_generation = 0;
+
+#if FEATURE_SET_SECOND_HAND
+// On the primary of a pair, single-handed templates are compared on the
+// wearer's hand alone (their rows are zero past it) and two-handed ones on
+// both, only while the other glove's features are in the frame.
+#if GESTURE_MATCH_USE_Q15
+static int16_t hand_input[TEMPLATE_MATCHER_MAX_STRIDE] __attribute__((aligned(16)));
+static uint16_t hand_candidates[MAX_GESTURE_TEMPLATES];
+static uint16_t pair_candidates[MAX_GESTURE_TEMPLATES];
+
+// Score the given templates (all when indices is NULL) against normalized_input
+static esp_err_t score_hands_q15(const template_view_t *view, bool two_hand,
+                                 const uint16_t *indices, uint16_t count) {
+    const template_set_t *set = &view->set;
+    uint16_t hand_count = 0, pair_count = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t t = (indices != NULL) ? indices[i] : i;
+        if (t >= set->count) {
+            continue;
+        }
+        if (view->info[t].two_handed) {
+            pair_candidates[pair_count++] = t;
+        } else {
+            hand_candidates[hand_count++] = t;
+        }
+    }
+    
+    // The same rows seen as one hand's, against the input cut to the wearer's hand
+    template_set_t hand_set = *set;
+    hand_set.dim = GESTURE_HAND_FEATURES;
+    memcpy(hand_input, normalized_input, GESTURE_HAND_FEATURES * sizeof(int16_t));
+    memset(hand_input + GESTURE_HAND_FEATURES, 0, (set->stride - GESTURE_HAND_FEATURES) * sizeof(int16_t));
+    
+    esp_err_t ret = template_matcher_score_q15(&hand_set, hand_input, hand_candidates, hand_count, frame_scores);
+    if (ret != ESP_OK || !two_hand) {
+        return ret;
+    }
+    return template_matcher_score_q15(set, normalized_input, pair_candidates, pair_count, frame_scores);
+}
+#else
+static float pair_scores[MAX_GESTURE_TEMPLATES];
+
+// Score every template, each on the hands it uses
+static esp_err_t score_hands(const template_view_t *view, const feature_vector_t *feature_vector) {
+    const template_set_t *set = &view->set;
+    template_set_t hand_set = *set;
+    hand_set.dim = GESTURE_HAND_FEATURES;
+    
+    esp_err_t ret = template_matcher_score(&hand_set, feature_vector->features,
+                                           feature_vector->feature_count, frame_scores);
+    if (ret == ESP_OK && feature_vector->two_hand) {
+        ret = template_matcher_score(set, feature_vector->features, feature_vector->feature_count, pair_scores);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    for (uint16_t t = 0; t < set->count; t++) {
+        if (view->info[t].two_handed) {
+            frame_scores[t] = feature_vector->two_hand ? pair_scores[t] : 0.0f;
+        }
+    }
+    return ESP_OK;
+}
+#endif
+#endif
+
+// DTW match of the latest motion against every dynamic template
+static esp_err_t match_dynamic(const template_view_t *view, dtw_match_t *match) {
+    const float *inv_scale = view->sequence_inv_scale;
+    for (int v = 0; v < SEQUENCE_VALUES; v++) {
+        scaled_sequence[v] = motion_sequence[v] * inv_scale[v % GESTURE_SEQUENCE_CHANNELS];
+    }
     
-    // Initialize gesture templates with some placeholder values
-    // In a real implementation, these would be learned or loaded from storage
+    esp_err_t ret = dtw_matcher_set_query(scaled_sequence, GESTURE_SEQUENCE_LENGTH,
+                                          GESTURE_SEQUENCE_CHANNELS, GESTURE_DTW_BAND);
+    if (ret != ESP_OK) {
+        return ret;
+    }
     
-    // Example for 'A' (ASL 'A' is a fist with thumb alongside)
-    for (int i = 0; i < 10; i++) {
-        gesture_templates[0].template_features[i] = 70.0f;  // All fingers curled (high angle values)
+#if GESTURE_MATCH_USE_Q15
+    // Only the coarse candidates, mapped back to template indices afterwards
+    if (coarse_active) {
+        for (uint16_t i = 0; i < coarse_count; i++) {
+            coarse_sequences[i] = view->sequences[coarse_candidates[i]];
+        }
+        
+        ret = dtw_matcher_match(coarse_sequences, coarse_count, match);
+        if (ret == ESP_OK && match->index >= 0) {
+            match->index = coarse_candidates[match->index];
+        }
+        return ret;
     }
-    // Thumb is slightly less curled
-    gesture_templates[0].template_features[0] = 30.0f;
-    gesture_templates[0].template_features[1] = 40.0f;
+#endif
     
-    // Example for 'B' (ASL 'B' is a flat hand with fingers together)
-    for (int i = 0; i < 10; i++) {
-        gesture_templates[1].template_features[i] = 0.0f;  // All fingers straight (low angle values)
+    return dtw_matcher_match(view->sequences, view->set.count, match);
+}
+
+esp_err_t gesture_detection_init(void) {
+    // Templates are matched in place in the memory-mapped template partition
+    esp_err_t ret = gesture_templates_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to load gesture templates: %s", esp_err_to_name(ret));
+        return ret;
     }
     
-    // More gesture templates would be initialized here
+    // The classifier matches a RAM snapshot, so the store can be rewritten underneath it
+    ret = template_view_init();
+    if (ret == ESP_OK) {
+        ret = template_enroll_init();
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
     
+    const template_view_t *view = template_view_peek();
+    dtw_enabled = (view->sequence_length == GESTURE_SEQUENCE_LENGTH &&
+                   view->sequence_channels == GESTURE_SEQUENCE_CHANNELS);
+    if (!dtw_enabled) {
+        ESP_LOGW(TAG, "Template sequences are %ux%u, expected %ux%u; dynamic gestures disabled",
+                 view->sequence_length, view->sequence_channels,
+                 GESTURE_SEQUENCE_LENGTH, GESTURE_SEQUENCE_CHANNELS);
+    }
+    
+    gesture_decoder_init();
+    
+    atomic_store(&motion_sequence_valid, false);
     gesture_detection_initialized = true;
-    ESP_LOGI(TAG, "Gesture detection initialized with %d gestures", NUM_GESTURES);
+    ESP_LOGI(TAG, "Gesture detection initialized with %u gestures", view->set.count);
     
     return ESP_OK;
 }
@@ -84,97 +204,202 @@ esp_err_t gesture_detection_deinit(void) {
     return ESP_OK;
 }
 
-esp_err_t gesture_detection_process(feature_vector_t *feature_vector, processing_result_t *result) {
-    if (!gesture_detection_initialized || feature_vector == NULL || result == NULL) {
-        return ESP_ERR_INVALID_STATE;
+esp_err_t gesture_detection_capture_motion(const history_window_t *history, float *sequence) {
+    if (history == NULL || sequence == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (history_window_get_count(history) < SEQUENCE_WINDOW_SAMPLES) {
+        return ESP_ERR_NOT_FOUND;
     }
     
+    for (int c = 0; c < GESTURE_SEQUENCE_CHANNELS; c++) {
+        const float *samples = history_window_channel(history, sequence_channels[c], SEQUENCE_WINDOW_SAMPLES);
+        for (int step = 0; step < GESTURE_SEQUENCE_LENGTH; step++) {
+            int k = step * (SEQUENCE_WINDOW_SAMPLES - 1) / (GESTURE_SEQUENCE_LENGTH - 1);
+            sequence[step * GESTURE_SEQUENCE_CHANNELS + c] = samples[k];
+        }
+    }
+    
+    return ESP_OK;
+}
+
+// Match one frame against a snapshot the caller holds
+static esp_err_t classify(const template_view_t *view, feature_vector_t *feature_vector, const float *motion,
+                          processing_result_t *result) {
+    const template_set_t *set = &view->set;
+    
     // Initialize result
     memset(result, 0, sizeof(processing_result_t));
     
-    // Get current time for timestamps and debouncing
-    uint32_t current_time = esp_timer_get_time() / 1000;
+    // Segment boundaries are on the sample clock, not the time the frame got here
+    uint32_t current_time = feature_vector->timestamp;
     
-    // Simplified gesture recognition: we'll use a basic distance metric
-    // In a real implementation, you would use an ML model or more sophisticated algorithm
+    // A reloaded template pack reuses the indices the decoder is tracking
+    if (view->generation != decoder_generation) {
+        gesture_decoder_reset();
+        decoder_generation = view->generation;
+    }
     
-    float best_match_score = 0.0f;
-    int best_match_index = -1;
+    memset(frame_scores, 0, set->count * sizeof(float));
     
-    // Compare input features to each template
-    for (int i = 0; i < NUM_GESTURES; i++) {
-        // Skip if template uses more features than we have
-        if (gesture_templates[i].feature_count > feature_vector->feature_count) {
-            continue;
-        }
-        
-        // Calculate a simple similarity score based on feature distances
-        // This is a very basic approach - a real implementation would use 
-        // more sophisticated matching or classification algorithms
-        
-        float similarity = 0.0f;
-        float max_distance = 0.0f;
-        
-        // Compare features (using only the features that both have)
-        uint16_t compare_count = gesture_templates[i].feature_count < feature_vector->feature_count ?
-                               gesture_templates[i].feature_count : feature_vector->feature_count;
+#if GESTURE_MATCH_USE_Q15
+    coarse_active = false;
+#endif
+    
+    // Static poses: score the templates against the input in one pass over
+    // the packed matrix. Dynamic templates are left to DTW.
+#if FEATURE_SET_SECOND_HAND
+    uint16_t needed = feature_vector->two_hand ? set->dim : GESTURE_HAND_FEATURES;
+#else
+    uint16_t needed = set->dim;
+#endif
+    if (feature_vector->feature_count >= needed) {
+#if GESTURE_MATCH_USE_Q15
+        template_matcher_pack_row_q15(feature_vector->features, set->offset, set->inv_scale,
+                                      set->dim, normalized_input);
         
-        for (int j = 0; j < compare_count; j++) {
-            // Calculate feature distance (normalized)
-            float feature_dist = fabsf(feature_vector->features[j] - gesture_templates[i].template_features[j]);
-            
-            // Update maximum distance (for later normalization)
-            if (feature_dist > max_distance) {
-                max_distance = feature_dist;
-            }
-            
-            // Accumulate similarity (inverse of distance)
-            similarity += 1.0f / (1.0f + feature_dist);
+        // Coarse stage: narrow a large vocabulary to the nearest poses
+        coarse_active = template_index_get_count(view->index) > GESTURE_COARSE_TOP_K;
+        const uint16_t *candidates = NULL;
+        uint16_t candidate_count = set->count;
+        if (coarse_active) {
+            coarse_count = template_index_query(view->index, normalized_input, GESTURE_COARSE_TOP_K,
+                                                coarse_candidates);
+            candidates = coarse_candidates;
+            candidate_count = coarse_count;
+        }
+#if FEATURE_SET_SECOND_HAND
+        esp_err_t ret = score_hands_q15(view, feature_vector->two_hand, candidates, candidate_count);
+#else
+        esp_err_t ret = template_matcher_score_q15(set, normalized_input, candidates, candidate_count,
+                                                   frame_scores);
+#endif
+#elif FEATURE_SET_SECOND_HAND
+        esp_err_t ret = score_hands(view, feature_vector);
+#else
+        esp_err_t ret = template_matcher_score(set, feature_vector->features,
+                                               feature_vector->feature_count, frame_scores);
+#endif
+        if (ret != ESP_OK) {
+            return ret;
         }
         
-        // Normalize similarity score (0-1 range)
-        float score = similarity / (float)compare_count;
-        
-        // Keep track of best match
-        if (score > best_match_score) {
-            best_match_score = score;
-            best_match_index = i;
+        for (uint16_t i = 0; i < set->count; i++) {
+            if (view->info[i].is_dynamic) {
+                frame_scores[i] = 0.0f;
+            }
         }
     }
     
-    // If we found a good match and it passes our confidence threshold
-    if (best_match_index >= 0 && best_match_score >= CONFIDENCE_THRESHOLD) {
-        // Check for debouncing (avoid rapid repeated detections of the same gesture)
-        if (strcmp(last_detected_gesture, gesture_templates[best_match_index].name) == 0) {
-            // Same gesture as last time, check time elapsed
-            if (current_time - last_detection_time < GESTURE_DEBOUNCE_TIME_MS) {
-                // Not enough time elapsed, ignore this detection
-                return ESP_OK;
-            }
+    // Dynamic gestures: DTW over the motion of the last MAX_GESTURE_DURATION_MS.
+    // Without a sequence the stage is skipped and the last one is kept.
+    if (motion != NULL) {
+        unsigned version = atomic_load_explicit(&motion_version, memory_order_relaxed);
+        atomic_store_explicit(&motion_version, version + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        memcpy(motion_sequence, motion, sizeof(motion_sequence));
+        atomic_store_explicit(&motion_version, version + 2, memory_order_release);
+        atomic_store(&motion_sequence_valid, true);
+    }
+    if (motion != NULL && dtw_enabled) {
+        dtw_match_t match;
+        esp_err_t ret = match_dynamic(view, &match);
+        if (ret != ESP_OK) {
+            return ret;
         }
         
-        // Fill in the result
-        result->gesture_id = best_match_index;
-        strncpy(result->gesture_name, gesture_templates[best_match_index].name, sizeof(result->gesture_name) - 1);
-        result->confidence = best_match_score;
-        result->is_dynamic = gesture_templates[best_match_index].is_dynamic;
-        result->duration_ms = 0;  // We're not tracking duration in this simplified version
-        
-        // Save for debouncing
-        strncpy(last_detected_gesture, result->gesture_name, sizeof(last_detected_gesture) - 1);
-        last_detection_time = current_time;
-        
-        ESP_LOGI(TAG, "Gesture detected: %s (confidence: %.2f)", result->gesture_name, result->confidence);
+        // DTW prunes everything but the winner, so only it gets a score
+        if (match.index >= 0) {
+            frame_scores[match.index] = match.score;
+        }
+    }
+    
+    // The decoder weighs every template over time and only reports
+    // segments it has settled on
+    esp_err_t ret = gesture_decoder_push(frame_scores, view->info, set->count, current_time);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    gesture_decoder_event_t event;
+    if (!gesture_decoder_pop(&event)) {
+        return ESP_OK;
+    }
+    
+    const char *name = template_view_name(view, event.template_index);
+    if (name == NULL) {
         return ESP_OK;
     }
     
-    // No gesture detected with sufficient confidence
+    // Fill in the result
+    result->gesture_id = event.template_index;
+    strncpy(result->gesture_name, name, sizeof(result->gesture_name) - 1);
+    result->confidence = event.confidence;
+    result->is_dynamic = view->info[event.template_index].is_dynamic != 0;
+    result->duration_ms = event.duration_ms;
+    result->sample_timestamp = event.start_ms + event.duration_ms;
+    
+    ESP_LOGI(TAG, "Gesture detected: %s (confidence: %.2f, %lu ms)", result->gesture_name,
+             result->confidence, (unsigned long)result->duration_ms);
     return ESP_OK;
 }
 
-esp_err_t gesture_detection_add_template(const char *name, feature_vector_t *features, bool is_dynamic) {
-    // This would be used for learning new gestures
-    // Not implemented in this simplified version
-    ESP_LOGW(TAG, "Gesture template addition not implemented");
-    return ESP_ERR_NOT_SUPPORTED;
-}
\ No newline at end of file
+esp_err_t gesture_detection_process(feature_vector_t *feature_vector, const float *motion,
+                                    processing_result_t *result) {
+    if (!gesture_detection_initialized || feature_vector == NULL || result == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    // Held for the whole frame; enrollment publishes into the other snapshot
+    const template_view_t *view = template_view_acquire();
+    esp_err_t ret = classify(view, feature_vector, motion, result);
+    template_view_release();
+    
+    return ret;
+}
+
+// Copy the last motion without holding up the classifier, retrying while it is rewritten
+static void read_motion(float *sequence) {
+    unsigned before, after;
+    do {
+        before = atomic_load_explicit(&motion_version, memory_order_acquire);
+        memcpy(sequence, motion_sequence, sizeof(motion_sequence));
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&motion_version, memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+}
+
+esp_err_t gesture_detection_add_template(const char *name, feature_vector_t *features, bool is_dynamic,
+                                         bool two_handed) {
+    if (name == NULL || features == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (!gesture_detection_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (is_dynamic && !atomic_load(&motion_sequence_valid)) {
+        ESP_LOGE(TAG, "Not enough motion history to record a dynamic gesture");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (two_handed && !features->two_hand) {
+        ESP_LOGE(TAG, "Second glove not heard, cannot record a two-handed gesture");
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    // Dynamic gestures keep the motion that led up to this frame
+    if (is_dynamic) {
+        read_motion(enroll_sequence);
+    }
+    
+    uint16_t remaining = 0;
+    esp_err_t ret = template_enroll_add(name, features->features, features->feature_count,
+                                        is_dynamic ? enroll_sequence : NULL, two_handed, &remaining);
+    if (ret == ESP_OK && remaining > 0) {
+        ESP_LOGI(TAG, "Enrolling '%s': %u repetitions to go", name, remaining);
+    }
+    return ret;
+}
@@ -3,6 +3,11 @@
 
 #include "esp_err.h"
 #include "util/buffer.h"
+#include "util/history_window.h"
+#include "config/system_config.h"
+
+// Values in one motion sequence: GESTURE_SEQUENCE_LENGTH steps, time-major
+#define GESTURE_MOTION_SEQUENCE_VALUES  (GESTURE_SEQUENCE_LENGTH * GESTURE_SEQUENCE_CHANNELS)
 
 /**
  * @brief Initialize gesture detection module
@@ -18,23 +23,51 @@ esp_err_t gesture_detection_init(void);
  */
 esp_err_t gesture_detection_deinit(void);
 
+/**
+ * @brief Resample the last MAX_GESTURE_DURATION_MS of history into a motion sequence
+ * 
+ * Only reads the history, so the sequence can be captured where the
+ * history is kept and matched later on another core.
+ * 
+ * @param history History window, already containing the current sample
+ * @param sequence Output sequence (GESTURE_MOTION_SEQUENCE_VALUES values)
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the history is still too short
+ */
+esp_err_t gesture_detection_capture_motion(const history_window_t *history, float *sequence);
+
 /**
  * @brief Process feature vector to detect gestures
  * 
+ * Static templates are matched against the feature vector; dynamic ones
+ * by DTW against the motion sequence.
+ * 
  * @param feature_vector Input feature vector
+ * @param motion_sequence Sequence from gesture_detection_capture_motion(),
+ *                        or NULL to skip the dynamic stage for this frame
  * @param result Output processing result
  * @return ESP_OK on success, error code otherwise
  */
-esp_err_t gesture_detection_process(feature_vector_t *feature_vector, processing_result_t *result);
+esp_err_t gesture_detection_process(feature_vector_t *feature_vector, const float *motion_sequence,
+                                    processing_result_t *result);
 
 /**
- * @brief Add a new gesture template
+ * @brief Add one enrollment repetition of a gesture
+ * 
+ * GESTURE_ENROLL_REPETITIONS calls for the same gesture are averaged into
+ * one template, which the classifier starts matching at once and which is
+ * written to flash in the background. Recognition keeps running meanwhile.
+ * A dynamic template also records the motion of the last
+ * MAX_GESTURE_DURATION_MS seen by gesture_detection_process(). Call from
+ * one task, not the one running gesture_detection_process().
  * 
  * @param name Gesture name
  * @param features Feature vector template
  * @param is_dynamic Whether this is a dynamic gesture
+ * @param two_handed Whether the gesture uses the second glove of a pair;
+ *                   its features must then be in the vector
  * @return ESP_OK on success, error code otherwise
  */
-esp_err_t gesture_detection_add_template(const char *name, feature_vector_t *features, bool is_dynamic);
+esp_err_t gesture_detection_add_template(const char *name, feature_vector_t *features, bool is_dynamic,
+                                         bool two_handed);
 
 #endif /* PROCESSING_GESTURE_DETECTION_H */
\ No newline at end of file
@@ -0,0 +1,683 @@
+#include "gesture_templates.h"
+#include <string.h>
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "image_slots.h"
+#include "config/system_config.h"
+#include "processing/dtw_matcher.h"
+#include "processing/feature_layout.h"
+#include "config/memory_layout.h"
+#include "util/scratch_arena.h"
+
+static const char *TAG = "GESTURE_TEMPLATES";
+
+#define FLASH_SECTOR_SIZE    IMAGE_SLOTS_SECTOR_SIZE
+
+// Template store state
+static const esp_partition_t *template_partition = NULL;
+static uint8_t template_slot = 0;                         // Image slot in use
+static uint32_t slot_base = 0;                            // Its offset in the partition
+static esp_partition_mmap_handle_t map_handle;
+static const uint8_t *image = NULL;                       // Mapped slot
+static const gesture_templates_header_t *header = NULL;   // Set once the image is validated
+static bool gesture_templates_initialized = false;
+
+// Read-modify-write buffer for one flash sector; only written at flash speed
+static MEM_BULK uint8_t sector_buffer[FLASH_SECTOR_SIZE] __attribute__((aligned(4)));
+
+// Rows and sequences being stored, reset by each store call (templates are
+// stored by one task at a time)
+#define TEMPLATE_SCRATCH_BYTES  (TEMPLATE_MATCHER_MAX_STRIDE * (sizeof(float) + sizeof(int16_t)) + \
+                                 GESTURE_SEQUENCE_LENGTH * GESTURE_SEQUENCE_CHANNELS * sizeof(float) + 16)
+static uint8_t template_scratch[TEMPLATE_SCRATCH_BYTES] __attribute__((aligned(16)));
+static scratch_arena_t template_arena;
+
+static inline uint32_t align_up(uint32_t value, uint32_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+// Section offsets of an image with the given capacity and shapes
+static void compute_layout(gesture_templates_header_t *hdr, uint16_t capacity, uint16_t dim,
+                           uint16_t sequence_length, uint16_t sequence_channels) {
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = GESTURE_TEMPLATES_MAGIC;
+    hdr->version = GESTURE_TEMPLATES_VERSION;
+    hdr->header_size = sizeof(gesture_templates_header_t);
+    hdr->template_capacity = capacity;
+    hdr->feature_dim = dim;
+    hdr->feature_stride = TEMPLATE_MATCHER_STRIDE(dim);
+    hdr->sequence_length = sequence_length;
+    hdr->sequence_channels = sequence_channels;
+
+    uint32_t offset = align_up(hdr->header_size, GESTURE_TEMPLATES_ALIGN);
+    hdr->names_offset = offset;
+    offset = align_up(offset + capacity * GESTURE_TEMPLATE_NAME_LEN, GESTURE_TEMPLATES_ALIGN);
+    hdr->info_offset = offset;
+    offset = align_up(offset + capacity * sizeof(gesture_template_info_t), GESTURE_TEMPLATES_ALIGN);
+    hdr->scale_offset = offset;
+    offset = align_up(offset + hdr->feature_stride * sizeof(float), GESTURE_TEMPLATES_ALIGN);
+    hdr->offset_offset = offset;
+    offset = align_up(offset + hdr->feature_stride * sizeof(float), GESTURE_TEMPLATES_ALIGN);
+    hdr->matrix_offset = offset;
+    offset = align_up(offset + capacity * hdr->feature_stride * sizeof(float), GESTURE_TEMPLATES_ALIGN);
+    hdr->norms_offset = offset;
+    offset = align_up(offset + capacity * sizeof(float), GESTURE_TEMPLATES_ALIGN);
+    hdr->matrix_q15_offset = offset;
+    offset = align_up(offset + capacity * hdr->feature_stride * sizeof(int16_t), GESTURE_TEMPLATES_ALIGN);
+    hdr->sequence_scale_offset = offset;
+    offset = align_up(offset + sequence_channels * sizeof(float), GESTURE_TEMPLATES_ALIGN);
+    hdr->sequence_offset = offset;
+    hdr->total_size = offset + capacity * sequence_length * sequence_channels * sizeof(float);
+}
+
+static inline uint32_t sequence_bytes(const gesture_templates_header_t *hdr) {
+    return hdr->sequence_length * hdr->sequence_channels * sizeof(float);
+}
+
+static uint32_t image_crc(const uint8_t *data, const gesture_templates_header_t *hdr) {
+    return esp_rom_crc32_le(0, data + hdr->header_size, hdr->total_size - hdr->header_size);
+}
+
+static esp_err_t map_partition(void) {
+    const void *ptr = NULL;
+    esp_err_t ret = esp_partition_mmap(template_partition, slot_base, image_slots_size(template_partition),
+                                       ESP_PARTITION_MMAP_DATA, &ptr, &map_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map template partition: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    image = (const uint8_t *)ptr;
+    return ESP_OK;
+}
+
+static void unmap_partition(void) {
+    if (image != NULL) {
+        esp_partition_munmap(map_handle);
+        image = NULL;
+    }
+    header = NULL;
+}
+
+// Check that the mapped image is complete, self-consistent and intact
+static esp_err_t validate_image(void) {
+    const gesture_templates_header_t *hdr = (const gesture_templates_header_t *)image;
+
+    if (hdr->magic != GESTURE_TEMPLATES_MAGIC) {
+        ESP_LOGW(TAG, "No template image in partition");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (hdr->version != GESTURE_TEMPLATES_VERSION || hdr->header_size != sizeof(gesture_templates_header_t)) {
+        ESP_LOGW(TAG, "Unsupported template image version %u", hdr->version);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    // The layout must be the one this firmware computes for the same shape
+    gesture_templates_header_t expected;
+    compute_layout(&expected, hdr->template_capacity, hdr->feature_dim,
+                   hdr->sequence_length, hdr->sequence_channels);
+
+    if (hdr->feature_dim == 0 || hdr->feature_dim > FEATURE_BUFFER_SIZE ||
+        hdr->template_capacity == 0 || hdr->template_capacity > MAX_GESTURE_TEMPLATES ||
+        hdr->template_count > hdr->template_capacity ||
+        hdr->feature_stride != expected.feature_stride ||
+        hdr->names_offset != expected.names_offset ||
+        hdr->info_offset != expected.info_offset ||
+        hdr->scale_offset != expected.scale_offset ||
+        hdr->offset_offset != expected.offset_offset ||
+        hdr->matrix_offset != expected.matrix_offset ||
+        hdr->norms_offset != expected.norms_offset ||
+        hdr->matrix_q15_offset != expected.matrix_q15_offset ||
+        hdr->sequence_length < 2 || hdr->sequence_length > DTW_MAX_LENGTH ||
+        hdr->sequence_channels == 0 || hdr->sequence_channels > DTW_MAX_CHANNELS ||
+        hdr->sequence_scale_offset != expected.sequence_scale_offset ||
+        hdr->sequence_offset != expected.sequence_offset ||
+        hdr->total_size != expected.total_size ||
+        hdr->total_size > image_slots_size(template_partition)) {
+        ESP_LOGW(TAG, "Malformed template image header");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (image_crc(image, hdr) != hdr->crc32) {
+        ESP_LOGW(TAG, "Template image CRC mismatch");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    header = hdr;
+    return ESP_OK;
+}
+
+// Map one slot and check its image
+static esp_err_t load_slot(uint8_t slot) {
+    unmap_partition();
+    template_slot = slot;
+    slot_base = image_slots_offset(template_partition, slot);
+
+    esp_err_t ret = map_partition();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = validate_image();
+    if (ret != ESP_OK) {
+        unmap_partition();
+    }
+    return ret;
+}
+
+// Write bytes anywhere in the slot, erasing and rewriting the sectors they touch
+static esp_err_t write_region(uint32_t offset, const void *data, size_t length) {
+    uint8_t *sector = sector_buffer;
+    const uint8_t *src = (const uint8_t *)data;
+    esp_err_t ret = ESP_OK;
+
+    offset += slot_base;
+
+    while (length > 0 && ret == ESP_OK) {
+        uint32_t sector_start = offset & ~(FLASH_SECTOR_SIZE - 1);
+        uint32_t in_sector = offset - sector_start;
+        size_t chunk = FLASH_SECTOR_SIZE - in_sector;
+        if (chunk > length) {
+            chunk = length;
+        }
+
+        ret = esp_partition_read(template_partition, sector_start, sector, FLASH_SECTOR_SIZE);
+        if (ret == ESP_OK) {
+            memcpy(sector + in_sector, src, chunk);
+            ret = esp_partition_erase_range(template_partition, sector_start, FLASH_SECTOR_SIZE);
+        }
+        if (ret == ESP_OK) {
+            ret = esp_partition_write(template_partition, sector_start, sector, FLASH_SECTOR_SIZE);
+        }
+
+        offset += chunk;
+        src += chunk;
+        length -= chunk;
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Template flash write failed: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+// Finish a modification: recompute the CRC over the written sections,
+// store the new header and map the result
+static esp_err_t commit_header(gesture_templates_header_t *hdr) {
+    esp_err_t ret = map_partition();
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    hdr->crc32 = image_crc(image, hdr);
+    unmap_partition();
+
+    ret = write_region(0, hdr, sizeof(*hdr));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    return load_slot(template_slot);
+}
+
+// Motion sequence steps hold the flex angles, then gravity and linear acceleration
+static float default_sequence_scale(uint16_t channel) {
+    return (channel < 10) ? 20.0f : 4.0f;
+}
+
+esp_err_t gesture_templates_init(void) {
+    if (gesture_templates_initialized) {
+        return ESP_OK;
+    }
+
+    template_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                  GESTURE_TEMPLATES_PARTITION_SUBTYPE,
+                                                  GESTURE_TEMPLATES_PARTITION_LABEL);
+    if (template_partition == NULL) {
+        ESP_LOGE(TAG, "Template partition '%s' not found", GESTURE_TEMPLATES_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    scratch_arena_init(&template_arena, template_scratch, sizeof(template_scratch));
+    gesture_templates_initialized = true;
+
+    esp_err_t ret = gesture_templates_load();
+    if (ret == ESP_OK && header->feature_dim != GESTURE_TEMPLATE_FEATURES) {
+        // Built for another feature set; its rows would be read at the wrong indices
+        ESP_LOGW(TAG, "Template image has %u features, this build extracts %u",
+                 header->feature_dim, (unsigned)GESTURE_TEMPLATE_FEATURES);
+        ret = ESP_ERR_INVALID_SIZE;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Writing default templates");
+        ret = gesture_templates_reset();
+        if (ret != ESP_OK) {
+            gesture_templates_initialized = false;
+            return ret;
+        }
+    }
+
+    ESP_LOGI(TAG, "%u templates mapped (%u features each)", header->template_count, header->feature_dim);
+    return ESP_OK;
+}
+
+esp_err_t gesture_templates_load(void) {
+    if (!gesture_templates_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t active = image_slots_active(template_partition);
+    esp_err_t ret = load_slot(active);
+    if (ret == ESP_OK) {
+        return ESP_OK;
+    }
+
+    // An image left in the other slot beats starting over; it becomes the
+    // active one, so the next pack is not written over it while mapped
+    uint8_t other = (active + 1) % IMAGE_SLOT_COUNT;
+    if (load_slot(other) == ESP_OK) {
+        ESP_LOGW(TAG, "Template slot %u unusable, fell back to slot %u", active, other);
+        image_slots_activate(template_partition, other);
+        return ESP_OK;
+    }
+
+    // Defaults are written to the active slot
+    template_slot = active;
+    slot_base = image_slots_offset(template_partition, active);
+    return ret;
+}
+
+esp_err_t gesture_templates_get_update_slot(const esp_partition_t **partition, uint8_t *slot) {
+    if (partition == NULL || slot == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!gesture_templates_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *partition = template_partition;
+    *slot = (template_slot + 1) % IMAGE_SLOT_COUNT;
+    return ESP_OK;
+}
+
+esp_err_t gesture_templates_activate_slot(uint8_t slot) {
+    if (!gesture_templates_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (slot >= IMAGE_SLOT_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t previous = template_slot;
+    esp_err_t ret = load_slot(slot);
+    if (ret == ESP_OK && header->feature_dim != GESTURE_TEMPLATE_FEATURES) {
+        ESP_LOGW(TAG, "Template pack has %u features, this build extracts %u",
+                 header->feature_dim, (unsigned)GESTURE_TEMPLATE_FEATURES);
+        ret = ESP_ERR_INVALID_SIZE;
+    }
+    if (ret == ESP_OK) {
+        ret = image_slots_activate(template_partition, slot);
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Template slot %u not activated: %s", slot, esp_err_to_name(ret));
+        load_slot(previous);
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "%u templates mapped from slot %u", header->template_count, slot);
+    return ESP_OK;
+}
+
+esp_err_t gesture_templates_save(void) {
+    if (!gesture_templates_initialized || header == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return (image_crc(image, header) == header->crc32) ? ESP_OK : ESP_ERR_INVALID_CRC;
+}
+
+uint16_t gesture_templates_packed_dim(const gesture_template_info_t *info, uint16_t feature_dim) {
+    if (info->two_handed || feature_dim < GESTURE_HAND_FEATURES) {
+        return feature_dim;
+    }
+    return GESTURE_HAND_FEATURES;
+}
+
+esp_err_t gesture_templates_add(const char* name, const float* features,
+                              uint16_t feature_count, bool is_dynamic,
+                              bool two_handed, float confidence_threshold) {
+    if (!gesture_templates_initialized || header == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (name == NULL || name[0] == '\0' || features == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    gesture_templates_header_t hdr = *header;
+    if (two_handed && hdr.feature_dim <= GESTURE_HAND_FEATURES) {
+        ESP_LOGE(TAG, "Two-handed template '%s' needs a primary glove", name);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    gesture_template_info_t info = {
+        .confidence_threshold = confidence_threshold,
+        .is_dynamic = is_dynamic ? 1 : 0,
+        .two_handed = two_handed ? 1 : 0
+    };
+    uint16_t packed_dim = gesture_templates_packed_dim(&info, hdr.feature_dim);
+    if (feature_count < packed_dim) {
+        ESP_LOGE(TAG, "Template needs %u features, got %u", packed_dim, feature_count);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Replace a template of the same name, otherwise take the next free slot
+    uint16_t index = hdr.template_count;
+    for (uint16_t i = 0; i < hdr.template_count; i++) {
+        if (strncmp(gesture_templates_get_name(i), name, GESTURE_TEMPLATE_NAME_LEN) == 0) {
+            index = i;
+            break;
+        }
+    }
+
+    if (index >= hdr.template_capacity) {
+        ESP_LOGE(TAG, "Template store full (%u)", hdr.template_capacity);
+        return ESP_ERR_NO_MEM;
+    }
+
+    scratch_arena_reset(&template_arena);
+    float *row = scratch_arena_alloc(&template_arena, hdr.feature_stride * (sizeof(float) + sizeof(int16_t)),
+                                     sizeof(float));
+    if (row == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    int16_t *row_q15 = (int16_t *)(row + hdr.feature_stride);
+
+    // Pack against the stored normalization tables before the image is unmapped
+    const float *inv_scale = (const float *)(image + hdr.scale_offset);
+    const float *offset = (const float *)(image + hdr.offset_offset);
+    float norm = template_matcher_pack_template(features, offset, inv_scale, packed_dim,
+                                                hdr.feature_stride, row, row_q15);
+
+    char slot_name[GESTURE_TEMPLATE_NAME_LEN] = {0};
+    strncpy(slot_name, name, GESTURE_TEMPLATE_NAME_LEN - 1);
+
+    info.has_sequence = (index < hdr.template_count) ? gesture_templates_get_info(index)->has_sequence : 0;
+
+    unmap_partition();
+
+    esp_err_t ret = write_region(hdr.names_offset + index * GESTURE_TEMPLATE_NAME_LEN, slot_name, sizeof(slot_name));
+    if (ret == ESP_OK) {
+        ret = write_region(hdr.info_offset + index * sizeof(info), &info, sizeof(info));
+    }
+    if (ret == ESP_OK) {
+        ret = write_region(hdr.matrix_offset + index * hdr.feature_stride * sizeof(float),
+                           row, hdr.feature_stride * sizeof(float));
+    }
+    if (ret == ESP_OK) {
+        ret = write_region(hdr.norms_offset + index * sizeof(float), &norm, sizeof(norm));
+    }
+    if (ret == ESP_OK) {
+        ret = write_region(hdr.matrix_q15_offset + index * hdr.feature_stride * sizeof(int16_t),
+                           row_q15, hdr.feature_stride * sizeof(int16_t));
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (index == hdr.template_count) {
+        hdr.template_count++;
+    }
+
+    ret = commit_header(&hdr);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Template '%s' stored in slot %u", slot_name, index);
+    }
+    return ret;
+}
+
+esp_err_t gesture_templates_set_sequence(const char* name, const float* sequence) {
+    if (!gesture_templates_initialized || header == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (name == NULL || sequence == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    gesture_templates_header_t hdr = *header;
+
+    int index = -1;
+    for (uint16_t i = 0; i < hdr.template_count; i++) {
+        if (strncmp(gesture_templates_get_name(i), name, GESTURE_TEMPLATE_NAME_LEN) == 0) {
+            index = i;
+            break;
+        }
+    }
+
+    if (index < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint32_t values = hdr.sequence_length * hdr.sequence_channels;
+    scratch_arena_reset(&template_arena);
+    float *scaled = scratch_arena_alloc(&template_arena, values * sizeof(float), sizeof(float));
+    if (scaled == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Scale like the query will be, so DTW compares scaled values directly
+    const float *inv_scale = (const float *)(image + hdr.sequence_scale_offset);
+    for (uint32_t v = 0; v < values; v++) {
+        scaled[v] = sequence[v] * inv_scale[v % hdr.sequence_channels];
+    }
+
+    gesture_template_info_t info = *gesture_templates_get_info(index);
+    info.has_sequence = 1;
+
+    unmap_partition();
+
+    esp_err_t ret = write_region(hdr.sequence_offset + index * sequence_bytes(&hdr), scaled, values * sizeof(float));
+    if (ret == ESP_OK) {
+        ret = write_region(hdr.info_offset + index * sizeof(info), &info, sizeof(info));
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    return commit_header(&hdr);
+}
+
+const float* gesture_templates_get_sequence(uint8_t index) {
+    const gesture_template_info_t *info = gesture_templates_get_info(index);
+    if (info == NULL || !info->has_sequence) {
+        return NULL;
+    }
+    return (const float *)(image + header->sequence_offset + index * sequence_bytes(header));
+}
+
+const float* gesture_templates_get_sequence_scale(void) {
+    if (header == NULL) {
+        return NULL;
+    }
+    return (const float *)(image + header->sequence_scale_offset);
+}
+
+esp_err_t gesture_templates_get_sequence_shape(uint16_t* length, uint16_t* channels) {
+    if (length == NULL || channels == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (header == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *length = header->sequence_length;
+    *channels = header->sequence_channels;
+    return ESP_OK;
+}
+
+esp_err_t gesture_templates_get_by_name(const char* name, gesture_template_t* template) {
+    if (name == NULL || template == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t count = gesture_templates_get_count();
+    for (uint8_t i = 0; i < count; i++) {
+        if (strncmp(gesture_templates_get_name(i), name, GESTURE_TEMPLATE_NAME_LEN) == 0) {
+            return gesture_templates_get_by_index(i, template);
+        }
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t gesture_templates_get_by_index(uint8_t index, gesture_template_t* template) {
+    if (template == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (header == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (index >= header->template_count) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const gesture_template_info_t *info = gesture_templates_get_info(index);
+    const float *inv_scale = (const float *)(image + header->scale_offset);
+    const float *offset = (const float *)(image + header->offset_offset);
+    const float *row = (const float *)(image + header->matrix_offset) + index * header->feature_stride;
+
+    memset(template, 0, sizeof(gesture_template_t));
+    strncpy(template->name, gesture_templates_get_name(index), sizeof(template->name) - 1);
+
+    // Undo the normalization to hand back raw feature values
+    for (uint16_t i = 0; i < header->feature_dim; i++) {
+        template->features[i] = ((inv_scale[i] != 0.0f) ? row[i] / inv_scale[i] : 0.0f) + offset[i];
+    }
+    template->feature_count = header->feature_dim;
+    template->is_dynamic = info->is_dynamic != 0;
+    template->confidence_threshold = info->confidence_threshold;
+
+    return ESP_OK;
+}
+
+uint8_t gesture_templates_get_count(void) {
+    return (header != NULL) ? header->template_count : 0;
+}
+
+esp_err_t gesture_templates_get_set(template_set_t *set) {
+    if (set == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (header == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    set->count = header->template_count;
+    set->dim = header->feature_dim;
+    set->stride = header->feature_stride;
+    set->matrix = (const float *)(image + header->matrix_offset);
+    set->norms = (const float *)(image + header->norms_offset);
+    set->offset = (const float *)(image + header->offset_offset);
+    set->inv_scale = (const float *)(image + header->scale_offset);
+    set->matrix_q15 = (const int16_t *)(image + header->matrix_q15_offset);
+
+    return ESP_OK;
+}
+
+const char* gesture_templates_get_name(uint8_t index) {
+    if (header == NULL || index >= header->template_count) {
+        return NULL;
+    }
+    return (const char *)(image + header->names_offset + index * GESTURE_TEMPLATE_NAME_LEN);
+}
+
+const gesture_template_info_t* gesture_templates_get_info(uint8_t index) {
+    if (header == NULL || index >= header->template_count) {
+        return NULL;
+    }
+    return (const gesture_template_info_t *)(image + header->info_offset) + index;
+}
+
+esp_err_t gesture_templates_reset(void) {
+    if (!gesture_templates_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    gesture_templates_header_t hdr;
+    compute_layout(&hdr, MAX_GESTURE_TEMPLATES, GESTURE_TEMPLATE_FEATURES,
+                   GESTURE_SEQUENCE_LENGTH, GESTURE_SEQUENCE_CHANNELS);
+
+    unmap_partition();
+
+    if (hdr.total_size > image_slots_size(template_partition)) {
+        ESP_LOGE(TAG, "Template image (%lu bytes) does not fit a slot", (unsigned long)hdr.total_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Start from an empty image: erased header, no templates
+    esp_err_t ret = esp_partition_erase_range(template_partition, slot_base,
+                                              align_up(hdr.total_size, FLASH_SECTOR_SIZE));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to erase template partition: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    float inv_scale[TEMPLATE_MATCHER_STRIDE(GESTURE_TEMPLATE_FEATURES)] = {0};
+    float offset[TEMPLATE_MATCHER_STRIDE(GESTURE_TEMPLATE_FEATURES)] = {0};
+    for (uint16_t i = 0; i < GESTURE_TEMPLATE_FEATURES; i++) {
+        inv_scale[i] = 1.0f / feature_layout_scale(i);
+        offset[i] = feature_layout_offset(i);
+    }
+
+    ret = esp_partition_write(template_partition, slot_base + hdr.scale_offset, inv_scale, sizeof(inv_scale));
+    if (ret == ESP_OK) {
+        ret = esp_partition_write(template_partition, slot_base + hdr.offset_offset, offset, sizeof(offset));
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    float sequence_scale[GESTURE_SEQUENCE_CHANNELS];
+    for (uint16_t i = 0; i < GESTURE_SEQUENCE_CHANNELS; i++) {
+        sequence_scale[i] = 1.0f / default_sequence_scale(i);
+    }
+
+    ret = esp_partition_write(template_partition, slot_base + hdr.sequence_scale_offset,
+                              sequence_scale, sizeof(sequence_scale));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = commit_header(&hdr);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // Placeholder vocabulary until trained templates are flashed
+    float features[GESTURE_TEMPLATE_FEATURES] = {0};
+
+    // ASL 'A' is a fist with the thumb alongside
+    for (int i = 0; i < 10; i++) {
+        features[i] = 70.0f;  // All fingers curled (high angle values)
+    }
+    features[0] = 30.0f;      // Thumb is slightly less curled
+    features[1] = 40.0f;
+    ret = gesture_templates_add("A", features, GESTURE_TEMPLATE_FEATURES, false, false, CONFIDENCE_THRESHOLD);
+
+    // ASL 'B' is a flat hand with fingers together
+    if (ret == ESP_OK) {
+        memset(features, 0, sizeof(features));  // All fingers straight (low angle values)
+        ret = gesture_templates_add("B", features, GESTURE_TEMPLATE_FEATURES, false, false, CONFIDENCE_THRESHOLD);
+    }
+
+    return ret;
+}
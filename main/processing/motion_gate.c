@@ -0,0 +1,187 @@
+#include "processing/motion_gate.h"
+#include <string.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "config/system_config.h"
+
+static const char *TAG = "MOTION_GATE";
+
+#define FLEX_CHANNELS   (sizeof(((flex_sensor_data_t *)0)->angles) / sizeof(float))
+#if GLOVE_HAS_TOUCH
+#define TOUCH_CHANNELS  (sizeof(((touch_sensor_data_t *)0)->touch_status) / sizeof(bool))
+#endif
+
+// Pose at the last frame that went through the matcher, the centroid the
+// flex classifier measures frames against
+static float reference_angles[FLEX_CHANNELS];
+
+// Per-joint flex noise variance (deg²), from frame-to-frame differences so
+// a held pose's slow drift does not count as noise. Steps far outside a
+// joint's noise are bends and left out, so they do not raise the floor the
+// next pose change is judged by.
+static float noise_var[FLEX_CHANNELS];
+static float previous_angles[FLEX_CHANNELS];
+static bool previous_valid = false;
+#if GLOVE_HAS_TOUCH
+static bool reference_touch[TOUCH_CHANNELS];
+#endif
+static bool reference_valid = false;
+
+// Frames left in which each stage keeps running after its trigger
+static uint16_t static_frames_left = 0;
+static uint16_t dynamic_frames_left = 0;
+
+// Frames since the matcher last ran
+static uint16_t idle_frames = 0;
+
+static motion_gate_stats_t stats;
+
+static bool imu_moving(const sensor_data_t *sensor_data) {
+    if (!sensor_data->imu_data_valid) {
+        return false;
+    }
+
+    const imu_data_t *imu = &sensor_data->imu_data;
+    if (imu->motion) {
+        return true;
+    }
+
+    float gyro_sq = 0.0f;
+    float accel_sq = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        gyro_sq += imu->gyro[i] * imu->gyro[i];
+        accel_sq += imu->linear_accel[i] * imu->linear_accel[i];
+    }
+
+    return gyro_sq > MOTION_GATE_GYRO_DPS * MOTION_GATE_GYRO_DPS ||
+           accel_sq > MOTION_GATE_LINEAR_ACCEL * MOTION_GATE_LINEAR_ACCEL;
+}
+
+// Track each joint's sensor noise; half the mean squared step of a
+// stationary signal is its variance. Steps beyond MOTION_GATE_NOISE_CLIP
+// standard deviations of the step are skipped.
+static void update_noise(const float *angles) {
+    if (previous_valid) {
+        for (size_t i = 0; i < FLEX_CHANNELS; i++) {
+            float step = angles[i] - previous_angles[i];
+            float step_var = 2.0f * (noise_var[i] + MOTION_GATE_FLEX_NOISE_DEG * MOTION_GATE_FLEX_NOISE_DEG);
+            if (step * step > MOTION_GATE_NOISE_CLIP * MOTION_GATE_NOISE_CLIP * step_var) {
+                continue;
+            }
+            noise_var[i] += MOTION_GATE_NOISE_RATE * (0.5f * step * step - noise_var[i]);
+        }
+    }
+    memcpy(previous_angles, angles, sizeof(previous_angles));
+    previous_valid = true;
+}
+
+// Flex-only stage: a nearest-centroid test of the flex vector against the
+// pose the matcher last saw. Each joint's distance is scaled by its noise,
+// so a noisy sensor does not trigger the matcher on its own while a small
+// bend shared by several joints does. Any touch pad change counts too.
+static bool pose_changed(const sensor_data_t *sensor_data) {
+    if (!reference_valid) {
+        return true;
+    }
+
+    if (sensor_data->flex_data_valid) {
+        const float *angles = sensor_data->flex_data.angles;
+        update_noise(angles);
+
+        float distance = 0.0f;
+        for (size_t i = 0; i < FLEX_CHANNELS; i++) {
+            float delta = angles[i] - reference_angles[i];
+            float scale = MOTION_GATE_FLEX_NOISE_DEG * MOTION_GATE_FLEX_NOISE_DEG +
+                          MOTION_GATE_NOISE_MARGIN * noise_var[i];
+            distance += delta * delta / scale;
+        }
+        if (distance > MOTION_GATE_POSE_DISTANCE * FLEX_CHANNELS) {
+            return true;
+        }
+    }
+
+#if GLOVE_HAS_TOUCH
+    if (sensor_data->touch_data_valid &&
+        memcmp(sensor_data->touch_data.touch_status, reference_touch, sizeof(reference_touch)) != 0) {
+        return true;
+    }
+#endif
+
+    return false;
+}
+
+static void capture_reference(const sensor_data_t *sensor_data) {
+    if (sensor_data->flex_data_valid) {
+        memcpy(reference_angles, sensor_data->flex_data.angles, sizeof(reference_angles));
+        reference_valid = true;
+    }
+#if GLOVE_HAS_TOUCH
+    if (sensor_data->touch_data_valid) {
+        memcpy(reference_touch, sensor_data->touch_data.touch_status, sizeof(reference_touch));
+    }
+#endif
+}
+
+esp_err_t motion_gate_init(void) {
+    memset(&stats, 0, sizeof(stats));
+    reference_valid = false;
+    previous_valid = false;
+    memset(noise_var, 0, sizeof(noise_var));
+    static_frames_left = 0;
+    dynamic_frames_left = 0;
+    idle_frames = 0;
+
+    ESP_LOGI(TAG, "Motion gate %s", MOTION_GATE_ENABLED ? "enabled" : "disabled");
+    return ESP_OK;
+}
+
+motion_gate_decision_t motion_gate_evaluate(const sensor_data_t *sensor_data) {
+    if (!MOTION_GATE_ENABLED || sensor_data == NULL) {
+        return MOTION_GATE_DYNAMIC;
+    }
+
+    if (imu_moving(sensor_data)) {
+        // The flex step across a movement is not sensor noise
+        previous_valid = false;
+        dynamic_frames_left = MOTION_GATE_DYNAMIC_FRAMES;
+        static_frames_left = MOTION_GATE_SETTLE_FRAMES;
+    } else if (pose_changed(sensor_data)) {
+        static_frames_left = MOTION_GATE_SETTLE_FRAMES;
+    }
+
+    motion_gate_decision_t decision;
+    if (dynamic_frames_left > 0) {
+        dynamic_frames_left--;
+        decision = MOTION_GATE_DYNAMIC;
+    } else if (static_frames_left > 0) {
+        static_frames_left--;
+        decision = MOTION_GATE_STATIC;
+    } else if (++idle_frames >= MOTION_GATE_IDLE_INTERVAL) {
+        // Keep-alive, so a slow drift or a missed trigger is caught eventually
+        decision = MOTION_GATE_STATIC;
+    } else {
+        stats.idle++;
+        return MOTION_GATE_IDLE;
+    }
+
+    // The next frames are compared with the pose the matcher just saw
+    capture_reference(sensor_data);
+    idle_frames = 0;
+
+    if (decision == MOTION_GATE_DYNAMIC) {
+        stats.dynamic++;
+    } else {
+        stats.static_pose++;
+    }
+
+    return decision;
+}
+
+esp_err_t motion_gate_get_stats(motion_gate_stats_t *stats_out) {
+    if (stats_out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *stats_out = stats;
+    return ESP_OK;
+}
@@ -0,0 +1,57 @@
+#ifndef PROCESSING_MOTION_GATE_H
+#define PROCESSING_MOTION_GATE_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "util/buffer.h"
+
+/**
+ * @brief Pipeline stages an aligned frame needs
+ */
+typedef enum {
+    MOTION_GATE_IDLE = 0,       // Nothing changed, skip features and matching
+    MOTION_GATE_STATIC,         // Hand pose changed, run the static pose matcher
+    MOTION_GATE_DYNAMIC         // Hand moving, run the pose matcher and DTW
+} motion_gate_decision_t;
+
+/**
+ * @brief Counters of the decisions taken since init
+ */
+typedef struct {
+    uint32_t idle;
+    uint32_t static_pose;
+    uint32_t dynamic;
+} motion_gate_stats_t;
+
+/**
+ * @brief Initialize the motion gate
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t motion_gate_init(void);
+
+/**
+ * @brief Decide which pipeline stages an aligned frame needs
+ *
+ * The first stage only looks at the IMU motion interrupt, the angular rate,
+ * the linear acceleration and a nearest-centroid test of the flex angles
+ * against the last evaluated pose, scaled by each joint's noise, so it costs
+ * a few dozen flops. The pose matcher keeps
+ * running for MOTION_GATE_SETTLE_FRAMES after the flex angles change, DTW for
+ * MOTION_GATE_DYNAMIC_FRAMES after the hand stops moving, and an idle hand is
+ * still checked once every MOTION_GATE_IDLE_INTERVAL frames.
+ *
+ * @param sensor_data Aligned sensor frame
+ * @return Stages to run for this frame
+ */
+motion_gate_decision_t motion_gate_evaluate(const sensor_data_t *sensor_data);
+
+/**
+ * @brief Get the decision counters
+ *
+ * @param stats Pointer to store the counters
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t motion_gate_get_stats(motion_gate_stats_t *stats);
+
+#endif /* PROCESSING_MOTION_GATE_H */
@@ -3,8 +3,16 @@
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "drivers/flex_sensor.h"
+#include "drivers/imu.h"
+#include "config/system_config.h"
+#if GLOVE_HAS_TOUCH
+#include "drivers/touch.h"
+#endif
+#include "util/ahrs.h"
 #include "util/buffer.h"
 #include "util/debug.h"
+#include "math.h"
 
 static const char *TAG = "SENSOR_FUSION";
 
@@ -13,39 +21,217 @@ static const char *TAG = "SENSOR_FUSION";
 #define ALPHA_IMU           0.2f    // IMU weight in fusion
 #define ALPHA_CAMERA        0.1f    // Camera weight in fusion (small due to higher latency)
 
+// Depth of the per-stream sample rings
+#define FUSION_CONTINUOUS_DEPTH  (8)
+#define FUSION_TOUCH_DEPTH       (8)
+#define FUSION_MAX_DEPTH         (8)
+
+// Fusion clock period in milliseconds
+#define FUSION_PERIOD_MS         (1000 / SENSOR_FUSION_RATE_HZ)
+
+/**
+ * Timestamps of one stream's recent samples; the samples themselves live in
+ * a parallel array of the stream's own type
+ */
+typedef struct {
+    uint32_t timestamps[FUSION_MAX_DEPTH];
+    uint8_t depth;
+    uint8_t head;             // Slot of the next write
+    uint8_t count;
+} stream_ring_t;
+
+// Recent samples per stream
+static stream_ring_t flex_ring;
+static flex_sensor_data_t flex_samples[FUSION_CONTINUOUS_DEPTH];
+static stream_ring_t imu_ring;
+static imu_data_t imu_samples[FUSION_CONTINUOUS_DEPTH];
+#if GLOVE_HAS_TOUCH
+static stream_ring_t touch_ring;
+static uint8_t touch_masks[FUSION_TOUCH_DEPTH];
+#endif
+
+// Latest camera ROI, held with one reference
+static camera_roi_desc_t held_roi;
+static bool held_roi_valid = false;
+
+// Fusion clock, on sensor time
+static bool clock_started = false;
+static uint32_t next_tick_ms = 0;
+static uint32_t newest_sample_ms = 0;
+static uint32_t tick_count = 0;
+
+#if GLOVE_HAS_TOUCH
+// Touch level carried across ticks
+static uint8_t touch_level = 0;
+#endif
+
+// IMU motion interrupt seen since the last aligned frame. Several IMU samples
+// fall between two ticks, so the flag is carried rather than interpolated.
+static bool imu_motion_pending = false;
+
 // Last fused sensor data for reference
 static sensor_data_t last_fused_data;
 
 // Initialized flag
 static bool sensor_fusion_initialized = false;
 
-esp_err_t sensor_fusion_init(void) {
-    // Initialize fusion state
-    memset(&last_fused_data, 0, sizeof(sensor_data_t));
-    
-    sensor_fusion_initialized = true;
-    ESP_LOGI(TAG, "Sensor fusion initialized");
-    
-    return ESP_OK;
+static inline bool time_after(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) > 0;
 }
 
-esp_err_t sensor_fusion_deinit(void) {
-    sensor_fusion_initialized = false;
-    ESP_LOGI(TAG, "Sensor fusion deinitialized");
-    
-    return ESP_OK;
+static void ring_init(stream_ring_t *ring, uint8_t depth) {
+    memset(ring, 0, sizeof(stream_ring_t));
+    ring->depth = depth;
 }
 
-esp_err_t sensor_fusion_process(sensor_data_t *new_data, sensor_data_buffer_t *data_buffer) {
-    if (!sensor_fusion_initialized || new_data == NULL || data_buffer == NULL) {
-        return ESP_ERR_INVALID_STATE;
+// Slot of the sample `age` steps back from the newest
+static inline uint8_t ring_slot(const stream_ring_t *ring, uint8_t age) {
+    return (ring->head + ring->depth - 1 - age) % ring->depth;
+}
+
+static inline uint32_t ring_newest_time(const stream_ring_t *ring) {
+    return ring->timestamps[ring_slot(ring, 0)];
+}
+
+// Claim a slot for a sample if it is newer than the last one; returns false otherwise
+static bool ring_push(stream_ring_t *ring, uint32_t timestamp, uint8_t *slot) {
+    if (ring->count > 0 && !time_after(timestamp, ring_newest_time(ring))) {
+        return false;
     }
-    
+
+    *slot = ring->head;
+    ring->timestamps[ring->head] = timestamp;
+    ring->head = (ring->head + 1) % ring->depth;
+    if (ring->count < ring->depth) {
+        ring->count++;
+    }
+
+    if (!clock_started) {
+        next_tick_ms = timestamp;
+        newest_sample_ms = timestamp;
+        clock_started = true;
+    } else if (time_after(timestamp, newest_sample_ms)) {
+        newest_sample_ms = timestamp;
+    }
+
+    return true;
+}
+
+// Samples around t and the weight of the newer one. Outside the stored
+// span both are the nearest sample, which holds its value.
+static void ring_bracket(const stream_ring_t *ring, uint32_t t,
+                         uint8_t *older, uint8_t *newer, float *weight) {
+    uint8_t b = ring_slot(ring, 0);
+    *older = b;
+    *newer = b;
+    *weight = 0.0f;
+
+    if (!time_after(ring->timestamps[b], t)) {
+        return;
+    }
+
+    for (uint8_t age = 1; age < ring->count; age++) {
+        uint8_t a = ring_slot(ring, age);
+        if (!time_after(ring->timestamps[a], t)) {
+            uint32_t span = ring->timestamps[b] - ring->timestamps[a];
+            *older = a;
+            *newer = b;
+            *weight = (span > 0) ? (float)(t - ring->timestamps[a]) / span : 0.0f;
+            return;
+        }
+        b = a;
+    }
+
+    // Before the oldest sample
+    *older = b;
+    *newer = b;
+}
+
+static inline bool stream_fresh(const stream_ring_t *ring, uint32_t t) {
+    return ring->count > 0 && (int32_t)(t - ring_newest_time(ring)) <= SENSOR_FUSION_STALE_MS;
+}
+
+static inline float lerp(float a, float b, float w) {
+    return a + (b - a) * w;
+}
+
+static void align_flex(uint32_t t, flex_sensor_data_t *out) {
+    uint8_t a, b;
+    float w;
+    ring_bracket(&flex_ring, t, &a, &b, &w);
+
+    for (int i = 0; i < FINGER_JOINT_COUNT; i++) {
+        out->angles[i] = lerp(flex_samples[a].angles[i], flex_samples[b].angles[i], w);
+        out->raw_values[i] = (uint16_t)(lerp(flex_samples[a].raw_values[i], flex_samples[b].raw_values[i], w) + 0.5f);
+    }
+    out->timestamp = t;
+}
+
+static void align_imu(uint32_t t, imu_data_t *out) {
+    uint8_t a, b;
+    float w;
+    ring_bracket(&imu_ring, t, &a, &b, &w);
+
+    const imu_data_t *ia = &imu_samples[a];
+    const imu_data_t *ib = &imu_samples[b];
+
+    for (int i = 0; i < 3; i++) {
+        out->accel[i] = lerp(ia->accel[i], ib->accel[i], w);
+        out->gyro[i] = lerp(ia->gyro[i], ib->gyro[i], w);
+        out->gravity[i] = lerp(ia->gravity[i], ib->gravity[i], w);
+        out->linear_accel[i] = lerp(ia->linear_accel[i], ib->linear_accel[i], w);
+    }
+
+    // Normalised lerp along the shorter arc; samples are close enough that slerp buys nothing
+    float dot = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        dot += ia->quaternion[i] * ib->quaternion[i];
+    }
+    float sign = (dot < 0.0f) ? -1.0f : 1.0f;
+    float norm_sq = 0.0f;
+    for (int i = 0; i < 4; i++) {
+        out->quaternion[i] = lerp(ia->quaternion[i], sign * ib->quaternion[i], w);
+        norm_sq += out->quaternion[i] * out->quaternion[i];
+    }
+    if (norm_sq > 0.0f) {
+        float inv_norm = ahrs_inv_sqrt(norm_sq);
+        for (int i = 0; i < 4; i++) {
+            out->quaternion[i] *= inv_norm;
+        }
+    }
+
+    out->temp = ib->temp;
+    out->timestamp = t;
+}
+
+#if GLOVE_HAS_TOUCH
+static void align_touch(uint32_t previous_t, uint32_t t, touch_sensor_data_t *out) {
+    // Level follows the latest sample up to t; presses inside the tick are latched
+    uint8_t latched = 0;
+    for (int age = touch_ring.count - 1; age >= 0; age--) {
+        uint8_t slot = ring_slot(&touch_ring, age);
+        uint32_t ts = touch_ring.timestamps[slot];
+        if (time_after(ts, previous_t) && !time_after(ts, t)) {
+            latched |= touch_masks[slot];
+            touch_level = touch_masks[slot];
+        }
+    }
+
+    uint8_t mask = touch_level | latched;
+    for (int i = 0; i < TOUCH_SENSOR_COUNT; i++) {
+        out->touch_status[i] = (mask >> i) & 0x01;
+    }
+    out->timestamp = t;
+}
+#endif
+
+// Cross-sensor corrections on an aligned frame
+static void apply_fusion(sensor_data_t *frame) {
     // Simple complementary filter-based fusion
     // In a complete implementation, this would be more sophisticated
     
     // If we have both flex and IMU data valid, perform fusion
-    if (new_data->flex_data_valid && new_data->imu_data_valid) {
+    if (frame->flex_data_valid && frame->imu_data_valid) {
         // For this basic version, we simply use the data as-is
         // A full implementation would fuse the data using more complex algorithms
         
@@ -53,8 +239,10 @@ esp_err_t sensor_fusion_process(sensor_data_t *new_data, sensor_data_buffer_t *d
         // This is a simplistic approach - in reality, you'd use a more sophisticated model
         
         // Get hand orientation from IMU
-        float roll = new_data->imu_data.orientation[0];
-        float pitch = new_data->imu_data.orientation[1];
+        float euler[3];
+        imu_get_euler(&frame->imu_data, euler);
+        float roll = euler[0];
+        float pitch = euler[1];
         
         // Apply small corrections to flex sensor readings based on orientation
         // This is just an illustrative example - real fusion would be more complex
@@ -63,24 +251,159 @@ esp_err_t sensor_fusion_process(sensor_data_t *new_data, sensor_data_buffer_t *d
             float orientation_factor = 1.0f - (fabs(roll) + fabs(pitch)) / 180.0f * 0.1f;
             
             // Apply the correction factor (limited effect for demonstration)
-            new_data->flex_data.angles[i] *= orientation_factor;
+            frame->flex_data.angles[i] *= orientation_factor;
         }
     }
     
     // If we have camera data, we could use it to validate/correct the other sensors
     // This is just a placeholder example
-    if (new_data->camera_data_valid) {
+    const camera_roi_desc_t *roi = camera_roi_get_desc(frame->camera_roi);
+    if (roi != NULL) {
         // In a real implementation, computer vision would extract hand pose
         // and could be used to correct other sensor readings
         
         // This is where you'd add computer vision processing
         // For now, we just log that we have camera data
-        ESP_LOGV(TAG, "Camera data available for fusion (frame size: %dx%d)", 
-                new_data->camera_data.width, new_data->camera_data.height);
+        ESP_LOGV(TAG, "Camera ROI available for fusion (window %d px at %d,%d, motion %d)", 
+                roi->size, roi->x, roi->y, roi->motion);
+    }
+}
+
+esp_err_t sensor_fusion_init(void) {
+    // Initialize fusion state
+    memset(&last_fused_data, 0, sizeof(sensor_data_t));
+    last_fused_data.camera_roi = CAMERA_ROI_INVALID;
+    
+    ring_init(&flex_ring, FUSION_CONTINUOUS_DEPTH);
+    ring_init(&imu_ring, FUSION_CONTINUOUS_DEPTH);
+#if GLOVE_HAS_TOUCH
+    ring_init(&touch_ring, FUSION_TOUCH_DEPTH);
+    touch_level = 0;
+#endif
+    held_roi_valid = false;
+    clock_started = false;
+    tick_count = 0;
+    imu_motion_pending = false;
+    
+    sensor_fusion_initialized = true;
+    ESP_LOGI(TAG, "Sensor fusion initialized (%d Hz aligned output)", SENSOR_FUSION_RATE_HZ);
+    
+    return ESP_OK;
+}
+
+esp_err_t sensor_fusion_deinit(void) {
+    if (held_roi_valid) {
+        camera_roi_release(held_roi.roi_index);
+        held_roi_valid = false;
+    }
+    
+    sensor_fusion_initialized = false;
+    ESP_LOGI(TAG, "Sensor fusion deinitialized");
+    
+    return ESP_OK;
+}
+
+esp_err_t sensor_fusion_ingest(const sensor_data_t *frame) {
+    if (!sensor_fusion_initialized || frame == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    uint8_t slot;
+    
+    if (frame->flex_data_valid && ring_push(&flex_ring, frame->flex_data.timestamp, &slot)) {
+        flex_samples[slot] = frame->flex_data;
+    }
+    
+    if (frame->imu_data_valid && ring_push(&imu_ring, frame->imu_data.timestamp, &slot)) {
+        imu_samples[slot] = frame->imu_data;
     }
+    if (frame->imu_data_valid && frame->imu_data.motion) {
+        imu_motion_pending = true;
+    }
+    
+#if GLOVE_HAS_TOUCH
+    if (frame->touch_data_valid && ring_push(&touch_ring, frame->touch_data.timestamp, &slot)) {
+        uint8_t mask = 0;
+        for (int i = 0; i < TOUCH_SENSOR_COUNT; i++) {
+            if (frame->touch_data.touch_status[i]) {
+                mask |= 1 << i;
+            }
+        }
+        touch_masks[slot] = mask;
+    }
+#endif
+    
+    // Hold the newest ROI with our own reference
+    const camera_roi_desc_t *roi = camera_roi_get_desc(frame->camera_roi);
+    if (roi != NULL && (!held_roi_valid || time_after(roi->timestamp, held_roi.timestamp))) {
+        camera_roi_retain(frame->camera_roi);
+        if (held_roi_valid) {
+            camera_roi_release(held_roi.roi_index);
+        }
+        held_roi = *roi;
+        held_roi_valid = true;
+    }
+    
+    return ESP_OK;
+}
+
+esp_err_t sensor_fusion_get_aligned(sensor_data_t *aligned) {
+    if (!sensor_fusion_initialized || aligned == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    if (!clock_started) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    // After a long gap, restart the clock instead of replaying empty ticks
+    if ((int32_t)(newest_sample_ms - next_tick_ms) > SENSOR_FUSION_STALE_MS + SENSOR_FUSION_LATENCY_MS) {
+        next_tick_ms = newest_sample_ms - SENSOR_FUSION_LATENCY_MS;
+    }
+    
+    // Wait until samples on both sides of the tick have had time to arrive
+    if ((int32_t)(newest_sample_ms - next_tick_ms) < SENSOR_FUSION_LATENCY_MS) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    
+    uint32_t t = next_tick_ms;
+    next_tick_ms += FUSION_PERIOD_MS;
+    
+    memset(aligned, 0, sizeof(sensor_data_t));
+    
+    aligned->flex_data_valid = stream_fresh(&flex_ring, t);
+    if (aligned->flex_data_valid) {
+        align_flex(t, &aligned->flex_data);
+    }
+    
+    aligned->imu_data_valid = stream_fresh(&imu_ring, t);
+    if (aligned->imu_data_valid) {
+        align_imu(t, &aligned->imu_data);
+        aligned->imu_data.motion = imu_motion_pending;
+        imu_motion_pending = false;
+    }
+    
+#if GLOVE_HAS_TOUCH
+    // Touch is event driven, so its level stays valid without fresh samples
+    aligned->touch_data_valid = touch_ring.count > 0;
+    if (aligned->touch_data_valid) {
+        align_touch(t - FUSION_PERIOD_MS, t, &aligned->touch_data);
+    }
+#endif
+    
+    // No reference of its own: fusion keeps holding the slot
+    aligned->camera_roi = CAMERA_ROI_INVALID;
+    if (held_roi_valid && (int32_t)(t - held_roi.timestamp) <= SENSOR_FUSION_STALE_MS) {
+        aligned->camera_roi = held_roi.roi_index;
+    }
+    
+    aligned->timestamp = t;
+    aligned->sequence_number = tick_count++;
+    
+    apply_fusion(aligned);
     
-    // Store the current data as the last fused data for next iteration
-    memcpy(&last_fused_data, new_data, sizeof(sensor_data_t));
+    // Store the aligned frame as the last fused data
+    memcpy(&last_fused_data, aligned, sizeof(sensor_data_t));
     
     return ESP_OK;
 }
@@ -19,13 +19,33 @@ esp_err_t sensor_fusion_init(void);
 esp_err_t sensor_fusion_deinit(void);
 
 /**
- * @brief Process sensor data through sensor fusion
+ * @brief Feed a sensor frame into the alignment stage
  * 
- * @param new_data Pointer to current sensor data
- * @param data_buffer Buffer containing historical sensor data
+ * Each stream (flex, IMU, touch, camera) is picked up only when its own
+ * timestamp has moved on, so frames that repeat an older sample of a
+ * stream add nothing. The frame is copied; the caller keeps ownership.
+ * 
+ * @param frame Sensor frame from the sensor task
  * @return ESP_OK on success, error code otherwise
  */
-esp_err_t sensor_fusion_process(sensor_data_t *new_data, sensor_data_buffer_t *data_buffer);
+esp_err_t sensor_fusion_ingest(const sensor_data_t *frame);
+
+/**
+ * @brief Get the next aligned frame on the fusion clock
+ * 
+ * Ticks run every 1/SENSOR_FUSION_RATE_HZ on sensor time and are emitted
+ * once the newest sample is SENSOR_FUSION_LATENCY_MS past the tick, so
+ * continuous channels can be interpolated between the samples around it.
+ * Touch is held at its last level, with any press seen since the
+ * previous tick latched on. Call repeatedly until ESP_ERR_NOT_FOUND.
+ * 
+ * The camera ROI in the output is borrowed from the fusion stage and
+ * stays valid until the next call to sensor_fusion_ingest().
+ * 
+ * @param aligned Pointer to store the aligned, fused frame
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no tick is due yet
+ */
+esp_err_t sensor_fusion_get_aligned(sensor_data_t *aligned);
 
 /**
  * @brief Get the latest fused sensor data
@@ -35,4 +55,4 @@ esp_err_t sensor_fusion_process(sensor_data_t *new_data, sensor_data_buffer_t *d
  */
 esp_err_t sensor_fusion_get_latest(sensor_data_t *data);
 
-#endif /* PROCESSING_SENSOR_FUSION_H */
\ No newline at end of file
+#endif /* PROCESSING_SENSOR_FUSION_H */
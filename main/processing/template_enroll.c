@@ -0,0 +1,283 @@
+#include "processing/template_enroll.h"
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "image_slots.h"
+#include "config/memory_layout.h"
+#include "core/telemetry.h"
+#include "processing/feature_layout.h"
+#include "processing/template_view.h"
+#include "gesture_templates.h"
+
+static const char *TAG = "TEMPLATE_ENROLL";
+
+#define ENROLL_SEQUENCE_VALUES  (GESTURE_SEQUENCE_LENGTH * GESTURE_SEQUENCE_CHANNELS)
+
+// What the persist task does with a record
+typedef enum {
+    PERSIST_STORE = 0,          // Write the template
+    PERSIST_ACTIVATE            // Switch the store to the pack in an image slot
+} persist_op_t;
+
+// A published template waiting to be written to flash, or a pack to switch to
+typedef struct {
+    persist_op_t op;
+    uint8_t slot;                               // PERSIST_ACTIVATE: image slot of the pack
+    TaskHandle_t waiter;                        // PERSIST_ACTIVATE: notified with the result
+    char name[GESTURE_TEMPLATE_NAME_LEN];
+    gesture_template_info_t info;
+    float features[FEATURE_BUFFER_SIZE];
+    uint16_t feature_count;
+    float sequence[ENROLL_SEQUENCE_VALUES];
+} persist_record_t;
+
+// Repetitions collected so far for one gesture
+typedef struct {
+    char name[GESTURE_TEMPLATE_NAME_LEN];
+    bool is_dynamic;
+    bool two_handed;
+    uint16_t dim;                               // Features averaged, one or both hands
+    uint16_t count;
+    float mean[FEATURE_BUFFER_SIZE];
+    float m2[FEATURE_BUFFER_SIZE];              // Sum of squared deviations (Welford)
+    float sequence_mean[ENROLL_SEQUENCE_VALUES];
+} enroll_session_t;
+
+static enroll_session_t session;
+static persist_record_t record;
+static persist_record_t activate_record;
+static QueueHandle_t persist_queue = NULL;
+static TaskHandle_t persist_task_handle = NULL;
+STATIC_TASK_STORAGE(persist_task, TEMPLATE_PERSIST_STACK_SIZE);
+
+// Kilobytes per record and written out at flash speed, so queued in PSRAM
+static MEM_BULK uint8_t persist_queue_storage[GESTURE_ENROLL_QUEUE * sizeof(persist_record_t)];
+static StaticQueue_t persist_queue_buffer;
+
+// Switch the store to a pack, then the classifier; a pack the snapshots
+// cannot take is switched back out of the store
+static esp_err_t activate_pack(uint8_t slot) {
+    esp_err_t ret = gesture_templates_activate_slot(slot);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = template_view_reload();
+    if (ret != ESP_OK) {
+        gesture_templates_activate_slot((slot + 1) % IMAGE_SLOT_COUNT);
+    }
+    return ret;
+}
+
+// Written out one template at a time, well below the classifier's priority.
+// The only writer of the template store, so packs are switched here too.
+static void persist_task(void *arg) {
+    (void)arg;
+
+    // Received by copy, so the enrolling task can fill the next record meanwhile
+    static persist_record_t pending;
+
+    while (1) {
+        if (xQueueReceive(persist_queue, &pending, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        if (pending.op == PERSIST_ACTIVATE) {
+            esp_err_t ret = activate_pack(pending.slot);
+            xTaskNotify(pending.waiter, (uint32_t)ret, eSetValueWithOverwrite);
+            continue;
+        }
+
+        esp_err_t ret = gesture_templates_add(pending.name, pending.features, pending.feature_count,
+                                              pending.info.is_dynamic != 0, pending.info.two_handed != 0,
+                                              pending.info.confidence_threshold);
+        if (ret == ESP_OK && pending.info.has_sequence) {
+            ret = gesture_templates_set_sequence(pending.name, pending.sequence);
+        }
+
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to store template '%s': %s (live until reboot)",
+                     pending.name, esp_err_to_name(ret));
+        } else {
+            ESP_LOGI(TAG, "Template '%s' stored", pending.name);
+        }
+    }
+}
+
+// Confidence threshold that still accepts repetitions as spread out as the enrolled ones
+static float spread_threshold(const template_set_t *set) {
+    if (session.count < 2) {
+        return CONFIDENCE_THRESHOLD;
+    }
+
+    // Expected mean squared scaled distance of a repetition to the centroid
+    float spread = 0.0f;
+    for (uint16_t i = 0; i < session.dim; i++) {
+        float variance = session.m2[i] / (session.count - 1);
+        spread += variance * set->inv_scale[i] * set->inv_scale[i];
+    }
+    spread /= session.dim;
+
+    float threshold = 1.0f / (1.0f + GESTURE_ENROLL_SPREAD * spread);
+    if (threshold > CONFIDENCE_THRESHOLD) {
+        threshold = CONFIDENCE_THRESHOLD;
+    } else if (threshold < GESTURE_ENROLL_MIN_CONF) {
+        threshold = GESTURE_ENROLL_MIN_CONF;
+    }
+    return threshold;
+}
+
+// Hand the finished centroid to the classifier, then queue it for flash
+static esp_err_t publish_session(const template_set_t *set) {
+    memset(&record, 0, sizeof(record));
+    snprintf(record.name, sizeof(record.name), "%s", session.name);
+    memcpy(record.features, session.mean, session.dim * sizeof(float));
+    record.feature_count = session.dim;
+    record.info.confidence_threshold = spread_threshold(set);
+    record.info.is_dynamic = session.is_dynamic ? 1 : 0;
+    record.info.has_sequence = session.is_dynamic ? 1 : 0;
+    record.info.two_handed = session.two_handed ? 1 : 0;
+    if (session.is_dynamic) {
+        memcpy(record.sequence, session.sequence_mean, sizeof(record.sequence));
+    }
+
+    esp_err_t ret = template_view_publish(record.name, record.features, &record.info,
+                                          session.is_dynamic ? record.sequence : NULL, NULL);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (telemetry_queue_send(TELEMETRY_QUEUE_TEMPLATE_PERSIST, &record, pdMS_TO_TICKS(GESTURE_ENROLL_WAIT_MS)) != pdTRUE) {
+        ESP_LOGW(TAG, "Persist queue full, template '%s' live until reboot", record.name);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    ESP_LOGI(TAG, "Enrolled '%s' from %u repetitions (threshold %.2f)",
+             record.name, session.count, record.info.confidence_threshold);
+    return ESP_OK;
+}
+
+esp_err_t template_enroll_init(void) {
+    if (persist_queue != NULL) {
+        return ESP_OK;
+    }
+
+    persist_queue = xQueueCreateStatic(GESTURE_ENROLL_QUEUE, sizeof(persist_record_t),
+                                       persist_queue_storage, &persist_queue_buffer);
+    if (persist_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create persist queue");
+        return ESP_ERR_NO_MEM;
+    }
+    telemetry_register_queue(TELEMETRY_QUEUE_TEMPLATE_PERSIST, persist_queue);
+
+    persist_task_handle = STATIC_TASK_CREATE_PINNED(persist_task, "template_persist", TEMPLATE_PERSIST_STACK_SIZE,
+                                                    NULL, TEMPLATE_PERSIST_PRIORITY, TEMPLATE_PERSIST_CORE);
+    if (persist_task_handle == NULL) {
+        ESP_LOGE(TAG, "Failed to create persist task");
+        telemetry_register_queue(TELEMETRY_QUEUE_TEMPLATE_PERSIST, NULL);
+        vQueueDelete(persist_queue);
+        persist_queue = NULL;
+        return ESP_FAIL;
+    }
+
+    template_enroll_cancel();
+    return ESP_OK;
+}
+
+esp_err_t template_enroll_add(const char *name, const float *features, uint16_t feature_count,
+                              const float *sequence, bool two_handed, uint16_t *remaining) {
+    if (name == NULL || name[0] == '\0' || features == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const template_view_t *view = template_view_peek();
+    if (view == NULL || persist_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const template_set_t *set = &view->set;
+    if (two_handed && set->dim <= GESTURE_HAND_FEATURES) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // Single-handed gestures only average the wearer's hand
+    gesture_template_info_t shape = { .two_handed = two_handed ? 1 : 0 };
+    uint16_t dim = gesture_templates_packed_dim(&shape, set->dim);
+    if (feature_count < dim || dim > FEATURE_BUFFER_SIZE) {
+        ESP_LOGE(TAG, "Template needs %u features, got %u", dim, feature_count);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    bool is_dynamic = (sequence != NULL);
+    if (is_dynamic && (view->sequence_length != GESTURE_SEQUENCE_LENGTH ||
+                       view->sequence_channels != GESTURE_SEQUENCE_CHANNELS)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // A different gesture starts over
+    if (session.count == 0 || session.is_dynamic != is_dynamic || session.two_handed != two_handed ||
+        strncmp(session.name, name, GESTURE_TEMPLATE_NAME_LEN - 1) != 0) {
+        template_enroll_cancel();
+        strncpy(session.name, name, sizeof(session.name) - 1);
+        session.is_dynamic = is_dynamic;
+        session.two_handed = two_handed;
+        session.dim = dim;
+    }
+
+    // Welford update of the centroid and spread
+    session.count++;
+    for (uint16_t i = 0; i < session.dim; i++) {
+        float delta = features[i] - session.mean[i];
+        session.mean[i] += delta / session.count;
+        session.m2[i] += delta * (features[i] - session.mean[i]);
+    }
+    if (is_dynamic) {
+        for (int v = 0; v < ENROLL_SEQUENCE_VALUES; v++) {
+            session.sequence_mean[v] += (sequence[v] - session.sequence_mean[v]) / session.count;
+        }
+    }
+
+    if (session.count < GESTURE_ENROLL_REPETITIONS) {
+        if (remaining != NULL) {
+            *remaining = GESTURE_ENROLL_REPETITIONS - session.count;
+        }
+        return ESP_OK;
+    }
+
+    esp_err_t ret = publish_session(set);
+    template_enroll_cancel();
+
+    if (remaining != NULL) {
+        *remaining = 0;
+    }
+    return ret;
+}
+
+void template_enroll_cancel(void) {
+    memset(&session, 0, sizeof(session));
+}
+
+esp_err_t template_enroll_activate_pack(uint8_t slot) {
+    if (persist_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Queued behind the templates enrolled before it, which land in the old pack
+    memset(&activate_record, 0, sizeof(activate_record));
+    activate_record.op = PERSIST_ACTIVATE;
+    activate_record.slot = slot;
+    activate_record.waiter = xTaskGetCurrentTaskHandle();
+    xTaskNotifyStateClear(NULL);
+
+    if (telemetry_queue_send(TELEMETRY_QUEUE_TEMPLATE_PERSIST, &activate_record,
+                             pdMS_TO_TICKS(GESTURE_ENROLL_WAIT_MS)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    uint32_t result = ESP_FAIL;
+    xTaskNotifyWait(0, UINT32_MAX, &result, portMAX_DELAY);
+    return (esp_err_t)result;
+}
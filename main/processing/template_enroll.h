@@ -0,0 +1,68 @@
+#ifndef PROCESSING_TEMPLATE_ENROLL_H
+#define PROCESSING_TEMPLATE_ENROLL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "config/system_config.h"
+
+/**
+ * @brief On-device template enrollment
+ *
+ * Repetitions of a gesture are folded into a running centroid and
+ * per-feature variance. Once GESTURE_ENROLL_REPETITIONS have been seen the
+ * centroid is published to the classifier through the template view, with
+ * a confidence threshold loosened to the spread of the repetitions, and
+ * queued for a background task that writes it to the template store. The
+ * classifier keeps running throughout; only the enrolling task waits.
+ */
+
+/**
+ * @brief Initialize enrollment and start the persistence task
+ *
+ * The template store and the template view must be initialized.
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t template_enroll_init(void);
+
+/**
+ * @brief Add one repetition of a gesture
+ *
+ * A repetition of a different gesture than the previous one starts a new
+ * enrollment. Not reentrant: call from one task.
+ *
+ * @param name Gesture name
+ * @param features Raw feature values
+ * @param feature_count Number of features, at least the template dimension
+ *                      (one hand's features for a single-handed gesture)
+ * @param sequence Raw motion sequence of a dynamic gesture
+ *                 (GESTURE_SEQUENCE_LENGTH x GESTURE_SEQUENCE_CHANNELS values), NULL for a static one
+ * @param two_handed Whether the gesture uses the second glove of a pair
+ * @param remaining Pointer to store the repetitions still needed (0 once published), may be NULL
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED for a two-handed gesture
+ *         on a single glove, error code otherwise
+ */
+esp_err_t template_enroll_add(const char *name, const float *features, uint16_t feature_count,
+                              const float *sequence, bool two_handed, uint16_t *remaining);
+
+/**
+ * @brief Discard the repetitions collected so far
+ */
+void template_enroll_cancel(void);
+
+/**
+ * @brief Switch to the template pack written into an image slot
+ *
+ * Runs on the persistence task, after the templates already queued for
+ * flash, since that task is the template store's only writer: the store
+ * maps the slot, then the classifier's snapshots are reloaded from it.
+ * If either fails the previous pack stays in use. Blocks the calling task
+ * until done; the classifier keeps running throughout.
+ *
+ * @param slot Slot from gesture_templates_get_update_slot() holding the pack
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t template_enroll_activate_pack(uint8_t slot);
+
+#endif /* PROCESSING_TEMPLATE_ENROLL_H */
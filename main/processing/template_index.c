@@ -0,0 +1,204 @@
+#include "processing/template_index.h"
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+#include "esp_log.h"
+
+static const char *TAG = "TEMPLATE_INDEX";
+
+#define INDEX_LEAF_SIZE   (4)
+#define INDEX_MAX_DEPTH   (16)    // Median splits of MAX_GESTURE_TEMPLATES stay far below this
+
+static inline uint32_t point_distance(const int16_t *a, const int16_t *b) {
+    uint32_t sum = 0;
+    for (int d = 0; d < GESTURE_COARSE_DIMS; d++) {
+        uint32_t diff = (uint32_t)abs(a[d] - b[d]);
+        // Squares fit a uint32; the shift keeps the sum of all dims in one too
+        sum += (diff * diff) >> 4;
+    }
+    return sum;
+}
+
+static float center_distance(const int16_t *center, const int16_t *p) {
+    float sum = 0.0f;
+    for (int d = 0; d < GESTURE_COARSE_DIMS; d++) {
+        float diff = (float)(p[d] - center[d]);
+        sum += diff * diff;
+    }
+    return sqrtf(sum);
+}
+
+static int16_t build_node(template_index_t *index, uint16_t start, uint16_t count) {
+    if (index->node_count >= TEMPLATE_INDEX_MAX_NODES) {
+        return -1;
+    }
+
+    int16_t id = index->node_count++;
+    template_index_node_t *node = &index->nodes[id];
+    uint16_t *order = index->order;
+    node->start = start;
+    node->count = count;
+    node->left = -1;
+    node->right = -1;
+
+    // Center and the dimension with the widest spread
+    int16_t lo[GESTURE_COARSE_DIMS], hi[GESTURE_COARSE_DIMS];
+    int64_t sum[GESTURE_COARSE_DIMS] = {0};
+    for (int d = 0; d < GESTURE_COARSE_DIMS; d++) {
+        lo[d] = INT16_MAX;
+        hi[d] = INT16_MIN;
+    }
+    for (uint16_t i = start; i < start + count; i++) {
+        const int16_t *p = index->points[order[i]];
+        for (int d = 0; d < GESTURE_COARSE_DIMS; d++) {
+            sum[d] += p[d];
+            if (p[d] < lo[d]) lo[d] = p[d];
+            if (p[d] > hi[d]) hi[d] = p[d];
+        }
+    }
+
+    int split_dim = 0;
+    for (int d = 0; d < GESTURE_COARSE_DIMS; d++) {
+        node->center[d] = (int16_t)(sum[d] / count);
+        if (hi[d] - lo[d] > hi[split_dim] - lo[split_dim]) {
+            split_dim = d;
+        }
+    }
+
+    node->radius = 0.0f;
+    for (uint16_t i = start; i < start + count; i++) {
+        float r = center_distance(node->center, index->points[order[i]]);
+        if (r > node->radius) {
+            node->radius = r;
+        }
+    }
+    node->radius += 1.0f;  // Covers the rounding of the integer center
+
+    if (count <= INDEX_LEAF_SIZE || hi[split_dim] == lo[split_dim]) {
+        return id;
+    }
+
+    // Sort members along the split dimension and halve at the median; the
+    // index is rebuilt only when templates change, so a simple sort will do
+    for (uint16_t i = start + 1; i < start + count; i++) {
+        uint16_t key = order[i];
+        uint16_t j = i;
+        while (j > start && index->points[order[j - 1]][split_dim] > index->points[key][split_dim]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = key;
+    }
+
+    uint16_t half = count / 2;
+    int16_t left = build_node(index, start, half);
+    int16_t right = build_node(index, start + half, count - half);
+    if (left < 0 || right < 0) {
+        return -1;
+    }
+
+    node->left = left;
+    node->right = right;
+    return id;
+}
+
+esp_err_t template_index_build(template_index_t *index, const template_set_t *set) {
+    if (index == NULL || set == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    index->node_count = 0;
+    index->point_count = 0;
+
+    if (set->count == 0) {
+        return ESP_OK;
+    }
+
+    if (set->matrix_q15 == NULL || set->dim < GESTURE_COARSE_DIMS || set->count > MAX_GESTURE_TEMPLATES) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    for (uint16_t t = 0; t < set->count; t++) {
+        memcpy(index->points[t], set->matrix_q15 + t * set->stride, sizeof(index->points[t]));
+        index->order[t] = t;
+    }
+    index->point_count = set->count;
+
+    if (build_node(index, 0, index->point_count) < 0) {
+        ESP_LOGE(TAG, "Index node pool exhausted");
+        index->node_count = 0;
+        index->point_count = 0;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGD(TAG, "Index built over %u templates (%u nodes)", index->point_count, index->node_count);
+    return ESP_OK;
+}
+
+uint16_t template_index_query(const template_index_t *index, const int16_t *input, uint16_t k,
+                              uint16_t *candidates) {
+    if (index == NULL || input == NULL || candidates == NULL || k == 0 || index->node_count == 0) {
+        return 0;
+    }
+
+    const template_index_node_t *nodes = index->nodes;
+    // Current best k, kept sorted by distance
+    uint32_t best_dist[TEMPLATE_INDEX_MAX_K];
+    uint16_t found = 0;
+    if (k > TEMPLATE_INDEX_MAX_K) {
+        k = TEMPLATE_INDEX_MAX_K;
+    }
+
+    int16_t stack[INDEX_MAX_DEPTH * 2];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const template_index_node_t *node = &nodes[stack[--top]];
+
+        // No member of the ball is closer than its surface (in the shifted
+        // units of point_distance, less the truncation of each term)
+        if (found == k) {
+            float gap = center_distance(node->center, input) - node->radius;
+            if (gap > 0.0f && (gap * gap) / 16.0f - GESTURE_COARSE_DIMS >= (float)best_dist[k - 1]) {
+                continue;
+            }
+        }
+
+        if (node->left < 0) {
+            for (uint16_t i = node->start; i < node->start + node->count; i++) {
+                uint32_t dist = point_distance(input, index->points[index->order[i]]);
+                if (found == k && dist >= best_dist[k - 1]) {
+                    continue;
+                }
+
+                uint16_t j = (found < k) ? found++ : k - 1;
+                while (j > 0 && best_dist[j - 1] > dist) {
+                    best_dist[j] = best_dist[j - 1];
+                    candidates[j] = candidates[j - 1];
+                    j--;
+                }
+                best_dist[j] = dist;
+                candidates[j] = index->order[i];
+            }
+            continue;
+        }
+
+        // Visit the nearer child first so the bound tightens early
+        float dl = center_distance(nodes[node->left].center, input);
+        float dr = center_distance(nodes[node->right].center, input);
+        if (dl < dr) {
+            stack[top++] = node->right;
+            stack[top++] = node->left;
+        } else {
+            stack[top++] = node->left;
+            stack[top++] = node->right;
+        }
+    }
+
+    return found;
+}
+
+uint16_t template_index_get_count(const template_index_t *index) {
+    return (index != NULL) ? index->point_count : 0;
+}
@@ -0,0 +1,75 @@
+#ifndef PROCESSING_TEMPLATE_INDEX_H
+#define PROCESSING_TEMPLATE_INDEX_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "config/system_config.h"
+#include "processing/template_matcher.h"
+#include "gesture_templates.h"
+
+// Most candidates one query returns
+#define TEMPLATE_INDEX_MAX_K    (16)
+
+// Median splits leave at least two members per leaf, so fewer nodes than points
+#define TEMPLATE_INDEX_MAX_NODES    (MAX_GESTURE_TEMPLATES)
+
+/**
+ * @brief Node of the ball tree
+ */
+typedef struct {
+    int16_t center[GESTURE_COARSE_DIMS];
+    float radius;                // Farthest member from the center, in Q15 units
+    uint16_t start;              // Members are order[start, start + count)
+    uint16_t count;
+    int16_t left;                // Children, -1 for a leaf
+    int16_t right;
+} template_index_node_t;
+
+/**
+ * @brief Coarse index over a low-dimensional projection of a template set
+ *
+ * A ball tree over the first GESTURE_COARSE_DIMS features of every Q15
+ * template row (the flex angles). A query returns the K templates nearest
+ * in that projection by branch and bound, so only those K need the full
+ * score or DTW and the cost grows roughly with log(count) rather than count.
+ * The projected rows are copied in, so the index does not refer to the set
+ * once built.
+ */
+typedef struct {
+    int16_t points[MAX_GESTURE_TEMPLATES][GESTURE_COARSE_DIMS];
+    uint16_t order[MAX_GESTURE_TEMPLATES];
+    template_index_node_t nodes[TEMPLATE_INDEX_MAX_NODES];
+    uint16_t node_count;
+    uint16_t point_count;
+} template_index_t;
+
+/**
+ * @brief Build the index over a set
+ *
+ * @param index Index to (re)build
+ * @param set Packed template set with matrix_q15
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t template_index_build(template_index_t *index, const template_set_t *set);
+
+/**
+ * @brief Find the templates nearest to an input in the coarse projection
+ *
+ * @param index Built index
+ * @param input Q15 input row from template_matcher_pack_row_q15()
+ * @param k Number of candidates wanted (at most TEMPLATE_INDEX_MAX_K)
+ * @param candidates Output template indices (k values), nearest first
+ * @return Number of candidates found, 0 if the index is empty
+ */
+uint16_t template_index_query(const template_index_t *index, const int16_t *input, uint16_t k,
+                              uint16_t *candidates);
+
+/**
+ * @brief Get the number of templates in the index
+ *
+ * @param index Built index
+ * @return Number of indexed templates
+ */
+uint16_t template_index_get_count(const template_index_t *index);
+
+#endif /* PROCESSING_TEMPLATE_INDEX_H */
@@ -0,0 +1,275 @@
+#include "processing/template_matcher.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include "esp_log.h"
+
+#if GESTURE_MATCH_USE_ESP_DSP
+#include "dsps_dotprod.h"
+#endif
+
+static const char *TAG = "TEMPLATE_MATCH";
+
+// Scaled copy of the input, padded with zeros to the stride
+static float scaled_input[TEMPLATE_MATCHER_MAX_STRIDE] __attribute__((aligned(16)));
+
+// Dot product of two 16-byte aligned vectors whose length is a multiple of four
+static inline float dot_product(const float *a, const float *b, uint16_t length) {
+#if GESTURE_MATCH_USE_ESP_DSP
+    float result = 0.0f;
+    dsps_dotprod_f32(a, b, &result, length);
+    return result;
+#else
+    // Four independent accumulators so the multiply-adds can pipeline
+    float acc0 = 0.0f, acc1 = 0.0f, acc2 = 0.0f, acc3 = 0.0f;
+    for (uint16_t i = 0; i < length; i += 4) {
+        acc0 += a[i] * b[i];
+        acc1 += a[i + 1] * b[i + 1];
+        acc2 += a[i + 2] * b[i + 2];
+        acc3 += a[i + 3] * b[i + 3];
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+#endif
+}
+
+// Squared distance of two Q15 rows. Each term fits a uint32 and the sum a
+// uint64, so nothing saturates for any stride.
+static inline uint64_t distance_q15(const int16_t *a, const int16_t *b, uint16_t length) {
+    uint64_t acc0 = 0, acc1 = 0;
+    for (uint16_t i = 0; i < length; i += 4) {
+        uint32_t d0 = (uint32_t)abs(a[i] - b[i]);
+        uint32_t d1 = (uint32_t)abs(a[i + 1] - b[i + 1]);
+        uint32_t d2 = (uint32_t)abs(a[i + 2] - b[i + 2]);
+        uint32_t d3 = (uint32_t)abs(a[i + 3] - b[i + 3]);
+        acc0 += d0 * d0 + (uint64_t)(d1 * d1);
+        acc1 += d2 * d2 + (uint64_t)(d3 * d3);
+    }
+    return acc0 + acc1;
+}
+
+float template_matcher_pack_row(const float *features, const float *offset, const float *inv_scale,
+                                uint16_t dim, float *row) {
+    uint16_t stride = TEMPLATE_MATCHER_STRIDE(dim);
+    float norm = 0.0f;
+
+    for (uint16_t i = 0; i < dim; i++) {
+        row[i] = (features[i] - offset[i]) * inv_scale[i];
+        norm += row[i] * row[i];
+    }
+    for (uint16_t i = dim; i < stride; i++) {
+        row[i] = 0.0f;
+    }
+
+    return norm;
+}
+
+void template_matcher_pack_row_q15(const float *features, const float *offset, const float *inv_scale,
+                                   uint16_t dim, int16_t *row) {
+    uint16_t stride = TEMPLATE_MATCHER_STRIDE(dim);
+
+    for (uint16_t i = 0; i < dim; i++) {
+        int32_t q = (int32_t)lrintf((features[i] - offset[i]) * inv_scale[i] * TEMPLATE_MATCHER_Q15_PER_UNIT);
+        row[i] = (int16_t)((q < INT16_MIN) ? INT16_MIN : (q > INT16_MAX) ? INT16_MAX : q);
+    }
+    for (uint16_t i = dim; i < stride; i++) {
+        row[i] = 0;
+    }
+}
+
+float template_matcher_pack_template(const float *features, const float *offset, const float *inv_scale,
+                                     uint16_t dim, uint16_t stride, float *row, int16_t *row_q15) {
+    float norm = template_matcher_pack_row(features, offset, inv_scale, dim, row);
+    template_matcher_pack_row_q15(features, offset, inv_scale, dim, row_q15);
+
+    for (uint16_t i = TEMPLATE_MATCHER_STRIDE(dim); i < stride; i++) {
+        row[i] = 0.0f;
+        row_q15[i] = 0;
+    }
+
+    return norm;
+}
+
+// Normalize the input into scaled_input, zeroed past the set's dim up to its stride
+static float scale_input(const template_set_t *set, const float *features) {
+    float norm = template_matcher_pack_row(features, set->offset, set->inv_scale, set->dim, scaled_input);
+    for (uint16_t i = TEMPLATE_MATCHER_STRIDE(set->dim); i < set->stride; i++) {
+        scaled_input[i] = 0.0f;
+    }
+    return norm;
+}
+
+// Fill a match from the two smallest squared distances
+static void set_match(const template_set_t *set, int16_t best_index, float best, float second,
+                      template_match_t *match) {
+    // Only the reported scores need a divide, not every template
+    float inv_dim = 1.0f / set->dim;
+    float distance = (best > 0.0f) ? best * inv_dim : 0.0f;  // Clamp rounding below zero
+
+    match->index = best_index;
+    match->distance = distance;
+    match->score = 1.0f / (1.0f + distance);
+    if (second < FLT_MAX) {
+        float runner_up = (second > 0.0f) ? second * inv_dim : 0.0f;
+        match->runner_up_score = 1.0f / (1.0f + runner_up);
+    }
+}
+
+esp_err_t template_matcher_score(const template_set_t *set, const float *features,
+                                 uint16_t feature_count, float *scores) {
+    if (set == NULL || features == NULL || scores == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (set->count == 0 || set->dim == 0) {
+        return ESP_OK;
+    }
+
+    if (set->stride > TEMPLATE_MATCHER_MAX_STRIDE || feature_count < set->dim) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    float input_norm = scale_input(set, features);
+    float inv_dim = 1.0f / set->dim;
+    const float *row = set->matrix;
+
+    for (uint16_t t = 0; t < set->count; t++, row += set->stride) {
+        float dist_sq = input_norm + set->norms[t] - 2.0f * dot_product(scaled_input, row, set->stride);
+        scores[t] = 1.0f / (1.0f + ((dist_sq > 0.0f) ? dist_sq * inv_dim : 0.0f));
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t template_matcher_match(const template_set_t *set, const float *features,
+                                 uint16_t feature_count, template_match_t *match) {
+    if (set == NULL || features == NULL || match == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    match->index = -1;
+    match->distance = 0.0f;
+    match->score = 0.0f;
+    match->runner_up_score = 0.0f;
+
+    if (set->count == 0 || set->dim == 0) {
+        return ESP_OK;
+    }
+
+    if (set->stride > TEMPLATE_MATCHER_MAX_STRIDE || feature_count < set->dim) {
+        ESP_LOGW(TAG, "Cannot match %u features against %u-feature templates",
+                 feature_count, set->dim);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Normalize the input once; the templates were normalized when packed
+    float input_norm = scale_input(set, features);
+
+    float best = FLT_MAX;
+    float second = FLT_MAX;
+    int16_t best_index = -1;
+    const float *row = set->matrix;
+
+    for (uint16_t t = 0; t < set->count; t++, row += set->stride) {
+        float dist_sq = input_norm + set->norms[t] - 2.0f * dot_product(scaled_input, row, set->stride);
+
+        if (dist_sq < best) {
+            second = best;
+            best = dist_sq;
+            best_index = t;
+        } else if (dist_sq < second) {
+            second = dist_sq;
+        }
+    }
+
+    set_match(set, best_index, best, second, match);
+    return ESP_OK;
+}
+
+// Q15 search over the given templates, or all of them when indices is NULL
+static esp_err_t match_q15_rows(const template_set_t *set, const int16_t *input, const uint16_t *indices,
+                                uint16_t count, template_match_t *match) {
+    if (set == NULL || input == NULL || match == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    match->index = -1;
+    match->distance = 0.0f;
+    match->score = 0.0f;
+    match->runner_up_score = 0.0f;
+
+    if (count == 0 || set->dim == 0) {
+        return ESP_OK;
+    }
+
+    if (set->matrix_q15 == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    uint64_t best = UINT64_MAX;
+    uint64_t second = UINT64_MAX;
+    int16_t best_index = -1;
+
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t t = (indices != NULL) ? indices[i] : i;
+        if (t >= set->count) {
+            continue;
+        }
+
+        uint64_t dist_sq = distance_q15(input, set->matrix_q15 + t * set->stride, set->stride);
+
+        if (dist_sq < best) {
+            second = best;
+            best = dist_sq;
+            best_index = t;
+        } else if (dist_sq < second) {
+            second = dist_sq;
+        }
+    }
+
+    // Back to normalized units only for the two reported distances
+    const float unit_sq = 1.0f / (TEMPLATE_MATCHER_Q15_PER_UNIT * TEMPLATE_MATCHER_Q15_PER_UNIT);
+    set_match(set, best_index, (best < UINT64_MAX) ? (float)best * unit_sq : FLT_MAX,
+              (second < UINT64_MAX) ? (float)second * unit_sq : FLT_MAX, match);
+    return ESP_OK;
+}
+
+esp_err_t template_matcher_match_q15(const template_set_t *set, const int16_t *input, template_match_t *match) {
+    return match_q15_rows(set, input, NULL, (set != NULL) ? set->count : 0, match);
+}
+
+esp_err_t template_matcher_match_q15_subset(const template_set_t *set, const int16_t *input,
+                                            const uint16_t *indices, uint16_t count, template_match_t *match) {
+    if (indices == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return match_q15_rows(set, input, indices, count, match);
+}
+
+esp_err_t template_matcher_score_q15(const template_set_t *set, const int16_t *input,
+                                     const uint16_t *indices, uint16_t count, float *scores) {
+    if (set == NULL || input == NULL || scores == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (set->dim == 0) {
+        return ESP_OK;
+    }
+
+    if (set->matrix_q15 == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    const float unit_sq = 1.0f / (TEMPLATE_MATCHER_Q15_PER_UNIT * TEMPLATE_MATCHER_Q15_PER_UNIT * set->dim);
+
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t t = (indices != NULL) ? indices[i] : i;
+        if (t >= set->count) {
+            continue;
+        }
+
+        uint64_t dist_sq = distance_q15(input, set->matrix_q15 + t * set->stride, set->stride);
+        scores[t] = 1.0f / (1.0f + (float)dist_sq * unit_sq);
+    }
+
+    return ESP_OK;
+}
@@ -0,0 +1,182 @@
+#ifndef PROCESSING_TEMPLATE_MATCHER_H
+#define PROCESSING_TEMPLATE_MATCHER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "config/system_config.h"
+
+/**
+ * @brief Row stride for a template of a given length: rounded up to four
+ * floats so every row starts 16-byte aligned when the matrix does
+ */
+#define TEMPLATE_MATCHER_STRIDE(dim)    (((dim) + 3) & ~3)
+#define TEMPLATE_MATCHER_MAX_STRIDE     TEMPLATE_MATCHER_STRIDE(FEATURE_BUFFER_SIZE)
+
+/**
+ * @brief Q15 units per normalized feature unit: normalized values in
+ * [-GESTURE_Q15_RANGE, GESTURE_Q15_RANGE) fill the int16 range
+ */
+#define TEMPLATE_MATCHER_Q15_PER_UNIT   (32768.0f / GESTURE_Q15_RANGE)
+
+/**
+ * @brief Packed template set
+ *
+ * All templates live in one row-major matrix, each row already normalized
+ * ((value - offset) * inv_scale) and zero-padded to the stride. With the
+ * squared norm of every row stored alongside, the squared distance to an
+ * input x' is |x'|^2 + |t'|^2 - 2 x'.t', so scoring a template is a single
+ * dot product and nothing in the loop divides. The same rows are also kept
+ * in Q15 for the fixed-point matcher.
+ *
+ * A copy of a set with a lower dim but the same stride compares only the
+ * first dim features of each row, exactly so for rows that are zero past
+ * dim (see template_matcher_pack_template()). Inputs are then zeroed past
+ * dim up to the stride.
+ */
+typedef struct {
+    uint16_t count;              // Number of templates (rows)
+    uint16_t dim;                // Features compared per template
+    uint16_t stride;             // Values per row, at least TEMPLATE_MATCHER_STRIDE(dim)
+    const float *matrix;         // count x stride values, 16-byte aligned
+    const float *norms;          // Squared norm of each scaled row
+    const float *offset;         // Center of each feature (dim values)
+    const float *inv_scale;      // 1 / scale of each feature (dim values)
+    const int16_t *matrix_q15;   // Normalized rows in Q15, count x stride values
+} template_set_t;
+
+/**
+ * @brief Result of matching one feature vector against a set
+ */
+typedef struct {
+    int16_t index;               // Best template, -1 if none
+    float distance;              // Mean squared scaled distance to the best template
+    float score;                 // 1 / (1 + distance), in (0, 1]
+    float runner_up_score;       // Score of the second-best template, 0 if none
+} template_match_t;
+
+/**
+ * @brief Normalize and pack one template row
+ *
+ * @param features Template feature values (dim values)
+ * @param offset Per-feature center (dim values)
+ * @param inv_scale Per-feature inverse scale (dim values)
+ * @param dim Number of features
+ * @param row Output row (TEMPLATE_MATCHER_STRIDE(dim) values), padding is zeroed
+ * @return Squared norm of the packed row, to store in the set's norms
+ */
+float template_matcher_pack_row(const float *features, const float *offset, const float *inv_scale,
+                                uint16_t dim, float *row);
+
+/**
+ * @brief Normalize and pack one row in Q15
+ *
+ * Values outside [-GESTURE_Q15_RANGE, GESTURE_Q15_RANGE) saturate.
+ *
+ * @param features Feature values (dim values)
+ * @param offset Per-feature center (dim values)
+ * @param inv_scale Per-feature inverse scale (dim values)
+ * @param dim Number of features
+ * @param row Output row (TEMPLATE_MATCHER_STRIDE(dim) values), padding is zeroed
+ */
+void template_matcher_pack_row_q15(const float *features, const float *offset, const float *inv_scale,
+                                   uint16_t dim, int16_t *row);
+
+/**
+ * @brief Normalize and pack one template row of a set, in float and Q15
+ *
+ * Only the first dim features are packed; the row is zeroed from there to
+ * the stride, so a template can leave out features the set has, such as
+ * the second hand's.
+ *
+ * @param features Template feature values (dim values)
+ * @param offset Per-feature center (dim values)
+ * @param inv_scale Per-feature inverse scale (dim values)
+ * @param dim Number of features packed
+ * @param stride Values per row of the set, at least TEMPLATE_MATCHER_STRIDE(dim)
+ * @param row Output float row (stride values)
+ * @param row_q15 Output Q15 row (stride values)
+ * @return Squared norm of the packed row, to store in the set's norms
+ */
+float template_matcher_pack_template(const float *features, const float *offset, const float *inv_scale,
+                                     uint16_t dim, uint16_t stride, float *row, int16_t *row_q15);
+
+/**
+ * @brief Find the template closest to a feature vector
+ *
+ * Uses the esp-dsp dot product when GESTURE_MATCH_USE_ESP_DSP is set
+ * (vectorized on the ESP32-S3), otherwise an unrolled scalar loop. Not
+ * reentrant: the scaled input is kept in a module buffer.
+ *
+ * @param set Packed template set
+ * @param features Input feature values
+ * @param feature_count Number of input features, must be at least set->dim
+ * @param match Output match result
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t template_matcher_match(const template_set_t *set, const float *features,
+                                 uint16_t feature_count, template_match_t *match);
+
+/**
+ * @brief Score a feature vector against every template
+ *
+ * Same scores as template_matcher_match(), one per template, for callers
+ * that weigh all templates rather than just the best.
+ *
+ * @param set Packed template set
+ * @param features Input feature values
+ * @param feature_count Number of input features, must be at least set->dim
+ * @param scores Output scores (set->count values)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t template_matcher_score(const template_set_t *set, const float *features,
+                                 uint16_t feature_count, float *scores);
+
+/**
+ * @brief Find the template closest to a Q15 feature vector
+ *
+ * Integer squared distances against the Q15 rows, so an already
+ * normalized input is scored without touching a float until the winner's
+ * score is computed. Scores match template_matcher_match() up to the Q15
+ * rounding.
+ *
+ * @param set Packed template set with matrix_q15
+ * @param input Row from template_matcher_pack_row_q15(), zero past set->dim (set->stride values)
+ * @param match Output match result
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t template_matcher_match_q15(const template_set_t *set, const int16_t *input, template_match_t *match);
+
+/**
+ * @brief Find the closest of a subset of templates to a Q15 feature vector
+ *
+ * As template_matcher_match_q15(), but only the listed templates are
+ * scored, e.g. the candidates of a coarse index. Indices past the set are
+ * skipped.
+ *
+ * @param set Packed template set with matrix_q15
+ * @param input Row from template_matcher_pack_row_q15(), zero past set->dim (set->stride values)
+ * @param indices Template indices to score
+ * @param count Number of indices
+ * @param match Output match result, index refers to the whole set
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t template_matcher_match_q15_subset(const template_set_t *set, const int16_t *input,
+                                            const uint16_t *indices, uint16_t count, template_match_t *match);
+
+/**
+ * @brief Score a Q15 feature vector against some or all templates
+ *
+ * Same scores as template_matcher_match_q15(). Only the scored entries of
+ * scores are written.
+ *
+ * @param set Packed template set with matrix_q15
+ * @param input Row from template_matcher_pack_row_q15(), zero past set->dim (set->stride values)
+ * @param indices Template indices to score, or NULL for the first count templates
+ * @param count Number of templates to score
+ * @param scores Output scores, indexed by template (set->count values)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t template_matcher_score_q15(const template_set_t *set, const int16_t *input,
+                                     const uint16_t *indices, uint16_t count, float *scores);
+
+#endif /* PROCESSING_TEMPLATE_MATCHER_H */
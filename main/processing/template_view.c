@@ -0,0 +1,501 @@
+#include "processing/template_view.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "TEMPLATE_VIEW";
+
+#define VIEW_NONE   (-1)
+
+// One snapshot and the storage behind its pointers
+typedef struct {
+    template_view_t view;
+    template_set_t set;          // Same as view.set, with writable counterparts below
+    uint16_t capacity;           // Templates the row storage holds
+    char *names;
+    gesture_template_info_t *info;
+    float *matrix;
+    float *norms;
+    float *offset;
+    float *inv_scale;
+    int16_t *matrix_q15;
+    float *sequence_inv_scale;
+    float *sequence_data;        // One sequence slot per template
+    const float **sequences;
+#if GESTURE_MATCH_USE_Q15
+    template_index_t *index;
+#endif
+} view_buffer_t;
+
+static view_buffer_t buffers[2];
+static atomic_int current_view = 0;         // Snapshot new readers get
+static atomic_int reader_view = VIEW_NONE;  // Snapshot the classifier holds
+static bool template_view_initialized = false;
+static uint32_t generation = 0;             // Whole-store reloads so far
+
+// Publishing and reloading both rewrite the idle snapshot, one at a time
+static SemaphoreHandle_t writer_lock = NULL;
+static StaticSemaphore_t writer_lock_storage;
+static int lagging_view = VIEW_NONE;        // Snapshot that missed the last update, under writer_lock
+
+// Given by the classifier on release while a writer waits for its snapshot
+static SemaphoreHandle_t reader_done = NULL;
+static StaticSemaphore_t reader_done_storage;
+static atomic_bool writer_waiting = false;
+
+static void* view_alloc(size_t size) {
+    // Rows are 16-byte aligned for the dot product
+    return heap_caps_aligned_calloc(16, 1, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+}
+
+static inline size_t sequence_values(const view_buffer_t *buf) {
+    return (size_t)buf->view.sequence_length * buf->view.sequence_channels;
+}
+
+static void free_rows(view_buffer_t *buf) {
+    heap_caps_free(buf->names);
+    heap_caps_free(buf->info);
+    heap_caps_free(buf->matrix);
+    heap_caps_free(buf->norms);
+    heap_caps_free(buf->matrix_q15);
+    heap_caps_free(buf->sequence_data);
+    heap_caps_free(buf->sequences);
+    buf->names = NULL;
+    buf->info = NULL;
+    buf->matrix = NULL;
+    buf->norms = NULL;
+    buf->matrix_q15 = NULL;
+    buf->sequence_data = NULL;
+    buf->sequences = NULL;
+    buf->capacity = 0;
+}
+
+// Storage for the rows of capacity templates, empty
+static esp_err_t alloc_rows(view_buffer_t *buf, uint16_t capacity) {
+    size_t rows = (size_t)capacity * buf->set.stride;
+    buf->names = view_alloc(capacity * GESTURE_TEMPLATE_NAME_LEN);
+    buf->info = view_alloc(capacity * sizeof(gesture_template_info_t));
+    buf->matrix = view_alloc(rows * sizeof(float));
+    buf->norms = view_alloc(capacity * sizeof(float));
+    buf->matrix_q15 = view_alloc(rows * sizeof(int16_t));
+    buf->sequence_data = view_alloc(capacity * sequence_values(buf) * sizeof(float));
+    buf->sequences = view_alloc(capacity * sizeof(const float *));
+
+    if (buf->names == NULL || buf->info == NULL || buf->matrix == NULL || buf->norms == NULL ||
+        buf->matrix_q15 == NULL || buf->sequence_data == NULL || buf->sequences == NULL) {
+        free_rows(buf);
+        return ESP_ERR_NO_MEM;
+    }
+
+    buf->capacity = capacity;
+    buf->set.matrix = buf->matrix;
+    buf->set.norms = buf->norms;
+    buf->set.matrix_q15 = buf->matrix_q15;
+    buf->view.names = buf->names;
+    buf->view.info = buf->info;
+    buf->view.sequences = buf->sequences;
+    return ESP_OK;
+}
+
+// Copy the first count templates of src into dst
+static void copy_rows(view_buffer_t *dst, const view_buffer_t *src, uint16_t count) {
+    size_t rows = (size_t)count * src->set.stride;
+    memcpy(dst->names, src->names, count * GESTURE_TEMPLATE_NAME_LEN);
+    memcpy(dst->info, src->info, count * sizeof(gesture_template_info_t));
+    memcpy(dst->matrix, src->matrix, rows * sizeof(float));
+    memcpy(dst->norms, src->norms, count * sizeof(float));
+    memcpy(dst->matrix_q15, src->matrix_q15, rows * sizeof(int16_t));
+    memcpy(dst->sequence_data, src->sequence_data, count * sequence_values(src) * sizeof(float));
+    for (uint16_t i = 0; i < count; i++) {
+        dst->sequences[i] = (src->sequences[i] != NULL) ? dst->sequence_data + i * sequence_values(dst) : NULL;
+    }
+}
+
+// Make room for count templates; a snapshot is sized to what it holds plus
+// GESTURE_VIEW_SPARE_SLOTS, so it only grows on enrollment past that
+static esp_err_t reserve_rows(view_buffer_t *buf, uint16_t count) {
+    if (count <= buf->capacity) {
+        return ESP_OK;
+    }
+
+    if (count > MAX_GESTURE_TEMPLATES) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint16_t capacity = count + GESTURE_VIEW_SPARE_SLOTS;
+    if (capacity > MAX_GESTURE_TEMPLATES) {
+        capacity = MAX_GESTURE_TEMPLATES;
+    }
+
+    view_buffer_t grown = *buf;
+    esp_err_t ret = alloc_rows(&grown, capacity);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "No room to grow a template snapshot to %u templates", capacity);
+        return ret;
+    }
+
+    copy_rows(&grown, buf, buf->set.count);
+    free_rows(buf);
+    *buf = grown;
+    buf->view.set = buf->set;
+    ESP_LOGI(TAG, "Template snapshot grown to %u templates", capacity);
+    return ESP_OK;
+}
+
+static esp_err_t alloc_buffer(view_buffer_t *buf, const template_set_t *shape,
+                              uint16_t sequence_length, uint16_t sequence_channels) {
+    buf->view.sequence_length = sequence_length;
+    buf->view.sequence_channels = sequence_channels;
+    buf->set = *shape;
+    buf->set.count = 0;
+
+    buf->offset = view_alloc(shape->stride * sizeof(float));
+    buf->inv_scale = view_alloc(shape->stride * sizeof(float));
+    buf->sequence_inv_scale = view_alloc(sequence_channels * sizeof(float));
+#if GESTURE_MATCH_USE_Q15
+    buf->index = view_alloc(sizeof(template_index_t));
+    if (buf->index == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+
+    if (buf->offset == NULL || buf->inv_scale == NULL || buf->sequence_inv_scale == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    buf->set.offset = buf->offset;
+    buf->set.inv_scale = buf->inv_scale;
+    buf->view.sequence_inv_scale = buf->sequence_inv_scale;
+#if GESTURE_MATCH_USE_Q15
+    buf->view.index = buf->index;
+#endif
+    uint16_t capacity = shape->count + GESTURE_VIEW_SPARE_SLOTS;
+    return alloc_rows(buf, (capacity < MAX_GESTURE_TEMPLATES) ? capacity : MAX_GESTURE_TEMPLATES);
+}
+
+// Make the published part of a buffer match its contents
+static void finish_buffer(view_buffer_t *buf) {
+#if GESTURE_MATCH_USE_Q15
+    // A failed build leaves an empty index, and an empty index means a full search
+    if (template_index_build(buf->index, &buf->set) != ESP_OK) {
+        ESP_LOGW(TAG, "Coarse index unavailable, matching exhaustively");
+    }
+#endif
+    buf->view.set = buf->set;
+}
+
+// Copy the stored image into a buffer with room for it
+static void load_buffer(view_buffer_t *buf, const template_set_t *stored) {
+    uint16_t stride = stored->stride;
+    memcpy(buf->matrix, stored->matrix, (size_t)stored->count * stride * sizeof(float));
+    memcpy(buf->norms, stored->norms, stored->count * sizeof(float));
+    memcpy(buf->offset, stored->offset, stored->dim * sizeof(float));
+    memcpy(buf->inv_scale, stored->inv_scale, stored->dim * sizeof(float));
+    memcpy(buf->matrix_q15, stored->matrix_q15, (size_t)stored->count * stride * sizeof(int16_t));
+    memcpy(buf->sequence_inv_scale, gesture_templates_get_sequence_scale(),
+           buf->view.sequence_channels * sizeof(float));
+
+    for (uint16_t i = 0; i < stored->count; i++) {
+        const gesture_template_info_t *info = gesture_templates_get_info(i);
+        const float *sequence = info->is_dynamic ? gesture_templates_get_sequence(i) : NULL;
+        float *slot = buf->sequence_data + i * sequence_values(buf);
+
+        memcpy(buf->names + i * GESTURE_TEMPLATE_NAME_LEN, gesture_templates_get_name(i), GESTURE_TEMPLATE_NAME_LEN);
+        buf->info[i] = *info;
+        if (sequence != NULL) {
+            memcpy(slot, sequence, sequence_values(buf) * sizeof(float));
+        }
+        buf->sequences[i] = (sequence != NULL) ? slot : NULL;
+    }
+
+    buf->set.count = stored->count;
+    finish_buffer(buf);
+}
+
+// Bring a buffer that missed an update level with the current one
+static esp_err_t sync_buffer(view_buffer_t *dst, const view_buffer_t *src) {
+    esp_err_t ret = reserve_rows(dst, src->set.count);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    copy_rows(dst, src, src->set.count);
+    memcpy(dst->offset, src->offset, src->set.dim * sizeof(float));
+    memcpy(dst->inv_scale, src->inv_scale, src->set.dim * sizeof(float));
+    memcpy(dst->sequence_inv_scale, src->sequence_inv_scale, src->view.sequence_channels * sizeof(float));
+    dst->set.count = src->set.count;
+    dst->view.generation = src->view.generation;
+    finish_buffer(dst);
+    return ESP_OK;
+}
+
+// Slot a template takes, chosen by name as the store does
+static uint16_t find_slot(const view_buffer_t *buf, const char *name) {
+    for (uint16_t i = 0; i < buf->set.count; i++) {
+        if (strncmp(buf->names + i * GESTURE_TEMPLATE_NAME_LEN, name, GESTURE_TEMPLATE_NAME_LEN) == 0) {
+            return i;
+        }
+    }
+    return buf->set.count;
+}
+
+// Write one template into a slot of a buffer with room for it
+static void apply_template(view_buffer_t *buf, uint16_t slot, const char *name, const float *features,
+                           const gesture_template_info_t *info, const float *sequence) {
+    uint16_t stride = buf->set.stride;
+    buf->norms[slot] = template_matcher_pack_template(features, buf->offset, buf->inv_scale,
+                                                      gesture_templates_packed_dim(info, buf->set.dim), stride,
+                                                      buf->matrix + slot * stride,
+                                                      buf->matrix_q15 + slot * stride);
+
+    char *slot_name = buf->names + slot * GESTURE_TEMPLATE_NAME_LEN;
+    memset(slot_name, 0, GESTURE_TEMPLATE_NAME_LEN);
+    strncpy(slot_name, name, GESTURE_TEMPLATE_NAME_LEN - 1);
+
+    buf->info[slot] = *info;
+    buf->sequences[slot] = NULL;
+    if (sequence != NULL) {
+        // Scale like the query will be, as the store does
+        float *scaled = buf->sequence_data + slot * sequence_values(buf);
+        for (size_t v = 0; v < sequence_values(buf); v++) {
+            scaled[v] = sequence[v] * buf->sequence_inv_scale[v % buf->view.sequence_channels];
+        }
+        buf->info[slot].has_sequence = 1;
+        buf->sequences[slot] = scaled;
+    }
+
+    if (slot == buf->set.count) {
+        buf->set.count++;
+    }
+    finish_buffer(buf);
+}
+
+// Writer side: wait for the classifier to hand back a snapshot. It only
+// ever acquires the current one, so one release is enough; a classifier
+// that holds on past GESTURE_VIEW_READER_WAIT_MS is reported and the
+// snapshot left alone.
+static bool wait_for_reader(int view) {
+    bool released = true;
+
+    atomic_store(&writer_waiting, true);
+    while (atomic_load(&reader_view) == view) {
+        if (xSemaphoreTake(reader_done, pdMS_TO_TICKS(GESTURE_VIEW_READER_WAIT_MS)) != pdTRUE) {
+            released = false;
+            break;
+        }
+    }
+    atomic_store(&writer_waiting, false);
+
+    if (!released) {
+        ESP_LOGW(TAG, "Classifier held template snapshot %d for over %d ms", view, GESTURE_VIEW_READER_WAIT_MS);
+    }
+    return released;
+}
+
+// Writer side: get the idle snapshot ready to take an update
+static esp_err_t begin_update(int idle, int active) {
+    if (!wait_for_reader(idle)) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if (lagging_view == idle) {
+        esp_err_t ret = sync_buffer(&buffers[idle], &buffers[active]);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        lagging_view = VIEW_NONE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t template_view_init(void) {
+    template_set_t stored;
+    esp_err_t ret = gesture_templates_get_set(&stored);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    uint16_t length = 0, channels = 0;
+    ret = gesture_templates_get_sequence_shape(&length, &channels);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (!template_view_initialized) {
+        writer_lock = xSemaphoreCreateMutexStatic(&writer_lock_storage);
+        reader_done = xSemaphoreCreateBinaryStatic(&reader_done_storage);
+        for (int b = 0; b < 2; b++) {
+            ret = alloc_buffer(&buffers[b], &stored, length, channels);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to allocate template snapshot");
+                return ret;
+            }
+        }
+        template_view_initialized = true;
+    }
+
+    for (int b = 0; b < 2; b++) {
+        ret = reserve_rows(&buffers[b], stored.count);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        load_buffer(&buffers[b], &stored);
+    }
+    lagging_view = VIEW_NONE;
+    atomic_store(&current_view, 0);
+
+    ESP_LOGI(TAG, "Template snapshots ready (%u templates, room for %u)",
+             stored.count, buffers[0].capacity);
+    return ESP_OK;
+}
+
+const template_view_t* template_view_acquire(void) {
+    if (!template_view_initialized) {
+        return NULL;
+    }
+
+    // Announce the snapshot, then check it was not replaced in between; a
+    // writer that saw the announcement too late retries on its own side
+    int view;
+    do {
+        view = atomic_load(&current_view);
+        atomic_store(&reader_view, view);
+    } while (atomic_load(&current_view) != view);
+
+    return &buffers[view].view;
+}
+
+void template_view_release(void) {
+    atomic_store(&reader_view, VIEW_NONE);
+    if (atomic_load(&writer_waiting)) {
+        xSemaphoreGive(reader_done);
+    }
+}
+
+const template_view_t* template_view_peek(void) {
+    return template_view_initialized ? &buffers[atomic_load(&current_view)].view : NULL;
+}
+
+esp_err_t template_view_copy_name(uint16_t index, char *name) {
+    if (!template_view_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Writers only touch the snapshots under the lock
+    if (xSemaphoreTake(writer_lock, 0) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    const view_buffer_t *buf = &buffers[atomic_load(&current_view)];
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    if (index < buf->set.count) {
+        memcpy(name, buf->names + index * GESTURE_TEMPLATE_NAME_LEN, GESTURE_TEMPLATE_NAME_LEN);
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(writer_lock);
+    return ret;
+}
+
+esp_err_t template_view_publish(const char *name, const float *features,
+                                const gesture_template_info_t *info, const float *sequence,
+                                uint16_t *index) {
+    if (!template_view_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (name == NULL || name[0] == '\0' || features == NULL || info == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(writer_lock, portMAX_DELAY);
+    int active = atomic_load(&current_view);
+    int idle = 1 - active;
+    uint16_t slot = 0;
+
+    // Update the idle snapshot and make it current
+    esp_err_t ret = begin_update(idle, active);
+    if (ret == ESP_OK) {
+        slot = find_slot(&buffers[idle], name);
+        ret = (slot < MAX_GESTURE_TEMPLATES) ? reserve_rows(&buffers[idle], slot + 1) : ESP_ERR_NO_MEM;
+    }
+    if (ret != ESP_OK) {
+        xSemaphoreGive(writer_lock);
+        ESP_LOGE(TAG, "Template '%s' not published: %s", name, esp_err_to_name(ret));
+        return ret;
+    }
+    apply_template(&buffers[idle], slot, name, features, info, sequence);
+    atomic_store(&current_view, idle);
+
+    // Then bring the old one level with it for the next update, or leave
+    // that to the next update if the classifier still holds it
+    if (wait_for_reader(active) && reserve_rows(&buffers[active], slot + 1) == ESP_OK) {
+        apply_template(&buffers[active], slot, name, features, info, sequence);
+    } else {
+        lagging_view = active;
+    }
+    xSemaphoreGive(writer_lock);
+
+    if (index != NULL) {
+        *index = slot;
+    }
+    ESP_LOGI(TAG, "Template '%s' live in slot %u", name, slot);
+    return ESP_OK;
+}
+
+esp_err_t template_view_reload(void) {
+    if (!template_view_initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    template_set_t stored;
+    uint16_t length = 0, channels = 0;
+    esp_err_t ret = gesture_templates_get_set(&stored);
+    if (ret == ESP_OK) {
+        ret = gesture_templates_get_sequence_shape(&length, &channels);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // The snapshots were sized for the shapes at init
+    const view_buffer_t *shape = &buffers[0];
+    if (stored.dim != shape->set.dim || stored.stride != shape->set.stride ||
+        length != shape->view.sequence_length || channels != shape->view.sequence_channels) {
+        ESP_LOGE(TAG, "Stored templates changed shape, not reloaded");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    xSemaphoreTake(writer_lock, portMAX_DELAY);
+    int active = atomic_load(&current_view);
+    int idle = 1 - active;
+
+    // Same swap as a publish, with the whole store copied in
+    ret = begin_update(idle, active);
+    if (ret == ESP_OK) {
+        ret = reserve_rows(&buffers[idle], stored.count);
+    }
+    if (ret != ESP_OK) {
+        xSemaphoreGive(writer_lock);
+        ESP_LOGE(TAG, "Template snapshots not reloaded: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    generation++;
+    load_buffer(&buffers[idle], &stored);
+    buffers[idle].view.generation = generation;
+    atomic_store(&current_view, idle);
+
+    if (wait_for_reader(active) && reserve_rows(&buffers[active], stored.count) == ESP_OK) {
+        load_buffer(&buffers[active], &stored);
+        buffers[active].view.generation = generation;
+    } else {
+        lagging_view = active;
+    }
+    xSemaphoreGive(writer_lock);
+
+    ESP_LOGI(TAG, "Template snapshots reloaded (%u templates)", stored.count);
+    return ESP_OK;
+}
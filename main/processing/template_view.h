@@ -0,0 +1,133 @@
+#ifndef PROCESSING_TEMPLATE_VIEW_H
+#define PROCESSING_TEMPLATE_VIEW_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "config/system_config.h"
+#include "processing/template_matcher.h"
+#include "processing/template_index.h"
+#include "gesture_templates.h"
+
+/**
+ * @brief Snapshot of the templates the classifier matches against
+ *
+ * Everything the hot path reads, copied out of the template image into
+ * PSRAM: packed rows, names, metadata, motion sequences and the coarse
+ * index. Two snapshots are kept. Updates go into the one the classifier is
+ * not using and are published with a single atomic swap, so the classifier
+ * never takes a lock, never waits on a writer and never reads flash that
+ * is being rewritten. Each snapshot holds the loaded templates plus
+ * GESTURE_VIEW_SPARE_SLOTS and grows when enrollment needs more.
+ */
+typedef struct {
+    template_set_t set;                      // Rows ready for the matchers
+    const char *names;                       // count x GESTURE_TEMPLATE_NAME_LEN characters
+    const gesture_template_info_t *info;     // Metadata of each template
+    const float *const *sequences;           // Scaled motion of each template, NULL if none
+    const float *sequence_inv_scale;         // sequence_channels values
+    uint16_t sequence_length;
+    uint16_t sequence_channels;
+    uint32_t generation;                     // Bumped by template_view_reload(); indices do not carry over
+#if GESTURE_MATCH_USE_Q15
+    const template_index_t *index;           // Coarse index over the Q15 rows
+#endif
+} template_view_t;
+
+/**
+ * @brief Build both snapshots from the template store
+ *
+ * The store must be initialized. Shapes are taken from the stored image,
+ * capacity from the templates it holds.
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t template_view_init(void);
+
+/**
+ * @brief Get the current snapshot (classifier only)
+ *
+ * Wait-free. The snapshot stays untouched until template_view_release().
+ * Only one task may hold a snapshot.
+ *
+ * @return Current snapshot, or NULL if not initialized
+ */
+const template_view_t* template_view_acquire(void);
+
+/**
+ * @brief Hand back the snapshot from template_view_acquire()
+ */
+void template_view_release(void);
+
+/**
+ * @brief Get the current snapshot from the publishing task
+ *
+ * Snapshots only change inside template_view_publish(), so the task that
+ * publishes can read the current one without acquiring it.
+ *
+ * @return Current snapshot, or NULL if not initialized
+ */
+const template_view_t* template_view_peek(void);
+
+/**
+ * @brief Copy the name of a template in the current snapshot (any task)
+ *
+ * Does not wait: while a publish or reload runs it fails and the caller
+ * tries again later.
+ *
+ * @param index Template index
+ * @param name Buffer of GESTURE_TEMPLATE_NAME_LEN characters
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND past the last template,
+ *         ESP_ERR_TIMEOUT while the snapshots are being updated,
+ *         ESP_ERR_INVALID_STATE if not initialized
+ */
+esp_err_t template_view_copy_name(uint16_t index, char *name);
+
+/**
+ * @brief Publish a new or replaced template
+ *
+ * The template goes into the idle snapshot, which then becomes current;
+ * the same change is applied to the other snapshot once the classifier
+ * has let go of it. A template of the same name is replaced, otherwise the
+ * next free slot is taken, as the template store does. Waits up to
+ * GESTURE_VIEW_READER_WAIT_MS for the classifier to let go of a snapshot,
+ * and while a reload runs.
+ *
+ * @param name Gesture name
+ * @param features Raw feature values (set dim values)
+ * @param info Template metadata
+ * @param sequence Raw motion sequence (sequence_length x sequence_channels values), or NULL
+ * @param index Pointer to store the slot used, may be NULL
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if no slot or no room is left,
+ *         ESP_ERR_TIMEOUT if the classifier did not let go of the idle
+ *         snapshot, error code otherwise
+ */
+esp_err_t template_view_publish(const char *name, const float *features,
+                                const gesture_template_info_t *info, const float *sequence,
+                                uint16_t *index);
+
+/**
+ * @brief Replace both snapshots with the contents of the template store
+ *
+ * For a store switched to another template pack. Swapped in like a
+ * publish, so the classifier keeps matching the old templates until the
+ * new ones are complete; the snapshot's generation changes, since template
+ * indices now name other templates. The pack must have the shapes the
+ * snapshots were built with.
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_SIZE if the shapes differ,
+ *         error code otherwise
+ */
+esp_err_t template_view_reload(void);
+
+/**
+ * @brief Get the name of a template in a snapshot
+ *
+ * @param view Snapshot
+ * @param index Template index
+ * @return Name, or NULL if index is out of range
+ */
+static inline const char* template_view_name(const template_view_t *view, uint16_t index) {
+    return (index < view->set.count) ? view->names + index * GESTURE_TEMPLATE_NAME_LEN : NULL;
+}
+
+#endif /* PROCESSING_TEMPLATE_VIEW_H */
@@ -0,0 +1,164 @@
+#include "tasks/camera_task.h"
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "drivers/camera.h"
+#include "core/sample_scheduler.h"
+#include "core/telemetry.h"
+#include "app_main.h"
+#include "config/system_config.h"
+#include "config/memory_layout.h"
+#include "util/debug.h"
+
+static const char *TAG = "CAMERA_TASK";
+
+// Task handle
+static TaskHandle_t camera_task_handle = NULL;
+STATIC_TASK_STORAGE(camera_task, CAMERA_TASK_STACK_SIZE);
+
+// Latest ROI not yet taken by the sensor task
+static camera_roi_desc_t latest_roi;
+static bool latest_roi_valid = false;
+static portMUX_TYPE latest_roi_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Forward declarations
+static void camera_task(void *arg);
+static esp_err_t capture_roi(void);
+
+esp_err_t camera_task_init(void) {
+    esp_err_t ret = camera_roi_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize ROI pool: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    // Create the camera task
+    camera_task_handle = STATIC_TASK_CREATE_PINNED(
+        camera_task,
+        "camera_task",
+        CAMERA_TASK_STACK_SIZE,
+        NULL,
+        CAMERA_TASK_PRIORITY,
+        CAMERA_TASK_CORE
+    );
+    
+    if (camera_task_handle == NULL) {
+        ESP_LOGE(TAG, "Failed to create camera task");
+        return ESP_FAIL;
+    }
+    
+    ESP_LOGI(TAG, "Camera task initialized on core %d", CAMERA_TASK_CORE);
+    return ESP_OK;
+}
+
+void camera_task_deinit(void) {
+    // Cleanup resources when task is deleted
+    if (camera_task_handle != NULL) {
+        vTaskDelete(camera_task_handle);
+        camera_task_handle = NULL;
+    }
+    
+    camera_roi_desc_t desc;
+    if (camera_task_take_roi(&desc) == ESP_OK) {
+        camera_roi_release(desc.roi_index);
+    }
+    camera_roi_deinit();
+    
+    ESP_LOGI(TAG, "Camera task deinitialized");
+}
+
+esp_err_t camera_task_take_roi(camera_roi_desc_t *desc) {
+    if (desc == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    
+    taskENTER_CRITICAL(&latest_roi_lock);
+    if (latest_roi_valid) {
+        *desc = latest_roi;
+        latest_roi_valid = false;
+        ret = ESP_OK;
+    }
+    taskEXIT_CRITICAL(&latest_roi_lock);
+    
+    return ret;
+}
+
+static void camera_task(void *arg) {
+    ESP_LOGI(TAG, "Camera task started");
+    
+    // Wait for system initialization to complete
+    xEventGroupWaitBits(g_system_event_group, 
+                        SYSTEM_EVENT_INIT_COMPLETE, 
+                        pdFALSE, pdTRUE, portMAX_DELAY);
+    
+    const TickType_t period = pdMS_TO_TICKS(1000 / CAMERA_FRAME_RATE_HZ);
+    bool camera_ready = false;
+    TickType_t last_wake_time = xTaskGetTickCount();
+    
+    while (1) {
+        vTaskDelayUntil(&last_wake_time, period);
+        
+        if (!g_system_config.camera_enabled) {
+            continue;
+        }
+        
+        // Brought up the first time it is enabled rather than at boot
+        if (!camera_ready) {
+            if (camera_init() != ESP_OK) {
+                ESP_LOGE(TAG, "Camera unavailable, disabling it");
+                g_system_config.camera_enabled = false;
+                continue;
+            }
+            camera_ready = true;
+        }
+        
+        if (capture_roi() == ESP_OK) {
+            // Let the sensor task pick the ROI up with its next frame
+            sample_scheduler_notify(SAMPLE_SOURCE_CAMERA);
+        }
+    }
+}
+
+static esp_err_t capture_roi(void) {
+    camera_frame_t frame;
+    esp_err_t ret = camera_capture_frame(&frame);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to capture camera frame: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    camera_roi_desc_t desc;
+    ret = camera_roi_extract(&frame, &desc);
+    
+    // The frame buffer never leaves this task
+    camera_release_frame();
+    
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to extract hand ROI: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
+    // Replace any ROI the sensor task has not taken yet
+    bool dropped = false;
+    camera_roi_desc_t stale;
+    
+    taskENTER_CRITICAL(&latest_roi_lock);
+    if (latest_roi_valid) {
+        stale = latest_roi;
+        dropped = true;
+    }
+    latest_roi = desc;
+    latest_roi_valid = true;
+    taskEXIT_CRITICAL(&latest_roi_lock);
+    
+    if (dropped) {
+        telemetry_count_drop(TELEMETRY_DROP_CAMERA_ROI);
+        camera_roi_release(stale.roi_index);
+    }
+    
+    return ESP_OK;
+}
@@ -0,0 +1,35 @@
+#ifndef TASKS_CAMERA_TASK_H
+#define TASKS_CAMERA_TASK_H
+
+#include "esp_err.h"
+#include "processing/camera_roi.h"
+
+/**
+ * @brief Initialize the camera task
+ * 
+ * This task captures camera frames, reduces each one to a 32x32 grayscale
+ * hand ROI and returns the frame buffer to the driver straight away. Only
+ * the ROI descriptor is handed to the sensor task.
+ * 
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t camera_task_init(void);
+
+/**
+ * @brief Deinitialize the camera task
+ * 
+ * Frees resources allocated by the camera task.
+ */
+void camera_task_deinit(void);
+
+/**
+ * @brief Take the most recent ROI, if a new one is available
+ * 
+ * The reference held on the ROI slot passes to the caller.
+ * 
+ * @param desc Pointer to store the ROI descriptor
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no new ROI is available
+ */
+esp_err_t camera_task_take_roi(camera_roi_desc_t *desc);
+
+#endif /* TASKS_CAMERA_TASK_H */
@@ -9,35 +9,53 @@
 #include "communication/ble_service.h"
 #include "app_main.h"
 #include "core/power_management.h"
+#include "core/trace_recorder.h"
+#include "core/command_bus.h"
+#include "core/telemetry.h"
 #include "config/system_config.h"
+#include "config/memory_layout.h"
 #include "util/debug.h"
+#include "util/cycle_trace.h"
 
 static const char *TAG = "COMM_TASK";
 
 // Task handle
 static TaskHandle_t communication_task_handle = NULL;
+STATIC_TASK_STORAGE(communication_task, COMMUNICATION_TASK_STACK_SIZE);
 
 // Last status update time
 static uint32_t last_status_update_ms = 0;
 #define STATUS_UPDATE_INTERVAL_MS 5000  // Update status every 5 seconds
 
+// Telemetry snapshot being sent; too big for the Bluetooth task's stack
+static uint8_t telemetry_buffer[TELEMETRY_SNAPSHOT_MAX];
+
 // Forward declarations
 static void communication_task(void *arg);
 static void ble_command_handler(const uint8_t *data, size_t length);
+static void ble_trace_sink(const char *line, void *ctx);
 
 esp_err_t communication_task_init(void) {
+    // Bluetooth on and off come to this task
+    esp_err_t ret = command_bus_subscribe(COMMAND_SUBSCRIBER_COMMUNICATION,
+                                          COMMAND_BUS_TYPE(SYS_CMD_ENABLE_BLE) |
+                                          COMMAND_BUS_TYPE(SYS_CMD_DISABLE_BLE));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to subscribe to system commands: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
     // Create the communication task
-    BaseType_t ret = xTaskCreatePinnedToCore(
+    communication_task_handle = STATIC_TASK_CREATE_PINNED(
         communication_task,
         "communication_task",
         COMMUNICATION_TASK_STACK_SIZE,
         NULL,
         COMMUNICATION_TASK_PRIORITY,
-        &communication_task_handle,
         COMMUNICATION_TASK_CORE
     );
     
-    if (ret != pdPASS) {
+    if (communication_task_handle == NULL) {
         ESP_LOGE(TAG, "Failed to create communication task");
         return ESP_FAIL;
     }
@@ -72,8 +90,16 @@ static void communication_task(void *arg) {
     system_command_t system_cmd;
     
     while (1) {
-        // Process any incoming system commands
-        if (xQueueReceive(g_system_command_queue, &system_cmd, 0) == pdTRUE) {
+        // Sleep until a command arrives or the status update or link policy is due
+        uint32_t elapsed_ms = (uint32_t)(esp_timer_get_time() / 1000) - last_status_update_ms;
+        uint32_t wait_ms = (elapsed_ms < STATUS_UPDATE_INTERVAL_MS) ? STATUS_UPDATE_INTERVAL_MS - elapsed_ms : 0;
+        uint32_t link_wait_ms = ble_service_update_link();
+        if (link_wait_ms < wait_ms) {
+            wait_ms = link_wait_ms;
+        }
+        
+        // Only the command types this task subscribed to arrive here
+        if (command_bus_receive(COMMAND_SUBSCRIBER_COMMUNICATION, &system_cmd, pdMS_TO_TICKS(wait_ms)) == pdTRUE) {
             // Handle system commands
             switch (system_cmd.type) {
                 case SYS_CMD_ENABLE_BLE:
@@ -87,10 +113,7 @@ static void communication_task(void *arg) {
                     break;
                     
                 default:
-                    // Forward to other subsystems or tasks if needed
-                    if (xQueueSend(g_system_command_queue, &system_cmd, 0) != pdTRUE) {
-                        ESP_LOGW(TAG, "Failed to forward system command (queue full)");
-                    }
+                    ESP_LOGW(TAG, "Unexpected system command %d", system_cmd.type);
                     break;
             }
         }
@@ -114,9 +137,6 @@ static void communication_task(void *arg) {
             
             last_status_update_ms = current_time_ms;
         }
-        
-        // Short delay to prevent CPU hogging
-        vTaskDelay(pdMS_TO_TICKS(50));
     }
 }
 
@@ -157,7 +177,7 @@ static void ble_command_handler(const uint8_t *data, size_t length) {
                     };
                     
                     // Send to output queue
-                    if (xQueueSend(g_output_command_queue, &cmd, 0) != pdTRUE) {
+                    if (telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &cmd, 0) != pdTRUE) {
                         ESP_LOGW(TAG, "Failed to send output mode command (queue full)");
                     }
                 }
@@ -171,9 +191,13 @@ static void ble_command_handler(const uint8_t *data, size_t length) {
                     .type = SYS_CMD_CALIBRATE
                 };
                 
-                // Send to system command queue
-                if (xQueueSend(g_system_command_queue, &cmd, 0) != pdTRUE) {
-                    ESP_LOGW(TAG, "Failed to send calibration command (queue full)");
+                // Route to the task that handles it
+                
+                esp_err_t ret = command_bus_publish(&cmd);
+                
+                if (ret != ESP_OK) {
+                
+                    ESP_LOGW(TAG, "Failed to send calibration command: %s", esp_err_to_name(ret));
                 }
             }
             break;
@@ -188,9 +212,13 @@ static void ble_command_handler(const uint8_t *data, size_t length) {
                         .data.power_mode.enable_power_save = (power_mode != POWER_MODE_PERFORMANCE)
                     };
                     
-                    // Send to system command queue
-                    if (xQueueSend(g_system_command_queue, &cmd, 0) != pdTRUE) {
-                        ESP_LOGW(TAG, "Failed to send power mode command (queue full)");
+                    // Route to the task that handles it
+                    
+                    esp_err_t ret = command_bus_publish(&cmd);
+                    
+                    if (ret != ESP_OK) {
+                    
+                        ESP_LOGW(TAG, "Failed to send power mode command: %s", esp_err_to_name(ret));
                     }
                 }
             }
@@ -206,9 +234,13 @@ static void ble_command_handler(const uint8_t *data, size_t length) {
                         .data.change_state.new_state = (system_state_t)state
                     };
                     
-                    // Send to system command queue
-                    if (xQueueSend(g_system_command_queue, &cmd, 0) != pdTRUE) {
-                        ESP_LOGW(TAG, "Failed to send state change command (queue full)");
+                    // Route to the task that handles it
+                    
+                    esp_err_t ret = command_bus_publish(&cmd);
+                    
+                    if (ret != ESP_OK) {
+                    
+                        ESP_LOGW(TAG, "Failed to send state change command: %s", esp_err_to_name(ret));
                     }
                 }
             }
@@ -224,9 +256,13 @@ static void ble_command_handler(const uint8_t *data, size_t length) {
                     .data.sleep.sleep_duration_sec = sleep_duration
                 };
                 
-                // Send to system command queue
-                if (xQueueSend(g_system_command_queue, &cmd, 0) != pdTRUE) {
-                    ESP_LOGW(TAG, "Failed to send sleep command (queue full)");
+                // Route to the task that handles it
+                
+                esp_err_t ret = command_bus_publish(&cmd);
+                
+                if (ret != ESP_OK) {
+                
+                    ESP_LOGW(TAG, "Failed to send sleep command: %s", esp_err_to_name(ret));
                 }
             }
             break;
@@ -238,9 +274,13 @@ static void ble_command_handler(const uint8_t *data, size_t length) {
                     .type = SYS_CMD_RESTART
                 };
                 
-                // Send to system command queue
-                if (xQueueSend(g_system_command_queue, &cmd, 0) != pdTRUE) {
-                    ESP_LOGW(TAG, "Failed to send restart command (queue full)");
+                // Route to the task that handles it
+                
+                esp_err_t ret = command_bus_publish(&cmd);
+                
+                if (ret != ESP_OK) {
+                
+                    ESP_LOGW(TAG, "Failed to send restart command: %s", esp_err_to_name(ret));
                 }
             }
             break;
@@ -252,9 +292,13 @@ static void ble_command_handler(const uint8_t *data, size_t length) {
                     .type = SYS_CMD_FACTORY_RESET
                 };
                 
-                // Send to system command queue
-                if (xQueueSend(g_system_command_queue, &cmd, 0) != pdTRUE) {
-                    ESP_LOGW(TAG, "Failed to send factory reset command (queue full)");
+                // Route to the task that handles it
+                
+                esp_err_t ret = command_bus_publish(&cmd);
+                
+                if (ret != ESP_OK) {
+                
+                    ESP_LOGW(TAG, "Failed to send factory reset command: %s", esp_err_to_name(ret));
                 }
             }
             break;
@@ -280,7 +324,7 @@ static void ble_command_handler(const uint8_t *data, size_t length) {
                     cmd.data.display.text[copy_len] = '\0';
                     
                     // Send to output queue
-                    if (xQueueSend(g_output_command_queue, &cmd, 0) != pdTRUE) {
+                    if (telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &cmd, 0) != pdTRUE) {
                         ESP_LOGW(TAG, "Failed to send display text command (queue full)");
                     }
                 }
@@ -306,7 +350,7 @@ static void ble_command_handler(const uint8_t *data, size_t length) {
                     cmd.data.speak.text[copy_len] = '\0';
                     
                     // Send to output queue
-                    if (xQueueSend(g_output_command_queue, &cmd, 0) != pdTRUE) {
+                    if (telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &cmd, 0) != pdTRUE) {
                         ESP_LOGW(TAG, "Failed to send speak text command (queue full)");
                     }
                 }
@@ -328,14 +372,53 @@ static void ble_command_handler(const uint8_t *data, size_t length) {
                 };
                 
                 // Send to output queue
-                if (xQueueSend(g_output_command_queue, &cmd, 0) != pdTRUE) {
+                if (telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &cmd, 0) != pdTRUE) {
                     ESP_LOGW(TAG, "Failed to send haptic feedback command (queue full)");
                 }
             }
             break;
             
+        case 0x0B: // Sensor trace recording command
+            if (length >= 2) {
+                esp_err_t ret = data[1] ? trace_recorder_start(NULL) : trace_recorder_stop();
+                if (ret != ESP_OK) {
+                    ESP_LOGW(TAG, "Failed to %s trace recording: %s",
+                             data[1] ? "start" : "stop", esp_err_to_name(ret));
+                }
+            }
+            break;
+            
+        case 0x0C: // Cycle trace dump command
+            {
+                // Over the debug characteristic if requested, otherwise to the console
+                bool over_ble = (length >= 2 && data[1] == 1);
+                esp_err_t ret = cycle_trace_dump(over_ble ? ble_trace_sink : cycle_trace_uart_sink, NULL);
+                if (ret != ESP_OK) {
+                    ESP_LOGW(TAG, "Failed to dump cycle trace: %s", esp_err_to_name(ret));
+                }
+            }
+            break;
+            
+        case 0x0D: // Telemetry snapshot command
+            {
+                size_t snapshot_len = 0;
+                esp_err_t ret = telemetry_snapshot(telemetry_buffer, sizeof(telemetry_buffer), &snapshot_len);
+                if (ret == ESP_OK) {
+                    ret = ble_service_send_telemetry(telemetry_buffer, snapshot_len);
+                }
+                if (ret != ESP_OK) {
+                    ESP_LOGW(TAG, "Failed to send telemetry snapshot: %s", esp_err_to_name(ret));
+                }
+            }
+            break;
+            
         default:
             ESP_LOGW(TAG, "Unknown BLE command: 0x%02x", cmd_id);
             break;
     }
-}
\ No newline at end of file
+}
+
+// Sends one line of a cycle trace dump per debug notification
+static void ble_trace_sink(const char *line, void *ctx) {
+    ble_service_send_debug(line);
+}
@@ -1,41 +1,74 @@
 #include "tasks/output_task.h"
 #include <string.h>
+#include <stdio.h>
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "freertos/event_groups.h"
 #include "drivers/display.h"
 #include "drivers/audio.h"
 #include "drivers/haptic.h"
 #include "output/text_generation.h"
 #include "output/output_manager.h"
+#include "communication/ble_service.h"
+#include "core/power_management.h"
 #include "app_main.h"
 #include "config/system_config.h"
+#include "config/memory_layout.h"
 #include "util/debug.h"
+#include "util/cycle_trace.h"
 
 static const char *TAG = "OUTPUT_TASK";
 
 // Task handle
 static TaskHandle_t output_task_handle = NULL;
+STATIC_TASK_STORAGE(output_task, OUTPUT_TASK_STACK_SIZE);
+
+// The task sleeps on this set: both input queues and the outputs going idle
+#define OUTPUT_SET_LENGTH (OUTPUT_QUEUE_SIZE + PROCESSING_QUEUE_SIZE + 1)
+static QueueSetHandle_t output_set = NULL;
+static SemaphoreHandle_t outputs_idle = NULL;  // Given by the audio task and the haptic timer
+static StaticSemaphore_t outputs_idle_storage;
+
+// Newest status screen, held back while a gesture is still being played out
+static output_command_t pending_status;
+static bool status_pending = false;
 
 // Output task function
 static void output_task(void *arg);
 
 esp_err_t output_task_init(void) {
+    outputs_idle = xSemaphoreCreateBinaryStatic(&outputs_idle_storage);
+    output_set = xQueueCreateSet(OUTPUT_SET_LENGTH);
+    if (outputs_idle == NULL || output_set == NULL) {
+        ESP_LOGE(TAG, "Failed to create output queue set");
+        return ESP_ERR_NO_MEM;
+    }
+    
+    // Members must be empty when added; nothing is posted before init completes
+    if (xQueueAddToSet(g_output_command_queue, output_set) != pdPASS ||
+        xQueueAddToSet(g_processing_result_queue, output_set) != pdPASS ||
+        xQueueAddToSet(outputs_idle, output_set) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to add to output queue set");
+        return ESP_FAIL;
+    }
+    audio_set_done_signal(outputs_idle);
+    haptic_set_done_signal(outputs_idle);
+    
     // Create the output task
-    BaseType_t xReturned = xTaskCreatePinnedToCore(
+    output_task_handle = STATIC_TASK_CREATE_PINNED(
         output_task,
         "output_task",
         OUTPUT_TASK_STACK_SIZE,
         NULL,
         OUTPUT_TASK_PRIORITY,
-        &output_task_handle,
         OUTPUT_TASK_CORE
     );
     
-    if (xReturned != pdPASS) {
+    if (output_task_handle == NULL) {
         ESP_LOGE(TAG, "Failed to create output task");
         return ESP_FAIL;
     }
@@ -44,6 +77,163 @@ esp_err_t output_task_init(void) {
     return ESP_OK;
 }
 
+// Show the completion on offer under the text, if there is one
+static void show_suggestion(void) {
+    char suggestion[WORD_DICTIONARY_MAX_WORD + 1];
+    if (text_generation_get_suggestion(suggestion, sizeof(suggestion)) != ESP_OK || suggestion[0] == '\0') {
+        return;
+    }
+    
+    // No origin: latency is counted on the gesture's own text
+    output_command_t command = {
+        .type = OUTPUT_CMD_DISPLAY_TEXT,
+        .data.display.size = DISPLAY_FONT_SMALL,
+        .data.display.line = 3,
+        .data.display.clear_first = false
+    };
+    snprintf(command.data.display.text, sizeof(command.data.display.text), "+%s", suggestion);
+    output_manager_handle_command(&command);
+}
+
+// Status screens would overwrite a gesture still being spoken or felt
+static bool is_status(const output_command_t *command) {
+    return command->type == OUTPUT_CMD_SHOW_STATUS || command->type == OUTPUT_CMD_SHOW_BATTERY;
+}
+
+static bool outputs_busy(void) {
+    bool haptic_active = false;
+    haptic_is_active(&haptic_active);
+    return audio_is_active() || haptic_active;
+}
+
+static void handle_command(output_command_t *command) {
+    CYCLE_TRACE_BEGIN(CYCLE_TRACE_OUTPUT_COMMAND);
+    output_manager_handle_command(command);
+    CYCLE_TRACE_END(CYCLE_TRACE_OUTPUT_COMMAND);
+}
+
+static void handle_result(processing_result_t *result) {
+    CYCLE_TRACE_BEGIN(CYCLE_TRACE_OUTPUT_RESULT);
+    
+    // Time to first gesture after power-on, the boot time users notice
+    static bool first_result_seen = false;
+    if (!first_result_seen) {
+        first_result_seen = true;
+        ESP_LOGI(TAG, "First gesture %lu ms after reset", (unsigned long)(esp_timer_get_time() / 1000));
+    }
+    
+    // Generate text from the recognition result
+    char text[64];
+    text_generation_generate_text(result, text, sizeof(text));
+    
+    // The client gets every result whatever the output mode, batched
+    ble_service_send_gesture(result->gesture_id, result->gesture_name, result->confidence,
+                             result->sample_timestamp);
+    
+    // Every sink reached by this result reports its latency against the sample
+    output_command_t command = {
+        .origin_timestamp = result->sample_timestamp
+    };
+    
+    // Create output commands based on the current output mode
+    switch (g_system_config.output_mode) {
+        case OUTPUT_MODE_TEXT_ONLY:
+            // Display the text
+            command.type = OUTPUT_CMD_DISPLAY_TEXT;
+            strncpy(command.data.display.text, text, sizeof(command.data.display.text) - 1);
+            command.data.display.size = DISPLAY_FONT_SMALL;
+            command.data.display.line = 1;
+            command.data.display.clear_first = true;
+            
+            // Process the command
+            output_manager_handle_command(&command);
+            show_suggestion();
+            break;
+            
+        case OUTPUT_MODE_AUDIO_ONLY:
+            // Speak the text
+            command.type = OUTPUT_CMD_SPEAK_TEXT;
+            strncpy(command.data.speak.text, text, sizeof(command.data.speak.text) - 1);
+            command.data.speak.priority = 0;
+            
+            // Process the command
+            output_manager_handle_command(&command);
+            break;
+            
+        case OUTPUT_MODE_TEXT_AND_AUDIO:
+            // Display the text
+            command.type = OUTPUT_CMD_DISPLAY_TEXT;
+            strncpy(command.data.display.text, text, sizeof(command.data.display.text) - 1);
+            command.data.display.size = DISPLAY_FONT_SMALL;
+            command.data.display.line = 1;
+            command.data.display.clear_first = true;
+            
+            // Process the command
+            output_manager_handle_command(&command);
+            show_suggestion();
+            
+            // Speak the text
+            command.type = OUTPUT_CMD_SPEAK_TEXT;
+            strncpy(command.data.speak.text, text, sizeof(command.data.speak.text) - 1);
+            command.data.speak.priority = 0;
+            
+            // Process the command
+            output_manager_handle_command(&command);
+            break;
+            
+        case OUTPUT_MODE_MINIMAL:
+            // Just provide haptic feedback for confirmation
+            command.type = OUTPUT_CMD_HAPTIC_FEEDBACK;
+            command.data.haptic.pattern = 0;  // Simple pattern
+            command.data.haptic.intensity = g_system_config.haptic_intensity;
+            command.data.haptic.duration_ms = 100;
+            
+            // Process the command
+            output_manager_handle_command(&command);
+            break;
+    }
+    
+    CYCLE_TRACE_END(CYCLE_TRACE_OUTPUT_RESULT);
+}
+
+/**
+ * Take exactly one item from the set members, whichever the set woke us
+ * for, so the set always holds one entry per item still waiting. Errors
+ * come first (they are queued at the front of the command queue), then
+ * gesture results, then the other commands. Returns false when it was
+ * only the outputs going idle.
+ */
+static bool handle_next(void) {
+    output_command_t command;
+    processing_result_t result;
+    
+    if (xQueuePeek(g_output_command_queue, &command, 0) == pdTRUE &&
+        command.type == OUTPUT_CMD_SHOW_ERROR) {
+        xQueueReceive(g_output_command_queue, &command, 0);
+        handle_command(&command);
+        return true;
+    }
+    
+    if (xQueueReceive(g_processing_result_queue, &result, 0) == pdTRUE) {
+        handle_result(&result);
+        return true;
+    }
+    
+    if (xQueueReceive(g_output_command_queue, &command, 0) == pdTRUE) {
+        if (is_status(&command) && outputs_busy()) {
+            pending_status = command;
+            status_pending = true;
+        } else {
+            handle_command(&command);
+        }
+        return true;
+    }
+    
+    // Nothing queued: the outputs went idle
+    xSemaphoreTake(outputs_idle, 0);
+    return false;
+}
+
 static void output_task(void *arg) {
     ESP_LOGI(TAG, "Output task started");
     
@@ -55,91 +245,45 @@ static void output_task(void *arg) {
                         SYSTEM_EVENT_INIT_COMPLETE, 
                         pdFALSE, pdTRUE, portMAX_DELAY);
     
-    // Processing result and output command
-    processing_result_t result;
-    output_command_t command;
-    
     // Show the system is ready on the display
     display_clear();
     display_draw_text("Ready", 0, 20, DISPLAY_FONT_SMALL, DISPLAY_ALIGN_CENTER);
     display_draw_text("Waiting for gestures...", 0, 36, DISPLAY_FONT_SMALL, DISPLAY_ALIGN_CENTER);
     display_update();
     
-    // Play a short beep to indicate readiness
-    audio_play_beep(1000, 100);
+    // Beep readiness only when gestures will be spoken; this is what first
+    // brings up the audio driver, kept off the boot path
+    if (g_system_config.output_mode == OUTPUT_MODE_AUDIO_ONLY ||
+        g_system_config.output_mode == OUTPUT_MODE_TEXT_AND_AUDIO) {
+        audio_play_beep(1000, 100);
+    }
     
+    bool lock_held = false;
     while (1) {
-        // Check for output commands first (priority)
-        if (xQueueReceive(g_output_command_queue, &command, 0) == pdTRUE) {
-            // Process the command
-            output_manager_handle_command(&command);
+        // Sleep until a command, a result or the outputs going idle; while
+        // the frequency lock is held, also wake to let the governor drop it
+        TickType_t wait = lock_held ? pdMS_TO_TICKS(POWER_GOVERNOR_HOLD_MS) : portMAX_DELAY;
+        QueueSetMemberHandle_t member = xQueueSelectFromSet(output_set, wait);
+        if (member == NULL) {
+            lock_held = power_management_report_stage(POWER_STAGE_OUTPUT, outputs_busy(), 0);
+            continue;
+        }
+        if (member != (QueueSetMemberHandle_t)outputs_idle) {
+            // A result or command: run it at full speed from the start
+            power_management_begin_stage(POWER_STAGE_OUTPUT);
         }
         
-        // Check for processing results
-        if (xQueueReceive(g_processing_result_queue, &result, 0) == pdTRUE) {
-            // Generate text from the recognition result
-            char text[64];
-            text_generation_generate_text(&result, text, sizeof(text));
-            
-            // Create output commands based on the current output mode
-            switch (g_system_config.output_mode) {
-                case OUTPUT_MODE_TEXT_ONLY:
-                    // Display the text
-                    command.type = OUTPUT_CMD_DISPLAY_TEXT;
-                    strncpy(command.data.display.text, text, sizeof(command.data.display.text) - 1);
-                    command.data.display.size = DISPLAY_FONT_SMALL;
-                    command.data.display.line = 1;
-                    command.data.display.clear_first = true;
-                    
-                    // Process the command
-                    output_manager_handle_command(&command);
-                    break;
-                    
-                case OUTPUT_MODE_AUDIO_ONLY:
-                    // Speak the text
-                    command.type = OUTPUT_CMD_SPEAK_TEXT;
-                    strncpy(command.data.speak.text, text, sizeof(command.data.speak.text) - 1);
-                    command.data.speak.priority = 0;
-                    
-                    // Process the command
-                    output_manager_handle_command(&command);
-                    break;
-                    
-                case OUTPUT_MODE_TEXT_AND_AUDIO:
-                    // Display the text
-                    command.type = OUTPUT_CMD_DISPLAY_TEXT;
-                    strncpy(command.data.display.text, text, sizeof(command.data.display.text) - 1);
-                    command.data.display.size = DISPLAY_FONT_SMALL;
-                    command.data.display.line = 1;
-                    command.data.display.clear_first = true;
-                    
-                    // Process the command
-                    output_manager_handle_command(&command);
-                    
-                    // Speak the text
-                    command.type = OUTPUT_CMD_SPEAK_TEXT;
-                    strncpy(command.data.speak.text, text, sizeof(command.data.speak.text) - 1);
-                    command.data.speak.priority = 0;
-                    
-                    // Process the command
-                    output_manager_handle_command(&command);
-                    break;
-                    
-                case OUTPUT_MODE_MINIMAL:
-                    // Just provide haptic feedback for confirmation
-                    command.type = OUTPUT_CMD_HAPTIC_FEEDBACK;
-                    command.data.haptic.pattern = 0;  // Simple pattern
-                    command.data.haptic.intensity = g_system_config.haptic_intensity;
-                    command.data.haptic.duration_ms = 100;
-                    
-                    // Process the command
-                    output_manager_handle_command(&command);
-                    break;
-            }
+        int64_t start_time = esp_timer_get_time();
+        bool handled = handle_next();
+        
+        if (status_pending && !outputs_busy()) {
+            status_pending = false;
+            handle_command(&pending_status);
         }
         
-        // Short delay to prevent CPU hogging
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // Busy while a gesture is still being spoken or felt
+        lock_held = power_management_report_stage(POWER_STAGE_OUTPUT, handled || outputs_busy(),
+                                                  (uint32_t)(esp_timer_get_time() - start_time));
     }
 }
 
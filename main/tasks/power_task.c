@@ -10,8 +10,12 @@
 #include "freertos/event_groups.h"
 #include "core/power_management.h"
 #include "core/system_monitor.h"
+#include "core/command_bus.h"
+#include "core/telemetry.h"
+#include "core/calibration.h"
 #include "app_main.h"
 #include "config/system_config.h"
+#include "config/memory_layout.h"
 #include "util/debug.h"
 #include "output/output_manager.h"
 
@@ -19,6 +23,10 @@ static const char *TAG = "POWER_TASK";
 
 // Task handle
 static TaskHandle_t power_task_handle = NULL;
+STATIC_TASK_STORAGE(power_task, POWER_TASK_STACK_SIZE);
+
+// Longest the task sleeps between its periodic checks
+#define POWER_TASK_PERIOD_MS 100
 
 // Last battery check time
 static uint32_t last_battery_check_ms = 0;
@@ -39,18 +47,30 @@ static void exit_power_save_mode(void);
 static void check_battery_status(void);
 
 esp_err_t power_task_init(void) {
+    // Every system command but Bluetooth on and off comes to this task
+    esp_err_t ret = command_bus_subscribe(COMMAND_SUBSCRIBER_POWER,
+                                          COMMAND_BUS_TYPE(SYS_CMD_CHANGE_STATE) |
+                                          COMMAND_BUS_TYPE(SYS_CMD_CALIBRATE) |
+                                          COMMAND_BUS_TYPE(SYS_CMD_SET_POWER_MODE) |
+                                          COMMAND_BUS_TYPE(SYS_CMD_RESTART) |
+                                          COMMAND_BUS_TYPE(SYS_CMD_SLEEP) |
+                                          COMMAND_BUS_TYPE(SYS_CMD_FACTORY_RESET));
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to subscribe to system commands: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    
     // Create the power task
-    BaseType_t ret = xTaskCreatePinnedToCore(
+    power_task_handle = STATIC_TASK_CREATE_PINNED(
         power_task,
         "power_task",
         POWER_TASK_STACK_SIZE,
         NULL,
         POWER_TASK_PRIORITY,
-        &power_task_handle,
         POWER_TASK_CORE
     );
     
-    if (ret != pdPASS) {
+    if (power_task_handle == NULL) {
         ESP_LOGE(TAG, "Failed to create power task");
         return ESP_FAIL;
     }
@@ -77,13 +97,14 @@ static void power_task(void *arg) {
     system_command_t system_cmd;
     
     while (1) {
-        current_time_ms = esp_timer_get_time() / 1000;
-        
-        // Check for system commands
-        if (xQueueReceive(g_system_command_queue, &system_cmd, 0) == pdTRUE) {
+        // Wait for a system command, at most one period; a command is
+        // handled as soon as it arrives
+        if (command_bus_receive(COMMAND_SUBSCRIBER_POWER, &system_cmd, pdMS_TO_TICKS(POWER_TASK_PERIOD_MS)) == pdTRUE) {
             handle_system_command(&system_cmd);
         }
         
+        current_time_ms = esp_timer_get_time() / 1000;
+        
         // Check battery status periodically
         if (current_time_ms - last_battery_check_ms >= BATTERY_CHECK_INTERVAL_MS) {
             check_battery_status();
@@ -103,7 +124,7 @@ static void power_task(void *arg) {
                 };
                 
                 // Send to output queue
-                if (xQueueSend(g_output_command_queue, &cmd, 0) != pdTRUE) {
+                if (telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &cmd, 0) != pdTRUE) {
                     ESP_LOGW(TAG, "Failed to send status display command (queue full)");
                 }
             }
@@ -128,19 +149,9 @@ static void power_task(void *arg) {
                 // This would be specific to the application
             }
             
-            if (metrics.cpu_usage_percent > 80) {  // High CPU usage
-                ESP_LOGW(TAG, "High CPU usage detected: %u%%", metrics.cpu_usage_percent);
-                
-                // Consider throttling some non-essential tasks
-                if (power_management_get_mode() != POWER_MODE_PERFORMANCE) {
-                    // Temporarily boost performance
-                    power_management_set_mode(POWER_MODE_BALANCED);
-                }
-            }
+            // CPU frequency follows the pipeline stages' own deadlines
+            // (power_management_report_stage()), not the CPU average
         }
-        
-        // Short delay to prevent CPU hogging
-        vTaskDelay(pdMS_TO_TICKS(100));
     }
 }
 
@@ -191,23 +202,13 @@ static void handle_system_command(system_command_t *cmd) {
         case SYS_CMD_CALIBRATE:
             ESP_LOGI(TAG, "Executing calibration command");
             
-            // Set system state to calibration
-            g_system_config.system_state = SYSTEM_STATE_CALIBRATION;
-            
-            // Create output command for calibration instructions
-            output_command_t out_cmd = {
-                .type = OUTPUT_CMD_DISPLAY_TEXT,
-                .data.display.clear_first = true,
-                .data.display.line = 0,
-                .data.display.size = 0
-            };
-            
-            strcpy(out_cmd.data.display.text, "Calibration Mode");
-            xQueueSend(g_output_command_queue, &out_cmd, 0);
+            // The session prompts on the display and sends SYSTEM_STATE_ACTIVE when done
+            if (calibration_start() != ESP_OK) {
+                ESP_LOGW(TAG, "Calibration already running");
+                break;
+            }
             
-            // Execute calibration sequence here
-            // This would involve flex sensor calibration, IMU calibration, etc.
-            // For now, this is just a placeholder
+            g_system_config.system_state = SYSTEM_STATE_CALIBRATION;
             
             // Reset inactivity timer
             power_management_reset_inactivity_timer();
@@ -234,7 +235,7 @@ static void handle_system_command(system_command_t *cmd) {
             };
             
             strcpy(restart_cmd.data.display.text, "Restarting...");
-            xQueueSend(g_output_command_queue, &restart_cmd, 0);
+            telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &restart_cmd, 0);
             
             // Give some time for the message to be displayed
             vTaskDelay(pdMS_TO_TICKS(1000));
@@ -257,7 +258,7 @@ static void handle_system_command(system_command_t *cmd) {
             
             sprintf(sleep_cmd.data.display.text, "Sleeping for %d sec...", 
                     cmd->data.sleep.sleep_duration_sec);
-            xQueueSend(g_output_command_queue, &sleep_cmd, 0);
+            telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &sleep_cmd, 0);
             
             // Give some time for the message to be displayed
             vTaskDelay(pdMS_TO_TICKS(1000));
@@ -281,7 +282,7 @@ static void handle_system_command(system_command_t *cmd) {
             };
             
             strcpy(reset_cmd.data.display.text, "Factory reset...");
-            xQueueSend(g_output_command_queue, &reset_cmd, 0);
+            telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &reset_cmd, 0);
             
             // Give some time for the message to be displayed
             vTaskDelay(pdMS_TO_TICKS(1000));
@@ -334,7 +335,7 @@ static void enter_power_save_mode(void) {
     };
     
     strcpy(cmd.data.display.text, "Power Save: ON");
-    xQueueSend(g_output_command_queue, &cmd, 0);
+    telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &cmd, 0);
 }
 
 static void exit_power_save_mode(void) {
@@ -355,7 +356,7 @@ static void exit_power_save_mode(void) {
     };
     
     strcpy(cmd.data.display.text, "Power Save: OFF");
-    xQueueSend(g_output_command_queue, &cmd, 0);
+    telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &cmd, 0);
 }
 
 static void check_battery_status(void) {
@@ -390,7 +391,8 @@ static void check_battery_status(void) {
             .data.error.error_text = "Battery critically low!"
         };
         
-        xQueueSend(g_output_command_queue, &cmd, 0);
+        // Errors go ahead of anything queued for the output task
+        telemetry_queue_send_to_front(TELEMETRY_QUEUE_OUTPUT_COMMAND, &cmd, 0);
         
         // Set low battery event bit
         xEventGroupSetBits(g_system_event_group, SYSTEM_EVENT_LOW_BATTERY);
@@ -406,7 +408,7 @@ static void check_battery_status(void) {
             .data.battery.show_graphic = true
         };
         
-        xQueueSend(g_output_command_queue, &cmd, 0);
+        telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &cmd, 0);
         
         // Enter power save mode
         if (g_system_config.power_save_enabled == false) {
@@ -430,7 +432,7 @@ static void check_battery_status(void) {
                 .data.battery.show_graphic = true
             };
             
-            xQueueSend(g_output_command_queue, &cmd, 0);
+            telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &cmd, 0);
         }
     }
     else if (g_system_config.system_state == SYSTEM_STATE_CHARGING && !battery_status.is_charging) {
@@ -447,7 +449,7 @@ static void check_battery_status(void) {
             .data.battery.show_graphic = true
         };
         
-        xQueueSend(g_output_command_queue, &cmd, 0);
+        telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &cmd, 0);
     }
     else if (g_system_config.system_state == SYSTEM_STATE_LOW_BATTERY && 
              !battery_status.is_low && !battery_status.is_critical) {
@@ -468,7 +470,7 @@ static void check_battery_status(void) {
             .data.battery.show_graphic = true
         };
         
-        xQueueSend(g_output_command_queue, &cmd, 0);
+        telemetry_queue_send(TELEMETRY_QUEUE_OUTPUT_COMMAND, &cmd, 0);
         
         // Return to balanced power mode
         power_management_set_mode(POWER_MODE_BALANCED);
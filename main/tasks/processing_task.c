@@ -9,52 +9,117 @@
 #include "processing/sensor_fusion.h"
 #include "processing/feature_extraction.h"
 #include "processing/gesture_detection.h"
+#include "processing/motion_gate.h"
+#include "core/power_management.h"
+#include "core/telemetry.h"
 #include "app_main.h"
 #include "config/system_config.h"
+#include "config/memory_layout.h"
 #include "config/pin_definitions.h"
 #include "util/debug.h"
 #include "util/buffer.h"
+#include "util/frame_pool.h"
+#include "util/history_window.h"
+#include "util/window_stats.h"
+#include "util/spsc_ring.h"
+#include "util/cycle_trace.h"
+#include "ml_inference.h"
+#if GLOVE_HAND_SECONDARY
+#include "communication/hand_link.h"
+#endif
 
 static const char *TAG = "PROCESSING_TASK";
 
-// Task handle
+/**
+ * Output of the feature stage, consumed in place by the classify stage
+ */
+typedef struct {
+    feature_vector_t features;
+    float motion_sequence[GESTURE_MOTION_SEQUENCE_VALUES];
+    bool has_motion;            // Gate asked for DTW and the history was long enough
+    uint32_t sequence_number;   // Aligned sensor frame the features came from
+} feature_frame_t;
+
+// Stage task handles
 static TaskHandle_t processing_task_handle = NULL;
+static TaskHandle_t feature_stage_handle = NULL;
+static TaskHandle_t classify_stage_handle = NULL;
+STATIC_TASK_STORAGE(processing_task, PROCESSING_TASK_STACK_SIZE);
+STATIC_TASK_STORAGE(feature_stage_task, FEATURE_STAGE_STACK_SIZE);
+STATIC_TASK_STORAGE(classify_stage_task, CLASSIFY_STAGE_STACK_SIZE);
+
+// Rings between the stages: fusion -> features -> classify
+static MEM_HOT sensor_data_t aligned_slots[PIPELINE_RING_DEPTH];
+static MEM_HOT feature_frame_t feature_slots[PIPELINE_RING_DEPTH];
+static spsc_ring_t aligned_ring;
+static spsc_ring_t feature_ring;
+
+// Aligned frames still have to leave fusion when the feature stage falls behind
+static sensor_data_t overflow_frame;
+
+// Per-channel history for temporal features (feature stage only); the
+// largest buffer on the frame path, read once per frame, so it lives in PSRAM
+static MEM_BULK history_window_t history_window;
+
+// Running statistics over the tail of the history window (feature stage only)
+static window_stats_t window_stats;
 
-// Buffer for sensor data history
-static sensor_data_buffer_t sensor_data_buffer;
+#if GLOVE_HAND_SECONDARY
+// Features of this hand on their way to the primary glove (feature stage only)
+static feature_vector_t hand_features;
+#endif
 
-// Processing task function
+// Stage task functions
 static void processing_task(void *arg);
+static void feature_stage_task(void *arg);
+static void classify_stage_task(void *arg);
+static bool extract_frame(sensor_data_t *sensor_data);
+static void classify_frame(feature_frame_t *frame);
+
+static esp_err_t check_stage(TaskHandle_t handle, const char *name) {
+    if (handle == NULL) {
+        ESP_LOGE(TAG, "Failed to create %s", name);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
 
 esp_err_t processing_task_init(void) {
-    // Initialize sensor data buffer
-    esp_err_t ret = buffer_init(&sensor_data_buffer, 20);  // Buffer for 20 samples
+    // Initialize feature history window
+    history_window_init(&history_window);
+    window_stats_init(&window_stats);
+    motion_gate_init();
+    
+    spsc_ring_init(&aligned_ring, aligned_slots, sizeof(sensor_data_t), PIPELINE_RING_DEPTH);
+    spsc_ring_init(&feature_ring, feature_slots, sizeof(feature_frame_t), PIPELINE_RING_DEPTH);
+    telemetry_register_ring(TELEMETRY_DROP_ALIGNED_FRAME, &aligned_ring);
+    telemetry_register_ring(TELEMETRY_DROP_FEATURE_FRAME, &feature_ring);
+    
+    // Consumers first, so every producer has someone to notify
+    classify_stage_handle = STATIC_TASK_CREATE_PINNED(classify_stage_task, "classify_stage", CLASSIFY_STAGE_STACK_SIZE,
+                                                      NULL, CLASSIFY_STAGE_PRIORITY, CLASSIFY_STAGE_CORE);
+    esp_err_t ret = check_stage(classify_stage_handle, "classify_stage");
+    if (ret == ESP_OK) {
+        feature_stage_handle = STATIC_TASK_CREATE_PINNED(feature_stage_task, "feature_stage", FEATURE_STAGE_STACK_SIZE,
+                                                         NULL, FEATURE_STAGE_PRIORITY, FEATURE_STAGE_CORE);
+        ret = check_stage(feature_stage_handle, "feature_stage");
+    }
+    if (ret == ESP_OK) {
+        processing_task_handle = STATIC_TASK_CREATE_PINNED(processing_task, "processing_task", PROCESSING_TASK_STACK_SIZE,
+                                                           NULL, PROCESSING_TASK_PRIORITY, PROCESSING_TASK_CORE);
+        ret = check_stage(processing_task_handle, "processing_task");
+    }
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to initialize sensor data buffer: %s", esp_err_to_name(ret));
+        processing_task_deinit();
         return ret;
     }
     
-    // Create the processing task
-    BaseType_t xReturned = xTaskCreatePinnedToCore(
-        processing_task,
-        "processing_task",
-        PROCESSING_TASK_STACK_SIZE,
-        NULL,
-        PROCESSING_TASK_PRIORITY,
-        &processing_task_handle,
-        PROCESSING_TASK_CORE
-    );
-    
-    if (xReturned != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create processing task");
-        buffer_free(&sensor_data_buffer);
-        return ESP_FAIL;
-    }
-    
-    ESP_LOGI(TAG, "Processing task initialized on core %d", PROCESSING_TASK_CORE);
+    ESP_LOGI(TAG, "Processing pipeline initialized: fusion on core %d, features on core %d, classify on core %d",
+             PROCESSING_TASK_CORE, FEATURE_STAGE_CORE, CLASSIFY_STAGE_CORE);
     return ESP_OK;
 }
 
+// Stage 1: align sensor updates on the fusion clock
 static void processing_task(void *arg) {
     ESP_LOGI(TAG, "Processing task started");
     
@@ -62,59 +127,187 @@ static void processing_task(void *arg) {
     xEventGroupSetBits(g_system_event_group, SYSTEM_EVENT_PROCESSING_READY);
     
     // Wait for system initialization to complete
-    xEventGroupWaitBits(g_system_event_group, 
-                        SYSTEM_EVENT_INIT_COMPLETE, 
+    xEventGroupWaitBits(g_system_event_group,
+                        SYSTEM_EVENT_INIT_COMPLETE,
                         pdFALSE, pdTRUE, portMAX_DELAY);
     
-    // Sensor data and feature vector
-    sensor_data_t sensor_data;
-    feature_vector_t feature_vector;
-    
-    // Processing result
-    processing_result_t result;
+    // Sensor frame slot
+    sensor_frame_index_t frame_index;
     
     while (1) {
         // Wait for sensor data from queue
-        if (xQueueReceive(g_sensor_data_queue, &sensor_data, pdMS_TO_TICKS(100)) == pdTRUE) {
-            // Store sensor data in buffer for temporal analysis
-            buffer_push(&sensor_data_buffer, &sensor_data);
+        bool received = xQueueReceive(g_sensor_data_queue, &frame_index, pdMS_TO_TICKS(100)) == pdTRUE;
+        int64_t start_time = esp_timer_get_time();
+        if (received) {
+            CYCLE_TRACE_BEGIN(CYCLE_TRACE_FUSION);
+            
+            // The frame is shared with the producer, read it in place
+            sensor_data_t *sensor_data = frame_pool_get(frame_index);
+            if (sensor_data != NULL) {
+                sensor_fusion_ingest(sensor_data);
+            }
             
-            // Perform sensor fusion
-            sensor_fusion_process(&sensor_data, &sensor_data_buffer);
+            // Drop the reference received from the sensor task
+            frame_pool_release(frame_index);
+        }
+        
+        // One frame per fusion tick, aligned straight into the next ring slot
+        while (1) {
+            sensor_data_t *slot = spsc_ring_acquire_write(&aligned_ring);
+            sensor_data_t *target = (slot != NULL) ? slot : &overflow_frame;
             
-            // Extract features from sensor data
-            if (feature_extraction_process(&sensor_data, &sensor_data_buffer, &feature_vector) == ESP_OK) {
-                // Detect gesture based on features
-                if (gesture_detection_process(&feature_vector, &result) == ESP_OK) {
-                    // If a gesture was detected with sufficient confidence
-                    if (result.confidence >= CONFIDENCE_THRESHOLD) {
-                        // Add timestamp to result
-                        result.timestamp = esp_timer_get_time() / 1000;
-                        
-                        ESP_LOGI(TAG, "Gesture detected: %s (confidence: %.2f)", 
-                                result.gesture_name, result.confidence);
-                        
-                        // Send result to output task
-                        if (xQueueSend(g_processing_result_queue, &result, 0) != pdTRUE) {
-                            ESP_LOGW(TAG, "Failed to send processing result to queue (queue full)");
-                        }
-                    }
-                }
+            if (sensor_fusion_get_aligned(target) != ESP_OK) {
+                break;
+            }
+            
+            if (slot != NULL) {
+                spsc_ring_commit_write(&aligned_ring);
+                xTaskNotifyGive(feature_stage_handle);
+            } else {
+                // Counted by the ring, reported through telemetry
+                ESP_LOGW(TAG, "Feature stage behind, aligned frame dropped");
             }
         }
         
-        // Check system events or commands if any (could add here)
+        if (received) {
+            ml_inference_record_stage(ML_STAGE_FUSION, (uint32_t)(esp_timer_get_time() - start_time));
+            CYCLE_TRACE_END(CYCLE_TRACE_FUSION);
+        }
     }
 }
 
-void processing_task_deinit(void) {
-    // Cleanup resources when task is deleted
-    if (processing_task_handle != NULL) {
-        vTaskDelete(processing_task_handle);
-        processing_task_handle = NULL;
+// Stage 2: history, gating and feature extraction
+static void feature_stage_task(void *arg) {
+    ESP_LOGI(TAG, "Feature stage started");
+    
+    while (1) {
+        // Idle wakeups let the governor drop the frequency lock
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100)) == 0) {
+            power_management_report_stage(POWER_STAGE_FEATURES, false, 0);
+        }
+        
+        sensor_data_t *sensor_data;
+        while ((sensor_data = spsc_ring_peek_read(&aligned_ring)) != NULL) {
+            int64_t start_time = esp_timer_get_time();
+            CYCLE_TRACE_BEGIN(CYCLE_TRACE_FEATURES);
+            bool moving = extract_frame(sensor_data);
+            CYCLE_TRACE_END(CYCLE_TRACE_FEATURES);
+            uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_time);
+            ml_inference_record_stage(ML_STAGE_FEATURES, elapsed_us);
+            power_management_report_stage(POWER_STAGE_FEATURES, moving, elapsed_us);
+            spsc_ring_release_read(&aligned_ring);
+        }
     }
+}
+
+// Stage 3: template matching, DTW and result delivery
+static void classify_stage_task(void *arg) {
+    ESP_LOGI(TAG, "Classify stage started");
     
-    buffer_free(&sensor_data_buffer);
+    while (1) {
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100)) == 0) {
+            power_management_report_stage(POWER_STAGE_CLASSIFY, false, 0);
+        }
+        
+        // Feature frames only come while the hand moves: each one is part of a gesture
+        feature_frame_t *frame;
+        while ((frame = spsc_ring_peek_read(&feature_ring)) != NULL) {
+            power_management_begin_stage(POWER_STAGE_CLASSIFY);
+            int64_t start_time = esp_timer_get_time();
+            CYCLE_TRACE_BEGIN(CYCLE_TRACE_CLASSIFY);
+            classify_frame(frame);
+            CYCLE_TRACE_END(CYCLE_TRACE_CLASSIFY);
+            uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_time);
+            ml_inference_record_stage(ML_STAGE_MATCHING, elapsed_us);
+            power_management_report_stage(POWER_STAGE_CLASSIFY, true, elapsed_us);
+            spsc_ring_release_read(&feature_ring);
+        }
+    }
+}
+
+// Returns whether the hand is moving, i.e. a gesture may be in progress
+static bool extract_frame(sensor_data_t *sensor_data) {
+    // Store the aligned frame for temporal analysis
+    history_window_push(&history_window, sensor_data);
+    window_stats_update(&window_stats, &history_window);
+    
+    // Cheap first stage: skip the rest while the hand is idle, and DTW
+    // unless it is moving
+    motion_gate_decision_t gate = motion_gate_evaluate(sensor_data);
+    if (gate != MOTION_GATE_IDLE) {
+        // Full speed from the first moving frame, not after it
+        power_management_begin_stage(POWER_STAGE_FEATURES);
+    }
+    
+#if GLOVE_HAND_SECONDARY
+    // The secondary of a pair classifies nothing: the primary gets this
+    // hand's features while it moves, and its pose now and then at rest
+    bool moving = gate != MOTION_GATE_IDLE;
+    if (moving || hand_link_keepalive_due(sensor_data->timestamp)) {
+        if (feature_extraction_process(sensor_data, &history_window, &window_stats,
+                                       &hand_features) == ESP_OK) {
+            hand_link_send_features(&hand_features, !moving);
+        }
+    }
+    return moving;
+#endif
+    
+    if (gate == MOTION_GATE_IDLE) {
+        return false;
+    }
+    
+    feature_frame_t *frame = spsc_ring_acquire_write(&feature_ring);
+    if (frame == NULL) {
+        ESP_LOGW(TAG, "Classify stage behind, feature frame dropped");
+        return true;
+    }
+    
+    // Extract features from sensor data
+    if (feature_extraction_process(sensor_data, &history_window, &window_stats,
+                                   &frame->features) != ESP_OK) {
+        return true;
+    }
+    
+    frame->sequence_number = sensor_data->sequence_number;
+    
+    // The classify stage cannot read the history, so hand it the motion
+    frame->has_motion = gate == MOTION_GATE_DYNAMIC &&
+                        gesture_detection_capture_motion(&history_window, frame->motion_sequence) == ESP_OK;
+    
+    spsc_ring_commit_write(&feature_ring);
+    xTaskNotifyGive(classify_stage_handle);
+    return true;
+}
+
+static void classify_frame(feature_frame_t *frame) {
+    processing_result_t result;
+    
+    // Detect gesture based on features
+    if (gesture_detection_process(&frame->features, frame->has_motion ? frame->motion_sequence : NULL,
+                                  &result) == ESP_OK) {
+        // If a gesture was detected (each template applies its own threshold)
+        if (result.confidence > 0.0f) {
+            // Add timestamp to result; sample_timestamp already holds the sample time
+            result.sample_sequence = frame->sequence_number;
+            result.timestamp = esp_timer_get_time() / 1000;
+            
+            // Send result to output task
+            if (telemetry_queue_send(TELEMETRY_QUEUE_PROCESSING_RESULT, &result, 0) != pdTRUE) {
+                ESP_LOGW(TAG, "Failed to send processing result to queue (queue full)");
+            }
+        }
+    }
+}
+
+void processing_task_deinit(void) {
+    // Cleanup resources when task is deleted; producers go first
+    TaskHandle_t *handles[] = { &processing_task_handle, &feature_stage_handle, &classify_stage_handle };
+    for (size_t i = 0; i < sizeof(handles) / sizeof(handles[0]); i++) {
+        if (*handles[i] != NULL) {
+            vTaskDelete(*handles[i]);
+            *handles[i] = NULL;
+        }
+    }
     
     ESP_LOGI(TAG, "Processing task deinitialized");
-}
\ No newline at end of file
+}
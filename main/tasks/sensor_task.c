@@ -2,36 +2,38 @@
 #include <string.h>
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "esp_attr.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/event_groups.h"
+#include "config/system_config.h"
 #include "drivers/flex_sensor.h"
 #include "drivers/imu.h"
-#include "drivers/camera.h"
+#if GLOVE_HAS_CAMERA
+#include "tasks/camera_task.h"
+#endif
+#if GLOVE_HAS_TOUCH
 #include "drivers/touch.h"
+#endif
+#include "core/sample_scheduler.h"
+#include "core/trace_recorder.h"
+#include "core/sensor_stream.h"
+#include "core/telemetry.h"
+#include "core/calibration.h"
 #include "app_main.h"
-#include "config/system_config.h"
+#include "config/memory_layout.h"
 #include "config/pin_definitions.h"
 #include "util/debug.h"
 #include "util/buffer.h"
+#include "util/frame_pool.h"
+#include "util/cycle_trace.h"
 
 static const char *TAG = "SENSOR_TASK";
 
 // Task handle
 static TaskHandle_t sensor_task_handle = NULL;
-
-// Sensor sampling rates (in milliseconds)
-#define FLEX_SENSOR_SAMPLE_INTERVAL  (1000 / FLEX_SENSOR_SAMPLE_RATE_HZ)
-#define IMU_SAMPLE_INTERVAL          (1000 / IMU_SAMPLE_RATE_HZ)
-#define CAMERA_SAMPLE_INTERVAL       (1000 / CAMERA_FRAME_RATE_HZ)
-#define TOUCH_SAMPLE_INTERVAL        (1000 / TOUCH_SAMPLE_RATE_HZ)
-
-// Last sampling timestamps
-static uint32_t last_flex_sample_time = 0;
-static uint32_t last_imu_sample_time = 0;
-static uint32_t last_camera_sample_time = 0;
-static uint32_t last_touch_sample_time = 0;
+STATIC_TASK_STORAGE(sensor_task, SENSOR_TASK_STACK_SIZE);
 
 // Sensor data storage
 static sensor_data_t current_sensor_data;
@@ -40,35 +42,47 @@ static uint32_t sequence_number = 0;
 // Forward declarations for sampling functions
 static esp_err_t sample_flex_sensors(void);
 static esp_err_t sample_imu(void);
+#if GLOVE_HAS_CAMERA
 static esp_err_t sample_camera(void);
+#endif
+#if GLOVE_HAS_TOUCH
 static esp_err_t sample_touch_sensors(void);
-static void touch_callback(bool *status);
+static void touch_callback(void *arg);
+#endif
+static esp_err_t publish_sensor_frame(uint32_t timestamp);
+static void imu_data_ready_callback(void *arg);
+static void release_frame_resources(sensor_data_t *frame);
 
 // Sensor task function
 static void sensor_task(void *arg);
 
 esp_err_t sensor_task_init(void) {
     // Create the sensor task
-    BaseType_t ret = xTaskCreatePinnedToCore(
+    sensor_task_handle = STATIC_TASK_CREATE_PINNED(
         sensor_task,
         "sensor_task",
         SENSOR_TASK_STACK_SIZE,
         NULL,
         SENSOR_TASK_PRIORITY,
-        &sensor_task_handle,
         SENSOR_TASK_CORE
     );
     
-    if (ret != pdPASS) {
+    if (sensor_task_handle == NULL) {
         ESP_LOGE(TAG, "Failed to create sensor task");
         return ESP_FAIL;
     }
     
-    // Register touch callback
-    touch_set_callback(touch_callback);
+#if GLOVE_HAS_TOUCH
+    // Touch interrupts only set the touch notification bit
+    touch_set_callback(touch_callback, NULL);
+#endif
+    
+    // Frames drop their ROI reference when their slot is freed
+    frame_pool_set_release_hook(release_frame_resources);
     
     // Initialize sensor data structure
     memset(&current_sensor_data, 0, sizeof(sensor_data_t));
+    current_sensor_data.camera_roi = CAMERA_ROI_INVALID;
     
     ESP_LOGI(TAG, "Sensor task initialized on core %d", SENSOR_TASK_CORE);
     return ESP_OK;
@@ -85,65 +99,96 @@ static void sensor_task(void *arg) {
                         SYSTEM_EVENT_INIT_COMPLETE, 
                         pdFALSE, pdTRUE, portMAX_DELAY);
     
-    // Initialize timestamps to current time
-    uint32_t current_time = esp_timer_get_time() / 1000;  // Convert to milliseconds
-    last_flex_sample_time = current_time;
-    last_imu_sample_time = current_time;
-    last_camera_sample_time = current_time;
-    last_touch_sample_time = current_time;
+    // Hand sampling periods to the timer-driven scheduler
+    esp_err_t ret = sample_scheduler_init(sensor_task_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize sample scheduler: %s", esp_err_to_name(ret));
+        vTaskDelete(NULL);
+        return;
+    }
+    
+    sample_scheduler_start(SAMPLE_SOURCE_FLEX, FLEX_SENSOR_SAMPLE_RATE_HZ);
+    
+    // The IMU paces itself through its FIFO data-ready interrupt when possible
+    bool imu_fifo = false;
+#if IMU_FIFO_MODE
+    imu_set_data_ready_callback(imu_data_ready_callback, NULL);
+    if (imu_enable_fifo(true, IMU_FIFO_BURST_SAMPLES) == ESP_OK) {
+        imu_fifo = true;
+    } else {
+        ESP_LOGW(TAG, "IMU FIFO unavailable, falling back to timed reads");
+        imu_set_data_ready_callback(NULL, NULL);
+    }
+#endif
+    if (!imu_fifo) {
+        sample_scheduler_start(SAMPLE_SOURCE_IMU, IMU_SAMPLE_RATE_HZ);
+    }
+    
+#if MOTION_GATE_ENABLED
+    // The motion interrupt flag rides along with IMU samples to the motion gate
+    imu_motion_detection_config_t motion_config = {
+        .threshold = MOTION_GATE_IMU_THRESHOLD,
+        .duration = MOTION_GATE_IMU_DURATION,
+        .x_axis_enable = true,
+        .y_axis_enable = true,
+        .z_axis_enable = true
+    };
+    if (imu_config_motion_detection(&motion_config) != ESP_OK ||
+        imu_enable_motion_detection(true) != ESP_OK) {
+        ESP_LOGW(TAG, "IMU motion detection unavailable, gating on rates only");
+    }
+#endif
+#if GLOVE_HAS_TOUCH
+    sample_scheduler_start(SAMPLE_SOURCE_TOUCH, TOUCH_SAMPLE_RATE_HZ);
+#endif
+    
+    // The camera task signals SAMPLE_SOURCE_CAMERA itself when an ROI is ready
     
     while (1) {
-        current_time = esp_timer_get_time() / 1000;  // Get current time in milliseconds
+        // Block until at least one sensor is due
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+        CYCLE_TRACE_BEGIN(CYCLE_TRACE_SENSOR_CYCLE);
+        
         bool data_updated = false;
         
-        // Check if it's time to sample flex sensors
-        if (current_time - last_flex_sample_time >= FLEX_SENSOR_SAMPLE_INTERVAL) {
+        // Flex sensors
+        if (events & SAMPLE_EVENT_BIT(SAMPLE_SOURCE_FLEX)) {
             if (sample_flex_sensors() == ESP_OK) {
-                last_flex_sample_time = current_time;
                 data_updated = true;
             }
         }
         
-        // Check if it's time to sample IMU
-        if (current_time - last_imu_sample_time >= IMU_SAMPLE_INTERVAL) {
+        // IMU
+        if (events & SAMPLE_EVENT_BIT(SAMPLE_SOURCE_IMU)) {
             if (sample_imu() == ESP_OK) {
-                last_imu_sample_time = current_time;
                 data_updated = true;
             }
         }
         
-        // Check if it's time to sample camera (if enabled)
-        if (g_system_config.camera_enabled && 
-            current_time - last_camera_sample_time >= CAMERA_SAMPLE_INTERVAL) {
+#if GLOVE_HAS_CAMERA
+        // Camera (if enabled)
+        if ((events & SAMPLE_EVENT_BIT(SAMPLE_SOURCE_CAMERA)) && g_system_config.camera_enabled) {
             if (sample_camera() == ESP_OK) {
-                last_camera_sample_time = current_time;
                 data_updated = true;
             }
         }
+#endif
         
-        // Check if it's time to sample touch sensors
-        if (g_system_config.touch_enabled && 
-            current_time - last_touch_sample_time >= TOUCH_SAMPLE_INTERVAL) {
+#if GLOVE_HAS_TOUCH
+        // Touch sensors (if enabled)
+        if ((events & SAMPLE_EVENT_BIT(SAMPLE_SOURCE_TOUCH)) && g_system_config.touch_enabled) {
             if (sample_touch_sensors() == ESP_OK) {
-                last_touch_sample_time = current_time;
                 data_updated = true;
             }
         }
+#endif
         
         // If any data was updated, send it to the processing task
         if (data_updated) {
-            // Update timestamp and sequence number
-            current_sensor_data.timestamp = current_time;
-            current_sensor_data.sequence_number = sequence_number++;
-            
-            // Send data to processing task
-            if (xQueueSend(g_sensor_data_queue, &current_sensor_data, 0) != pdTRUE) {
-                ESP_LOGW(TAG, "Failed to send sensor data to queue (queue full)");
-            }
+            publish_sensor_frame(esp_timer_get_time() / 1000);
         }
-        
-        // Short delay to prevent CPU hogging
-        vTaskDelay(pdMS_TO_TICKS(5));
+        CYCLE_TRACE_END(CYCLE_TRACE_SENSOR_CYCLE);
     }
 }
 
@@ -164,8 +209,8 @@ static esp_err_t sample_flex_sensors(void) {
         return ret;
     }
     
-    // Set timestamp
-    current_sensor_data.flex_data.timestamp = esp_timer_get_time() / 1000;
+    // Timestamp from the scheduler tick rather than when the task ran
+    current_sensor_data.flex_data.timestamp = sample_scheduler_get_tick_time(SAMPLE_SOURCE_FLEX) / 1000;
     current_sensor_data.flex_data_valid = true;
     
     return ESP_OK;
@@ -174,6 +219,32 @@ static esp_err_t sample_flex_sensors(void) {
 static esp_err_t sample_imu(void) {
     esp_err_t ret;
     
+    if (imu_is_fifo_enabled()) {
+        // Drain the whole burst in one transaction
+        imu_data_t samples[IMU_FIFO_MAX_BURST];
+        size_t count = 0;
+        ret = imu_read_fifo(samples, IMU_FIFO_MAX_BURST, &count);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to read IMU FIFO: %s", esp_err_to_name(ret));
+            return ret;
+        }
+        
+        if (count == 0) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        
+        // Every sample but the newest goes out as its own frame; the newest
+        // is published by the caller with the rest of this cycle's data
+        current_sensor_data.imu_data_valid = true;
+        for (size_t i = 0; i + 1 < count; i++) {
+            memcpy(&current_sensor_data.imu_data, &samples[i], sizeof(imu_data_t));
+            publish_sensor_frame(samples[i].timestamp);
+        }
+        memcpy(&current_sensor_data.imu_data, &samples[count - 1], sizeof(imu_data_t));
+        
+        return ESP_OK;
+    }
+    
     // Read IMU data
     imu_data_t imu_data;
     ret = imu_read(&imu_data);
@@ -189,28 +260,27 @@ static esp_err_t sample_imu(void) {
     return ESP_OK;
 }
 
+#if GLOVE_HAS_CAMERA
 static esp_err_t sample_camera(void) {
-    esp_err_t ret;
-    
-    // First release any previous frame
-    if (current_sensor_data.camera_data_valid && 
-        current_sensor_data.camera_data.frame_buffer != NULL) {
-        camera_release_frame();
-        current_sensor_data.camera_data.frame_buffer = NULL;
-        current_sensor_data.camera_data_valid = false;
-    }
-    
-    // Capture new frame
-    ret = camera_capture_frame(&current_sensor_data.camera_data);
+    // Pick up the ROI produced by the camera task; no frame buffer is held here
+    camera_roi_desc_t roi;
+    esp_err_t ret = camera_task_take_roi(&roi);
     if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to capture camera frame: %s", esp_err_to_name(ret));
         return ret;
     }
     
-    current_sensor_data.camera_data_valid = true;
+    // Drop our reference on the previous ROI
+    if (current_sensor_data.camera_roi != CAMERA_ROI_INVALID) {
+        camera_roi_release(current_sensor_data.camera_roi);
+    }
+    
+    // The descriptor stays in the pool; the frame only carries the slot
+    current_sensor_data.camera_roi = roi.roi_index;
     return ESP_OK;
 }
+#endif
 
+#if GLOVE_HAS_TOUCH
 static esp_err_t sample_touch_sensors(void) {
     esp_err_t ret;
     
@@ -221,28 +291,84 @@ static esp_err_t sample_touch_sensors(void) {
         return ret;
     }
     
-    // Set timestamp
-    current_sensor_data.touch_data.timestamp = esp_timer_get_time() / 1000;
+    // Merge touches latched by the ISR so a tap released before this read still shows
+    uint8_t touched_mask = 0;
+    if (touch_take_events(&touched_mask) == ESP_OK) {
+        for (int i = 0; i < TOUCH_SENSOR_COUNT; i++) {
+            if (touched_mask & (1 << i)) {
+                current_sensor_data.touch_data.touch_status[i] = true;
+            }
+        }
+    }
+    
+    // Timestamp from the scheduler tick rather than when the task ran
+    current_sensor_data.touch_data.timestamp = sample_scheduler_get_tick_time(SAMPLE_SOURCE_TOUCH) / 1000;
     current_sensor_data.touch_data_valid = true;
     
     return ESP_OK;
 }
+#endif
 
-// Callback for touch events
-static void touch_callback(bool *status) {
-    // Copy touch status to sensor data
-    memcpy(current_sensor_data.touch_data.touch_status, status, sizeof(bool) * TOUCH_SENSOR_COUNT);
-    
-    // Set timestamp
-    current_sensor_data.touch_data.timestamp = esp_timer_get_time() / 1000;
-    current_sensor_data.touch_data_valid = true;
+// Publish the latest sensor state as a pooled frame and queue its index
+static esp_err_t publish_sensor_frame(uint32_t timestamp) {
+    sensor_frame_index_t index;
+    if (frame_pool_acquire(&index) != ESP_OK) {
+        telemetry_count_drop(TELEMETRY_DROP_SENSOR_FRAME);
+        ESP_LOGW(TAG, "No free sensor frame, dropping sample");
+        return ESP_ERR_NO_MEM;
+    }
     
-    // Send data immediately since this is an event-driven update
-    current_sensor_data.timestamp = current_sensor_data.touch_data.timestamp;
+    // Update timestamp and sequence number
+    current_sensor_data.timestamp = timestamp;
     current_sensor_data.sequence_number = sequence_number++;
     
-    // Send data to processing task
-    if (xQueueSend(g_sensor_data_queue, &current_sensor_data, 0) != pdTRUE) {
-        ESP_LOGW(TAG, "Failed to send touch event data to queue (queue full)");
+    // Raw capture for offline replay; never blocks on flash
+    trace_recorder_record(&current_sensor_data);
+    sensor_stream_record(&current_sensor_data);
+    calibration_record(&current_sensor_data);
+    
+    // Single copy into the shared slot; the queue only carries the index
+    memcpy(frame_pool_get(index), &current_sensor_data, sizeof(sensor_data_t));
+    
+    // The frame keeps its own reference on the ROI it describes
+    if (current_sensor_data.camera_roi != CAMERA_ROI_INVALID) {
+        camera_roi_retain(current_sensor_data.camera_roi);
     }
-}
\ No newline at end of file
+    
+    // Ownership of the reference passes to the processing task
+    if (telemetry_queue_send(TELEMETRY_QUEUE_SENSOR_DATA, &index, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Failed to send sensor data to queue (queue full)");
+        frame_pool_release(index);
+        return ESP_FAIL;
+    }
+    
+    return ESP_OK;
+}
+
+#if GLOVE_HAS_TOUCH
+// Runs from the touch ISR after the driver latched the touched pads
+static void touch_callback(void *arg) {
+    BaseType_t higher_priority_woken = pdFALSE;
+    sample_scheduler_notify_from_isr(SAMPLE_SOURCE_TOUCH, &higher_priority_woken);
+    if (higher_priority_woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+#endif
+
+// Runs when a frame slot returns to the pool
+static void release_frame_resources(sensor_data_t *frame) {
+    if (frame->camera_roi != CAMERA_ROI_INVALID) {
+        camera_roi_release(frame->camera_roi);
+        frame->camera_roi = CAMERA_ROI_INVALID;
+    }
+}
+
+// Runs from the IMU INT pin ISR once per FIFO burst
+static void IRAM_ATTR imu_data_ready_callback(void *arg) {
+    BaseType_t higher_priority_woken = pdFALSE;
+    sample_scheduler_notify_from_isr(SAMPLE_SOURCE_IMU, &higher_priority_woken);
+    if (higher_priority_woken) {
+        portYIELD_FROM_ISR();
+    }
+}
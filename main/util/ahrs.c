@@ -0,0 +1,146 @@
+#include "util/ahrs.h"
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#define RAD_TO_DEG  (57.2957795131f)
+
+float ahrs_inv_sqrt(float x) {
+    // Bit-level initial guess refined by one Newton step, with constants
+    // tuned to minimise the relative error after that step
+    uint32_t i;
+    float y;
+    memcpy(&i, &x, sizeof(i));
+    i = 0x5F1FFFF9u - (i >> 1);
+    memcpy(&y, &i, sizeof(y));
+    return y * 0.703952253f * (2.38924456f - x * y * y);
+}
+
+// Quaternion that rotates the sensor's z axis onto a measured gravity direction
+static void seed_from_accel(ahrs_t *ahrs, float ax, float ay, float az) {
+    if (az < -0.999f) {
+        // Upside down: 180° about x
+        ahrs->q[0] = 0.0f;
+        ahrs->q[1] = 1.0f;
+        ahrs->q[2] = 0.0f;
+        ahrs->q[3] = 0.0f;
+        return;
+    }
+
+    // Zero-yaw solution of gravity(q) = a with q = (w, x, y, 0)
+    float w2 = 0.5f * (1.0f + az);
+    float inv_2w = 0.5f * ahrs_inv_sqrt(w2);
+    ahrs->q[0] = w2 * 2.0f * inv_2w;  // sqrt(w2)
+    ahrs->q[1] = ay * inv_2w;
+    ahrs->q[2] = -ax * inv_2w;
+    ahrs->q[3] = 0.0f;
+}
+
+esp_err_t ahrs_init(ahrs_t *ahrs, float beta) {
+    if (ahrs == NULL || beta < 0.0f) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ahrs->beta = beta;
+    ahrs_reset(ahrs);
+
+    return ESP_OK;
+}
+
+void ahrs_reset(ahrs_t *ahrs) {
+    if (ahrs == NULL) {
+        return;
+    }
+
+    ahrs->q[0] = 1.0f;
+    ahrs->q[1] = 0.0f;
+    ahrs->q[2] = 0.0f;
+    ahrs->q[3] = 0.0f;
+    ahrs->initialized = false;
+}
+
+void ahrs_update(ahrs_t *ahrs, const float gyro[3], const float accel[3], float dt) {
+    float q0 = ahrs->q[0], q1 = ahrs->q[1], q2 = ahrs->q[2], q3 = ahrs->q[3];
+    float gx = gyro[0], gy = gyro[1], gz = gyro[2];
+    float ax = accel[0], ay = accel[1], az = accel[2];
+
+    float a_norm_sq = ax * ax + ay * ay + az * az;
+    bool accel_valid = a_norm_sq > 0.0f;
+
+    if (accel_valid) {
+        float recip_norm = ahrs_inv_sqrt(a_norm_sq);
+        ax *= recip_norm;
+        ay *= recip_norm;
+        az *= recip_norm;
+    }
+
+    // Start from the measured tilt instead of converging from identity
+    if (!ahrs->initialized) {
+        if (accel_valid) {
+            seed_from_accel(ahrs, ax, ay, az);
+            ahrs->initialized = true;
+        }
+        return;
+    }
+
+    // Rate of change of the quaternion from the gyro: 0.5 * q ⊗ (0, ω)
+    float q_dot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float q_dot1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+    float q_dot2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+    float q_dot3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+    if (accel_valid) {
+        // Gradient of the error between predicted and measured gravity
+        float _2q0 = 2.0f * q0, _2q1 = 2.0f * q1, _2q2 = 2.0f * q2, _2q3 = 2.0f * q3;
+        float _4q0 = 4.0f * q0, _4q1 = 4.0f * q1, _4q2 = 4.0f * q2;
+        float _8q1 = 8.0f * q1, _8q2 = 8.0f * q2;
+        float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+
+        float s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+        float s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 +
+                   _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+        float s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 +
+                   _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+        float s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+
+        float s_norm_sq = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+        if (s_norm_sq > 0.0f) {
+            float recip_norm = ahrs->beta * ahrs_inv_sqrt(s_norm_sq);
+            q_dot0 -= recip_norm * s0;
+            q_dot1 -= recip_norm * s1;
+            q_dot2 -= recip_norm * s2;
+            q_dot3 -= recip_norm * s3;
+        }
+    }
+
+    q0 += q_dot0 * dt;
+    q1 += q_dot1 * dt;
+    q2 += q_dot2 * dt;
+    q3 += q_dot3 * dt;
+
+    float recip_norm = ahrs_inv_sqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    ahrs->q[0] = q0 * recip_norm;
+    ahrs->q[1] = q1 * recip_norm;
+    ahrs->q[2] = q2 * recip_norm;
+    ahrs->q[3] = q3 * recip_norm;
+}
+
+void ahrs_quaternion_gravity(const float q[4], float gravity[3]) {
+    // Third row of the rotation matrix: earth z expressed in the sensor frame
+    gravity[0] = 2.0f * (q[1] * q[3] - q[0] * q[2]);
+    gravity[1] = 2.0f * (q[0] * q[1] + q[2] * q[3]);
+    gravity[2] = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+}
+
+void ahrs_quaternion_to_euler(const float q[4], float euler[3]) {
+    // ZYX (yaw-pitch-roll) convention
+    float sin_pitch = 2.0f * (q[0] * q[2] - q[1] * q[3]);
+    if (sin_pitch > 1.0f) sin_pitch = 1.0f;
+    if (sin_pitch < -1.0f) sin_pitch = -1.0f;
+
+    euler[0] = atan2f(2.0f * (q[0] * q[1] + q[2] * q[3]),
+                      1.0f - 2.0f * (q[1] * q[1] + q[2] * q[2])) * RAD_TO_DEG;
+    euler[1] = asinf(sin_pitch) * RAD_TO_DEG;
+    euler[2] = atan2f(2.0f * (q[0] * q[3] + q[1] * q[2]),
+                      1.0f - 2.0f * (q[2] * q[2] + q[3] * q[3])) * RAD_TO_DEG;
+}
@@ -0,0 +1,75 @@
+#ifndef UTIL_AHRS_H
+#define UTIL_AHRS_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+/**
+ * @brief Quaternion attitude estimator (Madgwick gradient-descent filter)
+ *
+ * The state is a unit quaternion (w, x, y, z) rotating the sensor frame
+ * into the earth frame. Each update integrates the gyro and applies one
+ * gradient step towards the measured gravity direction, so the filter
+ * has no gimbal lock and needs no trig functions per sample. Euler angles
+ * are only computed when asked for.
+ *
+ * With accelerometer and gyro only (MPU6050), roll and pitch are
+ * drift-corrected; yaw has no absolute reference and follows the gyro.
+ */
+typedef struct {
+    float q[4];          // Orientation quaternion (w, x, y, z)
+    float beta;          // Gradient step gain; higher trusts the accelerometer more
+    bool initialized;    // Seeded from the first accelerometer sample
+} ahrs_t;
+
+/**
+ * @brief Initialize an AHRS instance
+ *
+ * @param ahrs Pointer to the AHRS state
+ * @param beta Filter gain (typically 0.03 - 0.3)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t ahrs_init(ahrs_t *ahrs, float beta);
+
+/**
+ * @brief Reset the orientation; the next update re-seeds it from gravity
+ *
+ * @param ahrs Pointer to the AHRS state
+ */
+void ahrs_reset(ahrs_t *ahrs);
+
+/**
+ * @brief Update the orientation with one accelerometer/gyro sample
+ *
+ * @param ahrs Pointer to the AHRS state
+ * @param gyro Angular rate in rad/s (x, y, z)
+ * @param accel Acceleration in any unit (x, y, z); only the direction is used
+ * @param dt Time since the previous sample in seconds
+ */
+void ahrs_update(ahrs_t *ahrs, const float gyro[3], const float accel[3], float dt);
+
+/**
+ * @brief Gravity direction in the sensor frame for a quaternion
+ *
+ * @param q Orientation quaternion (w, x, y, z)
+ * @param gravity Unit gravity vector in the sensor frame
+ */
+void ahrs_quaternion_gravity(const float q[4], float gravity[3]);
+
+/**
+ * @brief Convert a quaternion to Euler angles
+ *
+ * @param q Orientation quaternion (w, x, y, z)
+ * @param euler Roll, pitch, yaw in degrees
+ */
+void ahrs_quaternion_to_euler(const float q[4], float euler[3]);
+
+/**
+ * @brief Fast approximate 1/sqrt(x) (about 0.1% error)
+ *
+ * @param x Positive input
+ * @return Approximate inverse square root
+ */
+float ahrs_inv_sqrt(float x);
+
+#endif /* UTIL_AHRS_H */
@@ -1,21 +1,13 @@
 #include "util/buffer.h"
-#include <stdlib.h>
 #include <string.h>
-#include "esp_log.h"
+#include "util/frame_pool.h"
 
-static const char *TAG = "BUFFER";
-
-esp_err_t buffer_init(sensor_data_buffer_t* buffer, size_t capacity) {
-    if (buffer == NULL || capacity == 0) {
+esp_err_t buffer_init(sensor_data_buffer_t* buffer, sensor_frame_index_t* storage, size_t capacity) {
+    if (buffer == NULL || storage == NULL || capacity == 0) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    buffer->buffer = (sensor_data_t*)malloc(capacity * sizeof(sensor_data_t));
-    if (buffer->buffer == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate memory for buffer");
-        return ESP_ERR_NO_MEM;
-    }
-    
+    buffer->buffer = storage;
     buffer->capacity = capacity;
     buffer->size = 0;
     buffer->head = 0;
@@ -29,15 +21,13 @@ void buffer_free(sensor_data_buffer_t* buffer) {
         return;
     }
     
-    // Free camera frame buffers if they exist
-    for (size_t i = 0; i < buffer->capacity; i++) {
-        if (buffer->buffer[i].camera_data.frame_buffer != NULL) {
-            free(buffer->buffer[i].camera_data.frame_buffer);
-            buffer->buffer[i].camera_data.frame_buffer = NULL;
-        }
+    // Drop the references still held by the buffer
+    while (buffer->size > 0) {
+        frame_pool_release(buffer->buffer[buffer->tail]);
+        buffer->tail = (buffer->tail + 1) % buffer->capacity;
+        buffer->size--;
     }
     
-    free(buffer->buffer);
     buffer->buffer = NULL;
     buffer->capacity = 0;
     buffer->size = 0;
@@ -45,40 +35,23 @@ void buffer_free(sensor_data_buffer_t* buffer) {
     buffer->tail = 0;
 }
 
-esp_err_t buffer_push(sensor_data_buffer_t* buffer, const sensor_data_t* data) {
-    if (buffer == NULL || data == NULL || buffer->buffer == NULL) {
+esp_err_t buffer_push(sensor_data_buffer_t* buffer, sensor_frame_index_t index) {
+    if (buffer == NULL || buffer->buffer == NULL || frame_pool_get(index) == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
     
     if (buffer_is_full(buffer)) {
-        // Buffer is full, overwrite oldest data
-        // First free any camera frame buffer in the oldest slot to prevent memory leak
-        if (buffer->buffer[buffer->tail].camera_data_valid && 
-            buffer->buffer[buffer->tail].camera_data.frame_buffer != NULL) {
-            free(buffer->buffer[buffer->tail].camera_data.frame_buffer);
-            buffer->buffer[buffer->tail].camera_data.frame_buffer = NULL;
-        }
+        // Buffer is full, drop the reference to the oldest frame
+        frame_pool_release(buffer->buffer[buffer->tail]);
         
         // Move tail forward
         buffer->tail = (buffer->tail + 1) % buffer->capacity;
-        buffer->size--; // Reduce size as we're about to overwrite
+        buffer->size--;
     }
     
-    // Copy data to the head position
-    memcpy(&buffer->buffer[buffer->head], data, sizeof(sensor_data_t));
-    
-    // Special handling for camera frame buffer - need a deep copy
-    if (data->camera_data_valid && data->camera_data.frame_buffer != NULL && data->camera_data.buffer_size > 0) {
-        buffer->buffer[buffer->head].camera_data.frame_buffer = (uint8_t*)malloc(data->camera_data.buffer_size);
-        if (buffer->buffer[buffer->head].camera_data.frame_buffer == NULL) {
-            ESP_LOGE(TAG, "Failed to allocate memory for camera frame");
-            buffer->buffer[buffer->head].camera_data_valid = false;
-        } else {
-            memcpy(buffer->buffer[buffer->head].camera_data.frame_buffer, 
-                   data->camera_data.frame_buffer, 
-                   data->camera_data.buffer_size);
-        }
-    }
+    // Store a reference at the head position
+    frame_pool_retain(index);
+    buffer->buffer[buffer->head] = index;
     
     // Move head forward
     buffer->head = (buffer->head + 1) % buffer->capacity;
@@ -87,8 +60,8 @@ esp_err_t buffer_push(sensor_data_buffer_t* buffer, const sensor_data_t* data) {
     return ESP_OK;
 }
 
-esp_err_t buffer_pop(sensor_data_buffer_t* buffer, sensor_data_t* data) {
-    if (buffer == NULL || data == NULL || buffer->buffer == NULL) {
+esp_err_t buffer_pop(sensor_data_buffer_t* buffer, sensor_frame_index_t* index) {
+    if (buffer == NULL || index == NULL || buffer->buffer == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
     
@@ -96,14 +69,8 @@ esp_err_t buffer_pop(sensor_data_buffer_t* buffer, sensor_data_t* data) {
         return ESP_ERR_NOT_FOUND;
     }
     
-    // Copy data from tail position
-    memcpy(data, &buffer->buffer[buffer->tail], sizeof(sensor_data_t));
-    
-    // Special handling for camera frame buffer - transfer ownership
-    if (buffer->buffer[buffer->tail].camera_data_valid) {
-        data->camera_data.frame_buffer = buffer->buffer[buffer->tail].camera_data.frame_buffer;
-        buffer->buffer[buffer->tail].camera_data.frame_buffer = NULL;
-    }
+    // Hand the reference at the tail position to the caller
+    *index = buffer->buffer[buffer->tail];
     
     // Move tail forward
     buffer->tail = (buffer->tail + 1) % buffer->capacity;
@@ -112,6 +79,15 @@ esp_err_t buffer_pop(sensor_data_buffer_t* buffer, sensor_data_t* data) {
     return ESP_OK;
 }
 
+const sensor_data_t* buffer_get(const sensor_data_buffer_t* buffer, size_t age) {
+    if (buffer == NULL || buffer->buffer == NULL || age >= buffer->size) {
+        return NULL;
+    }
+    
+    size_t position = (buffer->head + buffer->capacity - 1 - age) % buffer->capacity;
+    return frame_pool_get(buffer->buffer[position]);
+}
+
 bool buffer_is_empty(const sensor_data_buffer_t* buffer) {
     if (buffer == NULL) {
         return true;
@@ -3,6 +3,9 @@
 
 #include <stdint.h>
 #include "esp_err.h"
+#include "config/system_config.h"
+#include "drivers/imu.h"
+#include "processing/camera_roi.h"
 
 /**
  * @brief Structure to hold flex sensor data
@@ -13,27 +16,6 @@ typedef struct {
     uint32_t timestamp;       // Acquisition timestamp
 } flex_sensor_data_t;
 
-/**
- * @brief Structure to hold IMU data
- */
-typedef struct {
-    float accel[3];          // X, Y, Z acceleration
-    float gyro[3];           // X, Y, Z rotation rates
-    float orientation[3];    // Roll, pitch, yaw
-    uint32_t timestamp;      // Acquisition timestamp
-} imu_data_t;
-
-/**
- * @brief Structure to hold camera frame data
- */
-typedef struct {
-    uint8_t* frame_buffer;   // Pointer to image data
-    uint32_t buffer_size;    // Size of the buffer
-    uint16_t width;          // Image width
-    uint16_t height;         // Image height
-    uint32_t timestamp;      // Acquisition timestamp
-} camera_frame_t;
-
 /**
  * @brief Structure to hold touch sensor data
  */
@@ -44,20 +26,32 @@ typedef struct {
 
 /**
  * @brief Structure to hold all sensor data
+ *
+ * Sensor readings only. The camera contributes a one-byte handle; its
+ * descriptor and pixels stay in the ROI pool (see camera_roi_get_desc).
+ * A raw frame from the sensor task holds a reference on its ROI slot and
+ * releases it when done. An aligned frame from sensor_fusion takes none:
+ * it borrows the fusion's own reference, which lasts until a newer ROI is
+ * ingested, so it must not be released or kept past the next
+ * sensor_fusion_ingest().
  */
 typedef struct sensor_data_s {
     flex_sensor_data_t flex_data;
     imu_data_t imu_data;
-    camera_frame_t camera_data;
     touch_sensor_data_t touch_data;
+    camera_roi_index_t camera_roi;  // ROI slot, CAMERA_ROI_INVALID if none; see below
     bool flex_data_valid;
     bool imu_data_valid;
-    bool camera_data_valid;
     bool touch_data_valid;
     uint32_t sequence_number;  // For tracking data packets
     uint32_t timestamp;        // Global timestamp for this dataset
 } sensor_data_t;
 
+/**
+ * @brief Index of a sensor frame slot in the frame pool (see util/frame_pool.h)
+ */
+typedef uint8_t sensor_frame_index_t;
+
 /**
  * @brief Structure to hold feature vector
  */
@@ -65,6 +59,7 @@ typedef struct {
     float features[FEATURE_BUFFER_SIZE];
     uint16_t feature_count;
     uint32_t timestamp;
+    bool two_hand;            // Second glove's features are in the vector
 } feature_vector_t;
 
 /**
@@ -76,6 +71,8 @@ typedef struct processing_result_s {
     float confidence;         // Recognition confidence (0-1)
     bool is_dynamic;          // Static vs dynamic gesture
     uint32_t duration_ms;     // Gesture duration
+    uint32_t sample_sequence; // Sequence number of the sensor frame the gesture was decided on
+    uint32_t sample_timestamp; // Sample time of the end of the gesture
     uint32_t timestamp;       // Processing timestamp
 } processing_result_t;
 
@@ -98,6 +95,7 @@ typedef enum {
  */
 typedef struct output_command_s {
     output_command_type_t type;
+    uint32_t origin_timestamp;  // Sample time of the gesture behind this output, 0 if none
     union {
         struct {
             char text[64];
@@ -144,7 +142,8 @@ typedef enum {
     SYS_CMD_DISABLE_BLE,
     SYS_CMD_RESTART,
     SYS_CMD_SLEEP,
-    SYS_CMD_FACTORY_RESET
+    SYS_CMD_FACTORY_RESET,
+    SYS_CMD_COUNT                   // Number of command types
 } system_command_type_t;
 
 /**
@@ -168,10 +167,13 @@ typedef struct system_command_s {
 } system_command_t;
 
 /**
- * @brief Circular buffer for sensor data storage
+ * @brief Circular buffer of sensor frame references
+ *
+ * Holds one frame pool reference per entry; the oldest reference is
+ * released when a push overwrites it.
  */
 typedef struct {
-    sensor_data_t* buffer;
+    sensor_frame_index_t* buffer;
     size_t capacity;
     size_t size;
     size_t head;
@@ -181,36 +183,56 @@ typedef struct {
 /**
  * @brief Initialize a circular buffer
  * 
+ * The buffer does not allocate: the caller provides the entry storage,
+ * typically a static array placed with config/memory_layout.h.
+ * 
  * @param buffer Pointer to the buffer structure
+ * @param storage Storage for capacity entries, owned by the caller
  * @param capacity Capacity of the buffer
  * @return ESP_OK on success, error code otherwise
  */
-esp_err_t buffer_init(sensor_data_buffer_t* buffer, size_t capacity);
+esp_err_t buffer_init(sensor_data_buffer_t* buffer, sensor_frame_index_t* storage, size_t capacity);
 
 /**
  * @brief Free a circular buffer
  * 
+ * Releases every frame reference still held by the buffer. The storage
+ * stays with the caller.
+ * 
  * @param buffer Pointer to the buffer structure
  */
 void buffer_free(sensor_data_buffer_t* buffer);
 
 /**
- * @brief Push sensor data to the buffer
+ * @brief Push a sensor frame to the buffer
+ * 
+ * The buffer takes its own reference to the frame.
  * 
  * @param buffer Pointer to the buffer structure
- * @param data Pointer to the sensor data to push
+ * @param index Frame pool slot to push
  * @return ESP_OK on success, error code otherwise
  */
-esp_err_t buffer_push(sensor_data_buffer_t* buffer, const sensor_data_t* data);
+esp_err_t buffer_push(sensor_data_buffer_t* buffer, sensor_frame_index_t index);
 
 /**
- * @brief Pop sensor data from the buffer
+ * @brief Pop the oldest sensor frame from the buffer
+ * 
+ * The buffer's reference is handed to the caller, who must release it.
  * 
  * @param buffer Pointer to the buffer structure
- * @param data Pointer to store the popped data
+ * @param index Pointer to store the popped frame slot
  * @return ESP_OK on success, error code otherwise
  */
-esp_err_t buffer_pop(sensor_data_buffer_t* buffer, sensor_data_t* data);
+esp_err_t buffer_pop(sensor_data_buffer_t* buffer, sensor_frame_index_t* index);
+
+/**
+ * @brief Get a frame from the buffer without copying it
+ * 
+ * @param buffer Pointer to the buffer structure
+ * @param age Number of pushes ago (0 = most recent)
+ * @return Pointer to the frame, or NULL if not available
+ */
+const sensor_data_t* buffer_get(const sensor_data_buffer_t* buffer, size_t age);
 
 /**
  * @brief Check if buffer is empty
@@ -0,0 +1,160 @@
+#include "util/cycle_trace.h"
+#include <stdio.h>
+#include <stdatomic.h>
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_ipc.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define CYCLE_TRACE_MASK        (CYCLE_TRACE_DEPTH - 1)
+#define CYCLE_TRACE_MAX_TASKS   (24)
+
+typedef struct {
+    uint32_t cycles;             // CPU cycle counter of the recording core
+    TaskHandle_t task;           // Running (or interrupted) task
+    uint8_t event;               // cycle_trace_event_t
+    uint8_t phase;               // cycle_trace_phase_t
+} trace_entry_t;
+
+/**
+ * Writers reserve a slot with one atomic add on the ring head, so a task
+ * preempted by another trace point on the same core just ends up with
+ * the earlier slot.
+ */
+typedef struct {
+    trace_entry_t entries[CYCLE_TRACE_DEPTH];
+    atomic_uint head;            // Events recorded since the last dump
+} trace_ring_t;
+
+// Cycle counter of a core sampled against esp_timer
+typedef struct {
+    uint32_t cycles;
+    int64_t time_us;
+} clock_anchor_t;
+
+static const char *event_names[CYCLE_TRACE_EVENT_COUNT] = {
+    "sensor_cycle",
+    "fusion",
+    "features",
+    "classify",
+    "output_command",
+    "output_result",
+    "display_update",
+    "audio_play",
+    "ble_send"
+};
+
+static trace_ring_t rings[portNUM_PROCESSORS];
+static atomic_bool tracing_paused = false;
+
+void IRAM_ATTR cycle_trace_record(cycle_trace_event_t event, cycle_trace_phase_t phase) {
+    uint32_t cycles = esp_cpu_get_cycle_count();
+    if (atomic_load_explicit(&tracing_paused, memory_order_relaxed)) {
+        return;
+    }
+
+    trace_ring_t *ring = &rings[esp_cpu_get_core_id()];
+    unsigned slot = atomic_fetch_add_explicit(&ring->head, 1, memory_order_relaxed) & CYCLE_TRACE_MASK;
+
+    trace_entry_t *entry = &ring->entries[slot];
+    entry->cycles = cycles;
+    entry->task = xTaskGetCurrentTaskHandle();
+    entry->event = (uint8_t)event;
+    entry->phase = (uint8_t)phase;
+}
+
+// Runs on the core being sampled
+static void sample_anchor(void *arg) {
+    clock_anchor_t *anchor = (clock_anchor_t *)arg;
+    anchor->cycles = esp_cpu_get_cycle_count();
+    anchor->time_us = esp_timer_get_time();
+}
+
+void cycle_trace_uart_sink(const char *line, void *ctx) {
+    printf("%s\n", line);
+}
+
+esp_err_t cycle_trace_dump(cycle_trace_sink_t sink, void *ctx) {
+    if (sink == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+#if !CYCLE_TRACE_ENABLED
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    // Let trace points already past the pause check finish their slot
+    atomic_store(&tracing_paused, true);
+    vTaskDelay(1);
+
+    clock_anchor_t anchors[portNUM_PROCESSORS];
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        esp_ipc_call_blocking(core, sample_anchor, &anchors[core]);
+    }
+    float cycles_per_us = (float)esp_rom_get_cpu_ticks_per_us();
+
+    TaskHandle_t tasks[CYCLE_TRACE_MAX_TASKS];
+    int task_cores[CYCLE_TRACE_MAX_TASKS];
+    int task_count = 0;
+    char line[160];
+    const char *separator = "";
+
+    sink("[", ctx);
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        trace_ring_t *ring = &rings[core];
+        unsigned head = atomic_load(&ring->head);
+        unsigned count = (head < CYCLE_TRACE_DEPTH) ? head : CYCLE_TRACE_DEPTH;
+
+        for (unsigned i = head - count; i != head; i++) {
+            const trace_entry_t *entry = &ring->entries[i & CYCLE_TRACE_MASK];
+            if (entry->event >= CYCLE_TRACE_EVENT_COUNT) {
+                continue;
+            }
+
+            // Cycles before the anchor, so counter wrap drops out
+            uint32_t age = anchors[core].cycles - entry->cycles;
+            double ts = anchors[core].time_us - age / cycles_per_us;
+
+            snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%lu%s}",
+                     separator, event_names[entry->event], entry->phase, ts, core,
+                     (unsigned long)(uintptr_t)entry->task,
+                     entry->phase == CYCLE_TRACE_PHASE_INSTANT ? ",\"s\":\"t\"" : "");
+            sink(line, ctx);
+            separator = ",";
+
+            // Remember each task once, to name its track
+            int t = 0;
+            while (t < task_count && (tasks[t] != entry->task || task_cores[t] != core)) {
+                t++;
+            }
+            if (t == task_count && task_count < CYCLE_TRACE_MAX_TASKS) {
+                tasks[task_count] = entry->task;
+                task_cores[task_count++] = core;
+            }
+        }
+
+        atomic_store(&ring->head, 0);
+    }
+
+    // Track names; the traced tasks are never deleted, so their handles are still valid
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        snprintf(line, sizeof(line), "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"core %d\"}}",
+                 separator, core, core);
+        sink(line, ctx);
+        separator = ",";
+    }
+    for (int t = 0; t < task_count; t++) {
+        const char *name = (tasks[t] != NULL) ? pcTaskGetName(tasks[t]) : "isr";
+        snprintf(line, sizeof(line), ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+                 task_cores[t], (unsigned long)(uintptr_t)tasks[t], name);
+        sink(line, ctx);
+    }
+    sink("]", ctx);
+
+    atomic_store(&tracing_paused, false);
+    return ESP_OK;
+#endif
+}
@@ -0,0 +1,96 @@
+#ifndef UTIL_CYCLE_TRACE_H
+#define UTIL_CYCLE_TRACE_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "config/system_config.h"
+
+/**
+ * @brief Cycle-accurate trace points
+ *
+ * Each trace point stores the CPU cycle counter, the event, the core and
+ * the running task into a lock-free ring owned by the current core, so
+ * tasks and interrupts on either core can record without a lock. The
+ * newest CYCLE_TRACE_DEPTH events per core are kept.
+ *
+ * With CYCLE_TRACE_ENABLED set to 0 the macros compile to nothing.
+ */
+
+/**
+ * @brief Traced events
+ */
+typedef enum {
+    CYCLE_TRACE_SENSOR_CYCLE = 0,   // sensor_task: one wake-up, sampling to publish
+    CYCLE_TRACE_FUSION,             // processing_task: ingest and alignment
+    CYCLE_TRACE_FEATURES,           // feature stage: history, gate and features
+    CYCLE_TRACE_CLASSIFY,           // classify stage: matching and decoding
+    CYCLE_TRACE_OUTPUT_COMMAND,     // output_task: one output command
+    CYCLE_TRACE_OUTPUT_RESULT,      // output_task: one recognition result
+    CYCLE_TRACE_DISPLAY_UPDATE,     // display flush over I2C
+    CYCLE_TRACE_AUDIO_PLAY,         // audio task: one tone or utterance
+    CYCLE_TRACE_BLE_SEND,           // ble_service_send_*()
+    CYCLE_TRACE_EVENT_COUNT
+} cycle_trace_event_t;
+
+/**
+ * @brief Trace event phases, as in the Chrome trace format
+ */
+typedef enum {
+    CYCLE_TRACE_PHASE_BEGIN = 'B',
+    CYCLE_TRACE_PHASE_END = 'E',
+    CYCLE_TRACE_PHASE_INSTANT = 'i'
+} cycle_trace_phase_t;
+
+/**
+ * @brief Receives the dump one line at a time
+ *
+ * @param line Terminated line, without a newline
+ * @param ctx Context passed to cycle_trace_dump()
+ */
+typedef void (*cycle_trace_sink_t)(const char *line, void *ctx);
+
+#if CYCLE_TRACE_ENABLED
+#define CYCLE_TRACE_BEGIN(event)    cycle_trace_record((event), CYCLE_TRACE_PHASE_BEGIN)
+#define CYCLE_TRACE_END(event)      cycle_trace_record((event), CYCLE_TRACE_PHASE_END)
+#define CYCLE_TRACE_INSTANT(event)  cycle_trace_record((event), CYCLE_TRACE_PHASE_INSTANT)
+#else
+#define CYCLE_TRACE_BEGIN(event)    do { } while (0)
+#define CYCLE_TRACE_END(event)      do { } while (0)
+#define CYCLE_TRACE_INSTANT(event)  do { } while (0)
+#endif
+
+/**
+ * @brief Record a trace point (use the CYCLE_TRACE_* macros)
+ *
+ * Safe from tasks and interrupts on either core.
+ *
+ * @param event Event
+ * @param phase Phase
+ */
+void cycle_trace_record(cycle_trace_event_t event, cycle_trace_phase_t phase);
+
+/**
+ * @brief Write out and clear the recorded events
+ *
+ * Recording pauses while dumping. The output is a Chrome trace JSON
+ * array, one event per line: the concatenated lines open directly in
+ * chrome://tracing or Perfetto. Cycle counts are converted to
+ * microseconds on a timeline shared by both cores, with one sample of
+ * each core's counter against esp_timer taken at dump time, so events
+ * older than 2^32 cycles (about 17 s at 240 MHz) are misplaced.
+ *
+ * @param sink Line consumer
+ * @param ctx Context for the sink
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if tracing is compiled out
+ */
+esp_err_t cycle_trace_dump(cycle_trace_sink_t sink, void *ctx);
+
+/**
+ * @brief Sink printing each line to the console UART
+ *
+ * @param line Line to print
+ * @param ctx Unused
+ */
+void cycle_trace_uart_sink(const char *line, void *ctx);
+
+#endif /* UTIL_CYCLE_TRACE_H */
@@ -2,66 +2,128 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stdatomic.h>
 #include "esp_system.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "esp_cpu.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "driver/uart.h"
 #include "drivers/display.h"
 #include "communication/ble_service.h"
+#include "config/system_config.h"
+#include "config/memory_layout.h"
+#include "util/spsc_ring.h"
+#include "util/log_format.h"
 
 static const char *TAG = "DEBUG";
 
+#define MESSAGE_SIZE        256
+
+/**
+ * One deferred debug_log() call: the format and tag pointers plus the
+ * arguments as va_arg returned them, back to back in format order.
+ */
+typedef struct {
+    const char *tag;
+    const char *format;
+    uint32_t timestamp_us;       // Low bits of esp_timer, orders records across cores
+    uint8_t level;               // debug_level_t
+    uint8_t modes;               // DEBUG_MODE_* outputs for this record
+    uint8_t arg_len;             // Bytes of args in use
+    uint8_t truncated;           // Arguments after arg_len did not fit
+    uint8_t args[DEBUG_LOG_ARG_BYTES];
+} log_record_t;
+
 static debug_level_t current_debug_level = DEBUG_LEVEL_INFO;
 static uint8_t current_debug_mode = DEBUG_MODE_UART;
 
 // Debug display buffer (for OLED display)
 static char debug_display_buffer[128] = {0};
 
-esp_err_t debug_init(debug_level_t level, uint8_t mode) {
-    current_debug_level = level;
-    current_debug_mode = mode;
-    
-    ESP_LOGI(TAG, "Debug subsystem initialized with level %d and mode %d", level, mode);
-    return ESP_OK;
-}
+// One ring per core. Producers on a core are serialized by masking that
+// core's interrupts, so each ring has a single writer at a time and the
+// log task is its only reader.
+static log_record_t ring_storage[portNUM_PROCESSORS][DEBUG_LOG_RING_RECORDS];
+static spsc_ring_t rings[portNUM_PROCESSORS];
+static TaskHandle_t log_task_handle = NULL;
+STATIC_TASK_STORAGE(log_task, DEBUG_LOG_STACK_SIZE);
 
-void debug_set_level(debug_level_t level) {
-    current_debug_level = level;
-}
+static atomic_uint_least32_t records_logged;
+static atomic_uint_least32_t records_truncated;
 
-void debug_set_mode(uint8_t mode) {
-    current_debug_mode = mode;
-}
+static void log_record_v(debug_level_t level, const char* tag, uint8_t modes, const char* format, va_list args) {
+    if (log_task_handle == NULL || format == NULL || modes == 0) {
+        return;
+    }
 
-void debug_log(debug_level_t level, const char* tag, const char* format, ...) {
-    if (level > current_debug_level) {
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    bool truncated = false;
+    uint32_t queued = 0;
+
+    // Nothing else runs on this core until the record is published, and
+    // the other core writes its own ring
+    UBaseType_t state = portSET_INTERRUPT_MASK_FROM_ISR();
+    spsc_ring_t *ring = &rings[esp_cpu_get_core_id()];
+    log_record_t *record = (log_record_t *)spsc_ring_acquire_write(ring);
+    if (record != NULL) {
+        record->tag = tag;
+        record->format = format;
+        record->timestamp_us = now;
+        record->level = (uint8_t)level;
+        record->modes = modes;
+        record->arg_len = (uint8_t)log_format_capture(record->args, sizeof(record->args), format, args, &truncated);
+        record->truncated = truncated;
+        spsc_ring_commit_write(ring);
+        queued = spsc_ring_get_count(ring);
+    }
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(state);
+
+    if (record == NULL) {
         return;
     }
-    
+    atomic_fetch_add_explicit(&records_logged, 1, memory_order_relaxed);
+    if (truncated) {
+        atomic_fetch_add_explicit(&records_truncated, 1, memory_order_relaxed);
+    }
+
+    // The log task polls every DEBUG_LOG_FLUSH_MS; only a filling ring wakes it early
+    if (queued == DEBUG_LOG_RING_RECORDS / 2) {
+        if (xPortInIsrContext()) {
+            vTaskNotifyGiveFromISR(log_task_handle, NULL);
+        } else {
+            xTaskNotifyGive(log_task_handle);
+        }
+    }
+}
+
+static void log_record(debug_level_t level, const char* tag, uint8_t modes, const char* format, ...) {
     va_list args;
     va_start(args, format);
-    
-    // Format message
-    char buffer[256];
-    vsnprintf(buffer, sizeof(buffer), format, args);
-    
+    log_record_v(level, tag, modes, format, args);
+    va_end(args);
+}
+
+// Send a formatted message to the outputs its record asked for
+static void emit_message(debug_level_t level, const char* tag, uint8_t modes, const char* message) {
     // Output to UART using ESP logging
-    if (current_debug_mode & DEBUG_MODE_UART) {
+    if (modes & DEBUG_MODE_UART) {
         switch (level) {
             case DEBUG_LEVEL_ERROR:
-                ESP_LOGE(tag, "%s", buffer);
+                ESP_LOGE(tag, "%s", message);
                 break;
             case DEBUG_LEVEL_WARNING:
-                ESP_LOGW(tag, "%s", buffer);
+                ESP_LOGW(tag, "%s", message);
                 break;
             case DEBUG_LEVEL_INFO:
-                ESP_LOGI(tag, "%s", buffer);
+                ESP_LOGI(tag, "%s", message);
                 break;
             case DEBUG_LEVEL_DEBUG:
-                ESP_LOGD(tag, "%s", buffer);
+                ESP_LOGD(tag, "%s", message);
                 break;
             case DEBUG_LEVEL_VERBOSE:
-                ESP_LOGV(tag, "%s", buffer);
+                ESP_LOGV(tag, "%s", message);
                 break;
             default:
                 break;
@@ -69,9 +131,9 @@ void debug_log(debug_level_t level, const char* tag, const char* format, ...) {
     }
     
     // Output to display
-    if (current_debug_mode & DEBUG_MODE_DISPLAY) {
+    if (modes & DEBUG_MODE_DISPLAY) {
         // Keep only the latest message for display
-        snprintf(debug_display_buffer, sizeof(debug_display_buffer), "[%s] %s", tag, buffer);
+        snprintf(debug_display_buffer, sizeof(debug_display_buffer), "[%s] %s", tag, message);
         
         // Only display error and warning messages to avoid cluttering the display
         if (level <= DEBUG_LEVEL_WARNING) {
@@ -80,7 +142,7 @@ void debug_log(debug_level_t level, const char* tag, const char* format, ...) {
     }
     
     // Output over BLE
-    if (current_debug_mode & DEBUG_MODE_BLUETOOTH) {
+    if (modes & DEBUG_MODE_BLUETOOTH) {
         // Format with level and tag
         char ble_buffer[128];
         char level_char = 'I';
@@ -93,13 +155,118 @@ void debug_log(debug_level_t level, const char* tag, const char* format, ...) {
             default: break;
         }
         
-        snprintf(ble_buffer, sizeof(ble_buffer), "[%c][%s] %s", level_char, tag, buffer);
+        snprintf(ble_buffer, sizeof(ble_buffer), "[%c][%s] %s", level_char, tag, message);
         ble_service_send_debug(ble_buffer);
     }
+}
+
+// Oldest record across the cores' rings, NULL when all are empty
+static log_record_t* oldest_record(int *core) {
+    log_record_t *oldest = NULL;
+
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        log_record_t *record = (log_record_t *)spsc_ring_peek_read(&rings[i]);
+        if (record != NULL &&
+            (oldest == NULL || (int32_t)(record->timestamp_us - oldest->timestamp_us) < 0)) {
+            oldest = record;
+            *core = i;
+        }
+    }
+    return oldest;
+}
+
+static uint32_t records_dropped(void) {
+    uint32_t dropped = 0;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        dropped += spsc_ring_get_dropped(&rings[i]);
+    }
+    return dropped;
+}
+
+static void log_task(void *arg) {
+    static char message[MESSAGE_SIZE];
+    uint32_t reported_drops = 0;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DEBUG_LOG_FLUSH_MS));
+
+        log_record_t *record;
+        int core = 0;
+        while ((record = oldest_record(&core)) != NULL) {
+            debug_level_t level = (debug_level_t)record->level;
+            const char *tag = record->tag;
+            uint8_t modes = record->modes;
+            log_format_message(record->format, record->args, record->arg_len, record->truncated,
+                               message, sizeof(message));
+
+            // Hand the slot back before the slow outputs
+            spsc_ring_release_read(&rings[core]);
+            emit_message(level, tag, modes, message);
+        }
+
+        uint32_t dropped = records_dropped();
+        if (dropped != reported_drops) {
+            ESP_LOGW(TAG, "%lu debug records dropped, ring full", (unsigned long)(dropped - reported_drops));
+            reported_drops = dropped;
+        }
+    }
+}
+
+esp_err_t debug_init(debug_level_t level, uint8_t mode) {
+    current_debug_level = level;
+    current_debug_mode = mode;
+
+    if (log_task_handle == NULL) {
+        for (int i = 0; i < portNUM_PROCESSORS; i++) {
+            esp_err_t ret = spsc_ring_init(&rings[i], ring_storage[i], sizeof(log_record_t),
+                                           DEBUG_LOG_RING_RECORDS);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+        }
+
+        log_task_handle = STATIC_TASK_CREATE_PINNED(log_task, "debug_log", DEBUG_LOG_STACK_SIZE,
+                                                    NULL, DEBUG_LOG_PRIORITY, DEBUG_LOG_CORE);
+        if (log_task_handle == NULL) {
+            ESP_LOGE(TAG, "Failed to create debug log task");
+            return ESP_FAIL;
+        }
+    }
     
+    ESP_LOGI(TAG, "Debug subsystem initialized with level %d and mode %d", level, mode);
+    return ESP_OK;
+}
+
+void debug_set_level(debug_level_t level) {
+    current_debug_level = level;
+}
+
+void debug_set_mode(uint8_t mode) {
+    current_debug_mode = mode;
+}
+
+void debug_log(debug_level_t level, const char* tag, const char* format, ...) {
+    if (level > current_debug_level || level == DEBUG_LEVEL_NONE) {
+        return;
+    }
+    
+    va_list args;
+    va_start(args, format);
+    log_record_v(level, tag, current_debug_mode, format, args);
     va_end(args);
 }
 
+esp_err_t debug_get_stats(debug_stats_t *stats) {
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    stats->records_logged = atomic_load(&records_logged);
+    stats->records_dropped = records_dropped();
+    stats->records_truncated = atomic_load(&records_truncated);
+    return ESP_OK;
+}
+
 void debug_buffer(debug_level_t level, const char* tag, const char* prefix, const void* buffer, size_t length) {
     if (level > current_debug_level || !buffer) {
         return;
@@ -145,12 +312,9 @@ esp_err_t debug_assert(bool condition, const char* tag, const char* message, int
         
         ESP_LOGE(tag, "Assertion failed: %s (%s:%d)", message, filename, line);
         
-        // Also output to display if enabled
-        if (current_debug_mode & DEBUG_MODE_DISPLAY) {
-            char assert_msg[64];
-            snprintf(assert_msg, sizeof(assert_msg), "ASSERT: %s (%s:%d)", message, filename, line);
-            display_show_debug(assert_msg);
-        }
+        // Also output to display if enabled, from the log task
+        log_record(DEBUG_LEVEL_ERROR, tag, current_debug_mode & DEBUG_MODE_DISPLAY,
+                   "ASSERT: %s (%s:%d)", message, filename, line);
         
         return ESP_FAIL;
     }
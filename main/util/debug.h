@@ -2,6 +2,8 @@
 #define UTIL_DEBUG_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h"
 #include "esp_log.h"
 
@@ -28,7 +30,16 @@ typedef enum {
 } debug_mode_t;
 
 /**
- * @brief Initialize debug subsystem
+ * @brief Deferred log counters since boot
+ */
+typedef struct {
+    uint32_t records_logged;     // Records queued by debug_log()
+    uint32_t records_dropped;    // Records refused because their core's ring was full
+    uint32_t records_truncated;  // Records whose arguments did not fit DEBUG_LOG_ARG_BYTES
+} debug_stats_t;
+
+/**
+ * @brief Initialize debug subsystem and start its log task
  * 
  * @param level Debug level
  * @param mode Debug mode flags (can be combined)
@@ -53,6 +64,15 @@ void debug_set_mode(uint8_t mode);
 /**
  * @brief Log a debug message
  * 
+ * Only the format pointer and the raw arguments are queued, in a ring
+ * per core; a low-priority task formats the record later and sends it to
+ * UART, display and BLE. Safe from any task or ISR, never blocks, and
+ * drops the record when the ring is full or before debug_init().
+ * 
+ * tag and format are kept as pointers, so they must be string literals or
+ * otherwise live forever. %s arguments are copied. Arguments beyond
+ * DEBUG_LOG_ARG_BYTES are left out of the message, and %n is not supported.
+ * 
  * @param level Message level
  * @param tag Module tag
  * @param format Message format (printf style)
@@ -60,9 +80,20 @@ void debug_set_mode(uint8_t mode);
  */
 void debug_log(debug_level_t level, const char* tag, const char* format, ...);
 
+/**
+ * @brief Get the deferred log counters
+ * 
+ * @param stats Pointer to store the counters
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t debug_get_stats(debug_stats_t *stats);
+
 /**
  * @brief Log a debug message with buffer hex dump
  * 
+ * Formatted and written to UART in the caller's context, so keep it off
+ * the hot path.
+ * 
  * @param level Message level
  * @param tag Module tag
  * @param prefix Message prefix
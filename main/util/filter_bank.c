@@ -0,0 +1,189 @@
+#include "util/filter_bank.h"
+#include <string.h>
+#include <math.h>
+#include "esp_log.h"
+
+static const char *TAG = "FILTER_BANK";
+
+#define TWO_PI  (6.28318530718f)
+
+// Smoothing factor of a first-order low-pass with cutoff fc at step dt
+static inline float lowpass_alpha(float cutoff_hz, float dt_sec) {
+    float r = TWO_PI * cutoff_hz * dt_sec;
+    return r / (1.0f + r);
+}
+
+static inline float median3(float a, float b, float c) {
+    if (a > b) {
+        float t = a; a = b; b = t;
+    }
+    // a <= b here
+    if (c <= a) {
+        return a;
+    }
+    return (c < b) ? c : b;
+}
+
+// Fill a channel's state with a steady value so the first output is not skewed
+static void prime_channel(filter_bank_t *bank, uint8_t ch, float value) {
+    uint8_t window = bank->config[ch].window;
+    for (int i = 0; i < window; i++) {
+        bank->ma_history[i][ch] = value;
+    }
+    bank->ma_sum[ch] = value * window;
+    bank->ma_index[ch] = 0;
+    bank->last_output[ch] = value;
+    bank->last_input[ch] = value;
+    bank->median_prev[0][ch] = value;
+    bank->median_prev[1][ch] = value;
+    bank->euro_derivative[ch] = 0.0f;
+    bank->primed[ch] = true;
+}
+
+// One filter step for one channel; inv_dt is 1/dt_sec, precomputed by the caller
+static inline float filter_step(filter_bank_t *bank, uint8_t ch, float x, float dt_sec, float inv_dt) {
+    const filter_config_t *cfg = &bank->config[ch];
+    float y;
+
+    if (!bank->primed[ch]) {
+        prime_channel(bank, ch, x);
+        return x;
+    }
+
+    switch (cfg->type) {
+        case FILTER_TYPE_MOVING_AVERAGE: {
+            // Running sum: add the new sample, subtract the one leaving the window.
+            // Exact for integer-valued inputs such as ADC counts.
+            uint8_t idx = bank->ma_index[ch];
+            bank->ma_sum[ch] += x - bank->ma_history[idx][ch];
+            bank->ma_history[idx][ch] = x;
+            bank->ma_index[ch] = (idx + 1 == cfg->window) ? 0 : idx + 1;
+            y = bank->ma_sum[ch] * (1.0f / cfg->window);
+            break;
+        }
+
+        case FILTER_TYPE_IIR:
+            y = bank->last_output[ch] + cfg->alpha * (x - bank->last_output[ch]);
+            break;
+
+        case FILTER_TYPE_MEDIAN3:
+            y = median3(bank->median_prev[1][ch], bank->median_prev[0][ch], x);
+            bank->median_prev[1][ch] = bank->median_prev[0][ch];
+            bank->median_prev[0][ch] = x;
+            break;
+
+        case FILTER_TYPE_ONE_EURO: {
+            // Smoothed derivative drives the cutoff: slow motion -> heavy smoothing,
+            // fast motion -> low lag
+            float derivative = (x - bank->last_input[ch]) * inv_dt;
+            float a_d = lowpass_alpha(cfg->derivative_cutoff_hz, dt_sec);
+            bank->euro_derivative[ch] += a_d * (derivative - bank->euro_derivative[ch]);
+
+            float cutoff = cfg->min_cutoff_hz + cfg->beta * fabsf(bank->euro_derivative[ch]);
+            float a = lowpass_alpha(cutoff, dt_sec);
+            y = bank->last_output[ch] + a * (x - bank->last_output[ch]);
+            break;
+        }
+
+        case FILTER_TYPE_NONE:
+        default:
+            y = x;
+            break;
+    }
+
+    bank->last_input[ch] = x;
+    bank->last_output[ch] = y;
+    return y;
+}
+
+esp_err_t filter_bank_init(filter_bank_t *bank, uint8_t channel_count) {
+    if (bank == NULL || channel_count == 0 || channel_count > FILTER_BANK_MAX_CHANNELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(bank, 0, sizeof(filter_bank_t));
+    bank->channel_count = channel_count;
+
+    for (int i = 0; i < FILTER_BANK_MAX_CHANNELS; i++) {
+        bank->config[i].type = FILTER_TYPE_NONE;
+        bank->config[i].window = 1;
+        bank->config[i].alpha = 1.0f;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t filter_bank_configure(filter_bank_t *bank, uint8_t channel, const filter_config_t *config) {
+    if (bank == NULL || config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (channel != FILTER_BANK_ALL_CHANNELS && channel >= bank->channel_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (config->type == FILTER_TYPE_MOVING_AVERAGE &&
+        (config->window == 0 || config->window > FILTER_BANK_MAX_WINDOW)) {
+        ESP_LOGE(TAG, "Moving average window must be 1-%d", FILTER_BANK_MAX_WINDOW);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (config->type == FILTER_TYPE_IIR && (config->alpha <= 0.0f || config->alpha > 1.0f)) {
+        ESP_LOGE(TAG, "IIR alpha must be in (0, 1]");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (config->type == FILTER_TYPE_ONE_EURO &&
+        (config->min_cutoff_hz <= 0.0f || config->derivative_cutoff_hz <= 0.0f)) {
+        ESP_LOGE(TAG, "1-euro cutoffs must be positive");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t first = (channel == FILTER_BANK_ALL_CHANNELS) ? 0 : channel;
+    uint8_t last = (channel == FILTER_BANK_ALL_CHANNELS) ? bank->channel_count - 1 : channel;
+
+    for (uint8_t ch = first; ch <= last; ch++) {
+        bank->config[ch] = *config;
+        if (bank->config[ch].window == 0) {
+            bank->config[ch].window = 1;
+        }
+        bank->primed[ch] = false;
+    }
+
+    return ESP_OK;
+}
+
+void filter_bank_reset(filter_bank_t *bank, const float *initial) {
+    if (bank == NULL) {
+        return;
+    }
+
+    for (uint8_t ch = 0; ch < bank->channel_count; ch++) {
+        if (initial != NULL) {
+            prime_channel(bank, ch, initial[ch]);
+        } else {
+            bank->primed[ch] = false;
+        }
+    }
+}
+
+void filter_bank_process(filter_bank_t *bank, const float *input, float *output, float dt_sec) {
+    if (bank == NULL || input == NULL || output == NULL) {
+        return;
+    }
+
+    float inv_dt = (dt_sec > 0.0f) ? 1.0f / dt_sec : 0.0f;
+
+    for (uint8_t ch = 0; ch < bank->channel_count; ch++) {
+        output[ch] = filter_step(bank, ch, input[ch], dt_sec, inv_dt);
+    }
+}
+
+float filter_bank_process_channel(filter_bank_t *bank, uint8_t channel, float input, float dt_sec) {
+    if (bank == NULL || channel >= bank->channel_count) {
+        return input;
+    }
+
+    float inv_dt = (dt_sec > 0.0f) ? 1.0f / dt_sec : 0.0f;
+    return filter_step(bank, channel, input, dt_sec, inv_dt);
+}
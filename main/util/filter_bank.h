@@ -0,0 +1,104 @@
+#ifndef UTIL_FILTER_BANK_H
+#define UTIL_FILTER_BANK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define FILTER_BANK_MAX_CHANNELS    (10)
+#define FILTER_BANK_MAX_WINDOW      (16)
+#define FILTER_BANK_ALL_CHANNELS    (0xFF)
+
+/**
+ * @brief Filter types, all O(1) per sample
+ */
+typedef enum {
+    FILTER_TYPE_NONE = 0,         // Pass-through
+    FILTER_TYPE_MOVING_AVERAGE,   // Running-sum moving average
+    FILTER_TYPE_IIR,              // One-pole low-pass
+    FILTER_TYPE_MEDIAN3,          // Median of the last three samples (spike rejection)
+    FILTER_TYPE_ONE_EURO          // Speed-adaptive low-pass (1-euro filter)
+} filter_type_t;
+
+/**
+ * @brief Per-channel filter configuration
+ */
+typedef struct {
+    filter_type_t type;
+    uint8_t window;               // Moving average length (1..FILTER_BANK_MAX_WINDOW)
+    float alpha;                  // IIR smoothing factor (0..1], 1 = no smoothing
+    float min_cutoff_hz;          // 1-euro minimum cutoff frequency
+    float beta;                   // 1-euro speed coefficient
+    float derivative_cutoff_hz;   // 1-euro cutoff for the derivative estimate
+} filter_config_t;
+
+/**
+ * @brief Filter bank state
+ *
+ * State is kept as one array per quantity, indexed by channel, so a pass
+ * over all channels walks contiguous memory.
+ */
+typedef struct {
+    uint8_t channel_count;
+    filter_config_t config[FILTER_BANK_MAX_CHANNELS];
+    float ma_history[FILTER_BANK_MAX_WINDOW][FILTER_BANK_MAX_CHANNELS] __attribute__((aligned(16)));
+    float ma_sum[FILTER_BANK_MAX_CHANNELS] __attribute__((aligned(16)));
+    uint8_t ma_index[FILTER_BANK_MAX_CHANNELS];
+    float last_output[FILTER_BANK_MAX_CHANNELS] __attribute__((aligned(16)));
+    float median_prev[2][FILTER_BANK_MAX_CHANNELS] __attribute__((aligned(16)));
+    float euro_derivative[FILTER_BANK_MAX_CHANNELS] __attribute__((aligned(16)));
+    float last_input[FILTER_BANK_MAX_CHANNELS] __attribute__((aligned(16)));
+    bool primed[FILTER_BANK_MAX_CHANNELS];
+} filter_bank_t;
+
+/**
+ * @brief Initialize a filter bank with every channel set to pass-through
+ *
+ * @param bank Pointer to the filter bank
+ * @param channel_count Number of channels (1..FILTER_BANK_MAX_CHANNELS)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t filter_bank_init(filter_bank_t *bank, uint8_t channel_count);
+
+/**
+ * @brief Select the filter for one channel or all channels
+ *
+ * The channel's state is reset and re-primed by its next sample.
+ *
+ * @param bank Pointer to the filter bank
+ * @param channel Channel index, or FILTER_BANK_ALL_CHANNELS
+ * @param config Filter configuration
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t filter_bank_configure(filter_bank_t *bank, uint8_t channel, const filter_config_t *config);
+
+/**
+ * @brief Reset the state of all channels
+ *
+ * @param bank Pointer to the filter bank
+ * @param initial Values to prime every channel with, or NULL to prime on the next sample
+ */
+void filter_bank_reset(filter_bank_t *bank, const float *initial);
+
+/**
+ * @brief Filter one sample of every channel in a single pass
+ *
+ * @param bank Pointer to the filter bank
+ * @param input Input samples (channel_count values)
+ * @param output Filtered samples (channel_count values, may alias input)
+ * @param dt_sec Time since the previous sample in seconds (used by the 1-euro filter)
+ */
+void filter_bank_process(filter_bank_t *bank, const float *input, float *output, float dt_sec);
+
+/**
+ * @brief Filter one sample of a single channel
+ *
+ * @param bank Pointer to the filter bank
+ * @param channel Channel index
+ * @param input Input sample
+ * @param dt_sec Time since the previous sample in seconds
+ * @return Filtered sample
+ */
+float filter_bank_process_channel(filter_bank_t *bank, uint8_t channel, float input, float dt_sec);
+
+#endif /* UTIL_FILTER_BANK_H */
@@ -0,0 +1,116 @@
+#include "util/frame_pool.h"
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "config/system_config.h"
+#include "config/memory_layout.h"
+
+static const char *TAG = "FRAME_POOL";
+
+// Frame storage and per-slot reference counts
+static MEM_HOT sensor_data_t frame_slots[SENSOR_FRAME_POOL_SIZE];
+static atomic_uint_fast8_t frame_refs[SENSOR_FRAME_POOL_SIZE];
+
+// Count of a slot whose last reference is running the release hook
+#define FRAME_REF_RELEASING UINT8_MAX
+
+// Slot where the next acquire starts searching
+static atomic_uint_fast8_t next_slot = 0;
+
+static bool frame_pool_initialized = false;
+static frame_pool_release_hook_t release_hook = NULL;
+
+esp_err_t frame_pool_init(void) {
+    memset(frame_slots, 0, sizeof(frame_slots));
+    for (int i = 0; i < SENSOR_FRAME_POOL_SIZE; i++) {
+        atomic_init(&frame_refs[i], 0);
+    }
+    atomic_store(&next_slot, 0);
+
+    frame_pool_initialized = true;
+    ESP_LOGI(TAG, "Frame pool initialized (%d slots, %d bytes)",
+             SENSOR_FRAME_POOL_SIZE, (int)sizeof(frame_slots));
+
+    return ESP_OK;
+}
+
+void frame_pool_deinit(void) {
+    frame_pool_initialized = false;
+}
+
+esp_err_t frame_pool_acquire(sensor_frame_index_t *index) {
+    if (!frame_pool_initialized || index == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Round-robin scan so recently released slots are not reused immediately
+    uint_fast8_t start = atomic_fetch_add(&next_slot, 1) % SENSOR_FRAME_POOL_SIZE;
+    for (int n = 0; n < SENSOR_FRAME_POOL_SIZE; n++) {
+        uint_fast8_t slot = (start + n) % SENSOR_FRAME_POOL_SIZE;
+        uint_fast8_t expected = 0;
+        if (atomic_compare_exchange_strong(&frame_refs[slot], &expected, 1)) {
+            *index = (sensor_frame_index_t)slot;
+            return ESP_OK;
+        }
+    }
+
+    return ESP_ERR_NO_MEM;
+}
+
+void frame_pool_retain(sensor_frame_index_t index) {
+    if (index >= SENSOR_FRAME_POOL_SIZE) {
+        return;
+    }
+    atomic_fetch_add(&frame_refs[index], 1);
+}
+
+void frame_pool_release(sensor_frame_index_t index) {
+    if (index >= SENSOR_FRAME_POOL_SIZE) {
+        return;
+    }
+
+    // Claim each decrement with a CAS; the last one parks the count on
+    // FRAME_REF_RELEASING, which acquire cannot take, so the hook sees the
+    // frame before the slot becomes acquirable again
+    uint_fast8_t refs = atomic_load(&frame_refs[index]);
+    while (1) {
+        if (refs == 0 || refs == FRAME_REF_RELEASING) {
+            // Unbalanced release, leave the count alone rather than wrapping
+            ESP_LOGW(TAG, "Release of free slot %d", index);
+            return;
+        }
+
+        uint_fast8_t next = (refs == 1) ? FRAME_REF_RELEASING : refs - 1;
+        if (atomic_compare_exchange_weak(&frame_refs[index], &refs, next)) {
+            break;
+        }
+    }
+
+    if (refs == 1) {
+        if (release_hook != NULL) {
+            release_hook(&frame_slots[index]);
+        }
+        atomic_store(&frame_refs[index], 0);
+    }
+}
+
+void frame_pool_set_release_hook(frame_pool_release_hook_t hook) {
+    release_hook = hook;
+}
+
+sensor_data_t* frame_pool_get(sensor_frame_index_t index) {
+    if (index >= SENSOR_FRAME_POOL_SIZE) {
+        return NULL;
+    }
+    return &frame_slots[index];
+}
+
+uint32_t frame_pool_get_free_count(void) {
+    uint32_t free_count = 0;
+    for (int i = 0; i < SENSOR_FRAME_POOL_SIZE; i++) {
+        if (atomic_load(&frame_refs[i]) == 0) {
+            free_count++;
+        }
+    }
+    return free_count;
+}
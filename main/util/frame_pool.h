@@ -0,0 +1,83 @@
+#ifndef UTIL_FRAME_POOL_H
+#define UTIL_FRAME_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "util/buffer.h"
+
+/**
+ * @brief Preallocated pool of reference-counted sensor frames
+ *
+ * The sensor task fills a slot and passes only its index through
+ * g_sensor_data_queue. Consumers read the frame in place and drop their
+ * reference when done; a slot returns to the pool when its count reaches 0.
+ * Acquire, retain and release are lock-free and may be called from any core.
+ */
+
+/**
+ * @brief Hook run on a frame just before its slot returns to the pool
+ *
+ * Used to drop references the frame holds on other pools.
+ */
+typedef void (*frame_pool_release_hook_t)(sensor_data_t *frame);
+
+/**
+ * @brief Initialize the frame pool
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t frame_pool_init(void);
+
+/**
+ * @brief Deinitialize the frame pool
+ */
+void frame_pool_deinit(void);
+
+/**
+ * @brief Acquire a free frame slot
+ *
+ * The returned slot holds one reference owned by the caller.
+ *
+ * @param index Pointer to store the slot index
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if every slot is in use
+ */
+esp_err_t frame_pool_acquire(sensor_frame_index_t *index);
+
+/**
+ * @brief Add a reference to a frame slot
+ *
+ * @param index Slot index
+ */
+void frame_pool_retain(sensor_frame_index_t index);
+
+/**
+ * @brief Drop a reference to a frame slot
+ *
+ * @param index Slot index
+ */
+void frame_pool_release(sensor_frame_index_t index);
+
+/**
+ * @brief Set the hook run when a slot is freed
+ *
+ * @param hook Hook to run, or NULL for none
+ */
+void frame_pool_set_release_hook(frame_pool_release_hook_t hook);
+
+/**
+ * @brief Get the frame stored in a slot
+ *
+ * @param index Slot index
+ * @return Pointer to the frame, or NULL if the index is invalid
+ */
+sensor_data_t* frame_pool_get(sensor_frame_index_t index);
+
+/**
+ * @brief Get the number of free slots
+ *
+ * @return Number of slots with no references
+ */
+uint32_t frame_pool_get_free_count(void);
+
+#endif /* UTIL_FRAME_POOL_H */
@@ -0,0 +1,62 @@
+#include "util/heap_guard.h"
+#include <stdatomic.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+static const char *TAG = "HEAP_GUARD";
+
+// Touched from the allocator, possibly from an ISR, so kept in DRAM
+static DRAM_ATTR atomic_bool armed = false;
+static DRAM_ATTR atomic_uint_least32_t allocations = 0;
+static DRAM_ATTR atomic_uint_least32_t bytes = 0;
+static DRAM_ATTR atomic_uint_least32_t largest = 0;
+
+void heap_guard_arm(void) {
+    atomic_store(&allocations, 0);
+    atomic_store(&bytes, 0);
+    atomic_store(&largest, 0);
+    atomic_store(&armed, true);
+
+#if CONFIG_HEAP_USE_HOOKS
+    ESP_LOGI(TAG, "Counting heap allocations from now on");
+#else
+    ESP_LOGW(TAG, "CONFIG_HEAP_USE_HOOKS is off, heap allocations are not counted");
+#endif
+}
+
+esp_err_t heap_guard_get_stats(heap_guard_stats_t *stats) {
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    stats->allocations = atomic_load(&allocations);
+    stats->bytes = atomic_load(&bytes);
+    stats->largest = atomic_load(&largest);
+    stats->armed = atomic_load(&armed);
+
+#if CONFIG_HEAP_USE_HOOKS
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+#if CONFIG_HEAP_USE_HOOKS
+// Called by the heap for every successful allocation; must not allocate or log
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps) {
+    if (!atomic_load_explicit(&armed, memory_order_relaxed)) {
+        return;
+    }
+
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bytes, (uint_least32_t)size, memory_order_relaxed);
+
+    uint_least32_t seen = atomic_load_explicit(&largest, memory_order_relaxed);
+    while (size > seen &&
+           !atomic_compare_exchange_weak_explicit(&largest, &seen, (uint_least32_t)size,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+#endif
@@ -0,0 +1,41 @@
+#ifndef UTIL_HEAP_GUARD_H
+#define UTIL_HEAP_GUARD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/**
+ * @brief Heap allocations seen after initialization
+ *
+ * Steady state is meant to run without the heap: everything long-lived
+ * is reserved at link time and per-cycle memory comes from scratch
+ * arenas. Once armed, every heap allocation is counted through the
+ * ESP-IDF heap hooks (CONFIG_HEAP_USE_HOOKS). Expected exceptions: the
+ * Bluetooth stack and newlib file I/O allocate while a client is
+ * connected or a trace is recording, and the audio and camera drivers
+ * allocate once when first used.
+ */
+typedef struct {
+    uint32_t allocations;   // Allocations since arming
+    uint32_t bytes;         // Bytes requested by those allocations
+    uint32_t largest;       // Largest single allocation since arming
+    bool armed;
+} heap_guard_stats_t;
+
+/**
+ * @brief Start counting allocations
+ *
+ * Called once SYSTEM_EVENT_INIT_COMPLETE is set.
+ */
+void heap_guard_arm(void);
+
+/**
+ * @brief Get the allocation counters
+ *
+ * @param stats Pointer to store the counters
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED without heap hooks
+ */
+esp_err_t heap_guard_get_stats(heap_guard_stats_t *stats);
+
+#endif /* UTIL_HEAP_GUARD_H */
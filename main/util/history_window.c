@@ -0,0 +1,100 @@
+#include "util/history_window.h"
+#include <string.h>
+#include "esp_log.h"
+
+static const char *TAG = "HISTORY";
+
+// Store a value at a slot and at its mirror
+static inline void history_store(float *channel, size_t slot, float value) {
+    channel[slot] = value;
+    channel[slot + HISTORY_WINDOW_SIZE] = value;
+}
+
+esp_err_t history_window_init(history_window_t *window) {
+    if (window == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(window, 0, sizeof(history_window_t));
+    ESP_LOGD(TAG, "History window initialized (%d samples x %d channels)",
+             HISTORY_WINDOW_SIZE, HISTORY_CHANNEL_COUNT);
+
+    return ESP_OK;
+}
+
+esp_err_t history_window_push(history_window_t *window, const sensor_data_t *data) {
+    if (window == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t slot = window->head;
+    size_t previous = (slot + HISTORY_WINDOW_SIZE - 1) % HISTORY_WINDOW_SIZE;
+
+    // Flex joint angles
+    for (int i = 0; i < 10; i++) {
+        float *channel = window->channels[HISTORY_CH_FLEX_0 + i];
+        history_store(channel, slot, data->flex_data_valid ? data->flex_data.angles[i] : channel[previous]);
+    }
+
+    // IMU channels
+    for (int i = 0; i < 3; i++) {
+        float *accel = window->channels[HISTORY_CH_ACCEL_X + i];
+        float *gyro = window->channels[HISTORY_CH_GYRO_X + i];
+        float *gravity = window->channels[HISTORY_CH_GRAVITY_X + i];
+        float *linear = window->channels[HISTORY_CH_LINEAR_ACCEL_X + i];
+
+        if (data->imu_data_valid) {
+            history_store(accel, slot, data->imu_data.accel[i]);
+            history_store(gyro, slot, data->imu_data.gyro[i]);
+            history_store(gravity, slot, data->imu_data.gravity[i]);
+            history_store(linear, slot, data->imu_data.linear_accel[i]);
+        } else {
+            history_store(accel, slot, accel[previous]);
+            history_store(gyro, slot, gyro[previous]);
+            history_store(gravity, slot, gravity[previous]);
+            history_store(linear, slot, linear[previous]);
+        }
+    }
+
+    window->timestamps[slot] = data->timestamp;
+    window->timestamps[slot + HISTORY_WINDOW_SIZE] = data->timestamp;
+
+    window->head = (slot + 1) % HISTORY_WINDOW_SIZE;
+    if (window->count < HISTORY_WINDOW_SIZE) {
+        window->count++;
+    }
+
+    return ESP_OK;
+}
+
+float history_window_at(const history_window_t *window, history_channel_t channel, size_t k) {
+    if (window == NULL || channel >= HISTORY_CHANNEL_COUNT || k >= window->count) {
+        return 0.0f;
+    }
+
+    return window->channels[channel][window->head + HISTORY_WINDOW_SIZE - 1 - k];
+}
+
+const float* history_window_channel(const history_window_t *window, history_channel_t channel, size_t length) {
+    if (window == NULL || channel >= HISTORY_CHANNEL_COUNT || length == 0 || length > window->count) {
+        return NULL;
+    }
+
+    // The mirrored layout keeps [head + SIZE - length, head + SIZE) contiguous
+    return &window->channels[channel][window->head + HISTORY_WINDOW_SIZE - length];
+}
+
+const uint32_t* history_window_timestamps(const history_window_t *window, size_t length) {
+    if (window == NULL || length == 0 || length > window->count) {
+        return NULL;
+    }
+
+    return &window->timestamps[window->head + HISTORY_WINDOW_SIZE - length];
+}
+
+size_t history_window_get_count(const history_window_t *window) {
+    if (window == NULL) {
+        return 0;
+    }
+    return window->count;
+}
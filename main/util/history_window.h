@@ -0,0 +1,101 @@
+#ifndef UTIL_HISTORY_WINDOW_H
+#define UTIL_HISTORY_WINDOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "config/system_config.h"
+#include "util/buffer.h"
+
+/**
+ * @brief Channels stored in the history window
+ */
+typedef enum {
+    HISTORY_CH_FLEX_0 = 0,                       // Flex joint angles 0..9
+    HISTORY_CH_ACCEL_X = HISTORY_CH_FLEX_0 + 10,
+    HISTORY_CH_ACCEL_Y,
+    HISTORY_CH_ACCEL_Z,
+    HISTORY_CH_GYRO_X,
+    HISTORY_CH_GYRO_Y,
+    HISTORY_CH_GYRO_Z,
+    HISTORY_CH_GRAVITY_X,                        // Gravity direction, gimbal-free tilt
+    HISTORY_CH_GRAVITY_Y,
+    HISTORY_CH_GRAVITY_Z,
+    HISTORY_CH_LINEAR_ACCEL_X,                   // Acceleration with gravity removed
+    HISTORY_CH_LINEAR_ACCEL_Y,
+    HISTORY_CH_LINEAR_ACCEL_Z,
+    HISTORY_CHANNEL_COUNT
+} history_channel_t;
+
+/**
+ * @brief Sliding window of sensor history stored as structure-of-arrays
+ *
+ * Each channel is its own float array. Every sample is written twice,
+ * at slot and slot + HISTORY_WINDOW_SIZE, so the last N samples of a
+ * channel are always one contiguous run (oldest first) with no wrap.
+ */
+typedef struct {
+    float channels[HISTORY_CHANNEL_COUNT][2 * HISTORY_WINDOW_SIZE];
+    uint32_t timestamps[2 * HISTORY_WINDOW_SIZE];
+    size_t head;               // Slot of the next write
+    size_t count;              // Number of valid samples
+} history_window_t;
+
+/**
+ * @brief Initialize (clear) a history window
+ *
+ * @param window Pointer to the window
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t history_window_init(history_window_t *window);
+
+/**
+ * @brief Append a sensor frame to the window
+ *
+ * Channels whose sensor is not valid in the frame repeat their last value.
+ *
+ * @param window Pointer to the window
+ * @param data Sensor frame to append
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t history_window_push(history_window_t *window, const sensor_data_t *data);
+
+/**
+ * @brief Get one channel value k samples ago
+ *
+ * @param window Pointer to the window
+ * @param channel Channel to read
+ * @param k Number of samples ago (0 = most recent), must be < count
+ * @return Channel value, or 0 if k is out of range
+ */
+float history_window_at(const history_window_t *window, history_channel_t channel, size_t k);
+
+/**
+ * @brief Get the last samples of one channel as a contiguous array
+ *
+ * @param window Pointer to the window
+ * @param channel Channel to read
+ * @param length Number of samples, must be <= count
+ * @return Pointer to the oldest of the last length samples, or NULL
+ */
+const float* history_window_channel(const history_window_t *window, history_channel_t channel, size_t length);
+
+/**
+ * @brief Get the timestamps (ms) of the last samples as a contiguous array
+ *
+ * @param window Pointer to the window
+ * @param length Number of samples, must be <= count
+ * @return Pointer to the oldest of the last length timestamps, or NULL
+ */
+const uint32_t* history_window_timestamps(const history_window_t *window, size_t length);
+
+/**
+ * @brief Get the number of samples currently held
+ *
+ * @param window Pointer to the window
+ * @return Number of valid samples
+ */
+size_t history_window_get_count(const history_window_t *window);
+
+#endif /* UTIL_HISTORY_WINDOW_H */
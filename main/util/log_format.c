@@ -0,0 +1,312 @@
+#include "util/log_format.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SPEC_SIZE           48
+#define SPEC_MAX_CHARS      (SPEC_SIZE - 24)    // Room left for two '*' values
+
+// Argument a conversion consumes, named by its promoted type
+typedef enum {
+    ARG_INVALID = 0,             // Unsupported conversion, formatting stops here
+    ARG_NONE,                    // %%
+    ARG_INT,
+    ARG_LONG,
+    ARG_LLONG,
+    ARG_INTMAX,
+    ARG_SIZE,
+    ARG_PTRDIFF,
+    ARG_DOUBLE,
+    ARG_LDOUBLE,
+    ARG_PTR,
+    ARG_STRING                   // Copied with its terminator
+} arg_kind_t;
+
+typedef struct {
+    arg_kind_t kind;
+    bool star_width;             // Width comes from an int argument
+    bool star_precision;         // So does the precision
+} conversion_t;
+
+/**
+ * @brief Parse one conversion specification
+ *
+ * @param p First character after the '%'
+ * @param conv Pointer to store the conversion
+ * @return First character after the conversion
+ */
+static const char* parse_conversion(const char *p, conversion_t *conv) {
+    char length = 0;
+
+    conv->kind = ARG_INVALID;
+    conv->star_width = false;
+    conv->star_precision = false;
+
+    while (*p != '\0' && strchr("-+ #0", *p) != NULL) {
+        p++;
+    }
+    if (*p == '*') {
+        conv->star_width = true;
+        p++;
+    } else {
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            conv->star_precision = true;
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') {
+                p++;
+            }
+        }
+    }
+
+    // 'H' stands for ll, 'D' for L
+    switch (*p) {
+        case 'h':
+            p++;
+            if (*p == 'h') {
+                p++;
+            }
+            length = 'h';
+            break;
+        case 'l':
+            p++;
+            length = 'l';
+            if (*p == 'l') {
+                p++;
+                length = 'H';
+            }
+            break;
+        case 'j':
+        case 'z':
+        case 't':
+            length = *p++;
+            break;
+        case 'L':
+            p++;
+            length = 'D';
+            break;
+        default:
+            break;
+    }
+
+    switch (*p) {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+            switch (length) {
+                case 'l': conv->kind = ARG_LONG; break;
+                case 'H': conv->kind = ARG_LLONG; break;
+                case 'j': conv->kind = ARG_INTMAX; break;
+                case 'z': conv->kind = ARG_SIZE; break;
+                case 't': conv->kind = ARG_PTRDIFF; break;
+                default: conv->kind = ARG_INT; break;
+            }
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            conv->kind = (length == 'D') ? ARG_LDOUBLE : ARG_DOUBLE;
+            break;
+        case 'c':
+            conv->kind = (length == 0) ? ARG_INT : ARG_INVALID;
+            break;
+        case 's':
+            conv->kind = (length == 0) ? ARG_STRING : ARG_INVALID;
+            break;
+        case 'p':
+            conv->kind = ARG_PTR;
+            break;
+        case '%':
+            conv->kind = ARG_NONE;
+            break;
+        default:
+            // %n, wide characters and the end of the string
+            return p;
+    }
+
+    return p + 1;
+}
+
+#define CAPTURE(type) do {                                  \
+        type value_ = va_arg(args, type);                   \
+        if (len + sizeof(type) > capacity) {               \
+            goto full;                                      \
+        }                                                   \
+        memcpy(out + len, &value_, sizeof(type));           \
+        len += sizeof(type);                                \
+    } while (0)
+
+size_t log_format_capture(uint8_t *out, size_t capacity, const char *format, va_list args,
+                          bool *truncated) {
+    const char *p = format;
+    size_t len = 0;
+
+    *truncated = false;
+    while ((p = strchr(p, '%')) != NULL) {
+        conversion_t conv;
+        p = parse_conversion(p + 1, &conv);
+
+        if (conv.star_width) {
+            CAPTURE(int);
+        }
+        if (conv.star_precision) {
+            CAPTURE(int);
+        }
+
+        switch (conv.kind) {
+            case ARG_INVALID:
+                return len;
+            case ARG_NONE:
+                break;
+            case ARG_INT:       CAPTURE(int); break;
+            case ARG_LONG:      CAPTURE(long); break;
+            case ARG_LLONG:     CAPTURE(long long); break;
+            case ARG_INTMAX:    CAPTURE(intmax_t); break;
+            case ARG_SIZE:      CAPTURE(size_t); break;
+            case ARG_PTRDIFF:   CAPTURE(ptrdiff_t); break;
+            case ARG_DOUBLE:    CAPTURE(double); break;
+            case ARG_LDOUBLE:   CAPTURE(long double); break;
+            case ARG_PTR:       CAPTURE(void *); break;
+            case ARG_STRING: {
+                const char *str = va_arg(args, const char *);
+                if (str == NULL) {
+                    str = "(null)";
+                }
+                size_t room = capacity - len;
+                size_t str_len = strnlen(str, room);
+                if (str_len >= room) {
+                    // Keep what fits; nothing after it does
+                    if (room > 1) {
+                        memcpy(out + len, str, room - 1);
+                        out[len + room - 1] = '\0';
+                        len += room;
+                    }
+                    goto full;
+                }
+                memcpy(out + len, str, str_len + 1);
+                len += str_len + 1;
+                break;
+            }
+        }
+    }
+    return len;
+
+full:
+    *truncated = true;
+    return len;
+}
+
+#undef CAPTURE
+
+// Copy the next stored argument out; false when the record has run out
+static bool take_arg(const uint8_t **arg, const uint8_t *arg_end, void *value, size_t size) {
+    if ((size_t)(arg_end - *arg) < size) {
+        return false;
+    }
+    memcpy(value, *arg, size);
+    *arg += size;
+    return true;
+}
+
+#define FORMAT_ARG(type) do {                                           \
+        type value_;                                                    \
+        if (!take_arg(&arg, arg_end, &value_, sizeof(type))) {          \
+            goto done;                                                  \
+        }                                                               \
+        written = snprintf(out + len, size - len, spec, value_);        \
+    } while (0)
+
+size_t log_format_message(const char *format, const uint8_t *args, size_t arg_len, bool truncated,
+                          char *out, size_t size) {
+    const uint8_t *arg = args;
+    const uint8_t *arg_end = args + arg_len;
+    const char *p = format;
+    size_t len = 0;
+    bool complete = false;
+
+    while (len < size - 1) {
+        if (*p == '\0') {
+            complete = true;
+            break;
+        }
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+
+        const char *start = p;
+        conversion_t conv;
+        p = parse_conversion(p + 1, &conv);
+        if (conv.kind == ARG_INVALID || p - start > SPEC_MAX_CHARS) {
+            break;
+        }
+        if (conv.kind == ARG_NONE) {
+            out[len++] = '%';
+            continue;
+        }
+
+        // Copy the specification, with '*' replaced by the stored values
+        char spec[SPEC_SIZE];
+        size_t spec_len = 0;
+        for (const char *q = start; q < p; q++) {
+            if (*q != '*') {
+                spec[spec_len++] = *q;
+                continue;
+            }
+            int value;
+            if (!take_arg(&arg, arg_end, &value, sizeof(value))) {
+                goto done;
+            }
+            if (value < 0 && q[-1] == '.') {
+                // A negative precision counts as none
+                spec_len--;
+                continue;
+            }
+            spec_len += snprintf(spec + spec_len, sizeof(spec) - spec_len, "%d", value);
+        }
+        spec[spec_len] = '\0';
+
+        int written = 0;
+        switch (conv.kind) {
+            case ARG_INT:       FORMAT_ARG(int); break;
+            case ARG_LONG:      FORMAT_ARG(long); break;
+            case ARG_LLONG:     FORMAT_ARG(long long); break;
+            case ARG_INTMAX:    FORMAT_ARG(intmax_t); break;
+            case ARG_SIZE:      FORMAT_ARG(size_t); break;
+            case ARG_PTRDIFF:   FORMAT_ARG(ptrdiff_t); break;
+            case ARG_DOUBLE:    FORMAT_ARG(double); break;
+            case ARG_LDOUBLE:   FORMAT_ARG(long double); break;
+            case ARG_PTR:       FORMAT_ARG(void *); break;
+            case ARG_STRING: {
+                size_t str_len = strnlen((const char *)arg, arg_end - arg);
+                if (str_len == (size_t)(arg_end - arg)) {
+                    goto done;
+                }
+                written = snprintf(out + len, size - len, spec, (const char *)arg);
+                arg += str_len + 1;
+                break;
+            }
+            default:
+                goto done;
+        }
+
+        if (written < 0) {
+            break;
+        }
+        len += (size_t)written;
+        if (len >= size - 1) {
+            len = size - 1;
+        }
+    }
+
+done:
+    out[len] = '\0';
+    if ((!complete || truncated) && len + 4 < size) {
+        memcpy(out + len, "...", 4);
+        len += 3;
+    }
+    return len;
+}
+
+#undef FORMAT_ARG
@@ -0,0 +1,49 @@
+#ifndef UTIL_LOG_FORMAT_H
+#define UTIL_LOG_FORMAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+/**
+ * @brief Deferred printf formatting for debug_log()
+ *
+ * The caller's side only copies the arguments a format consumes, as
+ * va_arg returns them, back to back in format order; %s strings are
+ * copied with their terminator. The formatting side later rebuilds the
+ * message from the format and those bytes, one conversion at a time, so
+ * it reads the same as vsnprintf would have. %n and wide characters are
+ * not supported and end the message.
+ */
+
+/**
+ * @brief Copy the arguments a format consumes
+ *
+ * @param out Buffer for the arguments
+ * @param capacity Size of out
+ * @param format printf format
+ * @param args Arguments of the call
+ * @param truncated Set when arguments did not fit; what fit is kept
+ * @return Bytes stored in out
+ */
+size_t log_format_capture(uint8_t *out, size_t capacity, const char *format, va_list args,
+                          bool *truncated);
+
+/**
+ * @brief Format captured arguments the way vsnprintf would have formatted the call
+ *
+ * A message whose arguments ran out or were truncated ends in "...".
+ *
+ * @param format Format the arguments were captured with
+ * @param args Bytes from log_format_capture()
+ * @param arg_len Length of args
+ * @param truncated As reported by log_format_capture()
+ * @param out Buffer for the message
+ * @param size Size of out, at least 1
+ * @return Length of the message in out
+ */
+size_t log_format_message(const char *format, const uint8_t *args, size_t arg_len, bool truncated,
+                          char *out, size_t size);
+
+#endif /* UTIL_LOG_FORMAT_H */
@@ -0,0 +1,47 @@
+#include "util/scratch_arena.h"
+#include "esp_log.h"
+
+static const char *TAG = "SCRATCH_ARENA";
+
+esp_err_t scratch_arena_init(scratch_arena_t *arena, void *storage, size_t capacity) {
+    if (arena == NULL || storage == NULL || capacity == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    arena->base = (uint8_t *)storage;
+    arena->capacity = capacity;
+    arena->used = 0;
+    arena->high_water = 0;
+    arena->failures = 0;
+
+    return ESP_OK;
+}
+
+void* scratch_arena_alloc(scratch_arena_t *arena, size_t size, size_t align) {
+    if (arena == NULL || arena->base == NULL || align == 0 || (align & (align - 1)) != 0) {
+        return NULL;
+    }
+
+    // Align the address, not just the offset, so any storage works
+    uintptr_t start = ((uintptr_t)arena->base + arena->used + (align - 1)) & ~(uintptr_t)(align - 1);
+    size_t offset = start - (uintptr_t)arena->base;
+    if (offset > arena->capacity || size > arena->capacity - offset) {
+        arena->failures++;
+        ESP_LOGW(TAG, "Arena exhausted (%u of %u bytes used, %u requested)",
+                 (unsigned)arena->used, (unsigned)arena->capacity, (unsigned)size);
+        return NULL;
+    }
+
+    arena->used = offset + size;
+    if (arena->used > arena->high_water) {
+        arena->high_water = arena->used;
+    }
+
+    return arena->base + offset;
+}
+
+void scratch_arena_reset(scratch_arena_t *arena) {
+    if (arena != NULL) {
+        arena->used = 0;
+    }
+}
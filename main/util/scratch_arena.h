@@ -0,0 +1,51 @@
+#ifndef UTIL_SCRATCH_ARENA_H
+#define UTIL_SCRATCH_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * @brief Bump allocator over caller-provided storage
+ *
+ * For working memory that only lives for one cycle of a task: allocate
+ * as needed during the cycle, then reset once at the top of the next.
+ * Nothing is freed individually and the heap is never touched. An arena
+ * belongs to one task and is not locked.
+ */
+typedef struct {
+    uint8_t *base;
+    size_t capacity;
+    size_t used;
+    size_t high_water;      // Most bytes in use at once since init
+    uint32_t failures;      // Allocations refused for lack of space
+} scratch_arena_t;
+
+/**
+ * @brief Initialize an arena over caller-provided storage
+ *
+ * @param arena Pointer to the arena
+ * @param storage capacity bytes, typically a static array
+ * @param capacity Size of the storage in bytes
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t scratch_arena_init(scratch_arena_t *arena, void *storage, size_t capacity);
+
+/**
+ * @brief Allocate from the arena
+ *
+ * @param arena Pointer to the arena
+ * @param size Bytes to allocate
+ * @param align Alignment, a power of two
+ * @return Pointer to the block, or NULL if the arena is exhausted
+ */
+void* scratch_arena_alloc(scratch_arena_t *arena, size_t size, size_t align);
+
+/**
+ * @brief Release everything allocated since the last reset
+ *
+ * @param arena Pointer to the arena
+ */
+void scratch_arena_reset(scratch_arena_t *arena);
+
+#endif /* UTIL_SCRATCH_ARENA_H */
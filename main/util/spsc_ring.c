@@ -0,0 +1,66 @@
+#include "util/spsc_ring.h"
+#include "esp_log.h"
+
+static const char *TAG = "SPSC_RING";
+
+esp_err_t spsc_ring_init(spsc_ring_t *ring, void *storage, size_t slot_size, uint32_t capacity) {
+    if (ring == NULL || storage == NULL || slot_size == 0 ||
+        capacity == 0 || (capacity & (capacity - 1)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ring->slots = (uint8_t *)storage;
+    ring->slot_size = slot_size;
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->dropped, 0);
+
+    ESP_LOGD(TAG, "Ring initialized (%lu slots x %u bytes)", (unsigned long)capacity, (unsigned)slot_size);
+    return ESP_OK;
+}
+
+void* spsc_ring_acquire_write(spsc_ring_t *ring) {
+    uint_fast32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint_fast32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head - tail > ring->mask) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    return ring->slots + (head & ring->mask) * ring->slot_size;
+}
+
+void spsc_ring_commit_write(spsc_ring_t *ring) {
+    // Release: the slot contents are visible before the new head
+    uint_fast32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void* spsc_ring_peek_read(spsc_ring_t *ring) {
+    uint_fast32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint_fast32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if (tail == head) {
+        return NULL;
+    }
+
+    return ring->slots + (tail & ring->mask) * ring->slot_size;
+}
+
+void spsc_ring_release_read(spsc_ring_t *ring) {
+    // Release: reads of the slot finish before the producer may reuse it
+    uint_fast32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+uint32_t spsc_ring_get_count(spsc_ring_t *ring) {
+    uint_fast32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint_fast32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    return (uint32_t)(head - tail);
+}
+
+uint32_t spsc_ring_get_dropped(spsc_ring_t *ring) {
+    return (uint32_t)atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+}
@@ -0,0 +1,83 @@
+#ifndef UTIL_SPSC_RING_H
+#define UTIL_SPSC_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "esp_err.h"
+
+/**
+ * @brief Lock-free single-producer / single-consumer ring of preallocated slots
+ *
+ * The producer fills the next free slot in place and publishes it; the
+ * consumer reads the oldest published slot in place and hands it back.
+ * Nothing is copied and no lock is taken, so the two sides may run on
+ * different cores. Each index is only written by its own side.
+ */
+typedef struct {
+    uint8_t *slots;                 // capacity slots of slot_size bytes
+    size_t slot_size;
+    uint32_t mask;                  // capacity - 1, capacity is a power of two
+    atomic_uint_fast32_t head;      // Slots published, written by the producer
+    atomic_uint_fast32_t tail;      // Slots consumed, written by the consumer
+    atomic_uint_fast32_t dropped;   // Writes refused because the ring was full
+} spsc_ring_t;
+
+/**
+ * @brief Initialize a ring over caller-provided storage
+ *
+ * @param ring Pointer to the ring
+ * @param storage capacity * slot_size bytes, aligned for the slot type
+ * @param slot_size Size of one slot in bytes
+ * @param capacity Number of slots, a power of two
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t spsc_ring_init(spsc_ring_t *ring, void *storage, size_t slot_size, uint32_t capacity);
+
+/**
+ * @brief Get the next free slot for writing (producer only)
+ *
+ * @param ring Pointer to the ring
+ * @return Slot to fill, or NULL if the ring is full (counted as dropped)
+ */
+void* spsc_ring_acquire_write(spsc_ring_t *ring);
+
+/**
+ * @brief Publish the slot returned by spsc_ring_acquire_write() (producer only)
+ *
+ * @param ring Pointer to the ring
+ */
+void spsc_ring_commit_write(spsc_ring_t *ring);
+
+/**
+ * @brief Get the oldest published slot (consumer only)
+ *
+ * @param ring Pointer to the ring
+ * @return Slot to read, or NULL if the ring is empty
+ */
+void* spsc_ring_peek_read(spsc_ring_t *ring);
+
+/**
+ * @brief Return the slot returned by spsc_ring_peek_read() (consumer only)
+ *
+ * @param ring Pointer to the ring
+ */
+void spsc_ring_release_read(spsc_ring_t *ring);
+
+/**
+ * @brief Get the number of published slots not yet consumed
+ *
+ * @param ring Pointer to the ring
+ * @return Number of slots in use
+ */
+uint32_t spsc_ring_get_count(spsc_ring_t *ring);
+
+/**
+ * @brief Get the number of writes refused because the ring was full
+ *
+ * @param ring Pointer to the ring
+ * @return Number of dropped writes
+ */
+uint32_t spsc_ring_get_dropped(spsc_ring_t *ring);
+
+#endif /* UTIL_SPSC_RING_H */
@@ -0,0 +1,80 @@
+#include "util/text_ring.h"
+#include <string.h>
+
+esp_err_t text_ring_init(text_ring_t *ring) {
+    if (ring == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(ring, 0, sizeof(text_ring_t));
+    return ESP_OK;
+}
+
+void text_ring_push(text_ring_t *ring, char c) {
+    ring->data[ring->head] = c;
+    ring->data[ring->head + TEXT_SENTENCE_CAPACITY] = c;
+    ring->head = (ring->head + 1) & (TEXT_SENTENCE_CAPACITY - 1);
+
+    if (ring->length < TEXT_SENTENCE_CAPACITY) {
+        ring->length++;
+    } else if (ring->synced > 0) {
+        // The oldest character scrolled out; the consumer keeps its copy
+        ring->synced--;
+    }
+}
+
+bool text_ring_pop(text_ring_t *ring) {
+    if (ring->length == 0) {
+        return false;
+    }
+
+    ring->head = (ring->head + TEXT_SENTENCE_CAPACITY - 1) & (TEXT_SENTENCE_CAPACITY - 1);
+    ring->length--;
+
+    // Erasing something the consumer already has
+    if (ring->synced > ring->length) {
+        ring->synced--;
+        ring->erase++;
+    }
+    return true;
+}
+
+void text_ring_clear(text_ring_t *ring) {
+    ring->erase += ring->synced;
+    ring->synced = 0;
+    ring->length = 0;
+}
+
+size_t text_ring_copy(const text_ring_t *ring, char *output_text, size_t max_length) {
+    if (output_text == NULL || max_length == 0) {
+        return 0;
+    }
+
+    size_t count = ring->length;
+    if (count > max_length - 1) {
+        count = max_length - 1;
+    }
+
+    memcpy(output_text, text_ring_data(ring) + (ring->length - count), count);
+    output_text[count] = '\0';
+    return count;
+}
+
+size_t text_ring_take_delta(text_ring_t *ring, char *output_text, size_t max_length, size_t *erase) {
+    if (output_text == NULL || max_length == 0 || erase == NULL) {
+        return 0;
+    }
+
+    size_t count = ring->length - ring->synced;
+    if (count > max_length - 1) {
+        count = max_length - 1;
+    }
+
+    memcpy(output_text, text_ring_data(ring) + ring->synced, count);
+    output_text[count] = '\0';
+
+    *erase = ring->erase;
+    ring->erase = 0;
+    ring->synced += count;
+    return count;
+}
@@ -0,0 +1,105 @@
+#ifndef UTIL_TEXT_RING_H
+#define UTIL_TEXT_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "config/system_config.h"
+
+/**
+ * @brief Length-tracked text buffer for the sentence being built
+ *
+ * Appending and erasing a character are O(1). Once full, the oldest
+ * characters scroll out. Every character is written twice, at slot and
+ * slot + TEXT_SENTENCE_CAPACITY, so the text is always one contiguous run
+ * with no wrap.
+ *
+ * The buffer also tracks how much of its end a consumer has already been
+ * given, so text_ring_take_delta() can hand out only what changed.
+ */
+typedef struct {
+    char data[2 * TEXT_SENTENCE_CAPACITY];
+    size_t head;               // Slot of the next write
+    size_t length;             // Characters held
+    size_t synced;             // Leading characters the consumer is known to hold
+    size_t erase;              // Characters the consumer must drop from its end
+} text_ring_t;
+
+/**
+ * @brief Initialize (clear) a text ring
+ *
+ * @param ring Pointer to the ring
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t text_ring_init(text_ring_t *ring);
+
+/**
+ * @brief Append a character, dropping the oldest one if full
+ *
+ * @param ring Pointer to the ring
+ * @param c Character to append
+ */
+void text_ring_push(text_ring_t *ring, char c);
+
+/**
+ * @brief Erase the last character
+ *
+ * @param ring Pointer to the ring
+ * @return true if a character was erased
+ */
+bool text_ring_pop(text_ring_t *ring);
+
+/**
+ * @brief Erase all characters
+ *
+ * @param ring Pointer to the ring
+ */
+void text_ring_clear(text_ring_t *ring);
+
+/**
+ * @brief Get the text as one contiguous run
+ *
+ * @param ring Pointer to the ring
+ * @return Pointer to the first character (not terminated), valid until the next change
+ */
+static inline const char* text_ring_data(const text_ring_t *ring) {
+    return ring->data + (ring->head + TEXT_SENTENCE_CAPACITY - ring->length);
+}
+
+/**
+ * @brief Get the last character
+ *
+ * @param ring Pointer to the ring
+ * @return Last character, or '\0' if empty
+ */
+static inline char text_ring_last(const text_ring_t *ring) {
+    return (ring->length > 0) ? ring->data[ring->head + TEXT_SENTENCE_CAPACITY - 1] : '\0';
+}
+
+/**
+ * @brief Copy the end of the text that fits into a buffer
+ *
+ * @param ring Pointer to the ring
+ * @param output_text Buffer to store the text (always terminated)
+ * @param max_length Size of the buffer
+ * @return Number of characters copied
+ */
+size_t text_ring_copy(const text_ring_t *ring, char *output_text, size_t max_length);
+
+/**
+ * @brief Take what changed since the last call
+ *
+ * The consumer drops *erase characters from the end of its copy, then
+ * appends the returned text. If the buffer is too small the rest is
+ * returned by the next call.
+ *
+ * @param ring Pointer to the ring
+ * @param output_text Buffer to store the new characters (always terminated)
+ * @param max_length Size of the buffer
+ * @param erase Pointer to store the number of characters to drop
+ * @return Number of characters copied
+ */
+size_t text_ring_take_delta(text_ring_t *ring, char *output_text, size_t max_length, size_t *erase);
+
+#endif /* UTIL_TEXT_RING_H */
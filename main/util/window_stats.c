@@ -0,0 +1,198 @@
+#include "util/window_stats.h"
+#include <string.h>
+#include "esp_log.h"
+
+static const char *TAG = "WINDOW_STATS";
+
+// Sample number of a sample, kept modulo 2^16; ages stay far below that
+static inline uint16_t sample_number(uint32_t total) {
+    return (uint16_t)total;
+}
+
+static inline uint16_t deque_back_slot(const window_deque_t *deque) {
+    return (deque->front + deque->count - 1) % WINDOW_STATS_LENGTH;
+}
+
+// Value of a sample still in the window, by its sample number
+static inline float sample_value(const float *recent, size_t span, uint16_t newest, uint16_t sample) {
+    uint16_t age = (uint16_t)(newest - sample);
+    return recent[span - 1 - age];
+}
+
+// Drop the front once it leaves the window, then drop every back entry the
+// new sample dominates. keep_max selects a max (decreasing) or min deque.
+static void deque_push(window_deque_t *deque, const float *recent, size_t span,
+                       uint16_t newest, float value, bool keep_max) {
+    if (deque->count > 0 && (uint16_t)(newest - deque->samples[deque->front]) >= WINDOW_STATS_LENGTH) {
+        deque->front = (deque->front + 1) % WINDOW_STATS_LENGTH;
+        deque->count--;
+    }
+
+    while (deque->count > 0) {
+        float back = sample_value(recent, span, newest, deque->samples[deque_back_slot(deque)]);
+        if (keep_max ? (back > value) : (back < value)) {
+            break;
+        }
+        deque->count--;
+    }
+
+    deque->count++;
+    deque->samples[deque_back_slot(deque)] = newest;
+}
+
+// Recompute the sums exactly; sliding updates drift slowly in float
+static void reseed_channel(window_channel_stats_t *ch, const float *recent, size_t span, uint16_t count) {
+    const float *window = &recent[span - count];
+    float sum = 0.0f;
+    for (uint16_t i = 0; i < count; i++) {
+        sum += window[i];
+    }
+    float mean = sum / count;
+
+    float m2 = 0.0f;
+    float energy = 0.0f;
+    for (uint16_t i = 0; i < count; i++) {
+        float d = window[i] - mean;
+        m2 += d * d;
+        if (i > 0) {
+            float step = window[i] - window[i - 1];
+            energy += step * step;
+        }
+    }
+
+    ch->mean = mean;
+    ch->m2 = m2;
+    ch->diff_energy = energy;
+}
+
+esp_err_t window_stats_init(window_stats_t *stats) {
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(stats, 0, sizeof(window_stats_t));
+    ESP_LOGD(TAG, "Window statistics initialized (%d samples x %d channels)",
+             WINDOW_STATS_LENGTH, HISTORY_CHANNEL_COUNT);
+
+    return ESP_OK;
+}
+
+esp_err_t window_stats_update(window_stats_t *stats, const history_window_t *history) {
+    if (stats == NULL || history == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t available = history_window_get_count(history);
+    if (available == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The window plus the sample that just left it, and the one before the
+    // window's oldest so its first difference can be removed
+    size_t span = (available < WINDOW_STATS_LENGTH + 1) ? available : WINDOW_STATS_LENGTH + 1;
+    bool full = stats->count == WINDOW_STATS_LENGTH && span == WINDOW_STATS_LENGTH + 1;
+    uint16_t newest = sample_number(stats->total_samples);
+
+    if (!full && stats->count < WINDOW_STATS_LENGTH) {
+        stats->count++;
+    }
+    stats->total_samples++;
+
+    bool reseed = (stats->total_samples % WINDOW_STATS_RESEED_SAMPLES) == 0;
+
+    for (int c = 0; c < HISTORY_CHANNEL_COUNT; c++) {
+        window_channel_stats_t *ch = &stats->channels[c];
+        const float *recent = history_window_channel(history, (history_channel_t)c, span);
+        float x = recent[span - 1];
+
+        if (full) {
+            // Slide: the oldest sample and its step to the next one leave
+            float x_old = recent[0];
+            float next_old = recent[1];
+            float mean_old = ch->mean;
+            ch->mean += (x - x_old) / WINDOW_STATS_LENGTH;
+            ch->m2 += (x - x_old) * (x - ch->mean + x_old - mean_old);
+            if (ch->m2 < 0.0f) {
+                ch->m2 = 0.0f;
+            }
+
+            float step_old = next_old - x_old;
+            ch->diff_energy -= step_old * step_old;
+        } else {
+            // Grow: plain Welford
+            float delta = x - ch->mean;
+            ch->mean += delta / stats->count;
+            ch->m2 += delta * (x - ch->mean);
+        }
+
+        if (stats->count > 1) {
+            float step = x - recent[span - 2];
+            ch->diff_energy += step * step;
+        }
+        if (ch->diff_energy < 0.0f) {
+            ch->diff_energy = 0.0f;
+        }
+
+        deque_push(&ch->min_deque, recent, span, newest, x, false);
+        deque_push(&ch->max_deque, recent, span, newest, x, true);
+
+        if (reseed) {
+            reseed_channel(ch, recent, span, stats->count);
+        }
+    }
+
+    return ESP_OK;
+}
+
+size_t window_stats_get_count(const window_stats_t *stats) {
+    if (stats == NULL) {
+        return 0;
+    }
+    return stats->count;
+}
+
+float window_stats_mean(const window_stats_t *stats, history_channel_t channel) {
+    if (stats == NULL || channel >= HISTORY_CHANNEL_COUNT || stats->count == 0) {
+        return 0.0f;
+    }
+    return stats->channels[channel].mean;
+}
+
+float window_stats_variance(const window_stats_t *stats, history_channel_t channel) {
+    if (stats == NULL || channel >= HISTORY_CHANNEL_COUNT || stats->count == 0) {
+        return 0.0f;
+    }
+    return stats->channels[channel].m2 / stats->count;
+}
+
+static float deque_front_value(const window_stats_t *stats, const window_deque_t *deque,
+                               history_channel_t channel, const history_window_t *history) {
+    if (stats == NULL || history == NULL || deque->count == 0) {
+        return 0.0f;
+    }
+
+    uint16_t newest = sample_number(stats->total_samples - 1);
+    uint16_t age = (uint16_t)(newest - deque->samples[deque->front]);
+    return history_window_at(history, channel, age);
+}
+
+float window_stats_min(const window_stats_t *stats, history_channel_t channel, const history_window_t *history) {
+    if (stats == NULL || channel >= HISTORY_CHANNEL_COUNT) {
+        return 0.0f;
+    }
+    return deque_front_value(stats, &stats->channels[channel].min_deque, channel, history);
+}
+
+float window_stats_max(const window_stats_t *stats, history_channel_t channel, const history_window_t *history) {
+    if (stats == NULL || channel >= HISTORY_CHANNEL_COUNT) {
+        return 0.0f;
+    }
+    return deque_front_value(stats, &stats->channels[channel].max_deque, channel, history);
+}
+
+float window_stats_diff_energy(const window_stats_t *stats, history_channel_t channel) {
+    if (stats == NULL || channel >= HISTORY_CHANNEL_COUNT || stats->count < 2) {
+        return 0.0f;
+    }
+    return stats->channels[channel].diff_energy / (stats->count - 1);
+}
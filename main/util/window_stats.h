@@ -0,0 +1,121 @@
+#ifndef UTIL_WINDOW_STATS_H
+#define UTIL_WINDOW_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "config/system_config.h"
+#include "util/history_window.h"
+
+#if WINDOW_STATS_LENGTH >= HISTORY_WINDOW_SIZE
+#error "WINDOW_STATS_LENGTH must be shorter than HISTORY_WINDOW_SIZE"
+#endif
+
+/**
+ * @brief Monotonic deque of sample numbers, front is the extreme of the window
+ */
+typedef struct {
+    uint16_t samples[WINDOW_STATS_LENGTH];
+    uint16_t front;
+    uint16_t count;
+} window_deque_t;
+
+/**
+ * @brief Running statistics of one channel
+ */
+typedef struct {
+    float mean;
+    float m2;                  // Sum of squared deviations from the mean (Welford)
+    float diff_energy;         // Sum of squared first differences
+    window_deque_t min_deque;  // Increasing values, front is the minimum
+    window_deque_t max_deque;  // Decreasing values, front is the maximum
+} window_channel_stats_t;
+
+/**
+ * @brief Sliding-window statistics over the last WINDOW_STATS_LENGTH samples
+ *        of every history channel
+ *
+ * Updated in O(1) per sample and channel: samples leaving the window are
+ * read back from the history window instead of being stored again.
+ */
+typedef struct {
+    window_channel_stats_t channels[HISTORY_CHANNEL_COUNT];
+    uint32_t total_samples;    // Samples seen since init
+    uint16_t count;            // Samples in the window
+} window_stats_t;
+
+/**
+ * @brief Initialize (clear) the statistics
+ *
+ * @param stats Pointer to the statistics
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t window_stats_init(window_stats_t *stats);
+
+/**
+ * @brief Add the newest history sample to the window
+ *
+ * Call once after every history_window_push() on the same window.
+ *
+ * @param stats Pointer to the statistics
+ * @param history History window, already containing the new sample
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t window_stats_update(window_stats_t *stats, const history_window_t *history);
+
+/**
+ * @brief Get the number of samples in the window
+ *
+ * @param stats Pointer to the statistics
+ * @return Number of samples, at most WINDOW_STATS_LENGTH
+ */
+size_t window_stats_get_count(const window_stats_t *stats);
+
+/**
+ * @brief Get the mean of a channel over the window
+ *
+ * @param stats Pointer to the statistics
+ * @param channel Channel to read
+ * @return Mean, or 0 if the window is empty
+ */
+float window_stats_mean(const window_stats_t *stats, history_channel_t channel);
+
+/**
+ * @brief Get the population variance of a channel over the window
+ *
+ * @param stats Pointer to the statistics
+ * @param channel Channel to read
+ * @return Variance, or 0 if the window is empty
+ */
+float window_stats_variance(const window_stats_t *stats, history_channel_t channel);
+
+/**
+ * @brief Get the minimum of a channel over the window
+ *
+ * @param stats Pointer to the statistics
+ * @param channel Channel to read
+ * @param history History window the statistics follow
+ * @return Minimum, or 0 if the window is empty
+ */
+float window_stats_min(const window_stats_t *stats, history_channel_t channel, const history_window_t *history);
+
+/**
+ * @brief Get the maximum of a channel over the window
+ *
+ * @param stats Pointer to the statistics
+ * @param channel Channel to read
+ * @param history History window the statistics follow
+ * @return Maximum, or 0 if the window is empty
+ */
+float window_stats_max(const window_stats_t *stats, history_channel_t channel, const history_window_t *history);
+
+/**
+ * @brief Get the mean squared first difference of a channel over the window
+ *
+ * @param stats Pointer to the statistics
+ * @param channel Channel to read
+ * @return Energy per sample step, or 0 with fewer than two samples
+ */
+float window_stats_diff_energy(const window_stats_t *stats, history_channel_t channel);
+
+#endif /* UTIL_WINDOW_STATS_H */
@@ -0,0 +1,42 @@
+#include "unity.h"
+#include "esp_log.h"
+#include "driver/i2c.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "config/pin_definitions.h"
+
+static const char *TAG = "PERF";
+
+// Same bus setup as the firmware, for the display benchmarks
+static esp_err_t init_i2c(void) {
+    i2c_config_t i2c_conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = I2C_MASTER_SDA_IO,
+        .scl_io_num = I2C_MASTER_SCL_IO,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = I2C_MASTER_FREQ_HZ
+    };
+
+    esp_err_t ret = i2c_param_config(I2C_MASTER_NUM, &i2c_conf);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return i2c_driver_install(I2C_MASTER_NUM, I2C_MODE_MASTER, 0, 0, 0);
+}
+
+void app_main(void) {
+    if (init_i2c() != ESP_OK) {
+        ESP_LOGW(TAG, "I2C init failed, display benchmarks will be skipped");
+    }
+
+    // Above every other task, so only interrupts land inside a measurement
+    vTaskPrioritySet(NULL, configMAX_PRIORITIES - 1);
+
+    // Every benchmark once at boot, then the menu to rerun single ones
+    UNITY_BEGIN();
+    unity_run_tests_by_tag("[perf]", false);
+    UNITY_END();
+
+    unity_run_menu();
+}
@@ -0,0 +1,84 @@
+#include "perf_measure.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+
+static uint32_t samples[PERF_MAX_ITERATIONS];
+static uint32_t call_overhead = 0;
+static bool overhead_measured = false;
+
+static void empty_kernel(void *ctx) {
+}
+
+static int compare_cycles(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Time every call; the kernel pointer is read through a volatile so the
+// empty call cannot be folded away either
+static void run_timed(perf_kernel_t fn, void *ctx, uint32_t iterations) {
+    perf_kernel_t volatile kernel = fn;
+
+    kernel(ctx);
+    for (uint32_t i = 0; i < iterations; i++) {
+        uint32_t start = esp_cpu_get_cycle_count();
+        kernel(ctx);
+        samples[i] = esp_cpu_get_cycle_count() - start;
+    }
+}
+
+static void summarize(uint32_t iterations, perf_result_t *result) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        total += samples[i];
+    }
+
+    qsort(samples, iterations, sizeof(samples[0]), compare_cycles);
+    result->min = samples[0];
+    result->median = samples[iterations / 2];
+    result->mean = (uint32_t)(total / iterations);
+}
+
+static uint32_t minus_overhead(uint32_t cycles) {
+    return (cycles > call_overhead) ? cycles - call_overhead : 0;
+}
+
+esp_err_t perf_measure(const char *kernel, const char *variant, uint32_t size, uint32_t iterations,
+                       perf_kernel_t fn, void *ctx, perf_result_t *result) {
+    if (fn == NULL || iterations == 0 || iterations > PERF_MAX_ITERATIONS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!overhead_measured) {
+        perf_result_t empty;
+        run_timed(empty_kernel, NULL, PERF_MAX_ITERATIONS);
+        summarize(PERF_MAX_ITERATIONS, &empty);
+        call_overhead = empty.min;
+        overhead_measured = true;
+        printf("PERF kernel=overhead variant=empty size=0 iterations=%d min=%lu median=%lu mean=%lu us=0\n",
+               PERF_MAX_ITERATIONS, (unsigned long)empty.min, (unsigned long)empty.median,
+               (unsigned long)empty.mean);
+    }
+
+    run_timed(fn, ctx, iterations);
+
+    perf_result_t summary;
+    summarize(iterations, &summary);
+    summary.min = minus_overhead(summary.min);
+    summary.median = minus_overhead(summary.median);
+    summary.mean = minus_overhead(summary.mean);
+
+    printf("PERF kernel=%s variant=%s size=%lu iterations=%lu min=%lu median=%lu mean=%lu us=%.2f\n",
+           kernel, variant, (unsigned long)size, (unsigned long)iterations, (unsigned long)summary.min,
+           (unsigned long)summary.median, (unsigned long)summary.mean,
+           (double)summary.median / esp_rom_get_cpu_ticks_per_us());
+
+    if (result != NULL) {
+        *result = summary;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,52 @@
+#ifndef PERF_MEASURE_H
+#define PERF_MEASURE_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief Cycle-count measurement of one kernel call
+ *
+ * Each call is timed on its own with the CPU cycle counter, after one
+ * untimed warm-up call, and the cost of an empty call through the same
+ * path is subtracted. The result is printed as one line:
+ *
+ *   PERF kernel=<name> variant=<name> size=<n> iterations=<n> min=<cycles> median=<cycles> mean=<cycles> us=<median us>
+ *
+ * so runs can be collected with grep '^PERF ' from the console output.
+ */
+
+#define PERF_MAX_ITERATIONS     (1000)
+
+/**
+ * @brief Kernel under measurement, one call per invocation
+ *
+ * @param ctx Context passed to perf_measure()
+ */
+typedef void (*perf_kernel_t)(void *ctx);
+
+/**
+ * @brief Summary of one measurement, in cycles per call
+ */
+typedef struct {
+    uint32_t min;
+    uint32_t median;
+    uint32_t mean;
+} perf_result_t;
+
+/**
+ * @brief Time a kernel and print its result line
+ *
+ * @param kernel Kernel name
+ * @param variant Variant name (implementation, memory or data set)
+ * @param size Representative size of one call (channels, templates, bytes...)
+ * @param iterations Timed calls (1..PERF_MAX_ITERATIONS)
+ * @param fn Kernel
+ * @param ctx Context for the kernel
+ * @param result Pointer to store the summary, or NULL
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG for a bad iteration count
+ */
+esp_err_t perf_measure(const char *kernel, const char *variant, uint32_t size, uint32_t iterations,
+                       perf_kernel_t fn, void *ctx, perf_result_t *result);
+
+#endif /* PERF_MEASURE_H */
@@ -0,0 +1,132 @@
+#include <string.h>
+#include "unity.h"
+#include "perf_measure.h"
+#include "drivers/display.h"
+#include "drivers/audio.h"
+
+#define FLUSH_ITERATIONS        (50)
+#define TEXT_ITERATIONS         (500)
+#define TONE_ITERATIONS         (200)
+#define FLUSH_TIMEOUT_MS        (100)
+
+#define TONE_SAMPLE_RATE        (16000)  // I2S_SAMPLE_RATE of the audio driver
+#define TONE_MAX_FRAMES         (512)    // Frames per I2S write in tone playback
+
+typedef struct {
+    const char *variant;
+    display_font_t font;
+    uint8_t y;
+    const char *text;
+} text_ctx_t;
+
+typedef struct {
+    int16_t buffer[2 * TONE_MAX_FRAMES];
+    uint32_t frames;
+    uint32_t phase;
+    uint32_t phase_step;
+} tone_ctx_t;
+
+static tone_ctx_t tone_ctx;
+
+static bool display_ready(void) {
+    static bool tried = false;
+    static bool ready = false;
+    if (!tried) {
+        tried = true;
+        ready = display_init() == ESP_OK;
+    }
+    return ready;
+}
+
+// Toggle a region and hand it to the flush task (display_update returns at once)
+typedef struct {
+    uint8_t x, y, width, height;
+    uint8_t color;
+} flush_ctx_t;
+
+static void update_display(void *arg) {
+    flush_ctx_t *ctx = (flush_ctx_t *)arg;
+    ctx->color ^= 1;
+    display_fill_rect(ctx->x, ctx->y, ctx->width, ctx->height, ctx->color);
+    display_update();
+}
+
+// Same, until the flush task has sent it
+static void flush_display(void *arg) {
+    update_display(arg);
+    display_wait_flush(FLUSH_TIMEOUT_MS);
+}
+
+static void draw_text(void *arg) {
+    const text_ctx_t *ctx = (const text_ctx_t *)arg;
+    display_draw_text(ctx->text, 0, ctx->y, ctx->font, DISPLAY_ALIGN_LEFT);
+}
+
+TEST_CASE("display flush", "[perf][output]")
+{
+    if (!display_ready()) {
+        TEST_IGNORE_MESSAGE("No display on the I2C bus");
+    }
+
+    // Whole frame, one text line, one glyph cell
+    flush_ctx_t regions[] = {
+        { 0, 0, 128, 64, 0 },
+        { 0, 24, 128, 8, 0 },
+        { 60, 24, 6, 8, 0 }
+    };
+    static const char *variants[] = { "frame", "line", "glyph" };
+    for (size_t i = 0; i < sizeof(regions) / sizeof(regions[0]); i++) {
+        size_t bytes = regions[i].width * regions[i].height / 8;
+        TEST_ASSERT_EQUAL(ESP_OK, perf_measure("display_update", variants[i], bytes,
+                                               FLUSH_ITERATIONS, update_display, &regions[i], NULL));
+        TEST_ASSERT_EQUAL(ESP_OK, display_wait_flush(FLUSH_TIMEOUT_MS));
+        TEST_ASSERT_EQUAL(ESP_OK, perf_measure("display_flush", variants[i], bytes,
+                                               FLUSH_ITERATIONS, flush_display, &regions[i], NULL));
+    }
+    display_clear();
+}
+
+TEST_CASE("display text", "[perf][output]")
+{
+    if (!display_ready()) {
+        TEST_IGNORE_MESSAGE("No display on the I2C bus");
+    }
+
+    // On a page boundary and shifted across two pages, then the scaled fonts
+    static const text_ctx_t faces[] = {
+        { "small_page", DISPLAY_FONT_SMALL, 24, NULL },
+        { "small_shifted", DISPLAY_FONT_SMALL, 27, NULL },
+        { "medium", DISPLAY_FONT_MEDIUM, 24, NULL },
+        { "large", DISPLAY_FONT_LARGE, 24, NULL }
+    };
+    // One letter, a word, a full 21-column line
+    static const char *texts[] = { "A", "Thankyou", "HELLO HOW ARE YOU NOW" };
+    for (size_t f = 0; f < sizeof(faces) / sizeof(faces[0]); f++) {
+        for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+            text_ctx_t ctx = faces[f];
+            ctx.text = texts[i];
+            TEST_ASSERT_EQUAL(ESP_OK, perf_measure("display_draw_text", ctx.variant, strlen(texts[i]),
+                                                   TEXT_ITERATIONS, draw_text, &ctx, NULL));
+        }
+        display_clear();
+    }
+}
+
+// One block of the audio_play_tone() sample loop
+static void render_tone(void *arg) {
+    tone_ctx_t *ctx = (tone_ctx_t *)arg;
+    ctx->phase = audio_render_tone(ctx->buffer, ctx->frames, ctx->phase, ctx->phase_step, 26214);
+}
+
+TEST_CASE("audio tone loop", "[perf][output]")
+{
+    static const uint32_t block_frames[] = { 64, 256, TONE_MAX_FRAMES };
+
+    for (size_t i = 0; i < sizeof(block_frames) / sizeof(block_frames[0]); i++) {
+        memset(&tone_ctx, 0, sizeof(tone_ctx));
+        tone_ctx.frames = block_frames[i];
+        tone_ctx.phase_step = (uint32_t)((1000ULL << 32) / TONE_SAMPLE_RATE);
+        TEST_ASSERT_EQUAL(ESP_OK, perf_measure("audio_render_tone", "wavetable", block_frames[i],
+                                               TONE_ITERATIONS, render_tone, &tone_ctx, NULL));
+    }
+}
@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "unity.h"
+#include "esp_heap_caps.h"
+#include "perf_measure.h"
+#include "processing/feature_extraction.h"
+#include "processing/template_matcher.h"
+#include "util/history_window.h"
+#include "util/window_stats.h"
+#include "util/buffer.h"
+#include "config/system_config.h"
+
+#define FEATURE_ITERATIONS      (500)
+#define SCORE_ITERATIONS        (200)
+
+typedef struct {
+    sensor_data_t frame;
+    feature_vector_t features;
+    uint32_t step;
+} feature_ctx_t;
+
+typedef struct {
+    template_set_t set;
+    float features[FEATURE_BUFFER_SIZE];
+    int16_t input_q15[TEMPLATE_MATCHER_MAX_STRIDE];
+    float scores[MAX_GESTURES];
+} score_ctx_t;
+
+// Large, so kept out of the test task's stack
+static history_window_t history;
+static window_stats_t stats;
+static feature_ctx_t feature_ctx;
+static score_ctx_t score_ctx;
+
+// Synthetic glove frame, moving a little on every call
+static void next_frame(feature_ctx_t *ctx) {
+    sensor_data_t *frame = &ctx->frame;
+    float t = ctx->step * 0.02f;
+
+    for (int i = 0; i < 10; i++) {
+        frame->flex_data.angles[i] = 45.0f + 30.0f * sinf(t + i * 0.3f);
+    }
+    frame->imu_data.accel[0] = 9.81f * sinf(t * 0.5f);
+    frame->imu_data.accel[1] = 0.5f;
+    frame->imu_data.accel[2] = 9.81f * cosf(t * 0.5f);
+    frame->imu_data.gyro[1] = 20.0f * cosf(t);
+    frame->imu_data.quaternion[0] = cosf(t * 0.25f);
+    frame->imu_data.quaternion[2] = sinf(t * 0.25f);
+    for (int i = 0; i < 5; i++) {
+        frame->touch_data.touch_status[i] = ((ctx->step >> i) & 1) != 0;
+    }
+
+    frame->timestamp = ctx->step * (1000 / SENSOR_FUSION_RATE_HZ);
+    frame->sequence_number = ctx->step++;
+}
+
+static void extract(void *arg) {
+    feature_ctx_t *ctx = (feature_ctx_t *)arg;
+    next_frame(ctx);
+    feature_extraction_process(&ctx->frame, &history, &stats, &ctx->features);
+}
+
+static void measure_features(const char *variant, bool imu, bool touch, size_t history_frames) {
+    memset(&feature_ctx, 0, sizeof(feature_ctx));
+    feature_ctx.frame.flex_data_valid = true;
+    feature_ctx.frame.imu_data_valid = imu;
+    feature_ctx.frame.touch_data_valid = touch;
+
+    TEST_ASSERT_EQUAL(ESP_OK, history_window_init(&history));
+    TEST_ASSERT_EQUAL(ESP_OK, window_stats_init(&stats));
+    for (size_t i = 0; i < history_frames; i++) {
+        next_frame(&feature_ctx);
+        history_window_push(&history, &feature_ctx.frame);
+        window_stats_update(&stats, &history);
+    }
+
+    // Size is the feature count the variant produces
+    extract(&feature_ctx);
+    TEST_ASSERT_EQUAL(ESP_OK, perf_measure("feature_extraction_process", variant,
+                                           feature_ctx.features.feature_count, FEATURE_ITERATIONS,
+                                           extract, &feature_ctx, NULL));
+}
+
+TEST_CASE("feature extraction", "[perf][processing]")
+{
+    TEST_ASSERT_EQUAL(ESP_OK, feature_extraction_init());
+
+    measure_features("flex", false, false, 0);
+    measure_features("flex_imu", true, false, 0);
+    measure_features("flex_imu_temporal", true, false, HISTORY_WINDOW_SIZE);
+    measure_features("all_temporal", true, true, HISTORY_WINDOW_SIZE);
+}
+
+static void score_f32(void *arg) {
+    score_ctx_t *ctx = (score_ctx_t *)arg;
+    template_matcher_score(&ctx->set, ctx->features, ctx->set.dim, ctx->scores);
+}
+
+static void score_q15(void *arg) {
+    score_ctx_t *ctx = (score_ctx_t *)arg;
+    template_matcher_score_q15(&ctx->set, ctx->input_q15, NULL, ctx->set.count, ctx->scores);
+}
+
+// Pack count random-ish templates into memory with the given capabilities
+static bool build_set(uint16_t count, uint32_t caps, void **blocks) {
+    uint16_t dim = GESTURE_TEMPLATE_FEATURES;
+    uint16_t stride = TEMPLATE_MATCHER_STRIDE(dim);
+
+    float *matrix = heap_caps_aligned_alloc(16, count * stride * sizeof(float), caps);
+    float *norms = heap_caps_malloc(count * sizeof(float), caps);
+    float *offset = heap_caps_malloc(dim * sizeof(float), caps);
+    float *inv_scale = heap_caps_malloc(dim * sizeof(float), caps);
+    int16_t *matrix_q15 = heap_caps_aligned_alloc(16, count * stride * sizeof(int16_t), caps);
+    blocks[0] = matrix;
+    blocks[1] = norms;
+    blocks[2] = offset;
+    blocks[3] = inv_scale;
+    blocks[4] = matrix_q15;
+    if (matrix == NULL || norms == NULL || offset == NULL || inv_scale == NULL || matrix_q15 == NULL) {
+        return false;
+    }
+
+    for (uint16_t d = 0; d < dim; d++) {
+        offset[d] = 40.0f;
+        inv_scale[d] = 1.0f / 20.0f;
+        score_ctx.features[d] = 40.0f + 25.0f * sinf(d * 0.7f);
+    }
+
+    float row[TEMPLATE_MATCHER_MAX_STRIDE];
+    for (uint16_t t = 0; t < count; t++) {
+        for (uint16_t d = 0; d < dim; d++) {
+            row[d] = 40.0f + 30.0f * sinf(t * 1.3f + d * 0.7f);
+        }
+        norms[t] = template_matcher_pack_row(row, offset, inv_scale, dim, &matrix[t * stride]);
+        template_matcher_pack_row_q15(row, offset, inv_scale, dim, &matrix_q15[t * stride]);
+    }
+    template_matcher_pack_row_q15(score_ctx.features, offset, inv_scale, dim, score_ctx.input_q15);
+
+    score_ctx.set = (template_set_t){
+        .count = count,
+        .dim = dim,
+        .stride = stride,
+        .matrix = matrix,
+        .norms = norms,
+        .offset = offset,
+        .inv_scale = inv_scale,
+        .matrix_q15 = matrix_q15
+    };
+    return true;
+}
+
+TEST_CASE("template scoring", "[perf][processing]")
+{
+    static const uint16_t template_counts[] = { 8, 32, 128, MAX_GESTURES };
+    static const struct {
+        const char *f32;
+        const char *q15;
+        uint32_t caps;
+    } memories[] = {
+        { "f32_internal", "q15_internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT },
+        { "f32_psram", "q15_psram", MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT },
+    };
+
+    for (size_t m = 0; m < sizeof(memories) / sizeof(memories[0]); m++) {
+        if (heap_caps_get_total_size(memories[m].caps) == 0) {
+            printf("PERF skipped variant=%s (no such memory)\n", memories[m].f32);
+            continue;
+        }
+
+        for (size_t c = 0; c < sizeof(template_counts) / sizeof(template_counts[0]); c++) {
+            void *blocks[5];
+            bool built = build_set(template_counts[c], memories[m].caps, blocks);
+            if (built) {
+                TEST_ASSERT_EQUAL(ESP_OK, perf_measure("template_score", memories[m].f32, template_counts[c],
+                                                       SCORE_ITERATIONS, score_f32, &score_ctx, NULL));
+                TEST_ASSERT_EQUAL(ESP_OK, perf_measure("template_score", memories[m].q15, template_counts[c],
+                                                       SCORE_ITERATIONS, score_q15, &score_ctx, NULL));
+            }
+            for (int b = 0; b < 5; b++) {
+                heap_caps_free(blocks[b]);
+            }
+            TEST_ASSERT_TRUE_MESSAGE(built, "Out of memory for the template set");
+        }
+    }
+}
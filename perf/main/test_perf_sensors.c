@@ -0,0 +1,125 @@
+#include <string.h>
+#include <math.h>
+#include "unity.h"
+#include "perf_measure.h"
+#include "util/filter_bank.h"
+#include "util/ahrs.h"
+#include "drivers/imu.h"
+#include "config/system_config.h"
+
+#define FILTER_ITERATIONS       (1000)
+#define FLEX_WINDOW             (5)     // FLEX_FILTER_DEFAULT_WINDOW of the flex driver
+#define ORIENTATION_ITERATIONS  (1000)
+
+typedef struct {
+    filter_bank_t bank;
+    float input[FILTER_BANK_MAX_CHANNELS];
+    float output[FILTER_BANK_MAX_CHANNELS];
+    uint32_t step;
+} filter_ctx_t;
+
+typedef struct {
+    float accel[3];
+    float gyro[3];               // °/s
+    float gyro_rad[3];           // rad/s, for the AHRS
+    float orientation[3];
+    ahrs_t ahrs;
+    uint32_t step;
+} orientation_ctx_t;
+
+static filter_ctx_t filter_ctx;
+static orientation_ctx_t orientation_ctx;
+
+// Flex-like input: slow bend plus ADC noise, different on every call
+static void next_flex_input(filter_ctx_t *ctx) {
+    ctx->step++;
+    for (int i = 0; i < FILTER_BANK_MAX_CHANNELS; i++) {
+        ctx->input[i] = 2000.0f + 500.0f * sinf(ctx->step * 0.01f + i) + (float)((ctx->step * 7 + i * 13) % 16);
+    }
+}
+
+static void filter_frame(void *arg) {
+    filter_ctx_t *ctx = (filter_ctx_t *)arg;
+    next_flex_input(ctx);
+    filter_bank_process(&ctx->bank, ctx->input, ctx->output, 1.0f / FLEX_SENSOR_SAMPLE_RATE_HZ);
+}
+
+// One joint at a time, as flex_sensor_read_raw() filters a single joint
+static void filter_channel(void *arg) {
+    filter_ctx_t *ctx = (filter_ctx_t *)arg;
+    next_flex_input(ctx);
+    ctx->output[0] = filter_bank_process_channel(&ctx->bank, 0, ctx->input[0], 1.0f / FLEX_SENSOR_SAMPLE_RATE_HZ);
+}
+
+static void setup_filters(uint8_t channels, const filter_config_t *config) {
+    memset(&filter_ctx, 0, sizeof(filter_ctx));
+    TEST_ASSERT_EQUAL(ESP_OK, filter_bank_init(&filter_ctx.bank, channels));
+    TEST_ASSERT_EQUAL(ESP_OK, filter_bank_configure(&filter_ctx.bank, FILTER_BANK_ALL_CHANNELS, config));
+}
+
+TEST_CASE("flex filter bank", "[perf][sensors]")
+{
+    static const struct {
+        const char *name;
+        filter_config_t config;
+    } filters[] = {
+        { "moving_average", { .type = FILTER_TYPE_MOVING_AVERAGE, .window = FLEX_WINDOW } },
+        { "iir", { .type = FILTER_TYPE_IIR, .alpha = 0.3f } },
+        { "median3", { .type = FILTER_TYPE_MEDIAN3 } },
+        { "one_euro", { .type = FILTER_TYPE_ONE_EURO, .min_cutoff_hz = 1.0f, .beta = 0.01f,
+                        .derivative_cutoff_hz = 1.0f } },
+    };
+    static const uint8_t channel_counts[] = { 1, 5, FILTER_BANK_MAX_CHANNELS };
+
+    for (size_t f = 0; f < sizeof(filters) / sizeof(filters[0]); f++) {
+        for (size_t c = 0; c < sizeof(channel_counts) / sizeof(channel_counts[0]); c++) {
+            setup_filters(channel_counts[c], &filters[f].config);
+            TEST_ASSERT_EQUAL(ESP_OK, perf_measure("filter_bank_process", filters[f].name, channel_counts[c],
+                                                   FILTER_ITERATIONS, filter_frame, &filter_ctx, NULL));
+        }
+
+        setup_filters(FILTER_BANK_MAX_CHANNELS, &filters[f].config);
+        TEST_ASSERT_EQUAL(ESP_OK, perf_measure("filter_bank_process_channel", filters[f].name, 1,
+                                               FILTER_ITERATIONS, filter_channel, &filter_ctx, NULL));
+    }
+}
+
+// A hand turning slowly with the gravity vector following it
+static void next_imu_input(orientation_ctx_t *ctx) {
+    float angle = ctx->step++ * 0.002f;
+    ctx->accel[0] = sinf(angle);
+    ctx->accel[1] = 0.1f * cosf(angle * 3.0f);
+    ctx->accel[2] = cosf(angle);
+    ctx->gyro[0] = 5.0f * cosf(angle);
+    ctx->gyro[1] = 20.0f;
+    ctx->gyro[2] = -3.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        ctx->gyro_rad[axis] = ctx->gyro[axis] * (float)M_PI / 180.0f;
+    }
+}
+
+static void complementary_orientation(void *arg) {
+    orientation_ctx_t *ctx = (orientation_ctx_t *)arg;
+    next_imu_input(ctx);
+    imu_calculate_orientation(ctx->accel, ctx->gyro, 1.0f / IMU_SAMPLE_RATE_HZ, ctx->orientation,
+                              ctx->orientation);
+}
+
+// The quaternion filter the driver runs on every sample
+static void ahrs_orientation(void *arg) {
+    orientation_ctx_t *ctx = (orientation_ctx_t *)arg;
+    next_imu_input(ctx);
+    ahrs_update(&ctx->ahrs, ctx->gyro_rad, ctx->accel, 1.0f / IMU_SAMPLE_RATE_HZ);
+}
+
+TEST_CASE("imu orientation", "[perf][sensors]")
+{
+    memset(&orientation_ctx, 0, sizeof(orientation_ctx));
+    TEST_ASSERT_EQUAL(ESP_OK, ahrs_init(&orientation_ctx.ahrs, IMU_AHRS_BETA));
+
+    TEST_ASSERT_EQUAL(ESP_OK, perf_measure("imu_calculate_orientation", "complementary", 1,
+                                           ORIENTATION_ITERATIONS, complementary_orientation,
+                                           &orientation_ctx, NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, perf_measure("ahrs_update", "madgwick", 1, ORIENTATION_ITERATIONS,
+                                           ahrs_orientation, &orientation_ctx, NULL));
+}